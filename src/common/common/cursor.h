@@ -26,13 +26,25 @@
 #include <cairo/cairo.h>
 #include <guacamole/client.h>
 #include <guacamole/socket.h>
+#include <guacamole/timestamp.h>
 #include <guacamole/user.h>
 
+#include <pthread.h>
+
 /**
  * The default size of the cursor image buffer.
  */
 #define GUAC_COMMON_CURSOR_DEFAULT_SIZE 64*64*4
 
+/**
+ * The minimum amount of time between broadcasts of the cursor position which
+ * are performed directly by guac_common_cursor_update(), in milliseconds.
+ * Changes in position made more rapidly than this are held as pending state
+ * and broadcast by the next call to guac_common_cursor_flush(), or once this
+ * interval has elapsed if no frame is flushed in the meantime.
+ */
+#define GUAC_COMMON_CURSOR_BROADCAST_INTERVAL 50
+
 /**
  * Cursor object which maintains and synchronizes the current mouse cursor
  * state across all users of a specific client.
@@ -123,6 +135,45 @@ typedef struct guac_common_cursor {
      */
     guac_timestamp timestamp;
 
+    /**
+     * Non-zero if the cursor position or button state has changed since it
+     * was last broadcast to all other users, zero otherwise.
+     */
+    int broadcast_pending;
+
+    /**
+     * The server timestamp representing the point in time when the cursor
+     * position and button state were last broadcast to all other users.
+     */
+    guac_timestamp last_broadcast;
+
+    /**
+     * Non-zero if the cursor is being freed and the broadcast thread should
+     * stop, zero otherwise.
+     */
+    int stopping;
+
+    /**
+     * Thread which broadcasts any pending cursor state that has not been
+     * broadcast by guac_common_cursor_flush() by the end of the current
+     * broadcast interval, such that other users see the final position of
+     * the cursor even while no frames are being flushed.
+     */
+    pthread_t broadcast_thread;
+
+    /**
+     * Condition which is signalled when a broadcast is deferred or when the
+     * broadcast thread should stop.
+     */
+    pthread_cond_t _broadcast_deferred;
+
+    /**
+     * Lock which guards the cursor position, button state and pending
+     * broadcast state, as these are updated by user input threads while
+     * being broadcast by the thread flushing the display.
+     */
+    pthread_mutex_t _lock;
+
 } guac_common_cursor;
 
 /**
@@ -165,7 +216,13 @@ void guac_common_cursor_dup(guac_common_cursor* cursor, guac_user* user,
 /**
  * Updates the current position and button state of the mouse cursor, marking
  * the given user as the most recent user of the mouse. The remote mouse cursor
- * will be hidden for this user and shown for all others.
+ * will be hidden for this user and shown for all others. The new state is
+ * broadcast to all other users immediately only if no broadcast has occurred
+ * within the last GUAC_COMMON_CURSOR_BROADCAST_INTERVAL milliseconds.
+ * Otherwise, it is held until the next call to guac_common_cursor_flush(),
+ * replacing any state which had not yet been broadcast. If no such call
+ * occurs before the interval has elapsed, the pending state is broadcast
+ * and flushed by the cursor's own broadcast thread.
  *
  * @param cursor
  *     The cursor being updated.
@@ -195,6 +252,18 @@ void guac_common_cursor_dup(guac_common_cursor* cursor, guac_user* user,
 void guac_common_cursor_update(guac_common_cursor* cursor, guac_user* user,
         int x, int y, int button_mask);
 
+/**
+ * Broadcasts the current position and button state of the mouse cursor to
+ * all users other than the user that last moved the mouse, if that state has
+ * changed since it was last broadcast. The instructions sent are not flushed;
+ * this function is intended to be called as part of flushing a frame, which
+ * will flush the client socket once the frame is complete.
+ *
+ * @param cursor
+ *     The cursor to flush.
+ */
+void guac_common_cursor_flush(guac_common_cursor* cursor);
+
 /**
  * Sets the cursor image to the given raw image data. This raw image data must
  * be in 32-bit ARGB format, having 8 bits per color component, where the
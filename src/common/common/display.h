@@ -21,6 +21,8 @@
 #define GUAC_COMMON_DISPLAY_H
 
 #include "cursor.h"
+#include "encoder.h"
+#include "image-cache.h"
 #include "surface.h"
 
 #include <guacamole/client.h>
@@ -106,6 +108,21 @@ typedef struct guac_common_display {
      */
     int lossless;
 
+    /**
+     * Cache of image data previously sent by any layer or buffer of this
+     * display, allowing identical image data to be redrawn from a client-side
+     * copy rather than encoded and sent again. This cache is disabled until
+     * enabled with guac_common_display_set_image_cache_size().
+     */
+    guac_common_image_cache* image_cache;
+
+    /**
+     * The encoder used by all layers and buffers of this display to encode
+     * image data, using the number of threads requested by the client
+     * (encoder_threads) at the time the display was allocated.
+     */
+    guac_common_encoder* encoder;
+
     /**
      * Mutex which is locked internally when access to the display must be
      * synchronized. All public functions of guac_common_display should be
@@ -257,5 +274,23 @@ void guac_common_display_free_buffer(guac_common_display* display,
 void guac_common_display_set_lossless(guac_common_display* display,
         int lossless);
 
+/**
+ * Sets the maximum number of bytes of image data which may be retained within
+ * the image cache of the given display. Graphical updates whose contents
+ * exactly match image data previously sent will be drawn from a client-side
+ * copy of that data, rather than encoded and sent again. Specifying zero
+ * disables the image cache entirely. The image cache of a new display is
+ * disabled.
+ *
+ * @param display
+ *     The display to modify.
+ *
+ * @param size
+ *     The maximum number of bytes of image data to cache, or zero to disable
+ *     the image cache.
+ */
+void guac_common_display_set_image_cache_size(guac_common_display* display,
+        size_t size);
+
 #endif
 
@@ -0,0 +1,370 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUAC_COMMON_ENCODER_H
+#define GUAC_COMMON_ENCODER_H
+
+#include "config.h"
+
+#include <cairo/cairo.h>
+#include <guacamole/client.h>
+#include <guacamole/layer.h>
+#include <guacamole/protocol-types.h>
+#include <guacamole/socket.h>
+
+#include <pthread.h>
+#include <stdint.h>
+
+/**
+ * The maximum number of images which may be awaiting encoding or
+ * transmission within a single batch at any one time. Each such image holds
+ * one of the limited number of client-level streams (GUAC_CLIENT_MAX_STREAMS)
+ * until it has been sent, so this must be kept well below that limit.
+ */
+#define GUAC_COMMON_ENCODER_MAX_JOBS 16
+
+/**
+ * The image formats which may be produced by a guac_common_encoder.
+ */
+typedef enum guac_common_encoder_format {
+
+    /**
+     * Lossless PNG.
+     */
+    GUAC_COMMON_ENCODER_PNG,
+
+    /**
+     * Lossy JPEG.
+     */
+    GUAC_COMMON_ENCODER_JPEG,
+
+    /**
+     * WebP, which may be lossy or lossless.
+     */
+    GUAC_COMMON_ENCODER_WEBP,
+
+    /**
+     * The total number of image formats. This is not itself a valid format.
+     */
+    GUAC_COMMON_ENCODER_FORMATS
+
+} guac_common_encoder_format;
+
+/**
+ * Cumulative statistics describing all images encoded in a particular format.
+ */
+typedef struct guac_common_encoder_stats {
+
+    /**
+     * The total number of images encoded.
+     */
+    uint64_t images;
+
+    /**
+     * The total number of pixels within all images encoded.
+     */
+    uint64_t pixels;
+
+    /**
+     * The total number of bytes of protocol data produced, including the
+     * "img", "blob" and "end" instructions of each image.
+     */
+    uint64_t bytes;
+
+    /**
+     * The total amount of time spent encoding, in microseconds. As images may
+     * be encoded in parallel, this may exceed the amount of time actually
+     * elapsed.
+     */
+    uint64_t usec;
+
+} guac_common_encoder_stats;
+
+/**
+ * A single image awaiting encoding. The structure of each job is private to
+ * the encoder.
+ */
+typedef struct guac_common_encoder_job guac_common_encoder_job;
+
+/**
+ * A portion of the output of a batch, consisting of any instructions written
+ * to the batch socket prior to a particular image. The structure of each
+ * entry is private to the encoder.
+ */
+typedef struct guac_common_encoder_entry guac_common_encoder_entry;
+
+/**
+ * A pool of threads which encode image data in parallel on behalf of a
+ * single guac_client. Images are submitted in batches, and the instructions
+ * produced for each batch are sent in exactly the order the images were
+ * submitted, regardless of the order in which encoding completes.
+ */
+typedef struct guac_common_encoder {
+
+    /**
+     * The client for which images are being encoded.
+     */
+    guac_client* client;
+
+    /**
+     * The number of threads within the pool. If zero, images are encoded
+     * immediately by the thread submitting them.
+     */
+    int thread_count;
+
+    /**
+     * All threads within the pool.
+     */
+    pthread_t* threads;
+
+    /**
+     * The socket used to encode images serially, by whichever thread
+     * submits them, if the encoder has no threads. Each thread within the
+     * pool has its own socket.
+     */
+    guac_socket* socket;
+
+    /**
+     * The oldest job which has been submitted but not yet picked up by any
+     * thread, or NULL if no such jobs exist.
+     */
+    guac_common_encoder_job* pending_head;
+
+    /**
+     * The newest job which has been submitted but not yet picked up by any
+     * thread, or NULL if no such jobs exist.
+     */
+    guac_common_encoder_job* pending_tail;
+
+    /**
+     * Non-zero if the threads of the pool should stop once all pending jobs
+     * have been encoded.
+     */
+    int stopping;
+
+    /**
+     * Statistics for each image format, indexed by guac_common_encoder_format.
+     */
+    guac_common_encoder_stats stats[GUAC_COMMON_ENCODER_FORMATS];
+
+    /**
+     * Lock which guards all mutable state of the encoder, including the
+     * pending job queue, the completion state of each job, and the
+     * statistics of each format.
+     */
+    pthread_mutex_t _lock;
+
+    /**
+     * Condition which is signalled whenever a new job is queued, or when the
+     * pool is stopping.
+     */
+    pthread_cond_t _job_pending;
+
+    /**
+     * Condition which is signalled whenever any job completes.
+     */
+    pthread_cond_t _job_complete;
+
+} guac_common_encoder;
+
+/**
+ * A set of images, interleaved with arbitrary other instructions, which must
+ * be sent in order. Instructions which must be ordered relative to the images
+ * of the batch must be written to the batch socket rather than directly to
+ * the destination socket.
+ */
+typedef struct guac_common_encoder_batch {
+
+    /**
+     * The encoder which will encode the images of this batch.
+     */
+    guac_common_encoder* encoder;
+
+    /**
+     * The socket to which all output will ultimately be written.
+     */
+    guac_socket* destination;
+
+    /**
+     * The socket to which any instructions must be written that must be
+     * ordered relative to the images of this batch. If the encoder has no
+     * threads, this will be the destination socket itself.
+     */
+    guac_socket* socket;
+
+    /**
+     * The oldest entry of this batch which has not yet been sent, or NULL if
+     * the encoder has no threads.
+     */
+    guac_common_encoder_entry* head;
+
+    /**
+     * The newest entry of this batch, to which instructions written to the
+     * batch socket are currently appended, or NULL if the encoder has no
+     * threads.
+     */
+    guac_common_encoder_entry* tail;
+
+    /**
+     * The number of images within this batch which have not yet been sent.
+     */
+    int jobs;
+
+} guac_common_encoder_batch;
+
+/**
+ * Allocates a new encoder having the given number of threads. If the number
+ * of threads is zero, images will be encoded serially by whichever thread
+ * submits them, but statistics will still be recorded.
+ *
+ * @param client
+ *     The client for which images will be encoded.
+ *
+ * @param thread_count
+ *     The number of threads to use to encode images.
+ *
+ * @return
+ *     A newly-allocated encoder, which must eventually be freed with
+ *     guac_common_encoder_free().
+ */
+guac_common_encoder* guac_common_encoder_alloc(guac_client* client,
+        int thread_count);
+
+/**
+ * Stops all threads of the given encoder, logs the statistics recorded for
+ * each image format, and frees the encoder. There must be no batches in
+ * progress.
+ *
+ * @param encoder
+ *     The encoder to free.
+ */
+void guac_common_encoder_free(guac_common_encoder* encoder);
+
+/**
+ * Retrieves the statistics recorded for the given image format.
+ *
+ * @param encoder
+ *     The encoder to retrieve statistics from.
+ *
+ * @param format
+ *     The image format whose statistics should be retrieved.
+ *
+ * @param stats
+ *     The structure to populate with the statistics of the given format.
+ */
+void guac_common_encoder_get_stats(guac_common_encoder* encoder,
+        guac_common_encoder_format format, guac_common_encoder_stats* stats);
+
+/**
+ * Logs the statistics recorded for each image format which has been used at
+ * least once, at the given log level.
+ *
+ * @param encoder
+ *     The encoder whose statistics should be logged.
+ *
+ * @param level
+ *     The level at which the statistics should be logged.
+ */
+void guac_common_encoder_log_stats(guac_common_encoder* encoder,
+        guac_client_log_level level);
+
+/**
+ * Begins a new batch of images which will be sent to the given socket. Any
+ * instructions which must be ordered relative to the images of the batch must
+ * be written to the socket of the returned batch. The batch must eventually
+ * be ended with guac_common_encoder_end().
+ *
+ * @param encoder
+ *     The encoder which should encode the images of the batch.
+ *
+ * @param socket
+ *     The socket to which the output of the batch should be written.
+ *
+ * @return
+ *     A newly-allocated batch.
+ */
+guac_common_encoder_batch* guac_common_encoder_begin(
+        guac_common_encoder* encoder, guac_socket* socket);
+
+/**
+ * Submits the given image for encoding as part of the given batch. The
+ * resulting "img", "blob" and "end" instructions will be sent after all
+ * instructions previously written to the batch socket, and before any
+ * instructions written to the batch socket later. If the batch already
+ * contains GUAC_COMMON_ENCODER_MAX_JOBS unsent images, the oldest of those
+ * images are sent first, blocking until they have been encoded.
+ *
+ * @param batch
+ *     The batch to add the image to.
+ *
+ * @param format
+ *     The format to encode the image as.
+ *
+ * @param mode
+ *     The composite mode to use when drawing the image.
+ *
+ * @param layer
+ *     The layer the image should be drawn to.
+ *
+ * @param x
+ *     The X coordinate of the upper-left corner of the destination
+ *     rectangle.
+ *
+ * @param y
+ *     The Y coordinate of the upper-left corner of the destination
+ *     rectangle.
+ *
+ * @param image
+ *     The image to encode. The encoder takes ownership of this image, which
+ *     will be destroyed once encoded. The image data referenced by the image
+ *     must not change until the batch has been ended.
+ *
+ * @param quality
+ *     The quality to use for lossy formats, between 0 and 100 inclusive.
+ *
+ * @param lossless
+ *     Non-zero if WebP images should be encoded losslessly, zero otherwise.
+ *     This has no effect for other formats.
+ *
+ * @param filter
+ *     The filter restricting which users of the batch socket receive the
+ *     encoded image, as applied with guac_socket_broadcast_set_filter(), or
+ *     NULL if all users should receive the image.
+ *
+ * @param filter_data
+ *     Arbitrary data to pass to the given filter. This data must remain valid
+ *     until the batch has been ended.
+ */
+void guac_common_encoder_submit(guac_common_encoder_batch* batch,
+        guac_common_encoder_format format, guac_composite_mode mode,
+        const guac_layer* layer, int x, int y, cairo_surface_t* image,
+        int quality, int lossless, guac_user_filter* filter,
+        void* filter_data);
+
+/**
+ * Waits for all images of the given batch to be encoded, sends all output of
+ * the batch to its destination socket in order, and frees the batch.
+ *
+ * @param batch
+ *     The batch to end.
+ */
+void guac_common_encoder_end(guac_common_encoder_batch* batch);
+
+#endif
+
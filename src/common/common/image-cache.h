@@ -0,0 +1,308 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUAC_COMMON_IMAGE_CACHE_H
+#define GUAC_COMMON_IMAGE_CACHE_H
+
+#include "config.h"
+
+#include <cairo/cairo.h>
+#include <guacamole/client.h>
+#include <guacamole/layer.h>
+#include <guacamole/socket.h>
+#include <guacamole/user.h>
+
+#include <pthread.h>
+#include <stddef.h>
+
+/**
+ * The number of hash buckets within each image cache.
+ */
+#define GUAC_COMMON_IMAGE_CACHE_BUCKETS 1024
+
+/**
+ * The default maximum number of bytes of image data which may be held within
+ * an image cache, for protocols which allow the size of the image cache to be
+ * configured. The same amount of image data may additionally be held
+ * client-side within the buffers backing the cache. Image caches are
+ * otherwise disabled.
+ */
+#define GUAC_COMMON_IMAGE_CACHE_DEFAULT_SIZE 16777216
+
+/**
+ * The number of hashes of recently-sent images which are remembered by each
+ * image cache. An image is cached only if its hash is still remembered when
+ * it is sent again, such that images which never repeat are never copied.
+ */
+#define GUAC_COMMON_IMAGE_CACHE_SEEN 4096
+
+/**
+ * The minimum number of pixels that an image must contain to be considered
+ * for caching. Smaller images are cheap enough to encode that caching them
+ * would not be worthwhile.
+ */
+#define GUAC_COMMON_IMAGE_CACHE_MIN_AREA 4096
+
+/**
+ * A single image within an image cache, along with the client-side buffer
+ * containing an identical copy of that image.
+ */
+typedef struct guac_common_image_cache_entry {
+
+    /**
+     * The value of guac_hash_surface() for the cached image.
+     */
+    unsigned int hash;
+
+    /**
+     * Server-side copy of the cached image, used to verify that an image
+     * having the same hash is actually identical.
+     */
+    cairo_surface_t* image;
+
+    /**
+     * The client-side buffer containing the cached image at its upper-left
+     * corner.
+     */
+    guac_layer* buffer;
+
+    /**
+     * The number of bytes of image data within the cached image.
+     */
+    size_t size;
+
+    /**
+     * The next entry within the same hash bucket, or NULL if this is the last
+     * entry in the bucket.
+     */
+    struct guac_common_image_cache_entry* next;
+
+    /**
+     * The next more recently used entry, or NULL if this is the most recently
+     * used entry in the cache.
+     */
+    struct guac_common_image_cache_entry* newer;
+
+    /**
+     * The next less recently used entry, or NULL if this is the least recently
+     * used entry in the cache.
+     */
+    struct guac_common_image_cache_entry* older;
+
+} guac_common_image_cache_entry;
+
+/**
+ * A bounded cache of images which have already been sent to all users of a
+ * connection, keyed by content. Each cached image is retained client-side
+ * within its own buffer, such that an identical image can later be drawn with
+ * a "copy" instruction instead of being encoded and sent again.
+ */
+typedef struct guac_common_image_cache {
+
+    /**
+     * The client whose users receive the cached images.
+     */
+    guac_client* client;
+
+    /**
+     * Hash table of all cached images, keyed by the value of
+     * guac_hash_surface() modulo GUAC_COMMON_IMAGE_CACHE_BUCKETS.
+     */
+    guac_common_image_cache_entry* buckets[GUAC_COMMON_IMAGE_CACHE_BUCKETS];
+
+    /**
+     * The most recently used entry, or NULL if the cache is empty.
+     */
+    guac_common_image_cache_entry* newest;
+
+    /**
+     * The least recently used entry, or NULL if the cache is empty.
+     */
+    guac_common_image_cache_entry* oldest;
+
+    /**
+     * The hashes of images which were recently sent but not cached, each
+     * stored at the index given by that hash modulo
+     * GUAC_COMMON_IMAGE_CACHE_SEEN. Each hash is stored plus one, such that
+     * zero denotes an unused index. Hashes of different images which map to
+     * the same index replace each other.
+     */
+    unsigned int seen[GUAC_COMMON_IMAGE_CACHE_SEEN];
+
+    /**
+     * The total number of bytes of image data currently cached.
+     */
+    size_t size;
+
+    /**
+     * The maximum number of bytes of image data which may be cached. If zero,
+     * caching is disabled.
+     */
+    size_t max_size;
+
+    /**
+     * Mutex which is locked internally when access to the cache must be
+     * synchronized. As a single cache may be shared by many surfaces, all
+     * public functions of guac_common_image_cache should be considered
+     * threadsafe.
+     */
+    pthread_mutex_t _lock;
+
+} guac_common_image_cache;
+
+/**
+ * Allocates a new, empty image cache which will hold no more than the given
+ * number of bytes of image data.
+ *
+ * @param client
+ *     The client whose users will receive the cached images.
+ *
+ * @param max_size
+ *     The maximum number of bytes of image data to cache, or zero to disable
+ *     caching.
+ *
+ * @return
+ *     A newly-allocated image cache, which must eventually be freed with
+ *     guac_common_image_cache_free().
+ */
+guac_common_image_cache* guac_common_image_cache_alloc(guac_client* client,
+        size_t max_size);
+
+/**
+ * Frees the given image cache, including all cached images and the
+ * client-side buffers containing those images.
+ *
+ * @param cache
+ *     The image cache to free.
+ */
+void guac_common_image_cache_free(guac_common_image_cache* cache);
+
+/**
+ * Changes the maximum number of bytes of image data which may be held within
+ * the given cache, evicting least recently used images as necessary.
+ *
+ * @param cache
+ *     The image cache to modify.
+ *
+ * @param max_size
+ *     The maximum number of bytes of image data to cache, or zero to disable
+ *     caching.
+ */
+void guac_common_image_cache_set_size(guac_common_image_cache* cache,
+        size_t max_size);
+
+/**
+ * Draws the given image to the given layer from the cache, if an identical
+ * image has been cached, marking that image as most recently used. If no
+ * such image has been cached, nothing is drawn.
+ *
+ * @param cache
+ *     The image cache to search.
+ *
+ * @param socket
+ *     The socket over which the "copy" instruction should be sent if the
+ *     image is cached. This must be the socket of the client associated with
+ *     the cache.
+ *
+ * @param image
+ *     The image to draw. This must be an ARGB32 or RGB24 image surface.
+ *
+ * @param hash
+ *     The value of guac_hash_surface() for the given image.
+ *
+ * @param layer
+ *     The layer to draw the image to.
+ *
+ * @param x
+ *     The X coordinate of the upper-left corner of the destination within
+ *     the layer.
+ *
+ * @param y
+ *     The Y coordinate of the upper-left corner of the destination within
+ *     the layer.
+ *
+ * @return
+ *     Non-zero if the image was cached and has been drawn, zero otherwise.
+ */
+int guac_common_image_cache_draw(guac_common_image_cache* cache,
+        guac_socket* socket, cairo_surface_t* image, unsigned int hash,
+        const guac_layer* layer, int x, int y);
+
+/**
+ * Adds the given image to the cache, evicting least recently used images as
+ * necessary to remain within the size limit of the cache. The image must
+ * already have been drawn to the given layer at the given location, as the
+ * client-side copy of the image is taken from that layer rather than sent
+ * again. If the image alone exceeds the size limit of the cache, it is not
+ * cached. An image is only actually cached once it has been added at least
+ * twice; the first time, only its hash is remembered, such that the image
+ * data of updates which never repeat is never copied.
+ *
+ * @param cache
+ *     The image cache to add the image to.
+ *
+ * @param socket
+ *     The socket over which the image was drawn and over which the
+ *     instructions populating the cache, and disposing of any evicted
+ *     entries, should be sent. This must be the socket of the client
+ *     associated with the cache, or a socket whose contents are ultimately
+ *     written to that socket in order.
+ *
+ * @param image
+ *     The image to cache. This must be an ARGB32 or RGB24 image surface. If
+ *     the image is cached, its image data is copied; the cache does not take
+ *     ownership of the image.
+ *
+ * @param hash
+ *     The value of guac_hash_surface() for the given image.
+ *
+ * @param layer
+ *     The layer to which the image has already been drawn.
+ *
+ * @param x
+ *     The X coordinate of the upper-left corner of the image within the
+ *     layer.
+ *
+ * @param y
+ *     The Y coordinate of the upper-left corner of the image within the
+ *     layer.
+ */
+void guac_common_image_cache_add(guac_common_image_cache* cache,
+        guac_socket* socket, cairo_surface_t* image, unsigned int hash,
+        const guac_layer* layer, int x, int y);
+
+/**
+ * Synchronizes the client-side buffers of the given cache with the given
+ * user, such that later "copy" instructions sent by
+ * guac_common_image_cache_draw() will also be valid for that user.
+ *
+ * @param cache
+ *     The image cache to synchronize.
+ *
+ * @param user
+ *     The user receiving the cached images.
+ *
+ * @param socket
+ *     The socket over which the cached images should be sent.
+ */
+void guac_common_image_cache_dup(guac_common_image_cache* cache,
+        guac_user* user, guac_socket* socket);
+
+#endif
+
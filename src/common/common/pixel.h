@@ -0,0 +1,223 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUAC_COMMON_PIXEL_H
+#define GUAC_COMMON_PIXEL_H
+
+#include "config.h"
+
+#include <guacamole/protocol-types.h>
+
+#include <stdint.h>
+
+/**
+ * The instruction sets for which implementations of the pixel kernels used by
+ * guac_common_surface may be available.
+ */
+typedef enum guac_common_pixel_isa {
+
+    /**
+     * Portable C, processing one pixel at a time. This implementation is
+     * always available, and defines the output of all other implementations.
+     */
+    GUAC_COMMON_PIXEL_SCALAR,
+
+    /**
+     * x86 SSE2, processing four pixels at a time.
+     */
+    GUAC_COMMON_PIXEL_SSE2,
+
+    /**
+     * x86 AVX2, processing eight pixels at a time.
+     */
+    GUAC_COMMON_PIXEL_AVX2
+
+} guac_common_pixel_isa;
+
+/**
+ * The number of values within guac_common_pixel_isa.
+ */
+#define GUAC_COMMON_PIXEL_ISA_COUNT 3
+
+/**
+ * Writes a new value to each pixel of a row, tracking which pixels actually
+ * changed. Pixels are 32-bit ARGB values in native byte order with
+ * pre-multiplied alpha, as in Cairo's CAIRO_FORMAT_ARGB32.
+ *
+ * @param dst
+ *     The row of pixels to update.
+ *
+ * @param src
+ *     The row of source pixels, which may be NULL if the kernel does not use
+ *     source pixels.
+ *
+ * @param width
+ *     The number of pixels in the row.
+ *
+ * @param value
+ *     An additional value used by the kernel, such as a color or a
+ *     guac_transfer_function, or zero if not used.
+ *
+ * @param first
+ *     Pointer to an int which will receive the index of the first pixel
+ *     which changed. This is left untouched if no pixels changed.
+ *
+ * @param last
+ *     Pointer to an int which will receive the index of the last pixel
+ *     which changed. This is left untouched if no pixels changed.
+ *
+ * @return
+ *     Non-zero if any pixel changed, zero otherwise.
+ */
+typedef int guac_common_pixel_row_kernel(uint32_t* dst, const uint32_t* src,
+        int width, uint32_t value, int* first, int* last);
+
+/**
+ * Fills each pixel of a row with the given opaque color wherever the
+ * corresponding pixel of a mask row is not fully transparent.
+ *
+ * @param dst
+ *     The row of pixels to fill.
+ *
+ * @param mask
+ *     The row of mask pixels.
+ *
+ * @param width
+ *     The number of pixels in the row.
+ *
+ * @param color
+ *     The ARGB color to fill with.
+ */
+typedef void guac_common_pixel_fill_mask_kernel(uint32_t* dst,
+        const uint32_t* mask, int width, uint32_t color);
+
+/**
+ * Analyzes a row of pixels for the purposes of choosing an image format,
+ * counting the pixels whose color (ignoring alpha) matches the pixel
+ * immediately before, and combining the alpha of all pixels.
+ *
+ * @param row
+ *     The row of pixels to analyze.
+ *
+ * @param width
+ *     The number of pixels in the row.
+ *
+ * @param same
+ *     Pointer to an int which will be incremented once for each pixel whose
+ *     color matches the pixel immediately before it.
+ *
+ * @param alpha
+ *     Pointer to a value which will be bitwise ANDed with every pixel of the
+ *     row, such that its high byte remains 0xFF only if every pixel is fully
+ *     opaque.
+ */
+typedef void guac_common_pixel_analyze_kernel(const uint32_t* row, int width,
+        int* same, uint32_t* alpha);
+
+/**
+ * A complete set of the pixel kernels used by guac_common_surface, all
+ * implemented using the same instruction set. Every implementation produces
+ * output identical to that of the GUAC_COMMON_PIXEL_SCALAR implementation.
+ */
+typedef struct guac_common_pixel_kernels {
+
+    /**
+     * The instruction set used by these kernels.
+     */
+    guac_common_pixel_isa isa;
+
+    /**
+     * A human-readable name for the instruction set used by these kernels.
+     */
+    const char* name;
+
+    /**
+     * Copies source pixels over destination pixels, ignoring the alpha
+     * channel of the source and storing fully-opaque pixels. The value
+     * parameter is unused.
+     */
+    guac_common_pixel_row_kernel* copy_opaque;
+
+    /**
+     * Composites source pixels over destination pixels using the Porter-Duff
+     * "over" operator. The value parameter is unused.
+     */
+    guac_common_pixel_row_kernel* blend;
+
+    /**
+     * Sets all destination pixels to the ARGB color given as the value
+     * parameter. The source row is unused.
+     */
+    guac_common_pixel_row_kernel* set;
+
+    /**
+     * Combines source pixels with destination pixels using the
+     * guac_transfer_function given as the value parameter, processing
+     * pixels from first to last. The alpha channel of the destination is
+     * preserved by all functions except those which replace the destination
+     * entirely.
+     */
+    guac_common_pixel_row_kernel* transfer;
+
+    /**
+     * Identical to transfer, except that pixels are processed from last to
+     * first, as required when the source and destination are the same row
+     * and the destination lies to the right of the source.
+     */
+    guac_common_pixel_row_kernel* transfer_reverse;
+
+    /**
+     * Fills pixels with a color through a mask.
+     */
+    guac_common_pixel_fill_mask_kernel* fill_mask;
+
+    /**
+     * Counts repeated pixels and combines alpha for a row.
+     */
+    guac_common_pixel_analyze_kernel* analyze;
+
+} guac_common_pixel_kernels;
+
+/**
+ * Returns the pixel kernels implemented using the given instruction set, if
+ * that instruction set is supported both by this build and by the current
+ * processor.
+ *
+ * @param isa
+ *     The instruction set of the desired kernels.
+ *
+ * @return
+ *     The pixel kernels implemented using the given instruction set, or NULL
+ *     if those kernels cannot be used.
+ */
+const guac_common_pixel_kernels* guac_common_pixel_get_kernels(
+        guac_common_pixel_isa isa);
+
+/**
+ * Returns the fastest pixel kernels which can be used on the current
+ * processor. The kernels are selected once, when this function is first
+ * invoked.
+ *
+ * @return
+ *     The fastest pixel kernels which can be used on the current processor.
+ */
+const guac_common_pixel_kernels* guac_common_pixel_get_best_kernels();
+
+#endif
+
@@ -0,0 +1,218 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUAC_COMMON_RECORDING_COMPRESSION_H
+#define GUAC_COMMON_RECORDING_COMPRESSION_H
+
+#include <guacamole/socket.h>
+
+#include <sys/uio.h>
+#include <stdint.h>
+
+/**
+ * The number of bytes of compressed data processed at once when compressing
+ * or decompressing a recording.
+ */
+#define GUAC_COMMON_RECORDING_COMPRESSION_CHUNK_SIZE 65536
+
+/**
+ * The manner in which a session recording is compressed.
+ */
+typedef enum guac_common_recording_compression {
+
+    /**
+     * The recording is plain Guacamole protocol data.
+     */
+    GUAC_COMMON_RECORDING_COMPRESSION_NONE,
+
+    /**
+     * The recording is Guacamole protocol data compressed with gzip framing,
+     * as produced by zlib. The compressed stream is flushed each time data is
+     * written, such that an in-progress recording can be decompressed up to
+     * the most recent write.
+     */
+    GUAC_COMMON_RECORDING_COMPRESSION_GZIP
+
+} guac_common_recording_compression;
+
+/**
+ * State of a compressed recording which is being written.
+ */
+typedef struct guac_common_recording_compressor {
+
+    /**
+     * The manner in which the recording is compressed.
+     */
+    guac_common_recording_compression compression;
+
+    /**
+     * The file descriptor of the recording file.
+     */
+    int fd;
+
+    /**
+     * The compression stream of the underlying compression library.
+     */
+    void* stream;
+
+    /**
+     * Buffer receiving compressed data prior to that data being written to
+     * the recording file. This buffer is
+     * GUAC_COMMON_RECORDING_COMPRESSION_CHUNK_SIZE bytes in size.
+     */
+    unsigned char* output;
+
+    /**
+     * The total number of bytes of uncompressed data compressed thus far.
+     */
+    uint64_t bytes_in;
+
+    /**
+     * The total number of bytes of compressed data written thus far.
+     */
+    uint64_t bytes_out;
+
+    /**
+     * The total amount of CPU time spent compressing data, in microseconds.
+     */
+    uint64_t cpu_time;
+
+} guac_common_recording_compressor;
+
+/**
+ * Parses the given name of a compression format, as may be specified within
+ * connection parameters. Valid names are "none" and "gzip". An empty or NULL
+ * name is equivalent to "none".
+ *
+ * @param name
+ *     The name of the compression format to parse, or NULL.
+ *
+ * @param compression
+ *     Storage for the parsed compression format.
+ *
+ * @return
+ *     Zero if the name was parsed successfully, non-zero if the name is not
+ *     valid.
+ */
+int guac_common_recording_parse_compression(const char* name,
+        guac_common_recording_compression* compression);
+
+/**
+ * Returns whether session recordings can be written using the given
+ * compression format, as determined by the libraries available at build time.
+ *
+ * @param compression
+ *     The compression format to test.
+ *
+ * @return
+ *     Non-zero if the given compression format is supported, zero otherwise.
+ */
+int guac_common_recording_compression_supported(
+        guac_common_recording_compression compression);
+
+/**
+ * Allocates a compressor which writes compressed data to the given recording
+ * file. The file descriptor is not closed when the compressor is freed.
+ *
+ * @param compression
+ *     The compression format to use. This must not be
+ *     GUAC_COMMON_RECORDING_COMPRESSION_NONE, and must be supported.
+ *
+ * @param fd
+ *     The file descriptor of the recording file.
+ *
+ * @return
+ *     A newly-allocated compressor, or NULL if the compressor could not be
+ *     allocated.
+ */
+guac_common_recording_compressor* guac_common_recording_compressor_alloc(
+        guac_common_recording_compression compression, int fd);
+
+/**
+ * Compresses the given regions of uncompressed data, writing the result to
+ * the recording file. The compressed stream is flushed after all regions have
+ * been compressed, such that all data written thus far can be decompressed.
+ *
+ * @param compressor
+ *     The compressor to use.
+ *
+ * @param iov
+ *     The regions of uncompressed data to compress.
+ *
+ * @param iovcnt
+ *     The number of regions within the iov array.
+ *
+ * @return
+ *     Zero if all data was compressed and written successfully, non-zero
+ *     otherwise.
+ */
+int guac_common_recording_compressor_write(
+        guac_common_recording_compressor* compressor,
+        const struct iovec* iov, int iovcnt);
+
+/**
+ * Completes the compressed stream, writing any trailing data required by the
+ * compression format to the recording file. No further data may be written
+ * using the given compressor.
+ *
+ * @param compressor
+ *     The compressor whose stream should be completed.
+ *
+ * @return
+ *     Zero if the compressed stream was completed successfully, non-zero
+ *     otherwise.
+ */
+int guac_common_recording_compressor_finish(
+        guac_common_recording_compressor* compressor);
+
+/**
+ * Frees the given compressor. Any data which has not been written via
+ * guac_common_recording_compressor_finish() is discarded.
+ *
+ * @param compressor
+ *     The compressor to free.
+ */
+void guac_common_recording_compressor_free(
+        guac_common_recording_compressor* compressor);
+
+/**
+ * Returns a new guac_socket which reads the Guacamole protocol data of the
+ * recording open at the given file descriptor, transparently decompressing
+ * that data if the recording is compressed. Reading begins at the given
+ * offset within the uncompressed data. The file descriptor is closed when the
+ * returned socket is freed.
+ *
+ * @param fd
+ *     The file descriptor of the recording, positioned at the start of the
+ *     recording.
+ *
+ * @param offset
+ *     The offset within the uncompressed Guacamole protocol data at which
+ *     reading should begin.
+ *
+ * @return
+ *     A newly-allocated guac_socket which reads from the given recording, or
+ *     NULL if the recording cannot be read or the given offset cannot be
+ *     reached, in which case guac_error is set appropriately and the file
+ *     descriptor is left open.
+ */
+guac_socket* guac_common_recording_input_open(int fd, int64_t offset);
+
+#endif
+
@@ -0,0 +1,411 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUAC_COMMON_RECORDING_INDEX_H
+#define GUAC_COMMON_RECORDING_INDEX_H
+
+#include <guacamole/socket.h>
+#include <guacamole/timestamp-types.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * The suffix which is appended to the filename of a recording to produce the
+ * filename of its index.
+ */
+#define GUAC_COMMON_RECORDING_INDEX_SUFFIX ".idx"
+
+/**
+ * The minimum amount of recorded time between checkpoints, in milliseconds.
+ */
+#define GUAC_COMMON_RECORDING_INDEX_INTERVAL 10000
+
+/**
+ * The number of layers whose state is tracked within each checkpoint. Layers
+ * with larger indices are ignored.
+ */
+#define GUAC_COMMON_RECORDING_INDEX_MAX_LAYERS 64
+
+/**
+ * The number of buffers whose state is tracked within each checkpoint.
+ * Buffers with larger (more negative) indices are ignored.
+ */
+#define GUAC_COMMON_RECORDING_INDEX_MAX_BUFFERS 4096
+
+/**
+ * The number of streams whose state is tracked within each checkpoint.
+ * Streams with larger indices are ignored.
+ */
+#define GUAC_COMMON_RECORDING_INDEX_MAX_STREAMS 64
+
+/**
+ * The number of elements of each recorded instruction (including the opcode)
+ * which are retained while scanning for changes in state and for timestamps.
+ * The last element needed is the timestamp of the "touch" instruction.
+ */
+#define GUAC_COMMON_RECORDING_INDEX_MAX_ELEMENTS 10
+
+/**
+ * The maximum number of bytes of each retained instruction element, including
+ * null terminator. Longer elements are truncated, and are never needed in
+ * full by any instruction affecting the tracked state.
+ */
+#define GUAC_COMMON_RECORDING_INDEX_MAX_ELEMENT_LENGTH 32
+
+/**
+ * The state of a single layer, as of the most recent instruction scanned.
+ */
+typedef struct guac_common_recording_index_layer {
+
+    /**
+     * Non-zero if the layer has been sized, moved, or shaded, and not since
+     * disposed, zero otherwise.
+     */
+    int exists;
+
+    /**
+     * The width of the layer, in pixels.
+     */
+    int width;
+
+    /**
+     * The height of the layer, in pixels.
+     */
+    int height;
+
+    /**
+     * The index of the parent of the layer.
+     */
+    int parent;
+
+    /**
+     * The X coordinate of the layer relative to its parent.
+     */
+    int x;
+
+    /**
+     * The Y coordinate of the layer relative to its parent.
+     */
+    int y;
+
+    /**
+     * The Z order of the layer relative to its siblings.
+     */
+    int z;
+
+    /**
+     * The opacity of the layer, where 0 is fully transparent and 255 is fully
+     * opaque.
+     */
+    int opacity;
+
+} guac_common_recording_index_layer;
+
+/**
+ * The state of a single off-screen buffer, as of the most recent instruction
+ * scanned.
+ */
+typedef struct guac_common_recording_index_buffer {
+
+    /**
+     * Non-zero if the buffer has been sized and not since disposed, zero
+     * otherwise.
+     */
+    int exists;
+
+    /**
+     * The width of the buffer, in pixels.
+     */
+    int width;
+
+    /**
+     * The height of the buffer, in pixels.
+     */
+    int height;
+
+} guac_common_recording_index_buffer;
+
+/**
+ * Sidecar index of a session recording which is being written. Each
+ * checkpoint of the index records the timestamp of an instruction within the
+ * recording, the byte offset at which that instruction begins, and the
+ * layers, buffers, and streams which exist at that point. The index is itself
+ * Guacamole protocol data: a "checkpoint" instruction containing the
+ * timestamp and offset, followed by the "size", "move", and "shade"
+ * instructions required to restore the tracked layers and buffers, and a
+ * "stream" instruction for each stream left open.
+ */
+typedef struct guac_common_recording_index {
+
+    /**
+     * The guac_socket which writes to the index file.
+     */
+    guac_socket* socket;
+
+    /**
+     * The number of bytes of the recording scanned thus far.
+     */
+    int64_t offset;
+
+    /**
+     * The byte offset within the recording of the first byte of the
+     * instruction currently being scanned.
+     */
+    int64_t instruction_offset;
+
+    /**
+     * Non-zero if the recording could not be understood, in which case no
+     * further checkpoints are written, zero otherwise.
+     */
+    int failed;
+
+    /**
+     * Non-zero if the length of an element is currently being scanned, zero
+     * if the value of an element is being scanned.
+     */
+    int in_length;
+
+    /**
+     * The length of the element currently being scanned, or the number of
+     * characters which remain within its value.
+     */
+    int length;
+
+    /**
+     * The number of digits of the length of the element currently being
+     * scanned.
+     */
+    int digits;
+
+    /**
+     * The index of the element currently being scanned within its
+     * instruction, where the opcode is element 0.
+     */
+    int element;
+
+    /**
+     * The number of bytes of the current element which have been retained.
+     */
+    int element_length;
+
+    /**
+     * The retained elements of the instruction currently being scanned, each
+     * null-terminated once complete.
+     */
+    char elements[GUAC_COMMON_RECORDING_INDEX_MAX_ELEMENTS]
+        [GUAC_COMMON_RECORDING_INDEX_MAX_ELEMENT_LENGTH];
+
+    /**
+     * Non-zero if at least one checkpoint has been written, zero otherwise.
+     */
+    int checkpointed;
+
+    /**
+     * The timestamp of the most recently written checkpoint.
+     */
+    guac_timestamp last_checkpoint;
+
+    /**
+     * The state of all tracked layers, indexed by layer index.
+     */
+    guac_common_recording_index_layer
+        layers[GUAC_COMMON_RECORDING_INDEX_MAX_LAYERS];
+
+    /**
+     * The state of all tracked buffers, where the buffer having index -1 is
+     * the first element, -2 is the second, etc.
+     */
+    guac_common_recording_index_buffer
+        buffers[GUAC_COMMON_RECORDING_INDEX_MAX_BUFFERS];
+
+    /**
+     * Non-zero for each stream which has been opened but not yet ended,
+     * indexed by stream index.
+     */
+    int streams[GUAC_COMMON_RECORDING_INDEX_MAX_STREAMS];
+
+} guac_common_recording_index;
+
+/**
+ * A single instruction stored within a checkpoint which must be handled to
+ * restore the state of the recording at that checkpoint.
+ */
+typedef struct guac_common_recording_index_instruction {
+
+    /**
+     * The opcode of the instruction.
+     */
+    char* opcode;
+
+    /**
+     * The number of arguments of the instruction.
+     */
+    int argc;
+
+    /**
+     * All arguments of the instruction.
+     */
+    char** argv;
+
+} guac_common_recording_index_instruction;
+
+/**
+ * A checkpoint read from the index of a recording.
+ */
+typedef struct guac_common_recording_checkpoint {
+
+    /**
+     * The timestamp of the first checkpoint of the index, which is the
+     * timestamp of the first timestamped instruction of the recording.
+     */
+    guac_timestamp start;
+
+    /**
+     * The timestamp of the instruction at which this checkpoint was taken.
+     */
+    guac_timestamp timestamp;
+
+    /**
+     * The byte offset within the recording of the instruction at which this
+     * checkpoint was taken. Reading may resume from this offset.
+     */
+    int64_t offset;
+
+    /**
+     * The number of instructions within the state array.
+     */
+    int length;
+
+    /**
+     * The instructions which must be handled prior to those at the offset of
+     * this checkpoint to restore the tracked state of the recording.
+     */
+    guac_common_recording_index_instruction* state;
+
+} guac_common_recording_checkpoint;
+
+/**
+ * Allocates a new recording index which writes checkpoints to the given file
+ * descriptor. The file descriptor will be closed when the index is freed,
+ * but is left open if allocation fails.
+ *
+ * @param fd
+ *     The file descriptor of the open index file.
+ *
+ * @return
+ *     A newly-allocated recording index, or NULL if allocation fails.
+ */
+guac_common_recording_index* guac_common_recording_index_alloc(int fd);
+
+/**
+ * Flushes and frees the given recording index, closing its file.
+ *
+ * @param index
+ *     The recording index to free.
+ */
+void guac_common_recording_index_free(guac_common_recording_index* index);
+
+/**
+ * Scans the given data, which must be the next data written to the
+ * recording, updating the tracked state and writing any checkpoints that
+ * are due.
+ *
+ * @param index
+ *     The recording index to update.
+ *
+ * @param buf
+ *     The data written to the recording.
+ *
+ * @param length
+ *     The number of bytes of data written to the recording.
+ */
+void guac_common_recording_index_update(guac_common_recording_index* index,
+        const void* buf, size_t length);
+
+/**
+ * Reads the index of the recording at the given path, returning the last
+ * checkpoint which is no later than the given time. If the index does not
+ * exist or cannot be read, or if no checkpoint is sufficiently early, NULL is
+ * returned. Checkpoints beyond the current end of the recording, as may
+ * occur if a recording is still in progress, are ignored.
+ *
+ * @param path
+ *     The path to the recording (not to its index).
+ *
+ * @param time
+ *     The number of milliseconds since the start of the recording.
+ *
+ * @return
+ *     A newly-allocated checkpoint which must eventually be freed with
+ *     guac_common_recording_checkpoint_free(), or NULL if no such checkpoint
+ *     can be read.
+ */
+guac_common_recording_checkpoint* guac_common_recording_index_find(
+        const char* path, guac_timestamp time);
+
+/**
+ * Frees the given checkpoint, including all stored state instructions.
+ *
+ * @param checkpoint
+ *     The checkpoint to free.
+ */
+void guac_common_recording_checkpoint_free(
+        guac_common_recording_checkpoint* checkpoint);
+
+/**
+ * Returns the timestamp of the given recorded instruction, if it has one.
+ * The "sync", "mouse", "key", and "touch" instructions are timestamped.
+ *
+ * @param opcode
+ *     The opcode of the instruction.
+ *
+ * @param argc
+ *     The number of arguments of the instruction.
+ *
+ * @param argv
+ *     The arguments of the instruction.
+ *
+ * @param timestamp
+ *     Storage for the timestamp of the instruction.
+ *
+ * @return
+ *     Non-zero if the instruction has a timestamp, zero otherwise.
+ */
+int guac_common_recording_get_timestamp(const char* opcode, int argc,
+        char** argv, guac_timestamp* timestamp);
+
+/**
+ * Parses the given amount of time within a recording, which may be a number
+ * of seconds ("SS"), minutes and seconds ("MM:SS"), or hours, minutes, and
+ * seconds ("HH:MM:SS").
+ *
+ * @param value
+ *     The string to parse.
+ *
+ * @param time
+ *     Storage for the parsed amount of time, in milliseconds.
+ *
+ * @return
+ *     Zero if the value was parsed successfully, non-zero otherwise.
+ */
+int guac_common_recording_parse_time(const char* value, guac_timestamp* time);
+
+#endif
+
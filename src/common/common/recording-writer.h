@@ -0,0 +1,343 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUAC_COMMON_RECORDING_WRITER_H
+#define GUAC_COMMON_RECORDING_WRITER_H
+
+#include "common/recording-compression.h"
+#include "common/recording-index.h"
+
+#include <guacamole/client.h>
+#include <guacamole/socket.h>
+#include <guacamole/timestamp-types.h>
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * The default number of bytes of recorded data which may be queued in memory
+ * while waiting to be written to the recording file.
+ */
+#define GUAC_COMMON_RECORDING_WRITER_DEFAULT_SIZE 16777216
+
+/**
+ * The maximum number of microseconds that the writer thread of a
+ * guac_common_recording_writer will wait for further data before writing
+ * whatever data is already queued.
+ */
+#define GUAC_COMMON_RECORDING_WRITER_INTERVAL 250000
+
+/**
+ * What should happen when data is written to a recording whose queue is full.
+ */
+typedef enum guac_common_recording_overflow_policy {
+
+    /**
+     * The thread writing to the recording waits until sufficient queued data
+     * has been written to the recording file. No data is lost, but the
+     * session stalls for as long as the recording file cannot keep up.
+     */
+    GUAC_COMMON_RECORDING_OVERFLOW_BLOCK,
+
+    /**
+     * Entire instructions are discarded until at least half of the queue has
+     * been written to the recording file, at which point a "gap" instruction
+     * is written to mark the discarded data and recording resumes. The
+     * session never stalls, but the recording will be incomplete.
+     */
+    GUAC_COMMON_RECORDING_OVERFLOW_DROP
+
+} guac_common_recording_overflow_policy;
+
+/**
+ * Bounded in-memory queue of recorded Guacamole protocol data, drained to the
+ * recording file by a dedicated writer thread such that the threads producing
+ * the recorded data do not perform any file I/O. Queued data is written in
+ * batches of up to the size of the entire queue, and any compression of the
+ * recording or updates to its sidecar index are likewise performed by the
+ * writer thread.
+ *
+ * Data is appended via the guac_socket returned by
+ * guac_common_recording_writer_socket(). If data is discarded under
+ * GUAC_COMMON_RECORDING_OVERFLOW_DROP, the recording receives the following
+ * instruction once recording resumes:
+ *
+ *     gap,START,END,BYTES;
+ *
+ * where START is the timestamp at which data was first discarded, END is the
+ * timestamp at which recording resumed, and BYTES is the number of bytes
+ * discarded.
+ */
+typedef struct guac_common_recording_writer {
+
+    /**
+     * The client associated with the recording, for logging purposes.
+     */
+    guac_client* client;
+
+    /**
+     * The file descriptor of the recording file.
+     */
+    int fd;
+
+    /**
+     * The index to update as data is written to the recording file, or NULL
+     * if the recording is not indexed.
+     */
+    guac_common_recording_index* index;
+
+    /**
+     * The compressor which should compress all data written to the recording
+     * file, or NULL if the recording is not compressed.
+     */
+    guac_common_recording_compressor* compressor;
+
+    /**
+     * What should happen if this queue overflows.
+     */
+    guac_common_recording_overflow_policy policy;
+
+    /**
+     * Circular buffer containing all queued data.
+     */
+    char* buffer;
+
+    /**
+     * The size of the circular buffer, in bytes.
+     */
+    size_t size;
+
+    /**
+     * The position of the next byte to be written to the recording file. This
+     * is updated only by the writer thread, while holding the state lock.
+     */
+    size_t head;
+
+    /**
+     * The position at which the next byte appended to the queue will be
+     * stored. This may point within a partially-queued instruction.
+     */
+    size_t tail;
+
+    /**
+     * The position immediately after the last byte which the writer thread
+     * may write. Under GUAC_COMMON_RECORDING_OVERFLOW_DROP, this advances
+     * only at instruction boundaries, such that partially-queued instructions
+     * can be discarded.
+     */
+    size_t committed;
+
+    /**
+     * Non-zero if the instruction currently being appended is being
+     * discarded, zero otherwise.
+     */
+    int dropping;
+
+    /**
+     * Non-zero if data has been discarded and a "gap" instruction has not
+     * yet been written, zero otherwise.
+     */
+    int overflowed;
+
+    /**
+     * The timestamp at which data was first discarded, if overflowed is
+     * non-zero.
+     */
+    guac_timestamp gap_start;
+
+    /**
+     * The number of bytes discarded since overflowed was last set.
+     */
+    uint64_t gap_bytes;
+
+    /**
+     * Non-zero if writing to the recording file has failed, in which case
+     * all further data is discarded, zero otherwise.
+     */
+    int failed;
+
+    /**
+     * Non-zero if the writer thread should write all remaining data and
+     * stop, zero otherwise.
+     */
+    int stopping;
+
+    /**
+     * Non-zero if the writer thread is currently waiting for data, zero
+     * otherwise.
+     */
+    int writer_waiting;
+
+    /**
+     * The number of producer threads currently waiting for space within the
+     * queue.
+     */
+    int producers_waiting;
+
+    /**
+     * The total number of bytes which have been appended to the queue.
+     */
+    uint64_t bytes_queued;
+
+    /**
+     * The total number of bytes which have been written to the recording
+     * file.
+     */
+    uint64_t bytes_written;
+
+    /**
+     * The total number of bytes which have been discarded, either due to
+     * overflow or due to failure to write the recording file.
+     */
+    uint64_t bytes_dropped;
+
+    /**
+     * The total number of "gap" instructions written.
+     */
+    unsigned int gaps;
+
+    /**
+     * The largest number of bytes which have been queued at once.
+     */
+    size_t peak_depth;
+
+    /**
+     * The total number of times a producer had to wait for space within the
+     * queue.
+     */
+    unsigned int stalls;
+
+    /**
+     * The total amount of time producers have spent waiting for space within
+     * the queue, in microseconds.
+     */
+    uint64_t stall_time;
+
+    /**
+     * Lock which is held by a producer for the duration of each instruction,
+     * such that instructions from different threads are never interleaved.
+     */
+    pthread_mutex_t instruction_lock;
+
+    /**
+     * Lock which guards all positions, flags, and counters of the queue.
+     */
+    pthread_mutex_t state_lock;
+
+    /**
+     * Condition which is signalled when the writer thread should write queued
+     * data or stop.
+     */
+    pthread_cond_t data_available;
+
+    /**
+     * Condition which is signalled when the writer thread has freed space
+     * within the queue.
+     */
+    pthread_cond_t space_available;
+
+    /**
+     * The writer thread which drains this queue to the recording file.
+     */
+    pthread_t writer;
+
+} guac_common_recording_writer;
+
+/**
+ * Allocates a new recording writer for the given recording file, starting a
+ * writer thread which drains the queue to that file.
+ *
+ * @param client
+ *     The client associated with the recording, for logging purposes.
+ *
+ * @param fd
+ *     The file descriptor of the recording file. If allocation succeeds, this
+ *     file descriptor will be closed when the writer is freed. If allocation
+ *     fails, this file descriptor is left open.
+ *
+ * @param index
+ *     The index to update as data is written to the recording file, or NULL
+ *     if the recording is not indexed. If allocation succeeds, the index will
+ *     be freed when the writer is freed.
+ *
+ * @param compressor
+ *     The compressor which should compress all data written to the recording
+ *     file, or NULL if the recording should not be compressed. If allocation
+ *     succeeds, the compressed stream will be completed and the compressor
+ *     freed when the writer is freed.
+ *
+ * @param size
+ *     The maximum number of bytes which may be queued in memory.
+ *
+ * @param policy
+ *     What should happen if the queue overflows.
+ *
+ * @return
+ *     A newly-allocated recording writer, or NULL if the writer or its writer
+ *     thread could not be created.
+ */
+guac_common_recording_writer* guac_common_recording_writer_alloc(
+        guac_client* client, int fd, guac_common_recording_index* index,
+        guac_common_recording_compressor* compressor, size_t size,
+        guac_common_recording_overflow_policy policy);
+
+/**
+ * Writes all remaining queued data, stops the writer thread, logs the final
+ * counters of the given recording writer, and frees that writer, completing
+ * any compressed stream, closing the recording file, and freeing its index,
+ * if any. The writer must no longer be accessible to producers when this
+ * function is invoked.
+ *
+ * @param writer
+ *     The recording writer to free.
+ */
+void guac_common_recording_writer_free(guac_common_recording_writer* writer);
+
+/**
+ * Returns a new guac_socket which appends all data written to the queue of
+ * the given recording writer. Flushing the returned socket does not wait for
+ * data to be written. Freeing the returned socket frees the writer with
+ * guac_common_recording_writer_free().
+ *
+ * @param writer
+ *     The recording writer which should receive all data written to the
+ *     returned socket.
+ *
+ * @return
+ *     A newly-allocated guac_socket which writes to the given recording
+ *     writer, or NULL if the socket could not be allocated.
+ */
+guac_socket* guac_common_recording_writer_socket(
+        guac_common_recording_writer* writer);
+
+/**
+ * Returns the number of bytes currently queued.
+ *
+ * @param writer
+ *     The recording writer to inspect.
+ *
+ * @return
+ *     The number of bytes currently queued.
+ */
+size_t guac_common_recording_writer_depth(
+        guac_common_recording_writer* writer);
+
+#endif
+
@@ -50,8 +50,9 @@
 typedef struct guac_common_recording {
 
     /**
-     * The guac_socket which writes directly to the recording file, rather than
-     * to any particular user.
+     * The guac_socket which writes to the recording file, rather than to any
+     * particular user. Data written to this socket is queued and written to
+     * the recording file by a dedicated thread.
      */
     guac_socket* socket;
 
@@ -142,6 +143,35 @@ typedef struct guac_common_recording {
  *     caution. Key events can easily contain sensitive information, such as
  *     passwords, credit card numbers, etc.
  *
+ * @param write_index
+ *     Non-zero if a sidecar index of the recording should be written
+ *     alongside the recording, zero otherwise. The index is written to a file
+ *     having the same name as the recording plus the suffix
+ *     GUAC_COMMON_RECORDING_INDEX_SUFFIX, and allows tools like guacenc and
+ *     guaclog to begin processing the recording at an arbitrary point in
+ *     time.
+ *
+ * @param buffer_size
+ *     The maximum number of bytes of recorded data which may be held in
+ *     memory while waiting to be written to the recording file, or zero to
+ *     use GUAC_COMMON_RECORDING_WRITER_DEFAULT_SIZE. The recording file is
+ *     written by a dedicated thread, such that the session is not affected
+ *     by the performance of the filesystem unless this limit is reached.
+ *
+ * @param drop_on_overflow
+ *     Non-zero if recorded data should be discarded while buffer_size bytes
+ *     are already waiting to be written, leaving a gap in the recording, or
+ *     zero if the session should instead wait for the recording file to catch
+ *     up.
+ *
+ * @param compression
+ *     The name of the compression format which should be used to compress
+ *     the recording as it is written, such as "gzip", or NULL or "none" if
+ *     the recording should not be compressed. If the format is not valid or
+ *     not supported, a warning is logged and the recording is written
+ *     uncompressed. Compressed recordings are read transparently by guacenc
+ *     and guaclog.
+ *
  * @return
  *     A new guac_common_recording structure representing the in-progress
  *     recording if the recording file has been successfully created and a
@@ -150,7 +180,8 @@ typedef struct guac_common_recording {
 guac_common_recording* guac_common_recording_create(guac_client* client,
         const char* path, const char* name, int create_path,
         int include_output, int include_mouse, int include_touch,
-        int include_keys);
+        int include_keys, int write_index, int buffer_size,
+        int drop_on_overflow, const char* compression);
 
 /**
  * Frees the resources associated with the given in-progress recording. Note
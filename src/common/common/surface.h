@@ -21,6 +21,8 @@
 #define __GUAC_COMMON_SURFACE_H
 
 #include "config.h"
+#include "encoder.h"
+#include "image-cache.h"
 #include "rect.h"
 
 #include <cairo/cairo.h>
@@ -31,11 +33,6 @@
 
 #include <pthread.h>
 
-/**
- * The maximum number of updates to allow within the bitmap queue.
- */
-#define GUAC_COMMON_SURFACE_QUEUE_SIZE 256
-
 /**
  * Heat map cell size in pixels. Each side of each heat map cell will consist
  * of this many pixels.
@@ -58,9 +55,91 @@
  */
 #define GUAC_COMMON_SURFACE_HEAT_CELL_HISTORY_SIZE 5
 
+/**
+ * The maximum number of distinct encoding tiers into which the users of a
+ * surface may be divided. Users which do not fit within a tier of their own
+ * receive the encodings of the first tier, which is acceptable to all users.
+ */
+#define GUAC_COMMON_SURFACE_MAX_TIERS 4
+
+/**
+ * The granularity with which the lossy quality of each user is rounded down
+ * when dividing users into tiers, such that users with similar qualities
+ * share the same encoding.
+ */
+#define GUAC_COMMON_SURFACE_QUALITY_STEP 20
+
+/**
+ * The encoding capabilities and requirements shared by a group of users,
+ * which therefore may receive identical encodings of the same image data.
+ */
+typedef struct guac_common_surface_tier {
+
+    /**
+     * Non-zero if all users within this tier support WebP.
+     */
+    int webp;
+
+    /**
+     * The quality to use for lossy encodings sent to users within this tier.
+     */
+    int quality;
+
+    /**
+     * Non-zero if the users within this tier are congested, such that lossy
+     * encodings should be preferred.
+     */
+    int congested;
+
+    /**
+     * The number of users assigned to this tier.
+     */
+    int users;
+
+} guac_common_surface_tier;
+
+/**
+ * The tier assigned to a particular user, stored within the open-addressed
+ * hash table of tier assignments of a guac_common_surface.
+ */
+typedef struct guac_common_surface_tier_user {
+
+    /**
+     * The user assigned to the tier, or NULL if this entry of the hash table
+     * is unused. This pointer is only compared and is never dereferenced, and
+     * thus remains safe to use even if the user disconnects during a flush.
+     */
+    guac_user* user;
+
+    /**
+     * The index of the tier assigned to the user.
+     */
+    int tier;
+
+} guac_common_surface_tier_user;
+
+/**
+ * The set of tiers whose users should receive a particular encoding.
+ */
+typedef struct guac_common_surface_tier_group {
+
+    /**
+     * The surface whose tiers are referenced by this group.
+     */
+    struct guac_common_surface* surface;
+
+    /**
+     * Bitmask of tier indices, where each set bit denotes a tier whose users
+     * should receive the encoding.
+     */
+    int tiers;
+
+} guac_common_surface_tier_group;
+
 /**
  * Representation of a cell in the refresh heat map. This cell is used to keep
- * track of how often an area on a surface is refreshed.
+ * track of how often an area on a surface is refreshed, as well as which
+ * portion of that area has changed since the surface was last flushed.
  */
 typedef struct guac_common_surface_heat_cell {
 
@@ -79,25 +158,21 @@ typedef struct guac_common_surface_heat_cell {
      */
     int oldest_entry;
 
-} guac_common_surface_heat_cell;
-
-/**
- * Representation of a bitmap update, having a rectangle of image data (stored
- * elsewhere) and a flushed/not-flushed state.
- */
-typedef struct guac_common_surface_bitmap_rect {
-
     /**
-     * Whether this rectangle has been flushed.
+     * Non-zero if any part of the area associated with this heat map cell has
+     * changed since the surface was last flushed, zero otherwise.
      */
-    int flushed;
+    int dirty;
 
     /**
-     * The rectangle containing the bitmap update.
+     * The bounds of all changes made within the area associated with this
+     * heat map cell since the surface was last flushed, in surface
+     * coordinates. This rectangle is always contained within the area of
+     * this cell, and is only meaningful if dirty is non-zero.
      */
-    guac_common_rect rect;
+    guac_common_rect dirty_rect;
 
-} guac_common_surface_bitmap_rect;
+} guac_common_surface_heat_cell;
 
 /**
  * Surface which backs a Guacamole buffer or layer, automatically
@@ -226,20 +301,84 @@ typedef struct guac_common_surface {
     guac_common_rect clip_rect;
 
     /**
-     * The number of updates in the bitmap queue.
+     * A heat map keeping track of the refresh frequency of
+     * the areas of the screen. Each cell additionally tracks the portion of
+     * its area which has changed but has not yet been flushed.
      */
-    int bitmap_queue_length;
+    guac_common_surface_heat_cell* heat_map;
 
     /**
-     * All queued bitmap updates.
+     * Non-zero if any cell of the heat map has been marked dirty since the
+     * surface was last flushed, zero otherwise.
      */
-    guac_common_surface_bitmap_rect bitmap_queue[GUAC_COMMON_SURFACE_QUEUE_SIZE];
+    int damaged;
 
     /**
-     * A heat map keeping track of the refresh frequency of
-     * the areas of the screen.
+     * The cache of previously-sent images which should be used to avoid
+     * resending image data that all users already have, or NULL if no such
+     * cache should be used.
      */
-    guac_common_surface_heat_cell* heat_map;
+    guac_common_image_cache* image_cache;
+
+    /**
+     * The encoder which should be used to encode image data when flushing,
+     * or NULL if image data should be encoded directly by the flushing
+     * thread.
+     */
+    guac_common_encoder* encoder;
+
+    /**
+     * The batch of images being encoded by the current flush operation, or
+     * NULL if no flush is in progress or no encoder is in use.
+     */
+    guac_common_encoder_batch* batch;
+
+    /**
+     * The tiers into which the users of the surface were divided at the start
+     * of the current flush operation. The first tier is always acceptable to
+     * all users.
+     */
+    guac_common_surface_tier tiers[GUAC_COMMON_SURFACE_MAX_TIERS];
+
+    /**
+     * The number of tiers within the tiers array.
+     */
+    int tier_count;
+
+    /**
+     * Hash table of the tier assigned to each user at the start of the
+     * current flush operation, using open addressing keyed by the user
+     * pointer. Users not present within this table, such as users which
+     * joined during the flush, are treated as belonging to the first tier.
+     */
+    guac_common_surface_tier_user* tier_users;
+
+    /**
+     * The number of users within the tier_users hash table.
+     */
+    int tier_user_count;
+
+    /**
+     * The number of entries allocated for the tier_users hash table. This is
+     * always zero or a power of two, and is kept at least twice
+     * tier_user_count.
+     */
+    int tier_users_size;
+
+    /**
+     * Bitmask of the tiers whose encoding of the image data currently being
+     * flushed is also sent to anything other than a user, such as a session
+     * recording. Only one encoding is ever sent to such consumers: the
+     * lossless encoding, if any tier receives a lossless encoding, or the
+     * encoding of the first tier otherwise.
+     */
+    int recorded_tiers;
+
+    /**
+     * All possible groups of tiers, indexed by tier bitmask, for use as the
+     * data of the filters which route each encoding to its users.
+     */
+    guac_common_surface_tier_group tier_groups[1 << GUAC_COMMON_SURFACE_MAX_TIERS];
 
     /**
      * Mutex which is locked internally when access to the surface must be
@@ -343,6 +482,26 @@ void guac_common_surface_paint(guac_common_surface* surface, int x, int y, cairo
 void guac_common_surface_copy(guac_common_surface* src, int sx, int sy, int w, int h,
                               guac_common_surface* dst, int dx, int dy);
 
+/**
+ * Copies a rectangle of data between two surfaces, always sending the copy
+ * as a "copy" instruction. Unlike guac_common_surface_copy(), the copy is
+ * never combined with other pending updates to the destination surface and
+ * later resent as image data, which is preferable when the source surface
+ * exists solely so that its contents can be copied cheaply, such as a cache
+ * of pre-rendered glyphs.
+ *
+ * @param src The source surface.
+ * @param sx The X coordinate of the upper-left corner of the source rect.
+ * @param sy The Y coordinate of the upper-left corner of the source rect.
+ * @param w The width of the source rect.
+ * @param h The height of the source rect.
+ * @param dst The destination surface.
+ * @param dx The X coordinate of the upper-left corner of the destination rect.
+ * @param dy The Y coordinate of the upper-left corner of the destination rect.
+ */
+void guac_common_surface_copy_direct(guac_common_surface* src, int sx, int sy,
+        int w, int h, guac_common_surface* dst, int dx, int dy);
+
 /**
  * Transfers a rectangle of data between two surfaces.
  *
@@ -535,5 +694,41 @@ void guac_common_surface_set_multitouch(guac_common_surface* surface,
 void guac_common_surface_set_lossless(guac_common_surface* surface,
         int lossless);
 
-#endif
+/**
+ * Sets the cache of previously-sent images which should be used by the given
+ * surface when flushing. Large updates which are identical to an image within
+ * the cache will be drawn from the client-side copy of that image rather than
+ * being encoded and sent again, and large updates which are not yet cached
+ * will be added to the cache. By default, newly-created surfaces do not use
+ * an image cache.
+ *
+ * @param surface
+ *     The surface to modify.
+ *
+ * @param image_cache
+ *     The image cache to use, or NULL to stop using an image cache. The image
+ *     cache must be associated with the same client as the surface, and must
+ *     remain allocated while in use by the surface.
+ */
+void guac_common_surface_set_image_cache(guac_common_surface* surface,
+        guac_common_image_cache* image_cache);
 
+/**
+ * Sets the encoder which should be used by the given surface to encode image
+ * data when flushing. All image data within a single flush is submitted to
+ * the encoder as one batch, allowing independent updates to be encoded in
+ * parallel while still being sent in order. By default, newly-created
+ * surfaces encode image data directly.
+ *
+ * @param surface
+ *     The surface to modify.
+ *
+ * @param encoder
+ *     The encoder to use, or NULL to encode image data directly. The encoder
+ *     must be associated with the same client as the surface, and must
+ *     remain allocated while in use by the surface.
+ */
+void guac_common_surface_set_encoder(guac_common_surface* surface,
+        guac_common_encoder* encoder);
+
+#endif
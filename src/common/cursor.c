@@ -32,10 +32,26 @@
 #include <guacamole/user.h>
 
 #include <limits.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 
+/**
+ * Thread which broadcasts and flushes any cursor state still pending at the
+ * end of the broadcast interval in which it was deferred, for cases where no
+ * frame is flushed to broadcast that state via guac_common_cursor_flush().
+ * The thread runs until the cursor is freed.
+ *
+ * @param data
+ *     The guac_common_cursor whose deferred state should be broadcast.
+ *
+ * @return
+ *     Always NULL.
+ */
+static void* guac_common_cursor_broadcast_thread(void* data);
+
 /**
  * Allocates a cursor as well as an image buffer where the cursor is rendered.
  *
@@ -73,6 +89,28 @@ guac_common_cursor* guac_common_cursor_alloc(guac_client* client) {
     /* Start cursor in upper-left */
     cursor->x = 0;
     cursor->y = 0;
+    cursor->button_mask = 0;
+
+    /* Nothing yet to broadcast */
+    cursor->broadcast_pending = 0;
+    cursor->last_broadcast = 0;
+    cursor->stopping = 0;
+
+    pthread_mutex_init(&cursor->_lock, NULL);
+    pthread_cond_init(&cursor->_broadcast_deferred, NULL);
+
+    /* Broadcast deferred state even if no frames are flushed */
+    if (pthread_create(&cursor->broadcast_thread, NULL,
+                guac_common_cursor_broadcast_thread, cursor)) {
+        guac_client_log(client, GUAC_LOG_ERROR, "Unable to start cursor "
+                "broadcast thread.");
+        pthread_cond_destroy(&cursor->_broadcast_deferred);
+        pthread_mutex_destroy(&cursor->_lock);
+        guac_client_free_buffer(client, cursor->buffer);
+        free(cursor->image_buffer);
+        free(cursor);
+        return NULL;
+    }
 
     return cursor;
 
@@ -80,6 +118,13 @@ guac_common_cursor* guac_common_cursor_alloc(guac_client* client) {
 
 void guac_common_cursor_free(guac_common_cursor* cursor) {
 
+    /* Stop broadcasting deferred state */
+    pthread_mutex_lock(&cursor->_lock);
+    cursor->stopping = 1;
+    pthread_cond_signal(&cursor->_broadcast_deferred);
+    pthread_mutex_unlock(&cursor->_lock);
+    pthread_join(cursor->broadcast_thread, NULL);
+
     guac_client* client = cursor->client;
     guac_layer* buffer = cursor->buffer;
     cairo_surface_t* surface = cursor->surface;
@@ -95,6 +140,8 @@ void guac_common_cursor_free(guac_common_cursor* cursor) {
     /* Return buffer to pool */
     guac_client_free_buffer(client, buffer);
 
+    pthread_cond_destroy(&cursor->_broadcast_deferred);
+    pthread_mutex_destroy(&cursor->_lock);
     free(cursor);
 
 }
@@ -103,8 +150,10 @@ void guac_common_cursor_dup(guac_common_cursor* cursor, guac_user* user,
         guac_socket* socket) {
 
     /* Synchronize location */
+    pthread_mutex_lock(&cursor->_lock);
     guac_protocol_send_mouse(socket, cursor->x, cursor->y, cursor->button_mask,
             cursor->timestamp);
+    pthread_mutex_unlock(&cursor->_lock);
 
     /* Synchronize cursor image */
     if (cursor->surface != NULL) {
@@ -124,13 +173,86 @@ void guac_common_cursor_dup(guac_common_cursor* cursor, guac_user* user,
 }
 
 /**
- * Callback for guac_client_foreach_user() which sends the current cursor
- * position and button state to any given user except the user that moved the
- * cursor last.
+ * A snapshot of the cursor position and button state which is being broadcast
+ * to all users except the user that moved the cursor last. Broadcasts are
+ * performed from a snapshot such that the cursor lock need not be held while
+ * iterating the users of the client.
+ */
+typedef struct guac_common_cursor_broadcast {
+
+    /**
+     * The user that moved the cursor last, and to whom the cursor state
+     * should not be sent.
+     */
+    guac_user* user;
+
+    /**
+     * The X coordinate of the cursor.
+     */
+    int x;
+
+    /**
+     * The Y coordinate of the cursor.
+     */
+    int y;
+
+    /**
+     * The button state of the cursor, as defined by
+     * guac_common_cursor.button_mask.
+     */
+    int button_mask;
+
+    /**
+     * The server timestamp representing the point in time when the cursor
+     * state was last updated.
+     */
+    guac_timestamp timestamp;
+
+    /**
+     * Non-zero if each user's socket should be flushed after the cursor
+     * state is sent, zero if the socket will be flushed later as part of a
+     * frame.
+     */
+    int flush;
+
+} guac_common_cursor_broadcast;
+
+/**
+ * Copies the current cursor position and button state into the given
+ * broadcast snapshot, marking that state as broadcast. The cursor lock must
+ * be held when calling this function.
+ *
+ * @param cursor
+ *     The cursor whose state is being broadcast.
+ *
+ * @param broadcast
+ *     The broadcast snapshot to populate.
+ *
+ * @param now
+ *     The current server timestamp.
+ */
+static void guac_common_cursor_prepare_broadcast(guac_common_cursor* cursor,
+        guac_common_cursor_broadcast* broadcast, guac_timestamp now) {
+
+    broadcast->user = cursor->user;
+    broadcast->x = cursor->x;
+    broadcast->y = cursor->y;
+    broadcast->button_mask = cursor->button_mask;
+    broadcast->timestamp = cursor->timestamp;
+
+    cursor->broadcast_pending = 0;
+    cursor->last_broadcast = now;
+
+}
+
+/**
+ * Callback for guac_client_foreach_user() which sends the cursor position and
+ * button state within a broadcast snapshot to any given user except the user
+ * that moved the cursor last.
  *
  * @param data
- *     A pointer to the guac_common_cursor whose state should be broadcast to
- *     all users except the user that moved the cursor last.
+ *     A pointer to the guac_common_cursor_broadcast describing the cursor
+ *     state to send.
  *
  * @return
  *     Always NULL.
@@ -138,15 +260,71 @@ void guac_common_cursor_dup(guac_common_cursor* cursor, guac_user* user,
 static void* guac_common_cursor_broadcast_state(guac_user* user,
         void* data) {
 
-    guac_common_cursor* cursor = (guac_common_cursor*) data;
+    guac_common_cursor_broadcast* broadcast =
+        (guac_common_cursor_broadcast*) data;
 
     /* Send cursor state only if the user is not moving the cursor */
-    if (user != cursor->user) {
-        guac_protocol_send_mouse(user->socket, cursor->x, cursor->y,
-                cursor->button_mask, cursor->timestamp);
-        guac_socket_flush(user->socket);
+    if (user != broadcast->user) {
+        guac_protocol_send_mouse(user->socket, broadcast->x, broadcast->y,
+                broadcast->button_mask, broadcast->timestamp);
+        if (broadcast->flush)
+            guac_socket_flush(user->socket);
+    }
+
+    return NULL;
+
+}
+
+static void* guac_common_cursor_broadcast_thread(void* data) {
+
+    guac_common_cursor* cursor = (guac_common_cursor*) data;
+    guac_common_cursor_broadcast broadcast;
+
+    pthread_mutex_lock(&cursor->_lock);
+
+    while (!cursor->stopping) {
+
+        /* Wait for a broadcast to be deferred */
+        if (!cursor->broadcast_pending) {
+            pthread_cond_wait(&cursor->_broadcast_deferred, &cursor->_lock);
+            continue;
+        }
+
+        /* Wait for the end of the current broadcast interval, giving the
+         * next frame the chance to broadcast the pending state first */
+        guac_timestamp now = guac_timestamp_current();
+        guac_timestamp remaining = cursor->last_broadcast
+            + GUAC_COMMON_CURSOR_BROADCAST_INTERVAL - now;
+
+        if (remaining > 0) {
+
+            struct timespec timeout;
+            clock_gettime(CLOCK_REALTIME, &timeout);
+
+            timeout.tv_nsec += remaining * 1000000L;
+            if (timeout.tv_nsec >= 1000000000L) {
+                timeout.tv_sec += timeout.tv_nsec / 1000000000L;
+                timeout.tv_nsec %= 1000000000L;
+            }
+
+            pthread_cond_timedwait(&cursor->_broadcast_deferred,
+                    &cursor->_lock, &timeout);
+            continue;
+
+        }
+
+        /* No frame has broadcast the pending state in time */
+        guac_common_cursor_prepare_broadcast(cursor, &broadcast, now);
+        broadcast.flush = 1;
+
+        pthread_mutex_unlock(&cursor->_lock);
+        guac_client_foreach_user(cursor->client,
+                guac_common_cursor_broadcast_state, &broadcast);
+        pthread_mutex_lock(&cursor->_lock);
+
     }
 
+    pthread_mutex_unlock(&cursor->_lock);
     return NULL;
 
 }
@@ -154,6 +332,11 @@ static void* guac_common_cursor_broadcast_state(guac_user* user,
 void guac_common_cursor_update(guac_common_cursor* cursor, guac_user* user,
         int x, int y, int button_mask) {
 
+    guac_common_cursor_broadcast broadcast;
+    int broadcast_now = 0;
+
+    pthread_mutex_lock(&cursor->_lock);
+
     /* Update current user of cursor */
     cursor->user = user;
 
@@ -163,11 +346,54 @@ void guac_common_cursor_update(guac_common_cursor* cursor, guac_user* user,
     cursor->button_mask = button_mask;
 
     /* Store time at which cursor was updated */
-    cursor->timestamp = guac_timestamp_current();
+    guac_timestamp now = guac_timestamp_current();
+    cursor->timestamp = now;
+
+    /* Broadcast immediately only if the previous broadcast was long enough
+     * ago, otherwise leave the new state for the next frame */
+    cursor->broadcast_pending = 1;
+    if (now - cursor->last_broadcast >= GUAC_COMMON_CURSOR_BROADCAST_INTERVAL) {
+        guac_common_cursor_prepare_broadcast(cursor, &broadcast, now);
+        broadcast.flush = 1;
+        broadcast_now = 1;
+    }
+
+    /* Ensure deferred state is eventually broadcast even if no frame is
+     * flushed */
+    else
+        pthread_cond_signal(&cursor->_broadcast_deferred);
+
+    pthread_mutex_unlock(&cursor->_lock);
 
     /* Notify all other users of change in cursor state */
-    guac_client_foreach_user(cursor->client,
-            guac_common_cursor_broadcast_state, cursor);
+    if (broadcast_now)
+        guac_client_foreach_user(cursor->client,
+                guac_common_cursor_broadcast_state, &broadcast);
+
+}
+
+void guac_common_cursor_flush(guac_common_cursor* cursor) {
+
+    guac_common_cursor_broadcast broadcast;
+    int broadcast_now = 0;
+
+    pthread_mutex_lock(&cursor->_lock);
+
+    /* Take only the most recent state, if not yet broadcast */
+    if (cursor->broadcast_pending) {
+        guac_common_cursor_prepare_broadcast(cursor, &broadcast,
+                guac_timestamp_current());
+        broadcast.flush = 0;
+        broadcast_now = 1;
+    }
+
+    pthread_mutex_unlock(&cursor->_lock);
+
+    /* Notify all other users of change in cursor state, leaving the flush to
+     * the end of the frame */
+    if (broadcast_now)
+        guac_client_foreach_user(cursor->client,
+                guac_common_cursor_broadcast_state, &broadcast);
 
 }
 
@@ -299,8 +525,10 @@ void guac_common_cursor_remove_user(guac_common_cursor* cursor,
         guac_user* user) {
 
     /* Disassociate from given user */
+    pthread_mutex_lock(&cursor->_lock);
     if (cursor->user == user)
         cursor->user = NULL;
+    pthread_mutex_unlock(&cursor->_lock);
 
 }
 
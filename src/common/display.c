@@ -19,6 +19,8 @@
 
 #include "common/cursor.h"
 #include "common/display.h"
+#include "common/encoder.h"
+#include "common/image-cache.h"
 #include "common/surface.h"
 
 #include <guacamole/client.h>
@@ -135,9 +137,20 @@ guac_common_display* guac_common_display_alloc(guac_client* client,
     /* Associate display with given client */
     display->client = client;
 
+    /* Image caching is disabled unless configured by the protocol */
+    display->image_cache = guac_common_image_cache_alloc(client, 0);
+
+    display->encoder = guac_common_encoder_alloc(client,
+            client->encoder_threads);
+
     display->default_surface = guac_common_surface_alloc(client,
             client->socket, GUAC_DEFAULT_LAYER, width, height);
 
+    guac_common_surface_set_image_cache(display->default_surface,
+            display->image_cache);
+    guac_common_surface_set_encoder(display->default_surface,
+            display->encoder);
+
     /* No initial layers or buffers */
     display->layers = NULL;
     display->buffers = NULL;
@@ -158,6 +171,11 @@ void guac_common_display_free(guac_common_display* display) {
     guac_common_display_free_layers(display->buffers, display->client);
     guac_common_display_free_layers(display->layers, display->client);
 
+    /* Free image cache and encoder only after all surfaces using them are
+     * gone */
+    guac_common_image_cache_free(display->image_cache);
+    guac_common_encoder_free(display->encoder);
+
     pthread_mutex_destroy(&display->_lock);
     free(display);
 
@@ -171,6 +189,9 @@ void guac_common_display_dup(guac_common_display* display, guac_user* user,
     /* Sunchronize shared cursor */
     guac_common_cursor_dup(display->cursor, user, socket);
 
+    /* Synchronize cached image data */
+    guac_common_image_cache_dup(display->image_cache, user, socket);
+
     /* Synchronize default surface */
     guac_common_surface_dup(display->default_surface, user, socket);
 
@@ -206,6 +227,11 @@ void guac_common_display_set_lossless(guac_common_display* display,
 
 }
 
+void guac_common_display_set_image_cache_size(guac_common_display* display,
+        size_t size) {
+    guac_common_image_cache_set_size(display->image_cache, size);
+}
+
 void guac_common_display_flush(guac_common_display* display) {
 
     pthread_mutex_lock(&display->_lock);
@@ -222,6 +248,9 @@ void guac_common_display_flush(guac_common_display* display) {
 
     pthread_mutex_unlock(&display->_lock);
 
+    /* Broadcast any cursor movement not yet seen by other users */
+    guac_common_cursor_flush(display->cursor);
+
 }
 
 /**
@@ -314,6 +343,10 @@ guac_common_display_layer* guac_common_display_alloc_layer(
     /* Apply current display losslessness */
     guac_common_surface_set_lossless(surface, display->lossless);
 
+    /* Share display-wide image cache and encoder */
+    guac_common_surface_set_image_cache(surface, display->image_cache);
+    guac_common_surface_set_encoder(surface, display->encoder);
+
     /* Add layer and surface to list */
     guac_common_display_layer* display_layer =
         guac_common_display_add_layer(&display->layers, layer, surface);
@@ -338,6 +371,10 @@ guac_common_display_layer* guac_common_display_alloc_buffer(
     /* Apply current display losslessness */
     guac_common_surface_set_lossless(surface, display->lossless);
 
+    /* Share display-wide image cache and encoder */
+    guac_common_surface_set_image_cache(surface, display->image_cache);
+    guac_common_surface_set_encoder(surface, display->encoder);
+
     /* Add buffer and surface to list */
     guac_common_display_layer* display_layer =
         guac_common_display_add_layer(&display->buffers, buffer, surface);
@@ -0,0 +1,694 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+#include "common/encoder.h"
+#include "encode-jpeg.h"
+#include "encode-png.h"
+
+#ifdef ENABLE_WEBP
+#include "encode-webp.h"
+#endif
+
+#include <cairo/cairo.h>
+#include <guacamole/client.h>
+#include <guacamole/protocol.h>
+#include <guacamole/socket.h>
+#include <guacamole/stream.h>
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * A growable buffer of protocol data.
+ */
+typedef struct guac_common_encoder_buffer {
+
+    /**
+     * The data within the buffer, or NULL if no data has yet been written.
+     */
+    char* data;
+
+    /**
+     * The number of bytes of data within the buffer.
+     */
+    size_t length;
+
+    /**
+     * The number of bytes allocated for the buffer.
+     */
+    size_t size;
+
+} guac_common_encoder_buffer;
+
+struct guac_common_encoder_job {
+
+    /**
+     * The encoder which will encode this job.
+     */
+    guac_common_encoder* encoder;
+
+    /**
+     * The format to encode the image as.
+     */
+    guac_common_encoder_format format;
+
+    /**
+     * The composite mode to use when drawing the image.
+     */
+    guac_composite_mode mode;
+
+    /**
+     * The layer the image should be drawn to.
+     */
+    const guac_layer* layer;
+
+    /**
+     * The X coordinate of the upper-left corner of the destination rectangle.
+     */
+    int x;
+
+    /**
+     * The Y coordinate of the upper-left corner of the destination rectangle.
+     */
+    int y;
+
+    /**
+     * The image to encode.
+     */
+    cairo_surface_t* image;
+
+    /**
+     * The quality to use for lossy formats.
+     */
+    int quality;
+
+    /**
+     * Non-zero if WebP images should be encoded losslessly.
+     */
+    int lossless;
+
+    /**
+     * The filter restricting which users receive the encoded image, or NULL
+     * if all users should receive the image.
+     */
+    guac_user_filter* filter;
+
+    /**
+     * Arbitrary data to pass to the filter.
+     */
+    void* filter_data;
+
+    /**
+     * The stream over which the image will be sent. This stream is allocated
+     * when the job is submitted and freed only once the encoded image has
+     * been sent, such that it cannot be reused by other data in the meantime.
+     */
+    guac_stream* stream;
+
+    /**
+     * The encoded image, including its "img", "blob" and "end" instructions.
+     */
+    guac_common_encoder_buffer output;
+
+    /**
+     * Non-zero if encoding has completed.
+     */
+    int complete;
+
+    /**
+     * The next job awaiting encoding, or NULL if this is the newest job.
+     */
+    guac_common_encoder_job* next;
+
+};
+
+struct guac_common_encoder_entry {
+
+    /**
+     * All instructions written to the batch socket after the image of the
+     * previous entry was submitted but before the image of this entry.
+     */
+    guac_common_encoder_buffer literal;
+
+    /**
+     * The image of this entry, or NULL if no image has yet been submitted.
+     * Only the newest entry of a batch lacks an image.
+     */
+    guac_common_encoder_job* job;
+
+    /**
+     * The next newer entry of the batch, or NULL if this is the newest entry.
+     */
+    guac_common_encoder_entry* next;
+
+};
+
+/**
+ * Appends the given data to the given buffer, growing the buffer as needed.
+ *
+ * @param buffer
+ *     The buffer to append to.
+ *
+ * @param data
+ *     The data to append.
+ *
+ * @param length
+ *     The number of bytes of data to append.
+ */
+static void guac_common_encoder_buffer_append(
+        guac_common_encoder_buffer* buffer, const void* data, size_t length) {
+
+    /* Double buffer size until data fits */
+    if (buffer->length + length > buffer->size) {
+
+        size_t size = buffer->size ? buffer->size : 1024;
+        while (buffer->length + length > size)
+            size *= 2;
+
+        buffer->data = realloc(buffer->data, size);
+        buffer->size = size;
+
+    }
+
+    memcpy(buffer->data + buffer->length, data, length);
+    buffer->length += length;
+
+}
+
+/**
+ * Writes the contents of the given buffer to the given socket as a single
+ * unit, such that it is not interleaved with instructions written by other
+ * threads.
+ *
+ * @param socket
+ *     The socket to write to.
+ *
+ * @param buffer
+ *     The buffer whose contents should be written.
+ */
+static void guac_common_encoder_buffer_send(guac_socket* socket,
+        guac_common_encoder_buffer* buffer) {
+
+    if (buffer->length == 0)
+        return;
+
+    guac_socket_instruction_begin(socket);
+    guac_socket_write(socket, buffer->data, buffer->length);
+    guac_socket_instruction_end(socket);
+
+}
+
+/**
+ * Sends the encoded image of the given job to the given socket, restricting
+ * the users receiving that image according to the filter of the job.
+ *
+ * @param socket
+ *     The socket to send the encoded image to.
+ *
+ * @param job
+ *     The job whose encoded image should be sent.
+ */
+static void guac_common_encoder_send_output(guac_socket* socket,
+        guac_common_encoder_job* job) {
+
+    guac_socket_broadcast_set_filter(job->filter, job->filter_data);
+    guac_common_encoder_buffer_send(socket, &job->output);
+    guac_socket_broadcast_set_filter(NULL, NULL);
+
+}
+
+/**
+ * Write handler for sockets which append all data written to a
+ * guac_common_encoder_buffer, stored within the data member of the socket.
+ */
+static ssize_t guac_common_encoder_buffer_write_handler(guac_socket* socket,
+        const void* buf, size_t count) {
+
+    guac_common_encoder_buffer_append(
+            (guac_common_encoder_buffer*) socket->data, buf, count);
+
+    return count;
+
+}
+
+/**
+ * Write handler for batch sockets, which appends all data written to the
+ * newest entry of the batch stored within the data member of the socket.
+ */
+static ssize_t guac_common_encoder_batch_write_handler(guac_socket* socket,
+        const void* buf, size_t count) {
+
+    guac_common_encoder_batch* batch =
+        (guac_common_encoder_batch*) socket->data;
+
+    guac_common_encoder_buffer_append(&batch->tail->literal, buf, count);
+    return count;
+
+}
+
+/**
+ * Returns the current value of a monotonic clock, in microseconds.
+ *
+ * @return
+ *     The current value of a monotonic clock, in microseconds.
+ */
+static uint64_t guac_common_encoder_usec() {
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+
+}
+
+/**
+ * Allocates a socket which appends all data written to the output buffer of
+ * whichever job is being encoded. The same socket is reused for every job
+ * encoded by the same thread.
+ *
+ * @return
+ *     A newly-allocated socket, which must eventually be freed with
+ *     guac_socket_free().
+ */
+static guac_socket* guac_common_encoder_socket_alloc() {
+
+    guac_socket* socket = guac_socket_alloc();
+    socket->write_handler = guac_common_encoder_buffer_write_handler;
+
+    return socket;
+
+}
+
+/**
+ * Encodes the image of the given job, storing the resulting instructions
+ * within the output buffer of the job, and records the time taken within the
+ * statistics of the encoder. The image of the job is destroyed.
+ *
+ * @param job
+ *     The job to encode.
+ *
+ * @param socket
+ *     A socket allocated with guac_common_encoder_socket_alloc() which is
+ *     not currently in use by any other thread.
+ */
+static void guac_common_encoder_encode(guac_common_encoder_job* job,
+        guac_socket* socket) {
+
+    guac_common_encoder* encoder = job->encoder;
+    guac_client* client = encoder->client;
+
+    socket->data = &job->output;
+
+    uint64_t start = guac_common_encoder_usec();
+
+    switch (job->format) {
+
+        case GUAC_COMMON_ENCODER_JPEG:
+            guac_protocol_send_img(socket, job->stream, job->mode,
+                    job->layer, "image/jpeg", job->x, job->y);
+            guac_jpeg_write(socket, job->stream, job->image, job->quality);
+            break;
+
+#ifdef ENABLE_WEBP
+        case GUAC_COMMON_ENCODER_WEBP:
+            guac_protocol_send_img(socket, job->stream, job->mode,
+                    job->layer, "image/webp", job->x, job->y);
+            guac_webp_write(socket, job->stream, job->image, job->quality,
+                    job->lossless);
+            break;
+#endif
+
+        /* PNG, including WebP if WebP support is not built in */
+        default:
+            guac_protocol_send_img(socket, job->stream, job->mode,
+                    job->layer, "image/png", job->x, job->y);
+            guac_png_write(socket, job->stream, job->image,
+                    client->png_compression_level, client->png_strategy);
+            break;
+
+    }
+
+    guac_protocol_send_end(socket, job->stream);
+
+    uint64_t elapsed = guac_common_encoder_usec() - start;
+    socket->data = NULL;
+
+    pthread_mutex_lock(&encoder->_lock);
+
+    guac_common_encoder_stats* stats = &encoder->stats[job->format];
+    stats->images++;
+    stats->pixels += (uint64_t) cairo_image_surface_get_width(job->image)
+                   * cairo_image_surface_get_height(job->image);
+    stats->bytes += job->output.length;
+    stats->usec += elapsed;
+
+    pthread_mutex_unlock(&encoder->_lock);
+
+    cairo_surface_destroy(job->image);
+    job->image = NULL;
+
+}
+
+/**
+ * The main function of each thread within an encoder's pool, repeatedly
+ * encoding pending jobs until the encoder is stopped.
+ *
+ * @param data
+ *     The guac_common_encoder which owns the thread.
+ *
+ * @return
+ *     Always NULL.
+ */
+static void* guac_common_encoder_thread(void* data) {
+
+    guac_common_encoder* encoder = (guac_common_encoder*) data;
+    guac_socket* socket = guac_common_encoder_socket_alloc();
+
+    pthread_mutex_lock(&encoder->_lock);
+
+    for (;;) {
+
+        /* Wait for work */
+        while (encoder->pending_head == NULL && !encoder->stopping)
+            pthread_cond_wait(&encoder->_job_pending, &encoder->_lock);
+
+        guac_common_encoder_job* job = encoder->pending_head;
+        if (job == NULL)
+            break;
+
+        /* Take oldest job */
+        encoder->pending_head = job->next;
+        if (encoder->pending_head == NULL)
+            encoder->pending_tail = NULL;
+
+        pthread_mutex_unlock(&encoder->_lock);
+
+        /* Encode into memory, to be sent later in order */
+        guac_common_encoder_encode(job, socket);
+
+        pthread_mutex_lock(&encoder->_lock);
+
+        job->complete = 1;
+        pthread_cond_broadcast(&encoder->_job_complete);
+
+    }
+
+    pthread_mutex_unlock(&encoder->_lock);
+    guac_socket_free(socket);
+
+    return NULL;
+
+}
+
+guac_common_encoder* guac_common_encoder_alloc(guac_client* client,
+        int thread_count) {
+
+    int i;
+
+    guac_common_encoder* encoder = calloc(1, sizeof(guac_common_encoder));
+    encoder->client = client;
+    encoder->socket = guac_common_encoder_socket_alloc();
+
+    pthread_mutex_init(&encoder->_lock, NULL);
+    pthread_cond_init(&encoder->_job_pending, NULL);
+    pthread_cond_init(&encoder->_job_complete, NULL);
+
+    if (thread_count > 0)
+        encoder->threads = calloc(thread_count, sizeof(pthread_t));
+
+    /* Start as many threads as possible, falling back to serial encoding if
+     * none can be started */
+    for (i = 0; i < thread_count; i++) {
+
+        if (pthread_create(&encoder->threads[i], NULL,
+                    guac_common_encoder_thread, encoder)) {
+            guac_client_log(client, GUAC_LOG_WARNING, "Unable to start "
+                    "image encoding thread. Only %i of %i requested "
+                    "threads will be used.", i, thread_count);
+            break;
+        }
+
+        encoder->thread_count++;
+
+    }
+
+    if (encoder->thread_count > 0)
+        guac_client_log(client, GUAC_LOG_DEBUG, "Encoding images using %i "
+                "threads.", encoder->thread_count);
+
+    return encoder;
+
+}
+
+void guac_common_encoder_free(guac_common_encoder* encoder) {
+
+    int i;
+
+    /* Signal all threads to stop */
+    pthread_mutex_lock(&encoder->_lock);
+    encoder->stopping = 1;
+    pthread_cond_broadcast(&encoder->_job_pending);
+    pthread_mutex_unlock(&encoder->_lock);
+
+    for (i = 0; i < encoder->thread_count; i++)
+        pthread_join(encoder->threads[i], NULL);
+
+    guac_common_encoder_log_stats(encoder, GUAC_LOG_DEBUG);
+
+    pthread_cond_destroy(&encoder->_job_complete);
+    pthread_cond_destroy(&encoder->_job_pending);
+    pthread_mutex_destroy(&encoder->_lock);
+
+    guac_socket_free(encoder->socket);
+    free(encoder->threads);
+    free(encoder);
+
+}
+
+void guac_common_encoder_get_stats(guac_common_encoder* encoder,
+        guac_common_encoder_format format, guac_common_encoder_stats* stats) {
+
+    pthread_mutex_lock(&encoder->_lock);
+    *stats = encoder->stats[format];
+    pthread_mutex_unlock(&encoder->_lock);
+
+}
+
+void guac_common_encoder_log_stats(guac_common_encoder* encoder,
+        guac_client_log_level level) {
+
+    static const char* names[GUAC_COMMON_ENCODER_FORMATS] = {
+        [GUAC_COMMON_ENCODER_PNG]  = "PNG",
+        [GUAC_COMMON_ENCODER_JPEG] = "JPEG",
+        [GUAC_COMMON_ENCODER_WEBP] = "WebP"
+    };
+
+    int format;
+
+    for (format = 0; format < GUAC_COMMON_ENCODER_FORMATS; format++) {
+
+        guac_common_encoder_stats stats;
+        guac_common_encoder_get_stats(encoder, format, &stats);
+
+        /* Skip formats which were never used */
+        if (stats.images == 0)
+            continue;
+
+        guac_client_log(encoder->client, level, "%s: %" PRIu64 " images "
+                "(%" PRIu64 " pixels, %" PRIu64 " bytes) encoded in "
+                "%" PRIu64 " ms (average %" PRIu64 " us per image).",
+                names[format], stats.images, stats.pixels, stats.bytes,
+                stats.usec / 1000, stats.usec / stats.images);
+
+    }
+
+}
+
+/**
+ * Sends the oldest entry of the given batch to the destination socket of the
+ * batch, waiting for its image to finish encoding if necessary, and frees
+ * that entry. The batch must contain at least one entry having an image.
+ *
+ * @param batch
+ *     The batch whose oldest entry should be sent.
+ */
+static void guac_common_encoder_send_oldest(
+        guac_common_encoder_batch* batch) {
+
+    guac_common_encoder* encoder = batch->encoder;
+    guac_common_encoder_entry* entry = batch->head;
+    guac_common_encoder_job* job = entry->job;
+
+    /* Send instructions preceding the image */
+    guac_common_encoder_buffer_send(batch->destination, &entry->literal);
+
+    /* Wait for image to finish encoding */
+    pthread_mutex_lock(&encoder->_lock);
+    while (!job->complete)
+        pthread_cond_wait(&encoder->_job_complete, &encoder->_lock);
+    pthread_mutex_unlock(&encoder->_lock);
+
+    /* Send image, releasing its stream only once sent */
+    guac_common_encoder_send_output(batch->destination, job);
+    guac_client_free_stream(encoder->client, job->stream);
+
+    batch->head = entry->next;
+    batch->jobs--;
+
+    free(job->output.data);
+    free(job);
+    free(entry->literal.data);
+    free(entry);
+
+}
+
+guac_common_encoder_batch* guac_common_encoder_begin(
+        guac_common_encoder* encoder, guac_socket* socket) {
+
+    guac_common_encoder_batch* batch =
+        calloc(1, sizeof(guac_common_encoder_batch));
+
+    batch->encoder = encoder;
+    batch->destination = socket;
+
+    /* Without threads, everything can be written directly */
+    if (encoder->thread_count == 0) {
+        batch->socket = socket;
+        return batch;
+    }
+
+    /* Otherwise, collect instructions between images */
+    batch->head = batch->tail = calloc(1, sizeof(guac_common_encoder_entry));
+
+    batch->socket = guac_socket_alloc();
+    batch->socket->data = batch;
+    batch->socket->write_handler = guac_common_encoder_batch_write_handler;
+
+    return batch;
+
+}
+
+void guac_common_encoder_submit(guac_common_encoder_batch* batch,
+        guac_common_encoder_format format, guac_composite_mode mode,
+        const guac_layer* layer, int x, int y, cairo_surface_t* image,
+        int quality, int lossless, guac_user_filter* filter,
+        void* filter_data) {
+
+    guac_common_encoder* encoder = batch->encoder;
+
+    /* Limit the number of streams held by unsent images */
+    while (batch->jobs >= GUAC_COMMON_ENCODER_MAX_JOBS)
+        guac_common_encoder_send_oldest(batch);
+
+    guac_common_encoder_job* job = calloc(1, sizeof(guac_common_encoder_job));
+    job->encoder  = encoder;
+    job->format   = format;
+    job->mode     = mode;
+    job->layer    = layer;
+    job->x        = x;
+    job->y        = y;
+    job->image    = image;
+    job->quality  = quality;
+    job->lossless = lossless;
+    job->filter   = filter;
+    job->filter_data = filter_data;
+    job->stream   = guac_client_alloc_stream(encoder->client);
+
+    /* If no stream is available, send everything pending and fall back to
+     * serial encoding, which will not hold the stream beyond this call */
+    if (job->stream == NULL || encoder->thread_count == 0) {
+
+        while (batch->jobs > 0)
+            guac_common_encoder_send_oldest(batch);
+
+        if (batch->head != NULL) {
+            guac_common_encoder_buffer_send(batch->destination,
+                    &batch->head->literal);
+            batch->head->literal.length = 0;
+        }
+
+        /* Drop the image if there is truly no stream available */
+        if (job->stream != NULL) {
+            guac_common_encoder_encode(job, encoder->socket);
+            guac_common_encoder_send_output(batch->destination, job);
+            guac_client_free_stream(encoder->client, job->stream);
+            free(job->output.data);
+        }
+        else {
+            guac_client_log(encoder->client, GUAC_LOG_WARNING, "No stream "
+                    "available for image. Image will not be sent.");
+            cairo_surface_destroy(image);
+        }
+
+        free(job);
+        return;
+
+    }
+
+    /* Attach job to current entry, directing further instructions to a new
+     * entry */
+    guac_common_encoder_entry* entry = batch->tail;
+    entry->job = job;
+
+    batch->tail = entry->next = calloc(1, sizeof(guac_common_encoder_entry));
+    batch->jobs++;
+
+    /* Queue job for encoding */
+    pthread_mutex_lock(&encoder->_lock);
+
+    if (encoder->pending_tail != NULL)
+        encoder->pending_tail->next = job;
+    else
+        encoder->pending_head = job;
+
+    encoder->pending_tail = job;
+
+    pthread_cond_signal(&encoder->_job_pending);
+    pthread_mutex_unlock(&encoder->_lock);
+
+}
+
+void guac_common_encoder_end(guac_common_encoder_batch* batch) {
+
+    /* Nothing was deferred without threads */
+    if (batch->head == NULL) {
+        free(batch);
+        return;
+    }
+
+    /* Send all images in order */
+    while (batch->jobs > 0)
+        guac_common_encoder_send_oldest(batch);
+
+    /* Send any instructions following the last image */
+    guac_common_encoder_buffer_send(batch->destination, &batch->head->literal);
+
+    free(batch->head->literal.data);
+    free(batch->head);
+
+    guac_socket_free(batch->socket);
+    free(batch);
+
+}
+
@@ -0,0 +1,371 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+
+#include "common/image-cache.h"
+
+#include <cairo/cairo.h>
+#include <guacamole/client.h>
+#include <guacamole/hash.h>
+#include <guacamole/layer.h>
+#include <guacamole/protocol.h>
+#include <guacamole/socket.h>
+#include <guacamole/user.h>
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Returns the hash bucket which would contain images having the given hash.
+ *
+ * @param cache
+ *     The image cache containing the bucket.
+ *
+ * @param hash
+ *     The value of guac_hash_surface() for the image.
+ *
+ * @return
+ *     A pointer to the head of the bucket which would contain the image.
+ */
+static guac_common_image_cache_entry** guac_common_image_cache_bucket(
+        guac_common_image_cache* cache, unsigned int hash) {
+    return &cache->buckets[hash % GUAC_COMMON_IMAGE_CACHE_BUCKETS];
+}
+
+/**
+ * Removes the given entry from the least-recently-used list of the given
+ * cache. The entry remains within its hash bucket.
+ *
+ * @param cache
+ *     The image cache containing the entry.
+ *
+ * @param entry
+ *     The entry to remove from the least-recently-used list.
+ */
+static void guac_common_image_cache_unlink(guac_common_image_cache* cache,
+        guac_common_image_cache_entry* entry) {
+
+    if (entry->newer != NULL)
+        entry->newer->older = entry->older;
+    else
+        cache->newest = entry->older;
+
+    if (entry->older != NULL)
+        entry->older->newer = entry->newer;
+    else
+        cache->oldest = entry->newer;
+
+    entry->newer = NULL;
+    entry->older = NULL;
+
+}
+
+/**
+ * Inserts the given entry at the head of the least-recently-used list of the
+ * given cache, marking it as the most recently used entry.
+ *
+ * @param cache
+ *     The image cache to insert the entry into.
+ *
+ * @param entry
+ *     The entry to mark as most recently used. This entry must not currently
+ *     be within the least-recently-used list.
+ */
+static void guac_common_image_cache_touch(guac_common_image_cache* cache,
+        guac_common_image_cache_entry* entry) {
+
+    entry->newer = NULL;
+    entry->older = cache->newest;
+
+    if (cache->newest != NULL)
+        cache->newest->newer = entry;
+    else
+        cache->oldest = entry;
+
+    cache->newest = entry;
+
+}
+
+/**
+ * Removes the given entry from the given cache entirely, destroying its
+ * client-side buffer and freeing the entry and its image.
+ *
+ * @param cache
+ *     The image cache containing the entry.
+ *
+ * @param socket
+ *     The socket over which the client-side buffer should be disposed. This
+ *     must be the socket used for any instructions which may still refer to
+ *     that buffer, such that the buffer is not disposed before those
+ *     instructions are sent.
+ *
+ * @param entry
+ *     The entry to remove and free.
+ */
+static void guac_common_image_cache_remove(guac_common_image_cache* cache,
+        guac_socket* socket, guac_common_image_cache_entry* entry) {
+
+    /* Remove from hash bucket */
+    guac_common_image_cache_entry** current =
+        guac_common_image_cache_bucket(cache, entry->hash);
+
+    while (*current != NULL) {
+        if (*current == entry) {
+            *current = entry->next;
+            break;
+        }
+        current = &(*current)->next;
+    }
+
+    /* Remove from LRU list */
+    guac_common_image_cache_unlink(cache, entry);
+    cache->size -= entry->size;
+
+    /* Destroy buffer within remotely-connected client */
+    guac_protocol_send_dispose(socket, entry->buffer);
+    guac_client_free_buffer(cache->client, entry->buffer);
+
+    cairo_surface_destroy(entry->image);
+    free(entry);
+
+}
+
+/**
+ * Evicts least recently used entries from the given cache until the given
+ * number of additional bytes of image data would fit within the size limit
+ * of the cache.
+ *
+ * @param cache
+ *     The image cache to evict entries from.
+ *
+ * @param socket
+ *     The socket over which the client-side buffers of evicted entries should
+ *     be disposed.
+ *
+ * @param size
+ *     The number of bytes of image data which must fit.
+ */
+static void guac_common_image_cache_evict(guac_common_image_cache* cache,
+        guac_socket* socket, size_t size) {
+
+    while (cache->oldest != NULL && cache->size + size > cache->max_size)
+        guac_common_image_cache_remove(cache, socket, cache->oldest);
+
+}
+
+/**
+ * Returns the cached entry containing an image identical to the given image,
+ * if any.
+ *
+ * @param cache
+ *     The image cache to search.
+ *
+ * @param image
+ *     The image to search for.
+ *
+ * @param hash
+ *     The value of guac_hash_surface() for the given image.
+ *
+ * @return
+ *     The entry containing an identical image, or NULL if no such image is
+ *     cached.
+ */
+static guac_common_image_cache_entry* guac_common_image_cache_find(
+        guac_common_image_cache* cache, cairo_surface_t* image,
+        unsigned int hash) {
+
+    guac_common_image_cache_entry* current =
+        *guac_common_image_cache_bucket(cache, hash);
+
+    /* Hashes may collide, so verify image contents */
+    while (current != NULL) {
+        if (current->hash == hash
+                && guac_surface_cmp(current->image, image) == 0)
+            return current;
+        current = current->next;
+    }
+
+    return NULL;
+
+}
+
+guac_common_image_cache* guac_common_image_cache_alloc(guac_client* client,
+        size_t max_size) {
+
+    guac_common_image_cache* cache =
+        calloc(1, sizeof(guac_common_image_cache));
+
+    cache->client = client;
+    cache->max_size = max_size;
+
+    pthread_mutex_init(&cache->_lock, NULL);
+
+    return cache;
+
+}
+
+void guac_common_image_cache_free(guac_common_image_cache* cache) {
+
+    /* Remove all entries */
+    while (cache->oldest != NULL)
+        guac_common_image_cache_remove(cache, cache->client->socket,
+                cache->oldest);
+
+    pthread_mutex_destroy(&cache->_lock);
+    free(cache);
+
+}
+
+void guac_common_image_cache_set_size(guac_common_image_cache* cache,
+        size_t max_size) {
+
+    pthread_mutex_lock(&cache->_lock);
+
+    cache->max_size = max_size;
+    guac_common_image_cache_evict(cache, cache->client->socket, 0);
+
+    pthread_mutex_unlock(&cache->_lock);
+
+}
+
+int guac_common_image_cache_draw(guac_common_image_cache* cache,
+        guac_socket* socket, cairo_surface_t* image, unsigned int hash,
+        const guac_layer* layer, int x, int y) {
+
+    pthread_mutex_lock(&cache->_lock);
+
+    guac_common_image_cache_entry* entry =
+        guac_common_image_cache_find(cache, image, hash);
+
+    if (entry != NULL) {
+
+        /* Mark as most recently used */
+        if (cache->newest != entry) {
+            guac_common_image_cache_unlink(cache, entry);
+            guac_common_image_cache_touch(cache, entry);
+        }
+
+        /* Draw from client-side copy, replacing destination entirely. The
+         * copy is sent while the cache is locked such that the buffer cannot
+         * be concurrently evicted and reused. */
+        guac_protocol_send_copy(socket, entry->buffer, 0, 0,
+                cairo_image_surface_get_width(image),
+                cairo_image_surface_get_height(image),
+                GUAC_COMP_SRC, layer, x, y);
+
+    }
+
+    pthread_mutex_unlock(&cache->_lock);
+    return entry != NULL;
+
+}
+
+void guac_common_image_cache_add(guac_common_image_cache* cache,
+        guac_socket* socket, cairo_surface_t* image, unsigned int hash,
+        const guac_layer* layer, int x, int y) {
+
+    int width = cairo_image_surface_get_width(image);
+    int height = cairo_image_surface_get_height(image);
+    int src_stride = cairo_image_surface_get_stride(image);
+    unsigned char* src = cairo_image_surface_get_data(image);
+    size_t size = (size_t) width * height * 4;
+
+    int row;
+
+    pthread_mutex_lock(&cache->_lock);
+
+    /* Do not cache images which could never fit, nor duplicates */
+    if (size > cache->max_size
+            || guac_common_image_cache_find(cache, image, hash) != NULL) {
+        pthread_mutex_unlock(&cache->_lock);
+        return;
+    }
+
+    /* Copy only images which have been sent before */
+    unsigned int* seen = &cache->seen[hash % GUAC_COMMON_IMAGE_CACHE_SEEN];
+    if (*seen != hash + 1) {
+        *seen = hash + 1;
+        pthread_mutex_unlock(&cache->_lock);
+        return;
+    }
+
+    /* Make room for new image */
+    guac_common_image_cache_evict(cache, socket, size);
+
+    /* Create server-side copy of image */
+    cairo_surface_t* copy = cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
+            width, height);
+
+    int dst_stride = cairo_image_surface_get_stride(copy);
+    unsigned char* dst = cairo_image_surface_get_data(copy);
+
+    for (row = 0; row < height; row++) {
+        memcpy(dst, src, width * 4);
+        src += src_stride;
+        dst += dst_stride;
+    }
+
+    cairo_surface_mark_dirty(copy);
+
+    guac_common_image_cache_entry* entry =
+        malloc(sizeof(guac_common_image_cache_entry));
+
+    entry->hash = hash;
+    entry->image = copy;
+    entry->size = size;
+    entry->buffer = guac_client_alloc_buffer(cache->client);
+
+    /* Populate client-side copy from the image already drawn to the layer */
+    guac_protocol_send_copy(socket, layer, x, y, width, height,
+            GUAC_COMP_SRC, entry->buffer, 0, 0);
+
+    /* Add to hash bucket */
+    guac_common_image_cache_entry** bucket =
+        guac_common_image_cache_bucket(cache, hash);
+
+    entry->next = *bucket;
+    *bucket = entry;
+
+    /* Add as most recently used */
+    guac_common_image_cache_touch(cache, entry);
+    cache->size += size;
+
+    pthread_mutex_unlock(&cache->_lock);
+
+}
+
+void guac_common_image_cache_dup(guac_common_image_cache* cache,
+        guac_user* user, guac_socket* socket) {
+
+    pthread_mutex_lock(&cache->_lock);
+
+    /* Send each cached image to its buffer, oldest first */
+    guac_common_image_cache_entry* current = cache->oldest;
+    while (current != NULL) {
+        guac_user_stream_png(user, socket, GUAC_COMP_SRC, current->buffer,
+                0, 0, current->image);
+        current = current->newer;
+    }
+
+    pthread_mutex_unlock(&cache->_lock);
+
+}
+
@@ -0,0 +1,1455 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+#include "common/pixel.h"
+
+#include <guacamole/protocol-types.h>
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GUAC_COMMON_PIXEL_X86
+#include <immintrin.h>
+#endif
+
+/**
+ * The families of operations into which all guac_transfer_function values
+ * can be decomposed, where "t" is the source pixel XOR'd with a constant.
+ */
+typedef enum guac_common_pixel_transfer_family {
+
+    /**
+     * The result is (t & mask) | out.
+     */
+    GUAC_COMMON_PIXEL_TRANSFER_SET,
+
+    /**
+     * The result is (dst & (t | 0xFF000000)) ^ out.
+     */
+    GUAC_COMMON_PIXEL_TRANSFER_AND,
+
+    /**
+     * The result is (dst | (t & 0x00FFFFFF)) ^ out.
+     */
+    GUAC_COMMON_PIXEL_TRANSFER_OR,
+
+    /**
+     * The result is (dst ^ (t & mask)) ^ out.
+     */
+    GUAC_COMMON_PIXEL_TRANSFER_XOR
+
+} guac_common_pixel_transfer_family;
+
+/**
+ * The decomposition of a guac_transfer_function into a family of similar
+ * operations and the constants which select that function within its family,
+ * allowing vectorized kernels to implement all transfer functions with only
+ * a few loops.
+ */
+typedef struct guac_common_pixel_transfer_params {
+
+    /**
+     * The family of operations containing the transfer function.
+     */
+    guac_common_pixel_transfer_family family;
+
+    /**
+     * The value XOR'd with each source pixel to produce "t".
+     */
+    uint32_t src_xor;
+
+    /**
+     * The mask applied to "t", for those families which use a mask.
+     */
+    uint32_t mask;
+
+    /**
+     * The value combined with the result of the operation, as defined by the
+     * family.
+     */
+    uint32_t out;
+
+} guac_common_pixel_transfer_params;
+
+/**
+ * Decomposes the given transfer function into a family of operations and the
+ * constants selecting that function within its family.
+ *
+ * @param op
+ *     The transfer function to decompose.
+ *
+ * @param params
+ *     The guac_common_pixel_transfer_params to populate.
+ */
+static void guac_common_pixel_get_transfer_params(guac_transfer_function op,
+        guac_common_pixel_transfer_params* params) {
+
+    params->src_xor = 0;
+    params->mask = 0x00FFFFFF;
+    params->out = 0;
+
+    switch (op) {
+
+        case GUAC_TRANSFER_BINARY_BLACK:
+            params->family = GUAC_COMMON_PIXEL_TRANSFER_SET;
+            params->mask = 0;
+            params->out = 0xFF000000;
+            break;
+
+        case GUAC_TRANSFER_BINARY_WHITE:
+            params->family = GUAC_COMMON_PIXEL_TRANSFER_SET;
+            params->mask = 0;
+            params->out = 0xFFFFFFFF;
+            break;
+
+        case GUAC_TRANSFER_BINARY_SRC:
+            params->family = GUAC_COMMON_PIXEL_TRANSFER_SET;
+            params->mask = 0xFFFFFFFF;
+            break;
+
+        case GUAC_TRANSFER_BINARY_NSRC:
+            params->family = GUAC_COMMON_PIXEL_TRANSFER_SET;
+            params->src_xor = 0x00FFFFFF;
+            params->mask = 0xFFFFFFFF;
+            break;
+
+        case GUAC_TRANSFER_BINARY_NDEST:
+            params->family = GUAC_COMMON_PIXEL_TRANSFER_XOR;
+            params->mask = 0;
+            params->out = 0x00FFFFFF;
+            break;
+
+        case GUAC_TRANSFER_BINARY_AND:
+            params->family = GUAC_COMMON_PIXEL_TRANSFER_AND;
+            break;
+
+        case GUAC_TRANSFER_BINARY_NAND:
+            params->family = GUAC_COMMON_PIXEL_TRANSFER_AND;
+            params->out = 0x00FFFFFF;
+            break;
+
+        case GUAC_TRANSFER_BINARY_OR:
+            params->family = GUAC_COMMON_PIXEL_TRANSFER_OR;
+            break;
+
+        case GUAC_TRANSFER_BINARY_NOR:
+            params->family = GUAC_COMMON_PIXEL_TRANSFER_OR;
+            params->out = 0x00FFFFFF;
+            break;
+
+        case GUAC_TRANSFER_BINARY_XOR:
+            params->family = GUAC_COMMON_PIXEL_TRANSFER_XOR;
+            break;
+
+        case GUAC_TRANSFER_BINARY_XNOR:
+            params->family = GUAC_COMMON_PIXEL_TRANSFER_XOR;
+            params->out = 0x00FFFFFF;
+            break;
+
+        case GUAC_TRANSFER_BINARY_NSRC_AND:
+            params->family = GUAC_COMMON_PIXEL_TRANSFER_AND;
+            params->src_xor = 0x00FFFFFF;
+            break;
+
+        case GUAC_TRANSFER_BINARY_NSRC_NAND:
+            params->family = GUAC_COMMON_PIXEL_TRANSFER_AND;
+            params->src_xor = 0x00FFFFFF;
+            params->out = 0x00FFFFFF;
+            break;
+
+        case GUAC_TRANSFER_BINARY_NSRC_OR:
+            params->family = GUAC_COMMON_PIXEL_TRANSFER_OR;
+            params->src_xor = 0x00FFFFFF;
+            break;
+
+        case GUAC_TRANSFER_BINARY_NSRC_NOR:
+            params->family = GUAC_COMMON_PIXEL_TRANSFER_OR;
+            params->src_xor = 0x00FFFFFF;
+            params->out = 0x00FFFFFF;
+            break;
+
+        /* Leave destination untouched (GUAC_TRANSFER_BINARY_DEST) */
+        default:
+            params->family = GUAC_COMMON_PIXEL_TRANSFER_XOR;
+            params->mask = 0;
+            break;
+
+    }
+
+}
+
+/**
+ * Records the range of changed pixels within a row, merging that range with
+ * any range already recorded.
+ *
+ * @param range_first
+ *     The index of the first changed pixel within the range to record.
+ *
+ * @param range_last
+ *     The index of the last changed pixel within the range to record.
+ *
+ * @param first
+ *     Pointer to the index of the first changed pixel recorded thus far, or
+ *     to -1 if no changed pixels have been recorded.
+ *
+ * @param last
+ *     Pointer to the index of the last changed pixel recorded thus far, or
+ *     to -1 if no changed pixels have been recorded.
+ */
+static inline void guac_common_pixel_track(int range_first, int range_last,
+        int* first, int* last) {
+
+    if (*first < 0 || range_first < *first)
+        *first = range_first;
+
+    if (range_last > *last)
+        *last = range_last;
+
+}
+
+/**
+ * Stores the range of changed pixels recorded by a kernel in the output
+ * parameters of that kernel, if any pixels changed.
+ *
+ * @param changed_first
+ *     The index of the first changed pixel, or -1 if no pixels changed.
+ *
+ * @param changed_last
+ *     The index of the last changed pixel, or -1 if no pixels changed.
+ *
+ * @param first
+ *     The output parameter which should receive the index of the first
+ *     changed pixel.
+ *
+ * @param last
+ *     The output parameter which should receive the index of the last
+ *     changed pixel.
+ *
+ * @return
+ *     Non-zero if any pixels changed, zero otherwise.
+ */
+static inline int guac_common_pixel_report(int changed_first,
+        int changed_last, int* first, int* last) {
+
+    if (changed_first < 0)
+        return 0;
+
+    *first = changed_first;
+    *last = changed_last;
+    return 1;
+
+}
+
+/*
+ * Scalar implementation
+ */
+
+/**
+ * Applies the Porter-Duff "over" composite operator, blending the two given
+ * color components using the given alpha value.
+ *
+ * @param dst
+ *     The destination color component.
+ *
+ * @param src
+ *     The source color component.
+ *
+ * @param alpha
+ *     The alpha value which applies to the blending operation.
+ *
+ * @return
+ *     The result of applying the Porter-Duff "over" composite operator to the
+ *     given source and destination components.
+ */
+static int guac_common_pixel_blend_component(int dst, int src, int alpha) {
+
+    int blended = src + dst * (0xFF - alpha);
+
+    /* Do not exceed maximum component value */
+    if (blended > 0xFF)
+        return 0xFF;
+
+    return blended;
+
+}
+
+/**
+ * Applies the Porter-Duff "over" composite operator, blending each component
+ * of the two given ARGB colors.
+ *
+ * @param dst
+ *     The destination ARGB color.
+ *
+ * @param src
+ *     The source ARGB color.
+ *
+ * @return
+ *     The result of applying the Porter-Duff "over" composite operator to the
+ *     given source and destination colors.
+ */
+static uint32_t guac_common_pixel_argb_blend(uint32_t dst, uint32_t src) {
+
+    /* Separate destination ARGB color into its components */
+    int dst_a = (dst >> 24) & 0xFF;
+    int dst_r = (dst >> 16) & 0xFF;
+    int dst_g = (dst >>  8) & 0xFF;
+    int dst_b =  dst        & 0xFF;
+
+    /* Separate source ARGB color into its components */
+    int src_a = (src >> 24) & 0xFF;
+    int src_r = (src >> 16) & 0xFF;
+    int src_g = (src >>  8) & 0xFF;
+    int src_b =  src        & 0xFF;
+
+    /* If source is fully opaque (or destination is fully transparent), the
+     * blended result is the source */
+    if (src_a == 0xFF || dst_a == 0x00)
+        return src;
+
+    /* If source is fully transparent, the blended result is the destination */
+    if (src_a == 0x00)
+        return dst;
+
+    /* Otherwise, blend each ARGB component, assuming pre-multiplied alpha */
+    int r = guac_common_pixel_blend_component(dst_r, src_r, src_a);
+    int g = guac_common_pixel_blend_component(dst_g, src_g, src_a);
+    int b = guac_common_pixel_blend_component(dst_b, src_b, src_a);
+    int a = guac_common_pixel_blend_component(dst_a, src_a, src_a);
+
+    /* Recombine blended components */
+    return ((uint32_t) a << 24) | (r << 16) | (g << 8) | b;
+
+}
+
+/**
+ * Returns the result of applying the given transfer function to the given
+ * source and destination pixels.
+ *
+ * @param op
+ *     The transfer function to apply.
+ *
+ * @param src
+ *     The source pixel.
+ *
+ * @param dst
+ *     The destination pixel.
+ *
+ * @return
+ *     The new value of the destination pixel.
+ */
+static uint32_t guac_common_pixel_transfer_int(guac_transfer_function op,
+        uint32_t src, uint32_t dst) {
+
+    switch (op) {
+
+        case GUAC_TRANSFER_BINARY_BLACK:
+            return 0xFF000000;
+
+        case GUAC_TRANSFER_BINARY_WHITE:
+            return 0xFFFFFFFF;
+
+        case GUAC_TRANSFER_BINARY_SRC:
+            return src;
+
+        case GUAC_TRANSFER_BINARY_DEST:
+            return dst;
+
+        case GUAC_TRANSFER_BINARY_NSRC:
+            return src ^ 0x00FFFFFF;
+
+        case GUAC_TRANSFER_BINARY_NDEST:
+            return dst ^ 0x00FFFFFF;
+
+        case GUAC_TRANSFER_BINARY_AND:
+            return dst & (0xFF000000 | src);
+
+        case GUAC_TRANSFER_BINARY_NAND:
+            return (dst & (0xFF000000 | src)) ^ 0x00FFFFFF;
+
+        case GUAC_TRANSFER_BINARY_OR:
+            return dst | (0x00FFFFFF & src);
+
+        case GUAC_TRANSFER_BINARY_NOR:
+            return (dst | (0x00FFFFFF & src)) ^ 0x00FFFFFF;
+
+        case GUAC_TRANSFER_BINARY_XOR:
+            return dst ^ (0x00FFFFFF & src);
+
+        case GUAC_TRANSFER_BINARY_XNOR:
+            return (dst ^ (0x00FFFFFF & src)) ^ 0x00FFFFFF;
+
+        case GUAC_TRANSFER_BINARY_NSRC_AND:
+            return dst & (0xFF000000 | (src ^ 0x00FFFFFF));
+
+        case GUAC_TRANSFER_BINARY_NSRC_NAND:
+            return (dst & (0xFF000000 | (src ^ 0x00FFFFFF))) ^ 0x00FFFFFF;
+
+        case GUAC_TRANSFER_BINARY_NSRC_OR:
+            return dst | (0x00FFFFFF & (src ^ 0x00FFFFFF));
+
+        case GUAC_TRANSFER_BINARY_NSRC_NOR:
+            return (dst | (0x00FFFFFF & (src ^ 0x00FFFFFF))) ^ 0x00FFFFFF;
+
+    }
+
+    return dst;
+
+}
+
+static int guac_common_pixel_scalar_copy_opaque(uint32_t* dst,
+        const uint32_t* src, int width, uint32_t value, int* first,
+        int* last) {
+
+    int changed_first = -1;
+    int changed_last = -1;
+    int x;
+
+    for (x = 0; x < width; x++) {
+
+        uint32_t color = src[x] | 0xFF000000;
+
+        if (dst[x] != color) {
+            guac_common_pixel_track(x, x,
+                &changed_first, &changed_last);
+            dst[x] = color;
+        }
+
+    }
+
+    return guac_common_pixel_report(changed_first, changed_last, first, last);
+
+}
+
+static int guac_common_pixel_scalar_blend(uint32_t* dst, const uint32_t* src,
+        int width, uint32_t value, int* first, int* last) {
+
+    int changed_first = -1;
+    int changed_last = -1;
+    int x;
+
+    for (x = 0; x < width; x++) {
+
+        uint32_t color = guac_common_pixel_argb_blend(dst[x], src[x]);
+
+        if (dst[x] != color) {
+            guac_common_pixel_track(x, x,
+                &changed_first, &changed_last);
+            dst[x] = color;
+        }
+
+    }
+
+    return guac_common_pixel_report(changed_first, changed_last, first, last);
+
+}
+
+static int guac_common_pixel_scalar_set(uint32_t* dst, const uint32_t* src,
+        int width, uint32_t value, int* first, int* last) {
+
+    int changed_first = -1;
+    int changed_last = -1;
+    int x;
+
+    for (x = 0; x < width; x++) {
+
+        if (dst[x] != value) {
+            guac_common_pixel_track(x, x,
+                &changed_first, &changed_last);
+            dst[x] = value;
+        }
+
+    }
+
+    return guac_common_pixel_report(changed_first, changed_last, first, last);
+
+}
+
+static int guac_common_pixel_scalar_transfer(uint32_t* dst,
+        const uint32_t* src, int width, uint32_t value, int* first,
+        int* last) {
+
+    guac_transfer_function op = (guac_transfer_function) value;
+
+    int changed_first = -1;
+    int changed_last = -1;
+    int x;
+
+    for (x = 0; x < width; x++) {
+
+        uint32_t color = guac_common_pixel_transfer_int(op, src[x], dst[x]);
+
+        if (dst[x] != color) {
+            guac_common_pixel_track(x, x,
+                &changed_first, &changed_last);
+            dst[x] = color;
+        }
+
+    }
+
+    return guac_common_pixel_report(changed_first, changed_last, first, last);
+
+}
+
+static int guac_common_pixel_scalar_transfer_reverse(uint32_t* dst,
+        const uint32_t* src, int width, uint32_t value, int* first,
+        int* last) {
+
+    guac_transfer_function op = (guac_transfer_function) value;
+
+    int changed_first = -1;
+    int changed_last = -1;
+    int x;
+
+    for (x = width - 1; x >= 0; x--) {
+
+        uint32_t color = guac_common_pixel_transfer_int(op, src[x], dst[x]);
+
+        if (dst[x] != color) {
+            guac_common_pixel_track(x, x,
+                &changed_first, &changed_last);
+            dst[x] = color;
+        }
+
+    }
+
+    return guac_common_pixel_report(changed_first, changed_last, first, last);
+
+}
+
+static void guac_common_pixel_scalar_fill_mask(uint32_t* dst,
+        const uint32_t* mask, int width, uint32_t color) {
+
+    int x;
+
+    for (x = 0; x < width; x++) {
+
+        /* Fill with color if opaque */
+        if (mask[x] & 0xFF000000)
+            dst[x] = color;
+
+    }
+
+}
+
+static void guac_common_pixel_scalar_analyze(const uint32_t* row, int width,
+        int* same, uint32_t* alpha) {
+
+    int x;
+
+    if (width < 1)
+        return;
+
+    uint32_t combined = row[0];
+
+    for (x = 1; x < width; x++) {
+
+        if (((row[x] ^ row[x - 1]) & 0x00FFFFFF) == 0)
+            (*same)++;
+
+        combined &= row[x];
+
+    }
+
+    *alpha &= combined;
+
+}
+
+/**
+ * Pixel kernels which process one pixel at a time.
+ */
+static const guac_common_pixel_kernels guac_common_pixel_scalar = {
+    .isa              = GUAC_COMMON_PIXEL_SCALAR,
+    .name             = "scalar",
+    .copy_opaque      = guac_common_pixel_scalar_copy_opaque,
+    .blend            = guac_common_pixel_scalar_blend,
+    .set              = guac_common_pixel_scalar_set,
+    .transfer         = guac_common_pixel_scalar_transfer,
+    .transfer_reverse = guac_common_pixel_scalar_transfer_reverse,
+    .fill_mask        = guac_common_pixel_scalar_fill_mask,
+    .analyze          = guac_common_pixel_scalar_analyze
+};
+
+#ifdef GUAC_COMMON_PIXEL_X86
+
+/*
+ * SSE2 implementation
+ */
+
+#define GUAC_COMMON_PIXEL_SSE2_TARGET __attribute__((target("sse2")))
+
+/**
+ * Records the pixels that changed within a group of four, given the result
+ * of comparing the old and new values of those pixels.
+ *
+ * @param x
+ *     The index of the first pixel of the group.
+ *
+ * @param equal
+ *     The result of comparing the old and new values of each pixel with
+ *     _mm_cmpeq_epi32().
+ *
+ * @param first
+ *     Pointer to the index of the first changed pixel recorded thus far.
+ *
+ * @param last
+ *     Pointer to the index of the last changed pixel recorded thus far.
+ *
+ * @return
+ *     Non-zero if any pixel of the group changed, zero otherwise.
+ */
+GUAC_COMMON_PIXEL_SSE2_TARGET
+static inline int guac_common_pixel_sse2_track(int x, __m128i equal,
+        int* first, int* last) {
+
+    int changed = _mm_movemask_ps(_mm_castsi128_ps(equal)) ^ 0xF;
+    if (!changed)
+        return 0;
+
+    guac_common_pixel_track(x + __builtin_ctz(changed),
+            x + 31 - __builtin_clz(changed), first, last);
+
+    return 1;
+
+}
+
+/**
+ * Selects, for each 32-bit lane, the value of "a" where the corresponding
+ * lane of the mask is set, and the value of "b" otherwise.
+ */
+GUAC_COMMON_PIXEL_SSE2_TARGET
+static inline __m128i guac_common_pixel_sse2_select(__m128i mask, __m128i a,
+        __m128i b) {
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+/**
+ * Blends each component of two pairs of pixels, expanded to 16 bits per
+ * component, exactly as guac_common_pixel_blend_component() does.
+ */
+GUAC_COMMON_PIXEL_SSE2_TARGET
+static inline __m128i guac_common_pixel_sse2_blend_components(__m128i dst,
+        __m128i src) {
+
+    const __m128i max = _mm_set1_epi16(0xFF);
+
+    /* Copy alpha of each source pixel into all of its components */
+    __m128i alpha = _mm_shufflelo_epi16(src, _MM_SHUFFLE(3, 3, 3, 3));
+    alpha = _mm_shufflehi_epi16(alpha, _MM_SHUFFLE(3, 3, 3, 3));
+
+    /* src + dst * (0xFF - alpha), which cannot exceed 16 bits */
+    __m128i blended = _mm_add_epi16(src,
+            _mm_mullo_epi16(dst, _mm_sub_epi16(max, alpha)));
+
+    /* Clamp to 0xFF */
+    return _mm_sub_epi16(blended, _mm_subs_epu16(blended, max));
+
+}
+
+/**
+ * Applies the Porter-Duff "over" composite operator to four pixels, exactly
+ * as guac_common_pixel_argb_blend() does.
+ */
+GUAC_COMMON_PIXEL_SSE2_TARGET
+static inline __m128i guac_common_pixel_sse2_argb_blend(__m128i dst,
+        __m128i src) {
+
+    const __m128i zero = _mm_setzero_si128();
+
+    __m128i src_a = _mm_srli_epi32(src, 24);
+    __m128i dst_a = _mm_srli_epi32(dst, 24);
+
+    /* Blend all pixels */
+    __m128i blended = _mm_packus_epi16(
+        guac_common_pixel_sse2_blend_components(
+            _mm_unpacklo_epi8(dst, zero), _mm_unpacklo_epi8(src, zero)),
+        guac_common_pixel_sse2_blend_components(
+            _mm_unpackhi_epi8(dst, zero), _mm_unpackhi_epi8(src, zero)));
+
+    /* Destination is used as-is where source is fully transparent */
+    blended = guac_common_pixel_sse2_select(_mm_cmpeq_epi32(src_a, zero),
+            dst, blended);
+
+    /* Source is used as-is where opaque or destination fully transparent */
+    __m128i use_src = _mm_or_si128(
+            _mm_cmpeq_epi32(src_a, _mm_set1_epi32(0xFF)),
+            _mm_cmpeq_epi32(dst_a, zero));
+
+    return guac_common_pixel_sse2_select(use_src, src, blended);
+
+}
+
+/**
+ * Applies the transfer function described by the given parameters to four
+ * pixels, exactly as guac_common_pixel_transfer_int() does.
+ */
+GUAC_COMMON_PIXEL_SSE2_TARGET
+static inline __m128i guac_common_pixel_sse2_transfer_int(
+        const guac_common_pixel_transfer_params* params, __m128i src,
+        __m128i dst) {
+
+    __m128i t = _mm_xor_si128(src, _mm_set1_epi32(params->src_xor));
+    __m128i out = _mm_set1_epi32(params->out);
+
+    switch (params->family) {
+
+        case GUAC_COMMON_PIXEL_TRANSFER_SET:
+            return _mm_or_si128(_mm_and_si128(t,
+                        _mm_set1_epi32(params->mask)), out);
+
+        case GUAC_COMMON_PIXEL_TRANSFER_AND:
+            return _mm_xor_si128(_mm_and_si128(dst, _mm_or_si128(t,
+                            _mm_set1_epi32(0xFF000000))), out);
+
+        case GUAC_COMMON_PIXEL_TRANSFER_OR:
+            return _mm_xor_si128(_mm_or_si128(dst, _mm_and_si128(t,
+                            _mm_set1_epi32(0x00FFFFFF))), out);
+
+        default:
+            return _mm_xor_si128(_mm_xor_si128(dst, _mm_and_si128(t,
+                            _mm_set1_epi32(params->mask))), out);
+
+    }
+
+}
+
+GUAC_COMMON_PIXEL_SSE2_TARGET
+static int guac_common_pixel_sse2_copy_opaque(uint32_t* dst,
+        const uint32_t* src, int width, uint32_t value, int* first,
+        int* last) {
+
+    const __m128i opaque = _mm_set1_epi32(0xFF000000);
+
+    int changed_first = -1;
+    int changed_last = -1;
+    int tail_first = 0;
+    int tail_last = 0;
+    int x;
+
+    for (x = 0; x + 4 <= width; x += 4) {
+
+        __m128i color = _mm_or_si128(
+                _mm_loadu_si128((const __m128i*) (src + x)), opaque);
+        __m128i old = _mm_loadu_si128((const __m128i*) (dst + x));
+
+        if (guac_common_pixel_sse2_track(x, _mm_cmpeq_epi32(old, color),
+                    &changed_first, &changed_last))
+            _mm_storeu_si128((__m128i*) (dst + x), color);
+
+    }
+
+    /* Process any remaining pixels individually */
+    if (guac_common_pixel_scalar_copy_opaque(dst + x, src + x, width - x,
+                value, &tail_first, &tail_last))
+        guac_common_pixel_track(x + tail_first, x + tail_last,
+                &changed_first, &changed_last);
+
+    return guac_common_pixel_report(changed_first, changed_last, first, last);
+
+}
+
+GUAC_COMMON_PIXEL_SSE2_TARGET
+static int guac_common_pixel_sse2_blend(uint32_t* dst, const uint32_t* src,
+        int width, uint32_t value, int* first, int* last) {
+
+    int changed_first = -1;
+    int changed_last = -1;
+    int tail_first = 0;
+    int tail_last = 0;
+    int x;
+
+    for (x = 0; x + 4 <= width; x += 4) {
+
+        __m128i old = _mm_loadu_si128((const __m128i*) (dst + x));
+        __m128i color = guac_common_pixel_sse2_argb_blend(old,
+                _mm_loadu_si128((const __m128i*) (src + x)));
+
+        if (guac_common_pixel_sse2_track(x, _mm_cmpeq_epi32(old, color),
+                    &changed_first, &changed_last))
+            _mm_storeu_si128((__m128i*) (dst + x), color);
+
+    }
+
+    /* Process any remaining pixels individually */
+    if (guac_common_pixel_scalar_blend(dst + x, src + x, width - x,
+                value, &tail_first, &tail_last))
+        guac_common_pixel_track(x + tail_first, x + tail_last,
+                &changed_first, &changed_last);
+
+    return guac_common_pixel_report(changed_first, changed_last, first, last);
+
+}
+
+GUAC_COMMON_PIXEL_SSE2_TARGET
+static int guac_common_pixel_sse2_set(uint32_t* dst, const uint32_t* src,
+        int width, uint32_t value, int* first, int* last) {
+
+    const __m128i color = _mm_set1_epi32(value);
+
+    int changed_first = -1;
+    int changed_last = -1;
+    int tail_first = 0;
+    int tail_last = 0;
+    int x;
+
+    for (x = 0; x + 4 <= width; x += 4) {
+
+        __m128i old = _mm_loadu_si128((const __m128i*) (dst + x));
+
+        if (guac_common_pixel_sse2_track(x, _mm_cmpeq_epi32(old, color),
+                    &changed_first, &changed_last))
+            _mm_storeu_si128((__m128i*) (dst + x), color);
+
+    }
+
+    /* Process any remaining pixels individually */
+    if (guac_common_pixel_scalar_set(dst + x, NULL, width - x,
+                value, &tail_first, &tail_last))
+        guac_common_pixel_track(x + tail_first, x + tail_last,
+                &changed_first, &changed_last);
+
+    return guac_common_pixel_report(changed_first, changed_last, first, last);
+
+}
+
+GUAC_COMMON_PIXEL_SSE2_TARGET
+static int guac_common_pixel_sse2_transfer(uint32_t* dst,
+        const uint32_t* src, int width, uint32_t value, int* first,
+        int* last) {
+
+    guac_common_pixel_transfer_params params;
+    guac_common_pixel_get_transfer_params((guac_transfer_function) value,
+            &params);
+
+    int changed_first = -1;
+    int changed_last = -1;
+    int tail_first = 0;
+    int tail_last = 0;
+    int x;
+
+    for (x = 0; x + 4 <= width; x += 4) {
+
+        __m128i old = _mm_loadu_si128((const __m128i*) (dst + x));
+        __m128i color = guac_common_pixel_sse2_transfer_int(&params,
+                _mm_loadu_si128((const __m128i*) (src + x)), old);
+
+        if (guac_common_pixel_sse2_track(x, _mm_cmpeq_epi32(old, color),
+                    &changed_first, &changed_last))
+            _mm_storeu_si128((__m128i*) (dst + x), color);
+
+    }
+
+    /* Process any remaining pixels individually */
+    if (guac_common_pixel_scalar_transfer(dst + x, src + x, width - x,
+                value, &tail_first, &tail_last))
+        guac_common_pixel_track(x + tail_first, x + tail_last,
+                &changed_first, &changed_last);
+
+    return guac_common_pixel_report(changed_first, changed_last, first, last);
+
+}
+
+GUAC_COMMON_PIXEL_SSE2_TARGET
+static int guac_common_pixel_sse2_transfer_reverse(uint32_t* dst,
+        const uint32_t* src, int width, uint32_t value, int* first,
+        int* last) {
+
+    guac_common_pixel_transfer_params params;
+    guac_common_pixel_get_transfer_params((guac_transfer_function) value,
+            &params);
+
+    int changed_first = -1;
+    int changed_last = -1;
+    int head_first = 0;
+    int head_last = 0;
+    int x;
+
+    /* Process groups from last to first, leaving any partial group at the
+     * start of the row for last */
+    for (x = width - 4; x >= 0; x -= 4) {
+
+        __m128i old = _mm_loadu_si128((const __m128i*) (dst + x));
+        __m128i color = guac_common_pixel_sse2_transfer_int(&params,
+                _mm_loadu_si128((const __m128i*) (src + x)), old);
+
+        if (guac_common_pixel_sse2_track(x, _mm_cmpeq_epi32(old, color),
+                    &changed_first, &changed_last))
+            _mm_storeu_si128((__m128i*) (dst + x), color);
+
+    }
+
+    /* Process any remaining pixels individually */
+    if (guac_common_pixel_scalar_transfer_reverse(dst, src, x + 4,
+                value, &head_first, &head_last))
+        guac_common_pixel_track(head_first, head_last,
+                &changed_first, &changed_last);
+
+    return guac_common_pixel_report(changed_first, changed_last, first, last);
+
+}
+
+GUAC_COMMON_PIXEL_SSE2_TARGET
+static void guac_common_pixel_sse2_fill_mask(uint32_t* dst,
+        const uint32_t* mask, int width, uint32_t color) {
+
+    const __m128i alpha = _mm_set1_epi32(0xFF000000);
+    const __m128i fill = _mm_set1_epi32(color);
+    const __m128i zero = _mm_setzero_si128();
+
+    int x;
+
+    for (x = 0; x + 4 <= width; x += 4) {
+
+        /* Fill only where mask is not fully transparent */
+        __m128i transparent = _mm_cmpeq_epi32(_mm_and_si128(
+                    _mm_loadu_si128((const __m128i*) (mask + x)), alpha),
+                zero);
+
+        _mm_storeu_si128((__m128i*) (dst + x), guac_common_pixel_sse2_select(
+                transparent, _mm_loadu_si128((const __m128i*) (dst + x)),
+                fill));
+
+    }
+
+    guac_common_pixel_scalar_fill_mask(dst + x, mask + x, width - x, color);
+
+}
+
+GUAC_COMMON_PIXEL_SSE2_TARGET
+static void guac_common_pixel_sse2_analyze(const uint32_t* row, int width,
+        int* same, uint32_t* alpha) {
+
+    const __m128i color = _mm_set1_epi32(0x00FFFFFF);
+    const __m128i zero = _mm_setzero_si128();
+
+    __m128i combined = _mm_set1_epi32(0xFFFFFFFF);
+    uint32_t lanes[4];
+    int x;
+
+    if (width < 1)
+        return;
+
+    *alpha &= row[0];
+
+    /* Compare each pixel with the pixel before it */
+    for (x = 1; x + 4 <= width; x += 4) {
+
+        __m128i current = _mm_loadu_si128((const __m128i*) (row + x));
+        __m128i previous = _mm_loadu_si128((const __m128i*) (row + x - 1));
+
+        __m128i equal = _mm_cmpeq_epi32(_mm_and_si128(
+                    _mm_xor_si128(current, previous), color), zero);
+
+        *same += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(equal)));
+        combined = _mm_and_si128(combined, current);
+
+    }
+
+    _mm_storeu_si128((__m128i*) lanes, combined);
+    *alpha &= lanes[0] & lanes[1] & lanes[2] & lanes[3];
+
+    /* Analyze remaining pixels, including the last pixel compared above */
+    guac_common_pixel_scalar_analyze(row + x - 1, width - x + 1, same, alpha);
+
+}
+
+/**
+ * Pixel kernels which process four pixels at a time using SSE2.
+ */
+static const guac_common_pixel_kernels guac_common_pixel_sse2 = {
+    .isa              = GUAC_COMMON_PIXEL_SSE2,
+    .name             = "sse2",
+    .copy_opaque      = guac_common_pixel_sse2_copy_opaque,
+    .blend            = guac_common_pixel_sse2_blend,
+    .set              = guac_common_pixel_sse2_set,
+    .transfer         = guac_common_pixel_sse2_transfer,
+    .transfer_reverse = guac_common_pixel_sse2_transfer_reverse,
+    .fill_mask        = guac_common_pixel_sse2_fill_mask,
+    .analyze          = guac_common_pixel_sse2_analyze
+};
+
+/*
+ * AVX2 implementation
+ */
+
+#define GUAC_COMMON_PIXEL_AVX2_TARGET __attribute__((target("avx2")))
+
+/**
+ * Records the pixels that changed within a group of eight, given the result
+ * of comparing the old and new values of those pixels.
+ *
+ * @param x
+ *     The index of the first pixel of the group.
+ *
+ * @param equal
+ *     The result of comparing the old and new values of each pixel with
+ *     _mm256_cmpeq_epi32().
+ *
+ * @param first
+ *     Pointer to the index of the first changed pixel recorded thus far.
+ *
+ * @param last
+ *     Pointer to the index of the last changed pixel recorded thus far.
+ *
+ * @return
+ *     Non-zero if any pixel of the group changed, zero otherwise.
+ */
+GUAC_COMMON_PIXEL_AVX2_TARGET
+static inline int guac_common_pixel_avx2_track(int x, __m256i equal,
+        int* first, int* last) {
+
+    int changed = _mm256_movemask_ps(_mm256_castsi256_ps(equal)) ^ 0xFF;
+    if (!changed)
+        return 0;
+
+    guac_common_pixel_track(x + __builtin_ctz(changed),
+            x + 31 - __builtin_clz(changed), first, last);
+
+    return 1;
+
+}
+
+/**
+ * Selects, for each 32-bit lane, the value of "a" where the corresponding
+ * lane of the mask is set, and the value of "b" otherwise.
+ */
+GUAC_COMMON_PIXEL_AVX2_TARGET
+static inline __m256i guac_common_pixel_avx2_select(__m256i mask, __m256i a,
+        __m256i b) {
+    return _mm256_or_si256(_mm256_and_si256(mask, a),
+            _mm256_andnot_si256(mask, b));
+}
+
+/**
+ * Blends each component of four pairs of pixels, expanded to 16 bits per
+ * component, exactly as guac_common_pixel_blend_component() does.
+ */
+GUAC_COMMON_PIXEL_AVX2_TARGET
+static inline __m256i guac_common_pixel_avx2_blend_components(__m256i dst,
+        __m256i src) {
+
+    const __m256i max = _mm256_set1_epi16(0xFF);
+
+    /* Copy alpha of each source pixel into all of its components */
+    __m256i alpha = _mm256_shufflelo_epi16(src, _MM_SHUFFLE(3, 3, 3, 3));
+    alpha = _mm256_shufflehi_epi16(alpha, _MM_SHUFFLE(3, 3, 3, 3));
+
+    /* src + dst * (0xFF - alpha), which cannot exceed 16 bits */
+    __m256i blended = _mm256_add_epi16(src,
+            _mm256_mullo_epi16(dst, _mm256_sub_epi16(max, alpha)));
+
+    /* Clamp to 0xFF */
+    return _mm256_sub_epi16(blended, _mm256_subs_epu16(blended, max));
+
+}
+
+/**
+ * Applies the Porter-Duff "over" composite operator to eight pixels, exactly
+ * as guac_common_pixel_argb_blend() does.
+ */
+GUAC_COMMON_PIXEL_AVX2_TARGET
+static inline __m256i guac_common_pixel_avx2_argb_blend(__m256i dst,
+        __m256i src) {
+
+    const __m256i zero = _mm256_setzero_si256();
+
+    __m256i src_a = _mm256_srli_epi32(src, 24);
+    __m256i dst_a = _mm256_srli_epi32(dst, 24);
+
+    /* Blend all pixels */
+    __m256i blended = _mm256_packus_epi16(
+        guac_common_pixel_avx2_blend_components(
+            _mm256_unpacklo_epi8(dst, zero), _mm256_unpacklo_epi8(src, zero)),
+        guac_common_pixel_avx2_blend_components(
+            _mm256_unpackhi_epi8(dst, zero), _mm256_unpackhi_epi8(src, zero)));
+
+    /* Destination is used as-is where source is fully transparent */
+    blended = guac_common_pixel_avx2_select(_mm256_cmpeq_epi32(src_a, zero),
+            dst, blended);
+
+    /* Source is used as-is where opaque or destination fully transparent */
+    __m256i use_src = _mm256_or_si256(
+            _mm256_cmpeq_epi32(src_a, _mm256_set1_epi32(0xFF)),
+            _mm256_cmpeq_epi32(dst_a, zero));
+
+    return guac_common_pixel_avx2_select(use_src, src, blended);
+
+}
+
+/**
+ * Applies the transfer function described by the given parameters to eight
+ * pixels, exactly as guac_common_pixel_transfer_int() does.
+ */
+GUAC_COMMON_PIXEL_AVX2_TARGET
+static inline __m256i guac_common_pixel_avx2_transfer_int(
+        const guac_common_pixel_transfer_params* params, __m256i src,
+        __m256i dst) {
+
+    __m256i t = _mm256_xor_si256(src, _mm256_set1_epi32(params->src_xor));
+    __m256i out = _mm256_set1_epi32(params->out);
+
+    switch (params->family) {
+
+        case GUAC_COMMON_PIXEL_TRANSFER_SET:
+            return _mm256_or_si256(_mm256_and_si256(t,
+                        _mm256_set1_epi32(params->mask)), out);
+
+        case GUAC_COMMON_PIXEL_TRANSFER_AND:
+            return _mm256_xor_si256(_mm256_and_si256(dst, _mm256_or_si256(t,
+                            _mm256_set1_epi32(0xFF000000))), out);
+
+        case GUAC_COMMON_PIXEL_TRANSFER_OR:
+            return _mm256_xor_si256(_mm256_or_si256(dst, _mm256_and_si256(t,
+                            _mm256_set1_epi32(0x00FFFFFF))), out);
+
+        default:
+            return _mm256_xor_si256(_mm256_xor_si256(dst, _mm256_and_si256(t,
+                            _mm256_set1_epi32(params->mask))), out);
+
+    }
+
+}
+
+GUAC_COMMON_PIXEL_AVX2_TARGET
+static int guac_common_pixel_avx2_copy_opaque(uint32_t* dst,
+        const uint32_t* src, int width, uint32_t value, int* first,
+        int* last) {
+
+    const __m256i opaque = _mm256_set1_epi32(0xFF000000);
+
+    int changed_first = -1;
+    int changed_last = -1;
+    int tail_first = 0;
+    int tail_last = 0;
+    int x;
+
+    for (x = 0; x + 8 <= width; x += 8) {
+
+        __m256i color = _mm256_or_si256(
+                _mm256_loadu_si256((const __m256i*) (src + x)), opaque);
+        __m256i old = _mm256_loadu_si256((const __m256i*) (dst + x));
+
+        if (guac_common_pixel_avx2_track(x, _mm256_cmpeq_epi32(old, color),
+                    &changed_first, &changed_last))
+            _mm256_storeu_si256((__m256i*) (dst + x), color);
+
+    }
+
+    /* Process any remaining pixels individually */
+    if (guac_common_pixel_scalar_copy_opaque(dst + x, src + x, width - x,
+                value, &tail_first, &tail_last))
+        guac_common_pixel_track(x + tail_first, x + tail_last,
+                &changed_first, &changed_last);
+
+    return guac_common_pixel_report(changed_first, changed_last, first, last);
+
+}
+
+GUAC_COMMON_PIXEL_AVX2_TARGET
+static int guac_common_pixel_avx2_blend(uint32_t* dst, const uint32_t* src,
+        int width, uint32_t value, int* first, int* last) {
+
+    int changed_first = -1;
+    int changed_last = -1;
+    int tail_first = 0;
+    int tail_last = 0;
+    int x;
+
+    for (x = 0; x + 8 <= width; x += 8) {
+
+        __m256i old = _mm256_loadu_si256((const __m256i*) (dst + x));
+        __m256i color = guac_common_pixel_avx2_argb_blend(old,
+                _mm256_loadu_si256((const __m256i*) (src + x)));
+
+        if (guac_common_pixel_avx2_track(x, _mm256_cmpeq_epi32(old, color),
+                    &changed_first, &changed_last))
+            _mm256_storeu_si256((__m256i*) (dst + x), color);
+
+    }
+
+    /* Process any remaining pixels individually */
+    if (guac_common_pixel_scalar_blend(dst + x, src + x, width - x,
+                value, &tail_first, &tail_last))
+        guac_common_pixel_track(x + tail_first, x + tail_last,
+                &changed_first, &changed_last);
+
+    return guac_common_pixel_report(changed_first, changed_last, first, last);
+
+}
+
+GUAC_COMMON_PIXEL_AVX2_TARGET
+static int guac_common_pixel_avx2_set(uint32_t* dst, const uint32_t* src,
+        int width, uint32_t value, int* first, int* last) {
+
+    const __m256i color = _mm256_set1_epi32(value);
+
+    int changed_first = -1;
+    int changed_last = -1;
+    int tail_first = 0;
+    int tail_last = 0;
+    int x;
+
+    for (x = 0; x + 8 <= width; x += 8) {
+
+        __m256i old = _mm256_loadu_si256((const __m256i*) (dst + x));
+
+        if (guac_common_pixel_avx2_track(x, _mm256_cmpeq_epi32(old, color),
+                    &changed_first, &changed_last))
+            _mm256_storeu_si256((__m256i*) (dst + x), color);
+
+    }
+
+    /* Process any remaining pixels individually */
+    if (guac_common_pixel_scalar_set(dst + x, NULL, width - x,
+                value, &tail_first, &tail_last))
+        guac_common_pixel_track(x + tail_first, x + tail_last,
+                &changed_first, &changed_last);
+
+    return guac_common_pixel_report(changed_first, changed_last, first, last);
+
+}
+
+GUAC_COMMON_PIXEL_AVX2_TARGET
+static int guac_common_pixel_avx2_transfer(uint32_t* dst,
+        const uint32_t* src, int width, uint32_t value, int* first,
+        int* last) {
+
+    guac_common_pixel_transfer_params params;
+    guac_common_pixel_get_transfer_params((guac_transfer_function) value,
+            &params);
+
+    int changed_first = -1;
+    int changed_last = -1;
+    int tail_first = 0;
+    int tail_last = 0;
+    int x;
+
+    for (x = 0; x + 8 <= width; x += 8) {
+
+        __m256i old = _mm256_loadu_si256((const __m256i*) (dst + x));
+        __m256i color = guac_common_pixel_avx2_transfer_int(&params,
+                _mm256_loadu_si256((const __m256i*) (src + x)), old);
+
+        if (guac_common_pixel_avx2_track(x, _mm256_cmpeq_epi32(old, color),
+                    &changed_first, &changed_last))
+            _mm256_storeu_si256((__m256i*) (dst + x), color);
+
+    }
+
+    /* Process any remaining pixels individually */
+    if (guac_common_pixel_scalar_transfer(dst + x, src + x, width - x,
+                value, &tail_first, &tail_last))
+        guac_common_pixel_track(x + tail_first, x + tail_last,
+                &changed_first, &changed_last);
+
+    return guac_common_pixel_report(changed_first, changed_last, first, last);
+
+}
+
+GUAC_COMMON_PIXEL_AVX2_TARGET
+static int guac_common_pixel_avx2_transfer_reverse(uint32_t* dst,
+        const uint32_t* src, int width, uint32_t value, int* first,
+        int* last) {
+
+    guac_common_pixel_transfer_params params;
+    guac_common_pixel_get_transfer_params((guac_transfer_function) value,
+            &params);
+
+    int changed_first = -1;
+    int changed_last = -1;
+    int head_first = 0;
+    int head_last = 0;
+    int x;
+
+    /* Process groups from last to first, leaving any partial group at the
+     * start of the row for last */
+    for (x = width - 8; x >= 0; x -= 8) {
+
+        __m256i old = _mm256_loadu_si256((const __m256i*) (dst + x));
+        __m256i color = guac_common_pixel_avx2_transfer_int(&params,
+                _mm256_loadu_si256((const __m256i*) (src + x)), old);
+
+        if (guac_common_pixel_avx2_track(x, _mm256_cmpeq_epi32(old, color),
+                    &changed_first, &changed_last))
+            _mm256_storeu_si256((__m256i*) (dst + x), color);
+
+    }
+
+    /* Process any remaining pixels individually */
+    if (guac_common_pixel_scalar_transfer_reverse(dst, src, x + 8,
+                value, &head_first, &head_last))
+        guac_common_pixel_track(head_first, head_last,
+                &changed_first, &changed_last);
+
+    return guac_common_pixel_report(changed_first, changed_last, first, last);
+
+}
+
+GUAC_COMMON_PIXEL_AVX2_TARGET
+static void guac_common_pixel_avx2_fill_mask(uint32_t* dst,
+        const uint32_t* mask, int width, uint32_t color) {
+
+    const __m256i alpha = _mm256_set1_epi32(0xFF000000);
+    const __m256i fill = _mm256_set1_epi32(color);
+    const __m256i zero = _mm256_setzero_si256();
+
+    int x;
+
+    for (x = 0; x + 8 <= width; x += 8) {
+
+        /* Fill only where mask is not fully transparent */
+        __m256i transparent = _mm256_cmpeq_epi32(_mm256_and_si256(
+                    _mm256_loadu_si256((const __m256i*) (mask + x)), alpha),
+                zero);
+
+        _mm256_storeu_si256((__m256i*) (dst + x), guac_common_pixel_avx2_select(
+                transparent, _mm256_loadu_si256((const __m256i*) (dst + x)),
+                fill));
+
+    }
+
+    guac_common_pixel_scalar_fill_mask(dst + x, mask + x, width - x, color);
+
+}
+
+GUAC_COMMON_PIXEL_AVX2_TARGET
+static void guac_common_pixel_avx2_analyze(const uint32_t* row, int width,
+        int* same, uint32_t* alpha) {
+
+    const __m256i color = _mm256_set1_epi32(0x00FFFFFF);
+    const __m256i zero = _mm256_setzero_si256();
+
+    __m256i combined = _mm256_set1_epi32(0xFFFFFFFF);
+    uint32_t lanes[8];
+    int x;
+
+    if (width < 1)
+        return;
+
+    *alpha &= row[0];
+
+    /* Compare each pixel with the pixel before it */
+    for (x = 1; x + 8 <= width; x += 8) {
+
+        __m256i current = _mm256_loadu_si256((const __m256i*) (row + x));
+        __m256i previous = _mm256_loadu_si256((const __m256i*) (row + x - 1));
+
+        __m256i equal = _mm256_cmpeq_epi32(_mm256_and_si256(
+                    _mm256_xor_si256(current, previous), color), zero);
+
+        *same += __builtin_popcount(
+                _mm256_movemask_ps(_mm256_castsi256_ps(equal)));
+        combined = _mm256_and_si256(combined, current);
+
+    }
+
+    _mm256_storeu_si256((__m256i*) lanes, combined);
+    *alpha &= lanes[0] & lanes[1] & lanes[2] & lanes[3]
+        & lanes[4] & lanes[5] & lanes[6] & lanes[7];
+
+    /* Analyze remaining pixels, including the last pixel compared above */
+    guac_common_pixel_scalar_analyze(row + x - 1, width - x + 1, same, alpha);
+
+}
+
+/**
+ * Pixel kernels which process eight pixels at a time using AVX2.
+ */
+static const guac_common_pixel_kernels guac_common_pixel_avx2 = {
+    .isa              = GUAC_COMMON_PIXEL_AVX2,
+    .name             = "avx2",
+    .copy_opaque      = guac_common_pixel_avx2_copy_opaque,
+    .blend            = guac_common_pixel_avx2_blend,
+    .set              = guac_common_pixel_avx2_set,
+    .transfer         = guac_common_pixel_avx2_transfer,
+    .transfer_reverse = guac_common_pixel_avx2_transfer_reverse,
+    .fill_mask        = guac_common_pixel_avx2_fill_mask,
+    .analyze          = guac_common_pixel_avx2_analyze
+};
+
+#endif
+
+/**
+ * The fastest pixel kernels which can be used on the current processor.
+ */
+static const guac_common_pixel_kernels* guac_common_pixel_best;
+
+/**
+ * Guard ensuring guac_common_pixel_best is selected only once.
+ */
+static pthread_once_t guac_common_pixel_best_init = PTHREAD_ONCE_INIT;
+
+const guac_common_pixel_kernels* guac_common_pixel_get_kernels(
+        guac_common_pixel_isa isa) {
+
+#ifdef GUAC_COMMON_PIXEL_X86
+    __builtin_cpu_init();
+#endif
+
+    switch (isa) {
+
+        case GUAC_COMMON_PIXEL_SCALAR:
+            return &guac_common_pixel_scalar;
+
+#ifdef GUAC_COMMON_PIXEL_X86
+        case GUAC_COMMON_PIXEL_SSE2:
+            if (__builtin_cpu_supports("sse2"))
+                return &guac_common_pixel_sse2;
+            break;
+
+        case GUAC_COMMON_PIXEL_AVX2:
+            if (__builtin_cpu_supports("avx2"))
+                return &guac_common_pixel_avx2;
+            break;
+#endif
+
+        default:
+            break;
+
+    }
+
+    /* Kernels not supported by this build or processor */
+    return NULL;
+
+}
+
+/**
+ * Selects the fastest pixel kernels which can be used on the current
+ * processor, storing those kernels in guac_common_pixel_best.
+ */
+static void guac_common_pixel_select_best() {
+
+    int isa;
+
+    /* Later instruction sets are faster */
+    for (isa = GUAC_COMMON_PIXEL_ISA_COUNT - 1; isa >= 0; isa--) {
+        guac_common_pixel_best = guac_common_pixel_get_kernels(isa);
+        if (guac_common_pixel_best != NULL)
+            break;
+    }
+
+}
+
+const guac_common_pixel_kernels* guac_common_pixel_get_best_kernels() {
+    pthread_once(&guac_common_pixel_best_init, guac_common_pixel_select_best);
+    return guac_common_pixel_best;
+}
+
@@ -0,0 +1,621 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+#include "common/recording-compression.h"
+
+#include <guacamole/error.h>
+#include <guacamole/socket.h>
+
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef ENABLE_ZLIB
+#include <zlib.h>
+#endif
+
+/**
+ * The first two bytes of any gzip stream.
+ */
+static const unsigned char GUAC_COMMON_RECORDING_GZIP_MAGIC[] = { 0x1F, 0x8B };
+
+int guac_common_recording_parse_compression(const char* name,
+        guac_common_recording_compression* compression) {
+
+    if (name == NULL || strcmp(name, "") == 0 || strcmp(name, "none") == 0) {
+        *compression = GUAC_COMMON_RECORDING_COMPRESSION_NONE;
+        return 0;
+    }
+
+    if (strcmp(name, "gzip") == 0) {
+        *compression = GUAC_COMMON_RECORDING_COMPRESSION_GZIP;
+        return 0;
+    }
+
+    return 1;
+
+}
+
+int guac_common_recording_compression_supported(
+        guac_common_recording_compression compression) {
+
+#ifdef ENABLE_ZLIB
+    if (compression == GUAC_COMMON_RECORDING_COMPRESSION_GZIP)
+        return 1;
+#endif
+
+    return compression == GUAC_COMMON_RECORDING_COMPRESSION_NONE;
+
+}
+
+#ifdef ENABLE_ZLIB
+/**
+ * Writes the entirety of the given buffer to the given file descriptor,
+ * resuming after partial writes.
+ *
+ * @param fd
+ *     The file descriptor to write to.
+ *
+ * @param buffer
+ *     The data to write.
+ *
+ * @param length
+ *     The number of bytes of data to write.
+ *
+ * @return
+ *     Zero if all data was written, non-zero if an error occurred.
+ */
+static int guac_common_recording_write_all(int fd, const unsigned char* buffer,
+        size_t length) {
+
+    while (length > 0) {
+
+        ssize_t written = write(fd, buffer, length);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            return 1;
+        }
+
+        buffer += written;
+        length -= written;
+
+    }
+
+    return 0;
+
+}
+
+/**
+ * Returns the CPU time consumed by the current thread, in microseconds.
+ *
+ * @return
+ *     The CPU time consumed by the current thread, in microseconds.
+ */
+static uint64_t guac_common_recording_cpu_time() {
+
+    struct timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+
+    return (uint64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+
+}
+
+/**
+ * Runs the deflate algorithm of the given compressor over all input provided
+ * to its stream, writing all compressed output to the recording file.
+ *
+ * @param compressor
+ *     The compressor to run.
+ *
+ * @param flush
+ *     The zlib flush mode to use, such as Z_NO_FLUSH, Z_SYNC_FLUSH, or
+ *     Z_FINISH.
+ *
+ * @return
+ *     Zero if all input was compressed and written successfully, non-zero
+ *     otherwise.
+ */
+static int guac_common_recording_deflate(
+        guac_common_recording_compressor* compressor, int flush) {
+
+    z_stream* stream = (z_stream*) compressor->stream;
+
+    do {
+
+        stream->next_out = compressor->output;
+        stream->avail_out = GUAC_COMMON_RECORDING_COMPRESSION_CHUNK_SIZE;
+
+        uint64_t start = guac_common_recording_cpu_time();
+        int result = deflate(stream, flush);
+        compressor->cpu_time += guac_common_recording_cpu_time() - start;
+
+        if (result == Z_STREAM_ERROR) {
+            errno = EIO;
+            return 1;
+        }
+
+        size_t length = GUAC_COMMON_RECORDING_COMPRESSION_CHUNK_SIZE
+            - stream->avail_out;
+
+        if (guac_common_recording_write_all(compressor->fd,
+                    compressor->output, length))
+            return 1;
+
+        compressor->bytes_out += length;
+
+    } while (stream->avail_out == 0);
+
+    return 0;
+
+}
+#endif
+
+guac_common_recording_compressor* guac_common_recording_compressor_alloc(
+        guac_common_recording_compression compression, int fd) {
+
+#ifdef ENABLE_ZLIB
+    if (compression != GUAC_COMMON_RECORDING_COMPRESSION_GZIP)
+        return NULL;
+
+    guac_common_recording_compressor* compressor =
+        calloc(1, sizeof(guac_common_recording_compressor));
+    if (compressor == NULL)
+        return NULL;
+
+    z_stream* stream = calloc(1, sizeof(z_stream));
+    compressor->output = malloc(GUAC_COMMON_RECORDING_COMPRESSION_CHUNK_SIZE);
+
+    /* Add 16 to the window size to request gzip framing */
+    if (stream == NULL || compressor->output == NULL
+            || deflateInit2(stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        free(compressor->output);
+        free(stream);
+        free(compressor);
+        return NULL;
+    }
+
+    compressor->compression = compression;
+    compressor->fd = fd;
+    compressor->stream = stream;
+    return compressor;
+#else
+    return NULL;
+#endif
+
+}
+
+int guac_common_recording_compressor_write(
+        guac_common_recording_compressor* compressor,
+        const struct iovec* iov, int iovcnt) {
+
+#ifdef ENABLE_ZLIB
+    int i;
+    z_stream* stream = (z_stream*) compressor->stream;
+
+    for (i = 0; i < iovcnt; i++) {
+
+        stream->next_in = (Bytef*) iov[i].iov_base;
+        stream->avail_in = iov[i].iov_len;
+
+        if (guac_common_recording_deflate(compressor, Z_NO_FLUSH))
+            return 1;
+
+        compressor->bytes_in += iov[i].iov_len;
+
+    }
+
+    /* Allow everything written thus far to be decompressed */
+    return guac_common_recording_deflate(compressor, Z_SYNC_FLUSH);
+#else
+    errno = ENOSYS;
+    return 1;
+#endif
+
+}
+
+int guac_common_recording_compressor_finish(
+        guac_common_recording_compressor* compressor) {
+
+#ifdef ENABLE_ZLIB
+    return guac_common_recording_deflate(compressor, Z_FINISH);
+#else
+    errno = ENOSYS;
+    return 1;
+#endif
+
+}
+
+void guac_common_recording_compressor_free(
+        guac_common_recording_compressor* compressor) {
+
+#ifdef ENABLE_ZLIB
+    z_stream* stream = (z_stream*) compressor->stream;
+    deflateEnd(stream);
+    free(stream);
+#endif
+
+    free(compressor->output);
+    free(compressor);
+
+}
+
+/**
+ * Data specific to the guac_socket implementation which reads possibly-
+ * compressed recordings.
+ */
+typedef struct guac_common_recording_input {
+
+    /**
+     * The file descriptor of the recording.
+     */
+    int fd;
+
+    /**
+     * The manner in which the recording is compressed.
+     */
+    guac_common_recording_compression compression;
+
+    /**
+     * The decompression stream of the underlying compression library, if
+     * the recording is compressed.
+     */
+    void* stream;
+
+    /**
+     * Buffer containing data read from the recording file which has not yet
+     * been consumed. This buffer is
+     * GUAC_COMMON_RECORDING_COMPRESSION_CHUNK_SIZE bytes in size.
+     */
+    unsigned char* input;
+
+    /**
+     * The offset of the first unconsumed byte within the input buffer.
+     */
+    size_t input_offset;
+
+    /**
+     * The number of bytes of data within the input buffer.
+     */
+    size_t input_length;
+
+    /**
+     * Non-zero if the end of the recording file has been reached, zero
+     * otherwise.
+     */
+    int eof;
+
+} guac_common_recording_input;
+
+/**
+ * Refills the input buffer of the given recording input if all data within
+ * that buffer has been consumed.
+ *
+ * @param input
+ *     The recording input whose buffer should be refilled.
+ *
+ * @return
+ *     Zero if the buffer now contains data or the end of the recording file
+ *     has been reached, non-zero if an error occurred.
+ */
+static int guac_common_recording_input_fill(
+        guac_common_recording_input* input) {
+
+    if (input->input_offset < input->input_length || input->eof)
+        return 0;
+
+    ssize_t length;
+    do {
+        length = read(input->fd, input->input,
+                GUAC_COMMON_RECORDING_COMPRESSION_CHUNK_SIZE);
+    } while (length < 0 && errno == EINTR);
+
+    if (length < 0)
+        return 1;
+
+    input->input_offset = 0;
+    input->input_length = length;
+    input->eof = (length == 0);
+    return 0;
+
+}
+
+#ifdef ENABLE_ZLIB
+/**
+ * Reads and decompresses data from the given compressed recording input.
+ *
+ * @param input
+ *     The recording input to read from.
+ *
+ * @param buf
+ *     The buffer which should receive the decompressed data.
+ *
+ * @param count
+ *     The maximum number of bytes to store within the buffer.
+ *
+ * @return
+ *     The number of bytes of decompressed data stored within the buffer,
+ *     zero if the end of the recording has been reached, or a negative value
+ *     if an error occurs.
+ */
+static ssize_t guac_common_recording_input_inflate(
+        guac_common_recording_input* input, void* buf, size_t count) {
+
+    z_stream* stream = (z_stream*) input->stream;
+
+    for (;;) {
+
+        if (guac_common_recording_input_fill(input))
+            return -1;
+
+        stream->next_in = input->input + input->input_offset;
+        stream->avail_in = input->input_length - input->input_offset;
+        stream->next_out = buf;
+        stream->avail_out = count;
+
+        int result = inflate(stream, Z_NO_FLUSH);
+
+        input->input_offset = input->input_length - stream->avail_in;
+        size_t length = count - stream->avail_out;
+
+        /* Concatenated gzip streams are read as a single stream */
+        if (result == Z_STREAM_END)
+            inflateReset(stream);
+
+        else if (result != Z_OK && result != Z_BUF_ERROR) {
+            errno = EIO;
+            return -1;
+        }
+
+        if (length > 0)
+            return length;
+
+        /* A recording which is still being written may end without a
+         * complete gzip trailer */
+        if (input->eof)
+            return 0;
+
+    }
+
+}
+#endif
+
+/**
+ * Callback function which reads Guacamole protocol data from the recording
+ * associated with the given socket, decompressing that data as necessary.
+ *
+ * @param socket
+ *     The guac_socket being read from.
+ *
+ * @param buf
+ *     The buffer which should receive the data read.
+ *
+ * @param count
+ *     The maximum number of bytes to store within the buffer.
+ *
+ * @return
+ *     The number of bytes read, zero if the end of the recording has been
+ *     reached, or a negative value if an error occurs.
+ */
+static ssize_t guac_common_recording_input_read_handler(guac_socket* socket,
+        void* buf, size_t count) {
+
+    guac_common_recording_input* input =
+        (guac_common_recording_input*) socket->data;
+
+#ifdef ENABLE_ZLIB
+    if (input->compression == GUAC_COMMON_RECORDING_COMPRESSION_GZIP)
+        return guac_common_recording_input_inflate(input, buf, count);
+#endif
+
+    /* Consume any data read while detecting the compression format */
+    size_t buffered = input->input_length - input->input_offset;
+    if (buffered > 0) {
+
+        if (count > buffered)
+            count = buffered;
+
+        memcpy(buf, input->input + input->input_offset, count);
+        input->input_offset += count;
+        return count;
+
+    }
+
+    ssize_t length;
+    do {
+        length = read(input->fd, buf, count);
+    } while (length < 0 && errno == EINTR);
+
+    return length;
+
+}
+
+/**
+ * Frees the given recording input, without closing its file descriptor.
+ *
+ * @param input
+ *     The recording input to free.
+ */
+static void guac_common_recording_input_free(
+        guac_common_recording_input* input) {
+
+#ifdef ENABLE_ZLIB
+    if (input->stream != NULL) {
+        inflateEnd((z_stream*) input->stream);
+        free(input->stream);
+    }
+#endif
+
+    free(input->input);
+    free(input);
+
+}
+
+/**
+ * Callback function which frees all data associated with the given socket,
+ * closing the recording file.
+ *
+ * @param socket
+ *     The guac_socket being freed.
+ *
+ * @return
+ *     Always zero.
+ */
+static int guac_common_recording_input_free_handler(guac_socket* socket) {
+
+    guac_common_recording_input* input =
+        (guac_common_recording_input*) socket->data;
+
+    close(input->fd);
+    guac_common_recording_input_free(input);
+    return 0;
+
+}
+
+/**
+ * Discards the given number of bytes of Guacamole protocol data from the
+ * given recording input socket.
+ *
+ * @param socket
+ *     The recording input socket to read from.
+ *
+ * @param offset
+ *     The number of bytes to discard.
+ *
+ * @return
+ *     Zero if the requested number of bytes were discarded, non-zero if the
+ *     end of the recording was reached first or an error occurred.
+ */
+static int guac_common_recording_input_skip(guac_socket* socket,
+        int64_t offset) {
+
+    guac_common_recording_input* input =
+        (guac_common_recording_input*) socket->data;
+
+    /* Plain recordings can be skipped without being read */
+    if (input->compression == GUAC_COMMON_RECORDING_COMPRESSION_NONE
+            && lseek(input->fd, offset, SEEK_SET) != -1) {
+        input->input_offset = input->input_length = 0;
+        return 0;
+    }
+
+    char discarded[4096];
+    while (offset > 0) {
+
+        size_t count = sizeof(discarded);
+        if (offset < count)
+            count = offset;
+
+        ssize_t length = guac_common_recording_input_read_handler(socket,
+                discarded, count);
+        if (length <= 0)
+            return 1;
+
+        offset -= length;
+
+    }
+
+    return 0;
+
+}
+
+guac_socket* guac_common_recording_input_open(int fd, int64_t offset) {
+
+    guac_common_recording_input* input =
+        calloc(1, sizeof(guac_common_recording_input));
+    if (input == NULL) {
+        guac_error = GUAC_STATUS_NO_MEMORY;
+        guac_error_message = "Could not allocate recording input";
+        return NULL;
+    }
+
+    input->fd = fd;
+    input->input = malloc(GUAC_COMMON_RECORDING_COMPRESSION_CHUNK_SIZE);
+    if (input->input == NULL) {
+        guac_error = GUAC_STATUS_NO_MEMORY;
+        guac_error_message = "Could not allocate recording input";
+        free(input);
+        return NULL;
+    }
+
+    /* Detect compression format from the first bytes of the recording */
+    if (guac_common_recording_input_fill(input)) {
+        guac_error = GUAC_STATUS_SEE_ERRNO;
+        guac_error_message = "Error reading recording";
+        guac_common_recording_input_free(input);
+        return NULL;
+    }
+
+    if (input->input_length >= sizeof(GUAC_COMMON_RECORDING_GZIP_MAGIC)
+            && memcmp(input->input, GUAC_COMMON_RECORDING_GZIP_MAGIC,
+                sizeof(GUAC_COMMON_RECORDING_GZIP_MAGIC)) == 0) {
+
+#ifdef ENABLE_ZLIB
+        z_stream* stream = calloc(1, sizeof(z_stream));
+
+        /* Add 16 to the window size to accept only gzip framing */
+        if (stream == NULL || inflateInit2(stream, 15 + 16) != Z_OK) {
+            guac_error = GUAC_STATUS_NO_MEMORY;
+            guac_error_message = "Could not allocate decompression stream";
+            free(stream);
+            guac_common_recording_input_free(input);
+            return NULL;
+        }
+
+        input->compression = GUAC_COMMON_RECORDING_COMPRESSION_GZIP;
+        input->stream = stream;
+#else
+        guac_error = GUAC_STATUS_NOT_SUPPORTED;
+        guac_error_message = "Recording is compressed, but compression "
+            "support is not available";
+        guac_common_recording_input_free(input);
+        return NULL;
+#endif
+
+    }
+
+    guac_socket* socket = guac_socket_alloc();
+    if (socket == NULL) {
+        guac_common_recording_input_free(input);
+        return NULL;
+    }
+
+    socket->data = input;
+    socket->read_handler = guac_common_recording_input_read_handler;
+
+    /* Skip to requested offset, if any */
+    if (offset > 0 && guac_common_recording_input_skip(socket, offset)) {
+        guac_socket_free(socket);
+        guac_common_recording_input_free(input);
+        guac_error = GUAC_STATUS_INVALID_ARGUMENT;
+        guac_error_message = "Recording ends before requested offset";
+        return NULL;
+    }
+
+    socket->free_handler = guac_common_recording_input_free_handler;
+    return socket;
+
+}
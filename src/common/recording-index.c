@@ -0,0 +1,656 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+#include "common/recording-index.h"
+
+#include <guacamole/error.h>
+#include <guacamole/parser.h>
+#include <guacamole/socket.h>
+#include <guacamole/string.h>
+#include <guacamole/timestamp.h>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Writes a single instruction having only integer arguments to the given
+ * guac_socket.
+ *
+ * @param socket
+ *     The guac_socket to write the instruction to.
+ *
+ * @param opcode
+ *     The opcode of the instruction.
+ *
+ * @param argc
+ *     The number of arguments of the instruction.
+ *
+ * @param argv
+ *     The values of all arguments of the instruction.
+ */
+static void guac_common_recording_index_write(guac_socket* socket,
+        const char* opcode, int argc, const int64_t* argv) {
+
+    int i;
+    char value[32];
+
+    guac_socket_write_int(socket, strlen(opcode));
+    guac_socket_write_string(socket, ".");
+    guac_socket_write_string(socket, opcode);
+
+    /* Integer arguments consist only of single-byte characters */
+    for (i = 0; i < argc; i++) {
+        int length = snprintf(value, sizeof(value), "%" PRId64, argv[i]);
+        guac_socket_write_string(socket, ",");
+        guac_socket_write_int(socket, length);
+        guac_socket_write_string(socket, ".");
+        guac_socket_write_string(socket, value);
+    }
+
+    guac_socket_write_string(socket, ";");
+
+}
+
+/**
+ * Writes a checkpoint describing the current offset within the recording and
+ * the current state of all tracked layers, buffers, and streams.
+ *
+ * @param index
+ *     The recording index to write a checkpoint to.
+ *
+ * @param timestamp
+ *     The timestamp of the instruction most recently scanned.
+ */
+static void guac_common_recording_index_checkpoint(
+        guac_common_recording_index* index, guac_timestamp timestamp) {
+
+    int i;
+    int64_t args[5];
+    guac_socket* socket = index->socket;
+
+    args[0] = timestamp;
+    args[1] = index->instruction_offset;
+    guac_common_recording_index_write(socket, "checkpoint", 2, args);
+
+    /* Restore layer size, position, and opacity */
+    for (i = 0; i < GUAC_COMMON_RECORDING_INDEX_MAX_LAYERS; i++) {
+
+        guac_common_recording_index_layer* layer = &index->layers[i];
+        if (!layer->exists)
+            continue;
+
+        args[0] = i;
+        args[1] = layer->width;
+        args[2] = layer->height;
+        guac_common_recording_index_write(socket, "size", 3, args);
+
+        /* The default layer cannot be moved */
+        if (i != 0) {
+            args[1] = layer->parent;
+            args[2] = layer->x;
+            args[3] = layer->y;
+            args[4] = layer->z;
+            guac_common_recording_index_write(socket, "move", 5, args);
+        }
+
+        if (layer->opacity != 255) {
+            args[1] = layer->opacity;
+            guac_common_recording_index_write(socket, "shade", 2, args);
+        }
+
+    }
+
+    /* Restore buffer size */
+    for (i = 0; i < GUAC_COMMON_RECORDING_INDEX_MAX_BUFFERS; i++) {
+
+        guac_common_recording_index_buffer* buffer = &index->buffers[i];
+        if (!buffer->exists)
+            continue;
+
+        args[0] = -1 - i;
+        args[1] = buffer->width;
+        args[2] = buffer->height;
+        guac_common_recording_index_write(socket, "size", 3, args);
+
+    }
+
+    /* List streams which are still open */
+    for (i = 0; i < GUAC_COMMON_RECORDING_INDEX_MAX_STREAMS; i++) {
+        if (index->streams[i]) {
+            args[0] = i;
+            guac_common_recording_index_write(socket, "stream", 1, args);
+        }
+    }
+
+    /* Make checkpoint available to readers of in-progress recordings */
+    guac_socket_flush(socket);
+
+    index->checkpointed = 1;
+    index->last_checkpoint = timestamp;
+
+}
+
+/**
+ * Returns the tracked state of the layer having the given index, marking the
+ * layer as existing with default properties if it did not already exist.
+ *
+ * @param index
+ *     The recording index tracking the layer.
+ *
+ * @param layer_index
+ *     The index of the layer.
+ *
+ * @return
+ *     The tracked state of the layer, or NULL if the layer is not tracked.
+ */
+static guac_common_recording_index_layer* guac_common_recording_index_get_layer(
+        guac_common_recording_index* index, int layer_index) {
+
+    if (layer_index < 0 || layer_index >= GUAC_COMMON_RECORDING_INDEX_MAX_LAYERS)
+        return NULL;
+
+    guac_common_recording_index_layer* layer = &index->layers[layer_index];
+
+    /* New layers are fully opaque children of the default layer */
+    if (!layer->exists) {
+        layer->exists = 1;
+        layer->width = 0;
+        layer->height = 0;
+        layer->parent = 0;
+        layer->x = 0;
+        layer->y = 0;
+        layer->z = 0;
+        layer->opacity = 255;
+    }
+
+    return layer;
+
+}
+
+/**
+ * Returns the tracked state of the buffer having the given index, which must
+ * be negative, marking the buffer as existing if it did not already exist.
+ *
+ * @param index
+ *     The recording index tracking the buffer.
+ *
+ * @param buffer_index
+ *     The index of the buffer.
+ *
+ * @return
+ *     The tracked state of the buffer, or NULL if the buffer is not tracked.
+ */
+static guac_common_recording_index_buffer* guac_common_recording_index_get_buffer(
+        guac_common_recording_index* index, int buffer_index) {
+
+    int i = -1 - buffer_index;
+    if (i < 0 || i >= GUAC_COMMON_RECORDING_INDEX_MAX_BUFFERS)
+        return NULL;
+
+    guac_common_recording_index_buffer* buffer = &index->buffers[i];
+    buffer->exists = 1;
+    return buffer;
+
+}
+
+/**
+ * Marks the stream having the given index as open or closed.
+ *
+ * @param index
+ *     The recording index tracking the stream.
+ *
+ * @param stream_index
+ *     The index of the stream, as a string.
+ *
+ * @param open
+ *     Non-zero if the stream has been opened, zero if it has been closed.
+ */
+static void guac_common_recording_index_set_stream(
+        guac_common_recording_index* index, const char* stream_index,
+        int open) {
+
+    int i = atoi(stream_index);
+    if (i >= 0 && i < GUAC_COMMON_RECORDING_INDEX_MAX_STREAMS)
+        index->streams[i] = open;
+
+}
+
+/**
+ * Updates the tracked state using the instruction which has just been
+ * completely scanned, writing a checkpoint if the instruction is
+ * timestamped and sufficient time has passed since the last checkpoint.
+ *
+ * @param index
+ *     The recording index whose current instruction is complete.
+ *
+ * @param count
+ *     The total number of elements within the instruction, including the
+ *     opcode.
+ */
+static void guac_common_recording_index_handle(
+        guac_common_recording_index* index, int count) {
+
+    int i;
+    char* argv[GUAC_COMMON_RECORDING_INDEX_MAX_ELEMENTS - 1];
+
+    /* Only the leading elements of each instruction are retained */
+    if (count > GUAC_COMMON_RECORDING_INDEX_MAX_ELEMENTS)
+        count = GUAC_COMMON_RECORDING_INDEX_MAX_ELEMENTS;
+
+    const char* opcode = index->elements[0];
+    int argc = count - 1;
+    for (i = 0; i < argc; i++)
+        argv[i] = index->elements[i + 1];
+
+    /* Layers and buffers are resized with "size" */
+    if (strcmp(opcode, "size") == 0 && argc >= 3) {
+
+        int layer_index = atoi(argv[0]);
+
+        if (layer_index >= 0) {
+            guac_common_recording_index_layer* layer =
+                guac_common_recording_index_get_layer(index, layer_index);
+            if (layer != NULL) {
+                layer->width = atoi(argv[1]);
+                layer->height = atoi(argv[2]);
+            }
+        }
+
+        else {
+            guac_common_recording_index_buffer* buffer =
+                guac_common_recording_index_get_buffer(index, layer_index);
+            if (buffer != NULL) {
+                buffer->width = atoi(argv[1]);
+                buffer->height = atoi(argv[2]);
+            }
+        }
+
+    }
+
+    /* Layers are repositioned and restacked with "move" */
+    else if (strcmp(opcode, "move") == 0 && argc >= 5) {
+        guac_common_recording_index_layer* layer =
+            guac_common_recording_index_get_layer(index, atoi(argv[0]));
+        if (layer != NULL) {
+            layer->parent = atoi(argv[1]);
+            layer->x = atoi(argv[2]);
+            layer->y = atoi(argv[3]);
+            layer->z = atoi(argv[4]);
+        }
+    }
+
+    /* Layer opacity is changed with "shade" */
+    else if (strcmp(opcode, "shade") == 0 && argc >= 2) {
+        guac_common_recording_index_layer* layer =
+            guac_common_recording_index_get_layer(index, atoi(argv[0]));
+        if (layer != NULL)
+            layer->opacity = atoi(argv[1]);
+    }
+
+    /* Layers and buffers are destroyed with "dispose" */
+    else if (strcmp(opcode, "dispose") == 0 && argc >= 1) {
+
+        int layer_index = atoi(argv[0]);
+
+        if (layer_index >= 0
+                && layer_index < GUAC_COMMON_RECORDING_INDEX_MAX_LAYERS)
+            index->layers[layer_index].exists = 0;
+
+        else if (layer_index < 0
+                && -1 - layer_index < GUAC_COMMON_RECORDING_INDEX_MAX_BUFFERS)
+            index->buffers[-1 - layer_index].exists = 0;
+
+    }
+
+    /* Streams are opened by instructions whose first argument is the stream
+     * index ... */
+    else if ((strcmp(opcode, "img") == 0
+                || strcmp(opcode, "audio") == 0
+                || strcmp(opcode, "video") == 0
+                || strcmp(opcode, "file") == 0
+                || strcmp(opcode, "pipe") == 0
+                || strcmp(opcode, "clipboard") == 0
+                || strcmp(opcode, "argv") == 0) && argc >= 1)
+        guac_common_recording_index_set_stream(index, argv[0], 1);
+
+    /* ... with the exception of "body", whose first argument is the object
+     * index */
+    else if (strcmp(opcode, "body") == 0 && argc >= 2)
+        guac_common_recording_index_set_stream(index, argv[1], 1);
+
+    /* Streams are closed with "end" */
+    else if (strcmp(opcode, "end") == 0 && argc >= 1)
+        guac_common_recording_index_set_stream(index, argv[0], 0);
+
+    /* Write checkpoint if enough time has elapsed since the last */
+    guac_timestamp timestamp;
+    if (guac_common_recording_get_timestamp(opcode, argc, argv, &timestamp)
+            && (!index->checkpointed || timestamp - index->last_checkpoint
+                >= GUAC_COMMON_RECORDING_INDEX_INTERVAL))
+        guac_common_recording_index_checkpoint(index, timestamp);
+
+}
+
+guac_common_recording_index* guac_common_recording_index_alloc(int fd) {
+
+    guac_common_recording_index* index =
+        calloc(1, sizeof(guac_common_recording_index));
+    if (index == NULL)
+        return NULL;
+
+    index->socket = guac_socket_open(fd);
+    if (index->socket == NULL) {
+        free(index);
+        return NULL;
+    }
+
+    index->in_length = 1;
+    return index;
+
+}
+
+void guac_common_recording_index_free(guac_common_recording_index* index) {
+    guac_socket_flush(index->socket);
+    guac_socket_free(index->socket);
+    free(index);
+}
+
+void guac_common_recording_index_update(guac_common_recording_index* index,
+        const void* buf, size_t length) {
+
+    const unsigned char* current = (const unsigned char*) buf;
+
+    for (; length > 0; length--) {
+
+        unsigned char c = *(current++);
+        index->offset++;
+
+        /* Stop tracking state entirely if the recording is not understood */
+        if (index->failed)
+            continue;
+
+        /* Parse decimal length of element, which precedes a period */
+        if (index->in_length) {
+
+            if (c >= '0' && c <= '9' && index->digits < 9) {
+                index->length = index->length * 10 + c - '0';
+                index->digits++;
+            }
+
+            else if (c == '.' && index->digits > 0) {
+                index->in_length = 0;
+                index->element_length = 0;
+            }
+
+            else
+                index->failed = 1;
+
+            continue;
+
+        }
+
+        /* Element lengths are in characters, and continuation bytes of
+         * multibyte characters are never the first byte of a character */
+        int continuation = (c & 0xC0) == 0x80;
+        if (continuation || index->length > 0) {
+
+            if (!continuation)
+                index->length--;
+
+            /* Retain only the leading bytes of the leading elements */
+            if (index->element < GUAC_COMMON_RECORDING_INDEX_MAX_ELEMENTS
+                    && index->element_length
+                        < GUAC_COMMON_RECORDING_INDEX_MAX_ELEMENT_LENGTH - 1)
+                index->elements[index->element][index->element_length++] = c;
+
+            continue;
+
+        }
+
+        /* The element is complete, and this is its terminator */
+        if (index->element < GUAC_COMMON_RECORDING_INDEX_MAX_ELEMENTS)
+            index->elements[index->element][index->element_length] = '\0';
+
+        /* Additional elements follow commas */
+        if (c == ',')
+            index->element++;
+
+        /* Instructions end with semicolons */
+        else if (c == ';') {
+            guac_common_recording_index_handle(index, index->element + 1);
+            index->instruction_offset = index->offset;
+            index->element = 0;
+        }
+
+        else {
+            index->failed = 1;
+            continue;
+        }
+
+        index->in_length = 1;
+        index->length = 0;
+        index->digits = 0;
+
+    }
+
+}
+
+/**
+ * Appends a copy of the given instruction to the state of the given
+ * checkpoint.
+ *
+ * @param checkpoint
+ *     The checkpoint to append the instruction to.
+ *
+ * @param parser
+ *     The guac_parser containing the instruction most recently read.
+ */
+static void guac_common_recording_checkpoint_append(
+        guac_common_recording_checkpoint* checkpoint, guac_parser* parser) {
+
+    int i;
+
+    guac_common_recording_index_instruction* state = realloc(
+            checkpoint->state, sizeof(guac_common_recording_index_instruction)
+            * (checkpoint->length + 1));
+    if (state == NULL)
+        return;
+
+    checkpoint->state = state;
+
+    guac_common_recording_index_instruction* instruction =
+        &state[checkpoint->length++];
+
+    instruction->opcode = guac_strdup(parser->opcode);
+    instruction->argc = parser->argc;
+    instruction->argv = malloc(sizeof(char*) * parser->argc);
+    for (i = 0; i < parser->argc; i++)
+        instruction->argv[i] = guac_strdup(parser->argv[i]);
+
+}
+
+guac_common_recording_checkpoint* guac_common_recording_index_find(
+        const char* path, guac_timestamp time) {
+
+    /* Checkpoints beyond the end of the recording cannot be used */
+    struct stat recording_stat;
+    if (stat(path, &recording_stat))
+        return NULL;
+
+    size_t index_path_size = strlen(path)
+        + sizeof(GUAC_COMMON_RECORDING_INDEX_SUFFIX);
+    char* index_path = malloc(index_path_size);
+    snprintf(index_path, index_path_size, "%s%s", path,
+            GUAC_COMMON_RECORDING_INDEX_SUFFIX);
+
+    int fd = open(index_path, O_RDONLY);
+    free(index_path);
+    if (fd == -1)
+        return NULL;
+
+    guac_socket* socket = guac_socket_open(fd);
+    if (socket == NULL)
+        return NULL;
+
+    guac_parser* parser = guac_parser_alloc();
+    if (parser == NULL) {
+        guac_socket_free(socket);
+        return NULL;
+    }
+
+    guac_common_recording_checkpoint* found = NULL;
+    guac_timestamp start = 0;
+
+    while (!guac_parser_read(parser, socket, -1)) {
+
+        /* State instructions belong to the preceding checkpoint */
+        if (strcmp(parser->opcode, "checkpoint") != 0) {
+            if (found != NULL)
+                guac_common_recording_checkpoint_append(found, parser);
+            continue;
+        }
+
+        /* Ignore malformed checkpoints */
+        if (parser->argc < 2)
+            continue;
+
+        guac_timestamp timestamp = strtoll(parser->argv[0], NULL, 10);
+        int64_t offset = strtoll(parser->argv[1], NULL, 10);
+
+        /* The first checkpoint marks the start of the recording */
+        if (found == NULL)
+            start = timestamp;
+
+        /* Checkpoints are written in order, so stop at the first checkpoint
+         * which cannot be used */
+        if (timestamp - start > time || offset > recording_stat.st_size)
+            break;
+
+        if (found != NULL)
+            guac_common_recording_checkpoint_free(found);
+
+        found = calloc(1, sizeof(guac_common_recording_checkpoint));
+        if (found == NULL)
+            break;
+
+        found->start = start;
+        found->timestamp = timestamp;
+        found->offset = offset;
+
+    }
+
+    guac_parser_free(parser);
+    guac_socket_free(socket);
+    return found;
+
+}
+
+void guac_common_recording_checkpoint_free(
+        guac_common_recording_checkpoint* checkpoint) {
+
+    int i, j;
+
+    for (i = 0; i < checkpoint->length; i++) {
+
+        guac_common_recording_index_instruction* instruction =
+            &checkpoint->state[i];
+
+        for (j = 0; j < instruction->argc; j++)
+            free(instruction->argv[j]);
+
+        free(instruction->argv);
+        free(instruction->opcode);
+
+    }
+
+    free(checkpoint->state);
+    free(checkpoint);
+
+}
+
+int guac_common_recording_get_timestamp(const char* opcode, int argc,
+        char** argv, guac_timestamp* timestamp) {
+
+    int position;
+
+    /* Locate timestamp argument, if any */
+    if (strcmp(opcode, "sync") == 0)
+        position = 0;
+    else if (strcmp(opcode, "mouse") == 0)
+        position = 3;
+    else if (strcmp(opcode, "key") == 0)
+        position = 2;
+    else if (strcmp(opcode, "touch") == 0)
+        position = 7;
+    else
+        return 0;
+
+    /* Timestamps are optional for some instructions */
+    if (argc <= position)
+        return 0;
+
+    *timestamp = strtoll(argv[position], NULL, 10);
+    return 1;
+
+}
+
+int guac_common_recording_parse_time(const char* value, guac_timestamp* time) {
+
+    int parts;
+    guac_timestamp total = 0;
+
+    for (parts = 1; parts <= 3; parts++) {
+
+        /* Each part must be a non-negative decimal integer */
+        if (*value < '0' || *value > '9')
+            return 1;
+
+        char* end;
+        long long part = strtoll(value, &end, 10);
+
+        /* Only the leading part may exceed the size of the next unit */
+        if (parts > 1 && part >= 60)
+            return 1;
+
+        total = total * 60 + part;
+
+        /* Parts are separated by colons */
+        if (*end == '\0') {
+            *time = total * 1000;
+            return 0;
+        }
+
+        if (*end != ':')
+            return 1;
+
+        value = end + 1;
+
+    }
+
+    /* More than three parts were given */
+    return 1;
+
+}
+
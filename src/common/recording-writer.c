@@ -0,0 +1,730 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+#include "common/recording-compression.h"
+#include "common/recording-index.h"
+#include "common/recording-writer.h"
+
+#include <guacamole/client.h>
+#include <guacamole/protocol.h>
+#include <guacamole/socket.h>
+#include <guacamole/timestamp.h>
+
+#include <sys/uio.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * Returns the current value of a monotonic clock, in microseconds.
+ *
+ * @return
+ *     The current value of a monotonic clock, in microseconds.
+ */
+static uint64_t guac_common_recording_writer_now() {
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+
+}
+
+/**
+ * Returns the number of bytes currently queued within the given writer. The
+ * state lock of the writer must be held.
+ *
+ * @param writer
+ *     The recording writer to inspect.
+ *
+ * @return
+ *     The number of bytes currently queued.
+ */
+static size_t guac_common_recording_writer_queued(
+        guac_common_recording_writer* writer) {
+    return writer->tail - writer->head;
+}
+
+/**
+ * Copies the given data into the queue of the given writer, which must have
+ * sufficient space available. The state lock of the writer must be held.
+ *
+ * @param writer
+ *     The recording writer to append data to.
+ *
+ * @param buf
+ *     The data to append.
+ *
+ * @param length
+ *     The number of bytes of data to append.
+ */
+static void guac_common_recording_writer_append(
+        guac_common_recording_writer* writer, const void* buf,
+        size_t length) {
+
+    /* Copy data into circular buffer, wrapping around as necessary */
+    size_t offset = writer->tail % writer->size;
+    size_t first = writer->size - offset;
+    if (first > length)
+        first = length;
+
+    memcpy(writer->buffer + offset, buf, first);
+    memcpy(writer->buffer, (const char*) buf + first, length - first);
+
+    writer->tail += length;
+    writer->bytes_queued += length;
+
+    if (guac_common_recording_writer_queued(writer) > writer->peak_depth)
+        writer->peak_depth = guac_common_recording_writer_queued(writer);
+
+}
+
+/**
+ * Makes all data appended to the given writer visible to the writer thread,
+ * waking the writer thread if a significant amount of data is now waiting.
+ * The state lock of the writer must be held.
+ *
+ * @param writer
+ *     The recording writer to commit.
+ */
+static void guac_common_recording_writer_commit(
+        guac_common_recording_writer* writer) {
+
+    writer->committed = writer->tail;
+
+    if (writer->writer_waiting
+            && writer->committed - writer->head >= writer->size / 4)
+        pthread_cond_signal(&writer->data_available);
+
+}
+
+/**
+ * Discards the instruction currently being appended to the given writer,
+ * along with all further data until space becomes available, as dictated by
+ * GUAC_COMMON_RECORDING_OVERFLOW_DROP. The state lock of the writer must be
+ * held.
+ *
+ * @param writer
+ *     The recording writer which has overflowed.
+ *
+ * @param length
+ *     The number of bytes of data which could not be appended.
+ *
+ * @return
+ *     Non-zero if this is the first data discarded since recording last
+ *     resumed, zero otherwise.
+ */
+static int guac_common_recording_writer_overflow(
+        guac_common_recording_writer* writer, size_t length) {
+
+    /* Discard partial instruction and everything that follows */
+    size_t discarded = writer->tail - writer->committed + length;
+    writer->bytes_queued -= writer->tail - writer->committed;
+    writer->tail = writer->committed;
+    writer->dropping = 1;
+
+    writer->bytes_dropped += discarded;
+    writer->gap_bytes += discarded;
+
+    if (writer->overflowed)
+        return 0;
+
+    writer->overflowed = 1;
+    writer->gap_start = guac_timestamp_current();
+    return 1;
+
+}
+
+/**
+ * Appends a "gap" instruction describing all data discarded since the given
+ * writer overflowed, resuming recording. If insufficient space is available,
+ * the writer remains overflowed. The state lock of the writer must be held.
+ *
+ * @param writer
+ *     The overflowed recording writer.
+ *
+ * @return
+ *     Non-zero if the "gap" instruction was appended and recording has
+ *     resumed, zero otherwise.
+ */
+static int guac_common_recording_writer_resume(
+        guac_common_recording_writer* writer) {
+
+    char start[32];
+    char end[32];
+    char bytes[32];
+    char gap[128];
+
+    /* Resume only after the writer thread has caught up significantly */
+    if (guac_common_recording_writer_queued(writer) > writer->size / 2)
+        return 0;
+
+    snprintf(start, sizeof(start), "%" PRId64, (int64_t) writer->gap_start);
+    snprintf(end, sizeof(end), "%" PRId64,
+            (int64_t) guac_timestamp_current());
+    snprintf(bytes, sizeof(bytes), "%" PRIu64, writer->gap_bytes);
+
+    int length = snprintf(gap, sizeof(gap), "3.gap,%zu.%s,%zu.%s,%zu.%s;",
+            strlen(start), start, strlen(end), end, strlen(bytes), bytes);
+
+    if (writer->size - guac_common_recording_writer_queued(writer)
+            < (size_t) length)
+        return 0;
+
+    guac_common_recording_writer_append(writer, gap, length);
+    guac_common_recording_writer_commit(writer);
+
+    writer->overflowed = 0;
+    writer->gap_bytes = 0;
+    writer->gaps++;
+    return 1;
+
+}
+
+/**
+ * Writes all data between the given positions within the queue of the given
+ * writer to the recording file, updating the index of the recording, if any.
+ * The state lock of the writer must NOT be held.
+ *
+ * @param writer
+ *     The recording writer whose queued data should be written.
+ *
+ * @param start
+ *     The position of the first byte to write.
+ *
+ * @param end
+ *     The position immediately after the last byte to write.
+ *
+ * @return
+ *     Zero if all data was written successfully, non-zero otherwise.
+ */
+static int guac_common_recording_writer_write(
+        guac_common_recording_writer* writer, size_t start, size_t end) {
+
+    struct iovec iov[2];
+    int iovcnt = 0;
+
+    /* Describe queued data as at most two contiguous regions */
+    size_t offset = start % writer->size;
+    size_t length = end - start;
+    size_t first = writer->size - offset;
+    if (first > length)
+        first = length;
+
+    iov[iovcnt].iov_base = writer->buffer + offset;
+    iov[iovcnt++].iov_len = first;
+
+    if (length > first) {
+        iov[iovcnt].iov_base = writer->buffer;
+        iov[iovcnt++].iov_len = length - first;
+    }
+
+    /* Update index only with data in the order it is written */
+    if (writer->index != NULL) {
+        int i;
+        for (i = 0; i < iovcnt; i++)
+            guac_common_recording_index_update(writer->index,
+                    iov[i].iov_base, iov[i].iov_len);
+    }
+
+    /* Compressed recordings are written by the compressor */
+    if (writer->compressor != NULL)
+        return guac_common_recording_compressor_write(writer->compressor,
+                iov, iovcnt);
+
+    /* Write all regions, resuming after partial writes */
+    struct iovec* current = iov;
+    while (iovcnt > 0) {
+
+        ssize_t written = writev(writer->fd, current, iovcnt);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            return 1;
+        }
+
+        while (iovcnt > 0 && (size_t) written >= current->iov_len) {
+            written -= current->iov_len;
+            current++;
+            iovcnt--;
+        }
+
+        if (iovcnt > 0) {
+            current->iov_base = (char*) current->iov_base + written;
+            current->iov_len -= written;
+        }
+
+    }
+
+    return 0;
+
+}
+
+/**
+ * Writer thread which drains the queue of the recording writer given as its
+ * argument to the recording file until the writer is stopped and no further
+ * data remains. Data is written once at least a quarter of the queue is in
+ * use, or once GUAC_COMMON_RECORDING_WRITER_INTERVAL microseconds have
+ * elapsed, such that writes are batched.
+ *
+ * @param data
+ *     The guac_common_recording_writer to drain.
+ *
+ * @return
+ *     Always NULL.
+ */
+static void* guac_common_recording_writer_thread(void* data) {
+
+    guac_common_recording_writer* writer =
+        (guac_common_recording_writer*) data;
+
+    pthread_mutex_lock(&writer->state_lock);
+
+    for (;;) {
+
+        /* Wait for a batch of data to accumulate */
+        if (!writer->stopping
+                && writer->committed - writer->head < writer->size / 4) {
+
+            struct timespec timeout;
+            clock_gettime(CLOCK_REALTIME, &timeout);
+
+            timeout.tv_nsec += GUAC_COMMON_RECORDING_WRITER_INTERVAL * 1000L;
+            if (timeout.tv_nsec >= 1000000000L) {
+                timeout.tv_sec += timeout.tv_nsec / 1000000000L;
+                timeout.tv_nsec %= 1000000000L;
+            }
+
+            writer->writer_waiting = 1;
+            pthread_cond_timedwait(&writer->data_available,
+                    &writer->state_lock, &timeout);
+            writer->writer_waiting = 0;
+
+        }
+
+        size_t start = writer->head;
+        size_t end = writer->committed;
+
+        if (start == end) {
+            if (writer->stopping)
+                break;
+            continue;
+        }
+
+        /* Data is discarded once the recording file cannot be written */
+        if (writer->failed)
+            writer->bytes_dropped += end - start;
+
+        else {
+
+            pthread_mutex_unlock(&writer->state_lock);
+            int error = guac_common_recording_writer_write(writer, start, end);
+            int write_errno = errno;
+            pthread_mutex_lock(&writer->state_lock);
+
+            if (error) {
+                guac_client_log(writer->client, GUAC_LOG_ERROR, "Unable to "
+                        "write session recording: %s. All further recorded "
+                        "data will be discarded.", strerror(write_errno));
+                writer->failed = 1;
+                writer->bytes_dropped += end - start;
+            }
+
+            else
+                writer->bytes_written += end - start;
+
+        }
+
+        /* Release written space to producers */
+        writer->head = end;
+        if (writer->producers_waiting)
+            pthread_cond_broadcast(&writer->space_available);
+
+    }
+
+    pthread_mutex_unlock(&writer->state_lock);
+    return NULL;
+
+}
+
+/**
+ * Appends the given data to the queue of the given writer, waiting for space
+ * to become available as necessary. The state lock of the writer must be
+ * held, and will be released while waiting.
+ *
+ * @param writer
+ *     The recording writer to append data to.
+ *
+ * @param buf
+ *     The data to append.
+ *
+ * @param count
+ *     The number of bytes of data to append.
+ *
+ * @return
+ *     Non-zero if this is the first time any producer has needed to wait for
+ *     space, zero otherwise.
+ */
+static int guac_common_recording_writer_append_blocking(
+        guac_common_recording_writer* writer, const char* buf,
+        size_t count) {
+
+    uint64_t stall_start = 0;
+    int first_stall = 0;
+
+    while (count > 0) {
+
+        /* Data which can never be written need not be waited for */
+        if (writer->failed) {
+            writer->bytes_dropped += count;
+            break;
+        }
+
+        size_t available =
+            writer->size - guac_common_recording_writer_queued(writer);
+
+        /* Wait for the writer thread to free space */
+        if (available == 0) {
+
+            if (stall_start == 0) {
+                stall_start = guac_common_recording_writer_now();
+                first_stall = (writer->stalls++ == 0);
+            }
+
+            pthread_cond_signal(&writer->data_available);
+
+            writer->producers_waiting++;
+            pthread_cond_wait(&writer->space_available, &writer->state_lock);
+            writer->producers_waiting--;
+            continue;
+
+        }
+
+        /* Append as much as will fit, making it visible to the writer thread
+         * immediately, as nothing is ever discarded */
+        size_t length = count;
+        if (length > available)
+            length = available;
+
+        guac_common_recording_writer_append(writer, buf, length);
+        guac_common_recording_writer_commit(writer);
+
+        buf += length;
+        count -= length;
+
+    }
+
+    if (stall_start != 0)
+        writer->stall_time += guac_common_recording_writer_now() - stall_start;
+
+    return first_stall;
+
+}
+
+/**
+ * Callback function which appends data to the queue of the recording writer
+ * associated with the given socket, applying the overflow policy of that
+ * writer if the queue is full.
+ *
+ * @param socket
+ *     The guac_socket being written to.
+ *
+ * @param buf
+ *     The data to write.
+ *
+ * @param count
+ *     The number of bytes of data to write.
+ *
+ * @return
+ *     The number of bytes written, which is always count, as data which
+ *     cannot be recorded is discarded rather than treated as an error.
+ */
+static ssize_t guac_common_recording_writer_write_handler(guac_socket* socket,
+        const void* buf, size_t count) {
+
+    guac_common_recording_writer* writer =
+        (guac_common_recording_writer*) socket->data;
+
+    int overflowed = 0;
+    int stalled = 0;
+
+    pthread_mutex_lock(&writer->state_lock);
+
+    /* Data which can never be written is simply discarded */
+    if (writer->failed)
+        writer->bytes_dropped += count;
+
+    /* Ignore data for instructions which are being discarded */
+    else if (writer->dropping || writer->overflowed) {
+        writer->bytes_dropped += count;
+        writer->gap_bytes += count;
+    }
+
+    else if (writer->policy == GUAC_COMMON_RECORDING_OVERFLOW_BLOCK)
+        stalled = guac_common_recording_writer_append_blocking(writer, buf,
+                count);
+
+    else if (writer->size - guac_common_recording_writer_queued(writer)
+            < count)
+        overflowed = guac_common_recording_writer_overflow(writer, count);
+
+    else
+        guac_common_recording_writer_append(writer, buf, count);
+
+    pthread_mutex_unlock(&writer->state_lock);
+
+    if (overflowed)
+        guac_client_log(writer->client, GUAC_LOG_WARNING, "Recording queue "
+                "full (%zu bytes). Recorded data will be discarded until the "
+                "recording file catches up.", writer->size);
+
+    else if (stalled)
+        guac_client_log(writer->client, GUAC_LOG_WARNING, "Recording queue "
+                "full (%zu bytes). The session will wait for the recording "
+                "file to catch up.", writer->size);
+
+    return count;
+
+}
+
+/**
+ * Callback function which does nothing, as queued data is written by the
+ * writer thread without needing to be explicitly flushed.
+ *
+ * @param socket
+ *     The guac_socket being flushed.
+ *
+ * @return
+ *     Always zero.
+ */
+static ssize_t guac_common_recording_writer_flush_handler(guac_socket* socket) {
+    return 0;
+}
+
+/**
+ * Callback function which begins a new instruction, acquiring exclusive
+ * access to the queue of the associated recording writer and resuming
+ * recording if data was previously discarded and space is now available.
+ *
+ * @param socket
+ *     The guac_socket on which an instruction is beginning.
+ */
+static void guac_common_recording_writer_lock_handler(guac_socket* socket) {
+
+    guac_common_recording_writer* writer =
+        (guac_common_recording_writer*) socket->data;
+
+    int resumed = 0;
+    uint64_t gap_bytes = 0;
+
+    pthread_mutex_lock(&writer->instruction_lock);
+    pthread_mutex_lock(&writer->state_lock);
+
+    if (writer->overflowed && !writer->failed) {
+        gap_bytes = writer->gap_bytes;
+        resumed = guac_common_recording_writer_resume(writer);
+    }
+
+    writer->dropping = writer->overflowed;
+
+    pthread_mutex_unlock(&writer->state_lock);
+
+    if (resumed)
+        guac_client_log(writer->client, GUAC_LOG_INFO, "Recording resumed "
+                "after discarding %" PRIu64 " bytes.", gap_bytes);
+
+}
+
+/**
+ * Callback function which ends the current instruction, making that
+ * instruction visible to the writer thread of the associated recording
+ * writer and releasing exclusive access to the queue.
+ *
+ * @param socket
+ *     The guac_socket on which an instruction is ending.
+ */
+static void guac_common_recording_writer_unlock_handler(guac_socket* socket) {
+
+    guac_common_recording_writer* writer =
+        (guac_common_recording_writer*) socket->data;
+
+    pthread_mutex_lock(&writer->state_lock);
+
+    if (!writer->dropping)
+        guac_common_recording_writer_commit(writer);
+
+    writer->dropping = 0;
+
+    pthread_mutex_unlock(&writer->state_lock);
+    pthread_mutex_unlock(&writer->instruction_lock);
+
+}
+
+/**
+ * Callback function which frees the recording writer associated with the
+ * given socket.
+ *
+ * @param socket
+ *     The guac_socket being freed.
+ *
+ * @return
+ *     Always zero.
+ */
+static int guac_common_recording_writer_free_handler(guac_socket* socket) {
+    guac_common_recording_writer_free(
+            (guac_common_recording_writer*) socket->data);
+    return 0;
+}
+
+guac_common_recording_writer* guac_common_recording_writer_alloc(
+        guac_client* client, int fd, guac_common_recording_index* index,
+        guac_common_recording_compressor* compressor, size_t size,
+        guac_common_recording_overflow_policy policy) {
+
+    guac_common_recording_writer* writer =
+        calloc(1, sizeof(guac_common_recording_writer));
+    if (writer == NULL)
+        return NULL;
+
+    writer->buffer = malloc(size);
+    if (writer->buffer == NULL) {
+        free(writer);
+        return NULL;
+    }
+
+    writer->client = client;
+    writer->fd = fd;
+    writer->index = index;
+    writer->compressor = compressor;
+    writer->size = size;
+    writer->policy = policy;
+
+    pthread_mutex_init(&writer->instruction_lock, NULL);
+    pthread_mutex_init(&writer->state_lock, NULL);
+    pthread_cond_init(&writer->data_available, NULL);
+    pthread_cond_init(&writer->space_available, NULL);
+
+    if (pthread_create(&writer->writer, NULL,
+                guac_common_recording_writer_thread, writer)) {
+        pthread_cond_destroy(&writer->space_available);
+        pthread_cond_destroy(&writer->data_available);
+        pthread_mutex_destroy(&writer->state_lock);
+        pthread_mutex_destroy(&writer->instruction_lock);
+        free(writer->buffer);
+        free(writer);
+        return NULL;
+    }
+
+    return writer;
+
+}
+
+void guac_common_recording_writer_free(guac_common_recording_writer* writer) {
+
+    /* Signal writer thread to write all remaining data and stop */
+    pthread_mutex_lock(&writer->state_lock);
+    writer->stopping = 1;
+    pthread_cond_signal(&writer->data_available);
+    pthread_mutex_unlock(&writer->state_lock);
+
+    pthread_join(writer->writer, NULL);
+
+    guac_client_log(writer->client,
+            writer->stalls || writer->bytes_dropped
+                ? GUAC_LOG_INFO : GUAC_LOG_DEBUG,
+            "Recording closed: %" PRIu64 " bytes queued, %" PRIu64 " bytes "
+            "written, %" PRIu64 " bytes discarded in %u gap(s), at most %zu "
+            "bytes pending, %u stall(s) totalling %" PRIu64 " ms.",
+            writer->bytes_queued, writer->bytes_written,
+            writer->bytes_dropped, writer->gaps, writer->peak_depth,
+            writer->stalls, writer->stall_time / 1000);
+
+    /* Complete compressed stream, reporting the effectiveness and cost of
+     * compression */
+    guac_common_recording_compressor* compressor = writer->compressor;
+    if (compressor != NULL) {
+
+        if (guac_common_recording_compressor_finish(compressor))
+            guac_client_log(writer->client, GUAC_LOG_ERROR, "Unable to "
+                    "complete compressed session recording: %s",
+                    strerror(errno));
+
+        else if (compressor->bytes_in > 0)
+            guac_client_log(writer->client, GUAC_LOG_INFO, "Recording "
+                    "compressed from %" PRIu64 " to %" PRIu64 " bytes "
+                    "(ratio %.2f) using %" PRIu64 " ms of CPU time.",
+                    compressor->bytes_in, compressor->bytes_out,
+                    (double) compressor->bytes_in / compressor->bytes_out,
+                    compressor->cpu_time / 1000);
+
+        guac_common_recording_compressor_free(compressor);
+
+    }
+
+    if (writer->index != NULL)
+        guac_common_recording_index_free(writer->index);
+
+    close(writer->fd);
+
+    pthread_cond_destroy(&writer->space_available);
+    pthread_cond_destroy(&writer->data_available);
+    pthread_mutex_destroy(&writer->state_lock);
+    pthread_mutex_destroy(&writer->instruction_lock);
+
+    free(writer->buffer);
+    free(writer);
+
+}
+
+guac_socket* guac_common_recording_writer_socket(
+        guac_common_recording_writer* writer) {
+
+    guac_socket* socket = guac_socket_alloc();
+    if (socket == NULL)
+        return NULL;
+
+    socket->data = writer;
+
+    socket->write_handler  = guac_common_recording_writer_write_handler;
+    socket->flush_handler  = guac_common_recording_writer_flush_handler;
+    socket->lock_handler   = guac_common_recording_writer_lock_handler;
+    socket->unlock_handler = guac_common_recording_writer_unlock_handler;
+    socket->free_handler   = guac_common_recording_writer_free_handler;
+
+    return socket;
+
+}
+
+size_t guac_common_recording_writer_depth(
+        guac_common_recording_writer* writer) {
+
+    pthread_mutex_lock(&writer->state_lock);
+    size_t queued = guac_common_recording_writer_queued(writer);
+    pthread_mutex_unlock(&writer->state_lock);
+
+    return queued;
+
+}
@@ -18,6 +18,9 @@
  */
 
 #include "common/recording.h"
+#include "common/recording-compression.h"
+#include "common/recording-index.h"
+#include "common/recording-writer.h"
 
 #include <guacamole/client.h>
 #include <guacamole/protocol.h>
@@ -135,10 +138,120 @@ static int guac_common_recording_open(const char* path,
 
 }
 
+/**
+ * Creates the sidecar index of the recording having the given filename. If
+ * the index cannot be created, a warning is logged and the recording
+ * continues without an index.
+ *
+ * @param client
+ *     The client associated with the recording, for logging purposes.
+ *
+ * @param filename
+ *     The full path to the recording file.
+ *
+ * @return
+ *     A newly-allocated index which writes to the sidecar index file, or NULL
+ *     if the index could not be created.
+ */
+static guac_common_recording_index* guac_common_recording_open_index(
+        guac_client* client, const char* filename) {
+
+    char index_filename[GUAC_COMMON_RECORDING_MAX_NAME_LENGTH
+        + sizeof(GUAC_COMMON_RECORDING_INDEX_SUFFIX)];
+
+    snprintf(index_filename, sizeof(index_filename), "%s%s", filename,
+            GUAC_COMMON_RECORDING_INDEX_SUFFIX);
+
+    /* The recording itself was created exclusively, so any existing index
+     * belongs to a different recording */
+    int fd = open(index_filename,
+            O_CREAT | O_EXCL | O_WRONLY,
+            S_IRUSR | S_IWUSR);
+
+    if (fd == -1) {
+        guac_client_log(client, GUAC_LOG_WARNING, "Recording will not be "
+                "indexed: %s", strerror(errno));
+        return NULL;
+    }
+
+    guac_common_recording_index* index = guac_common_recording_index_alloc(fd);
+    if (index == NULL) {
+        guac_client_log(client, GUAC_LOG_WARNING, "Recording will not be "
+                "indexed: Unable to allocate index.");
+        close(fd);
+        return NULL;
+    }
+
+    guac_client_log(client, GUAC_LOG_INFO,
+            "Index of recording will be saved to \"%s\".", index_filename);
+
+    return index;
+
+}
+
+/**
+ * Allocates a compressor for the recording open at the given file
+ * descriptor, using the compression format having the given name. If the
+ * format is invalid or unsupported, or the compressor cannot be allocated, a
+ * warning is logged and the recording continues without compression.
+ *
+ * @param client
+ *     The client associated with the recording, for logging purposes.
+ *
+ * @param fd
+ *     The file descriptor of the recording file.
+ *
+ * @param compression
+ *     The name of the compression format to use, as accepted by
+ *     guac_common_recording_parse_compression(), or NULL.
+ *
+ * @return
+ *     A newly-allocated compressor which writes to the given file
+ *     descriptor, or NULL if the recording should not be compressed.
+ */
+static guac_common_recording_compressor* guac_common_recording_open_compressor(
+        guac_client* client, int fd, const char* compression) {
+
+    guac_common_recording_compression format;
+
+    if (guac_common_recording_parse_compression(compression, &format)) {
+        guac_client_log(client, GUAC_LOG_WARNING, "Recording will not be "
+                "compressed: Unknown compression format \"%s\".",
+                compression);
+        return NULL;
+    }
+
+    if (format == GUAC_COMMON_RECORDING_COMPRESSION_NONE)
+        return NULL;
+
+    if (!guac_common_recording_compression_supported(format)) {
+        guac_client_log(client, GUAC_LOG_WARNING, "Recording will not be "
+                "compressed: Support for \"%s\" compression is not "
+                "available.", compression);
+        return NULL;
+    }
+
+    guac_common_recording_compressor* compressor =
+        guac_common_recording_compressor_alloc(format, fd);
+
+    if (compressor == NULL) {
+        guac_client_log(client, GUAC_LOG_WARNING, "Recording will not be "
+                "compressed: Unable to allocate compressor.");
+        return NULL;
+    }
+
+    guac_client_log(client, GUAC_LOG_INFO, "Recording will be compressed "
+            "using %s.", compression);
+
+    return compressor;
+
+}
+
 guac_common_recording* guac_common_recording_create(guac_client* client,
         const char* path, const char* name, int create_path,
         int include_output, int include_mouse, int include_touch,
-        int include_keys) {
+        int include_keys, int write_index, int buffer_size,
+        int drop_on_overflow, const char* compression) {
 
     char filename[GUAC_COMMON_RECORDING_MAX_NAME_LENGTH];
 
@@ -161,9 +274,47 @@ guac_common_recording* guac_common_recording_create(guac_client* client,
         return NULL;
     }
 
+    /* Index recording as it is written, if requested */
+    guac_common_recording_index* index = NULL;
+    if (write_index)
+        index = guac_common_recording_open_index(client, filename);
+
+    /* Compress recording as it is written, if requested */
+    guac_common_recording_compressor* compressor =
+        guac_common_recording_open_compressor(client, fd, compression);
+
+    if (buffer_size <= 0)
+        buffer_size = GUAC_COMMON_RECORDING_WRITER_DEFAULT_SIZE;
+
+    /* Write recording from a dedicated thread, such that the session is not
+     * affected by the performance of the filesystem */
+    guac_common_recording_writer* writer = guac_common_recording_writer_alloc(
+            client, fd, index, compressor, buffer_size, drop_on_overflow
+                ? GUAC_COMMON_RECORDING_OVERFLOW_DROP
+                : GUAC_COMMON_RECORDING_OVERFLOW_BLOCK);
+
+    if (writer == NULL) {
+        guac_client_log(client, GUAC_LOG_ERROR, "Creation of recording "
+                "failed: Unable to start recording writer.");
+        if (compressor != NULL)
+            guac_common_recording_compressor_free(compressor);
+        if (index != NULL)
+            guac_common_recording_index_free(index);
+        close(fd);
+        return NULL;
+    }
+
+    guac_socket* socket = guac_common_recording_writer_socket(writer);
+    if (socket == NULL) {
+        guac_client_log(client, GUAC_LOG_ERROR, "Creation of recording "
+                "failed: Unable to allocate socket.");
+        guac_common_recording_writer_free(writer);
+        return NULL;
+    }
+
     /* Create recording structure with reference to underlying socket */
     guac_common_recording* recording = malloc(sizeof(guac_common_recording));
-    recording->socket = guac_socket_open(fd);
+    recording->socket = socket;
     recording->include_output = include_output;
     recording->include_mouse = include_mouse;
     recording->include_touch = include_touch;
@@ -18,11 +18,16 @@
  */
 
 #include "config.h"
+#include "common/encoder.h"
+#include "common/image-cache.h"
+#include "common/pixel.h"
 #include "common/rect.h"
 #include "common/surface.h"
 
 #include <cairo/cairo.h>
 #include <guacamole/client.h>
+#include <guacamole/congestion.h>
+#include <guacamole/hash.h>
 #include <guacamole/layer.h>
 #include <guacamole/protocol.h>
 #include <guacamole/socket.h>
@@ -103,6 +108,41 @@
  */
 #define GUAC_SURFACE_WEBP_BLOCK_SIZE 8
 
+/**
+ * The minimum width and height of a draw operation, in pixels, for that
+ * operation to be checked for content which merely shifts content already
+ * present within the surface (such as when scrolling).
+ */
+#define GUAC_SURFACE_SCROLL_MIN_SIZE 128
+
+/**
+ * The minimum area of a draw operation, in pixels, for that operation to be
+ * checked for shifted content. Draws covering fewer than sixteen 64x64 cells
+ * are cheap enough to send as-is.
+ */
+#define GUAC_SURFACE_SCROLL_MIN_AREA 65536
+
+/**
+ * The minimum number of contiguous rows or columns of a draw operation which
+ * must match existing surface content at the same offset for that content to
+ * be copied within the surface rather than sent again as image data.
+ */
+#define GUAC_SURFACE_SCROLL_MIN_RUN 16
+
+/**
+ * The number of rows or columns of a draw operation which are used as anchors
+ * when searching for the offset of shifted content. Offsets are only
+ * considered if they would align at least one anchor with an identical row
+ * or column of existing content.
+ */
+#define GUAC_SURFACE_SCROLL_ANCHORS 8
+
+/**
+ * The maximum number of offsets that will be tested for each anchor when
+ * searching for shifted content.
+ */
+#define GUAC_SURFACE_SCROLL_CANDIDATES 4
+
 void guac_common_surface_set_multitouch(guac_common_surface* surface,
         int touches) {
 
@@ -125,6 +165,24 @@ void guac_common_surface_set_lossless(guac_common_surface* surface,
 
 }
 
+void guac_common_surface_set_image_cache(guac_common_surface* surface,
+        guac_common_image_cache* image_cache) {
+
+    pthread_mutex_lock(&surface->_lock);
+    surface->image_cache = image_cache;
+    pthread_mutex_unlock(&surface->_lock);
+
+}
+
+void guac_common_surface_set_encoder(guac_common_surface* surface,
+        guac_common_encoder* encoder) {
+
+    pthread_mutex_lock(&surface->_lock);
+    surface->encoder = encoder;
+    pthread_mutex_unlock(&surface->_lock);
+
+}
+
 void guac_common_surface_move(guac_common_surface* surface, int x, int y) {
 
     pthread_mutex_lock(&surface->_lock);
@@ -232,54 +290,6 @@ static void __guac_common_clip_rect(guac_common_surface* surface,
 
 }
 
-/**
- * Returns whether a rectangle within the given surface contains only fully
- * opaque pixels.
- *
- * @param surface
- *     The surface to check.
- *
- * @param rect
- *     The rectangle to check.
- *
- * @return
- *     Non-zero if the rectangle contains only fully opaque pixels, zero
- *     otherwise.
- */
-static int __guac_common_surface_is_opaque(guac_common_surface* surface,
-        guac_common_rect* rect) {
-
-    int x, y;
-
-    int stride = surface ->stride;
-    unsigned char* buffer =
-        surface->buffer + (stride * rect->y) + (4 * rect->x);
-
-    /* For each row */
-    for (y = 0; y < rect->height; y++) {
-
-        /* Search for a non-opaque pixel */
-        uint32_t* current = (uint32_t*) buffer;
-        for (x=0; x < rect->width; x++) {
-
-            /* Rectangle is non-opaque if a single non-opaque pixel is found */
-            uint32_t color = *(current++);
-            if ((color & 0xFF000000) != 0xFF000000)
-                return 0;
-
-        }
-
-        /* Next row */
-        buffer += stride;
-
-    }
-
-    /* Rectangle is opaque */
-    return 1;
-
-}
-
-
 /**
  * Returns whether the given rectangle should be combined into the existing
  * dirty rectangle, to be eventually flushed as image data, or would be best
@@ -415,13 +425,13 @@ static unsigned int __guac_common_surface_calculate_framerate(
 
     /* Iterate over all the heat map cells for the area
      * and calculate the average framerate */
-    for (y = min_y; y < max_y; y++) {
+    for (y = min_y; y <= max_y; y++) {
 
         /* Get current row of heat map */
         const guac_common_surface_heat_cell* heat_cell = heat_row;
 
         /* For each cell in subset of row */
-        for (x = min_x; x < max_x; x++) {
+        for (x = min_x; x <= max_x; x++) {
 
             /* Calculate indicies for latest and oldest history entries */
             int oldest_entry = heat_cell->oldest_entry;
@@ -461,7 +471,8 @@ static unsigned int __guac_common_surface_calculate_framerate(
  * Guesses whether a rectangle within a particular surface would be better
  * compressed as PNG or using a lossy format like JPEG. Positive values
  * indicate PNG is likely to be superior, while negative values indicate the
- * opposite.
+ * opposite. Whether the rectangle contains only fully opaque pixels is
+ * determined within the same pass over the image data.
  *
  * @param surface
  *     The surface containing the image data to check.
@@ -469,18 +480,28 @@ static unsigned int __guac_common_surface_calculate_framerate(
  * @param rect
  *     The rect to check within the given surface.
  *
+ * @param opaque
+ *     Pointer to an int which will be set to non-zero if the rectangle
+ *     contains only fully opaque pixels, zero otherwise.
+ *
  * @return
  *     Positive values if PNG compression is likely to perform better than
  *     lossy alternatives, or negative values if PNG is likely to perform
  *     worse.
  */
 static int __guac_common_surface_png_optimality(guac_common_surface* surface,
-        const guac_common_rect* rect) {
+        const guac_common_rect* rect, int* opaque) {
 
-    int x, y;
+    const guac_common_pixel_kernels* kernels =
+        guac_common_pixel_get_best_kernels();
+
+    int y;
 
     int num_same = 0;
-    int num_different = 1;
+    int num_different;
+
+    /* Alpha of every pixel, which will be 0xFF only if all are opaque */
+    uint32_t alpha = 0xFF000000;
 
     /* Get image/buffer metrics */
     int width = rect->width;
@@ -491,36 +512,22 @@ static int __guac_common_surface_png_optimality(guac_common_surface* surface,
     unsigned char* buffer = surface->buffer + rect->y * stride + rect->x * 4;
 
     /* Image must be at least 1x1 */
-    if (width < 1 || height < 1)
+    if (width < 1 || height < 1) {
+        *opaque = 1;
         return 0;
+    }
 
-    /* For each row */
+    /* Count pixels identical to the previous pixel in each row */
     for (y = 0; y < height; y++) {
-
-        uint32_t* row = (uint32_t*) buffer;
-        uint32_t last_pixel = *(row++) | 0xFF000000;
-
-        /* For each pixel in current row */
-        for (x = 1; x < width; x++) {
-
-            /* Get next pixel */
-            uint32_t current_pixel = *(row++) | 0xFF000000;
-
-            /* Update same/different counts according to pixel value */
-            if (current_pixel == last_pixel)
-                num_same++;
-            else
-                num_different++;
-
-            last_pixel = current_pixel;
-
-        }
-
-        /* Advance to next row */
+        kernels->analyze((uint32_t*) buffer, width, &num_same, &alpha);
         buffer += stride;
-
     }
 
+    /* All other pixels (aside from the first of each row) differ */
+    num_different = 1 + height * (width - 1) - num_same;
+
+    *opaque = ((alpha & 0xFF000000) == 0xFF000000);
+
     /* Return rough approximation of optimality for PNG compression */
     return 0x100 * num_same / num_different - 0x400;
 
@@ -536,12 +543,20 @@ static int __guac_common_surface_png_optimality(guac_common_surface* surface,
  * @param rect
  *     The rectangle to check.
  *
+ * @param congested
+ *     Non-zero if the users receiving the rectangle are congested, such that
+ *     JPEG should be preferred regardless of frame rate.
+ *
+ * @param png_optimality
+ *     The PNG optimality of the rectangle, as returned by
+ *     __guac_common_surface_png_optimality().
+ *
  * @return
  *     Non-zero if the rectangle would be optimally encoded as JPEG, zero
  *     otherwise.
  */
 static int __guac_common_surface_should_use_jpeg(guac_common_surface* surface,
-        const guac_common_rect* rect) {
+        const guac_common_rect* rect, int congested, int png_optimality) {
 
     /* Do not use JPEG if lossless quality is required */
     if (surface->lossless)
@@ -553,12 +568,12 @@ static int __guac_common_surface_should_use_jpeg(guac_common_surface* surface,
     int rect_size = rect->width * rect->height;
 
     /* JPEG is preferred if:
-     * - frame rate is high enough
+     * - frame rate is high enough, or the users are congested
      * - image size is large enough
      * - PNG is not more optimal based on image contents */
-    return framerate >= GUAC_COMMON_SURFACE_JPEG_FRAMERATE
+    return (framerate >= GUAC_COMMON_SURFACE_JPEG_FRAMERATE || congested)
         && rect_size > GUAC_SURFACE_JPEG_MIN_BITMAP_SIZE
-        && __guac_common_surface_png_optimality(surface, rect) < 0;
+        && png_optimality < 0;
 
 }
 
@@ -572,25 +587,30 @@ static int __guac_common_surface_should_use_jpeg(guac_common_surface* surface,
  * @param rect
  *     The rectangle to check.
  *
+ * @param congested
+ *     Non-zero if the users receiving the rectangle are congested, such that
+ *     WebP should be preferred regardless of frame rate.
+ *
+ * @param png_optimality
+ *     The PNG optimality of the rectangle, as returned by
+ *     __guac_common_surface_png_optimality().
+ *
  * @return
  *     Non-zero if the rectangle would be optimally encoded as WebP, zero
- *     otherwise.
+ *     otherwise. Whether the users receiving the rectangle support WebP is
+ *     not considered.
  */
 static int __guac_common_surface_should_use_webp(guac_common_surface* surface,
-        const guac_common_rect* rect) {
-
-    /* Do not use WebP if not supported */
-    if (!guac_client_supports_webp(surface->client))
-        return 0;
+        const guac_common_rect* rect, int congested, int png_optimality) {
 
     /* Calculate the average framerate for the given rect */
     int framerate = __guac_common_surface_calculate_framerate(surface, rect);
 
     /* WebP is preferred if:
-     * - frame rate is high enough
+     * - frame rate is high enough, or the users are congested
      * - PNG is not more optimal based on image contents */
-    return framerate >= GUAC_COMMON_SURFACE_JPEG_FRAMERATE
-        && __guac_common_surface_png_optimality(surface, rect) < 0;
+    return (framerate >= GUAC_COMMON_SURFACE_JPEG_FRAMERATE || congested)
+        && png_optimality < 0;
 
 }
 
@@ -660,27 +680,82 @@ static void __guac_common_surface_touch_rect(guac_common_surface* surface,
 }
 
 /**
- * Flushes the bitmap update currently described by the dirty rectangle within the
- * given surface to that surface's bitmap queue. There MUST be space within the
- * queue.
+ * Marks the given rectangle as changed within each heat map cell that it
+ * intersects, such that the changed area is eventually flushed by
+ * __guac_common_surface_flush(). Each cell accumulates only the bounds of the
+ * changes within its own area, thus distant updates are never combined into a
+ * single larger update unless they are later found to be adjacent.
  *
- * @param surface The surface to flush.
+ * @param surface
+ *     The surface containing the changed rectangle.
+ *
+ * @param rect
+ *     The rectangle which has changed. This rectangle must be within the
+ *     bounds of the surface.
  */
-static void __guac_common_surface_flush_to_queue(guac_common_surface* surface) {
+static void __guac_common_surface_mark_damaged(guac_common_surface* surface,
+        const guac_common_rect* rect) {
 
-    guac_common_surface_bitmap_rect* rect;
+    int x, y;
 
-    /* Do not flush if not dirty */
-    if (!surface->dirty)
+    /* Ignore empty rects */
+    if (rect->width <= 0 || rect->height <= 0)
         return;
 
-    /* Add new rect to queue */
-    rect = &(surface->bitmap_queue[surface->bitmap_queue_length++]);
-    rect->rect = surface->dirty_rect;
-    rect->flushed = 0;
+    /* Calculate heat map dimensions */
+    int heat_width = GUAC_COMMON_SURFACE_HEAT_DIMENSION(surface->width);
 
-    /* Surface now flushed */
-    surface->dirty = 0;
+    /* Calculate minimum X/Y coordinates intersecting given rect */
+    int min_x = rect->x / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE;
+    int min_y = rect->y / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE;
+
+    /* Calculate maximum X/Y coordinates intersecting given rect */
+    int max_x = (rect->x + rect->width  - 1) / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE;
+    int max_y = (rect->y + rect->height - 1) / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE;
+
+    /* Get start of buffer at given coordinates */
+    guac_common_surface_heat_cell* heat_row =
+        surface->heat_map + min_y * heat_width + min_x;
+
+    /* Update all heat map cells which intersect with rectangle */
+    for (y = min_y; y <= max_y; y++) {
+
+        /* Get current row of heat map */
+        guac_common_surface_heat_cell* heat_cell = heat_row;
+
+        /* For each cell in subset of row */
+        for (x = min_x; x <= max_x; x++) {
+
+            /* Restrict changed area to the area of the cell */
+            guac_common_rect cell_rect;
+            guac_common_rect_init(&cell_rect,
+                    x * GUAC_COMMON_SURFACE_HEAT_CELL_SIZE,
+                    y * GUAC_COMMON_SURFACE_HEAT_CELL_SIZE,
+                    GUAC_COMMON_SURFACE_HEAT_CELL_SIZE,
+                    GUAC_COMMON_SURFACE_HEAT_CELL_SIZE);
+
+            guac_common_rect changed = *rect;
+            guac_common_rect_constrain(&changed, &cell_rect);
+
+            /* Add to any existing changes within cell */
+            if (heat_cell->dirty)
+                guac_common_rect_extend(&heat_cell->dirty_rect, &changed);
+            else {
+                heat_cell->dirty_rect = changed;
+                heat_cell->dirty = 1;
+            }
+
+            /* Advance to next heat map cell */
+            heat_cell++;
+
+        }
+
+        /* Next heat map row */
+        heat_row += heat_width;
+
+    }
+
+    surface->damaged = 1;
 
 }
 
@@ -695,9 +770,10 @@ static void __guac_common_surface_flush(guac_common_surface* surface);
 
 /**
  * Schedules a deferred flush of the given surface. This will not immediately
- * flush the surface to the client. Instead, the result of the flush is
- * added to a queue which is reinspected and combined (if possible) with other
- * deferred flushes during the call to guac_common_surface_flush().
+ * flush the surface to the client. Instead, the bitmap update currently
+ * described by the dirty rectangle is recorded within the heat map cells it
+ * intersects, to be combined with adjacent changes (if worthwhile) during
+ * the call to guac_common_surface_flush().
  *
  * @param surface The surface to flush.
  */
@@ -707,98 +783,82 @@ static void __guac_common_surface_flush_deferred(guac_common_surface* surface) {
     if (!surface->dirty)
         return;
 
-    /* Flush if queue size has reached maximum (space is reserved for the final
-     * dirty rect, as __guac_common_surface_flush() MAY add an additional rect
-     * to the queue */
-    if (surface->bitmap_queue_length == GUAC_COMMON_SURFACE_QUEUE_SIZE-1)
-        __guac_common_surface_flush(surface);
+    /* Record dirty rect within heat map */
+    __guac_common_surface_mark_damaged(surface, &surface->dirty_rect);
 
-    /* Append dirty rect to queue */
-    __guac_common_surface_flush_to_queue(surface);
+    /* Surface now flushed */
+    surface->dirty = 0;
 
 }
 
 /**
- * Transfers a single uint32_t using the given transfer function.
+ * Updates the bounds of the pixels changed within a rectangle to include the
+ * given range of changed pixels within a row of that rectangle.
  *
- * @param op The transfer function to use.
- * @param src The source of the uint32_t value.
- * @param dst THe destination which will hold the result of the transfer.
- * @return Non-zero if the destination value was changed, zero otherwise.
+ * @param y
+ *     The row containing the changed pixels, relative to the rectangle.
+ *
+ * @param first
+ *     The first changed pixel within the row, relative to the rectangle.
+ *
+ * @param last
+ *     The last changed pixel within the row, relative to the rectangle.
+ *
+ * @param min_x
+ *     The minimum X coordinate of all changed pixels.
+ *
+ * @param min_y
+ *     The minimum Y coordinate of all changed pixels.
+ *
+ * @param max_x
+ *     The maximum X coordinate of all changed pixels.
+ *
+ * @param max_y
+ *     The maximum Y coordinate of all changed pixels.
  */
-static int __guac_common_surface_transfer_int(guac_transfer_function op, uint32_t* src, uint32_t* dst) {
-
-    uint32_t orig = *dst;
-
-    switch (op) {
-
-        case GUAC_TRANSFER_BINARY_BLACK:
-            *dst = 0xFF000000;
-            break;
-
-        case GUAC_TRANSFER_BINARY_WHITE:
-            *dst = 0xFFFFFFFF;
-            break;
-
-        case GUAC_TRANSFER_BINARY_SRC:
-            *dst = *src;
-            break;
-
-        case GUAC_TRANSFER_BINARY_DEST:
-            /* NOP */
-            break;
-
-        case GUAC_TRANSFER_BINARY_NSRC:
-            *dst = *src ^ 0x00FFFFFF;
-            break;
-
-        case GUAC_TRANSFER_BINARY_NDEST:
-            *dst = *dst ^ 0x00FFFFFF;
-            break;
-
-        case GUAC_TRANSFER_BINARY_AND:
-            *dst = ((*dst) & (0xFF000000 | *src));
-            break;
-
-        case GUAC_TRANSFER_BINARY_NAND:
-            *dst = ((*dst) & (0xFF000000 | *src)) ^ 0x00FFFFFF;
-            break;
-
-        case GUAC_TRANSFER_BINARY_OR:
-            *dst = ((*dst) | (0x00FFFFFF & *src));
-            break;
-
-        case GUAC_TRANSFER_BINARY_NOR:
-            *dst = ((*dst) | (0x00FFFFFF & *src)) ^ 0x00FFFFFF;
-            break;
-
-        case GUAC_TRANSFER_BINARY_XOR:
-            *dst = ((*dst) ^ (0x00FFFFFF & *src));
-            break;
-
-        case GUAC_TRANSFER_BINARY_XNOR:
-            *dst = ((*dst) ^ (0x00FFFFFF & *src)) ^ 0x00FFFFFF;
-            break;
-
-        case GUAC_TRANSFER_BINARY_NSRC_AND:
-            *dst = ((*dst) & (0xFF000000 | (*src ^ 0x00FFFFFF)));
-            break;
+static void __guac_common_surface_track_row(int y, int first, int last,
+        int* min_x, int* min_y, int* max_x, int* max_y) {
 
-        case GUAC_TRANSFER_BINARY_NSRC_NAND:
-            *dst = ((*dst) & (0xFF000000 | (*src ^ 0x00FFFFFF))) ^ 0x00FFFFFF;
-            break;
+    if (first < *min_x) *min_x = first;
+    if (y < *min_y) *min_y = y;
+    if (last > *max_x) *max_x = last;
+    if (y > *max_y) *max_y = y;
 
-        case GUAC_TRANSFER_BINARY_NSRC_OR:
-            *dst = ((*dst) | (0x00FFFFFF & (*src ^ 0x00FFFFFF)));
-            break;
+}
 
-        case GUAC_TRANSFER_BINARY_NSRC_NOR:
-            *dst = ((*dst) | (0x00FFFFFF & (*src ^ 0x00FFFFFF))) ^ 0x00FFFFFF;
-            break;
+/**
+ * Restricts the given rectangle to the given bounds, relative to that
+ * rectangle, of the pixels actually changed within the rectangle. If no
+ * pixels changed, the rectangle becomes empty.
+ *
+ * @param rect
+ *     The rectangle to restrict.
+ *
+ * @param min_x
+ *     The minimum X coordinate of all changed pixels.
+ *
+ * @param min_y
+ *     The minimum Y coordinate of all changed pixels.
+ *
+ * @param max_x
+ *     The maximum X coordinate of all changed pixels.
+ *
+ * @param max_y
+ *     The maximum Y coordinate of all changed pixels.
+ */
+static void __guac_common_surface_restrict_rect(guac_common_rect* rect,
+        int min_x, int min_y, int max_x, int max_y) {
 
+    if (max_x >= min_x && max_y >= min_y) {
+        rect->x += min_x;
+        rect->y += min_y;
+        rect->width = max_x - min_x + 1;
+        rect->height = max_y - min_y + 1;
+    }
+    else {
+        rect->width = 0;
+        rect->height = 0;
     }
-
-    return *dst != orig;
 
 }
 
@@ -832,12 +892,17 @@ static int __guac_common_surface_transfer_int(guac_transfer_function op, uint32_
 static void __guac_common_surface_set(guac_common_surface* dst,
         guac_common_rect* rect, int red, int green, int blue, int alpha) {
 
-    int x, y;
+    const guac_common_pixel_kernels* kernels =
+        guac_common_pixel_get_best_kernels();
+
+    int y;
+    int first, last;
 
     int dst_stride;
     unsigned char* dst_buffer;
 
-    uint32_t color = (alpha << 24) | (red << 16) | (green << 8) | blue;
+    uint32_t color = ((uint32_t) alpha << 24) | (red << 16) | (green << 8)
+                   | blue;
 
     int min_x = rect->width - 1;
     int min_y = rect->height - 1;
@@ -850,23 +915,11 @@ static void __guac_common_surface_set(guac_common_surface* dst,
     /* For each row */
     for (y=0; y < rect->height; y++) {
 
-        uint32_t* dst_current = (uint32_t*) dst_buffer;
-
-        /* Set row */
-        for (x=0; x < rect->width; x++) {
-
-            uint32_t old_color = *dst_current;
-
-            if (old_color != color) {
-                if (x < min_x) min_x = x;
-                if (y < min_y) min_y = y;
-                if (x > max_x) max_x = x;
-                if (y > max_y) max_y = y;
-                *dst_current = color;
-            }
-
-            dst_current++;
-        }
+        /* Set row, noting which pixels changed */
+        if (kernels->set((uint32_t*) dst_buffer, NULL, rect->width, color,
+                    &first, &last))
+            __guac_common_surface_track_row(y, first, last,
+                    &min_x, &min_y, &max_x, &max_y);
 
         /* Next row */
         dst_buffer += dst_stride;
@@ -874,93 +927,7 @@ static void __guac_common_surface_set(guac_common_surface* dst,
     }
 
     /* Restrict destination rect to only updated pixels */
-    if (max_x >= min_x && max_y >= min_y) {
-        rect->x += min_x;
-        rect->y += min_y;
-        rect->width = max_x - min_x + 1;
-        rect->height = max_y - min_y + 1;
-    }
-    else {
-        rect->width = 0;
-        rect->height = 0;
-    }
-
-}
-
-/**
- * Applies the Porter-Duff "over" composite operator, blending the two given
- * color components using the given alpha value.
- *
- * @param dst
- *     The destination color component.
- *
- * @param src
- *     The source color component.
- *
- * @param alpha
- *     The alpha value which applies to the blending operation.
- *
- * @return
- *     The result of applying the Porter-Duff "over" composite operator to the
- *     given source and destination components.
- */
-static int guac_common_surface_blend_component(int dst, int src, int alpha) {
-
-    int blended = src + dst * (0xFF - alpha);
-
-    /* Do not exceed maximum component value */
-    if (blended > 0xFF)
-        return 0xFF;
-
-    return blended;
-
-}
-
-/**
- * Applies the Porter-Duff "over" composite operator, blending each component
- * of the two given ARGB colors.
- *
- * @param dst
- *     The destination ARGB color.
- *
- * @param src
- *     The source ARGB color.
- *
- * @return
- *     The result of applying the Porter-Duff "over" composite operator to the
- *     given source and destination colors.
- */
-static uint32_t guac_common_surface_argb_blend(uint32_t dst, uint32_t src) {
-
-    /* Separate destination ARGB color into its components */
-    int dst_a = (dst >> 24) & 0xFF;
-    int dst_r = (dst >> 16) & 0xFF;
-    int dst_g = (dst >>  8) & 0xFF;
-    int dst_b =  dst        & 0xFF;
-
-    /* Separate source ARGB color into its components */
-    int src_a = (src >> 24) & 0xFF;
-    int src_r = (src >> 16) & 0xFF;
-    int src_g = (src >>  8) & 0xFF;
-    int src_b =  src        & 0xFF;
-
-    /* If source is fully opaque (or destination is fully transparent), the
-     * blended result is the source */
-    if (src_a == 0xFF || dst_a == 0x00)
-        return src;
-
-    /* If source is fully transparent, the blended result is the destination */
-    if (src_a == 0x00)
-        return dst;
-
-    /* Otherwise, blend each ARGB component, assuming pre-multiplied alpha */
-    int r = guac_common_surface_blend_component(dst_r, src_r, src_a);
-    int g = guac_common_surface_blend_component(dst_g, src_g, src_a);
-    int b = guac_common_surface_blend_component(dst_b, src_b, src_a);
-    int a = guac_common_surface_blend_component(dst_a, src_a, src_a);
-
-    /* Recombine blended components */
-    return (a << 24) | (r << 16) | (g << 8) | b;
+    __guac_common_surface_restrict_rect(rect, min_x, min_y, max_x, max_y);
 
 }
 
@@ -983,10 +950,19 @@ static void __guac_common_surface_put(unsigned char* src_buffer, int src_stride,
                                       guac_common_surface* dst, guac_common_rect* rect,
                                       int opaque) {
 
+    const guac_common_pixel_kernels* kernels =
+        guac_common_pixel_get_best_kernels();
+
+    /* Ignore alpha channel if opaque, otherwise perform alpha blending */
+    guac_common_pixel_row_kernel* put = opaque
+                                      ? kernels->copy_opaque
+                                      : kernels->blend;
+
     unsigned char* dst_buffer = dst->buffer;
     int dst_stride = dst->stride;
 
-    int x, y;
+    int y;
+    int first, last;
 
     int min_x = rect->width;
     int min_y = rect->height;
@@ -1002,41 +978,11 @@ static void __guac_common_surface_put(unsigned char* src_buffer, int src_stride,
     /* For each row */
     for (y=0; y < rect->height; y++) {
 
-        uint32_t* src_current = (uint32_t*) src_buffer;
-        uint32_t* dst_current = (uint32_t*) dst_buffer;
-
-        /* Copy row */
-        for (x=0; x < rect->width; x++) {
-
-            uint32_t color;
-
-            /* Get source and destination color values */
-            uint32_t src_color = *src_current;
-            uint32_t dst_color = *dst_current;
-
-            /* Ignore alpha channel if opaque */
-            if (opaque)
-                color = src_color | 0xFF000000;
-
-            /* Otherwise, perform alpha blending operation */
-            else
-                color = guac_common_surface_argb_blend(dst_color, src_color);
-
-            /* If the destination color is changing, update rectangle bounds
-             * and store the new color */
-            if (dst_color != color) {
-                if (x < min_x) min_x = x;
-                if (y < min_y) min_y = y;
-                if (x > max_x) max_x = x;
-                if (y > max_y) max_y = y;
-                *dst_current = color;
-            }
-
-            /* Advance to next pixel */
-            src_current++;
-            dst_current++;
-
-        }
+        /* Copy row, noting which pixels changed */
+        if (put((uint32_t*) dst_buffer, (uint32_t*) src_buffer, rect->width,
+                    0, &first, &last))
+            __guac_common_surface_track_row(y, first, last,
+                    &min_x, &min_y, &max_x, &max_y);
 
         /* Next row */
         src_buffer += src_stride;
@@ -1045,16 +991,7 @@ static void __guac_common_surface_put(unsigned char* src_buffer, int src_stride,
     }
 
     /* Restrict destination rect to only updated pixels */
-    if (max_x >= min_x && max_y >= min_y) {
-        rect->x += min_x;
-        rect->y += min_y;
-        rect->width = max_x - min_x + 1;
-        rect->height = max_y - min_y + 1;
-    }
-    else {
-        rect->width = 0;
-        rect->height = 0;
-    }
+    __guac_common_surface_restrict_rect(rect, min_x, min_y, max_x, max_y);
 
     /* Update source X/Y */
     *sx += rect->x - orig_x;
@@ -1085,8 +1022,11 @@ static void __guac_common_surface_fill_mask(unsigned char* src_buffer, int src_s
     unsigned char* dst_buffer = dst->buffer;
     int dst_stride = dst->stride;
 
+    const guac_common_pixel_kernels* kernels =
+        guac_common_pixel_get_best_kernels();
+
     uint32_t color = 0xFF000000 | (red << 16) | (green << 8) | blue;
-    int x, y;
+    int y;
 
     src_buffer += src_stride*sy + 4*sx;
     dst_buffer += (dst_stride * rect->y) + (4 * rect->x);
@@ -1094,19 +1034,9 @@ static void __guac_common_surface_fill_mask(unsigned char* src_buffer, int src_s
     /* For each row */
     for (y=0; y < rect->height; y++) {
 
-        uint32_t* src_current = (uint32_t*) src_buffer;
-        uint32_t* dst_current = (uint32_t*) dst_buffer;
-
         /* Stencil row */
-        for (x=0; x < rect->width; x++) {
-
-            /* Fill with color if opaque */
-            if (*src_current & 0xFF000000)
-                *dst_current = color;
-
-            src_current++;
-            dst_current++;
-        }
+        kernels->fill_mask((uint32_t*) dst_buffer, (uint32_t*) src_buffer,
+                rect->width, color);
 
         /* Next row */
         src_buffer += src_stride;
@@ -1132,12 +1062,17 @@ static void __guac_common_surface_transfer(guac_common_surface* src, int* sx, in
                                            guac_transfer_function op,
                                            guac_common_surface* dst, guac_common_rect* rect) {
 
+    const guac_common_pixel_kernels* kernels =
+        guac_common_pixel_get_best_kernels();
+
+    guac_common_pixel_row_kernel* transfer;
+
     unsigned char* src_buffer = src->buffer;
     unsigned char* dst_buffer = dst->buffer;
 
-    int x, y;
+    int y, row;
+    int first, last;
     int src_stride, dst_stride;
-    int step = 1;
 
     int min_x = rect->width - 1;
     int min_y = rect->height - 1;
@@ -1147,75 +1082,45 @@ static void __guac_common_surface_transfer(guac_common_surface* src, int* sx, in
     int orig_x = rect->x;
     int orig_y = rect->y;
 
+    src_buffer += src->stride * (*sy) + 4 * (*sx);
+    dst_buffer += (dst->stride * rect->y) + (4 * rect->x);
+
     /* Copy forwards only if destination is in a different surface or is before source */
     if (src != dst || rect->y < *sy || (rect->y == *sy && rect->x < *sx)) {
-        src_buffer += src->stride * (*sy) + 4 * (*sx);
-        dst_buffer += (dst->stride * rect->y) + (4 * rect->x);
         src_stride = src->stride;
         dst_stride = dst->stride;
-        step = 1;
+        transfer = kernels->transfer;
+        row = 0;
     }
 
     /* Otherwise, copy backwards */
     else {
-        src_buffer += src->stride * (*sy + rect->height - 1) + 4 * (*sx + rect->width - 1);
-        dst_buffer += dst->stride * (rect->y + rect->height - 1) + 4 * (rect->x + rect->width - 1);
+        src_buffer += src->stride * (rect->height - 1);
+        dst_buffer += dst->stride * (rect->height - 1);
         src_stride = -src->stride;
         dst_stride = -dst->stride;
-        step = -1;
+        transfer = kernels->transfer_reverse;
+        row = rect->height - 1;
     }
 
     /* For each row */
     for (y=0; y < rect->height; y++) {
 
-        uint32_t* src_current = (uint32_t*) src_buffer;
-        uint32_t* dst_current = (uint32_t*) dst_buffer;
-
-        /* Transfer each pixel in row */
-        for (x=0; x < rect->width; x++) {
-
-            if (__guac_common_surface_transfer_int(op, src_current, dst_current)) {
-                if (x < min_x) min_x = x;
-                if (y < min_y) min_y = y;
-                if (x > max_x) max_x = x;
-                if (y > max_y) max_y = y;
-            }
-
-            src_current += step;
-            dst_current += step;
-        }
+        /* Transfer each pixel in row, noting which pixels changed */
+        if (transfer((uint32_t*) dst_buffer, (uint32_t*) src_buffer,
+                    rect->width, op, &first, &last))
+            __guac_common_surface_track_row(row, first, last,
+                    &min_x, &min_y, &max_x, &max_y);
 
         /* Next row */
         src_buffer += src_stride;
         dst_buffer += dst_stride;
+        row += (dst_stride < 0) ? -1 : 1;
 
     }
 
-    /* Translate X coordinate space of moving backwards */
-    if (step < 0) {
-        int old_max_x = max_x;
-        max_x = rect->width - 1 - min_x;
-        min_x = rect->width - 1 - old_max_x;
-    }
-
-    /* Translate Y coordinate space of moving backwards */
-    if (dst_stride < 0) {
-        int old_max_y = max_y;
-        max_y = rect->height - 1 - min_y;
-        min_y = rect->height - 1 - old_max_y;
-    }
-
     /* Restrict destination rect to only updated pixels */
-    if (max_x >= min_x && max_y >= min_y) {
-        rect->x += min_x;
-        rect->y += min_y;
-        rect->width = max_x - min_x + 1;
-        rect->height = max_y - min_y + 1;
-    }
-    else {
-        rect->width = 0;
-        rect->height = 0;
-    }
+    __guac_common_surface_restrict_rect(rect, min_x, min_y, max_x, max_y);
 
     /* Update source X/Y */
     *sx += rect->x - orig_x;
@@ -1229,6 +1134,7 @@ guac_common_surface* guac_common_surface_alloc(guac_client* client,
     /* Calculate heat map dimensions */
     int heat_width = GUAC_COMMON_SURFACE_HEAT_DIMENSION(w);
     int heat_height = GUAC_COMMON_SURFACE_HEAT_DIMENSION(h);
+    int i;
 
     /* Init surface */
     guac_common_surface* surface = calloc(1, sizeof(guac_common_surface));
@@ -1242,6 +1148,12 @@ guac_common_surface* guac_common_surface_alloc(guac_client* client,
 
     pthread_mutex_init(&surface->_lock, NULL);
 
+    /* Init filter data for each possible group of tiers */
+    for (i = 0; i < (1 << GUAC_COMMON_SURFACE_MAX_TIERS); i++) {
+        surface->tier_groups[i].surface = surface;
+        surface->tier_groups[i].tiers = i;
+    }
+
     /* Create corresponding Cairo surface */
     surface->stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, w);
     surface->buffer = calloc(h, surface->stride);
@@ -1274,6 +1186,7 @@ void guac_common_surface_free(guac_common_surface* surface) {
 
     pthread_mutex_destroy(&surface->_lock);
 
+    free(surface->tier_users);
     free(surface->heat_map);
     free(surface->buffer);
     free(surface);
@@ -1301,6 +1214,9 @@ void guac_common_surface_resize(guac_common_surface* surface, int w, int h) {
     /* Calculate heat map dimensions */
     int heat_width = GUAC_COMMON_SURFACE_HEAT_DIMENSION(w);
     int heat_height = GUAC_COMMON_SURFACE_HEAT_DIMENSION(h);
+    int old_heat_width = GUAC_COMMON_SURFACE_HEAT_DIMENSION(surface->width);
+    int old_heat_height = GUAC_COMMON_SURFACE_HEAT_DIMENSION(surface->height);
+    int i;
 
     /* Copy old surface data */
     old_buffer = surface->buffer;
@@ -1322,10 +1238,27 @@ void guac_common_surface_resize(guac_common_surface* surface, int w, int h) {
     free(old_buffer);
 
     /* Allocate completely new heat map (can safely discard old stats) */
-    free(surface->heat_map);
+    guac_common_surface_heat_cell* old_heat_map = surface->heat_map;
     surface->heat_map = calloc(heat_width * heat_height,
             sizeof(guac_common_surface_heat_cell));
 
+    /* Retain any changes not yet flushed which remain within bounds */
+    if (surface->damaged) {
+
+        surface->damaged = 0;
+
+        for (i = 0; i < old_heat_width * old_heat_height; i++) {
+            if (old_heat_map[i].dirty) {
+                guac_common_rect changed = old_heat_map[i].dirty_rect;
+                __guac_common_bound_rect(surface, &changed, NULL, NULL);
+                __guac_common_surface_mark_damaged(surface, &changed);
+            }
+        }
+
+    }
+
+    free(old_heat_map);
+
     /* Resize dirty rect to fit new surface dimensions */
     if (surface->dirty) {
         __guac_common_bound_rect(surface, &surface->dirty_rect, NULL, NULL);
@@ -1342,6 +1275,307 @@ complete:
 
 }
 
+/**
+ * Searches for the offset at which the longest contiguous run of new rows (or
+ * columns) matches old rows (or columns), given the hashes of each. An offset
+ * of d indicates that new row i matches old row i + d.
+ *
+ * @param old_hashes
+ *     The hashes of each row or column of existing content.
+ *
+ * @param new_hashes
+ *     The hashes of each row or column of new content.
+ *
+ * @param length
+ *     The number of rows or columns.
+ *
+ * @param offset
+ *     Pointer to an int which will receive the offset of the longest run
+ *     found, if any.
+ *
+ * @param start
+ *     Pointer to an int which will receive the index of the first new row or
+ *     column within the longest run found, if any.
+ *
+ * @return
+ *     The length of the longest run found, or zero if no run of at least
+ *     GUAC_SURFACE_SCROLL_MIN_RUN rows or columns was found at any non-zero
+ *     offset.
+ */
+static int __guac_common_surface_find_shift(const uint32_t* old_hashes,
+        const uint32_t* new_hashes, int length, int* offset, int* start) {
+
+    int best_length = 0;
+    int anchor, j;
+
+    for (anchor = 0; anchor < GUAC_SURFACE_SCROLL_ANCHORS; anchor++) {
+
+        /* Space anchors evenly, ignoring anchors within uniform areas, which
+         * match everything */
+        int a = (2 * anchor + 1) * length / (2 * GUAC_SURFACE_SCROLL_ANCHORS);
+        if (a > 0 && new_hashes[a] == new_hashes[a - 1])
+            continue;
+
+        int candidates = 0;
+        for (j = 0; j < length && candidates < GUAC_SURFACE_SCROLL_CANDIDATES;
+                j++) {
+
+            int d = j - a;
+
+            /* Only consider actual shifts of matching content */
+            if (d == 0 || old_hashes[j] != new_hashes[a])
+                continue;
+
+            candidates++;
+
+            /* Find extent of matching run containing anchor */
+            int first = a;
+            while (first > 0 && first + d > 0
+                    && new_hashes[first - 1] == old_hashes[first - 1 + d])
+                first--;
+
+            int last = a;
+            while (last + 1 < length && last + 1 + d < length
+                    && new_hashes[last + 1] == old_hashes[last + 1 + d])
+                last++;
+
+            if (last - first + 1 > best_length) {
+                best_length = last - first + 1;
+                *offset = d;
+                *start = first;
+            }
+
+        }
+
+    }
+
+    /* Ignore runs which are too short to be worthwhile, including runs which
+     * would not reduce the area sent by at least half */
+    if (best_length < GUAC_SURFACE_SCROLL_MIN_RUN || best_length * 2 < length)
+        return 0;
+
+    return best_length;
+
+}
+
+/**
+ * Tests whether either of the two middle rows (or columns) of new content
+ * matches any row (or column) of existing content at a non-zero offset. Any
+ * run long enough to be found by __guac_common_surface_find_shift() must
+ * contain one of these two lines, so if neither matches, the new content
+ * cannot be shifted existing content and need not be hashed. Comparisons
+ * stop at the first differing pixel.
+ *
+ * @param new_buffer
+ *     The first pixel of the first row or column of new content.
+ *
+ * @param old_buffer
+ *     The first pixel of the first row or column of existing content.
+ *
+ * @param new_line_step
+ *     The number of bytes between consecutive rows or columns of new content.
+ *
+ * @param old_line_step
+ *     The number of bytes between consecutive rows or columns of existing
+ *     content.
+ *
+ * @param new_pixel_step
+ *     The number of bytes between consecutive pixels within each row or
+ *     column of new content.
+ *
+ * @param old_pixel_step
+ *     The number of bytes between consecutive pixels within each row or
+ *     column of existing content.
+ *
+ * @param length
+ *     The number of rows or columns.
+ *
+ * @param count
+ *     The number of pixels within each row or column.
+ *
+ * @return
+ *     Non-zero if either middle line matches existing content at a non-zero
+ *     offset, zero otherwise.
+ */
+static int __guac_common_surface_sample_shift(const unsigned char* new_buffer,
+        const unsigned char* old_buffer, int new_line_step, int old_line_step,
+        int new_pixel_step, int old_pixel_step, int length, int count) {
+
+    int i, j, k;
+
+    for (j = 0; j < length; j++) {
+
+        const unsigned char* old_line = old_buffer + old_line_step * j;
+
+        for (i = length / 2 - 1; i <= length / 2; i++) {
+
+            /* Only actual shifts are of interest */
+            if (i == j)
+                continue;
+
+            const unsigned char* new_line = new_buffer + new_line_step * i;
+
+            for (k = 0; k < count; k++) {
+                uint32_t old_color =
+                    *((const uint32_t*) (old_line + old_pixel_step * k));
+                uint32_t new_color =
+                    *((const uint32_t*) (new_line + new_pixel_step * k));
+                if (old_color != (new_color | 0xFF000000))
+                    break;
+            }
+
+            if (k == count)
+                return 1;
+
+        }
+
+    }
+
+    return 0;
+
+}
+
+/**
+ * Tests whether the given opaque image data, about to be drawn at the given
+ * rectangle, is largely a vertical or horizontal shift of the content already
+ * present within that rectangle, as occurs when scrolling. If so, the shifted
+ * content is copied within the layer of the surface, and within the surface
+ * itself, such that only the newly-exposed content differs and will be sent
+ * as image data when drawn. Any pending updates are flushed prior to copying
+ * to ensure the remote layer matches the surface.
+ *
+ * @param surface
+ *     The surface being drawn to.
+ *
+ * @param src_buffer
+ *     The image data being drawn.
+ *
+ * @param src_stride
+ *     The number of bytes in each row of image data.
+ *
+ * @param sx
+ *     The X coordinate of the upper-left corner of the relevant region of the
+ *     image data.
+ *
+ * @param sy
+ *     The Y coordinate of the upper-left corner of the relevant region of the
+ *     image data.
+ *
+ * @param rect
+ *     The destination rectangle within the surface, already clipped.
+ */
+static void __guac_common_surface_shift(guac_common_surface* surface,
+        unsigned char* src_buffer, int src_stride, int sx, int sy,
+        const guac_common_rect* rect) {
+
+    int x, y;
+    int offset, start, length;
+
+    int width = rect->width;
+    int height = rect->height;
+
+    /* Only large updates are likely to be scrolled content */
+    if (width < GUAC_SURFACE_SCROLL_MIN_SIZE
+            || height < GUAC_SURFACE_SCROLL_MIN_SIZE
+            || width * height < GUAC_SURFACE_SCROLL_MIN_AREA)
+        return;
+
+    src_buffer += src_stride * sy + 4 * sx;
+    unsigned char* dst_buffer = surface->buffer
+                              + surface->stride * rect->y + 4 * rect->x;
+
+    /* Give up unless a sample of the new content appears elsewhere within
+     * the existing content */
+    int vertical = __guac_common_surface_sample_shift(src_buffer, dst_buffer,
+            src_stride, surface->stride, 4, 4, height, width);
+
+    int horizontal = __guac_common_surface_sample_shift(src_buffer,
+            dst_buffer, 4, 4, src_stride, surface->stride, width, height);
+
+    if (!vertical && !horizontal)
+        return;
+
+    uint32_t* old_rows = malloc(sizeof(uint32_t) * height);
+    uint32_t* new_rows = malloc(sizeof(uint32_t) * height);
+    uint32_t* old_cols = malloc(sizeof(uint32_t) * width);
+    uint32_t* new_cols = malloc(sizeof(uint32_t) * width);
+
+    for (x = 0; x < width; x++)
+        old_cols[x] = new_cols[x] = 2166136261u;
+
+    /* Hash each row and column of old and new content (FNV-1a over pixels,
+     * using the colors the new content will have once stored) */
+    for (y = 0; y < height; y++) {
+
+        uint32_t* src_current = (uint32_t*) (src_buffer + src_stride * y);
+        uint32_t* dst_current = (uint32_t*) (dst_buffer + surface->stride * y);
+
+        uint32_t old_row = 2166136261u;
+        uint32_t new_row = 2166136261u;
+
+        for (x = 0; x < width; x++) {
+
+            uint32_t old_color = dst_current[x];
+            uint32_t new_color = src_current[x] | 0xFF000000;
+
+            old_row = (old_row ^ old_color) * 16777619u;
+            new_row = (new_row ^ new_color) * 16777619u;
+            old_cols[x] = (old_cols[x] ^ old_color) * 16777619u;
+            new_cols[x] = (new_cols[x] ^ new_color) * 16777619u;
+
+        }
+
+        old_rows[y] = old_row;
+        new_rows[y] = new_row;
+
+    }
+
+    /* Vertical scrolling */
+    if (vertical && (length = __guac_common_surface_find_shift(old_rows,
+                    new_rows, height, &offset, &start)) != 0) {
+
+        /* Ensure remote layer matches surface before copying */
+        __guac_common_surface_flush(surface);
+
+        guac_protocol_send_copy(surface->socket, surface->layer,
+                rect->x, rect->y + start + offset, width, length,
+                GUAC_COMP_SRC, surface->layer, rect->x, rect->y + start);
+
+        /* Copy rows in an order which does not overwrite rows not yet
+         * copied */
+        for (y = 0; y < length; y++) {
+            int row = offset > 0 ? start + y : start + length - 1 - y;
+            memcpy(dst_buffer + surface->stride * row,
+                    dst_buffer + surface->stride * (row + offset), width * 4);
+        }
+
+    }
+
+    /* Horizontal scrolling */
+    else if (horizontal && (length = __guac_common_surface_find_shift(
+                    old_cols, new_cols, width, &offset, &start)) != 0) {
+
+        /* Ensure remote layer matches surface before copying */
+        __guac_common_surface_flush(surface);
+
+        guac_protocol_send_copy(surface->socket, surface->layer,
+                rect->x + start + offset, rect->y, length, height,
+                GUAC_COMP_SRC, surface->layer, rect->x + start, rect->y);
+
+        for (y = 0; y < height; y++) {
+            unsigned char* row = dst_buffer + surface->stride * y;
+            memmove(row + 4 * start, row + 4 * (start + offset), length * 4);
+        }
+
+    }
+
+    free(old_rows);
+    free(new_rows);
+    free(old_cols);
+    free(new_cols);
+
+}
+
 void guac_common_surface_draw(guac_common_surface* surface, int x, int y, cairo_surface_t* src) {
 
     pthread_mutex_lock(&surface->_lock);
@@ -1363,6 +1597,11 @@ void guac_common_surface_draw(guac_common_surface* surface, int x, int y, cairo_
     if (rect.width <= 0 || rect.height <= 0)
         goto complete;
 
+    /* Reuse existing content if the update merely shifts that content, such
+     * that only newly-exposed content differs */
+    if (format != CAIRO_FORMAT_ARGB32)
+        __guac_common_surface_shift(surface, buffer, stride, sx, sy, &rect);
+
     /* Update backing surface */
     __guac_common_surface_put(buffer, stride, &sx, &sy, surface, &rect, format != CAIRO_FORMAT_ARGB32);
     if (rect.width <= 0 || rect.height <= 0)
@@ -1420,8 +1659,42 @@ complete:
 
 }
 
-void guac_common_surface_copy(guac_common_surface* src, int sx, int sy,
-        int w, int h, guac_common_surface* dst, int dx, int dy) {
+/**
+ * Copies a rectangle of data between two surfaces, optionally allowing the
+ * copy to be deferred and combined with other pending updates to the
+ * destination surface.
+ *
+ * @param src
+ *     The source surface.
+ *
+ * @param sx
+ *     The X coordinate of the upper-left corner of the source rect.
+ *
+ * @param sy
+ *     The Y coordinate of the upper-left corner of the source rect.
+ *
+ * @param w
+ *     The width of the source rect.
+ *
+ * @param h
+ *     The height of the source rect.
+ *
+ * @param dst
+ *     The destination surface.
+ *
+ * @param dx
+ *     The X coordinate of the upper-left corner of the destination rect.
+ *
+ * @param dy
+ *     The Y coordinate of the upper-left corner of the destination rect.
+ *
+ * @param combine
+ *     Non-zero if the copy may be combined with pending updates and later
+ *     sent as image data, zero if a "copy" instruction must always be sent.
+ */
+static void __guac_common_surface_copy(guac_common_surface* src, int sx,
+        int sy, int w, int h, guac_common_surface* dst, int dx, int dy,
+        int combine) {
 
     /* Lock both surfaces */
     pthread_mutex_lock(&dst->_lock);
@@ -1461,7 +1734,7 @@ void guac_common_surface_copy(guac_common_surface* src, int sx, int sy,
     }
 
     /* Defer if combining */
-    if (__guac_common_should_combine(dst, &drect, 1))
+    if (combine && __guac_common_should_combine(dst, &drect, 1))
         __guac_common_mark_dirty(dst, &drect);
 
     /* Otherwise, flush and draw immediately */
@@ -1488,6 +1761,16 @@ complete:
 
 }
 
+void guac_common_surface_copy(guac_common_surface* src, int sx, int sy,
+        int w, int h, guac_common_surface* dst, int dx, int dy) {
+    __guac_common_surface_copy(src, sx, sy, w, h, dst, dx, dy, 1);
+}
+
+void guac_common_surface_copy_direct(guac_common_surface* src, int sx,
+        int sy, int w, int h, guac_common_surface* dst, int dx, int dy) {
+    __guac_common_surface_copy(src, sx, sy, w, h, dst, dx, dy, 0);
+}
+
 void guac_common_surface_transfer(guac_common_surface* src, int sx, int sy, int w, int h,
                                   guac_transfer_function op, guac_common_surface* dst, int dx, int dy) {
 
@@ -1628,6 +1911,320 @@ void guac_common_surface_reset_clip(guac_common_surface* surface) {
     pthread_mutex_unlock(&surface->_lock);
 }
 
+/**
+ * Returns the entry of the tier assignment hash table of the given surface
+ * which holds the given user, or the unused entry where that user would be
+ * stored if not present. The hash table MUST contain at least one unused
+ * entry.
+ *
+ * @param surface
+ *     The surface whose tier assignments should be searched.
+ *
+ * @param user
+ *     The user to locate.
+ *
+ * @return
+ *     The entry holding the given user, or the unused entry where that user
+ *     would be stored.
+ */
+static guac_common_surface_tier_user* __guac_common_surface_find_tier_user(
+        guac_common_surface* surface, guac_user* user) {
+
+    unsigned int mask = surface->tier_users_size - 1;
+    unsigned int slot = (unsigned int) (((uintptr_t) user >> 4)
+            * 2654435761u) & mask;
+
+    guac_common_surface_tier_user* entry;
+    while ((entry = &surface->tier_users[slot])->user != NULL
+            && entry->user != user)
+        slot = (slot + 1) & mask;
+
+    return entry;
+
+}
+
+/**
+ * Records the tier assigned to the given user within the tier assignment hash
+ * table of the given surface, growing that table as necessary.
+ *
+ * @param surface
+ *     The surface whose tier assignments should be updated.
+ *
+ * @param user
+ *     The user being assigned a tier.
+ *
+ * @param tier
+ *     The index of the tier assigned to the user.
+ */
+static void __guac_common_surface_set_tier_user(guac_common_surface* surface,
+        guac_user* user, int tier) {
+
+    /* Keep the table at most half full, rehashing into a larger table as
+     * necessary */
+    if ((surface->tier_user_count + 1) * 2 > surface->tier_users_size) {
+
+        guac_common_surface_tier_user* old_users = surface->tier_users;
+        int old_size = surface->tier_users_size;
+        int new_size = old_size ? old_size * 2 : 16;
+
+        guac_common_surface_tier_user* new_users =
+            calloc(new_size, sizeof(guac_common_surface_tier_user));
+
+        /* Users which cannot be stored receive the first tier */
+        if (new_users == NULL)
+            return;
+
+        surface->tier_users = new_users;
+        surface->tier_users_size = new_size;
+
+        int i;
+        for (i = 0; i < old_size; i++) {
+            if (old_users[i].user != NULL)
+                *__guac_common_surface_find_tier_user(surface,
+                        old_users[i].user) = old_users[i];
+        }
+
+        free(old_users);
+
+    }
+
+    guac_common_surface_tier_user* entry =
+        __guac_common_surface_find_tier_user(surface, user);
+
+    if (entry->user == NULL)
+        surface->tier_user_count++;
+
+    entry->user = user;
+    entry->tier = tier;
+
+}
+
+/**
+ * Filter which accepts only those users assigned to the tiers of a particular
+ * guac_common_surface_tier_group. Users which were not assigned a tier at the
+ * start of the current flush are treated as belonging to the first tier. If
+ * the data is not destined for a user (such as a session recording), it is
+ * accepted only for the group whose encoding is to be recorded.
+ *
+ * @param user
+ *     The user to test, or NULL if the data is not destined for a user.
+ *
+ * @param data
+ *     The guac_common_surface_tier_group whose users should be accepted.
+ *
+ * @return
+ *     Non-zero if the given user belongs to one of the tiers of the group,
+ *     zero otherwise.
+ */
+static int __guac_common_surface_tier_filter(guac_user* user, void* data) {
+
+    guac_common_surface_tier_group* group =
+        (guac_common_surface_tier_group*) data;
+
+    guac_common_surface* surface = group->surface;
+
+    if (user == NULL)
+        return group->tiers == surface->recorded_tiers;
+
+    /* Look up tier assigned to user */
+    int tier = 0;
+    if (surface->tier_users_size > 0) {
+        guac_common_surface_tier_user* entry =
+            __guac_common_surface_find_tier_user(surface, user);
+        if (entry->user != NULL)
+            tier = entry->tier;
+    }
+
+    return (group->tiers >> tier) & 1;
+
+}
+
+/**
+ * Rounds the given lossy quality down to the granularity defined by
+ * GUAC_COMMON_SURFACE_QUALITY_STEP, relative to the lowest quality which may
+ * be recommended for any user.
+ *
+ * @param quality
+ *     The quality to round.
+ *
+ * @return
+ *     The rounded quality.
+ */
+static int __guac_common_surface_round_quality(int quality) {
+
+    int offset = quality - GUAC_CONGESTION_MIN_QUALITY;
+    if (offset < 0)
+        return GUAC_CONGESTION_MIN_QUALITY;
+
+    return GUAC_CONGESTION_MIN_QUALITY + offset
+        - offset % GUAC_COMMON_SURFACE_QUALITY_STEP;
+
+}
+
+/**
+ * Callback which is invoked by guac_client_foreach_user() to assign the given
+ * user to the tier matching its capabilities and current network conditions.
+ * If no such tier exists, a new tier is created. If the maximum number of
+ * tiers already exist, the user is assigned to the first tier, which is
+ * acceptable to all users.
+ *
+ * @param user
+ *     The user to assign to a tier.
+ *
+ * @param data
+ *     The guac_common_surface whose tiers are being built.
+ *
+ * @return
+ *     Always NULL.
+ */
+static void* __guac_common_surface_assign_tier(guac_user* user, void* data) {
+
+    guac_common_surface* surface = (guac_common_surface*) data;
+    guac_timestamp now = guac_timestamp_current();
+    int i;
+
+    guac_common_surface_tier tier = {
+        .webp = guac_user_supports_webp(user),
+        .quality = __guac_common_surface_round_quality(
+                guac_congestion_get_quality(user->congestion, now)),
+        .congested = guac_congestion_is_congested(user->congestion, now)
+    };
+
+    /* Find matching tier, if any */
+    for (i = 0; i < surface->tier_count; i++) {
+        guac_common_surface_tier* current = &surface->tiers[i];
+        if (current->webp == tier.webp && current->quality == tier.quality
+                && current->congested == tier.congested)
+            break;
+    }
+
+    /* Create new tier if possible, otherwise fall back to the first tier */
+    if (i == surface->tier_count) {
+        if (surface->tier_count < GUAC_COMMON_SURFACE_MAX_TIERS)
+            surface->tiers[surface->tier_count++] = tier;
+        else
+            i = 0;
+    }
+
+    surface->tiers[i].users++;
+
+    __guac_common_surface_set_tier_user(surface, user, i);
+
+    return NULL;
+
+}
+
+/**
+ * Divides all users of the given surface into tiers of users which may
+ * receive identical encodings of the same image data. The first tier is the
+ * lowest common denominator of all users, such that its encodings are
+ * acceptable to any user, including any users which join during the flush.
+ *
+ * @param surface
+ *     The surface whose users should be divided into tiers.
+ */
+static void __guac_common_surface_update_tiers(guac_common_surface* surface) {
+
+    guac_client* client = surface->client;
+    guac_common_surface_tier* common = &surface->tiers[0];
+
+    common->webp = guac_client_supports_webp(client);
+    common->quality = __guac_common_surface_round_quality(
+            guac_client_get_lossy_quality(client));
+    common->congested = guac_client_is_congested(client);
+    common->users = 0;
+
+    surface->tier_count = 1;
+
+    /* Forget the tiers assigned by any previous flush */
+    if (surface->tier_user_count > 0) {
+        memset(surface->tier_users, 0, sizeof(guac_common_surface_tier_user)
+                * surface->tier_users_size);
+        surface->tier_user_count = 0;
+    }
+
+    guac_client_foreach_user(client, __guac_common_surface_assign_tier,
+            surface);
+
+}
+
+/**
+ * Sends the given image to the layer of the given surface via an "img"
+ * instruction. If a flush of the surface is in progress using an encoder, the
+ * image is submitted to the current batch of that encoder, and will be sent
+ * in order once the batch ends. Otherwise, the image is encoded and sent
+ * immediately.
+ *
+ * @param surface
+ *     The surface whose layer should receive the image.
+ *
+ * @param format
+ *     The format to encode the image as.
+ *
+ * @param x
+ *     The X coordinate of the upper-left corner of the destination rectangle.
+ *
+ * @param y
+ *     The Y coordinate of the upper-left corner of the destination rectangle.
+ *
+ * @param image
+ *     The image to send, which will be destroyed by this function or by the
+ *     encoder once encoding is complete.
+ *
+ * @param quality
+ *     The quality to use for lossy formats, between 0 and 100 inclusive.
+ *
+ * @param lossless
+ *     Non-zero if WebP images should be encoded losslessly, zero otherwise.
+ *
+ * @param group
+ *     The group of tiers whose users should receive the image, or NULL if all
+ *     users should receive the image.
+ */
+static void __guac_common_surface_send_image(guac_common_surface* surface,
+        guac_common_encoder_format format, int x, int y,
+        cairo_surface_t* image, int quality, int lossless,
+        guac_common_surface_tier_group* group) {
+
+    guac_user_filter* filter = NULL;
+    if (group != NULL)
+        filter = __guac_common_surface_tier_filter;
+
+    /* Defer to encoder if possible */
+    if (surface->batch != NULL) {
+        guac_common_encoder_submit(surface->batch, format, GUAC_COMP_OVER,
+                surface->layer, x, y, image, quality, lossless, filter,
+                group);
+        return;
+    }
+
+    guac_socket_broadcast_set_filter(filter, group);
+
+    switch (format) {
+
+        case GUAC_COMMON_ENCODER_JPEG:
+            guac_client_stream_jpeg(surface->client, surface->socket,
+                    GUAC_COMP_OVER, surface->layer, x, y, image, quality);
+            break;
+
+        case GUAC_COMMON_ENCODER_WEBP:
+            guac_client_stream_webp(surface->client, surface->socket,
+                    GUAC_COMP_OVER, surface->layer, x, y, image, quality,
+                    lossless);
+            break;
+
+        default:
+            guac_client_stream_png(surface->client, surface->socket,
+                    GUAC_COMP_OVER, surface->layer, x, y, image);
+            break;
+
+    }
+
+    guac_socket_broadcast_set_filter(NULL, NULL);
+    cairo_surface_destroy(image);
+
+}
+
 /**
  * Flushes the bitmap update currently described by the dirty rectangle within
  * the given surface directly via an "img" instruction as PNG data. The
@@ -1639,9 +2236,14 @@ void guac_common_surface_reset_clip(guac_common_surface* surface) {
  *
  * @param opaque
  *     Whether the rectangle being flushed contains only fully-opaque pixels.
+ *
+ * @param group
+ *     The group of tiers whose users should receive the PNG, or NULL if all
+ *     users should receive the PNG. Any instructions clearing the destination
+ *     rectangle are sent to all users regardless.
  */
 static void __guac_common_surface_flush_to_png(guac_common_surface* surface,
-        int opaque) {
+        int opaque, guac_common_surface_tier_group* group) {
 
     if (surface->dirty) {
 
@@ -1678,10 +2280,10 @@ static void __guac_common_surface_flush_to_png(guac_common_surface* surface,
         }
 
         /* Send PNG for rect */
-        guac_client_stream_png(surface->client, socket, GUAC_COMP_OVER,
-                layer, surface->dirty_rect.x, surface->dirty_rect.y, rect);
+        __guac_common_surface_send_image(surface, GUAC_COMMON_ENCODER_PNG,
+                surface->dirty_rect.x, surface->dirty_rect.y, rect, 0, 0,
+                group);
 
-        cairo_surface_destroy(rect);
         surface->realized = 1;
 
         /* Surface is no longer dirty */
@@ -1691,36 +2293,6 @@ static void __guac_common_surface_flush_to_png(guac_common_surface* surface,
 
 }
 
-/**
- * Returns an appropriate quality between 0 and 100 for lossy encoding
- * depending on the current processing lag calculated for the given client.
- *
- * @param client
- *     The client for which the lossy quality is being calculated.
- *
- * @return
- *     A value between 0 and 100 inclusive which seems appropriate for the
- *     client based on lag measurements.
- */
-static int guac_common_surface_suggest_quality(guac_client* client) {
-
-    int lag = guac_client_get_processing_lag(client);
-
-    /* Scale quality linearly from 90 to 30 as lag varies from 20ms to 80ms */
-    int quality = 90 - (lag - 20);
-
-    /* Do not exceed 90 for quality */
-    if (quality > 90)
-        return 90;
-
-    /* Do not go below 30 for quality */
-    if (quality < 30)
-        return 30;
-
-    return quality;
-
-}
-
 /**
  * Flushes the bitmap update currently described by the dirty rectangle within
  * the given surface directly via an "img" instruction as JPEG data. The
@@ -1729,14 +2301,19 @@ static int guac_common_surface_suggest_quality(guac_client* client) {
  *
  * @param surface
  *     The surface to flush.
+ *
+ * @param quality
+ *     The quality to use for the JPEG, between 0 and 100 inclusive.
+ *
+ * @param group
+ *     The group of tiers whose users should receive the JPEG, or NULL if all
+ *     users should receive the JPEG.
  */
-static void __guac_common_surface_flush_to_jpeg(guac_common_surface* surface) {
+static void __guac_common_surface_flush_to_jpeg(guac_common_surface* surface,
+        int quality, guac_common_surface_tier_group* group) {
 
     if (surface->dirty) {
 
-        guac_socket* socket = surface->socket;
-        const guac_layer* layer = surface->layer;
-
         guac_common_rect max;
         guac_common_rect_init(&max, 0, 0, surface->width, surface->height);
 
@@ -1755,11 +2332,10 @@ static void __guac_common_surface_flush_to_jpeg(guac_common_surface* surface) {
                 surface->dirty_rect.height, surface->stride);
 
         /* Send JPEG for rect */
-        guac_client_stream_jpeg(surface->client, socket, GUAC_COMP_OVER, layer,
+        __guac_common_surface_send_image(surface, GUAC_COMMON_ENCODER_JPEG,
                 surface->dirty_rect.x, surface->dirty_rect.y, rect,
-                guac_common_surface_suggest_quality(surface->client));
+                quality, 0, group);
 
-        cairo_surface_destroy(rect);
         surface->realized = 1;
 
         /* Surface is no longer dirty */
@@ -1780,15 +2356,19 @@ static void __guac_common_surface_flush_to_jpeg(guac_common_surface* surface) {
  *
  * @param opaque
  *     Whether the rectangle being flushed contains only fully-opaque pixels.
+ *
+ * @param quality
+ *     The quality to use for the WebP, between 0 and 100 inclusive.
+ *
+ * @param group
+ *     The group of tiers whose users should receive the WebP, or NULL if all
+ *     users should receive the WebP.
  */
 static void __guac_common_surface_flush_to_webp(guac_common_surface* surface,
-        int opaque) {
+        int opaque, int quality, guac_common_surface_tier_group* group) {
 
     if (surface->dirty) {
 
-        guac_socket* socket = surface->socket;
-        const guac_layer* layer = surface->layer;
-
         guac_common_rect max;
         guac_common_rect_init(&max, 0, 0, surface->width, surface->height);
 
@@ -1817,12 +2397,10 @@ static void __guac_common_surface_flush_to_webp(guac_common_surface* surface,
                     surface->dirty_rect.height, surface->stride);
 
         /* Send WebP for rect */
-        guac_client_stream_webp(surface->client, socket, GUAC_COMP_OVER, layer,
+        __guac_common_surface_send_image(surface, GUAC_COMMON_ENCODER_WEBP,
                 surface->dirty_rect.x, surface->dirty_rect.y, rect,
-                guac_common_surface_suggest_quality(surface->client),
-                surface->lossless ? 1 : 0);
+                quality, surface->lossless ? 1 : 0, group);
 
-        cairo_surface_destroy(rect);
         surface->realized = 1;
 
         /* Surface is no longer dirty */
@@ -1833,25 +2411,219 @@ static void __guac_common_surface_flush_to_webp(guac_common_surface* surface,
 }
 
 /**
- * Comparator for instances of guac_common_surface_bitmap_rect, the elements
- * which make up a surface's bitmap buffer.
+ * Flushes the bitmap update currently described by the dirty rectangle within
+ * the given surface to all users, encoding that update once for each distinct
+ * encoding required by the current tiers of users. If all tiers require the
+ * same encoding, the update is encoded once and sent to all users.
+ *
+ * @param surface
+ *     The surface to flush.
+ *
+ * @param opaque
+ *     Whether the rectangle being flushed contains only fully-opaque pixels.
+ *
+ * @param png_optimality
+ *     The PNG optimality of the rectangle being flushed, as returned by
+ *     __guac_common_surface_png_optimality().
+ *
+ * @return
+ *     Non-zero if any user may have received an encoding of the update which
+ *     does not exactly match the contents of the surface, zero otherwise.
+ */
+static int __guac_common_surface_flush_tiers(guac_common_surface* surface,
+        int opaque, int png_optimality) {
+
+    guac_common_encoder_format formats[GUAC_COMMON_SURFACE_MAX_TIERS];
+    int qualities[GUAC_COMMON_SURFACE_MAX_TIERS];
+    int groups[GUAC_COMMON_SURFACE_MAX_TIERS];
+    int group_count = 0;
+    int lossy = 0;
+    int i, j;
+
+    /* Choose encoding for each tier, grouping tiers with identical
+     * encodings */
+    for (i = 0; i < surface->tier_count; i++) {
+
+        guac_common_surface_tier* tier = &surface->tiers[i];
+        guac_common_encoder_format format = GUAC_COMMON_ENCODER_PNG;
+        int quality = 0;
+
+        /* The first tier must always be sent, as it covers any users which
+         * join mid-flush */
+        if (i > 0 && tier->users == 0)
+            continue;
+
+        /* Prefer WebP when reasonable */
+        if (tier->webp && __guac_common_surface_should_use_webp(surface,
+                    &surface->dirty_rect, tier->congested, png_optimality)) {
+            format = GUAC_COMMON_ENCODER_WEBP;
+            quality = tier->quality;
+        }
+
+        /* If not WebP, JPEG is the next best (lossy) choice */
+        else if (opaque && __guac_common_surface_should_use_jpeg(surface,
+                    &surface->dirty_rect, tier->congested, png_optimality)) {
+            format = GUAC_COMMON_ENCODER_JPEG;
+            quality = tier->quality;
+        }
+
+        for (j = 0; j < group_count; j++) {
+            if (formats[j] == format && qualities[j] == quality)
+                break;
+        }
+
+        /* Add new group if no existing group has the same encoding */
+        if (j == group_count) {
+            formats[j] = format;
+            qualities[j] = quality;
+            groups[j] = 0;
+            group_count++;
+        }
+
+        groups[j] |= 1 << i;
+
+        if (format != GUAC_COMMON_ENCODER_PNG)
+            lossy = 1;
+
+    }
+
+    /* Differing encodings are not identical to any one cached copy */
+    if (group_count > 1)
+        lossy = 1;
+
+    /* Send PNG first, such that clearing the destination rectangle for
+     * non-opaque updates (sent to all users) precedes all other encodings */
+    for (i = 1; i < group_count; i++) {
+        if (formats[i] == GUAC_COMMON_ENCODER_PNG) {
+
+            int tiers = groups[i];
+
+            formats[i] = formats[0];
+            qualities[i] = qualities[0];
+            groups[i] = groups[0];
+
+            formats[0] = GUAC_COMMON_ENCODER_PNG;
+            qualities[0] = 0;
+            groups[0] = tiers;
+
+            break;
+
+        }
+    }
+
+    /* Record only the first (lossless, if any) encoding */
+    surface->recorded_tiers = groups[0];
+
+    /* Lossy encodings may expand the dirty rectangle, which must be restored
+     * for each subsequent encoding */
+    guac_common_rect dirty_rect = surface->dirty_rect;
+
+    for (i = 0; i < group_count; i++) {
+
+        /* Send to all users if only one encoding is needed */
+        guac_common_surface_tier_group* group = NULL;
+        if (group_count > 1)
+            group = &surface->tier_groups[groups[i]];
+
+        surface->dirty = 1;
+        surface->dirty_rect = dirty_rect;
+
+        switch (formats[i]) {
+
+            case GUAC_COMMON_ENCODER_WEBP:
+                __guac_common_surface_flush_to_webp(surface, opaque,
+                        qualities[i], group);
+                break;
+
+            case GUAC_COMMON_ENCODER_JPEG:
+                __guac_common_surface_flush_to_jpeg(surface, qualities[i],
+                        group);
+                break;
+
+            default:
+                __guac_common_surface_flush_to_png(surface, opaque, group);
+                break;
+
+        }
+
+    }
+
+    return lossy;
+
+}
+
+/**
+ * Returns an image surface referencing the contents of the given rectangle
+ * if that rectangle should be looked up within and added to the image cache
+ * of the given surface. Rectangles which are too small to be worth caching, or
+ * which lie within regions updated so frequently that their contents are
+ * unlikely to ever repeat (such as video), are not cached.
  *
- * @see qsort
+ * @param surface
+ *     The surface containing the rectangle.
+ *
+ * @param rect
+ *     The rectangle to test.
+ *
+ * @return
+ *     A new image surface referencing the image data of the given rectangle,
+ *     which must eventually be destroyed with cairo_surface_destroy(), or
+ *     NULL if the rectangle should not be cached.
  */
-static int __guac_common_surface_bitmap_rect_compare(const void* a, const void* b) {
+static cairo_surface_t* __guac_common_surface_cacheable_rect(
+        guac_common_surface* surface, const guac_common_rect* rect) {
+
+    guac_common_image_cache* cache = surface->image_cache;
 
-    guac_common_surface_bitmap_rect* ra = (guac_common_surface_bitmap_rect*) a;
-    guac_common_surface_bitmap_rect* rb = (guac_common_surface_bitmap_rect*) b;
+    /* Caching must be enabled */
+    if (cache == NULL || cache->max_size == 0)
+        return NULL;
 
-    /* Order roughly top to bottom, left to right */
-    if (ra->rect.y != rb->rect.y) return ra->rect.y - rb->rect.y;
-    if (ra->rect.x != rb->rect.x) return ra->rect.x - rb->rect.x;
+    /* Small updates are cheap to send directly */
+    if (rect->width * rect->height < GUAC_COMMON_IMAGE_CACHE_MIN_AREA)
+        return NULL;
 
-    /* Wider updates should come first (more likely to intersect later) */
-    if (ra->rect.width != rb->rect.width) return rb->rect.width - ra->rect.width;
+    /* Rapidly-changing content is unlikely to repeat */
+    if (__guac_common_surface_calculate_framerate(surface, rect)
+            >= GUAC_COMMON_SURFACE_JPEG_FRAMERATE)
+        return NULL;
 
-    /* Shorter updates should come first (less likely to increase cost) */
-    return ra->rect.height - rb->rect.height;
+    unsigned char* buffer = surface->buffer
+                          + rect->y * surface->stride
+                          + rect->x * 4;
+
+    return cairo_image_surface_create_for_data(buffer, CAIRO_FORMAT_ARGB32,
+            rect->width, rect->height, surface->stride);
+
+}
+
+/**
+ * Returns whether two changed rectangles within adjacent heat map cells should
+ * be flushed as a single combined update, based on whether the estimated cost
+ * of the combined update is no greater than that of both separately.
+ *
+ * @param a
+ *     The first changed rectangle.
+ *
+ * @param b
+ *     The second changed rectangle.
+ *
+ * @return
+ *     Non-zero if the rectangles should be combined, zero otherwise.
+ */
+static int __guac_common_surface_should_merge(const guac_common_rect* a,
+        const guac_common_rect* b) {
+
+    /* Simulate combination */
+    guac_common_rect combined = *a;
+    guac_common_rect_extend(&combined, b);
+
+    /* Estimate costs of each update, and both combined */
+    int combined_cost = GUAC_SURFACE_BASE_COST + combined.width * combined.height;
+    int a_cost        = GUAC_SURFACE_BASE_COST + a->width * a->height;
+    int b_cost        = GUAC_SURFACE_BASE_COST + b->width * b->height;
+
+    return combined_cost <= a_cost + b_cost;
 
 }
 
@@ -1887,91 +2659,196 @@ static void __guac_common_surface_flush_properties(
 
 }
 
-static void __guac_common_surface_flush(guac_common_surface* surface) {
+/**
+ * Flushes the given rectangle of the given surface as image data, reusing
+ * identical image data from the image cache if possible, and otherwise
+ * encoding the rectangle once for each distinct encoding required by the
+ * users of the surface.
+ *
+ * @param surface
+ *     The surface to flush.
+ *
+ * @param rect
+ *     The rectangle to flush, which must be within the bounds of the surface.
+ */
+static void __guac_common_surface_flush_rect(guac_common_surface* surface,
+        const guac_common_rect* rect) {
 
-    /* Flush final dirty rectangle to queue. */
-    __guac_common_surface_flush_to_queue(surface);
+    unsigned int hash = 0;
+    int lossy = 0;
 
-    guac_common_surface_bitmap_rect* current = surface->bitmap_queue;
-    int i, j;
-    int original_queue_length;
-    int flushed = 0;
+    /* Encoders flush the dirty rect, which lossy encodings may expand */
+    surface->dirty = 1;
+    surface->dirty_rect = *rect;
 
-    original_queue_length = surface->bitmap_queue_length;
+    cairo_surface_t* cacheable =
+        __guac_common_surface_cacheable_rect(surface, rect);
 
-    /* Sort updates to make combination less costly */
-    qsort(surface->bitmap_queue, surface->bitmap_queue_length, sizeof(guac_common_surface_bitmap_rect),
-          __guac_common_surface_bitmap_rect_compare);
+    if (cacheable != NULL)
+        hash = guac_hash_surface(cacheable);
 
-    /* Flush all rects in queue */
-    for (i=0; i < surface->bitmap_queue_length; i++) {
+    /* Reuse identical image data already sent, if any */
+    if (cacheable != NULL && guac_common_image_cache_draw(
+                surface->image_cache, surface->socket, cacheable,
+                hash, surface->layer, rect->x, rect->y)) {
+        surface->realized = 1;
+        surface->dirty = 0;
+    }
 
-        /* Get next unflushed candidate */
-        guac_common_surface_bitmap_rect* candidate = current;
-        if (!candidate->flushed) {
+    else {
 
-            int combined = 0;
+        /* Analyze image data once for all encodings */
+        int opaque;
+        int png_optimality = __guac_common_surface_png_optimality(
+                surface, &surface->dirty_rect, &opaque);
 
-            /* Build up rect as much as possible */
-            for (j=i; j < surface->bitmap_queue_length; j++) {
+        /* Encode once per distinct encoding required by users */
+        lossy = __guac_common_surface_flush_tiers(surface, opaque,
+                png_optimality);
 
-                if (!candidate->flushed) {
+        /* Retain a client-side copy for later reuse, unless that
+         * copy would not exactly match the image hashed */
+        if (cacheable != NULL && !lossy)
+            guac_common_image_cache_add(surface->image_cache,
+                    surface->socket, cacheable, hash,
+                    surface->layer, rect->x, rect->y);
 
-                    /* Clip candidate within current bounds */
-                    __guac_common_bound_rect(surface, &candidate->rect, NULL, NULL);
-                    if (candidate->rect.width <= 0 || candidate->rect.height <= 0)
-                        candidate->flushed = 1;
+    }
 
-                    /* Combine if reasonable */
-                    else if (__guac_common_should_combine(surface, &candidate->rect, 0) || !surface->dirty) {
-                        __guac_common_mark_dirty(surface, &candidate->rect);
-                        candidate->flushed = 1;
-                        combined++;
-                    }
+    if (cacheable != NULL)
+        cairo_surface_destroy(cacheable);
 
-                }
+}
 
-                candidate++;
+/**
+ * Flushes all changes recorded within the heat map of the given surface as
+ * image data, clearing those changes. The heat map is scanned once, row by
+ * row. Changes within horizontally-adjacent cells are combined into runs
+ * where doing so is estimated to be no more costly than sending each
+ * separately, and runs spanning the same columns of vertically-adjacent rows
+ * are combined likewise. As each run covers a distinct set of cells, the
+ * resulting updates never overlap.
+ *
+ * @param surface
+ *     The surface to flush.
+ */
+static void __guac_common_surface_flush_damaged(guac_common_surface* surface) {
 
-            }
+    int x, y;
 
-            /* Re-add to queue if there's room and this update was modified or we expect others might be */
-            if ((combined > 1 || i < original_queue_length)
-                    && surface->bitmap_queue_length < GUAC_COMMON_SURFACE_QUEUE_SIZE)
-                __guac_common_surface_flush_to_queue(surface);
+    /* Calculate heat map dimensions */
+    int heat_width = GUAC_COMMON_SURFACE_HEAT_DIMENSION(surface->width);
+    int heat_height = GUAC_COMMON_SURFACE_HEAT_DIMENSION(surface->height);
 
-            /* Flush as bitmap otherwise */
-            else if (surface->dirty) {
+    /* The update currently being built for the run of cells beginning at
+     * each column, if any (zero width if none) */
+    guac_common_rect* pending = calloc(heat_width, sizeof(guac_common_rect));
 
-                flushed++;
+    guac_common_surface_heat_cell* heat_row = surface->heat_map;
+    for (y = 0; y < heat_height; y++) {
 
-                int opaque = __guac_common_surface_is_opaque(surface,
-                            &surface->dirty_rect);
+        x = 0;
+        while (x < heat_width) {
+
+            /* Skip cells which have not changed */
+            guac_common_surface_heat_cell* heat_cell = &heat_row[x];
+            if (!heat_cell->dirty) {
+                x++;
+                continue;
+            }
 
-                /* Prefer WebP when reasonable */
-                if (__guac_common_surface_should_use_webp(surface,
-                            &surface->dirty_rect))
-                    __guac_common_surface_flush_to_webp(surface, opaque);
+            /* Build run of changed cells as long as combining is
+             * reasonable */
+            int start = x;
+            guac_common_rect run = heat_cell->dirty_rect;
+            heat_cell->dirty = 0;
 
-                /* If not WebP, JPEG is the next best (lossy) choice */
-                else if (opaque && __guac_common_surface_should_use_jpeg(
-                            surface, &surface->dirty_rect))
-                    __guac_common_surface_flush_to_jpeg(surface);
+            for (x++, heat_cell++; x < heat_width; x++, heat_cell++) {
 
-                /* Use PNG if no lossy formats are appropriate */
-                else
-                    __guac_common_surface_flush_to_png(surface, opaque);
+                if (!heat_cell->dirty || !__guac_common_surface_should_merge(
+                            &run, &heat_cell->dirty_rect))
+                    break;
+
+                guac_common_rect_extend(&run, &heat_cell->dirty_rect);
+                heat_cell->dirty = 0;
+
+            }
 
+            /* Extend the update built for the identical run of cells within
+             * the previous row, if combining is reasonable */
+            guac_common_rect* above = &pending[start];
+            if (above->width > 0
+                    && (above->x + above->width - 1)
+                        / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE == x - 1
+                    && (above->y + above->height - 1)
+                        / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE == y - 1
+                    && __guac_common_surface_should_merge(above, &run))
+                guac_common_rect_extend(above, &run);
+
+            /* Otherwise, flush any such update and begin a new update */
+            else {
+                if (above->width > 0)
+                    __guac_common_surface_flush_rect(surface, above);
+                *above = run;
             }
 
         }
 
-        current++;
+        /* Flush all updates which were not extended by this row */
+        for (x = 0; x < heat_width; x++) {
+            guac_common_rect* update = &pending[x];
+            if (update->width > 0 && (update->y + update->height - 1)
+                        / GUAC_COMMON_SURFACE_HEAT_CELL_SIZE != y) {
+                __guac_common_surface_flush_rect(surface, update);
+                update->width = 0;
+            }
+        }
+
+        /* Next heat map row */
+        heat_row += heat_width;
+
+    }
+
+    /* Flush all remaining updates */
+    for (x = 0; x < heat_width; x++) {
+        if (pending[x].width > 0)
+            __guac_common_surface_flush_rect(surface, &pending[x]);
+    }
+
+    free(pending);
+    surface->damaged = 0;
+
+}
+
+static void __guac_common_surface_flush(guac_common_surface* surface) {
+
+    /* Record final dirty rectangle within heat map */
+    __guac_common_surface_flush_deferred(surface);
+
+    /* Nothing to do if no updates are pending */
+    if (!surface->damaged)
+        return;
+
+    /* Determine the encodings required by each user */
+    __guac_common_surface_update_tiers(surface);
 
+    /* Submit all image data within this flush as a single batch, with all
+     * other instructions ordered relative to that batch */
+    guac_socket* socket = surface->socket;
+    if (surface->encoder != NULL) {
+        surface->batch = guac_common_encoder_begin(surface->encoder, socket);
+        surface->socket = surface->batch->socket;
     }
 
-    /* Flush complete */
-    surface->bitmap_queue_length = 0;
+    /* Flush all changes as near-minimal, non-overlapping rectangles */
+    __guac_common_surface_flush_damaged(surface);
+
+    /* Send all image data, waiting for encoding to complete */
+    if (surface->batch != NULL) {
+        guac_common_encoder_end(surface->batch);
+        surface->batch = NULL;
+        surface->socket = socket;
+    }
 
 }
 
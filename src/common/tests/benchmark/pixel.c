@@ -0,0 +1,235 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "common/pixel.h"
+
+#include <guacamole/protocol-types.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * The width of each benchmarked row, in pixels. This matches a typical
+ * 1080p display.
+ */
+#define BENCHMARK_WIDTH 1920
+
+/**
+ * The number of rows processed by each benchmark pass.
+ */
+#define BENCHMARK_HEIGHT 1080
+
+/**
+ * The number of passes over the full benchmark image timed for each kernel.
+ */
+#define BENCHMARK_PASSES 20
+
+/**
+ * Destination and source images shared by all benchmarks.
+ */
+static uint32_t benchmark_dst[BENCHMARK_WIDTH * BENCHMARK_HEIGHT];
+static uint32_t benchmark_src[BENCHMARK_WIDTH * BENCHMARK_HEIGHT];
+
+/**
+ * Returns the current value of a monotonic clock, in seconds.
+ *
+ * @return
+ *     The current value of the monotonic clock, in seconds.
+ */
+static double benchmark_now() {
+    struct timespec current;
+    clock_gettime(CLOCK_MONOTONIC, &current);
+    return current.tv_sec + current.tv_nsec / 1000000000.0;
+}
+
+/**
+ * Fills the source and destination images with content resembling a typical
+ * desktop: long runs of identical color interrupted by varying pixels, with
+ * a mix of opaque, transparent and translucent alpha.
+ */
+static void benchmark_init_images() {
+
+    unsigned int state = 1;
+
+    for (int i = 0; i < BENCHMARK_WIDTH * BENCHMARK_HEIGHT; i++) {
+
+        state = state * 1103515245 + 12345;
+
+        /* Mostly runs of a solid color, occasionally something else */
+        uint32_t color = (i / 64) * 0x010203;
+        if ((state >> 16) % 8 == 0)
+            color = state;
+
+        benchmark_src[i] = color | 0xFF000000;
+        if ((state >> 8) % 4 == 0)
+            benchmark_src[i] &= 0x7F7F7F7F;
+
+        benchmark_dst[i] = color ^ 0x00101010;
+
+    }
+
+}
+
+/**
+ * Resets the destination image to its initial contents, such that every
+ * pass of a benchmark performs the same work.
+ */
+static void benchmark_reset_dst() {
+    for (int i = 0; i < BENCHMARK_WIDTH * BENCHMARK_HEIGHT; i++)
+        benchmark_dst[i] = benchmark_src[i] ^ 0x00101010;
+}
+
+/**
+ * Prints the average time taken per megapixel by a benchmarked operation.
+ *
+ * @param name
+ *     The human-readable name of the operation being benchmarked.
+ *
+ * @param elapsed
+ *     The total time spent performing the operation across all passes, in
+ *     seconds.
+ */
+static void benchmark_report(const char* name, double elapsed) {
+    printf("    %-20s %8.3f ms/MP\n", name, elapsed * 1000000000.0
+            / ((double) BENCHMARK_PASSES * BENCHMARK_WIDTH * BENCHMARK_HEIGHT));
+}
+
+/**
+ * Times the given row kernel over every row of the benchmark images,
+ * printing the average time taken per megapixel.
+ *
+ * @param name
+ *     The human-readable name of the operation being benchmarked.
+ *
+ * @param kernel
+ *     The row kernel to benchmark.
+ *
+ * @param value
+ *     The value to pass to the kernel for each row.
+ */
+static void benchmark_row_kernel(const char* name,
+        guac_common_pixel_row_kernel* kernel, uint32_t value) {
+
+    double elapsed = 0;
+
+    for (int pass = 0; pass < BENCHMARK_PASSES; pass++) {
+
+        benchmark_reset_dst();
+
+        double start = benchmark_now();
+        for (int y = 0; y < BENCHMARK_HEIGHT; y++) {
+            int first, last;
+            kernel(benchmark_dst + y * BENCHMARK_WIDTH,
+                    benchmark_src + y * BENCHMARK_WIDTH,
+                    BENCHMARK_WIDTH, value, &first, &last);
+        }
+        elapsed += benchmark_now() - start;
+
+    }
+
+    benchmark_report(name, elapsed);
+
+}
+
+/**
+ * Times the fill_mask kernel over every row of the benchmark images,
+ * printing the average time taken per megapixel.
+ *
+ * @param kernels
+ *     The kernels being benchmarked.
+ */
+static void benchmark_fill_mask(const guac_common_pixel_kernels* kernels) {
+
+    double start = benchmark_now();
+    for (int pass = 0; pass < BENCHMARK_PASSES; pass++) {
+        for (int y = 0; y < BENCHMARK_HEIGHT; y++)
+            kernels->fill_mask(benchmark_dst + y * BENCHMARK_WIDTH,
+                    benchmark_src + y * BENCHMARK_WIDTH,
+                    BENCHMARK_WIDTH, 0xFF336699);
+    }
+
+    benchmark_report("fill_mask", benchmark_now() - start);
+
+}
+
+/**
+ * Times the analyze kernel over every row of the benchmark images, printing
+ * the average time taken per megapixel.
+ *
+ * @param kernels
+ *     The kernels being benchmarked.
+ */
+static void benchmark_analyze(const guac_common_pixel_kernels* kernels) {
+
+    int same = 0;
+    uint32_t alpha = 0xFFFFFFFF;
+
+    double start = benchmark_now();
+    for (int pass = 0; pass < BENCHMARK_PASSES; pass++) {
+        for (int y = 0; y < BENCHMARK_HEIGHT; y++)
+            kernels->analyze(benchmark_src + y * BENCHMARK_WIDTH,
+                    BENCHMARK_WIDTH, &same, &alpha);
+    }
+
+    benchmark_report("analyze", benchmark_now() - start);
+
+    /* Use the results so that the analysis cannot be optimized away */
+    if (same < 0 || alpha == 0xDEADBEEF)
+        printf("    (unexpected analysis result)\n");
+
+}
+
+int main() {
+
+    benchmark_init_images();
+
+    printf("Pixel kernels (%ix%i, %i passes):\n",
+            BENCHMARK_WIDTH, BENCHMARK_HEIGHT, BENCHMARK_PASSES);
+
+    /* Benchmark every implementation supported by this processor */
+    for (int isa = 0; isa < GUAC_COMMON_PIXEL_ISA_COUNT; isa++) {
+
+        const guac_common_pixel_kernels* kernels =
+            guac_common_pixel_get_kernels(isa);
+
+        if (kernels == NULL) {
+            printf("\nInstruction set %i: not supported\n", isa);
+            continue;
+        }
+
+        printf("\n%s:\n", kernels->name);
+        benchmark_row_kernel("copy_opaque", kernels->copy_opaque, 0);
+        benchmark_row_kernel("blend", kernels->blend, 0);
+        benchmark_row_kernel("set", kernels->set, 0xFF336699);
+        benchmark_row_kernel("transfer (XOR)", kernels->transfer,
+                GUAC_TRANSFER_BINARY_XOR);
+        benchmark_row_kernel("transfer (NSRC)", kernels->transfer,
+                GUAC_TRANSFER_BINARY_NSRC);
+        benchmark_fill_mask(kernels);
+        benchmark_analyze(kernels);
+
+    }
+
+    return EXIT_SUCCESS;
+
+}
+
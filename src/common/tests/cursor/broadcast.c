@@ -0,0 +1,139 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "common/cursor.h"
+
+#include <CUnit/CUnit.h>
+#include <guacamole/client.h>
+#include <guacamole/socket.h>
+#include <guacamole/user.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * The number of milliseconds to remain idle after moving the cursor, which
+ * must comfortably exceed GUAC_COMMON_CURSOR_BROADCAST_INTERVAL.
+ */
+#define TEST_IDLE_TIME (GUAC_COMMON_CURSOR_BROADCAST_INTERVAL * 4)
+
+/**
+ * Allocates a new user with a socket that writes to a new, anonymous
+ * temporary file, joining that user to the given client. The file descriptor
+ * of the temporary file is stored within the given int.
+ */
+static guac_user* join_test_user(guac_client* client, int* fd) {
+
+    char path[] = "/tmp/guac-test-cursor-XXXXXX";
+
+    *fd = mkstemp(path);
+    CU_ASSERT_FATAL(*fd != -1);
+    unlink(path);
+
+    guac_user* user = guac_user_alloc();
+    user->socket = guac_socket_open(*fd);
+    user->client = client;
+
+    CU_ASSERT_EQUAL_FATAL(guac_client_add_user(client, user, 0, NULL), 0);
+    return user;
+
+}
+
+/**
+ * Removes the given user from the given client, freeing the user and its
+ * socket, and closing the underlying temporary file.
+ */
+static void leave_test_user(guac_client* client, guac_user* user) {
+
+    guac_client_remove_user(client, user);
+
+    guac_socket_free(user->socket);
+    guac_user_free(user);
+
+}
+
+/**
+ * Reads all data written to the file having the given file descriptor into a
+ * newly-allocated, null-terminated string.
+ *
+ * @param fd
+ *     The file descriptor of the file to read.
+ *
+ * @return
+ *     A newly-allocated string containing all data written to the file,
+ *     which must eventually be freed with free().
+ */
+static char* read_written(int fd) {
+
+    off_t length = lseek(fd, 0, SEEK_END);
+    char* written = malloc(length + 1);
+
+    CU_ASSERT_FATAL(pread(fd, written, length, 0) == length);
+    written[length] = '\0';
+
+    return written;
+
+}
+
+/**
+ * Test which verifies that a cursor position which is not broadcast
+ * immediately, having been updated too soon after a previous broadcast, is
+ * still broadcast to all other users if no frame follows.
+ */
+void test_cursor__broadcast_idle() {
+
+    int mover_fd;
+    int viewer_fd;
+
+    guac_client* client = guac_client_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(client);
+
+    guac_user* mover = join_test_user(client, &mover_fd);
+    guac_user* viewer = join_test_user(client, &viewer_fd);
+
+    guac_common_cursor* cursor = guac_common_cursor_alloc(client);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(cursor);
+
+    /* The first move is broadcast immediately, while the second falls within
+     * the same broadcast interval and is deferred */
+    guac_common_cursor_update(cursor, mover, 12, 34, 0);
+    guac_common_cursor_update(cursor, mover, 56, 78, 0);
+
+    /* Remain idle, never flushing a frame */
+    usleep(TEST_IDLE_TIME * 1000);
+
+    char* viewer_written = read_written(viewer_fd);
+    CU_ASSERT_PTR_NOT_NULL(strstr(viewer_written, "5.mouse,2.12,2.34,1.0,"));
+    CU_ASSERT_PTR_NOT_NULL(strstr(viewer_written, "5.mouse,2.56,2.78,1.0,"));
+    free(viewer_written);
+
+    /* The user moving the cursor is never sent its own position */
+    char* mover_written = read_written(mover_fd);
+    CU_ASSERT_PTR_NULL(strstr(mover_written, "5.mouse,"));
+    free(mover_written);
+
+    guac_common_cursor_free(cursor);
+
+    leave_test_user(client, mover);
+    leave_test_user(client, viewer);
+    guac_client_free(client);
+
+}
+
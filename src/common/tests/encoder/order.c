@@ -0,0 +1,136 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "common/encoder.h"
+
+#include <CUnit/CUnit.h>
+#include <cairo/cairo.h>
+#include <guacamole/client.h>
+#include <guacamole/layer.h>
+#include <guacamole/protocol.h>
+#include <guacamole/socket.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * The number of images to submit within each test batch. This is
+ * deliberately larger than GUAC_COMMON_ENCODER_MAX_JOBS, such that some
+ * images must be sent before the batch ends.
+ */
+#define TEST_IMAGES 40
+
+/**
+ * Submits a batch of TEST_IMAGES images to an encoder having the given number
+ * of threads, each preceded by a "sync" instruction written to the batch
+ * socket, and verifies that everything is sent in order.
+ *
+ * @param threads
+ *     The number of threads the encoder should use.
+ */
+static void test_encoder_order(int threads) {
+
+    int i;
+    char expected[64];
+    guac_common_encoder_stats stats;
+
+    char path[] = "/tmp/guac-test-encoder-XXXXXX";
+    int fd = mkstemp(path);
+    CU_ASSERT_FATAL(fd != -1);
+    unlink(path);
+
+    guac_client* client = guac_client_alloc();
+    guac_common_encoder* encoder = guac_common_encoder_alloc(client, threads);
+    guac_socket* socket = guac_socket_open(fd);
+
+    guac_common_encoder_batch* batch =
+        guac_common_encoder_begin(encoder, socket);
+
+    for (i = 0; i < TEST_IMAGES; i++) {
+
+        cairo_surface_t* image = cairo_image_surface_create(
+                CAIRO_FORMAT_RGB24, 16, 16);
+
+        guac_protocol_send_sync(batch->socket, i);
+        guac_common_encoder_submit(batch, GUAC_COMMON_ENCODER_PNG,
+                GUAC_COMP_OVER, GUAC_DEFAULT_LAYER, i, 0, image, 0, 0, NULL,
+                NULL);
+
+    }
+
+    guac_protocol_send_sync(batch->socket, TEST_IMAGES);
+    guac_common_encoder_end(batch);
+    guac_socket_flush(socket);
+
+    /* Read everything sent */
+    char written[65536];
+    ssize_t length = pread(fd, written, sizeof(written) - 1, 0);
+    CU_ASSERT_FATAL(length >= 0);
+    written[length] = '\0';
+
+    /* Each image must follow the instruction written before it */
+    const char* current = written;
+    for (i = 0; i < TEST_IMAGES; i++) {
+
+        snprintf(expected, sizeof(expected), "4.sync,%i.%i;",
+                i >= 10 ? 2 : 1, i);
+        current = strstr(current, expected);
+        CU_ASSERT_PTR_NOT_NULL_FATAL(current);
+
+        snprintf(expected, sizeof(expected), ",9.image/png,%i.%i,1.0;",
+                i >= 10 ? 2 : 1, i);
+        current = strstr(current, expected);
+        CU_ASSERT_PTR_NOT_NULL_FATAL(current);
+
+    }
+
+    CU_ASSERT_PTR_NOT_NULL(strstr(current, "4.sync,2.40;"));
+
+    /* All images should be accounted for */
+    guac_common_encoder_get_stats(encoder, GUAC_COMMON_ENCODER_PNG, &stats);
+    CU_ASSERT_EQUAL(stats.images, TEST_IMAGES);
+    CU_ASSERT_EQUAL(stats.pixels, TEST_IMAGES * 16 * 16);
+
+    guac_common_encoder_get_stats(encoder, GUAC_COMMON_ENCODER_JPEG, &stats);
+    CU_ASSERT_EQUAL(stats.images, 0);
+
+    guac_socket_free(socket);
+    guac_common_encoder_free(encoder);
+    guac_client_free(client);
+
+}
+
+/**
+ * Tests that images encoded serially are sent in order relative to other
+ * instructions.
+ */
+void test_encoder__serial() {
+    test_encoder_order(0);
+}
+
+/**
+ * Tests that images encoded in parallel are sent in order relative to each
+ * other and to other instructions.
+ */
+void test_encoder__parallel() {
+    test_encoder_order(4);
+}
+
@@ -0,0 +1,164 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "common/image-cache.h"
+
+#include <CUnit/CUnit.h>
+#include <cairo/cairo.h>
+#include <guacamole/client.h>
+#include <guacamole/hash.h>
+
+#include <stdint.h>
+
+/**
+ * The width and height of each test image, in pixels.
+ */
+#define TEST_IMAGE_SIZE 64
+
+/**
+ * The number of bytes of image data within each test image.
+ */
+#define TEST_IMAGE_BYTES (TEST_IMAGE_SIZE * TEST_IMAGE_SIZE * 4)
+
+/**
+ * Allocates a new test image filled entirely with the given color.
+ *
+ * @param color
+ *     The 32-bit ARGB color to fill the image with.
+ *
+ * @return
+ *     A newly-allocated image, which must eventually be destroyed with
+ *     cairo_surface_destroy().
+ */
+static cairo_surface_t* test_image(uint32_t color) {
+
+    cairo_surface_t* image = cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
+            TEST_IMAGE_SIZE, TEST_IMAGE_SIZE);
+
+    int stride = cairo_image_surface_get_stride(image);
+    unsigned char* data = cairo_image_surface_get_data(image);
+
+    int x, y;
+    for (y = 0; y < TEST_IMAGE_SIZE; y++) {
+        uint32_t* row = (uint32_t*) (data + y * stride);
+        for (x = 0; x < TEST_IMAGE_SIZE; x++)
+            row[x] = color;
+    }
+
+    cairo_surface_mark_dirty(image);
+    return image;
+
+}
+
+/**
+ * Adds the given image to the given image cache the given number of times.
+ *
+ * @param cache
+ *     The image cache to add the image to.
+ *
+ * @param client
+ *     The client associated with the image cache.
+ *
+ * @param image
+ *     The image to add.
+ *
+ * @param hash
+ *     The value of guac_hash_surface() for the given image.
+ *
+ * @param count
+ *     The number of times the image should be added.
+ */
+static void test_add(guac_common_image_cache* cache, guac_client* client,
+        cairo_surface_t* image, unsigned int hash, int count) {
+
+    while (count-- > 0)
+        guac_common_image_cache_add(cache, client->socket, image, hash,
+                GUAC_DEFAULT_LAYER, 0, 0);
+
+}
+
+/**
+ * Tests that images added to the image cache more than once are found only
+ * when identical image data is later drawn, and that the least recently used
+ * images are evicted once the cache is full.
+ */
+void test_image_cache__draw() {
+
+    guac_client* client = guac_client_alloc();
+    guac_common_image_cache* cache =
+        guac_common_image_cache_alloc(client, TEST_IMAGE_BYTES * 2);
+
+    cairo_surface_t* red = test_image(0xFFFF0000);
+    cairo_surface_t* green = test_image(0xFF00FF00);
+    cairo_surface_t* blue = test_image(0xFF0000FF);
+
+    unsigned int red_hash = guac_hash_surface(red);
+    unsigned int green_hash = guac_hash_surface(green);
+    unsigned int blue_hash = guac_hash_surface(blue);
+
+    /* Nothing is initially cached */
+    CU_ASSERT_FALSE(guac_common_image_cache_draw(cache, client->socket, red,
+                red_hash, GUAC_DEFAULT_LAYER, 0, 0));
+
+    /* Images added only once are not copied */
+    test_add(cache, client, red, red_hash, 1);
+    CU_ASSERT_EQUAL(cache->size, 0);
+    CU_ASSERT_FALSE(guac_common_image_cache_draw(cache, client->socket, red,
+                red_hash, GUAC_DEFAULT_LAYER, 0, 0));
+
+    /* Images added again are subsequently found */
+    test_add(cache, client, red, red_hash, 1);
+    test_add(cache, client, green, green_hash, 2);
+    CU_ASSERT_EQUAL(cache->size, TEST_IMAGE_BYTES * 2);
+
+    CU_ASSERT_TRUE(guac_common_image_cache_draw(cache, client->socket, red,
+                red_hash, GUAC_DEFAULT_LAYER, 0, 0));
+    CU_ASSERT_TRUE(guac_common_image_cache_draw(cache, client->socket, green,
+                green_hash, GUAC_DEFAULT_LAYER, 0, 0));
+
+    /* Matching hashes alone are insufficient */
+    CU_ASSERT_FALSE(guac_common_image_cache_draw(cache, client->socket, blue,
+                red_hash, GUAC_DEFAULT_LAYER, 0, 0));
+
+    /* Red is now least recently used and should be evicted for blue */
+    test_add(cache, client, blue, blue_hash, 2);
+    CU_ASSERT_EQUAL(cache->size, TEST_IMAGE_BYTES * 2);
+
+    CU_ASSERT_FALSE(guac_common_image_cache_draw(cache, client->socket, red,
+                red_hash, GUAC_DEFAULT_LAYER, 0, 0));
+    CU_ASSERT_TRUE(guac_common_image_cache_draw(cache, client->socket, green,
+                green_hash, GUAC_DEFAULT_LAYER, 0, 0));
+    CU_ASSERT_TRUE(guac_common_image_cache_draw(cache, client->socket, blue,
+                blue_hash, GUAC_DEFAULT_LAYER, 0, 0));
+
+    /* Disabling the cache discards everything */
+    guac_common_image_cache_set_size(cache, 0);
+    CU_ASSERT_EQUAL(cache->size, 0);
+    CU_ASSERT_FALSE(guac_common_image_cache_draw(cache, client->socket, blue,
+                blue_hash, GUAC_DEFAULT_LAYER, 0, 0));
+
+    cairo_surface_destroy(red);
+    cairo_surface_destroy(green);
+    cairo_surface_destroy(blue);
+
+    guac_common_image_cache_free(cache);
+    guac_client_free(client);
+
+}
+
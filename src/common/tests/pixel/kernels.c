@@ -0,0 +1,291 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "common/pixel.h"
+
+#include <CUnit/CUnit.h>
+#include <guacamole/protocol-types.h>
+
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * The maximum number of pixels in each test row. This is deliberately not a
+ * multiple of any vector width, such that partial groups are exercised.
+ */
+#define TEST_MAX_WIDTH 67
+
+/**
+ * The number of random rows tested for each width.
+ */
+#define TEST_ROWS 64
+
+/**
+ * The state of the pseudo-random number generator used to produce test
+ * pixels.
+ */
+static uint32_t test_random_state;
+
+/**
+ * Returns a pseudo-random pixel, biased toward the alpha values and repeated
+ * colors which trigger special cases within the kernels.
+ */
+static uint32_t test_random_pixel() {
+
+    static const uint32_t alphas[] = { 0x00, 0x01, 0x7F, 0xFE, 0xFF };
+
+    test_random_state = test_random_state * 1103515245 + 12345;
+    uint32_t random = test_random_state >> 8;
+
+    /* Restrict colors to a small set such that repeats are common */
+    uint32_t color = (random % 5) * 0x3F1F0F;
+    uint32_t alpha = alphas[(random >> 4) % 5];
+
+    return (alpha << 24) | (color & 0xFFFFFF);
+
+}
+
+/**
+ * Fills the given row with pseudo-random pixels.
+ */
+static void test_random_row(uint32_t* row, int width) {
+
+    int x;
+
+    for (x = 0; x < width; x++)
+        row[x] = test_random_pixel();
+
+}
+
+/**
+ * Verifies that the given row kernel produces the same pixels, return value
+ * and range of changed pixels as the corresponding scalar kernel, for rows
+ * of every width up to TEST_MAX_WIDTH.
+ *
+ * @param scalar
+ *     The scalar implementation of the kernel.
+ *
+ * @param kernel
+ *     The implementation of the kernel to test.
+ *
+ * @param value
+ *     The value to pass to both kernels, or UINT32_MAX to pass a random
+ *     pixel.
+ */
+static void test_row_kernel(guac_common_pixel_row_kernel* scalar,
+        guac_common_pixel_row_kernel* kernel, uint32_t value) {
+
+    uint32_t src[TEST_MAX_WIDTH];
+    uint32_t expected[TEST_MAX_WIDTH];
+    uint32_t actual[TEST_MAX_WIDTH];
+
+    int width, i;
+
+    test_random_state = 1;
+
+    for (width = 0; width <= TEST_MAX_WIDTH; width++) {
+        for (i = 0; i < TEST_ROWS; i++) {
+
+            int expected_first = -1, expected_last = -1;
+            int actual_first = -1, actual_last = -1;
+
+            uint32_t row_value = value;
+            if (value == UINT32_MAX)
+                row_value = test_random_pixel();
+
+            test_random_row(src, width);
+            test_random_row(expected, width);
+
+            /* Occasionally leave the row unchanged */
+            if (i % 8 == 0)
+                memcpy(expected, src, sizeof(uint32_t) * width);
+
+            memcpy(actual, expected, sizeof(actual));
+
+            CU_ASSERT_EQUAL(
+                scalar(expected, src, width, row_value,
+                    &expected_first, &expected_last),
+                kernel(actual, src, width, row_value,
+                    &actual_first, &actual_last));
+
+            CU_ASSERT_EQUAL(memcmp(expected, actual,
+                        sizeof(uint32_t) * width), 0);
+
+            CU_ASSERT_EQUAL(expected_first, actual_first);
+            CU_ASSERT_EQUAL(expected_last, actual_last);
+
+        }
+    }
+
+}
+
+/**
+ * Test which verifies that all available implementations of the kernels used
+ * to draw images onto surfaces match the scalar implementation.
+ */
+void test_pixel__put() {
+
+    const guac_common_pixel_kernels* scalar =
+        guac_common_pixel_get_kernels(GUAC_COMMON_PIXEL_SCALAR);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(scalar);
+
+    int isa;
+    for (isa = 0; isa < GUAC_COMMON_PIXEL_ISA_COUNT; isa++) {
+
+        const guac_common_pixel_kernels* kernels =
+            guac_common_pixel_get_kernels(isa);
+
+        if (kernels == NULL)
+            continue;
+
+        test_row_kernel(scalar->copy_opaque, kernels->copy_opaque, 0);
+        test_row_kernel(scalar->blend, kernels->blend, 0);
+        test_row_kernel(scalar->set, kernels->set, UINT32_MAX);
+
+    }
+
+}
+
+/**
+ * Test which verifies that all available implementations of the kernels
+ * implementing transfer functions match the scalar implementation for every
+ * transfer function, including when the source and destination overlap.
+ */
+void test_pixel__transfer() {
+
+    uint32_t expected[TEST_MAX_WIDTH];
+    uint32_t actual[TEST_MAX_WIDTH];
+
+    const guac_common_pixel_kernels* scalar =
+        guac_common_pixel_get_kernels(GUAC_COMMON_PIXEL_SCALAR);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(scalar);
+
+    int isa, op, shift;
+    for (isa = 0; isa < GUAC_COMMON_PIXEL_ISA_COUNT; isa++) {
+
+        const guac_common_pixel_kernels* kernels =
+            guac_common_pixel_get_kernels(isa);
+
+        if (kernels == NULL)
+            continue;
+
+        for (op = GUAC_TRANSFER_BINARY_BLACK;
+                op <= GUAC_TRANSFER_BINARY_NSRC_NOR; op++) {
+
+            test_row_kernel(scalar->transfer, kernels->transfer, op);
+            test_row_kernel(scalar->transfer_reverse,
+                    kernels->transfer_reverse, op);
+
+            /* Shift within the same row in both directions */
+            for (shift = 1; shift < 10; shift++) {
+
+                int width = TEST_MAX_WIDTH - shift;
+                int expected_first = -1, expected_last = -1;
+                int actual_first = -1, actual_last = -1;
+
+                test_random_row(expected, TEST_MAX_WIDTH);
+                memcpy(actual, expected, sizeof(actual));
+
+                scalar->transfer(expected, expected + shift, width, op,
+                        &expected_first, &expected_last);
+                kernels->transfer(actual, actual + shift, width, op,
+                        &actual_first, &actual_last);
+
+                CU_ASSERT_EQUAL(memcmp(expected, actual, sizeof(actual)), 0);
+                CU_ASSERT_EQUAL(expected_first, actual_first);
+                CU_ASSERT_EQUAL(expected_last, actual_last);
+
+                scalar->transfer_reverse(expected + shift, expected, width,
+                        op, &expected_first, &expected_last);
+                kernels->transfer_reverse(actual + shift, actual, width,
+                        op, &actual_first, &actual_last);
+
+                CU_ASSERT_EQUAL(memcmp(expected, actual, sizeof(actual)), 0);
+                CU_ASSERT_EQUAL(expected_first, actual_first);
+                CU_ASSERT_EQUAL(expected_last, actual_last);
+
+            }
+
+        }
+
+    }
+
+}
+
+/**
+ * Test which verifies that all available implementations of the kernels used
+ * to fill through masks and to analyze image data match the scalar
+ * implementation.
+ */
+void test_pixel__fill_mask_analyze() {
+
+    uint32_t mask[TEST_MAX_WIDTH];
+    uint32_t expected[TEST_MAX_WIDTH];
+    uint32_t actual[TEST_MAX_WIDTH];
+
+    const guac_common_pixel_kernels* scalar =
+        guac_common_pixel_get_kernels(GUAC_COMMON_PIXEL_SCALAR);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(scalar);
+
+    int isa, width;
+    for (isa = 0; isa < GUAC_COMMON_PIXEL_ISA_COUNT; isa++) {
+
+        const guac_common_pixel_kernels* kernels =
+            guac_common_pixel_get_kernels(isa);
+
+        if (kernels == NULL)
+            continue;
+
+        test_random_state = 1;
+
+        for (width = 0; width <= TEST_MAX_WIDTH; width++) {
+
+            int expected_same = 0, actual_same = 0;
+            uint32_t expected_alpha = 0xFFFFFFFF;
+            uint32_t actual_alpha = 0xFFFFFFFF;
+
+            test_random_row(mask, width);
+            test_random_row(expected, width);
+            memcpy(actual, expected, sizeof(actual));
+
+            scalar->fill_mask(expected, mask, width, 0xFF123456);
+            kernels->fill_mask(actual, mask, width, 0xFF123456);
+            CU_ASSERT_EQUAL(memcmp(expected, actual,
+                        sizeof(uint32_t) * width), 0);
+
+            scalar->analyze(mask, width, &expected_same, &expected_alpha);
+            kernels->analyze(mask, width, &actual_same, &actual_alpha);
+            CU_ASSERT_EQUAL(expected_same, actual_same);
+            CU_ASSERT_EQUAL(expected_alpha, actual_alpha);
+
+            /* Fully-opaque rows must remain recognizably opaque */
+            int x;
+            for (x = 0; x < width; x++)
+                mask[x] |= 0xFF000000;
+
+            actual_alpha = 0xFFFFFFFF;
+            kernels->analyze(mask, width, &actual_same, &actual_alpha);
+            CU_ASSERT_EQUAL(actual_alpha & 0xFF000000, 0xFF000000);
+
+        }
+
+    }
+
+}
+
@@ -0,0 +1,271 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "common/recording-compression.h"
+
+#include <CUnit/CUnit.h>
+#include <guacamole/socket.h>
+
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * Guacamole protocol data written to each test recording, split into the
+ * pieces in which that data is written.
+ */
+static const char* test_recording_data[] = {
+    "4.size,1.0,4.1024,3.768;",
+    "4.sync,4.1000;",
+    "4.rect,1.0,1.0,1.0,2.64,2.64;",
+    "4.sync,4.2000;",
+    NULL
+};
+
+/**
+ * Reads all data from the given guac_socket.
+ *
+ * @param socket
+ *     The socket to read from.
+ *
+ * @return
+ *     A newly-allocated, null-terminated string containing all data read.
+ */
+static char* test_recording_read_all(guac_socket* socket) {
+
+    size_t length = 0;
+    char* data = malloc(1);
+
+    for (;;) {
+
+        char buffer[7];
+        ssize_t received = guac_socket_read(socket, buffer, sizeof(buffer));
+        CU_ASSERT_FATAL(received >= 0);
+        if (received == 0)
+            break;
+
+        data = realloc(data, length + received + 1);
+        memcpy(data + length, buffer, received);
+        length += received;
+
+    }
+
+    data[length] = '\0';
+    return data;
+
+}
+
+/**
+ * Writes test_recording_data to a new temporary file, compressing that data
+ * with the given compression format, and reopens that file for reading.
+ *
+ * @param compression
+ *     The compression format to use.
+ *
+ * @return
+ *     A file descriptor for the recording, positioned at its start.
+ */
+static int test_recording_compressed(
+        guac_common_recording_compression compression) {
+
+    int i;
+
+    char path[] = "/tmp/guac_test_compression_XXXXXX";
+    int fd = mkstemp(path);
+    CU_ASSERT_NOT_EQUAL_FATAL(fd, -1);
+    unlink(path);
+
+    guac_common_recording_compressor* compressor =
+        guac_common_recording_compressor_alloc(compression, fd);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(compressor);
+
+    /* Write each piece separately, with the last two pieces together */
+    for (i = 0; test_recording_data[i + 2] != NULL; i++) {
+        struct iovec iov = {
+            .iov_base = (void*) test_recording_data[i],
+            .iov_len = strlen(test_recording_data[i])
+        };
+        CU_ASSERT_EQUAL(guac_common_recording_compressor_write(compressor,
+                    &iov, 1), 0);
+    }
+
+    struct iovec iov[2] = {
+        {
+            .iov_base = (void*) test_recording_data[i],
+            .iov_len = strlen(test_recording_data[i])
+        },
+        {
+            .iov_base = (void*) test_recording_data[i + 1],
+            .iov_len = strlen(test_recording_data[i + 1])
+        }
+    };
+    CU_ASSERT_EQUAL(guac_common_recording_compressor_write(compressor,
+                iov, 2), 0);
+
+    CU_ASSERT_EQUAL(guac_common_recording_compressor_finish(compressor), 0);
+    CU_ASSERT(compressor->bytes_in > 0);
+    CU_ASSERT(compressor->bytes_out > 0);
+    guac_common_recording_compressor_free(compressor);
+
+    CU_ASSERT_EQUAL_FATAL(lseek(fd, 0, SEEK_SET), 0);
+    return fd;
+
+}
+
+/**
+ * Returns all of test_recording_data, concatenated.
+ *
+ * @return
+ *     A newly-allocated string containing all of test_recording_data.
+ */
+static char* test_recording_expected() {
+
+    int i;
+    char* expected = calloc(1, 1024);
+
+    for (i = 0; test_recording_data[i] != NULL; i++)
+        strcat(expected, test_recording_data[i]);
+
+    return expected;
+
+}
+
+/**
+ * Test which verifies that the names of compression formats are parsed
+ * correctly.
+ */
+void test_recording__compression_parse() {
+
+    guac_common_recording_compression compression;
+
+    CU_ASSERT_EQUAL(guac_common_recording_parse_compression(NULL,
+                &compression), 0);
+    CU_ASSERT_EQUAL(compression, GUAC_COMMON_RECORDING_COMPRESSION_NONE);
+
+    CU_ASSERT_EQUAL(guac_common_recording_parse_compression("none",
+                &compression), 0);
+    CU_ASSERT_EQUAL(compression, GUAC_COMMON_RECORDING_COMPRESSION_NONE);
+
+    CU_ASSERT_EQUAL(guac_common_recording_parse_compression("gzip",
+                &compression), 0);
+    CU_ASSERT_EQUAL(compression, GUAC_COMMON_RECORDING_COMPRESSION_GZIP);
+
+    CU_ASSERT_NOT_EQUAL(guac_common_recording_parse_compression("lzma",
+                &compression), 0);
+
+}
+
+/**
+ * Test which verifies that plain recordings are read as-is, both from the
+ * start of the recording and from an arbitrary offset.
+ */
+void test_recording__compression_plain() {
+
+    char path[] = "/tmp/guac_test_compression_XXXXXX";
+    int fd = mkstemp(path);
+    CU_ASSERT_NOT_EQUAL_FATAL(fd, -1);
+    unlink(path);
+
+    char* expected = test_recording_expected();
+    CU_ASSERT_EQUAL(write(fd, expected, strlen(expected)),
+            strlen(expected));
+
+    /* Read entire recording */
+    CU_ASSERT_EQUAL_FATAL(lseek(fd, 0, SEEK_SET), 0);
+    guac_socket* socket = guac_common_recording_input_open(dup(fd), 0);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(socket);
+
+    char* data = test_recording_read_all(socket);
+    CU_ASSERT_STRING_EQUAL(data, expected);
+    guac_socket_free(socket);
+    free(data);
+
+    /* Read from offset */
+    CU_ASSERT_EQUAL_FATAL(lseek(fd, 0, SEEK_SET), 0);
+    socket = guac_common_recording_input_open(fd, 10);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(socket);
+
+    data = test_recording_read_all(socket);
+    CU_ASSERT_STRING_EQUAL(data, expected + 10);
+    guac_socket_free(socket);
+    free(data);
+
+    free(expected);
+
+}
+
+/**
+ * Test which verifies that gzip-compressed recordings are decompressed
+ * transparently, both from the start of the recording and from an offset
+ * within the uncompressed data, including recordings which are still being
+ * written and thus lack the end of the compressed stream.
+ */
+void test_recording__compression_gzip() {
+
+    /* Compression support is optional */
+    if (!guac_common_recording_compression_supported(
+                GUAC_COMMON_RECORDING_COMPRESSION_GZIP))
+        return;
+
+    char* expected = test_recording_expected();
+
+    /* Read entire recording */
+    int fd = test_recording_compressed(GUAC_COMMON_RECORDING_COMPRESSION_GZIP);
+    guac_socket* socket = guac_common_recording_input_open(fd, 0);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(socket);
+
+    char* data = test_recording_read_all(socket);
+    CU_ASSERT_STRING_EQUAL(data, expected);
+    guac_socket_free(socket);
+    free(data);
+
+    /* Read from offset */
+    fd = test_recording_compressed(GUAC_COMMON_RECORDING_COMPRESSION_GZIP);
+    socket = guac_common_recording_input_open(fd, 30);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(socket);
+
+    data = test_recording_read_all(socket);
+    CU_ASSERT_STRING_EQUAL(data, expected + 30);
+    guac_socket_free(socket);
+    free(data);
+
+    /* Offsets beyond the end of the recording cannot be reached */
+    fd = test_recording_compressed(GUAC_COMMON_RECORDING_COMPRESSION_GZIP);
+    CU_ASSERT_PTR_NULL(guac_common_recording_input_open(fd, 100000));
+    close(fd);
+
+    /* Read recording lacking the end of the compressed stream */
+    fd = test_recording_compressed(GUAC_COMMON_RECORDING_COMPRESSION_GZIP);
+    off_t length = lseek(fd, 0, SEEK_END);
+    CU_ASSERT_EQUAL_FATAL(ftruncate(fd, length - 8), 0);
+    CU_ASSERT_EQUAL_FATAL(lseek(fd, 0, SEEK_SET), 0);
+
+    socket = guac_common_recording_input_open(fd, 0);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(socket);
+
+    data = test_recording_read_all(socket);
+    CU_ASSERT_STRING_EQUAL(data, expected);
+    guac_socket_free(socket);
+    free(data);
+
+    free(expected);
+
+}
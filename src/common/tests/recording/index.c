@@ -0,0 +1,265 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "common/recording-index.h"
+
+#include <CUnit/CUnit.h>
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * Recorded Guacamole protocol data containing four timestamps, the first,
+ * third, and fourth of which are far enough apart to warrant checkpoints. The
+ * "name" instruction contains multibyte characters, whose length is measured
+ * in characters rather than bytes.
+ */
+static const char* test_recording[] = {
+    "4.size,1.0,4.1024,3.768;",
+    "4.sync,4.1000;",
+    "4.size,1.1,2.64,2.32;",
+    "4.move,1.1,1.0,2.10,2.20,1.5;",
+    "5.shade,1.1,3.128;",
+    "3.img,1.3,2.14,1.0,9.image/png,1.0,1.0;",
+    "4.name,5.caf\xC3\xA9\xE2\x82\xAC;",
+    "4.sync,4.5000;",
+    "5.mouse,2.10,2.20,1.0,5.11000;",
+    "3.end,1.3;",
+    "7.dispose,1.1;",
+    "4.sync,5.25000;",
+    NULL
+};
+
+/**
+ * Returns the byte offset of the start of the given element of
+ * test_recording.
+ *
+ * @param element
+ *     The index of the element of test_recording.
+ *
+ * @return
+ *     The total length of all elements of test_recording preceding the given
+ *     element.
+ */
+static int test_recording_offset(int element) {
+
+    int i;
+    int offset = 0;
+
+    for (i = 0; i < element; i++)
+        offset += strlen(test_recording[i]);
+
+    return offset;
+
+}
+
+/**
+ * Writes test_recording to a new temporary file, indexing it as it is
+ * written. The data is passed to the index in small pieces which do not align
+ * with instruction boundaries.
+ *
+ * @param path
+ *     A mkstemp() template for the path of the recording, which will be
+ *     replaced with the actual path.
+ *
+ * @param length
+ *     The number of bytes of test_recording to actually write to the
+ *     recording, or a negative value to write all data. All data is indexed
+ *     regardless.
+ */
+static void test_recording_write(char* path, int length) {
+
+    int i;
+
+    int fd = mkstemp(path);
+    CU_ASSERT_NOT_EQUAL_FATAL(fd, -1);
+
+    char index_path[256];
+    snprintf(index_path, sizeof(index_path), "%s%s", path,
+            GUAC_COMMON_RECORDING_INDEX_SUFFIX);
+
+    int index_fd = open(index_path, O_CREAT | O_TRUNC | O_WRONLY, 0600);
+    CU_ASSERT_NOT_EQUAL_FATAL(index_fd, -1);
+
+    guac_common_recording_index* index =
+        guac_common_recording_index_alloc(index_fd);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(index);
+
+    int written = 0;
+    for (i = 0; test_recording[i] != NULL; i++) {
+
+        const char* data = test_recording[i];
+        int remaining = strlen(data);
+
+        /* Write only the requested amount of data to the recording */
+        int to_write = remaining;
+        if (length >= 0 && written + to_write > length)
+            to_write = length > written ? length - written : 0;
+
+        CU_ASSERT_EQUAL(write(fd, data, to_write), to_write);
+        written += to_write;
+
+        /* Index data three bytes at a time */
+        while (remaining > 0) {
+            int piece = remaining < 3 ? remaining : 3;
+            guac_common_recording_index_update(index, data, piece);
+            data += piece;
+            remaining -= piece;
+        }
+
+    }
+
+    guac_common_recording_index_free(index);
+    close(fd);
+
+}
+
+/**
+ * Deletes the given recording and its index.
+ *
+ * @param path
+ *     The path of the recording.
+ */
+static void test_recording_delete(const char* path) {
+
+    char index_path[256];
+    snprintf(index_path, sizeof(index_path), "%s%s", path,
+            GUAC_COMMON_RECORDING_INDEX_SUFFIX);
+
+    unlink(index_path);
+    unlink(path);
+
+}
+
+/**
+ * Verifies that the given instruction has the given opcode and arguments.
+ *
+ * @param instruction
+ *     The instruction to verify.
+ *
+ * @param opcode
+ *     The expected opcode.
+ *
+ * @param argc
+ *     The expected number of arguments.
+ *
+ * @param argv
+ *     The expected values of each argument.
+ */
+static void test_recording_verify(
+        guac_common_recording_index_instruction* instruction,
+        const char* opcode, int argc, const char* argv[]) {
+
+    int i;
+
+    CU_ASSERT_STRING_EQUAL(instruction->opcode, opcode);
+    CU_ASSERT_EQUAL_FATAL(instruction->argc, argc);
+
+    for (i = 0; i < argc; i++)
+        CU_ASSERT_STRING_EQUAL(instruction->argv[i], argv[i]);
+
+}
+
+/**
+ * Test which verifies that the index of a recording contains checkpoints at
+ * the expected timestamps and offsets, and that each checkpoint restores the
+ * layers, buffers, and streams which existed at that point.
+ */
+void test_recording__index_checkpoints() {
+
+    char path[] = "/tmp/guac_test_recording_XXXXXX";
+    test_recording_write(path, -1);
+
+    /* The first checkpoint is the start of the recording */
+    guac_common_recording_checkpoint* checkpoint =
+        guac_common_recording_index_find(path, 0);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(checkpoint);
+    CU_ASSERT_EQUAL(checkpoint->start, 1000);
+    CU_ASSERT_EQUAL(checkpoint->timestamp, 1000);
+    CU_ASSERT_EQUAL(checkpoint->offset, test_recording_offset(1));
+    CU_ASSERT_EQUAL_FATAL(checkpoint->length, 1);
+    test_recording_verify(&checkpoint->state[0], "size", 3,
+            (const char*[]) { "0", "1024", "768" });
+    guac_common_recording_checkpoint_free(checkpoint);
+
+    /* The sync at 5000 is too soon after the previous checkpoint, so the next
+     * checkpoint is taken at the mouse event at 11000 */
+    checkpoint = guac_common_recording_index_find(path, 15000);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(checkpoint);
+    CU_ASSERT_EQUAL(checkpoint->start, 1000);
+    CU_ASSERT_EQUAL(checkpoint->timestamp, 11000);
+    CU_ASSERT_EQUAL(checkpoint->offset, test_recording_offset(8));
+    CU_ASSERT_EQUAL_FATAL(checkpoint->length, 5);
+    test_recording_verify(&checkpoint->state[0], "size", 3,
+            (const char*[]) { "0", "1024", "768" });
+    test_recording_verify(&checkpoint->state[1], "size", 3,
+            (const char*[]) { "1", "64", "32" });
+    test_recording_verify(&checkpoint->state[2], "move", 5,
+            (const char*[]) { "1", "0", "10", "20", "5" });
+    test_recording_verify(&checkpoint->state[3], "shade", 2,
+            (const char*[]) { "1", "128" });
+    test_recording_verify(&checkpoint->state[4], "stream", 1,
+            (const char*[]) { "3" });
+    guac_common_recording_checkpoint_free(checkpoint);
+
+    /* Disposed layers and ended streams are not restored */
+    checkpoint = guac_common_recording_index_find(path, 60000);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(checkpoint);
+    CU_ASSERT_EQUAL(checkpoint->timestamp, 25000);
+    CU_ASSERT_EQUAL(checkpoint->offset, test_recording_offset(11));
+    CU_ASSERT_EQUAL_FATAL(checkpoint->length, 1);
+    test_recording_verify(&checkpoint->state[0], "size", 3,
+            (const char*[]) { "0", "1024", "768" });
+    guac_common_recording_checkpoint_free(checkpoint);
+
+    test_recording_delete(path);
+
+}
+
+/**
+ * Test which verifies that checkpoints beyond the end of the recording, as
+ * may be present while a recording is still being written, are ignored.
+ */
+void test_recording__index_truncated() {
+
+    char path[] = "/tmp/guac_test_recording_XXXXXX";
+    test_recording_write(path, test_recording_offset(10));
+
+    guac_common_recording_checkpoint* checkpoint =
+        guac_common_recording_index_find(path, 60000);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(checkpoint);
+    CU_ASSERT_EQUAL(checkpoint->timestamp, 11000);
+    guac_common_recording_checkpoint_free(checkpoint);
+
+    test_recording_delete(path);
+
+}
+
+/**
+ * Test which verifies that no checkpoint is returned for a recording which
+ * has no index.
+ */
+void test_recording__index_missing() {
+    CU_ASSERT_PTR_NULL(guac_common_recording_index_find(
+                "/tmp/guac_test_recording_nonexistent", 0));
+}
+
@@ -0,0 +1,70 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "common/recording-index.h"
+
+#include <CUnit/CUnit.h>
+
+/**
+ * Test which verifies that guac_common_recording_parse_time() parses seconds,
+ * minutes and seconds, and hours, minutes, and seconds.
+ */
+void test_recording__parse_time() {
+
+    guac_timestamp time;
+
+    CU_ASSERT_EQUAL(guac_common_recording_parse_time("0", &time), 0);
+    CU_ASSERT_EQUAL(time, 0);
+
+    CU_ASSERT_EQUAL(guac_common_recording_parse_time("5", &time), 0);
+    CU_ASSERT_EQUAL(time, 5000);
+
+    CU_ASSERT_EQUAL(guac_common_recording_parse_time("90", &time), 0);
+    CU_ASSERT_EQUAL(time, 90000);
+
+    CU_ASSERT_EQUAL(guac_common_recording_parse_time("1:30", &time), 0);
+    CU_ASSERT_EQUAL(time, 90000);
+
+    CU_ASSERT_EQUAL(guac_common_recording_parse_time("47:00", &time), 0);
+    CU_ASSERT_EQUAL(time, 2820000);
+
+    CU_ASSERT_EQUAL(guac_common_recording_parse_time("1:02:03", &time), 0);
+    CU_ASSERT_EQUAL(time, 3723000);
+
+}
+
+/**
+ * Test which verifies that guac_common_recording_parse_time() rejects values
+ * which are not valid amounts of time.
+ */
+void test_recording__parse_time_invalid() {
+
+    guac_timestamp time;
+
+    CU_ASSERT_NOT_EQUAL(guac_common_recording_parse_time("", &time), 0);
+    CU_ASSERT_NOT_EQUAL(guac_common_recording_parse_time("abc", &time), 0);
+    CU_ASSERT_NOT_EQUAL(guac_common_recording_parse_time("-5", &time), 0);
+    CU_ASSERT_NOT_EQUAL(guac_common_recording_parse_time("5s", &time), 0);
+    CU_ASSERT_NOT_EQUAL(guac_common_recording_parse_time("1:", &time), 0);
+    CU_ASSERT_NOT_EQUAL(guac_common_recording_parse_time(":30", &time), 0);
+    CU_ASSERT_NOT_EQUAL(guac_common_recording_parse_time("1:60", &time), 0);
+    CU_ASSERT_NOT_EQUAL(guac_common_recording_parse_time("1:2:3:4", &time), 0);
+
+}
+
@@ -0,0 +1,256 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "common/recording-writer.h"
+
+#include <CUnit/CUnit.h>
+#include <guacamole/client.h>
+#include <guacamole/protocol.h>
+#include <guacamole/socket.h>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * The number of "sync" instructions written by each test.
+ */
+#define TEST_RECORDING_WRITER_SYNCS 1000
+
+/**
+ * The contents of a pipe, as read by test_recording_writer_read().
+ */
+typedef struct test_recording_writer_output {
+
+    /**
+     * The file descriptor of the read end of the pipe.
+     */
+    int fd;
+
+    /**
+     * All data read from the pipe.
+     */
+    char* data;
+
+    /**
+     * The number of bytes of data read from the pipe.
+     */
+    size_t length;
+
+} test_recording_writer_output;
+
+/**
+ * Thread which reads all data from the pipe described by the given
+ * test_recording_writer_output until end-of-file is reached.
+ *
+ * @param data
+ *     The test_recording_writer_output to populate.
+ *
+ * @return
+ *     Always NULL.
+ */
+static void* test_recording_writer_read(void* data) {
+
+    test_recording_writer_output* output =
+        (test_recording_writer_output*) data;
+
+    char buffer[4096];
+    ssize_t length;
+
+    while ((length = read(output->fd, buffer, sizeof(buffer))) > 0) {
+        output->data = realloc(output->data, output->length + length + 1);
+        memcpy(output->data + output->length, buffer, length);
+        output->length += length;
+        output->data[output->length] = '\0';
+    }
+
+    return NULL;
+
+}
+
+/**
+ * Writes a series of "sync" instructions having the given timestamps to the
+ * given string, formatted as Guacamole protocol data.
+ *
+ * @param buffer
+ *     The buffer to write the instructions to, which must be large enough.
+ *
+ * @param first
+ *     The timestamp of the first instruction.
+ *
+ * @param last
+ *     The timestamp of the last instruction.
+ *
+ * @return
+ *     The number of bytes written to the buffer, excluding null terminator.
+ */
+static size_t test_recording_writer_syncs(char* buffer, int first, int last) {
+
+    int i;
+    size_t length = 0;
+
+    for (i = first; i <= last; i++) {
+        char timestamp[16];
+        snprintf(timestamp, sizeof(timestamp), "%i", i);
+        length += sprintf(buffer + length, "4.sync,%zu.%s;",
+                strlen(timestamp), timestamp);
+    }
+
+    return length;
+
+}
+
+/**
+ * Test which verifies that a recording writer using
+ * GUAC_COMMON_RECORDING_OVERFLOW_BLOCK writes all data in order, even if that
+ * data is larger than the queue itself.
+ */
+void test_recording__writer_block() {
+
+    int i;
+    int fds[2];
+    CU_ASSERT_EQUAL_FATAL(pipe(fds), 0);
+
+    test_recording_writer_output output = { .fd = fds[0] };
+    pthread_t reader;
+    CU_ASSERT_EQUAL_FATAL(pthread_create(&reader, NULL,
+                test_recording_writer_read, &output), 0);
+
+    guac_client* client = calloc(1, sizeof(guac_client));
+    guac_common_recording_writer* writer = guac_common_recording_writer_alloc(
+            client, fds[1], NULL, NULL, 64,
+            GUAC_COMMON_RECORDING_OVERFLOW_BLOCK);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(writer);
+
+    guac_socket* socket = guac_common_recording_writer_socket(writer);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(socket);
+
+    for (i = 0; i < TEST_RECORDING_WRITER_SYNCS; i++)
+        guac_protocol_send_sync(socket, i);
+
+    /* Writes larger than the queue must also succeed */
+    char large[256];
+    memset(large, 'x', sizeof(large) - 1);
+    large[sizeof(large) - 1] = '\0';
+    guac_socket_write_string(socket, large);
+
+    guac_socket_free(socket);
+    pthread_join(reader, NULL);
+    close(fds[0]);
+    free(client);
+
+    char* expected = malloc(TEST_RECORDING_WRITER_SYNCS * 16 + sizeof(large));
+    size_t length = test_recording_writer_syncs(expected, 0,
+            TEST_RECORDING_WRITER_SYNCS - 1);
+    strcpy(expected + length, large);
+
+    CU_ASSERT_PTR_NOT_NULL_FATAL(output.data);
+    CU_ASSERT_STRING_EQUAL(output.data, expected);
+
+    free(expected);
+    free(output.data);
+
+}
+
+/**
+ * Test which verifies that a recording writer using
+ * GUAC_COMMON_RECORDING_OVERFLOW_DROP discards entire instructions while its
+ * queue is full, and marks the discarded data with a "gap" instruction once
+ * recording resumes.
+ */
+void test_recording__writer_drop() {
+
+    int i;
+    int fds[2];
+    CU_ASSERT_EQUAL_FATAL(pipe(fds), 0);
+
+    /* Fill the pipe such that the writer thread cannot make progress */
+    int flags = fcntl(fds[1], F_GETFL);
+    fcntl(fds[1], F_SETFL, flags | O_NONBLOCK);
+
+    size_t filler = 0;
+    while (write(fds[1], "x", 1) == 1)
+        filler++;
+
+    fcntl(fds[1], F_SETFL, flags);
+
+    guac_client* client = calloc(1, sizeof(guac_client));
+    guac_common_recording_writer* writer = guac_common_recording_writer_alloc(
+            client, fds[1], NULL, NULL, 1024,
+            GUAC_COMMON_RECORDING_OVERFLOW_DROP);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(writer);
+
+    guac_socket* socket = guac_common_recording_writer_socket(writer);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(socket);
+
+    /* Far more data is written than fits within the queue */
+    for (i = 0; i < TEST_RECORDING_WRITER_SYNCS; i++)
+        guac_protocol_send_sync(socket, i);
+
+    CU_ASSERT(guac_common_recording_writer_depth(writer) <= 1024);
+
+    /* Allow the writer thread to catch up */
+    test_recording_writer_output output = { .fd = fds[0] };
+    pthread_t reader;
+    CU_ASSERT_EQUAL_FATAL(pthread_create(&reader, NULL,
+                test_recording_writer_read, &output), 0);
+
+    while (guac_common_recording_writer_depth(writer) > 512)
+        usleep(1000);
+
+    guac_protocol_send_sync(socket, TEST_RECORDING_WRITER_SYNCS);
+
+    guac_socket_free(socket);
+    pthread_join(reader, NULL);
+    close(fds[0]);
+    free(client);
+
+    CU_ASSERT_PTR_NOT_NULL_FATAL(output.data);
+    CU_ASSERT_FATAL(output.length > filler);
+
+    /* All data prior to the gap must be complete instructions, beginning with
+     * the first instruction written */
+    char* recorded = output.data + filler;
+    char* gap = strstr(recorded, "3.gap,");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(gap);
+
+    int kept;
+    for (kept = 0; kept < TEST_RECORDING_WRITER_SYNCS; kept++) {
+        char expected[32];
+        size_t length = test_recording_writer_syncs(expected, kept, kept);
+        if (strncmp(recorded, expected, length) != 0)
+            break;
+        recorded += length;
+    }
+
+    CU_ASSERT(kept > 0);
+    CU_ASSERT(kept < TEST_RECORDING_WRITER_SYNCS);
+    CU_ASSERT_PTR_EQUAL(recorded, gap);
+
+    /* Recording resumes with the instruction following the gap */
+    char* resumed = strchr(gap, ';');
+    CU_ASSERT_PTR_NOT_NULL_FATAL(resumed);
+    CU_ASSERT_STRING_EQUAL(resumed + 1, "4.sync,4.1000;");
+
+    free(output.data);
+
+}
@@ -0,0 +1,159 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "common/surface.h"
+
+#include <CUnit/CUnit.h>
+#include <cairo/cairo.h>
+#include <guacamole/client.h>
+#include <guacamole/layer.h>
+#include <guacamole/socket.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * The width and height of each test surface, in pixels.
+ */
+#define TEST_SURFACE_SIZE 64
+
+/**
+ * The width and height of each copied rectangle, in pixels.
+ */
+#define TEST_COPY_SIZE 8
+
+/**
+ * Fills the given rectangle of the given surface with an opaque color.
+ *
+ * @param surface
+ *     The surface to draw to.
+ *
+ * @param x
+ *     The X coordinate of the upper-left corner of the rectangle.
+ *
+ * @param y
+ *     The Y coordinate of the upper-left corner of the rectangle.
+ *
+ * @param size
+ *     The width and height of the rectangle, in pixels.
+ *
+ * @param color
+ *     The color of the rectangle.
+ */
+static void test_fill(guac_common_surface* surface, int x, int y, int size,
+        uint32_t color) {
+
+    cairo_surface_t* image = cairo_image_surface_create(CAIRO_FORMAT_RGB24,
+            size, size);
+
+    int stride = cairo_image_surface_get_stride(image);
+    unsigned char* data = cairo_image_surface_get_data(image);
+
+    for (int j = 0; j < size; j++) {
+        uint32_t* row = (uint32_t*) (data + j * stride);
+        for (int i = 0; i < size; i++)
+            row[i] = 0xFF000000 | color;
+    }
+
+    cairo_surface_mark_dirty(image);
+    guac_common_surface_draw(surface, x, y, image);
+    cairo_surface_destroy(image);
+
+}
+
+/**
+ * Copies a small rectangle from a source surface into a destination surface
+ * next to a pending, unflushed update, returning whether a "copy" instruction
+ * was sent for it. The copied pixels are verified in either case.
+ *
+ * @param direct
+ *     Non-zero to copy using guac_common_surface_copy_direct(), zero to copy
+ *     using guac_common_surface_copy().
+ *
+ * @return
+ *     Non-zero if a "copy" instruction was sent, zero otherwise.
+ */
+static int test_copy_next_to_update(int direct) {
+
+    char path[] = "/tmp/guac-test-copy-XXXXXX";
+    int fd = mkstemp(path);
+    CU_ASSERT_FATAL(fd != -1);
+    unlink(path);
+
+    guac_client* client = guac_client_alloc();
+    guac_socket* socket = guac_socket_open(fd);
+
+    guac_common_surface* src = guac_common_surface_alloc(client, socket,
+            guac_client_alloc_buffer(client), TEST_SURFACE_SIZE,
+            TEST_SURFACE_SIZE);
+    guac_common_surface* dst = guac_common_surface_alloc(client, socket,
+            GUAC_DEFAULT_LAYER, TEST_SURFACE_SIZE, TEST_SURFACE_SIZE);
+    guac_common_surface_set_lossless(src, 1);
+    guac_common_surface_set_lossless(dst, 1);
+
+    /* Realize both surfaces */
+    test_fill(src, 0, 0, TEST_SURFACE_SIZE, 0x336699);
+    test_fill(dst, 0, 0, TEST_SURFACE_SIZE, 0x000000);
+    guac_common_surface_flush(src);
+    guac_common_surface_flush(dst);
+    guac_socket_flush(socket);
+    off_t offset = lseek(fd, 0, SEEK_END);
+
+    /* Copy next to a pending update small enough to be combined with it */
+    test_fill(dst, 0, 0, TEST_COPY_SIZE, 0xFFFFFF);
+    if (direct)
+        guac_common_surface_copy_direct(src, 0, 0, TEST_COPY_SIZE,
+                TEST_COPY_SIZE, dst, TEST_COPY_SIZE, 0);
+    else
+        guac_common_surface_copy(src, 0, 0, TEST_COPY_SIZE,
+                TEST_COPY_SIZE, dst, TEST_COPY_SIZE, 0);
+    guac_common_surface_flush(dst);
+    guac_socket_flush(socket);
+
+    /* Read everything sent since both surfaces were realized */
+    char output[65536];
+    ssize_t length = pread(fd, output, sizeof(output) - 1, offset);
+    CU_ASSERT_FATAL(length >= 0);
+    output[length] = '\0';
+
+    /* Copied pixels must be present regardless of how they were sent */
+    uint32_t* row = (uint32_t*) dst->buffer;
+    CU_ASSERT_EQUAL(row[0] & 0xFFFFFF, 0xFFFFFF);
+    CU_ASSERT_EQUAL(row[TEST_COPY_SIZE] & 0xFFFFFF, 0x336699);
+
+    guac_common_surface_free(src);
+    guac_common_surface_free(dst);
+    guac_socket_free(socket);
+    guac_client_free(client);
+
+    return strstr(output, "4.copy,") != NULL;
+
+}
+
+/**
+ * Tests that guac_common_surface_copy_direct() always sends a "copy"
+ * instruction, even where guac_common_surface_copy() would combine the copy
+ * with a neighboring update and resend the copied pixels as image data.
+ */
+void test_surface__copy_direct() {
+    CU_ASSERT_FALSE(test_copy_next_to_update(0));
+    CU_ASSERT_TRUE(test_copy_next_to_update(1));
+}
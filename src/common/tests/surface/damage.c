@@ -0,0 +1,302 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include "common/surface.h"
+
+#include <CUnit/CUnit.h>
+#include <cairo/cairo.h>
+#include <guacamole/client.h>
+#include <guacamole/layer.h>
+#include <guacamole/socket.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * The width and height of the test surface, in pixels.
+ */
+#define TEST_SURFACE_SIZE 256
+
+/**
+ * The file descriptor of the temporary file receiving all data written to the
+ * test socket.
+ */
+static int test_fd;
+
+/**
+ * The offset within the temporary file of the first byte not yet cleared by
+ * test_clear_written().
+ */
+static off_t written_offset;
+
+/**
+ * Buffer receiving all data written to the test socket since the written
+ * data was last cleared, as read by test_read_written().
+ */
+static char written[1048576];
+
+/**
+ * Opens a new guac_socket which writes to a new, anonymous temporary file,
+ * storing the file descriptor of that file within test_fd. The temporary
+ * file is automatically deleted when the socket is freed.
+ *
+ * @return
+ *     A new guac_socket which writes to the temporary file.
+ */
+static guac_socket* test_socket() {
+
+    char path[] = "/tmp/guac-test-damage-XXXXXX";
+
+    test_fd = mkstemp(path);
+    CU_ASSERT_FATAL(test_fd != -1);
+    unlink(path);
+
+    written_offset = 0;
+
+    return guac_socket_open(test_fd);
+
+}
+
+/**
+ * Flushes the given test socket, reading all data written to that socket
+ * since the written data was last cleared into the written buffer.
+ *
+ * @param socket
+ *     The test socket to flush.
+ */
+static void test_read_written(guac_socket* socket) {
+
+    guac_socket_flush(socket);
+
+    off_t end = lseek(test_fd, 0, SEEK_END);
+    CU_ASSERT_FATAL(end - written_offset < sizeof(written));
+
+    ssize_t length = pread(test_fd, written, end - written_offset,
+            written_offset);
+    CU_ASSERT_FATAL(length == end - written_offset);
+
+    written[length] = '\0';
+
+}
+
+/**
+ * Flushes the given test socket, clearing all data written to that socket
+ * thus far, such that only subsequently-written data is read by
+ * test_read_written().
+ *
+ * @param socket
+ *     The test socket to flush.
+ */
+static void test_clear_written(guac_socket* socket) {
+
+    guac_socket_flush(socket);
+
+    written_offset = lseek(test_fd, 0, SEEK_END);
+
+}
+
+/**
+ * Draws an opaque rectangle of the given color and size to the given surface
+ * at the given coordinates.
+ *
+ * @param surface
+ *     The surface to draw to.
+ *
+ * @param x
+ *     The X coordinate of the upper-left corner of the rectangle.
+ *
+ * @param y
+ *     The Y coordinate of the upper-left corner of the rectangle.
+ *
+ * @param size
+ *     The width and height of the rectangle, in pixels.
+ *
+ * @param color
+ *     The color of the rectangle.
+ */
+static void test_draw(guac_common_surface* surface, int x, int y, int size,
+        uint32_t color) {
+
+    cairo_surface_t* image = cairo_image_surface_create(CAIRO_FORMAT_RGB24,
+            size, size);
+
+    int stride = cairo_image_surface_get_stride(image);
+    unsigned char* data = cairo_image_surface_get_data(image);
+
+    int i, j;
+    for (j = 0; j < size; j++) {
+        uint32_t* row = (uint32_t*) (data + j * stride);
+        for (i = 0; i < size; i++)
+            row[i] = 0xFF000000 | color;
+    }
+
+    cairo_surface_mark_dirty(image);
+    guac_common_surface_draw(surface, x, y, image);
+    cairo_surface_destroy(image);
+
+}
+
+/**
+ * Returns the number of "img" instructions within the written buffer, as
+ * last read by test_read_written().
+ *
+ * @return
+ *     The number of "img" instructions written.
+ */
+static int test_count_images() {
+
+    int count = 0;
+    const char* current = written;
+
+    while ((current = strstr(current, "3.img,")) != NULL) {
+        current++;
+        count++;
+    }
+
+    return count;
+
+}
+
+/**
+ * Allocates a new lossless surface of TEST_SURFACE_SIZE pixels square which
+ * writes to the given socket.
+ *
+ * @param client
+ *     The client associated with the surface.
+ *
+ * @param socket
+ *     The socket to write to.
+ *
+ * @return
+ *     A newly-allocated surface.
+ */
+static guac_common_surface* test_surface(guac_client* client,
+        guac_socket* socket) {
+
+    guac_common_surface* surface = guac_common_surface_alloc(client, socket,
+            GUAC_DEFAULT_LAYER, TEST_SURFACE_SIZE, TEST_SURFACE_SIZE);
+    guac_common_surface_set_lossless(surface, 1);
+
+    test_clear_written(socket);
+    return surface;
+
+}
+
+/**
+ * Tests that small updates in distant corners of a surface are flushed as
+ * separate images rather than as one image covering the whole surface.
+ */
+void test_surface__damage_distant() {
+
+    guac_client* client = guac_client_alloc();
+    guac_socket* socket = test_socket();
+
+    guac_common_surface* surface = test_surface(client, socket);
+
+    test_draw(surface, 0, 0, 8, 0x112233);
+    test_draw(surface, 240, 240, 8, 0x445566);
+    guac_common_surface_flush(surface);
+    test_read_written(socket);
+
+    CU_ASSERT_EQUAL(test_count_images(), 2);
+    CU_ASSERT_PTR_NOT_NULL(strstr(written, ",9.image/png,1.0,1.0;"));
+    CU_ASSERT_PTR_NOT_NULL(strstr(written, ",9.image/png,3.240,3.240;"));
+
+    /* Nothing further should be sent once flushed */
+    test_clear_written(socket);
+    guac_common_surface_flush(surface);
+    test_read_written(socket);
+    CU_ASSERT_EQUAL(test_count_images(), 0);
+
+    guac_common_surface_free(surface);
+    guac_socket_free(socket);
+    guac_client_free(client);
+
+}
+
+/**
+ * Tests that an update spanning many heat map cells, and updates which
+ * adjoin across the boundaries of cells, are flushed as single images.
+ */
+void test_surface__damage_adjacent() {
+
+    guac_client* client = guac_client_alloc();
+    guac_socket* socket = test_socket();
+
+    guac_common_surface* surface = test_surface(client, socket);
+
+    /* One large update */
+    test_draw(surface, 0, 0, TEST_SURFACE_SIZE, 0x112233);
+    guac_common_surface_flush(surface);
+    test_read_written(socket);
+
+    CU_ASSERT_EQUAL(test_count_images(), 1);
+    CU_ASSERT_PTR_NOT_NULL(strstr(written, ",9.image/png,1.0,1.0;"));
+
+    /* A grid of updates straddling the corners of four cells */
+    test_clear_written(socket);
+    test_draw(surface, 48, 48, 16, 0x445566);
+    test_draw(surface, 64, 48, 16, 0x445566);
+    test_draw(surface, 48, 64, 16, 0x445566);
+    test_draw(surface, 64, 64, 16, 0x445566);
+    guac_common_surface_flush(surface);
+    test_read_written(socket);
+
+    CU_ASSERT_EQUAL(test_count_images(), 1);
+    CU_ASSERT_PTR_NOT_NULL(strstr(written, ",9.image/png,2.48,2.48;"));
+
+    guac_common_surface_free(surface);
+    guac_socket_free(socket);
+    guac_client_free(client);
+
+}
+
+/**
+ * Tests that changes which have not yet been flushed when a surface is
+ * resized are flushed if they remain within the bounds of the surface, and
+ * are discarded otherwise.
+ */
+void test_surface__damage_resize() {
+
+    guac_client* client = guac_client_alloc();
+    guac_socket* socket = test_socket();
+
+    guac_common_surface* surface = test_surface(client, socket);
+
+    test_draw(surface, 0, 0, 8, 0x112233);
+    test_draw(surface, 240, 240, 8, 0x445566);
+    guac_common_surface_resize(surface, TEST_SURFACE_SIZE / 2,
+            TEST_SURFACE_SIZE / 2);
+
+    test_clear_written(socket);
+    guac_common_surface_flush(surface);
+    test_read_written(socket);
+
+    CU_ASSERT_EQUAL(test_count_images(), 1);
+    CU_ASSERT_PTR_NOT_NULL(strstr(written, ",9.image/png,1.0,1.0;"));
+
+    guac_common_surface_free(surface);
+    guac_socket_free(socket);
+    guac_client_free(client);
+
+}
+
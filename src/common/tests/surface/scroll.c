@@ -0,0 +1,231 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "common/surface.h"
+
+#include <CUnit/CUnit.h>
+#include <cairo/cairo.h>
+#include <guacamole/client.h>
+#include <guacamole/layer.h>
+#include <guacamole/socket.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * The width and height of the test surface, in pixels.
+ */
+#define TEST_SURFACE_SIZE 256
+
+/**
+ * The width and height of a test surface too small to be checked for
+ * scrolling, in pixels.
+ */
+#define TEST_SMALL_SURFACE_SIZE 96
+
+/**
+ * The number of pixels by which test content is scrolled.
+ */
+#define TEST_SCROLL 16
+
+/**
+ * Returns the color of the pixel at the given coordinates of the test
+ * pattern. Every row and column of the pattern is distinct.
+ */
+static uint32_t test_pattern(int x, int y) {
+    return 0xFF000000 | ((x * 7919 + y * 104729) & 0xFFFFFF);
+}
+
+/**
+ * Allocates a new opaque image containing the test pattern, offset by the
+ * given amount.
+ *
+ * @param size
+ *     The width and height of the image, in pixels.
+ *
+ * @param dx
+ *     The horizontal offset of the pattern.
+ *
+ * @param dy
+ *     The vertical offset of the pattern.
+ *
+ * @return
+ *     A newly-allocated image, which must eventually be destroyed with
+ *     cairo_surface_destroy().
+ */
+static cairo_surface_t* test_image(int size, int dx, int dy) {
+
+    cairo_surface_t* image = cairo_image_surface_create(CAIRO_FORMAT_RGB24,
+            size, size);
+
+    int stride = cairo_image_surface_get_stride(image);
+    unsigned char* data = cairo_image_surface_get_data(image);
+
+    int x, y;
+    for (y = 0; y < size; y++) {
+        uint32_t* row = (uint32_t*) (data + y * stride);
+        for (x = 0; x < size; x++)
+            row[x] = test_pattern(x + dx, y + dy);
+    }
+
+    cairo_surface_mark_dirty(image);
+    return image;
+
+}
+
+/**
+ * Draws the test pattern to a new surface, and then draws the same pattern
+ * again offset by the given amount, verifying that the surface contains
+ * exactly the second image and returning everything sent for the second
+ * draw.
+ *
+ * @param size
+ *     The width and height of the surface, in pixels.
+ *
+ * @param dx
+ *     The horizontal offset of the second draw.
+ *
+ * @param dy
+ *     The vertical offset of the second draw.
+ *
+ * @return
+ *     A newly-allocated, null-terminated string containing all data sent for
+ *     the second draw, which must eventually be freed with free().
+ */
+static char* test_surface_scroll(int size, int dx, int dy) {
+
+    int x, y;
+
+    char path[] = "/tmp/guac-test-scroll-XXXXXX";
+    int fd = mkstemp(path);
+    CU_ASSERT_FATAL(fd != -1);
+    unlink(path);
+
+    guac_client* client = guac_client_alloc();
+    guac_socket* socket = guac_socket_open(fd);
+
+    guac_common_surface* surface = guac_common_surface_alloc(client, socket,
+            GUAC_DEFAULT_LAYER, size, size);
+    guac_common_surface_set_lossless(surface, 1);
+
+    /* Draw original content */
+    cairo_surface_t* original = test_image(size, 0, 0);
+    guac_common_surface_draw(surface, 0, 0, original);
+    guac_common_surface_flush(surface);
+    cairo_surface_destroy(original);
+    guac_socket_flush(socket);
+    off_t offset = lseek(fd, 0, SEEK_END);
+
+    /* Draw scrolled content */
+    cairo_surface_t* scrolled = test_image(size, dx, dy);
+    guac_common_surface_draw(surface, 0, 0, scrolled);
+    guac_common_surface_flush(surface);
+    cairo_surface_destroy(scrolled);
+    guac_socket_flush(socket);
+
+    /* Read everything sent for the scrolled content */
+    off_t end = lseek(fd, 0, SEEK_END);
+    char* output = malloc(end - offset + 1);
+    ssize_t length = pread(fd, output, end - offset, offset);
+    CU_ASSERT_FATAL(length == end - offset);
+    output[length] = '\0';
+
+    /* Surface must contain exactly the scrolled content */
+    for (y = 0; y < size; y++) {
+        uint32_t* row = (uint32_t*) (surface->buffer + y * surface->stride);
+        for (x = 0; x < size; x++)
+            CU_ASSERT_EQUAL_FATAL(row[x], test_pattern(x + dx, y + dy));
+    }
+
+    guac_common_surface_free(surface);
+    guac_socket_free(socket);
+    guac_client_free(client);
+
+    return output;
+
+}
+
+/**
+ * Verifies that content scrolled by the given amount is sent as a copy of
+ * existing content plus an image of only the newly-exposed strip.
+ *
+ * @param dx
+ *     The horizontal offset of the scrolled content.
+ *
+ * @param dy
+ *     The vertical offset of the scrolled content.
+ *
+ * @param expected_img
+ *     The portion of the "img" instruction expected to be sent for the
+ *     newly-exposed strip, including its destination coordinates.
+ */
+static void test_surface_scroll_copied(int dx, int dy,
+        const char* expected_img) {
+
+    char* output = test_surface_scroll(TEST_SURFACE_SIZE, dx, dy);
+
+    /* Existing content should be copied, followed by only the new strip */
+    char* copy = strstr(output, "4.copy,");
+    CU_ASSERT_PTR_NOT_NULL(copy);
+    if (copy != NULL)
+        CU_ASSERT_PTR_NOT_NULL(strstr(copy, expected_img));
+
+    free(output);
+
+}
+
+/**
+ * Tests that content scrolled upwards is copied rather than resent.
+ */
+void test_surface__scroll_vertical() {
+    test_surface_scroll_copied(0, TEST_SCROLL, ",9.image/png,1.0,3.240;");
+}
+
+/**
+ * Tests that content scrolled leftwards is copied rather than resent.
+ */
+void test_surface__scroll_horizontal() {
+    test_surface_scroll_copied(TEST_SCROLL, 0, ",9.image/png,3.240,1.0;");
+}
+
+/**
+ * Tests that content scrolled downwards is copied rather than resent.
+ */
+void test_surface__scroll_reverse() {
+    test_surface_scroll_copied(0, -TEST_SCROLL, ",9.image/png,1.0,1.0;");
+}
+
+
+/**
+ * Tests that draws too small to be worth checking for scrolled content are
+ * sent as image data without any copy.
+ */
+void test_surface__scroll_small() {
+
+    char* output = test_surface_scroll(TEST_SMALL_SURFACE_SIZE, 0,
+            TEST_SCROLL);
+
+    CU_ASSERT_PTR_NULL(strstr(output, "4.copy,"));
+    CU_ASSERT_PTR_NOT_NULL(strstr(output, ",9.image/png,1.0,1.0;"));
+
+    free(output);
+
+}
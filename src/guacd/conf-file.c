@@ -26,6 +26,7 @@
 #include <guacamole/client.h>
 
 #include <errno.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -60,6 +61,101 @@ static int guacd_conf_callback(const char* section, const char* param, const cha
             return 0;
         }
 
+        /* Per-user output queue size */
+        else if (strcmp(param, "output_queue_size") == 0) {
+
+            char* end;
+            long size = strtol(value, &end, 10);
+
+            /* Invalid size */
+            if (*value == '\0' || *end != '\0' || size < 0 || size > INT_MAX) {
+                guacd_conf_parse_error = "Invalid output queue size. The size must be a non-negative number of bytes.";
+                return 1;
+            }
+
+            config->output_queue_size = size;
+            return 0;
+
+        }
+
+        /* Per-user output queue overflow policy */
+        else if (strcmp(param, "output_queue_policy") == 0) {
+
+            int policy = guacd_parse_queue_policy(value);
+
+            /* Invalid policy */
+            if (policy < 0) {
+                guacd_conf_parse_error = "Invalid output queue policy. Valid policies are: \"resync\" and \"disconnect\".";
+                return 1;
+            }
+
+            config->output_queue_policy = policy;
+            return 0;
+
+        }
+
+        /* Per-connection image encoding threads */
+        else if (strcmp(param, "encoder_threads") == 0) {
+
+            int threads = guacd_parse_encoder_threads(value);
+
+            /* Invalid number of threads */
+            if (threads < 0) {
+                guacd_conf_parse_error = "Invalid number of encoder threads. The number of threads must be \"auto\" or a non-negative number.";
+                return 1;
+            }
+
+            config->encoder_threads = threads;
+            return 0;
+
+        }
+
+        /* PNG compression level */
+        else if (strcmp(param, "png_compression_level") == 0) {
+
+            char* end;
+            long level = strtol(value, &end, 10);
+
+            /* Invalid level */
+            if (*value == '\0' || *end != '\0' || level < 0 || level > 9) {
+                guacd_conf_parse_error = "Invalid PNG compression level. The level must be a number from 0 to 9.";
+                return 1;
+            }
+
+            config->png_compression_level = level;
+            return 0;
+
+        }
+
+        /* PNG compression strategy */
+        else if (strcmp(param, "png_compression_strategy") == 0) {
+
+            int strategy = guacd_parse_png_strategy(value);
+
+            /* Invalid strategy */
+            if (strategy < 0) {
+                guacd_conf_parse_error = "Invalid PNG compression strategy. Valid strategies are: \"default\", \"filtered\", \"rle\", and \"huffman\".";
+                return 1;
+            }
+
+            config->png_strategy = strategy;
+            return 0;
+
+        }
+
+        /* Processes started in advance of any connection */
+        else if (strcmp(param, "prefork") == 0) {
+
+            /* Invalid list of protocols */
+            if (guacd_parse_prefork(config, value)) {
+                guacd_conf_parse_error = "Invalid prefork list. The list must be a comma-separated list of PROTOCOL:COUNT pairs, where each COUNT is between 1 and 64.";
+                return 1;
+            }
+
+            return 0;
+
+        }
+
     }
 
     /* Options related to daemon startup */
@@ -182,6 +278,12 @@ guacd_config* guacd_conf_load() {
     conf->foreground = 0;
     conf->print_version = 0;
     conf->max_log_level = GUAC_LOG_INFO;
+    conf->output_queue_size = GUAC_CLIENT_DEFAULT_OUTPUT_QUEUE_SIZE;
+    conf->output_queue_policy = GUAC_CLIENT_QUEUE_RESYNC;
+    conf->encoder_threads = GUAC_CLIENT_DEFAULT_ENCODER_THREADS;
+    conf->png_compression_level = GUAC_CLIENT_DEFAULT_PNG_COMPRESSION_LEVEL;
+    conf->png_strategy = GUAC_CLIENT_PNG_DEFAULT;
+    conf->prefork_count = 0;
 
 #ifdef ENABLE_SSL
     conf->cert_file = NULL;
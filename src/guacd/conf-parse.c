@@ -25,7 +25,9 @@
 #include <guacamole/client.h>
 
 #include <ctype.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 /*
  * Simple recursive descent parser for an INI-like conf file grammar.  The
@@ -535,3 +537,116 @@ int guacd_parse_log_level(const char* name) {
 
 }
 
+int guacd_parse_queue_policy(const char* name) {
+
+    /* Translate output queue policy name */
+    if (strcmp(name, "resync")     == 0) return GUAC_CLIENT_QUEUE_RESYNC;
+    if (strcmp(name, "disconnect") == 0) return GUAC_CLIENT_QUEUE_DISCONNECT;
+
+    /* No such policy */
+    return -1;
+
+}
+
+int guacd_parse_png_strategy(const char* name) {
+
+    /* Translate PNG compression strategy name */
+    if (strcmp(name, "default")  == 0) return GUAC_CLIENT_PNG_DEFAULT;
+    if (strcmp(name, "filtered") == 0) return GUAC_CLIENT_PNG_FILTERED;
+    if (strcmp(name, "rle")      == 0) return GUAC_CLIENT_PNG_RLE;
+    if (strcmp(name, "huffman")  == 0) return GUAC_CLIENT_PNG_HUFFMAN;
+
+    /* No such strategy */
+    return -1;
+
+}
+
+int guacd_parse_encoder_threads(const char* value) {
+
+    /* Automatically use one thread per processor */
+    if (strcmp(value, "auto") == 0) {
+
+        long processors = sysconf(_SC_NPROCESSORS_ONLN);
+
+        /* Threads are pointless without multiple processors */
+        if (processors <= 1)
+            return 0;
+
+        if (processors > GUACD_MAX_AUTO_ENCODER_THREADS)
+            return GUACD_MAX_AUTO_ENCODER_THREADS;
+
+        return processors;
+
+    }
+
+    char* end;
+    long threads = strtol(value, &end, 10);
+
+    /* Reject anything other than a non-negative integer */
+    if (*value == '\0' || *end != '\0' || threads < 0
+            || threads > GUAC_CLIENT_MAX_STREAMS)
+        return -1;
+
+    return threads;
+
+}
+
+int guacd_parse_prefork(guacd_config* config, const char* value) {
+
+    int count = 0;
+    const char* current = value;
+
+    /* An empty list disables starting processes in advance */
+    if (*current == '\0') {
+        config->prefork_count = 0;
+        return 0;
+    }
+
+    for (;;) {
+
+        /* Refuse to parse more protocols than can be stored */
+        if (count == GUACD_PREFORK_MAX_PROTOCOLS)
+            return 1;
+
+        guacd_prefork_protocol* protocol = &config->prefork[count];
+
+        /* Protocol name extends up to the size separator */
+        const char* separator = strchr(current, ':');
+        if (separator == NULL)
+            return 1;
+
+        int length = separator - current;
+        if (length <= 0
+                || length >= GUACD_PREFORK_MAX_PROTOCOL_LENGTH
+                || memchr(current, ',', length) != NULL)
+            return 1;
+
+        memcpy(protocol->name, current, length);
+        protocol->name[length] = '\0';
+
+        /* Size must be a positive integer within range */
+        char* end;
+        long size = strtol(separator + 1, &end, 10);
+        if (end == separator + 1 || size <= 0
+                || size > GUACD_PREFORK_MAX_SIZE)
+            return 1;
+
+        protocol->size = size;
+        count++;
+
+        /* Continue with next pair, if any */
+        if (*end == '\0')
+            break;
+
+        if (*end != ',')
+            return 1;
+
+        current = end + 1;
+
+    }
+
+    config->prefork_count = count;
+    return 0;
+
+}
+
@@ -20,6 +20,10 @@
 #ifndef _GUACD_CONF_PARSE_H
 #define _GUACD_CONF_PARSE_H
 
+#include "config.h"
+
+#include "conf.h"
+
 /**
  * The maximum length of a name, in characters.
  */
@@ -53,6 +57,51 @@ int guacd_parse_conf(guacd_param_callback* callback, char* buffer, int length, v
  */
 int guacd_parse_log_level(const char* name);
 
+/**
+ * Parses the given output queue policy name, returning the corresponding
+ * guac_client_queue_policy, or -1 if no such policy exists.
+ */
+int guacd_parse_queue_policy(const char* name);
+
+/**
+ * Parses the given PNG compression strategy name, returning the
+ * corresponding guac_client_png_strategy, or -1 if no such strategy exists.
+ */
+int guacd_parse_png_strategy(const char* name);
+
+/**
+ * The maximum number of image encoding threads which will be used per
+ * connection if the number of threads is chosen automatically.
+ */
+#define GUACD_MAX_AUTO_ENCODER_THREADS 8
+
+/**
+ * Parses the given number of image encoding threads, which may be either a
+ * non-negative integer or "auto", returning the corresponding number of
+ * threads, or -1 if the value is invalid. If "auto", one thread is used per
+ * online processor, up to GUACD_MAX_AUTO_ENCODER_THREADS, unless only one
+ * processor is online, in which case zero is returned (encode serially).
+ */
+int guacd_parse_encoder_threads(const char* value);
+
+/**
+ * Parses the given comma-separated list of protocol/size pairs, each of the
+ * form "PROTOCOL:SIZE", storing the number of idle processes which should be
+ * started in advance for each protocol within the given configuration. An
+ * empty value disables starting processes in advance.
+ *
+ * @param config
+ *     The configuration to store the parsed list within.
+ *
+ * @param value
+ *     The list to parse, such as "rdp:4,ssh:2".
+ *
+ * @return
+ *     Zero if the list was parsed successfully, non-zero if the list is
+ *     invalid.
+ */
+int guacd_parse_prefork(guacd_config* config, const char* value);
+
 /**
  * Human-readable description of the current error, if any.
  */
@@ -24,6 +24,43 @@
 
 #include <guacamole/client.h>
 
+/**
+ * The maximum number of distinct protocols for which processes may be started
+ * in advance of any connection.
+ */
+#define GUACD_PREFORK_MAX_PROTOCOLS 16
+
+/**
+ * The maximum length of the name of any protocol for which processes may be
+ * started in advance, including null terminator.
+ */
+#define GUACD_PREFORK_MAX_PROTOCOL_LENGTH 64
+
+/**
+ * The maximum number of idle processes which may be kept started in advance
+ * for any single protocol.
+ */
+#define GUACD_PREFORK_MAX_SIZE 64
+
+/**
+ * The number of idle processes which should be kept started in advance for a
+ * particular protocol.
+ */
+typedef struct guacd_prefork_protocol {
+
+    /**
+     * The name of the protocol, as would be given within the "select"
+     * instruction of a new connection.
+     */
+    char name[GUACD_PREFORK_MAX_PROTOCOL_LENGTH];
+
+    /**
+     * The number of idle processes to keep started for this protocol.
+     */
+    int size;
+
+} guacd_prefork_protocol;
+
 /**
  * The contents of a guacd configuration file.
  */
@@ -71,6 +108,48 @@ typedef struct guacd_config {
      */
     guac_client_log_level max_log_level;
 
+    /**
+     * The maximum number of bytes of broadcast data which may be queued for
+     * each user of each connection, or zero to write broadcast data to all
+     * users synchronously.
+     */
+    int output_queue_size;
+
+    /**
+     * What should happen when the output queue of a user overflows.
+     */
+    guac_client_queue_policy output_queue_policy;
+
+    /**
+     * The number of threads each connection should use to encode image data,
+     * or zero to encode image data serially.
+     */
+    int encoder_threads;
+
+    /**
+     * The zlib compression level of palette-based PNG images sent by each
+     * connection, from 0 (no compression) to 9 (best compression).
+     */
+    int png_compression_level;
+
+    /**
+     * The strategy each connection should use to compress palette-based PNG
+     * images.
+     */
+    guac_client_png_strategy png_strategy;
+
+    /**
+     * The protocols for which processes should be started in advance of any
+     * connection, along with the number of idle processes to maintain for
+     * each.
+     */
+    guacd_prefork_protocol prefork[GUACD_PREFORK_MAX_PROTOCOLS];
+
+    /**
+     * The number of protocols within the prefork array.
+     */
+    int prefork_count;
+
 } guacd_config;
 
 #endif
@@ -24,6 +24,8 @@
 #include "move-fd.h"
 #include "proc.h"
 #include "proc-map.h"
+#include "proc-pool.h"
+#include "relay.h"
 
 #include <guacamole/client.h>
 #include <guacamole/error.h>
@@ -158,13 +160,18 @@ void* guacd_connection_io_thread(void* data) {
 
 /**
  * Adds the given socket as a new user to the given process, automatically
- * reading/writing from the socket via read/write threads. The given socket,
+ * reading/writing from the socket via the shared relay threads, or via
+ * dedicated read/write threads if the relay is unavailable. The given socket,
  * parser, and any associated resources will be freed unless the user is not
  * added successfully.
  *
  * If adding the user fails for any reason, non-zero is returned. Zero is
  * returned upon success.
  *
+ * @param connection
+ *     The parameters of the connection thread handling the user's inbound
+ *     connection, including the relay and the user's file descriptor.
+ *
  * @param proc
  *     The existing process to add the user to.
  *
@@ -179,7 +186,8 @@ void* guacd_connection_io_thread(void* data) {
  * @return
  *     Zero if the user was added successfully, non-zero if an error occurred.
  */
-static int guacd_add_user(guacd_proc* proc, guac_parser* parser, guac_socket* socket) {
+static int guacd_add_user(guacd_connection_thread_params* connection,
+        guacd_proc* proc, guac_parser* parser, guac_socket* socket) {
 
     int sockets[2];
 
@@ -201,6 +209,18 @@ static int guacd_add_user(guacd_proc* proc, guac_parser* parser, guac_socket* so
     /* Close our end of the process file descriptor */
     close(proc_fd);
 
+    int secure = 0;
+#ifdef ENABLE_SSL
+    secure = (connection->ssl_context != NULL);
+#endif
+
+    /* Relay data using shared relay threads, if possible */
+    if (connection->relay != NULL && !guacd_relay_add(connection->relay,
+                parser, socket, connection->connected_socket_fd, secure,
+                user_fd))
+        return 0;
+
+    /* Otherwise, start dedicated I/O thread */
     guacd_connection_io_thread_params* params = malloc(sizeof(guacd_connection_io_thread_params));
     params->parser = parser;
     params->socket = socket;
@@ -224,8 +244,11 @@ static int guacd_add_user(guacd_proc* proc, guac_parser* parser, guac_socket* so
  * The socket provided will be automatically freed when the connection
  * terminates unless routing fails, in which case non-zero is returned.
  *
- * @param map
- *     The map of existing client processes.
+ * @param params
+ *     The parameters of the connection thread handling the connection,
+ *     including the map of existing client processes and the pool of
+ *     processes started in advance, from which a process for a new
+ *     connection should be claimed, if available.
  *
  * @param socket
  *     The socket associated with the new connection that must be routed to
@@ -235,7 +258,11 @@ static int guacd_add_user(guacd_proc* proc, guac_parser* parser, guac_socket* so
  *     Zero if the connection was successfully routed, non-zero if routing has
  *     failed.
  */
-static int guacd_route_connection(guacd_proc_map* map, guac_socket* socket) {
+static int guacd_route_connection(guacd_connection_thread_params* params,
+        guac_socket* socket) {
+
+    guacd_proc_map* map = params->map;
+    guacd_proc_pool* pool = params->pool;
 
     guac_parser* parser = guac_parser_alloc();
 
@@ -294,8 +321,16 @@ static int guacd_route_connection(guacd_proc_map* map, guac_socket* socket) {
         guacd_log(GUAC_LOG_INFO, "Creating new client for protocol \"%s\"",
                 identifier);
 
-        /* Create new process */
-        proc = guacd_create_proc(identifier);
+        /* Claim process started in advance, if available */
+        proc = guacd_proc_pool_take(pool, identifier);
+        if (proc != NULL)
+            guacd_log(GUAC_LOG_DEBUG, "Using process started in advance "
+                    "for protocol \"%s\"", identifier);
+
+        /* Otherwise, create new process */
+        else
+            proc = guacd_create_proc(identifier);
+
         new_process = 1;
 
     }
@@ -308,7 +343,7 @@ static int guacd_route_connection(guacd_proc_map* map, guac_socket* socket) {
     }
 
     /* Add new user (in the case of a new process, this will be the owner */
-    int add_user_failed = guacd_add_user(proc, parser, socket);
+    int add_user_failed = guacd_add_user(params, proc, parser, socket);
 
     /* If new process was created, manage that process */
     if (new_process) {
@@ -362,7 +397,6 @@ void* guacd_connection_thread(void* data) {
 
     guacd_connection_thread_params* params = (guacd_connection_thread_params*) data;
 
-    guacd_proc_map* map = params->map;
     int connected_socket_fd = params->connected_socket_fd;
 
     guac_socket* socket;
@@ -390,7 +424,7 @@ void* guacd_connection_thread(void* data) {
 #endif
 
     /* Route connection according to Guacamole, creating a new process if needed */
-    if (guacd_route_connection(map, socket))
+    if (guacd_route_connection(params, socket))
         guac_socket_free(socket);
 
     free(params);
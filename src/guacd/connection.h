@@ -23,6 +23,8 @@
 #include "config.h"
 
 #include "proc-map.h"
+#include "proc-pool.h"
+#include "relay.h"
 
 #ifdef ENABLE_SSL
 #include <openssl/ssl.h>
@@ -38,6 +40,18 @@ typedef struct guacd_connection_thread_params {
      */
     guacd_proc_map* map;
 
+    /**
+     * The shared pool of processes started in advance of any connection.
+     */
+    guacd_proc_pool* pool;
+
+    /**
+     * The shared relay which should relay data between users and their
+     * connection processes, or NULL if each user should instead be relayed
+     * by dedicated threads.
+     */
+    guacd_relay* relay;
+
 #ifdef ENABLE_SSL
     /**
      * SSL context for encrypted connections to guacd. If SSL is not active,
@@ -63,7 +77,9 @@ typedef struct guacd_connection_thread_params {
  *
  * @param data
  *     A pointer to a guacd_connection_thread_params structure containing the
- *     shared overall map of currently-connected processes, the file
+ *     shared overall map of currently-connected processes, the pool of
+ *     processes started in advance of any connection, the shared relay, the
+ *     file
  *     descriptor associated with the newly-established connection that is to
  *     be either (1) associated with a new process or (2) passed on to an
  *     existing process, and the SSL context for the encryption surrounding
@@ -24,7 +24,10 @@
 #include "conf-file.h"
 #include "connection.h"
 #include "log.h"
+#include "proc.h"
 #include "proc-map.h"
+#include "proc-pool.h"
+#include "relay.h"
 
 #ifdef ENABLE_SSL
 #include <openssl/ssl.h>
@@ -289,6 +292,15 @@ int main(int argc, char* argv[]) {
 
     /* Init logging as early as possible */
     guacd_log_level = config->max_log_level;
+
+    /* Apply output queue configuration to all future connections */
+    guacd_output_queue_size = config->output_queue_size;
+    guacd_output_queue_policy = config->output_queue_policy;
+
+    /* Apply image encoding configuration to all future connections */
+    guacd_encoder_threads = config->encoder_threads;
+    guacd_png_compression_level = config->png_compression_level;
+    guacd_png_strategy = config->png_strategy;
     openlog(GUACD_LOG_NAME, LOG_PID, LOG_DAEMON);
 
     /* Log start */
@@ -452,6 +464,14 @@ int main(int argc, char* argv[]) {
                 "Child processes may pile up in the process table.");
     }
 
+    /* Start processes in advance of any connection, if requested. This must
+     * occur after daemonizing, as idle processes exit if their parent does. */
+    guacd_proc_pool* pool = guacd_proc_pool_alloc(config->prefork,
+            config->prefork_count);
+
+    /* Relay all user data using a fixed set of threads, if supported */
+    guacd_relay* relay = guacd_relay_alloc();
+
     /* Log listening status */
     guacd_log(GUAC_LOG_INFO, "Listening on host %s, port %s", bound_address, bound_port);
 
@@ -487,6 +507,8 @@ int main(int argc, char* argv[]) {
         }
 
         params->map = map;
+        params->pool = pool;
+        params->relay = relay;
         params->connected_socket_fd = connected_socket_fd;
 
 #ifdef ENABLE_SSL
@@ -499,6 +521,9 @@ int main(int argc, char* argv[]) {
 
     }
 
+    /* Terminate idle processes */
+    guacd_proc_pool_free(pool);
+
     /* Close socket */
     if (close(socket_fd) < 0) {
         guacd_log(GUAC_LOG_ERROR, "Could not close socket: %s", strerror(errno));
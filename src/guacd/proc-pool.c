@@ -0,0 +1,304 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+
+#include "conf.h"
+#include "log.h"
+#include "proc.h"
+#include "proc-pool.h"
+
+#include <guacamole/client.h>
+
+#include <poll.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * Frees the given idle process, which must have already been removed from
+ * its pool. Idle processes have no users and exit on their own once their
+ * end of the process socket is closed, so no signal is sent, avoiding any
+ * chance of signalling an unrelated process which has reused the PID.
+ *
+ * @param proc
+ *     The idle process to free.
+ */
+static void guacd_proc_pool_discard(guacd_proc* proc) {
+
+    shutdown(proc->fd_socket, SHUT_RDWR);
+    close(proc->fd_socket);
+
+    guac_client_free(proc->client);
+    free(proc);
+
+}
+
+/**
+ * Returns whether the given idle process is still running. Idle processes
+ * never write to the process socket, so any pending event on that socket
+ * can only be the EOF (or error) resulting from the process having
+ * terminated and its end of the socket having been closed. Unlike checking
+ * the PID, this cannot be fooled by the PID being reused after guacd (which
+ * ignores SIGCHLD) automatically reaps the process.
+ *
+ * @param proc
+ *     The process to check.
+ *
+ * @return
+ *     Non-zero if the process is still running or its state cannot currently
+ *     be checked, zero if the process has terminated.
+ */
+static int guacd_proc_pool_is_running(guacd_proc* proc) {
+
+    struct pollfd fd_state = {
+        .fd = proc->fd_socket,
+        .events = POLLIN
+    };
+
+    return poll(&fd_state, 1, 0) <= 0;
+
+}
+
+/**
+ * Removes and frees all idle processes within the given entry which are no
+ * longer running. If any such processes are found, further processes will
+ * not be started for the entry's protocol until GUACD_PROC_POOL_RETRY_INTERVAL
+ * seconds have elapsed. The lock of the pool containing the entry must be
+ * held.
+ *
+ * @param entry
+ *     The entry to remove terminated processes from.
+ *
+ * @param now
+ *     The current time.
+ */
+static void guacd_proc_pool_prune(guacd_proc_pool_entry* entry, time_t now) {
+
+    int i;
+    int running = 0;
+
+    for (i = 0; i < entry->idle_count; i++) {
+
+        guacd_proc* proc = entry->idle[i];
+
+        /* Retain running processes, preserving order */
+        if (guacd_proc_pool_is_running(proc)) {
+            entry->idle[running++] = proc;
+            continue;
+        }
+
+        guacd_log(GUAC_LOG_WARNING, "Process started in advance for "
+                "protocol \"%s\" terminated unexpectedly. Further processes "
+                "will not be started for this protocol for %i seconds.",
+                entry->protocol, GUACD_PROC_POOL_RETRY_INTERVAL);
+
+        entry->retry_after = now + GUACD_PROC_POOL_RETRY_INTERVAL;
+        guacd_proc_pool_discard(proc);
+
+    }
+
+    entry->idle_count = running;
+
+}
+
+/**
+ * Starts new processes as needed to maintain the number of idle processes of
+ * each protocol within a pool, until that pool is freed.
+ *
+ * @param data
+ *     A pointer to the guacd_proc_pool to maintain.
+ *
+ * @return
+ *     Always NULL.
+ */
+static void* guacd_proc_pool_refill_thread(void* data) {
+
+    guacd_proc_pool* pool = (guacd_proc_pool*) data;
+    int i;
+
+    pthread_mutex_lock(&pool->lock);
+
+    while (!pool->stopping) {
+
+        time_t now = time(NULL);
+
+        for (i = 0; i < pool->entry_count && !pool->stopping; i++) {
+
+            guacd_proc_pool_entry* entry = &pool->entries[i];
+            guacd_proc_pool_prune(entry, now);
+
+            /* Start processes until the entry is full, unless backing off
+             * after a failure */
+            while (!pool->stopping && entry->idle_count < entry->size
+                    && now >= entry->retry_after) {
+
+                /* Do not block claims while forking */
+                pthread_mutex_unlock(&pool->lock);
+                guacd_proc* proc = guacd_create_proc(entry->protocol);
+                pthread_mutex_lock(&pool->lock);
+
+                if (proc == NULL) {
+                    entry->retry_after = now + GUACD_PROC_POOL_RETRY_INTERVAL;
+                    break;
+                }
+
+                /* Claims may have occurred while forking, but never
+                 * additions, thus there is always room */
+                entry->idle[entry->idle_count++] = proc;
+
+                guacd_log(GUAC_LOG_DEBUG, "Started process for protocol "
+                        "\"%s\" in advance (%i of %i idle)", entry->protocol,
+                        entry->idle_count, entry->size);
+
+            }
+
+        }
+
+        if (pool->stopping)
+            break;
+
+        /* Wait for claims, periodically checking idle processes */
+        struct timeval current_time;
+        gettimeofday(&current_time, NULL);
+
+        struct timespec deadline = {
+            .tv_sec  = current_time.tv_sec + GUACD_PROC_POOL_CHECK_INTERVAL,
+            .tv_nsec = current_time.tv_usec * 1000
+        };
+
+        pthread_cond_timedwait(&pool->modified, &pool->lock, &deadline);
+
+    }
+
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+
+}
+
+guacd_proc_pool* guacd_proc_pool_alloc(const guacd_prefork_protocol* protocols,
+        int count) {
+
+    int i;
+
+    guacd_proc_pool* pool = calloc(1, sizeof(guacd_proc_pool));
+    if (pool == NULL)
+        return NULL;
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->modified, NULL);
+
+    /* Init an entry for each protocol */
+    for (i = 0; i < count && i < GUACD_PREFORK_MAX_PROTOCOLS; i++) {
+        guacd_proc_pool_entry* entry = &pool->entries[i];
+        strncpy(entry->protocol, protocols[i].name, sizeof(entry->protocol) - 1);
+        entry->size = protocols[i].size;
+    }
+
+    pool->entry_count = i;
+
+    /* Start processes only if there are protocols to start them for */
+    if (pool->entry_count > 0) {
+
+        if (pthread_create(&pool->refill_thread, NULL,
+                    guacd_proc_pool_refill_thread, pool)) {
+            guacd_log(GUAC_LOG_ERROR, "Unable to start thread for starting "
+                    "processes in advance. Processes will be started only "
+                    "as connections are made.");
+            pool->entry_count = 0;
+        }
+
+        else
+            guacd_log(GUAC_LOG_INFO, "Starting processes in advance for %i "
+                    "protocol(s)", pool->entry_count);
+
+    }
+
+    return pool;
+
+}
+
+guacd_proc* guacd_proc_pool_take(guacd_proc_pool* pool, const char* protocol) {
+
+    int i;
+    guacd_proc* proc = NULL;
+
+    pthread_mutex_lock(&pool->lock);
+
+    for (i = 0; i < pool->entry_count; i++) {
+
+        guacd_proc_pool_entry* entry = &pool->entries[i];
+        if (strcmp(entry->protocol, protocol) != 0)
+            continue;
+
+        /* Claim oldest process, which is most likely to be fully
+         * initialized, skipping any which have since terminated */
+        guacd_proc_pool_prune(entry, time(NULL));
+        if (entry->idle_count > 0) {
+            proc = entry->idle[0];
+            entry->idle_count--;
+            memmove(entry->idle, entry->idle + 1,
+                    entry->idle_count * sizeof(guacd_proc*));
+        }
+
+        /* Start replacement */
+        pthread_cond_signal(&pool->modified);
+        break;
+
+    }
+
+    pthread_mutex_unlock(&pool->lock);
+    return proc;
+
+}
+
+void guacd_proc_pool_free(guacd_proc_pool* pool) {
+
+    int i, j;
+
+    /* Stop refill thread, if running */
+    if (pool->entry_count > 0) {
+
+        pthread_mutex_lock(&pool->lock);
+        pool->stopping = 1;
+        pthread_cond_signal(&pool->modified);
+        pthread_mutex_unlock(&pool->lock);
+
+        pthread_join(pool->refill_thread, NULL);
+
+    }
+
+    /* Terminate all idle processes */
+    for (i = 0; i < pool->entry_count; i++) {
+        guacd_proc_pool_entry* entry = &pool->entries[i];
+        for (j = 0; j < entry->idle_count; j++)
+            guacd_proc_pool_discard(entry->idle[j]);
+    }
+
+    pthread_cond_destroy(&pool->modified);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool);
+
+}
+
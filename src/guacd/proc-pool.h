@@ -0,0 +1,173 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUACD_PROC_POOL_H
+#define GUACD_PROC_POOL_H
+
+#include "config.h"
+
+#include "conf.h"
+#include "proc.h"
+
+#include <pthread.h>
+#include <time.h>
+
+/**
+ * The number of seconds between each check of the idle processes within a
+ * process pool, during which processes which have terminated are discarded
+ * and replaced.
+ */
+#define GUACD_PROC_POOL_CHECK_INTERVAL 1
+
+/**
+ * The number of seconds to wait before again attempting to start processes
+ * for a protocol after an idle process for that protocol has terminated
+ * unexpectedly, such as when support for that protocol is not installed.
+ */
+#define GUACD_PROC_POOL_RETRY_INTERVAL 30
+
+/**
+ * The idle processes which have been started in advance for a single
+ * protocol.
+ */
+typedef struct guacd_proc_pool_entry {
+
+    /**
+     * The name of the protocol that each process has been started for.
+     */
+    char protocol[GUACD_PREFORK_MAX_PROTOCOL_LENGTH];
+
+    /**
+     * The number of idle processes which should be maintained.
+     */
+    int size;
+
+    /**
+     * All idle processes, in the order they were started. Only the first
+     * idle_count entries are valid.
+     */
+    guacd_proc* idle[GUACD_PREFORK_MAX_SIZE];
+
+    /**
+     * The number of processes currently within the idle array.
+     */
+    int idle_count;
+
+    /**
+     * The time before which no further processes should be started for this
+     * protocol, or zero if processes may be started immediately.
+     */
+    time_t retry_after;
+
+} guacd_proc_pool_entry;
+
+/**
+ * A pool of idle processes which have been started in advance of any
+ * connection, each having already loaded the client plugin for its protocol.
+ * New connections may claim a process from the pool rather than waiting for
+ * a new process to be forked and initialized. Claimed and terminated
+ * processes are replaced automatically by a background thread.
+ */
+typedef struct guacd_proc_pool {
+
+    /**
+     * The idle processes of each protocol within the pool.
+     */
+    guacd_proc_pool_entry entries[GUACD_PREFORK_MAX_PROTOCOLS];
+
+    /**
+     * The number of valid entries within the entries array.
+     */
+    int entry_count;
+
+    /**
+     * Lock which must be acquired before the entries of the pool are read or
+     * modified.
+     */
+    pthread_mutex_t lock;
+
+    /**
+     * Condition which is signalled whenever a process is claimed from the
+     * pool or the pool is being freed.
+     */
+    pthread_cond_t modified;
+
+    /**
+     * Whether the pool is being freed, in which case the background thread
+     * must terminate.
+     */
+    int stopping;
+
+    /**
+     * The thread which starts new processes as needed to maintain the size of
+     * each entry.
+     */
+    pthread_t refill_thread;
+
+} guacd_proc_pool;
+
+/**
+ * Allocates a new process pool which maintains the given number of idle
+ * processes for each of the given protocols. Processes are started in the
+ * background, and thus may not yet be available when this function returns.
+ *
+ * @param protocols
+ *     The protocols for which processes should be started in advance, along
+ *     with the number of idle processes to maintain for each.
+ *
+ * @param count
+ *     The number of protocols within the protocols array. If zero, no
+ *     processes are ever started in advance.
+ *
+ * @return
+ *     A newly-allocated process pool, which must eventually be freed with
+ *     guacd_proc_pool_free().
+ */
+guacd_proc_pool* guacd_proc_pool_alloc(const guacd_prefork_protocol* protocols,
+        int count);
+
+/**
+ * Removes and returns an idle process for the given protocol from the given
+ * pool, if one is available. A replacement process is started in the
+ * background. The returned process is owned by the caller and must be
+ * handled exactly as a process returned by guacd_create_proc().
+ *
+ * @param pool
+ *     The pool to claim a process from.
+ *
+ * @param protocol
+ *     The protocol that the claimed process must have been started for.
+ *
+ * @return
+ *     An idle process for the given protocol, or NULL if no such process is
+ *     currently available.
+ */
+guacd_proc* guacd_proc_pool_take(guacd_proc_pool* pool, const char* protocol);
+
+/**
+ * Frees the given process pool, terminating all idle processes within it.
+ * Processes previously claimed from the pool are unaffected.
+ *
+ * @param pool
+ *     The pool to free.
+ */
+void guacd_proc_pool_free(guacd_proc_pool* pool);
+
+#endif
+
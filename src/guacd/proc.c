@@ -33,6 +33,7 @@
 #include <guacamole/user.h>
 
 #include <errno.h>
+#include <poll.h>
 #include <pthread.h>
 #include <signal.h>
 #include <stdlib.h>
@@ -43,6 +44,22 @@
 #include <sys/socket.h>
 #include <sys/wait.h>
 
+int guacd_output_queue_size = GUAC_CLIENT_DEFAULT_OUTPUT_QUEUE_SIZE;
+
+guac_client_queue_policy guacd_output_queue_policy = GUAC_CLIENT_QUEUE_RESYNC;
+
+int guacd_encoder_threads = GUAC_CLIENT_DEFAULT_ENCODER_THREADS;
+
+int guacd_png_compression_level = GUAC_CLIENT_DEFAULT_PNG_COMPRESSION_LEVEL;
+
+guac_client_png_strategy guacd_png_strategy = GUAC_CLIENT_PNG_DEFAULT;
+
+/**
+ * Lock which is held from the creation of the socket pair of each new
+ * process until the parent has closed its copy of the child's end.
+ */
+static pthread_mutex_t guacd_proc_fork_lock = PTHREAD_MUTEX_INITIALIZER;
+
 /**
  * Parameters for the user thread.
  */
@@ -90,6 +107,13 @@ static void* guacd_user_thread(void* data) {
 
     /* Create skeleton user */
     guac_user* user = guac_user_alloc();
+    if (user == NULL) {
+        guacd_log(GUAC_LOG_ERROR, "Unable to allocate user.");
+        guac_socket_free(socket);
+        free(params);
+        return NULL;
+    }
+
     user->socket = socket;
     user->client = client;
     user->owner  = params->owner;
@@ -287,6 +311,50 @@ static int guacd_timed_client_free(guac_client* client, int timeout) {
     return !free_operation.completed;
 }
 
+/**
+ * Waits for data to be received along the given file descriptor, such as the
+ * file descriptor of the first user to join, periodically verifying that the
+ * given parent process is still running. As processes may be started well in
+ * advance of their first user, this prevents idle processes from outliving
+ * guacd itself.
+ *
+ * @param fd
+ *     The file descriptor to wait for data on.
+ *
+ * @param parent
+ *     The process ID of the parent process (guacd).
+ *
+ * @return
+ *     Zero if data is available to be read, non-zero if the parent process
+ *     has terminated or an error has occurred.
+ */
+static int guacd_proc_wait_for_user(int fd, pid_t parent) {
+
+    struct pollfd fd_state = {
+        .fd = fd,
+        .events = POLLIN
+    };
+
+    for (;;) {
+
+        int result = poll(&fd_state, 1, GUACD_PROC_PARENT_CHECK_INTERVAL);
+
+        /* Data (or an error which recvmsg() will report) is available */
+        if (result > 0)
+            return 0;
+
+        /* Fail on unexpected errors */
+        if (result < 0 && errno != EINTR)
+            return 1;
+
+        /* Orphaned processes are reparented, changing the parent PID */
+        if (getppid() != parent)
+            return 1;
+
+    }
+
+}
+
 /**
  * Starts protocol-specific handling on the given process by loading the client
  * plugin for that protocol. This function does NOT return. It initializes the
@@ -300,8 +368,12 @@ static int guacd_timed_client_free(guac_client* client, int timeout) {
  *
  * @param protocol
  *     The protocol to initialize the given process for.
+ *
+ * @param parent
+ *     The process ID of the parent process (guacd).
  */
-static void guacd_exec_proc(guacd_proc* proc, const char* protocol) {
+static void guacd_exec_proc(guacd_proc* proc, const char* protocol,
+        pid_t parent) {
 
     int result = 1;
    
@@ -333,6 +405,13 @@ static void guacd_exec_proc(guacd_proc* proc, const char* protocol) {
     /* Enable keep alive on the broadcast socket */
     guac_socket_require_keep_alive(client->socket);
 
+    /* Do not outlive guacd if no user ever joins */
+    if (guacd_proc_wait_for_user(proc->fd_socket, parent)) {
+        guacd_log(GUAC_LOG_DEBUG, "Parent process terminated before any "
+                "user joined.");
+        goto cleanup_client;
+    }
+
     /* Add each received file descriptor as a new user */
     int received_fd;
     while ((received_fd = guacd_recv_fd(proc->fd_socket)) != -1) {
@@ -392,29 +471,15 @@ guacd_proc* guacd_create_proc(const char* protocol) {
 
     int sockets[2];
 
-    /* Open UNIX socket pair */
-    if (socketpair(AF_UNIX, SOCK_DGRAM, 0, sockets) < 0) {
-        guacd_log(GUAC_LOG_ERROR, "Error opening socket pair: %s", strerror(errno));
-        return NULL;
-    }
-
-    int parent_socket = sockets[0];
-    int child_socket = sockets[1];
-
     /* Allocate process */
     guacd_proc* proc = calloc(1, sizeof(guacd_proc));
-    if (proc == NULL) {
-        close(parent_socket);
-        close(child_socket);
+    if (proc == NULL)
         return NULL;
-    }
 
     /* Associate new client */
     proc->client = guac_client_alloc();
     if (proc->client == NULL) {
         guacd_log_guac_error(GUAC_LOG_ERROR, "Unable to create client");
-        close(parent_socket);
-        close(child_socket);
         free(proc);
         return NULL;
     }
@@ -422,9 +487,38 @@ guacd_proc* guacd_create_proc(const char* protocol) {
     /* Init logging */
     proc->client->log_handler = guacd_client_log;
 
+    /* Apply configured output queue behavior */
+    proc->client->output_queue_size = guacd_output_queue_size;
+    proc->client->output_queue_policy = guacd_output_queue_policy;
+
+    /* Apply configured image encoding parallelism */
+    proc->client->encoder_threads = guacd_encoder_threads;
+    proc->client->png_compression_level = guacd_png_compression_level;
+    proc->client->png_strategy = guacd_png_strategy;
+
+    /* Prevent processes forked by other threads from inheriting the child's
+     * end of the socket pair, which would then never be closed */
+    pthread_mutex_lock(&guacd_proc_fork_lock);
+
+    /* Open UNIX socket pair. Unlike datagram sockets, sequenced-packet
+     * sockets report EOF once the other end is closed, allowing the
+     * termination of the child to be detected reliably. */
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sockets) < 0) {
+        pthread_mutex_unlock(&guacd_proc_fork_lock);
+        guacd_log(GUAC_LOG_ERROR, "Error opening socket pair: %s", strerror(errno));
+        guac_client_free(proc->client);
+        free(proc);
+        return NULL;
+    }
+
+    int parent_socket = sockets[0];
+    int child_socket = sockets[1];
+
     /* Fork */
+    pid_t parent = getpid();
     proc->pid = fork();
     if (proc->pid < 0) {
+        pthread_mutex_unlock(&guacd_proc_fork_lock);
         guacd_log(GUAC_LOG_ERROR, "Cannot fork child process: %s", strerror(errno));
         close(parent_socket);
         close(child_socket);
@@ -441,7 +535,7 @@ guacd_proc* guacd_create_proc(const char* protocol) {
         close(child_socket);
 
         /* Start protocol-specific handling */
-        guacd_exec_proc(proc, protocol);
+        guacd_exec_proc(proc, protocol, parent);
 
     }
 
@@ -452,6 +546,8 @@ guacd_proc* guacd_create_proc(const char* protocol) {
         proc->fd_socket = child_socket;
         close(parent_socket);
 
+        pthread_mutex_unlock(&guacd_proc_fork_lock);
+
     }
 
     return proc;
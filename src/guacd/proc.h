@@ -48,6 +48,43 @@
  */
 #define GUACD_CLIENT_FREE_TIMEOUT 5
 
+/**
+ * The number of milliseconds between each check, performed by a process which
+ * has not yet received its first user, that guacd itself is still running.
+ */
+#define GUACD_PROC_PARENT_CHECK_INTERVAL 1000
+
+/**
+ * The maximum number of bytes of broadcast data which may be queued for each
+ * user of each new connection. See the output_queue_size member of
+ * guac_client.
+ */
+extern int guacd_output_queue_size;
+
+/**
+ * What should happen when the output queue of a user of any new connection
+ * overflows. See the output_queue_policy member of guac_client.
+ */
+extern guac_client_queue_policy guacd_output_queue_policy;
+
+/**
+ * The number of threads each new connection should use to encode image data.
+ * See the encoder_threads member of guac_client.
+ */
+extern int guacd_encoder_threads;
+
+/**
+ * The zlib compression level of palette-based PNG images sent by each new
+ * connection. See the png_compression_level member of guac_client.
+ */
+extern int guacd_png_compression_level;
+
+/**
+ * The strategy each new connection should use to compress palette-based PNG
+ * images. See the png_strategy member of guac_client.
+ */
+extern guac_client_png_strategy guacd_png_strategy;
+
 /**
  * Process information of the internal remote desktop client.
  */
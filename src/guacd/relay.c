@@ -0,0 +1,953 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+
+/* Required for splice() on Linux */
+#define _GNU_SOURCE 1
+
+#include "log.h"
+#include "relay.h"
+
+#include <guacamole/client.h>
+#include <guacamole/parser.h>
+#include <guacamole/socket.h>
+
+#ifdef ENABLE_SSL
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#include <guacamole/socket-ssl.h>
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#ifdef HAVE_EPOLL
+#include <sys/epoll.h>
+
+/**
+ * One of the two file descriptors of a relayed connection, as registered with
+ * the epoll instance of a relay thread.
+ */
+typedef struct guacd_relay_endpoint {
+
+    /**
+     * The connection that this endpoint belongs to.
+     */
+    struct guacd_relay_connection* connection;
+
+    /**
+     * The file descriptor of this endpoint.
+     */
+    int fd;
+
+    /**
+     * The epoll events this endpoint is currently registered for, or zero if
+     * the endpoint is not currently registered.
+     */
+    uint32_t events;
+
+    /**
+     * Whether the epoll instance has reported that this file descriptor has
+     * hung up or is in an error state. Such file descriptors are never
+     * registered again, as these conditions are reported continuously.
+     */
+    int hung_up;
+
+} guacd_relay_endpoint;
+
+/**
+ * The state of data flowing in one direction between the two endpoints of a
+ * relayed connection. Data is held either within a buffer, if the data must
+ * be copied (such as for encryption), or within a pipe, if the data can be
+ * spliced. Any buffered data is always relayed before any piped data.
+ */
+typedef struct guacd_relay_direction {
+
+    /**
+     * Buffer of GUACD_RELAY_BUFFER_SIZE bytes holding data which has been read
+     * from the source endpoint but not yet written to the destination, or
+     * NULL if data in this direction is only ever spliced.
+     */
+    char* buffer;
+
+    /**
+     * The offset of the first byte within the buffer which has not yet been
+     * written to the destination.
+     */
+    int start;
+
+    /**
+     * The offset just past the last byte within the buffer.
+     */
+    int end;
+
+    /**
+     * The read and write ends of the pipe through which data is spliced, or
+     * -1 if data is not spliced in this direction.
+     */
+    int pipe[2];
+
+    /**
+     * The number of bytes currently within the pipe.
+     */
+    size_t piped;
+
+    /**
+     * Whether the source endpoint has reached end-of-stream or failed. No
+     * further data will be read in this direction.
+     */
+    int eof;
+
+    /**
+     * Whether the destination endpoint can no longer accept data. Any data
+     * remaining in this direction is discarded.
+     */
+    int closed;
+
+    /**
+     * Whether the destination endpoint has been informed of end-of-stream.
+     */
+    int shutdown;
+
+} guacd_relay_direction;
+
+/**
+ * A single user's connection to guacd, relayed to and from that user's
+ * connection process.
+ */
+typedef struct guacd_relay_connection {
+
+    /**
+     * The socket of the user's connection to guacd. Freeing this socket
+     * closes the user's file descriptor.
+     */
+    guac_socket* socket;
+
+#ifdef ENABLE_SSL
+    /**
+     * The SSL connection of the user's socket, or NULL if the user's socket
+     * is not encrypted.
+     */
+    SSL* ssl;
+
+    /**
+     * Whether the last call to SSL_read() could not proceed until the user's
+     * file descriptor is writable.
+     */
+    int ssl_read_wants_write;
+
+    /**
+     * Whether the last call to SSL_write() could not proceed until the user's
+     * file descriptor is readable.
+     */
+    int ssl_write_wants_read;
+
+    /**
+     * The length of data passed to the last call to SSL_write(), if that
+     * call must be retried, or zero otherwise. OpenSSL requires that retried
+     * writes include at least the same data.
+     */
+    int ssl_retry_length;
+#endif
+
+    /**
+     * The user's file descriptor.
+     */
+    guacd_relay_endpoint user;
+
+    /**
+     * The guacd end of the socket pair shared with the connection process.
+     */
+    guacd_relay_endpoint proc;
+
+    /**
+     * Data flowing from the user to the connection process.
+     */
+    guacd_relay_direction inbound;
+
+    /**
+     * Data flowing from the connection process to the user.
+     */
+    guacd_relay_direction outbound;
+
+    /**
+     * Whether relaying has finished for this connection, in which case the
+     * connection will be freed once all pending epoll events have been
+     * handled.
+     */
+    int finished;
+
+    /**
+     * The next connection within the pending list of a relay thread, or
+     * within the list of connections awaiting free.
+     */
+    struct guacd_relay_connection* next;
+
+} guacd_relay_connection;
+
+/**
+ * Returns whether the given error code indicates only that an operation
+ * would have blocked.
+ */
+static int guacd_relay_would_block(int error) {
+    return error == EAGAIN || error == EWOULDBLOCK || error == EINTR;
+}
+
+/**
+ * Reads data from the given endpoint of the given connection into the given
+ * buffer, decrypting the data if the endpoint is the user's encrypted socket.
+ * The semantics of this function are identical to read().
+ */
+static ssize_t guacd_relay_read(guacd_relay_connection* connection,
+        guacd_relay_endpoint* endpoint, void* buffer, size_t length) {
+
+#ifdef ENABLE_SSL
+    if (endpoint == &connection->user && connection->ssl != NULL) {
+
+        ERR_clear_error();
+        connection->ssl_read_wants_write = 0;
+
+        int result = SSL_read(connection->ssl, buffer, length);
+        if (result > 0)
+            return result;
+
+        switch (SSL_get_error(connection->ssl, result)) {
+
+            case SSL_ERROR_WANT_WRITE:
+                connection->ssl_read_wants_write = 1;
+                /* Fall through */
+
+            case SSL_ERROR_WANT_READ:
+                errno = EAGAIN;
+                return -1;
+
+            case SSL_ERROR_ZERO_RETURN:
+                return 0;
+
+        }
+
+        errno = EIO;
+        return -1;
+
+    }
+#endif
+
+    return read(endpoint->fd, buffer, length);
+
+}
+
+/**
+ * Writes data from the given buffer to the given endpoint of the given
+ * connection, encrypting the data if the endpoint is the user's encrypted
+ * socket. The semantics of this function are identical to write().
+ */
+static ssize_t guacd_relay_write(guacd_relay_connection* connection,
+        guacd_relay_endpoint* endpoint, const void* buffer, size_t length) {
+
+#ifdef ENABLE_SSL
+    if (endpoint == &connection->user && connection->ssl != NULL) {
+
+        /* Retried writes must not shrink */
+        if (length < connection->ssl_retry_length)
+            length = connection->ssl_retry_length;
+
+        ERR_clear_error();
+        connection->ssl_write_wants_read = 0;
+        connection->ssl_retry_length = 0;
+
+        int result = SSL_write(connection->ssl, buffer, length);
+        if (result > 0)
+            return result;
+
+        switch (SSL_get_error(connection->ssl, result)) {
+
+            case SSL_ERROR_WANT_READ:
+                connection->ssl_write_wants_read = 1;
+                /* Fall through */
+
+            case SSL_ERROR_WANT_WRITE:
+                connection->ssl_retry_length = length;
+                errno = EAGAIN;
+                return -1;
+
+        }
+
+        errno = EIO;
+        return -1;
+
+    }
+#endif
+
+    return write(endpoint->fd, buffer, length);
+
+}
+
+/**
+ * Returns whether data in the given direction is still awaiting transfer to
+ * its destination.
+ */
+static int guacd_relay_pending(guacd_relay_direction* direction) {
+    return !direction->closed
+        && ((direction->buffer != NULL && direction->start < direction->end)
+            || direction->piped > 0);
+}
+
+/**
+ * Returns whether further data should be read from the source of the given
+ * direction.
+ */
+static int guacd_relay_readable(guacd_relay_direction* direction) {
+
+    if (direction->eof || direction->closed)
+        return 0;
+
+    /* Spliced data is limited by the capacity of the pipe */
+    if (direction->pipe[0] != -1)
+        return direction->piped < GUACD_RELAY_PIPE_SIZE;
+
+    return direction->end < GUACD_RELAY_BUFFER_SIZE;
+
+}
+
+/**
+ * Reads as much data as possible from the given source endpoint, without
+ * blocking, storing that data within the given direction.
+ *
+ * @return
+ *     Non-zero if any progress was made, zero otherwise.
+ */
+static int guacd_relay_fill(guacd_relay_connection* connection,
+        guacd_relay_direction* direction, guacd_relay_endpoint* source) {
+
+    ssize_t result;
+
+    if (!guacd_relay_readable(direction))
+        return 0;
+
+#ifdef HAVE_SPLICE
+    /* Move data into pipe without copying, if possible */
+    if (direction->pipe[0] != -1) {
+
+        result = splice(source->fd, NULL, direction->pipe[1], NULL,
+                GUACD_RELAY_PIPE_SIZE - direction->piped,
+                SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+
+        if (result > 0) {
+            direction->piped += result;
+            return 1;
+        }
+
+    }
+    else
+#endif
+    {
+
+        result = guacd_relay_read(connection, source,
+                direction->buffer + direction->end,
+                GUACD_RELAY_BUFFER_SIZE - direction->end);
+
+        if (result > 0) {
+            direction->end += result;
+            return 1;
+        }
+
+    }
+
+    if (result < 0 && guacd_relay_would_block(errno))
+        return 0;
+
+    /* End-of-stream or unrecoverable error */
+    direction->eof = 1;
+    return 1;
+
+}
+
+/**
+ * Writes as much data as possible from the given direction to the given
+ * destination endpoint, without blocking.
+ *
+ * @return
+ *     Non-zero if any progress was made, zero otherwise.
+ */
+static int guacd_relay_drain(guacd_relay_connection* connection,
+        guacd_relay_direction* direction, guacd_relay_endpoint* destination) {
+
+    ssize_t result;
+
+    if (!guacd_relay_pending(direction))
+        return 0;
+
+    /* Buffered data always precedes piped data */
+    if (direction->buffer != NULL && direction->start < direction->end) {
+
+        result = guacd_relay_write(connection, destination,
+                direction->buffer + direction->start,
+                direction->end - direction->start);
+
+        if (result > 0) {
+
+            /* Reuse entire buffer once empty */
+            direction->start += result;
+            if (direction->start == direction->end)
+                direction->start = direction->end = 0;
+
+            return 1;
+
+        }
+
+    }
+
+#ifdef HAVE_SPLICE
+    else {
+
+        result = splice(direction->pipe[0], NULL, destination->fd, NULL,
+                direction->piped, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+
+        if (result > 0) {
+            direction->piped -= result;
+            return 1;
+        }
+
+    }
+#else
+    else
+        return 0;
+#endif
+
+    if (result < 0 && guacd_relay_would_block(errno))
+        return 0;
+
+    /* Destination can no longer accept data */
+    direction->closed = 1;
+    return 1;
+
+}
+
+/**
+ * Registers, re-registers, or deregisters the given endpoint with the epoll
+ * instance of the given thread such that the thread is notified of only the
+ * given events.
+ *
+ * @return
+ *     Zero on success, non-zero if the endpoint could not be registered.
+ */
+static int guacd_relay_watch(guacd_relay_thread* thread,
+        guacd_relay_endpoint* endpoint, uint32_t events) {
+
+    /* Hang-up and error conditions would be reported continuously */
+    if (endpoint->hung_up)
+        events = 0;
+
+    if (events == endpoint->events)
+        return 0;
+
+    struct epoll_event event = {
+        .events = events,
+        .data.ptr = endpoint
+    };
+
+    int operation;
+    if (events == 0)
+        operation = EPOLL_CTL_DEL;
+    else if (endpoint->events == 0)
+        operation = EPOLL_CTL_ADD;
+    else
+        operation = EPOLL_CTL_MOD;
+
+    if (epoll_ctl(thread->epoll_fd, operation, endpoint->fd, &event))
+        return 1;
+
+    endpoint->events = events;
+    return 0;
+
+}
+
+/**
+ * Updates the registrations of both endpoints of the given connection to
+ * reflect the transfers which can currently make progress.
+ *
+ * @return
+ *     Zero on success, non-zero if the endpoints could not be registered.
+ */
+static int guacd_relay_update(guacd_relay_thread* thread,
+        guacd_relay_connection* connection) {
+
+    uint32_t user_events = 0;
+    uint32_t proc_events = 0;
+
+    if (guacd_relay_readable(&connection->inbound))
+        user_events |= EPOLLIN;
+
+    if (guacd_relay_pending(&connection->outbound))
+        user_events |= EPOLLOUT;
+
+#ifdef ENABLE_SSL
+    /* Encrypted sockets may need to read to write, or write to read */
+    if (connection->ssl_read_wants_write)
+        user_events |= EPOLLOUT;
+
+    if (connection->ssl_write_wants_read)
+        user_events |= EPOLLIN;
+#endif
+
+    if (guacd_relay_readable(&connection->outbound))
+        proc_events |= EPOLLIN;
+
+    if (guacd_relay_pending(&connection->inbound))
+        proc_events |= EPOLLOUT;
+
+    return guacd_relay_watch(thread, &connection->user, user_events)
+        || guacd_relay_watch(thread, &connection->proc, proc_events);
+
+}
+
+/**
+ * Transfers as much data as possible in both directions of the given
+ * connection without blocking, and then updates the registrations of its
+ * endpoints accordingly. If relaying has finished, the connection is
+ * deregistered and flagged as finished, but is not freed.
+ */
+static void guacd_relay_pump(guacd_relay_thread* thread,
+        guacd_relay_connection* connection) {
+
+    guacd_relay_direction* inbound = &connection->inbound;
+    guacd_relay_direction* outbound = &connection->outbound;
+
+    int progress;
+    do {
+        progress  = guacd_relay_fill(connection, inbound, &connection->user);
+        progress |= guacd_relay_drain(connection, inbound, &connection->proc);
+        progress |= guacd_relay_fill(connection, outbound, &connection->proc);
+        progress |= guacd_relay_drain(connection, outbound, &connection->user);
+    } while (progress);
+
+    /* Inform connection process once the user has disconnected and all
+     * their data has been relayed */
+    if (inbound->eof && !guacd_relay_pending(inbound) && !inbound->shutdown) {
+        shutdown(connection->proc.fd, SHUT_WR);
+        inbound->shutdown = 1;
+    }
+
+    /* Relaying is finished once the user can no longer receive data, or once
+     * the connection process has closed and all its data has been relayed */
+    if (outbound->closed || (outbound->eof && !guacd_relay_pending(outbound))
+            || guacd_relay_update(thread, connection)) {
+
+        guacd_relay_watch(thread, &connection->user, 0);
+        guacd_relay_watch(thread, &connection->proc, 0);
+        connection->finished = 1;
+
+    }
+
+}
+
+/**
+ * Closes all pipes used to splice data for the given connection, if any.
+ */
+static void guacd_relay_close_pipes(guacd_relay_connection* connection) {
+
+    int i;
+    for (i = 0; i < 2; i++) {
+
+        if (connection->inbound.pipe[i] != -1)
+            close(connection->inbound.pipe[i]);
+
+        if (connection->outbound.pipe[i] != -1)
+            close(connection->outbound.pipe[i]);
+
+        connection->inbound.pipe[i] = connection->outbound.pipe[i] = -1;
+
+    }
+
+}
+
+/**
+ * Creates the pipes used to splice data in both directions of the given
+ * connection.
+ *
+ * @return
+ *     Zero if the pipes were created, non-zero if data cannot be spliced and
+ *     must instead be copied through buffers.
+ */
+static int guacd_relay_open_pipes(guacd_relay_connection* connection) {
+
+#ifdef HAVE_SPLICE
+    if (pipe(connection->inbound.pipe) == 0
+            && pipe(connection->outbound.pipe) == 0)
+        return 0;
+
+    guacd_relay_close_pipes(connection);
+#endif
+
+    return 1;
+
+}
+
+/**
+ * Frees the given connection, closing the user's socket and the file
+ * descriptor shared with the connection process. The connection must not be
+ * registered with any epoll instance.
+ */
+static void guacd_relay_connection_free(guacd_relay_connection* connection) {
+
+    /* Ensure the connection process observes the disconnect even if other
+     * processes hold copies of this file descriptor */
+    shutdown(connection->proc.fd, SHUT_RDWR);
+    close(connection->proc.fd);
+
+    guac_socket_free(connection->socket);
+
+    guacd_relay_close_pipes(connection);
+
+    free(connection->inbound.buffer);
+    free(connection->outbound.buffer);
+    free(connection);
+
+}
+
+/**
+ * Registers all connections pending for the given relay thread, performing
+ * any transfers which can be performed immediately, such as relaying data
+ * remaining from the connection handshake.
+ *
+ * @param thread
+ *     The relay thread whose pending connections should be registered.
+ *
+ * @param finished
+ *     Pointer to the head of the list of connections awaiting free. Any
+ *     connections which finish immediately are added to this list.
+ */
+static void guacd_relay_register_pending(guacd_relay_thread* thread,
+        guacd_relay_connection** finished) {
+
+    char discard[64];
+
+    /* Acknowledge wake-up */
+    while (read(thread->wake_pipe[0], discard, sizeof(discard)) > 0);
+
+    pthread_mutex_lock(&thread->pending_lock);
+    guacd_relay_connection* connection = thread->pending;
+    thread->pending = NULL;
+    pthread_mutex_unlock(&thread->pending_lock);
+
+    while (connection != NULL) {
+
+        guacd_relay_connection* next = connection->next;
+
+        guacd_relay_pump(thread, connection);
+        if (connection->finished) {
+            guacd_log(GUAC_LOG_DEBUG, "User disconnected before relaying "
+                    "could begin.");
+            connection->next = *finished;
+            *finished = connection;
+        }
+
+        connection = next;
+
+    }
+
+}
+
+/**
+ * Relays data for all connections assigned to a relay thread. This function
+ * never returns.
+ *
+ * @param data
+ *     A pointer to the guacd_relay_thread being run.
+ *
+ * @return
+ *     Always NULL.
+ */
+static void* guacd_relay_thread_run(void* data) {
+
+    guacd_relay_thread* thread = (guacd_relay_thread*) data;
+    struct epoll_event events[GUACD_RELAY_MAX_EVENTS];
+
+    for (;;) {
+
+        int count = epoll_wait(thread->epoll_fd, events,
+                GUACD_RELAY_MAX_EVENTS, -1);
+
+        if (count < 0) {
+            if (errno != EINTR)
+                guacd_log(GUAC_LOG_ERROR, "Unable to wait for relay "
+                        "events: %s", strerror(errno));
+            continue;
+        }
+
+        /* Connections which finish are freed only after all events have been
+         * handled, as later events may refer to the same connection */
+        guacd_relay_connection* finished = NULL;
+
+        int i;
+        for (i = 0; i < count; i++) {
+
+            guacd_relay_endpoint* endpoint = events[i].data.ptr;
+
+            /* Wake-up pipe is the only file descriptor without an endpoint */
+            if (endpoint == NULL) {
+                guacd_relay_register_pending(thread, &finished);
+                continue;
+            }
+
+            guacd_relay_connection* connection = endpoint->connection;
+            if (connection->finished)
+                continue;
+
+            if (events[i].events & (EPOLLHUP | EPOLLERR))
+                endpoint->hung_up = 1;
+
+            guacd_relay_pump(thread, connection);
+            if (connection->finished) {
+                connection->next = finished;
+                finished = connection;
+            }
+
+        }
+
+        /* Free all finished connections */
+        while (finished != NULL) {
+            guacd_relay_connection* next = finished->next;
+            guacd_relay_connection_free(finished);
+            finished = next;
+        }
+
+    }
+
+    return NULL;
+
+}
+
+/**
+ * Sets the O_NONBLOCK flag of the given file descriptor.
+ *
+ * @return
+ *     Zero on success, non-zero if the flag could not be set.
+ */
+static int guacd_relay_set_nonblocking(int fd) {
+
+    int flags = fcntl(fd, F_GETFL);
+    if (flags < 0)
+        return 1;
+
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0;
+
+}
+
+/**
+ * Initializes the given relay thread, creating its epoll instance and
+ * starting the thread.
+ *
+ * @return
+ *     Zero on success, non-zero if the thread could not be started.
+ */
+static int guacd_relay_thread_init(guacd_relay_thread* thread) {
+
+    thread->pending = NULL;
+    pthread_mutex_init(&thread->pending_lock, NULL);
+
+    thread->epoll_fd = epoll_create1(0);
+    if (thread->epoll_fd < 0)
+        goto fail_epoll;
+
+    if (pipe(thread->wake_pipe))
+        goto fail_pipe;
+
+    if (guacd_relay_set_nonblocking(thread->wake_pipe[0])
+            || guacd_relay_set_nonblocking(thread->wake_pipe[1]))
+        goto fail_register;
+
+    /* Wake-up pipe is identified by its lack of endpoint */
+    struct epoll_event event = {
+        .events = EPOLLIN,
+        .data.ptr = NULL
+    };
+
+    if (epoll_ctl(thread->epoll_fd, EPOLL_CTL_ADD, thread->wake_pipe[0],
+                &event))
+        goto fail_register;
+
+    if (pthread_create(&thread->thread, NULL, guacd_relay_thread_run, thread))
+        goto fail_register;
+
+    pthread_detach(thread->thread);
+    return 0;
+
+fail_register:
+    close(thread->wake_pipe[0]);
+    close(thread->wake_pipe[1]);
+
+fail_pipe:
+    close(thread->epoll_fd);
+
+fail_epoll:
+    pthread_mutex_destroy(&thread->pending_lock);
+    return 1;
+
+}
+
+guacd_relay* guacd_relay_alloc() {
+
+    guacd_relay* relay = calloc(1, sizeof(guacd_relay));
+    if (relay == NULL)
+        return NULL;
+
+    pthread_mutex_init(&relay->lock, NULL);
+
+    /* Use one thread per processor, within limits */
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    if (processors < 1)
+        processors = 1;
+    else if (processors > GUACD_RELAY_MAX_THREADS)
+        processors = GUACD_RELAY_MAX_THREADS;
+
+    while (relay->thread_count < processors) {
+        if (guacd_relay_thread_init(&relay->threads[relay->thread_count]))
+            break;
+        relay->thread_count++;
+    }
+
+    /* Fall back to per-user threads if no relay threads could start */
+    if (relay->thread_count == 0) {
+        guacd_log(GUAC_LOG_WARNING, "Unable to start relay threads: %s. "
+                "Each user will be relayed by dedicated threads.",
+                strerror(errno));
+        pthread_mutex_destroy(&relay->lock);
+        free(relay);
+        return NULL;
+    }
+
+    guacd_log(GUAC_LOG_DEBUG, "Relaying all users with %i thread(s)",
+            relay->thread_count);
+
+    return relay;
+
+}
+
+int guacd_relay_add(guacd_relay* relay, guac_parser* parser,
+        guac_socket* socket, int fd, int secure, int proc_fd) {
+
+    guacd_relay_connection* connection =
+        calloc(1, sizeof(guacd_relay_connection));
+
+    if (connection == NULL)
+        return 1;
+
+    connection->socket = socket;
+    connection->user.connection = connection;
+    connection->user.fd = fd;
+    connection->proc.connection = connection;
+    connection->proc.fd = proc_fd;
+
+    connection->inbound.pipe[0] = connection->inbound.pipe[1] = -1;
+    connection->outbound.pipe[0] = connection->outbound.pipe[1] = -1;
+
+    /* Data remaining from the handshake is always buffered */
+    connection->inbound.buffer = malloc(GUACD_RELAY_BUFFER_SIZE);
+    if (connection->inbound.buffer == NULL)
+        goto fail;
+
+#ifdef ENABLE_SSL
+    if (secure)
+        connection->ssl = ((guac_socket_ssl_data*) socket->data)->ssl;
+#endif
+
+    /* Splice unencrypted data without copying, if possible, otherwise copy
+     * through buffers */
+    if (secure || guacd_relay_open_pipes(connection)) {
+        connection->outbound.buffer = malloc(GUACD_RELAY_BUFFER_SIZE);
+        if (connection->outbound.buffer == NULL)
+            goto fail;
+    }
+
+    /* Both file descriptors must be non-blocking, otherwise neither may be
+     * left non-blocking, as the connection will be relayed by blocking I/O */
+    int flags = fcntl(fd, F_GETFL);
+    if (flags < 0 || guacd_relay_set_nonblocking(fd))
+        goto fail;
+
+    if (guacd_relay_set_nonblocking(proc_fd)) {
+        fcntl(fd, F_SETFL, flags);
+        goto fail;
+    }
+
+#ifdef ENABLE_SSL
+    /* Buffer contents may change between retried writes */
+    if (connection->ssl != NULL)
+        SSL_set_mode(connection->ssl, SSL_MODE_ENABLE_PARTIAL_WRITE
+                | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+#endif
+
+    /* The relay buffer can hold all data remaining within the parser */
+    connection->inbound.end = guac_parser_shift(parser,
+            connection->inbound.buffer, GUACD_RELAY_BUFFER_SIZE);
+    guac_parser_free(parser);
+
+    /* Assign connection to next thread */
+    pthread_mutex_lock(&relay->lock);
+    guacd_relay_thread* thread = &relay->threads[relay->next_thread];
+    relay->next_thread = (relay->next_thread + 1) % relay->thread_count;
+    pthread_mutex_unlock(&relay->lock);
+
+    /* Connection will be registered by the relay thread */
+    pthread_mutex_lock(&thread->pending_lock);
+    connection->next = thread->pending;
+    thread->pending = connection;
+    pthread_mutex_unlock(&thread->pending_lock);
+
+    /* Wake relay thread (failure here means a wake-up is already pending) */
+    char wake = 0;
+    if (write(thread->wake_pipe[1], &wake, 1) < 0 && errno != EAGAIN)
+        guacd_log(GUAC_LOG_ERROR, "Unable to wake relay thread: %s",
+                strerror(errno));
+
+    return 0;
+
+fail:
+    guacd_relay_close_pipes(connection);
+    free(connection->inbound.buffer);
+    free(connection->outbound.buffer);
+    free(connection);
+    return 1;
+
+}
+
+#else
+
+guacd_relay* guacd_relay_alloc() {
+
+    /* Event-driven relaying requires epoll */
+    return NULL;
+
+}
+
+int guacd_relay_add(guacd_relay* relay, guac_parser* parser,
+        guac_socket* socket, int fd, int secure, int proc_fd) {
+    return 1;
+}
+
+#endif
+
@@ -0,0 +1,174 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUACD_RELAY_H
+#define GUACD_RELAY_H
+
+#include "config.h"
+
+#include <guacamole/parser.h>
+#include <guacamole/socket.h>
+
+#include <pthread.h>
+
+/**
+ * The maximum number of threads which will be used to relay data between
+ * users and their connection processes. One thread is used per online
+ * processor, up to this limit.
+ */
+#define GUACD_RELAY_MAX_THREADS 4
+
+/**
+ * The maximum number of events handled by a relay thread per call to
+ * epoll_wait().
+ */
+#define GUACD_RELAY_MAX_EVENTS 64
+
+/**
+ * The size of each buffer used to relay data which cannot be spliced, such
+ * as data which must be encrypted or decrypted, in bytes. This is large
+ * enough to hold all data which may remain buffered within a guac_parser
+ * following the connection handshake.
+ */
+#define GUACD_RELAY_BUFFER_SIZE 32768
+
+/**
+ * The maximum number of bytes which will be held within each pipe used to
+ * splice data between sockets without copying. This is the default capacity
+ * of a pipe on Linux.
+ */
+#define GUACD_RELAY_PIPE_SIZE 65536
+
+/**
+ * A single thread which relays data for any number of connections using a
+ * dedicated epoll instance.
+ */
+typedef struct guacd_relay_thread {
+
+    /**
+     * The file descriptor of the epoll instance used by this thread.
+     */
+    int epoll_fd;
+
+    /**
+     * Pipe used to wake the thread when new connections are pending. The
+     * first element is the read end and is monitored by the epoll instance.
+     * The second element is the write end.
+     */
+    int wake_pipe[2];
+
+    /**
+     * Lock which must be acquired before the pending list is read or
+     * modified.
+     */
+    pthread_mutex_t pending_lock;
+
+    /**
+     * Connections which have been added but not yet registered with the
+     * epoll instance of this thread, or NULL if there are none. Connections
+     * are registered only by the relay thread itself.
+     */
+    struct guacd_relay_connection* pending;
+
+    /**
+     * The thread itself.
+     */
+    pthread_t thread;
+
+} guacd_relay_thread;
+
+/**
+ * A fixed set of threads which relay data between all users and their
+ * connection processes, in place of dedicated threads for each user.
+ */
+typedef struct guacd_relay {
+
+    /**
+     * All relay threads.
+     */
+    guacd_relay_thread threads[GUACD_RELAY_MAX_THREADS];
+
+    /**
+     * The number of threads within the threads array which are running.
+     */
+    int thread_count;
+
+    /**
+     * The index of the thread which should receive the next connection.
+     * Connections are distributed across threads in round-robin fashion.
+     */
+    int next_thread;
+
+    /**
+     * Lock which must be acquired before next_thread is read or modified.
+     */
+    pthread_mutex_t lock;
+
+} guacd_relay;
+
+/**
+ * Allocates a new relay and starts its threads. If event-driven relaying is
+ * not supported on the current platform, or the relay threads cannot be
+ * started, NULL is returned and users must instead be relayed with
+ * guacd_connection_io_thread().
+ *
+ * @return
+ *     A newly-allocated relay, or NULL if event-driven relaying is not
+ *     available. The relay persists for the life of guacd.
+ */
+guacd_relay* guacd_relay_alloc();
+
+/**
+ * Begins relaying data between a user's connection to guacd and the file
+ * descriptor given to that user's connection process. Any data remaining
+ * within the given parser is relayed to the connection process first. Once
+ * relaying has begun, the given parser and socket are owned by the relay and
+ * will be freed automatically when either side disconnects.
+ *
+ * @param relay
+ *     The relay which should relay the user's data.
+ *
+ * @param parser
+ *     The parser which was used to handle the user's connection handshake
+ *     thus far, and which may contain unhandled data.
+ *
+ * @param socket
+ *     The socket of the user's connection to guacd.
+ *
+ * @param fd
+ *     The file descriptor underlying the user's socket.
+ *
+ * @param secure
+ *     Non-zero if the user's socket was created with
+ *     guac_socket_open_secure(), zero if created with guac_socket_open().
+ *
+ * @param proc_fd
+ *     The guacd end of the socket pair whose other end has been given to the
+ *     connection process.
+ *
+ * @return
+ *     Zero if relaying has begun, non-zero if the user could not be added to
+ *     the relay, in which case the parser, socket and file descriptors are
+ *     untouched and remain owned by the caller.
+ */
+int guacd_relay_add(guacd_relay* relay, guac_parser* parser,
+        guac_socket* socket, int fd, int secure, int proc_fd);
+
+#endif
+
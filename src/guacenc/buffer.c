@@ -81,6 +81,8 @@ int guacenc_buffer_resize(guacenc_buffer* buffer, int width, int height) {
         buffer->width = width;
         buffer->height = height;
         buffer->stride = 0;
+        guacenc_rect_init(&buffer->path, 0, 0, 0, 0);
+        guacenc_rect_init(&buffer->damage, 0, 0, 0, 0);
         return 0;
     }
 
@@ -108,6 +110,11 @@ int guacenc_buffer_resize(guacenc_buffer* buffer, int width, int height) {
     buffer->height = height;
     buffer->stride = stride;
 
+    /* Any path is discarded along with the old graphics context, and the
+     * entire buffer is now damaged */
+    guacenc_rect_init(&buffer->path, 0, 0, 0, 0);
+    guacenc_rect_init(&buffer->damage, 0, 0, width, height);
+
     /* Replace old image */
     guacenc_buffer_free_image(buffer);
     buffer->image = image;
@@ -169,3 +176,45 @@ int guacenc_buffer_copy(guacenc_buffer* dst, guacenc_buffer* src) {
 
 }
 
+void guacenc_buffer_add_rect(guacenc_buffer* buffer, int x, int y,
+        int width, int height) {
+
+    /* Ignore if buffer has no pixels */
+    if (buffer->cairo == NULL)
+        return;
+
+    cairo_rectangle(buffer->cairo, x, y, width, height);
+
+    /* Track bounds of path */
+    guacenc_rect rect;
+    guacenc_rect_init(&rect, x, y, width, height);
+    guacenc_rect_extend(&buffer->path, &rect);
+
+}
+
+void guacenc_buffer_fill(guacenc_buffer* buffer) {
+
+    /* Ignore if buffer has no pixels */
+    if (buffer->cairo == NULL)
+        return;
+
+    cairo_fill(buffer->cairo);
+
+    /* Everything within the path has potentially changed */
+    guacenc_buffer_damage(buffer, &buffer->path);
+    guacenc_rect_init(&buffer->path, 0, 0, 0, 0);
+
+}
+
+void guacenc_buffer_damage(guacenc_buffer* buffer, const guacenc_rect* rect) {
+
+    guacenc_rect bounds;
+    guacenc_rect_init(&bounds, 0, 0, buffer->width, buffer->height);
+
+    /* Damage only the portion of the rectangle within the buffer */
+    guacenc_rect damage = *rect;
+    guacenc_rect_constrain(&damage, &bounds);
+    guacenc_rect_extend(&buffer->damage, &damage);
+
+}
+
@@ -21,6 +21,7 @@
 #define GUACENC_BUFFER_H
 
 #include "config.h"
+#include "rect.h"
 
 #include <cairo/cairo.h>
 
@@ -71,6 +72,20 @@ typedef struct guacenc_buffer {
      */
     cairo_t* cairo;
 
+    /**
+     * The bounds of the current path of the Cairo graphics context, as built
+     * through calls to guacenc_buffer_add_rect(). This will be empty if there
+     * is no current path.
+     */
+    guacenc_rect path;
+
+    /**
+     * The region of this buffer which has been modified since the damage of
+     * this buffer was last reset. Damage is reset only by the code consuming
+     * it, such as when the display is flattened.
+     */
+    guacenc_rect damage;
+
 } guacenc_buffer;
 
 /**
@@ -150,5 +165,53 @@ int guacenc_buffer_fit(guacenc_buffer* buffer, int x, int y);
  */
 int guacenc_buffer_copy(guacenc_buffer* dst, guacenc_buffer* src);
 
+/**
+ * Adds the given rectangle to the current path of the given buffer, as would
+ * be done by cairo_rectangle(), tracking the bounds of that path such that
+ * the region modified by guacenc_buffer_fill() is known. If the buffer has no
+ * pixels, this function has no effect.
+ *
+ * @param buffer
+ *     The buffer whose current path should be extended.
+ *
+ * @param x
+ *     The X coordinate of the upper-left corner of the rectangle.
+ *
+ * @param y
+ *     The Y coordinate of the upper-left corner of the rectangle.
+ *
+ * @param width
+ *     The width of the rectangle, in pixels.
+ *
+ * @param height
+ *     The height of the rectangle, in pixels.
+ */
+void guacenc_buffer_add_rect(guacenc_buffer* buffer, int x, int y,
+        int width, int height);
+
+/**
+ * Fills the current path of the given buffer using the current source and
+ * operator of its Cairo graphics context, as would be done by cairo_fill(),
+ * adding the bounds of that path to the damaged region of the buffer. The
+ * current path is cleared. If the buffer has no pixels, this function has no
+ * effect.
+ *
+ * @param buffer
+ *     The buffer whose current path should be filled.
+ */
+void guacenc_buffer_fill(guacenc_buffer* buffer);
+
+/**
+ * Adds the given rectangle to the damaged region of the given buffer. Only
+ * the portion of the rectangle within the bounds of the buffer is added.
+ *
+ * @param buffer
+ *     The buffer being damaged.
+ *
+ * @param rect
+ *     The rectangle which has been modified.
+ */
+void guacenc_buffer_damage(guacenc_buffer* buffer, const guacenc_rect* rect);
+
 #endif
 
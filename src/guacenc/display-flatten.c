@@ -78,6 +78,152 @@ static int guacenc_display_layer_comparator(const void* a, const void* b) {
 
 }
 
+/**
+ * Calculates the bounds of the given layer within the coordinate space of the
+ * default layer. Layers which cannot be reached from the default layer by
+ * following their parents are not rendered, and are given empty bounds.
+ *
+ * @param display
+ *     The display containing the given layer.
+ *
+ * @param layer
+ *     The layer whose bounds should be calculated.
+ *
+ * @param bounds
+ *     The rectangle in which the calculated bounds should be stored.
+ */
+static void guacenc_display_get_bounds(guacenc_display* display,
+        guacenc_layer* layer, guacenc_rect* bounds) {
+
+    guacenc_layer* def_layer = display->layers[0];
+    guacenc_layer* current = layer;
+
+    int x = 0;
+    int y = 0;
+    int depth = 0;
+
+    /* Sum positions of all layers between the given layer and the default
+     * layer, guarding against cycles */
+    while (current != def_layer) {
+
+        int parent_index = current->parent_index;
+        if (parent_index < 0 || parent_index >= GUACENC_DISPLAY_MAX_LAYERS
+                || depth++ >= GUACENC_DISPLAY_MAX_LAYERS) {
+            guacenc_rect_init(bounds, 0, 0, 0, 0);
+            return;
+        }
+
+        x += current->x;
+        y += current->y;
+
+        /* Layers with missing parents are not rendered */
+        current = display->layers[parent_index];
+        if (current == NULL) {
+            guacenc_rect_init(bounds, 0, 0, 0, 0);
+            return;
+        }
+
+    }
+
+    guacenc_rect_init(bounds, x, y, layer->buffer->width,
+            layer->buffer->height);
+
+}
+
+/**
+ * Determines the region of the default layer which must be redrawn due to
+ * changes since the display was last flattened, updating the recorded
+ * rendering state of each layer and of the mouse cursor, and resetting the
+ * damage of each layer's buffer.
+ *
+ * @param display
+ *     The display whose damaged region should be determined.
+ *
+ * @param render_order
+ *     All layers of the display, sorted as by
+ *     guacenc_display_layer_comparator.
+ *
+ * @param damage
+ *     The rectangle in which the damaged region should be stored.
+ */
+static void guacenc_display_get_damage(guacenc_display* display,
+        guacenc_layer** render_order, guacenc_rect* damage) {
+
+    int i;
+
+    /* Begin with damage not associated with any existing layer */
+    *damage = display->damage;
+    guacenc_rect_init(&display->damage, 0, 0, 0, 0);
+
+    for (i = 0; i < GUACENC_DISPLAY_MAX_LAYERS; i++) {
+
+        /* Pull current layer, ignoring unallocated layers */
+        guacenc_layer* layer = render_order[i];
+        if (layer == NULL)
+            continue;
+
+        guacenc_rect bounds;
+        guacenc_display_get_bounds(display, layer, &bounds);
+
+        /* Redraw both the old and new areas of layers which have been moved,
+         * resized, restacked, or shaded */
+        if (!layer->rendered
+                || !guacenc_rect_equals(&bounds, &layer->rendered_bounds)
+                || layer->opacity != layer->rendered_opacity
+                || layer->z != layer->rendered_z
+                || layer->parent_index != layer->rendered_parent_index) {
+
+            if (layer->rendered)
+                guacenc_rect_extend(damage, &layer->rendered_bounds);
+
+            guacenc_rect_extend(damage, &bounds);
+
+        }
+
+        /* Redraw areas of layers which have been drawn to */
+        guacenc_buffer* buffer = layer->buffer;
+        if (!guacenc_rect_is_empty(&bounds)) {
+            guacenc_rect modified = buffer->damage;
+            modified.x += bounds.x;
+            modified.y += bounds.y;
+            guacenc_rect_extend(damage, &modified);
+        }
+
+        guacenc_rect_init(&buffer->damage, 0, 0, 0, 0);
+
+        /* Record state of layer as rendered */
+        layer->rendered = true;
+        layer->rendered_bounds = bounds;
+        layer->rendered_opacity = layer->opacity;
+        layer->rendered_z = layer->z;
+        layer->rendered_parent_index = layer->parent_index;
+
+    }
+
+    /* Redraw both the old and new areas of the mouse cursor */
+    guacenc_cursor* cursor = display->cursor;
+    guacenc_rect cursor_bounds;
+    if (cursor->x < 0 || cursor->y < 0)
+        guacenc_rect_init(&cursor_bounds, 0, 0, 0, 0);
+    else
+        guacenc_rect_init(&cursor_bounds,
+                cursor->x - cursor->hotspot_x,
+                cursor->y - cursor->hotspot_y,
+                cursor->buffer->width, cursor->buffer->height);
+
+    guacenc_rect_extend(damage, &display->rendered_cursor);
+    guacenc_rect_extend(damage, &cursor_bounds);
+    display->rendered_cursor = cursor_bounds;
+
+    /* Only the area within the default layer is visible */
+    guacenc_buffer* def_buffer = display->layers[0]->buffer;
+    guacenc_rect def_bounds;
+    guacenc_rect_init(&def_bounds, 0, 0, def_buffer->width,
+            def_buffer->height);
+    guacenc_rect_constrain(damage, &def_bounds);
+
+}
+
 /**
  * Renders the mouse cursor on top of the frame buffer of the default layer of
  * the given display.
@@ -86,10 +232,15 @@ static int guacenc_display_layer_comparator(const void* a, const void* b) {
  *     The display whose mouse cursor should be rendered to the frame buffer
  *     of its default layer.
  *
+ * @param damage
+ *     The region of the frame buffer of the default layer which is being
+ *     redrawn. The cursor is rendered only within this region.
+ *
  * @return
  *     Zero if rendering succeeds, non-zero otherwise.
  */
-static int guacenc_display_render_cursor(guacenc_display* display) {
+static int guacenc_display_render_cursor(guacenc_display* display,
+        const guacenc_rect* damage) {
 
     guacenc_cursor* cursor = display->cursor;
 
@@ -106,7 +257,14 @@ static int guacenc_display_render_cursor(guacenc_display* display) {
     guacenc_buffer* dst = def_layer->frame;
 
     /* Render cursor to layer */
-    if (src->width > 0 && src->height > 0) {
+    if (src->width > 0 && src->height > 0 && dst->cairo != NULL
+            && !guacenc_rect_is_empty(damage)) {
+
+        cairo_reset_clip(dst->cairo);
+        cairo_rectangle(dst->cairo, damage->x, damage->y,
+                damage->width, damage->height);
+        cairo_clip(dst->cairo);
+
         cairo_set_source_surface(dst->cairo, src->surface,
                 cursor->x - cursor->hotspot_x,
                 cursor->y - cursor->hotspot_y);
@@ -115,6 +273,7 @@ static int guacenc_display_render_cursor(guacenc_display* display) {
                 cursor->y - cursor->hotspot_y,
                 src->width, src->height);
         cairo_fill(dst->cairo);
+
     }
 
     /* Always succeeds */
@@ -127,6 +286,11 @@ int guacenc_display_flatten(guacenc_display* display) {
     int i;
     guacenc_layer* render_order[GUACENC_DISPLAY_MAX_LAYERS];
 
+    /* Retrieve default layer, allocating it if necessary */
+    guacenc_layer* def_layer = guacenc_display_get_layer(display, 0);
+    if (def_layer == NULL)
+        return 1;
+
     /* Copy list of layers within display */
     memcpy(render_order, display->layers, sizeof(render_order));
 
@@ -135,7 +299,11 @@ int guacenc_display_flatten(guacenc_display* display) {
     qsort(render_order, GUACENC_DISPLAY_MAX_LAYERS, sizeof(guacenc_layer*),
             guacenc_display_layer_comparator);
 
-    /* Reset layer frame buffers */
+    /* Determine region of default layer which must be redrawn */
+    guacenc_rect damage;
+    guacenc_display_get_damage(display, render_order, &damage);
+
+    /* Reset layer frame buffers within damaged region */
     for (i = 0; i < GUACENC_DISPLAY_MAX_LAYERS; i++) {
 
         /* Pull current layer, ignoring unallocated layers */
@@ -147,8 +315,33 @@ int guacenc_display_flatten(guacenc_display* display) {
         guacenc_buffer* buffer = layer->buffer;
         guacenc_buffer* frame = layer->frame;
 
-        /* Reset frame contents */
-        guacenc_buffer_copy(frame, buffer);
+        /* Frame buffers always match the size of their layers */
+        if (guacenc_buffer_resize(frame, buffer->width, buffer->height))
+            return 1;
+
+        /* Translate damaged region into coordinates of layer */
+        guacenc_rect area = damage;
+        area.x -= layer->rendered_bounds.x;
+        area.y -= layer->rendered_bounds.y;
+
+        guacenc_rect bounds;
+        guacenc_rect_init(&bounds, 0, 0, buffer->width, buffer->height);
+        guacenc_rect_constrain(&area, &bounds);
+
+        /* Ignore layers which are unaffected */
+        if (buffer->surface == NULL || guacenc_rect_is_empty(&area))
+            continue;
+
+        /* Reset frame contents within damaged region */
+        cairo_t* cairo = frame->cairo;
+        cairo_reset_clip(cairo);
+        cairo_rectangle(cairo, area.x, area.y, area.width, area.height);
+        cairo_clip(cairo);
+
+        cairo_set_operator(cairo, CAIRO_OPERATOR_SOURCE);
+        cairo_set_source_surface(cairo, buffer->surface, 0, 0);
+        cairo_paint(cairo);
+        cairo_set_operator(cairo, CAIRO_OPERATOR_OVER);
 
     }
 
@@ -188,9 +381,21 @@ int guacenc_display_flatten(guacenc_display* display) {
         if (cairo == NULL)
             continue;
 
+        /* Translate damaged region into coordinates of parent */
+        guacenc_rect clip = damage;
+        clip.x -= parent->rendered_bounds.x;
+        clip.y -= parent->rendered_bounds.y;
+
+        /* Render only the damaged portion of the layer */
+        guacenc_rect area;
+        guacenc_rect_init(&area, layer->x, layer->y, src->width, src->height);
+        guacenc_rect_constrain(&area, &clip);
+        if (guacenc_rect_is_empty(&area))
+            continue;
+
         /* Render buffer to layer */
         cairo_reset_clip(cairo);
-        cairo_rectangle(cairo, layer->x, layer->y, src->width, src->height);
+        cairo_rectangle(cairo, area.x, area.y, area.width, area.height);
         cairo_clip(cairo);
 
         cairo_set_source_surface(cairo, surface, layer->x, layer->y);
@@ -198,8 +403,10 @@ int guacenc_display_flatten(guacenc_display* display) {
 
     }
 
+    /* Only the damaged region of the default layer has changed */
+    def_layer->frame->damage = damage;
+
     /* Render cursor on top of everything else */
-    return guacenc_display_render_cursor(display);
+    return guacenc_display_render_cursor(display, &damage);
 
 }
-
@@ -87,8 +87,13 @@ int guacenc_display_free_layer(guacenc_display* display,
         return 1;
     }
 
+    /* The area previously covered by the layer must be redrawn */
+    guacenc_layer* layer = display->layers[index];
+    if (layer != NULL && layer->rendered)
+        guacenc_rect_extend(&display->damage, &layer->rendered_bounds);
+
     /* Free layer (if allocated) */
-    guacenc_layer_free(display->layers[index]);
+    guacenc_layer_free(layer);
 
     /* Mark layer as freed */
     display->layers[index] = NULL;
@@ -25,6 +25,7 @@
 #include "cursor.h"
 #include "image-stream.h"
 #include "layer.h"
+#include "rect.h"
 #include "video.h"
 
 #include <cairo/cairo.h>
@@ -89,6 +90,21 @@ typedef struct guacenc_display {
      */
     guac_timestamp last_sync;
 
+    /**
+     * The region of the default layer which has been modified since the
+     * display was last flattened, other than through damage to the buffers of
+     * layers which still exist (such as through disposing of layers). Damage
+     * to the buffers of layers is tracked by the buffers themselves.
+     */
+    guacenc_rect damage;
+
+    /**
+     * The bounds of the mouse cursor within the default layer when the
+     * display was last flattened. This will be empty if the cursor was not
+     * rendered.
+     */
+    guacenc_rect rendered_cursor;
+
     /**
      * The video that this display is recording to.
      */
@@ -116,8 +132,10 @@ int guacenc_display_sync(guacenc_display* display, guac_timestamp timestamp);
  * Flattens the given display, rendering all child layers to the frame buffers
  * of their parent layers. The frame buffer of the default layer of the display
  * will thus contain the flattened, composited rendering of the entire display
- * state after this function succeeds. The contents of the frame buffers of
- * each layer are replaced by this function.
+ * state after this function succeeds. Only the regions of the frame buffers
+ * affected by changes since the display was last flattened are redrawn, and
+ * the damaged region of the frame buffer of the default layer is set to the
+ * union of those regions.
  *
  * @param display
  *     The display to flatten.
@@ -18,6 +18,8 @@
  */
 
 #include "config.h"
+#include "common/recording-compression.h"
+#include "common/recording-index.h"
 #include "display.h"
 #include "instructions.h"
 #include "log.h"
@@ -26,18 +28,23 @@
 #include <guacamole/error.h>
 #include <guacamole/parser.h>
 #include <guacamole/socket.h>
+#include <guacamole/timestamp.h>
 
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <inttypes.h>
 #include <stdbool.h>
 #include <string.h>
 #include <unistd.h>
 
 /**
  * Reads and handles all Guacamole instructions from the given guac_socket
- * until end-of-stream is reached.
+ * until end-of-stream is reached, or until the end of the requested portion
+ * of the recording is reached. Frames are rendered only within the requested
+ * portion of the recording, with the position within the recording measured
+ * using the timestamps of timestamped instructions.
  *
  * @param display
  *     The current internal display of the Guacamole video encoder.
@@ -49,12 +56,29 @@
  * @param socket
  *     The guac_socket through which instructions should be read.
  *
+ * @param start
+ *     The number of milliseconds from the start of the recording at which
+ *     frames should begin to be rendered.
+ *
+ * @param end
+ *     The number of milliseconds from the start of the recording after which
+ *     reading should stop, or a negative value to read until end-of-stream.
+ *
+ * @param has_origin
+ *     Whether the timestamp of the start of the recording is already known,
+ *     as when reading begins at a checkpoint within the recording.
+ *
+ * @param origin
+ *     The timestamp of the start of the recording, if has_origin is true.
+ *     If false, the first timestamp read is used.
+ *
  * @return
  *     Zero on success, non-zero if parsing of Guacamole protocol data through
  *     the given socket fails.
  */
 static int guacenc_read_instructions(guacenc_display* display,
-        const char* path, guac_socket* socket) {
+        const char* path, guac_socket* socket, guac_timestamp start,
+        guac_timestamp end, bool has_origin, guac_timestamp origin) {
 
     /* Obtain Guacamole protocol parser */
     guac_parser* parser = guac_parser_alloc();
@@ -63,11 +87,43 @@ static int guacenc_read_instructions(guacenc_display* display,
 
     /* Continuously read and handle all instructions */
     while (!guac_parser_read(parser, socket, -1)) {
+
+        int argc = parser->argc;
+
+        /* Track position within recording */
+        guac_timestamp timestamp;
+        if (guac_common_recording_get_timestamp(parser->opcode,
+                    parser->argc, parser->argv, &timestamp)) {
+
+            /* The first timestamp marks the start of the recording */
+            if (!has_origin) {
+                origin = timestamp;
+                has_origin = true;
+            }
+
+            /* Stop once the requested portion of the recording is complete */
+            if (end >= 0 && timestamp - origin > end) {
+                guac_parser_free(parser);
+                return 0;
+            }
+
+            /* Do not render frames before the requested portion of the
+             * recording, but continue tracking the mouse cursor */
+            if (timestamp - origin < start) {
+                if (strcmp(parser->opcode, "sync") == 0)
+                    continue;
+                if (strcmp(parser->opcode, "mouse") == 0)
+                    argc = 3;
+            }
+
+        }
+
         if (guacenc_handle_instruction(display, parser->opcode,
-                parser->argc, parser->argv)) {
+                argc, parser->argv)) {
             guacenc_log(GUAC_LOG_DEBUG, "Handling of \"%s\" instruction "
                     "failed.", parser->opcode);
         }
+
     }
 
     /* Fail on read/parse error */
@@ -84,8 +140,69 @@ static int guacenc_read_instructions(guacenc_display* display,
 
 }
 
+/**
+ * Restores the state of the given display from the nearest checkpoint at or
+ * before the given time within the index of the given recording, storing the
+ * corresponding position within the recording. If the recording has no usable
+ * index, the display and stored position are left untouched.
+ *
+ * @param display
+ *     The display whose state should be restored.
+ *
+ * @param path
+ *     The path to the recording.
+ *
+ * @param start
+ *     The number of milliseconds from the start of the recording at which
+ *     encoding should begin.
+ *
+ * @param origin
+ *     Storage for the timestamp of the start of the recording, if a
+ *     checkpoint is found.
+ *
+ * @param offset
+ *     Storage for the offset within the uncompressed recording at which
+ *     reading should resume, if a checkpoint is found.
+ *
+ * @return
+ *     true if the display was restored from a checkpoint, false otherwise.
+ */
+static bool guacenc_seek(guacenc_display* display, const char* path,
+        guac_timestamp start, guac_timestamp* origin, int64_t* offset) {
+
+    int i;
+
+    guac_common_recording_checkpoint* checkpoint =
+        guac_common_recording_index_find(path, start);
+
+    if (checkpoint == NULL) {
+        guacenc_log(GUAC_LOG_INFO, "No usable index for \"%s\". Reading "
+                "from the start of the recording.", path);
+        return false;
+    }
+
+    guacenc_log(GUAC_LOG_INFO, "Resuming \"%s\" from checkpoint at %" PRId64
+            " ms.", path, (int64_t) (checkpoint->timestamp - checkpoint->start));
+
+    /* Restore layers and buffers as they existed at the checkpoint (their
+     * contents will be drawn as the remainder of the recording is read) */
+    for (i = 0; i < checkpoint->length; i++) {
+        guac_common_recording_index_instruction* instruction =
+            &checkpoint->state[i];
+        guacenc_handle_instruction(display, instruction->opcode,
+                instruction->argc, instruction->argv);
+    }
+
+    *origin = checkpoint->start;
+    *offset = checkpoint->offset;
+    guac_common_recording_checkpoint_free(checkpoint);
+    return true;
+
+}
+
 int guacenc_encode(const char* path, const char* out_path, const char* codec,
-        int width, int height, int bitrate, bool force) {
+        int width, int height, int bitrate, bool force,
+        guac_timestamp start, guac_timestamp end) {
 
     /* Open input file */
     int fd = open(path, O_RDONLY);
@@ -129,8 +246,15 @@ int guacenc_encode(const char* path, const char* out_path, const char* codec,
         return 1;
     }
 
-    /* Obtain guac_socket wrapping file descriptor */
-    guac_socket* socket = guac_socket_open(fd);
+    /* Skip directly to the requested portion of the recording, if possible */
+    guac_timestamp origin = 0;
+    int64_t offset = 0;
+    bool has_origin = false;
+    if (start > 0)
+        has_origin = guacenc_seek(display, path, start, &origin, &offset);
+
+    /* Obtain guac_socket reading the (possibly compressed) recording */
+    guac_socket* socket = guac_common_recording_input_open(fd, offset);
     if (socket == NULL) {
         guacenc_log(GUAC_LOG_ERROR, "%s: %s", path,
                 guac_status_string(guac_error));
@@ -142,7 +266,8 @@ int guacenc_encode(const char* path, const char* out_path, const char* codec,
     guacenc_log(GUAC_LOG_INFO, "Encoding \"%s\" to \"%s\" ...", path, out_path);
 
     /* Attempt to read all instructions in the file */
-    if (guacenc_read_instructions(display, path, socket)) {
+    if (guacenc_read_instructions(display, path, socket, start, end,
+                has_origin, origin)) {
         guac_socket_free(socket);
         guacenc_display_free(display);
         return 1;
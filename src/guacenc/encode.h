@@ -22,6 +22,8 @@
 
 #include "config.h"
 
+#include <guacamole/timestamp-types.h>
+
 #include <stdbool.h>
 
 /**
@@ -54,12 +56,24 @@
  *     Perform the encoding, even if the input file appears to be an
  *     in-progress recording (has an associated lock).
  *
+ * @param start
+ *     The number of milliseconds from the start of the recording at which the
+ *     video should begin. If the recording has an index, encoding resumes
+ *     from the nearest preceding checkpoint rather than from the start of the
+ *     recording.
+ *
+ * @param end
+ *     The number of milliseconds from the start of the recording at which the
+ *     video should end, or a negative value to encode through the end of the
+ *     recording.
+ *
  * @return
  *     Zero on success, non-zero if an error prevented successful encoding of
  *     the video.
  */
 int guacenc_encode(const char* path, const char* out_path, const char* codec,
-        int width, int height, int bitrate, bool force);
+        int width, int height, int bitrate, bool force,
+        guac_timestamp start, guac_timestamp end);
 
 #endif
 
@@ -19,6 +19,7 @@
 
 #include "config.h"
 
+#include "common/recording-index.h"
 #include "encode.h"
 #include "guacenc.h"
 #include "log.h"
@@ -28,8 +29,156 @@
 #include <libavformat/avformat.h>
 
 #include <getopt.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
+
+/**
+ * The set of input files being encoded, shared by all threads which encode
+ * those files concurrently.
+ */
+typedef struct guacenc_batch {
+
+    /**
+     * The paths of all input files to be encoded.
+     */
+    char** paths;
+
+    /**
+     * The total number of input files within paths.
+     */
+    int total_files;
+
+    /**
+     * The index of the next input file within paths which has not yet been
+     * claimed by an encoding thread.
+     */
+    int next_file;
+
+    /**
+     * The number of input files which could not be encoded.
+     */
+    int failures;
+
+    /**
+     * Lock which guards access to next_file and failures.
+     */
+    pthread_mutex_t lock;
+
+    /**
+     * The width of the output videos, in pixels.
+     */
+    int width;
+
+    /**
+     * The height of the output videos, in pixels.
+     */
+    int height;
+
+    /**
+     * The desired bitrate of the output videos, in bits per second.
+     */
+    int bitrate;
+
+    /**
+     * Whether input files should be encoded even if they appear to be
+     * in-progress recordings.
+     */
+    bool force;
+
+    /**
+     * The number of milliseconds from the start of each recording at which
+     * the output videos should begin.
+     */
+    guac_timestamp start;
+
+    /**
+     * The number of milliseconds from the start of each recording at which
+     * the output videos should end, or a negative value if the output videos
+     * should continue through the end of each recording.
+     */
+    guac_timestamp end;
+
+} guacenc_batch;
+
+/**
+ * Encodes the given input file to a new file having the same name with the
+ * ".m4v" extension appended.
+ *
+ * @param batch
+ *     The batch defining the options which should be used for encoding.
+ *
+ * @param path
+ *     The path of the input file to encode.
+ *
+ * @return
+ *     Zero if the file was encoded successfully, non-zero otherwise.
+ */
+static int guacenc_batch_encode_file(guacenc_batch* batch, const char* path) {
+
+    /* Generate output filename */
+    char out_path[4096];
+    int len = snprintf(out_path, sizeof(out_path), "%s.m4v", path);
+
+    /* Do not write if filename exceeds maximum length */
+    if (len >= sizeof(out_path)) {
+        guacenc_log(GUAC_LOG_ERROR, "Cannot write output file for \"%s\": "
+                "Name too long", path);
+        return 1;
+    }
+
+    /* Attempt encoding, log granular success/failure at debug level */
+    if (guacenc_encode(path, out_path, "mpeg4",
+                batch->width, batch->height, batch->bitrate, batch->force,
+                batch->start, batch->end)) {
+        guacenc_log(GUAC_LOG_DEBUG,
+                "%s was NOT successfully encoded.", path);
+        return 1;
+    }
+
+    guacenc_log(GUAC_LOG_DEBUG, "%s was successfully encoded.", path);
+    return 0;
+
+}
+
+/**
+ * Repeatedly claims and encodes the next input file of the given batch until
+ * no input files remain. Several threads may run this function concurrently
+ * for the same batch.
+ *
+ * @param data
+ *     The guacenc_batch containing the input files to encode.
+ *
+ * @return
+ *     Always NULL.
+ */
+static void* guacenc_batch_worker(void* data) {
+
+    guacenc_batch* batch = (guacenc_batch*) data;
+
+    for (;;) {
+
+        /* Claim next input file, if any */
+        pthread_mutex_lock(&batch->lock);
+        int index = batch->next_file++;
+        pthread_mutex_unlock(&batch->lock);
+
+        if (index >= batch->total_files)
+            break;
+
+        /* Track failures across all threads */
+        if (guacenc_batch_encode_file(batch, batch->paths[index])) {
+            pthread_mutex_lock(&batch->lock);
+            batch->failures++;
+            pthread_mutex_unlock(&batch->lock);
+        }
+
+    }
+
+    return NULL;
+
+}
 
 int main(int argc, char* argv[]) {
 
@@ -40,10 +189,13 @@ int main(int argc, char* argv[]) {
     int width = GUACENC_DEFAULT_WIDTH;
     int height = GUACENC_DEFAULT_HEIGHT;
     int bitrate = GUACENC_DEFAULT_BITRATE;
+    int jobs = GUACENC_DEFAULT_JOBS;
+    guac_timestamp start = 0;
+    guac_timestamp end = -1;
 
     /* Parse arguments */
     int opt;
-    while ((opt = getopt(argc, argv, "s:r:f")) != -1) {
+    while ((opt = getopt(argc, argv, "s:r:j:S:E:f")) != -1) {
 
         /* -s: Dimensions (WIDTHxHEIGHT) */
         if (opt == 's') {
@@ -61,6 +213,30 @@ int main(int argc, char* argv[]) {
             }
         }
 
+        /* -j: Number of files to encode concurrently */
+        else if (opt == 'j') {
+            if (guacenc_parse_int(optarg, &jobs) || jobs <= 0) {
+                guacenc_log(GUAC_LOG_ERROR, "Invalid number of jobs.");
+                goto invalid_options;
+            }
+        }
+
+        /* -S: Start time ([[HH:]MM:]SS) */
+        else if (opt == 'S') {
+            if (guac_common_recording_parse_time(optarg, &start)) {
+                guacenc_log(GUAC_LOG_ERROR, "Invalid start time.");
+                goto invalid_options;
+            }
+        }
+
+        /* -E: End time ([[HH:]MM:]SS) */
+        else if (opt == 'E') {
+            if (guac_common_recording_parse_time(optarg, &end)) {
+                guacenc_log(GUAC_LOG_ERROR, "Invalid end time.");
+                goto invalid_options;
+            }
+        }
+
         /* -f: Force */
         else if (opt == 'f')
             force = true;
@@ -87,7 +263,6 @@ int main(int argc, char* argv[]) {
 
     /* Track number of overall failures */
     int total_files = argc - optind;
-    int failures = 0;
 
     /* Abort if no files given */
     if (total_files <= 0) {
@@ -100,35 +275,63 @@ int main(int argc, char* argv[]) {
     guacenc_log(GUAC_LOG_INFO, "Video will be encoded at %ix%i "
             "and %i bps.", width, height, bitrate);
 
-    /* Encode all input files */
-    for (i = optind; i < argc; i++) {
-
-        /* Get current filename */
-        const char* path = argv[i];
+    guacenc_batch batch = {
+        .paths       = argv + optind,
+        .total_files = total_files,
+        .next_file   = 0,
+        .failures    = 0,
+        .width       = width,
+        .height      = height,
+        .bitrate     = bitrate,
+        .force       = force,
+        .start       = start,
+        .end         = end
+    };
+
+    pthread_mutex_init(&batch.lock, NULL);
+
+    /* There is no benefit to more threads than files */
+    if (jobs > total_files)
+        jobs = total_files;
+
+    /* Encode all input files, using additional threads only if requested */
+    if (jobs == 1)
+        guacenc_batch_worker(&batch);
+
+    else {
+
+        guacenc_log(GUAC_LOG_INFO, "Encoding up to %i files concurrently.",
+                jobs);
+
+        pthread_t* threads = malloc(sizeof(pthread_t) * jobs);
+        int started = 0;
+
+        /* Start as many threads as possible, encoding on the current thread
+         * if no additional threads could be started */
+        for (i = 0; threads != NULL && i < jobs; i++) {
+            if (pthread_create(&threads[started], NULL,
+                        guacenc_batch_worker, &batch)) {
+                guacenc_log(GUAC_LOG_WARNING, "Unable to start encoding "
+                        "thread. Continuing with %i thread(s).", started);
+                break;
+            }
+            started++;
+        }
 
-        /* Generate output filename */
-        char out_path[4096];
-        int len = snprintf(out_path, sizeof(out_path), "%s.m4v", path);
+        if (started == 0)
+            guacenc_batch_worker(&batch);
 
-        /* Do not write if filename exceeds maximum length */
-        if (len >= sizeof(out_path)) {
-            guacenc_log(GUAC_LOG_ERROR, "Cannot write output file for \"%s\": "
-                    "Name too long", path);
-            continue;
-        }
+        /* Wait for all files to be encoded */
+        for (i = 0; i < started; i++)
+            pthread_join(threads[i], NULL);
 
-        /* Attempt encoding, log granular success/failure at debug level */
-        if (guacenc_encode(path, out_path, "mpeg4",
-                    width, height, bitrate, force)) {
-            failures++;
-            guacenc_log(GUAC_LOG_DEBUG,
-                    "%s was NOT successfully encoded.", path);
-        }
-        else
-            guacenc_log(GUAC_LOG_DEBUG, "%s was successfully encoded.", path);
+        free(threads);
 
     }
 
+    pthread_mutex_destroy(&batch.lock);
+    int failures = batch.failures;
+
     /* Warn if at least one file failed */
     if (failures != 0)
         guacenc_log(GUAC_LOG_WARNING, "Encoding failed for %i of %i file(s).",
@@ -147,6 +350,9 @@ invalid_options:
     fprintf(stderr, "USAGE: %s"
             " [-s WIDTHxHEIGHT]"
             " [-r BITRATE]"
+            " [-j JOBS]"
+            " [-S START]"
+            " [-E END]"
             " [-f]"
             " [FILE]...\n", argv[0]);
 
@@ -44,6 +44,12 @@
  */
 #define GUACENC_DEFAULT_BITRATE 2000000
 
+/**
+ * The number of input files which should be encoded concurrently, if no other
+ * number is given on the command line.
+ */
+#define GUACENC_DEFAULT_JOBS 1
+
 /**
  * The default log level below which no messages should be logged.
  */
@@ -142,8 +142,8 @@ int guacenc_image_stream_end(guacenc_image_stream* stream,
     if (buffer->cairo != NULL) {
         cairo_set_operator(buffer->cairo, guacenc_display_cairo_operator(stream->mask));
         cairo_set_source_surface(buffer->cairo, surface, stream->x, stream->y);
-        cairo_rectangle(buffer->cairo, stream->x, stream->y, width, height);
-        cairo_fill(buffer->cairo);
+        guacenc_buffer_add_rect(buffer, stream->x, stream->y, width, height);
+        guacenc_buffer_fill(buffer);
     }
 
     cairo_surface_destroy(surface);
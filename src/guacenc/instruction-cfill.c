@@ -50,7 +50,7 @@ int guacenc_handle_cfill(guacenc_display* display, int argc, char** argv) {
     if (buffer->cairo != NULL) {
         cairo_set_operator(buffer->cairo, guacenc_display_cairo_operator(mask));
         cairo_set_source_rgba(buffer->cairo, r, g, b, a);
-        cairo_fill(buffer->cairo);
+        guacenc_buffer_fill(buffer);
     }
 
     return 0;
@@ -52,8 +52,7 @@ int guacenc_handle_rect(guacenc_display* display, int argc, char** argv) {
         guacenc_buffer_fit(buffer, x + width, y + height);
 
     /* Set path to rectangle */
-    if (buffer->cairo != NULL)
-        cairo_rectangle(buffer->cairo, x, y, width, height);
+    guacenc_buffer_add_rect(buffer, x, y, width, height);
 
     return 0;
 
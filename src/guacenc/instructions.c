@@ -23,7 +23,9 @@
 #include "log.h"
 
 #include <guacamole/client.h>
+#include <guacamole/opcode.h>
 
+#include <pthread.h>
 #include <string.h>
 
 guacenc_instruction_handler_mapping guacenc_instruction_handler_map[] = {
@@ -44,33 +46,63 @@ guacenc_instruction_handler_mapping guacenc_instruction_handler_map[] = {
     {NULL,       NULL}
 };
 
-int guacenc_handle_instruction(guacenc_display* display, const char* opcode,
-        int argc, char** argv) {
+/**
+ * Perfect-hash index of guacenc_instruction_handler_map, built upon handling
+ * the first instruction, or NULL if the index could not be built.
+ */
+static guac_opcode_map* guacenc_instruction_opcode_map = NULL;
 
-    /* Search through mapping for instruction handler having given opcode */
-    guacenc_instruction_handler_mapping* current = guacenc_instruction_handler_map;
-    while (current->opcode != NULL) {
+/**
+ * Guard ensuring the opcode index of the handler map is built only once,
+ * even if instructions are handled concurrently by multiple threads.
+ */
+static pthread_once_t guacenc_instruction_opcode_map_once = PTHREAD_ONCE_INIT;
 
-        /* Invoke handler if opcode matches (if defined) */
-        if (strcmp(current->opcode, opcode) == 0) {
+/**
+ * Builds the perfect-hash index of guacenc_instruction_handler_map. This
+ * function is invoked only once, via pthread_once().
+ */
+static void guacenc_init_instruction_opcode_map() {
+    guacenc_instruction_opcode_map = guac_opcode_map_alloc(
+            guacenc_instruction_handler_map,
+            sizeof(guacenc_instruction_handler_mapping));
+}
 
-            /* Invoke defined handler */
-            guacenc_instruction_handler* handler = current->handler;
-            if (handler != NULL)
-                return handler(display, argc, argv);
+int guacenc_handle_instruction(guacenc_display* display, const char* opcode,
+        int argc, char** argv) {
 
-            /* Log defined but unimplemented instructions */
-            guacenc_log(GUAC_LOG_DEBUG, "\"%s\" not implemented", opcode);
-            return 0;
+    /* Index the mapping by opcode upon first use */
+    pthread_once(&guacenc_instruction_opcode_map_once,
+            guacenc_init_instruction_opcode_map);
 
-        }
+    /* Locate instruction handler having given opcode, searching the mapping
+     * linearly only if it could not be indexed */
+    guacenc_instruction_handler_mapping* current = NULL;
+    if (guacenc_instruction_opcode_map != NULL) {
+        int index = guac_opcode_map_lookup(guacenc_instruction_opcode_map,
+                opcode);
+        if (index != -1)
+            current = &guacenc_instruction_handler_map[index];
+    }
+    else {
+        current = guacenc_instruction_handler_map;
+        while (current->opcode != NULL && strcmp(current->opcode, opcode) != 0)
+            current++;
+        if (current->opcode == NULL)
+            current = NULL;
+    }
 
-        /* Next candidate handler */
-        current++;
+    /* Ignore any unknown instructions */
+    if (current == NULL)
+        return 0;
 
-    } /* end opcode search */
+    /* Invoke defined handler */
+    guacenc_instruction_handler* handler = current->handler;
+    if (handler != NULL)
+        return handler(display, argc, argv);
 
-    /* Ignore any unknown instructions */
+    /* Log defined but unimplemented instructions */
+    guacenc_log(GUAC_LOG_DEBUG, "\"%s\" not implemented", opcode);
     return 0;
 
 }
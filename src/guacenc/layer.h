@@ -22,6 +22,9 @@
 
 #include "config.h"
 #include "buffer.h"
+#include "rect.h"
+
+#include <stdbool.h>
 
 /**
  * The value assigned to the parent_index property of a guacenc_layer if it has
@@ -77,6 +80,36 @@ typedef struct guacenc_layer {
      */
     guacenc_buffer* frame;
 
+    /**
+     * Whether this layer has been rendered by guacenc_display_flatten(). If
+     * false, the remaining "rendered_" properties are undefined.
+     */
+    bool rendered;
+
+    /**
+     * The bounds of this layer within the coordinate space of the default
+     * layer when this layer was last rendered. The X and Y coordinates are
+     * meaningful even if the layer has no pixels.
+     */
+    guacenc_rect rendered_bounds;
+
+    /**
+     * The opacity of this layer when this layer was last rendered.
+     */
+    int rendered_opacity;
+
+    /**
+     * The relative stacking order of this layer when this layer was last
+     * rendered.
+     */
+    int rendered_z;
+
+    /**
+     * The index of the parent of this layer when this layer was last
+     * rendered.
+     */
+    int rendered_parent_index;
+
 } guacenc_layer;
 
 /**
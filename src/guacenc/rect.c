@@ -0,0 +1,96 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+#include "rect.h"
+
+#include <stdbool.h>
+
+void guacenc_rect_init(guacenc_rect* rect, int x, int y, int width,
+        int height) {
+    rect->x = x;
+    rect->y = y;
+    rect->width = width;
+    rect->height = height;
+}
+
+bool guacenc_rect_is_empty(const guacenc_rect* rect) {
+    return rect->width <= 0 || rect->height <= 0;
+}
+
+bool guacenc_rect_equals(const guacenc_rect* a, const guacenc_rect* b) {
+    return a->x == b->x
+        && a->y == b->y
+        && a->width == b->width
+        && a->height == b->height;
+}
+
+void guacenc_rect_extend(guacenc_rect* rect, const guacenc_rect* other) {
+
+    /* Nothing to add if other rectangle has no area */
+    if (guacenc_rect_is_empty(other))
+        return;
+
+    /* Empty rectangles are simply replaced */
+    if (guacenc_rect_is_empty(rect)) {
+        *rect = *other;
+        return;
+    }
+
+    /* Calculate extents of union */
+    int left   = rect->x < other->x ? rect->x : other->x;
+    int top    = rect->y < other->y ? rect->y : other->y;
+    int right  = rect->x + rect->width;
+    int bottom = rect->y + rect->height;
+
+    if (other->x + other->width > right)
+        right = other->x + other->width;
+
+    if (other->y + other->height > bottom)
+        bottom = other->y + other->height;
+
+    guacenc_rect_init(rect, left, top, right - left, bottom - top);
+
+}
+
+void guacenc_rect_constrain(guacenc_rect* rect, const guacenc_rect* bounds) {
+
+    /* Calculate extents of intersection */
+    int left   = rect->x > bounds->x ? rect->x : bounds->x;
+    int top    = rect->y > bounds->y ? rect->y : bounds->y;
+    int right  = rect->x + rect->width;
+    int bottom = rect->y + rect->height;
+
+    if (bounds->x + bounds->width < right)
+        right = bounds->x + bounds->width;
+
+    if (bounds->y + bounds->height < bottom)
+        bottom = bounds->y + bounds->height;
+
+    /* Rectangles which do not overlap result in an empty rectangle */
+    if (right < left)
+        right = left;
+
+    if (bottom < top)
+        bottom = top;
+
+    guacenc_rect_init(rect, left, top, right - left, bottom - top);
+
+}
+
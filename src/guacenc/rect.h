@@ -0,0 +1,131 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUACENC_RECT_H
+#define GUACENC_RECT_H
+
+#include "config.h"
+
+#include <stdbool.h>
+
+/**
+ * An arbitrary rectangle, such as the region of a buffer which has changed.
+ * A rectangle having a non-positive width or height is empty. The X and Y
+ * coordinates of an empty rectangle are still meaningful, and may be used to
+ * describe the position of something which has no area.
+ */
+typedef struct guacenc_rect {
+
+    /**
+     * The X coordinate of the upper-left corner of the rectangle.
+     */
+    int x;
+
+    /**
+     * The Y coordinate of the upper-left corner of the rectangle.
+     */
+    int y;
+
+    /**
+     * The width of the rectangle, in pixels.
+     */
+    int width;
+
+    /**
+     * The height of the rectangle, in pixels.
+     */
+    int height;
+
+} guacenc_rect;
+
+/**
+ * Initializes the given rectangle with the given coordinates and dimensions.
+ *
+ * @param rect
+ *     The rectangle to initialize.
+ *
+ * @param x
+ *     The X coordinate of the upper-left corner of the rectangle.
+ *
+ * @param y
+ *     The Y coordinate of the upper-left corner of the rectangle.
+ *
+ * @param width
+ *     The width of the rectangle, in pixels.
+ *
+ * @param height
+ *     The height of the rectangle, in pixels.
+ */
+void guacenc_rect_init(guacenc_rect* rect, int x, int y, int width,
+        int height);
+
+/**
+ * Returns whether the given rectangle is empty (has no area).
+ *
+ * @param rect
+ *     The rectangle to test.
+ *
+ * @return
+ *     true if the given rectangle has no area, false otherwise.
+ */
+bool guacenc_rect_is_empty(const guacenc_rect* rect);
+
+/**
+ * Returns whether the two given rectangles are identical. Empty rectangles
+ * are identical only if their coordinates and dimensions are identical.
+ *
+ * @param a
+ *     The first rectangle to compare.
+ *
+ * @param b
+ *     The second rectangle to compare.
+ *
+ * @return
+ *     true if both rectangles are identical, false otherwise.
+ */
+bool guacenc_rect_equals(const guacenc_rect* a, const guacenc_rect* b);
+
+/**
+ * Expands the given rectangle such that it also contains the given
+ * rectangle. If the given rectangle is empty, the rectangle being expanded is
+ * unchanged. If the rectangle being expanded is empty, it is replaced by the
+ * given rectangle.
+ *
+ * @param rect
+ *     The rectangle to expand.
+ *
+ * @param other
+ *     The rectangle which must be contained within the expanded rectangle.
+ */
+void guacenc_rect_extend(guacenc_rect* rect, const guacenc_rect* other);
+
+/**
+ * Reduces the given rectangle to its intersection with the given bounds. If
+ * the rectangle and bounds do not overlap, the rectangle becomes empty.
+ *
+ * @param rect
+ *     The rectangle to reduce.
+ *
+ * @param bounds
+ *     The rectangle which the reduced rectangle must fit within.
+ */
+void guacenc_rect_constrain(guacenc_rect* rect, const guacenc_rect* bounds);
+
+#endif
+
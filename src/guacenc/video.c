@@ -40,10 +40,32 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <inttypes.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
+/**
+ * Lock which serializes the opening and closing of codecs, as older versions
+ * of libavcodec do not allow codecs to be opened or closed concurrently unless
+ * a lock manager has been registered. This is required only when several
+ * recordings are encoded at once.
+ */
+static pthread_mutex_t guacenc_video_codec_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Converts and encodes all jobs queued for the given video, until the video is
+ * freed with guacenc_video_free(). This function is the entry point of the
+ * encoding thread of each guacenc_video.
+ *
+ * @param data
+ *     The guacenc_video whose queued jobs should be processed.
+ *
+ * @return
+ *     Always NULL.
+ */
+static void* guacenc_video_encoder_thread(void* data);
+
 guacenc_video* guacenc_video_alloc(const char* path, const char* codec_name,
         int width, int height, int bitrate) {
 
@@ -92,13 +114,22 @@ guacenc_video* guacenc_video_alloc(const char* path, const char* codec_name,
         goto fail_context;
     }
 
+    /* Allow libavcodec to encode using its own threads, automatically
+     * choosing the number of threads based on the number of processors */
+    avcodec_context->thread_count = 0;
+    avcodec_context->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+
     /* If format needs global headers, write them */
     if (container_format_context->oformat->flags & AVFMT_GLOBALHEADER) {
         avcodec_context->flags |= GUACENC_FLAG_GLOBAL_HEADER;
     }
 
     /* Open codec for use */
-    if (guacenc_open_avcodec(avcodec_context, codec, NULL, video_stream) < 0) {
+    pthread_mutex_lock(&guacenc_video_codec_lock);
+    ret = guacenc_open_avcodec(avcodec_context, codec, NULL, video_stream);
+    pthread_mutex_unlock(&guacenc_video_codec_lock);
+
+    if (ret < 0) {
         guacenc_log(GUAC_LOG_ERROR, "Failed to open codec \"%s\".", codec_name);
         goto fail_codec_open;
     }
@@ -154,10 +185,47 @@ guacenc_video* guacenc_video_alloc(const char* path, const char* codec_name,
     /* No frames have been written or prepared yet */
     video->last_timestamp = 0;
     video->next_pts = 0;
+    video->next_frame_written = false;
+
+    /* No scaling context or previous frame exists yet */
+    video->sws = NULL;
+    video->scaled_width = 0;
+    video->scaled_height = 0;
+    video->last_image = NULL;
+    video->last_image_size = 0;
+    video->last_width = 0;
+    video->last_height = 0;
+    video->last_stride = 0;
+    video->prepared_width = 0;
+    video->prepared_height = 0;
+
+    /* No jobs are pending */
+    memset(video->jobs, 0, sizeof(video->jobs));
+    video->job_start = 0;
+    video->job_count = 0;
+    video->stopping = false;
+    video->failed = false;
+
+    pthread_mutex_init(&video->lock, NULL);
+    pthread_cond_init(&video->job_added, NULL);
+    pthread_cond_init(&video->job_finished, NULL);
+
+    /* Convert and encode frames in parallel with instruction handling */
+    if (pthread_create(&video->encoder_thread, NULL,
+                guacenc_video_encoder_thread, video)) {
+        guacenc_log(GUAC_LOG_ERROR, "Unable to start encoding thread.");
+        goto fail_encoder_thread;
+    }
 
     return video;
 
     /* Free all allocated data in case of failure */
+fail_encoder_thread:
+    pthread_cond_destroy(&video->job_finished);
+    pthread_cond_destroy(&video->job_added);
+    pthread_mutex_destroy(&video->lock);
+    free(video);
+
 fail_alloc_video:
 fail_output_file:
     avio_close(container_format_context->pb);
@@ -230,22 +298,55 @@ static int guacenc_video_write_frame(guacenc_video* video, AVFrame* frame) {
 /**
  * Flushes the frame previously specified by guacenc_video_prepare_frame() as a
  * new frame of video, updating the internal video timestamp by one frame's
- * worth of time.
+ * worth of time. If the frame has already been written and has not changed
+ * since, neither the conversion nor the encoder is invoked again unless the
+ * flush is explicitly forced. Only the timestamp advances, such that the
+ * previously written frame remains visible until the next written frame,
+ * whose pts (and thus dts) accounts for every skipped frame.
  *
  * @param video
  *     The video to flush.
  *
+ * @param force
+ *     Whether the frame should be encoded even if it is identical to the
+ *     previously written frame, such as to mark the end of the video.
+ *
  * @return
  *     Zero if flushing was successful, non-zero if an error occurs.
  */
-static int guacenc_video_flush_frame(guacenc_video* video) {
+static int guacenc_video_flush_frame(guacenc_video* video, bool force) {
+
+    /* Skip duplicate frames, advancing only the timestamp */
+    if (video->next_frame_written && !force) {
+        video->next_pts++;
+        return 0;
+    }
+
+    video->next_frame_written = true;
 
     /* Write frame to video */
     return guacenc_video_write_frame(video, video->next_frame) < 0;
 
 }
 
-int guacenc_video_advance_timeline(guacenc_video* video,
+/**
+ * Advances the timeline of the encoding process to the given timestamp,
+ * flushing the prepared frame as many times as necessary. This function is
+ * invoked only by the encoding thread of the video, and is the synchronous
+ * equivalent of guacenc_video_advance_timeline().
+ *
+ * @param video
+ *     The video whose timeline should be adjusted.
+ *
+ * @param timestamp
+ *     The Guacamole timestamp denoting the point in time that the video
+ *     timeline should be advanced to.
+ *
+ * @return
+ *     Zero if the timeline was adjusted successfully, non-zero if an error
+ *     occurs (such as during the encoding of duplicate frames).
+ */
+static int guacenc_video_process_timeline(guacenc_video* video,
         guac_timestamp timestamp) {
 
     guac_timestamp next_timestamp = timestamp;
@@ -267,7 +368,7 @@ int guacenc_video_advance_timeline(guacenc_video* video,
 
         /* Flush frames to bring timeline in sync, duplicating if necessary */
         do {
-            if (guacenc_video_flush_frame(video)) {
+            if (guacenc_video_flush_frame(video, false)) {
                 guacenc_log(GUAC_LOG_ERROR, "Unable to flush frame to video "
                         "stream.");
                 return 1;
@@ -283,196 +384,414 @@ int guacenc_video_advance_timeline(guacenc_video* video,
 }
 
 /**
- * Converts the given Guacamole video encoder buffer to a frame in the format
- * required by libavcodec / libswscale. Black margins of the specified sizes
- * will be added. No scaling is performed; the image data is copied verbatim.
+ * Returns whether the damaged region of the given frame job is identical to
+ * the same region of the frame most recently converted by
+ * guacenc_video_process_frame().
  *
- * @param buffer
- *     The guacenc_buffer to copy as a new AVFrame.
- *
- * @param lsize
- *     The size of the letterboxes to add, in pixels. Letterboxes are the
- *     horizontal black boxes added to images which are scaled down to fit the
- *     destination because they are too wide (the width is scaled to exactly
- *     fit the destination, resulting in extra space at the top and bottom).
+ * @param video
+ *     The video whose most recently converted frame should be compared.
  *
- * @param psize
- *     The size of the pillarboxes to add, in pixels. Pillarboxes are the
- *     vertical black boxes added to images which are scaled down to fit the
- *     destination because they are too tall (the height is scaled to exactly
- *     fit the destination, resulting in extra space on the sides).
+ * @param job
+ *     The GUACENC_VIDEO_JOB_FRAME job to compare.
  *
  * @return
- *     A pointer to a newly-allocated AVFrame containing exactly the same image
- *     data as the given buffer. The image data within the frame and the frame
- *     itself must be manually freed later.
+ *     Non-zero if the damaged region of the given job is identical to that of
+ *     the most recently converted frame, zero otherwise.
  */
-static AVFrame* guacenc_video_frame_convert(guacenc_buffer* buffer, int lsize,
-        int psize) {
+static int guacenc_video_frame_unchanged(guacenc_video* video,
+        guacenc_video_job* job) {
 
-    /* Init size of left/right pillarboxes */
-    int left = psize;
-    int right = psize;
+    int y;
 
-    /* Init size of top/bottom letterboxes */
-    int top = lsize;
-    int bottom = lsize;
+    /* Frames of differing size always differ */
+    if (video->last_image == NULL
+            || video->last_width != job->width
+            || video->last_height != job->height)
+        return 0;
 
-    /* Prepare source frame for buffer */
-    AVFrame* frame = av_frame_alloc();
-    if (frame == NULL)
-        return NULL;
+    /* Compare only the damaged region */
+    unsigned char* current = job->image;
+    unsigned char* previous = video->last_image
+        + job->damage.y * video->last_stride + job->damage.x * 4;
 
-    /* Copy buffer properties to frame */
-    frame->format = AV_PIX_FMT_RGB32;
-    frame->width = buffer->width + left + right;
-    frame->height = buffer->height + top + bottom;
+    for (y = 0; y < job->damage.height; y++) {
+
+        if (memcmp(current, previous, job->stride) != 0)
+            return 0;
+
+        current += job->stride;
+        previous += video->last_stride;
 
-    /* Allocate actual backing data for frame */
-    if (av_image_alloc(frame->data, frame->linesize, frame->width,
-                frame->height, frame->format, 32) < 0) {
-        av_frame_free(&frame);
-        return NULL;
     }
 
-    /* Flush any pending operations */
-    cairo_surface_flush(buffer->surface);
+    return 1;
+
+}
 
-    /* Get pointer to source image data */
-    unsigned char* src_data = buffer->image;
-    int src_stride = buffer->stride;
+/**
+ * Fills the entirety of the given YCbCr 4:2:0 frame with black, such that
+ * any area not covered by scaled image data (letterboxes or pillarboxes)
+ * remains black.
+ *
+ * @param frame
+ *     The AV_PIX_FMT_YUV420P frame to fill.
+ */
+static void guacenc_video_frame_clear(AVFrame* frame) {
 
-    /* Get pointer to destination image data */
-    unsigned char* dst_data = frame->data[0];
-    int dst_stride = frame->linesize[0];
+    int y;
 
-    /* Get source/destination dimensions */
-    int width = buffer->width;
-    int height = buffer->height;
+    int chroma_width = (frame->width + 1) / 2;
+    int chroma_height = (frame->height + 1) / 2;
 
-    /* Source buffer is guaranteed to fit within destination buffer */
-    assert(width <= frame->width);
-    assert(height <= frame->height);
+    /* Black is the lowest luma value of the limited (MPEG) range, with
+     * neutral chroma, matching libswscale's conversion of black RGB */
+    for (y = 0; y < frame->height; y++)
+        memset(frame->data[0] + y * frame->linesize[0], 16, frame->width);
 
-    /* Add top margin */
-    while (top > 0) {
-        memset(dst_data, 0, frame->width * 4);
-        dst_data += dst_stride;
-        top--;
+    for (y = 0; y < chroma_height; y++) {
+        memset(frame->data[1] + y * frame->linesize[1], 128, chroma_width);
+        memset(frame->data[2] + y * frame->linesize[2], 128, chroma_width);
     }
 
-    /* Copy all data from source buffer to destination frame */
-    while (height > 0) {
+}
 
-        /* Calculate size of margin and data regions */
-        int left_size = left * 4;
-        int data_size = width * 4;
-        int right_size = right * 4;
+/**
+ * Converts the image data of the given frame job, storing the result as the
+ * next frame of the video. This function is invoked only by the encoding
+ * thread of the video, and is the synchronous equivalent of
+ * guacenc_video_prepare_frame(). Frames identical to the previously converted
+ * frame are ignored, and the scaling context is reused for as long as the
+ * frame dimensions remain the same. As each frame job contains only the
+ * damaged region of the frame, the full image of the frame is maintained
+ * within last_image.
+ *
+ * @param video
+ *     The video whose next frame should be replaced.
+ *
+ * @param job
+ *     The GUACENC_VIDEO_JOB_FRAME job containing the image data of the frame.
+ */
+static void guacenc_video_process_frame(guacenc_video* video,
+        guacenc_video_job* job) {
 
-        /* Add left margin */
-        memset(dst_data, 0, left_size);
+    int row;
 
-        /* Copy data */
-        memcpy(dst_data + left_size, src_data, data_size);
+    /* Frames of a different size entirely replace the previous frame */
+    if (video->last_image == NULL || video->last_width != job->width
+            || video->last_height != job->height) {
 
-        /* Add right margin */
-        memset(dst_data + left_size + data_size, 0, right_size);
+        int stride = job->width * 4;
+        size_t size = (size_t) stride * job->height;
 
-        dst_data += dst_stride;
-        src_data += src_stride;
+        /* Grow retained image only if too small for the frame */
+        if (video->last_image_size < size) {
 
-        height--;
+            unsigned char* image = realloc(video->last_image, size);
+            if (image == NULL) {
+                guacenc_log(GUAC_LOG_WARNING, "Failed to allocate source "
+                        "frame. Frame dropped.");
+                return;
+            }
 
-    }
+            video->last_image = image;
+            video->last_image_size = size;
 
-    /* Add bottom margin */
-    while (bottom > 0) {
-        memset(dst_data, 0, frame->width * 4);
-        dst_data += dst_stride;
-        bottom--;
-    }
+        }
 
-    /* Frame converted */
-    return frame;
+        video->last_width = job->width;
+        video->last_height = job->height;
+        video->last_stride = stride;
 
-}
+    }
 
-void guacenc_video_prepare_frame(guacenc_video* video, guacenc_buffer* buffer) {
+    /* The next frame need not change if the image has not changed */
+    else if (guacenc_video_frame_unchanged(video, job))
+        return;
 
-    int lsize;
-    int psize;
+    /* Apply damaged region to retained image */
+    unsigned char* src = job->image;
+    unsigned char* dst_image = video->last_image
+        + job->damage.y * video->last_stride + job->damage.x * 4;
 
-    /* Ignore NULL buffers */
-    if (buffer == NULL || buffer->surface == NULL)
-        return;
+    for (row = 0; row < job->damage.height; row++) {
+        memcpy(dst_image, src, job->stride);
+        src += job->stride;
+        dst_image += video->last_stride;
+    }
 
     /* Obtain destination frame */
     AVFrame* dst = video->next_frame;
 
+    /* Scale image to fill destination, preserving aspect ratio */
+    int x = 0;
+    int y = 0;
+    int width = dst->width;
+    int height = dst->height;
+
     /* Determine width of image if height is scaled to match destination */
-    int scaled_width = buffer->width * dst->height / buffer->height;
+    int scaled_width = job->width * dst->height / job->height;
 
     /* Determine height of image if width is scaled to match destination */
-    int scaled_height = buffer->height * dst->width / buffer->width;
+    int scaled_height = job->height * dst->width / job->width;
 
     /* If height-based scaling results in a fit width, add pillarboxes */
     if (scaled_width <= dst->width) {
-        lsize = 0;
-        psize = (dst->width - scaled_width)
-               * buffer->height / dst->height / 2;
+        width = scaled_width > 0 ? scaled_width : 1;
+        x = (dst->width - width) / 2;
     }
 
     /* If width-based scaling results in a fit width, add letterboxes */
     else {
         assert(scaled_height <= dst->height);
-        psize = 0;
-        lsize = (dst->height - scaled_height)
-               * buffer->width / dst->width / 2;
+        height = scaled_height > 0 ? scaled_height : 1;
+        y = (dst->height - height) / 2;
     }
 
-    /* Prepare source frame for buffer */
-    AVFrame* src = guacenc_video_frame_convert(buffer, lsize, psize);
-    if (src == NULL) {
-        guacenc_log(GUAC_LOG_WARNING, "Failed to allocate source frame. "
-                "Frame dropped.");
-        return;
-    }
+    /* Chroma planes are subsampled by 2 in each dimension */
+    x &= ~1;
+    y &= ~1;
 
-    /* Prepare scaling context */
-    struct SwsContext* sws = sws_getContext(src->width, src->height,
-            AV_PIX_FMT_RGB32, dst->width, dst->height, AV_PIX_FMT_YUV420P,
+    /* Reuse scaling context unless the source dimensions have changed */
+    struct SwsContext* sws = sws_getCachedContext(video->sws,
+            job->width, job->height, AV_PIX_FMT_RGB32,
+            width, height, AV_PIX_FMT_YUV420P,
             SWS_BICUBIC, NULL, NULL, NULL);
 
-    /* Abort if scaling context could not be created */
+    /* Abort if scaling context could not be created (the previous context
+     * has been freed) */
+    video->sws = sws;
     if (sws == NULL) {
         guacenc_log(GUAC_LOG_WARNING, "Failed to allocate software scaling "
                 "context. Frame dropped.");
-        av_freep(&src->data[0]);
-        av_frame_free(&src);
         return;
     }
 
-    /* Apply scaling, copying the source frame to the destination */
-    sws_scale(sws, (const uint8_t* const*) src->data, src->linesize,
-            0, src->height, dst->data, dst->linesize);
+    /* Letterboxes/pillarboxes must be redrawn if the scaled area changes */
+    if (width != video->scaled_width || height != video->scaled_height)
+        guacenc_video_frame_clear(dst);
+
+    video->scaled_width = width;
+    video->scaled_height = height;
+
+    /* Scale directly into the relevant region of the destination frame */
+    const uint8_t* src_data[4] = { video->last_image };
+    int src_linesize[4] = { video->last_stride };
+
+    uint8_t* dst_data[4] = {
+        dst->data[0] + y * dst->linesize[0] + x,
+        dst->data[1] + y / 2 * dst->linesize[1] + x / 2,
+        dst->data[2] + y / 2 * dst->linesize[2] + x / 2
+    };
+
+    /* Apply scaling, copying the source image to the destination */
+    sws_scale(sws, src_data, src_linesize, 0, job->height,
+            dst_data, dst->linesize);
+
+    /* Frame has changed and must be encoded upon next flush */
+    video->next_frame_written = false;
+
+}
+
+static void* guacenc_video_encoder_thread(void* data) {
+
+    guacenc_video* video = (guacenc_video*) data;
+
+    pthread_mutex_lock(&video->lock);
+    for (;;) {
+
+        /* Wait for next job, stopping only once all jobs are processed */
+        while (video->job_count == 0 && !video->stopping)
+            pthread_cond_wait(&video->job_added, &video->lock);
+
+        if (video->job_count == 0)
+            break;
+
+        /* Process oldest job without holding the lock (the job will not be
+         * touched by other threads until it is removed from the queue) */
+        guacenc_video_job* job = &video->jobs[video->job_start];
+        pthread_mutex_unlock(&video->lock);
+
+        int failed = 0;
+        if (job->type == GUACENC_VIDEO_JOB_TIMESTAMP)
+            failed = guacenc_video_process_timeline(video, job->timestamp);
+        else
+            guacenc_video_process_frame(video, job);
+
+        /* Remove job from queue, unblocking any waiting producer */
+        pthread_mutex_lock(&video->lock);
+        video->job_start = (video->job_start + 1) % GUACENC_VIDEO_MAX_JOBS;
+        video->job_count--;
+
+        if (failed)
+            video->failed = true;
+
+        pthread_cond_signal(&video->job_finished);
+
+    }
+    pthread_mutex_unlock(&video->lock);
+
+    return NULL;
+
+}
+
+/**
+ * Reserves the next free job within the queue of the given video, waiting for
+ * the encoding thread to finish older jobs if the queue is full. The job is
+ * not visible to the encoding thread until guacenc_video_push_job() is
+ * invoked.
+ *
+ * @param video
+ *     The video whose queue should be used.
+ *
+ * @return
+ *     The next free job within the queue of the given video.
+ */
+static guacenc_video_job* guacenc_video_reserve_job(guacenc_video* video) {
+
+    pthread_mutex_lock(&video->lock);
+
+    while (video->job_count == GUACENC_VIDEO_MAX_JOBS)
+        pthread_cond_wait(&video->job_finished, &video->lock);
+
+    int index = (video->job_start + video->job_count)
+        % GUACENC_VIDEO_MAX_JOBS;
+
+    pthread_mutex_unlock(&video->lock);
+    return &video->jobs[index];
+
+}
+
+/**
+ * Adds the job most recently reserved with guacenc_video_reserve_job() to the
+ * queue of the given video, notifying the encoding thread.
+ *
+ * @param video
+ *     The video whose queue should receive the reserved job.
+ */
+static void guacenc_video_push_job(guacenc_video* video) {
+    pthread_mutex_lock(&video->lock);
+    video->job_count++;
+    pthread_cond_signal(&video->job_added);
+    pthread_mutex_unlock(&video->lock);
+}
+
+int guacenc_video_advance_timeline(guacenc_video* video,
+        guac_timestamp timestamp) {
+
+    guacenc_video_job* job = guacenc_video_reserve_job(video);
+    job->type = GUACENC_VIDEO_JOB_TIMESTAMP;
+    job->timestamp = timestamp;
+    guacenc_video_push_job(video);
+
+    /* Report any failures which have occurred since the last update */
+    pthread_mutex_lock(&video->lock);
+    int failed = video->failed;
+    video->failed = false;
+    pthread_mutex_unlock(&video->lock);
+
+    return failed;
+
+}
+
+void guacenc_video_prepare_frame(guacenc_video* video, guacenc_buffer* buffer) {
+
+    int y;
+
+    /* Ignore NULL buffers */
+    if (buffer == NULL || buffer->surface == NULL)
+        return;
+
+    /* Entire frame has changed if its size has changed */
+    guacenc_rect damage = buffer->damage;
+    if (buffer->width != video->prepared_width
+            || buffer->height != video->prepared_height)
+        guacenc_rect_init(&damage, 0, 0, buffer->width, buffer->height);
+
+    /* Otherwise, retain previous frame if nothing has changed */
+    else if (guacenc_rect_is_empty(&damage))
+        return;
+
+    guacenc_video_job* job = guacenc_video_reserve_job(video);
+
+    /* Grow image data of job only if too small for the damaged region */
+    int stride = damage.width * 4;
+    size_t size = (size_t) stride * damage.height;
+    if (job->image_size < size) {
+
+        unsigned char* image = realloc(job->image, size);
+        if (image == NULL) {
+            guacenc_log(GUAC_LOG_WARNING, "Failed to allocate source "
+                    "frame. Frame dropped.");
+
+            /* Send the entire frame next time */
+            video->prepared_width = 0;
+            video->prepared_height = 0;
+            return;
+        }
+
+        job->image = image;
+        job->image_size = size;
+
+    }
+
+    /* Flush any pending operations */
+    cairo_surface_flush(buffer->surface);
+
+    /* Copy damaged region such that the buffer may continue to be modified
+     * while the frame is converted and encoded */
+    job->type = GUACENC_VIDEO_JOB_FRAME;
+    job->width = buffer->width;
+    job->height = buffer->height;
+    job->damage = damage;
+    job->stride = stride;
+
+    unsigned char* src = buffer->image + damage.y * buffer->stride
+        + damage.x * 4;
+    unsigned char* dst = job->image;
+    for (y = 0; y < damage.height; y++) {
+        memcpy(dst, src, stride);
+        src += buffer->stride;
+        dst += stride;
+    }
 
-    /* Free scaling context */
-    sws_freeContext(sws);
+    video->prepared_width = buffer->width;
+    video->prepared_height = buffer->height;
 
-    /* Free source frame */
-    av_freep(&src->data[0]);
-    av_frame_free(&src);
+    guacenc_video_push_job(video);
 
 }
 
 int guacenc_video_free(guacenc_video* video) {
 
+    int i;
+
     /* Ignore NULL video */
     if (video == NULL)
         return 0;
 
-    /* Write final frame */
-    guacenc_video_flush_frame(video);
+    /* Wait for all queued jobs to be processed */
+    pthread_mutex_lock(&video->lock);
+    video->stopping = true;
+    pthread_cond_signal(&video->job_added);
+    pthread_mutex_unlock(&video->lock);
+
+    pthread_join(video->encoder_thread, NULL);
+
+    /* Free image data of all jobs */
+    for (i = 0; i < GUACENC_VIDEO_MAX_JOBS; i++)
+        free(video->jobs[i].image);
+
+    /* Free cached frame conversion state */
+    free(video->last_image);
+    sws_freeContext(video->sws);
+
+    pthread_cond_destroy(&video->job_finished);
+    pthread_cond_destroy(&video->job_added);
+    pthread_mutex_destroy(&video->lock);
+
+    /* Write final frame, even if unchanged, such that the duration of the
+     * video is correct */
+    guacenc_video_flush_frame(video, true);
 
     /* Flush any unwritten frames */
     int retval;
@@ -499,7 +818,9 @@ int guacenc_video_free(guacenc_video* video) {
 
     /* Clean up encoding context */
     if (video->context != NULL) {
+        pthread_mutex_lock(&guacenc_video_codec_lock);
         avcodec_close(video->context);
+        pthread_mutex_unlock(&guacenc_video_codec_lock);
         avcodec_free_context(&(video->context));
     }
 
@@ -34,6 +34,8 @@
 #include <libavformat/avformat.h>
 #endif
 
+#include <pthread.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 
@@ -42,6 +44,88 @@
  */
 #define GUACENC_VIDEO_FRAMERATE 25
 
+/**
+ * The maximum number of pending timeline updates and frames which may be
+ * queued for the encoding thread of a guacenc_video. Once this many jobs are
+ * pending, further updates block until the encoding thread catches up.
+ */
+#define GUACENC_VIDEO_MAX_JOBS 8
+
+/**
+ * The type of operation described by a guacenc_video_job.
+ */
+typedef enum guacenc_video_job_type {
+
+    /**
+     * The video timeline should be advanced to the timestamp of the job, as
+     * if by guacenc_video_advance_timeline().
+     */
+    GUACENC_VIDEO_JOB_TIMESTAMP,
+
+    /**
+     * The image data of the job should be prepared as the next frame, as if
+     * by guacenc_video_prepare_frame().
+     */
+    GUACENC_VIDEO_JOB_FRAME
+
+} guacenc_video_job_type;
+
+/**
+ * A timeline update or frame which has been queued for the encoding thread of
+ * a guacenc_video. Each job retains its image data allocation once processed,
+ * such that the allocation can be reused by later frames of the same size.
+ */
+typedef struct guacenc_video_job {
+
+    /**
+     * The type of operation described by this job.
+     */
+    guacenc_video_job_type type;
+
+    /**
+     * The timestamp that the video timeline should be advanced to, if this
+     * job is a GUACENC_VIDEO_JOB_TIMESTAMP job.
+     */
+    guac_timestamp timestamp;
+
+    /**
+     * The width of the frame, in pixels, if this job is a
+     * GUACENC_VIDEO_JOB_FRAME job.
+     */
+    int width;
+
+    /**
+     * The height of the frame, in pixels, if this job is a
+     * GUACENC_VIDEO_JOB_FRAME job.
+     */
+    int height;
+
+    /**
+     * The region of the frame which has changed since the previous frame, if
+     * this job is a GUACENC_VIDEO_JOB_FRAME job. If the size of the frame has
+     * changed, this will be the entire frame.
+     */
+    guacenc_rect damage;
+
+    /**
+     * The number of bytes in each row of image data.
+     */
+    int stride;
+
+    /**
+     * A copy of the 32-bit RGB image data of the damaged region of the
+     * frame, if this job is a GUACENC_VIDEO_JOB_FRAME job. This allocation is
+     * retained and reused between jobs.
+     */
+    unsigned char* image;
+
+    /**
+     * The number of bytes allocated for image.
+     */
+    size_t image_size;
+
+} guacenc_video_job;
+
 /**
  * A video which is actively being encoded. Frames can be added to the video
  * as they are generated, along with their associated timestamps, and the
@@ -96,12 +180,130 @@ typedef struct guacenc_video {
      */
     int64_t next_pts;
 
+    /**
+     * Whether next_frame has already been written to the video. If it has,
+     * further flushes of the same frame are skipped, only advancing
+     * next_pts, until a different frame is prepared.
+     */
+    bool next_frame_written;
+
+    /**
+     * The scaling context used to convert prepared frames into next_frame,
+     * reused for as long as the dimensions of prepared frames do not change,
+     * or NULL if no frame has yet been converted.
+     */
+    struct SwsContext* sws;
+
+    /**
+     * The width of the area of next_frame which receives scaled image data,
+     * in pixels. The remaining area is black.
+     */
+    int scaled_width;
+
+    /**
+     * The height of the area of next_frame which receives scaled image data,
+     * in pixels. The remaining area is black.
+     */
+    int scaled_height;
+
+    /**
+     * The image data of the most recently converted frame, updated with the
+     * damaged region of each subsequent frame, or NULL if no frame has yet
+     * been converted.
+     */
+    unsigned char* last_image;
+
+    /**
+     * The number of bytes allocated for last_image.
+     */
+    size_t last_image_size;
+
+    /**
+     * The width of the most recently converted frame, in pixels.
+     */
+    int last_width;
+
+    /**
+     * The height of the most recently converted frame, in pixels.
+     */
+    int last_height;
+
+    /**
+     * The number of bytes in each row of last_image.
+     */
+    int last_stride;
+
+    /**
+     * The width of the most recently prepared frame, in pixels. Unlike
+     * last_width, this is updated as frames are queued, not as they are
+     * converted.
+     */
+    int prepared_width;
+
+    /**
+     * The height of the most recently prepared frame, in pixels. Unlike
+     * last_height, this is updated as frames are queued, not as they are
+     * converted.
+     */
+    int prepared_height;
+
     /**
      * The timestamp associated with the last frame, or 0 if no frames have yet
      * been added.
      */
     guac_timestamp last_timestamp;
 
+    /**
+     * The thread which converts and encodes queued frames, allowing
+     * instructions to be parsed and rendered while previous frames are
+     * encoded.
+     */
+    pthread_t encoder_thread;
+
+    /**
+     * Lock which guards access to the job queue and its associated flags.
+     */
+    pthread_mutex_t lock;
+
+    /**
+     * Condition which is signalled whenever a job is added to the queue, or
+     * when the encoding thread has been requested to stop.
+     */
+    pthread_cond_t job_added;
+
+    /**
+     * Condition which is signalled whenever the encoding thread finishes a
+     * job, freeing space within the queue.
+     */
+    pthread_cond_t job_finished;
+
+    /**
+     * Circular queue of all pending jobs, beginning at jobs[job_start].
+     */
+    guacenc_video_job jobs[GUACENC_VIDEO_MAX_JOBS];
+
+    /**
+     * The index of the oldest pending job within jobs.
+     */
+    int job_start;
+
+    /**
+     * The number of pending jobs within jobs.
+     */
+    int job_count;
+
+    /**
+     * Whether the encoding thread should stop once all pending jobs have been
+     * processed.
+     */
+    bool stopping;
+
+    /**
+     * Whether the encoding thread has failed to process a job since the last
+     * call to guacenc_video_advance_timeline().
+     */
+    bool failed;
+
 } guacenc_video;
 
 /**
@@ -140,6 +342,11 @@ guacenc_video* guacenc_video_alloc(const char* path, const char* codec_name,
  * have a framerate per se, and the time between each Guacamole "frame" will
  * vary significantly.
  *
+ * The timeline is advanced asynchronously by the encoding thread of the
+ * video, in the order that timeline updates and frames are given. Errors
+ * which occur while doing so are reported by later calls to this function
+ * and by guacenc_video_free().
+ *
  * This function MUST be called prior to invoking guacenc_video_prepare_frame()
  * to ensure the prepared frame will be encoded at the correct point in time.
  *
@@ -152,8 +359,8 @@ guacenc_video* guacenc_video_alloc(const char* path, const char* codec_name,
  *     instruction.
  *
  * @return
- *     Zero if the timeline was adjusted successfully, non-zero if an error
- *     occurs (such as during the encoding of duplicate frames).
+ *     Zero if the timeline update was queued successfully, non-zero if an
+ *     error has occurred (such as during the encoding of duplicate frames).
  */
 int guacenc_video_advance_timeline(guacenc_video* video,
         guac_timestamp timestamp);
@@ -169,6 +376,13 @@ int guacenc_video_advance_timeline(guacenc_video* video,
  * timeline or through reaching the end of the encoding process
  * (guacenc_video_free()).
  *
+ * Only the damaged region of the buffer is considered to have changed since
+ * the previous frame, unless the size of the buffer has changed. If no part
+ * of the buffer is damaged, the previously prepared frame is retained. The
+ * image data of the damaged region is copied before this function returns,
+ * and is converted and encoded by the encoding thread of the video. The
+ * buffer may be modified freely once this function returns.
+ *
  * @param video
  *     The video in which the given buffer should be queued for possible
  *     writing (depending on timing vs. video framerate).
@@ -19,6 +19,7 @@
 
 #include "config.h"
 
+#include "common/recording-index.h"
 #include "guaclog.h"
 #include "interpret.h"
 #include "log.h"
@@ -33,13 +34,31 @@ int main(int argc, char* argv[]) {
 
     /* Load defaults */
     bool force = false;
+    guac_timestamp start = 0;
+    guac_timestamp end = -1;
 
     /* Parse arguments */
     int opt;
-    while ((opt = getopt(argc, argv, "s:r:f")) != -1) {
+    while ((opt = getopt(argc, argv, "S:E:f")) != -1) {
+
+        /* -S: Start time ([[HH:]MM:]SS) */
+        if (opt == 'S') {
+            if (guac_common_recording_parse_time(optarg, &start)) {
+                guaclog_log(GUAC_LOG_ERROR, "Invalid start time.");
+                goto invalid_options;
+            }
+        }
+
+        /* -E: End time ([[HH:]MM:]SS) */
+        else if (opt == 'E') {
+            if (guac_common_recording_parse_time(optarg, &end)) {
+                guaclog_log(GUAC_LOG_ERROR, "Invalid end time.");
+                goto invalid_options;
+            }
+        }
 
         /* -f: Force */
-        if (opt == 'f')
+        else if (opt == 'f')
             force = true;
 
         /* Invalid option */
@@ -83,7 +102,7 @@ int main(int argc, char* argv[]) {
         }
 
         /* Attempt interpreting, log granular success/failure at debug level */
-        if (guaclog_interpret(path, out_path, force)) {
+        if (guaclog_interpret(path, out_path, force, start, end)) {
             failures++;
             guaclog_log(GUAC_LOG_DEBUG,
                     "%s was NOT successfully interpreted.", path);
@@ -110,6 +129,8 @@ int main(int argc, char* argv[]) {
 invalid_options:
 
     fprintf(stderr, "USAGE: %s"
+            " [-S START]"
+            " [-E END]"
             " [-f]"
             " [FILE]...\n", argv[0]);
 
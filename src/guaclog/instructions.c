@@ -22,6 +22,9 @@
 #include "instructions.h"
 #include "log.h"
 
+#include <guacamole/opcode.h>
+
+#include <pthread.h>
 #include <string.h>
 
 guaclog_instruction_handler_mapping guaclog_instruction_handler_map[] = {
@@ -29,33 +32,63 @@ guaclog_instruction_handler_mapping guaclog_instruction_handler_map[] = {
     {NULL,  NULL}
 };
 
-int guaclog_handle_instruction(guaclog_state* state, const char* opcode,
-        int argc, char** argv) {
+/**
+ * Perfect-hash index of guaclog_instruction_handler_map, built upon handling
+ * the first instruction, or NULL if the index could not be built.
+ */
+static guac_opcode_map* guaclog_instruction_opcode_map = NULL;
 
-    /* Search through mapping for instruction handler having given opcode */
-    guaclog_instruction_handler_mapping* current = guaclog_instruction_handler_map;
-    while (current->opcode != NULL) {
+/**
+ * Guard ensuring the opcode index of the handler map is built only once,
+ * even if instructions are handled concurrently by multiple threads.
+ */
+static pthread_once_t guaclog_instruction_opcode_map_once = PTHREAD_ONCE_INIT;
 
-        /* Invoke handler if opcode matches (if defined) */
-        if (strcmp(current->opcode, opcode) == 0) {
+/**
+ * Builds the perfect-hash index of guaclog_instruction_handler_map. This
+ * function is invoked only once, via pthread_once().
+ */
+static void guaclog_init_instruction_opcode_map() {
+    guaclog_instruction_opcode_map = guac_opcode_map_alloc(
+            guaclog_instruction_handler_map,
+            sizeof(guaclog_instruction_handler_mapping));
+}
 
-            /* Invoke defined handler */
-            guaclog_instruction_handler* handler = current->handler;
-            if (handler != NULL)
-                return handler(state, argc, argv);
+int guaclog_handle_instruction(guaclog_state* state, const char* opcode,
+        int argc, char** argv) {
 
-            /* Log defined but unimplemented instructions */
-            guaclog_log(GUAC_LOG_DEBUG, "\"%s\" not implemented", opcode);
-            return 0;
+    /* Index the mapping by opcode upon first use */
+    pthread_once(&guaclog_instruction_opcode_map_once,
+            guaclog_init_instruction_opcode_map);
 
-        }
+    /* Locate instruction handler having given opcode, searching the mapping
+     * linearly only if it could not be indexed */
+    guaclog_instruction_handler_mapping* current = NULL;
+    if (guaclog_instruction_opcode_map != NULL) {
+        int index = guac_opcode_map_lookup(guaclog_instruction_opcode_map,
+                opcode);
+        if (index != -1)
+            current = &guaclog_instruction_handler_map[index];
+    }
+    else {
+        current = guaclog_instruction_handler_map;
+        while (current->opcode != NULL && strcmp(current->opcode, opcode) != 0)
+            current++;
+        if (current->opcode == NULL)
+            current = NULL;
+    }
 
-        /* Next candidate handler */
-        current++;
+    /* Ignore any unknown instructions */
+    if (current == NULL)
+        return 0;
 
-    } /* end opcode search */
+    /* Invoke defined handler */
+    guaclog_instruction_handler* handler = current->handler;
+    if (handler != NULL)
+        return handler(state, argc, argv);
 
-    /* Ignore any unknown instructions */
+    /* Log defined but unimplemented instructions */
+    guaclog_log(GUAC_LOG_DEBUG, "\"%s\" not implemented", opcode);
     return 0;
 
 }
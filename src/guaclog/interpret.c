@@ -18,6 +18,8 @@
  */
 
 #include "config.h"
+#include "common/recording-compression.h"
+#include "common/recording-index.h"
 #include "instructions.h"
 #include "log.h"
 #include "state.h"
@@ -31,13 +33,17 @@
 #include <sys/types.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <inttypes.h>
 #include <stdbool.h>
 #include <string.h>
 #include <unistd.h>
 
 /**
  * Reads and handles all Guacamole instructions from the given guac_socket
- * until end-of-stream is reached.
+ * until end-of-stream is reached, or until the end of the requested portion
+ * of the recording is reached. Timestamped instructions outside the requested
+ * portion of the recording are ignored, with the position within the
+ * recording measured using those same timestamps.
  *
  * @param state
  *     The current state of the Guacamole input log interpreter.
@@ -49,12 +55,29 @@
  * @param socket
  *     The guac_socket through which instructions should be read.
  *
+ * @param start
+ *     The number of milliseconds from the start of the recording at which
+ *     input events should begin to be interpreted.
+ *
+ * @param end
+ *     The number of milliseconds from the start of the recording after which
+ *     reading should stop, or a negative value to read until end-of-stream.
+ *
+ * @param has_origin
+ *     Whether the timestamp of the start of the recording is already known,
+ *     as when reading begins at a checkpoint within the recording.
+ *
+ * @param origin
+ *     The timestamp of the start of the recording, if has_origin is true.
+ *     If false, the first timestamp read is used.
+ *
  * @return
  *     Zero on success, non-zero if parsing of Guacamole protocol data through
  *     the given socket fails.
  */
 static int guaclog_read_instructions(guaclog_state* state,
-        const char* path, guac_socket* socket) {
+        const char* path, guac_socket* socket, guac_timestamp start,
+        guac_timestamp end, bool has_origin, guac_timestamp origin) {
 
     /* Obtain Guacamole protocol parser */
     guac_parser* parser = guac_parser_alloc();
@@ -63,8 +86,33 @@ static int guaclog_read_instructions(guaclog_state* state,
 
     /* Continuously read and handle all instructions */
     while (!guac_parser_read(parser, socket, -1)) {
+
+        /* Track position within recording */
+        guac_timestamp timestamp;
+        if (guac_common_recording_get_timestamp(parser->opcode,
+                    parser->argc, parser->argv, &timestamp)) {
+
+            /* The first timestamp marks the start of the recording */
+            if (!has_origin) {
+                origin = timestamp;
+                has_origin = true;
+            }
+
+            /* Stop once the requested portion of the recording is complete */
+            if (end >= 0 && timestamp - origin > end) {
+                guac_parser_free(parser);
+                return 0;
+            }
+
+            /* Ignore events before the requested portion of the recording */
+            if (timestamp - origin < start)
+                continue;
+
+        }
+
         guaclog_handle_instruction(state, parser->opcode,
                 parser->argc, parser->argv);
+
     }
 
     /* Fail on read/parse error */
@@ -81,7 +129,56 @@ static int guaclog_read_instructions(guaclog_state* state,
 
 }
 
-int guaclog_interpret(const char* path, const char* out_path, bool force) {
+/**
+ * Locates the nearest checkpoint at or before the given time within the index
+ * of the given recording, storing the corresponding position within the
+ * recording. If the recording has no usable index, the stored position is
+ * left untouched.
+ *
+ * @param path
+ *     The path to the recording.
+ *
+ * @param start
+ *     The number of milliseconds from the start of the recording at which
+ *     interpreting should begin.
+ *
+ * @param origin
+ *     Storage for the timestamp of the start of the recording, if a
+ *     checkpoint is found.
+ *
+ * @param offset
+ *     Storage for the offset within the uncompressed recording at which
+ *     reading should resume, if a checkpoint is found.
+ *
+ * @return
+ *     true if a checkpoint was found, false otherwise.
+ */
+static bool guaclog_seek(const char* path, guac_timestamp start,
+        guac_timestamp* origin, int64_t* offset) {
+
+    guac_common_recording_checkpoint* checkpoint =
+        guac_common_recording_index_find(path, start);
+
+    if (checkpoint == NULL) {
+        guaclog_log(GUAC_LOG_INFO, "No usable index for \"%s\". Reading "
+                "from the start of the recording.", path);
+        return false;
+    }
+
+    guaclog_log(GUAC_LOG_INFO, "Resuming \"%s\" from checkpoint at %" PRId64
+            " ms.", path, (int64_t) (checkpoint->timestamp - checkpoint->start));
+
+    /* Only input events are interpreted, none of which are part of the state
+     * restored by the checkpoint */
+    *origin = checkpoint->start;
+    *offset = checkpoint->offset;
+    guac_common_recording_checkpoint_free(checkpoint);
+    return true;
+
+}
+
+int guaclog_interpret(const char* path, const char* out_path, bool force,
+        guac_timestamp start, guac_timestamp end) {
 
     /* Open input file */
     int fd = open(path, O_RDONLY);
@@ -124,8 +221,15 @@ int guaclog_interpret(const char* path, const char* out_path, bool force) {
         return 1;
     }
 
-    /* Obtain guac_socket wrapping file descriptor */
-    guac_socket* socket = guac_socket_open(fd);
+    /* Skip directly to the requested portion of the recording, if possible */
+    guac_timestamp origin = 0;
+    int64_t offset = 0;
+    bool has_origin = false;
+    if (start > 0)
+        has_origin = guaclog_seek(path, start, &origin, &offset);
+
+    /* Obtain guac_socket reading the (possibly compressed) recording */
+    guac_socket* socket = guac_common_recording_input_open(fd, offset);
     if (socket == NULL) {
         guaclog_log(GUAC_LOG_ERROR, "%s: %s", path,
                 guac_status_string(guac_error));
@@ -138,7 +242,8 @@ int guaclog_interpret(const char* path, const char* out_path, bool force) {
             "to \"%s\" ...", path, out_path);
 
     /* Attempt to read all instructions in the file */
-    if (guaclog_read_instructions(state, path, socket)) {
+    if (guaclog_read_instructions(state, path, socket, start, end,
+                has_origin, origin)) {
         guac_socket_free(socket);
         guaclog_state_free(state);
         return 1;
@@ -22,6 +22,8 @@
 
 #include "config.h"
 
+#include <guacamole/timestamp-types.h>
+
 #include <stdbool.h>
 
 /**
@@ -41,11 +43,23 @@
  *     Interpret even if the input file appears to be an in-progress log (has
  *     an associated lock).
  *
+ * @param start
+ *     The number of milliseconds from the start of the recording at which
+ *     input events should begin to be interpreted. If the recording has an
+ *     index, interpreting resumes from the nearest preceding checkpoint
+ *     rather than from the start of the recording.
+ *
+ * @param end
+ *     The number of milliseconds from the start of the recording after which
+ *     input events should no longer be interpreted, or a negative value to
+ *     interpret input events through the end of the recording.
+ *
  * @return
  *     Zero on success, non-zero if an error prevented successful
  *     interpretation of the log.
  */
-int guaclog_interpret(const char* path, const char* out_path, bool force);
+int guaclog_interpret(const char* path, const char* out_path, bool force,
+        guac_timestamp start, guac_timestamp end);
 
 #endif
 
@@ -0,0 +1,298 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+
+#include "base64.h"
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GUAC_BASE64_SSSE3
+#include <tmmintrin.h>
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#define GUAC_BASE64_NEON
+#include <arm_neon.h>
+#endif
+
+/**
+ * Value within guac_base64_values of characters which terminate decoding:
+ * the null terminator and the padding character ('=').
+ */
+#define GUAC_BASE64_END 0x80
+
+/**
+ * The value of every possible character within base64 data. Characters
+ * outside the base64 alphabet have the value zero, except for the null
+ * terminator and padding character, which have the value GUAC_BASE64_END.
+ */
+static const unsigned char guac_base64_values[256] = {
+    ['\0'] = GUAC_BASE64_END, ['='] = GUAC_BASE64_END,
+    ['A'] =  0, ['B'] =  1, ['C'] =  2, ['D'] =  3, ['E'] =  4, ['F'] =  5,
+    ['G'] =  6, ['H'] =  7, ['I'] =  8, ['J'] =  9, ['K'] = 10, ['L'] = 11,
+    ['M'] = 12, ['N'] = 13, ['O'] = 14, ['P'] = 15, ['Q'] = 16, ['R'] = 17,
+    ['S'] = 18, ['T'] = 19, ['U'] = 20, ['V'] = 21, ['W'] = 22, ['X'] = 23,
+    ['Y'] = 24, ['Z'] = 25, ['a'] = 26, ['b'] = 27, ['c'] = 28, ['d'] = 29,
+    ['e'] = 30, ['f'] = 31, ['g'] = 32, ['h'] = 33, ['i'] = 34, ['j'] = 35,
+    ['k'] = 36, ['l'] = 37, ['m'] = 38, ['n'] = 39, ['o'] = 40, ['p'] = 41,
+    ['q'] = 42, ['r'] = 43, ['s'] = 44, ['t'] = 45, ['u'] = 46, ['v'] = 47,
+    ['w'] = 48, ['x'] = 49, ['y'] = 50, ['z'] = 51, ['0'] = 52, ['1'] = 53,
+    ['2'] = 54, ['3'] = 55, ['4'] = 56, ['5'] = 57, ['6'] = 58, ['7'] = 59,
+    ['8'] = 60, ['9'] = 61, ['+'] = 62, ['/'] = 63
+};
+
+size_t guac_base64_encode_scalar(const unsigned char* input, size_t length,
+        char* output) {
+
+    size_t encoded = length - (length % 3);
+    const unsigned char* end = input + encoded;
+
+    /* Encode each complete triplet as four characters */
+    while (input < end) {
+
+        uint32_t triplet = (input[0] << 16) | (input[1] << 8) | input[2];
+
+        output[0] = __guac_socket_BASE64_CHARACTERS[(triplet >> 18) & 0x3F];
+        output[1] = __guac_socket_BASE64_CHARACTERS[(triplet >> 12) & 0x3F];
+        output[2] = __guac_socket_BASE64_CHARACTERS[(triplet >>  6) & 0x3F];
+        output[3] = __guac_socket_BASE64_CHARACTERS[ triplet        & 0x3F];
+
+        input  += 3;
+        output += 4;
+
+    }
+
+    return encoded;
+
+}
+
+#ifdef GUAC_BASE64_SSSE3
+/**
+ * Base64-encodes complete 3-byte groups using SSSE3, 12 bytes at a time,
+ * falling back to guac_base64_encode_scalar() for any data which cannot be
+ * safely loaded as a full 16-byte vector. The semantics of this function are
+ * identical to guac_base64_encode_scalar().
+ */
+__attribute__((target("ssse3")))
+static size_t guac_base64_encode_ssse3(const unsigned char* input,
+        size_t length, char* output) {
+
+    size_t encoded = 0;
+
+    /* Reorders each 3-byte group into the low three bytes of a 32-bit
+     * big-endian word, such that 6-bit fields can be extracted with
+     * 16-bit multiplies */
+    const __m128i shuffle = _mm_set_epi8(
+            10, 11,  9, 10,
+             7,  8,  6,  7,
+             4,  5,  3,  4,
+             1,  2,  0,  1);
+
+    /* Offsets which map each 6-bit value onto its ASCII character, indexed
+     * by the reduced value calculated below */
+    const __m128i offsets = _mm_setr_epi8(
+            'a' - 26, '0' - 52, '0' - 52, '0' - 52,
+            '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+            '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+            '/' - 63, 'A',      0,        0);
+
+    /* Each iteration consumes 12 bytes but loads 16 */
+    while (length - encoded >= 16) {
+
+        __m128i in = _mm_loadu_si128((const __m128i*) (input + encoded));
+        in = _mm_shuffle_epi8(in, shuffle);
+
+        /* Extract the four 6-bit values of each group into separate bytes */
+        __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0FC0FC00));
+        __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+        __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003F03F0));
+        __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+        __m128i indices = _mm_or_si128(t1, t3);
+
+        /* Reduce values to an index into the offset table: 0 for a-z, 1-10
+         * for 0-9, 11 for '+', 12 for '/', and 13 for A-Z */
+        __m128i reduced = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+        __m128i upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+        reduced = _mm_or_si128(reduced,
+                _mm_and_si128(upper, _mm_set1_epi8(13)));
+
+        /* Translate to ASCII */
+        __m128i out = _mm_add_epi8(indices,
+                _mm_shuffle_epi8(offsets, reduced));
+
+        _mm_storeu_si128((__m128i*) output, out);
+
+        encoded += 12;
+        output  += 16;
+
+    }
+
+    /* Encode remaining data using scalar implementation */
+    return encoded + guac_base64_encode_scalar(input + encoded,
+            length - encoded, output);
+
+}
+#endif
+
+#ifdef GUAC_BASE64_NEON
+/**
+ * Base64-encodes complete 3-byte groups using NEON, 48 bytes at a time,
+ * falling back to guac_base64_encode_scalar() for any remaining data. The
+ * semantics of this function are identical to guac_base64_encode_scalar().
+ */
+static size_t guac_base64_encode_neon(const unsigned char* input,
+        size_t length, char* output) {
+
+    size_t encoded = 0;
+
+    const uint8x16_t mask = vdupq_n_u8(0x3F);
+
+    /* Load entire alphabet as a 64-byte lookup table */
+    uint8x16x4_t alphabet;
+    alphabet.val[0] = vld1q_u8((const uint8_t*) __guac_socket_BASE64_CHARACTERS);
+    alphabet.val[1] = vld1q_u8((const uint8_t*) __guac_socket_BASE64_CHARACTERS + 16);
+    alphabet.val[2] = vld1q_u8((const uint8_t*) __guac_socket_BASE64_CHARACTERS + 32);
+    alphabet.val[3] = vld1q_u8((const uint8_t*) __guac_socket_BASE64_CHARACTERS + 48);
+
+    while (length - encoded >= 48) {
+
+        /* Deinterleave 16 groups of 3 bytes */
+        uint8x16x3_t in = vld3q_u8(input + encoded);
+
+        /* Split into four 6-bit values per group */
+        uint8x16x4_t out;
+        out.val[0] = vshrq_n_u8(in.val[0], 2);
+        out.val[1] = vandq_u8(vorrq_u8(vshlq_n_u8(in.val[0], 4),
+                    vshrq_n_u8(in.val[1], 4)), mask);
+        out.val[2] = vandq_u8(vorrq_u8(vshlq_n_u8(in.val[1], 2),
+                    vshrq_n_u8(in.val[2], 6)), mask);
+        out.val[3] = vandq_u8(in.val[2], mask);
+
+        /* Translate to ASCII */
+        out.val[0] = vqtbl4q_u8(alphabet, out.val[0]);
+        out.val[1] = vqtbl4q_u8(alphabet, out.val[1]);
+        out.val[2] = vqtbl4q_u8(alphabet, out.val[2]);
+        out.val[3] = vqtbl4q_u8(alphabet, out.val[3]);
+
+        /* Interleave back into groups of four characters */
+        vst4q_u8((uint8_t*) output, out);
+
+        encoded += 48;
+        output  += 64;
+
+    }
+
+    /* Encode remaining data using scalar implementation */
+    return encoded + guac_base64_encode_scalar(input + encoded,
+            length - encoded, output);
+
+}
+#endif
+
+/**
+ * The base64 encoder implementation selected for the current CPU.
+ */
+static size_t (*guac_base64_encoder)(const unsigned char* input,
+        size_t length, char* output) = guac_base64_encode_scalar;
+
+/**
+ * Guard ensuring the base64 encoder implementation is selected only once.
+ */
+static pthread_once_t guac_base64_encoder_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Selects the fastest base64 encoder implementation supported by the current
+ * CPU, storing that implementation within guac_base64_encoder.
+ */
+static void guac_base64_select_encoder() {
+
+#ifdef GUAC_BASE64_NEON
+    /* NEON is always available on AArch64 */
+    guac_base64_encoder = guac_base64_encode_neon;
+#endif
+
+#ifdef GUAC_BASE64_SSSE3
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("ssse3"))
+        guac_base64_encoder = guac_base64_encode_ssse3;
+#endif
+
+}
+
+size_t guac_base64_encode(const unsigned char* input, size_t length,
+        char* output) {
+
+    pthread_once(&guac_base64_encoder_once, guac_base64_select_encoder);
+    return guac_base64_encoder(input, length, output);
+
+}
+
+int guac_base64_decode(char* base64) {
+
+    const unsigned char* input = (const unsigned char*) base64;
+    unsigned char* output = (unsigned char*) base64;
+
+    unsigned int a, b, c, d;
+
+    /* Decode complete groups of four characters, stopping at the first
+     * terminating character without reading beyond it */
+    while ((a = guac_base64_values[input[0]]) != GUAC_BASE64_END
+        && (b = guac_base64_values[input[1]]) != GUAC_BASE64_END
+        && (c = guac_base64_values[input[2]]) != GUAC_BASE64_END
+        && (d = guac_base64_values[input[3]]) != GUAC_BASE64_END) {
+
+        uint32_t value = (a << 18) | (b << 12) | (c << 6) | d;
+
+        output[0] = (value >> 16) & 0xFF;
+        output[1] = (value >>  8) & 0xFF;
+        output[2] =  value        & 0xFF;
+
+        input  += 4;
+        output += 3;
+
+    }
+
+    /* Decode any remaining partial group, writing only whole bytes */
+    int bits_read = 0;
+    int value = 0;
+    unsigned int current;
+
+    while ((current = guac_base64_values[*(input++)]) != GUAC_BASE64_END) {
+
+        /* Shift on the latest 6 bits */
+        value = (value << 6) | current;
+        bits_read += 6;
+
+        /* If we have at least one byte, write out the latest whole byte */
+        if (bits_read >= 8) {
+            *(output++) = (value >> (bits_read % 8)) & 0xFF;
+            bits_read -= 8;
+        }
+
+    }
+
+    /* Return number of bytes written */
+    return output - (unsigned char*) base64;
+
+}
+
@@ -0,0 +1,109 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUAC_BASE64_H
+#define GUAC_BASE64_H
+
+#include "config.h"
+
+#include <stddef.h>
+
+/**
+ * The number of bytes of unencoded data which will be base64-encoded at once
+ * by guac_socket_write_base64() for sockets which cannot accept base64 directly
+ * into their own output buffer. This value is a multiple of 3, such that the
+ * encoded result of each block contains no padding.
+ */
+#define GUAC_BASE64_BLOCK_SIZE 768
+
+/**
+ * Returns the number of bytes of base64 produced when encoding the given
+ * number of bytes, which must be a multiple of 3.
+ */
+#define GUAC_BASE64_ENCODED_SIZE(length) (((length) / 3) * 4)
+
+/**
+ * The characters of the base64 alphabet, in order of value. This array is
+ * defined within socket.c, where it has always been exported.
+ */
+extern char __guac_socket_BASE64_CHARACTERS[64];
+
+/**
+ * Base64-encodes all complete 3-byte groups within the given buffer, storing
+ * the result in the given output buffer. Any trailing bytes which do not form
+ * a complete group (up to two bytes) are not encoded. No padding is ever
+ * written, and the output is not null-terminated. The fastest implementation
+ * available for the current CPU is used.
+ *
+ * @param input
+ *     The data to encode.
+ *
+ * @param length
+ *     The number of bytes of data within the input buffer.
+ *
+ * @param output
+ *     The buffer which should receive the base64 output. This buffer must be
+ *     at least GUAC_BASE64_ENCODED_SIZE(length) bytes in size.
+ *
+ * @return
+ *     The number of input bytes encoded, which will be the largest multiple
+ *     of 3 not exceeding the given length.
+ */
+size_t guac_base64_encode(const unsigned char* input, size_t length,
+        char* output);
+
+/**
+ * Base64-encodes all complete 3-byte groups within the given buffer, exactly
+ * as guac_base64_encode(), but without use of any CPU-specific
+ * optimizations. This function is the reference implementation against which
+ * any accelerated implementations are verified.
+ *
+ * @param input
+ *     The data to encode.
+ *
+ * @param length
+ *     The number of bytes of data within the input buffer.
+ *
+ * @param output
+ *     The buffer which should receive the base64 output. This buffer must be
+ *     at least GUAC_BASE64_ENCODED_SIZE(length) bytes in size.
+ *
+ * @return
+ *     The number of input bytes encoded, which will be the largest multiple
+ *     of 3 not exceeding the given length.
+ */
+size_t guac_base64_encode_scalar(const unsigned char* input, size_t length,
+        char* output);
+
+/**
+ * Decodes the given null-terminated base64 string in-place, stopping at the
+ * first padding character ('=') or at the null terminator, whichever comes
+ * first. Characters outside the base64 alphabet are interpreted as zero.
+ *
+ * @param base64
+ *     The base64 string to decode. The decoded data will overwrite the
+ *     beginning of this string.
+ *
+ * @return
+ *     The number of bytes of decoded data.
+ */
+int guac_base64_decode(char* base64);
+
+#endif
+
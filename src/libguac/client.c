@@ -23,6 +23,7 @@
 #include "encode-png.h"
 #include "encode-webp.h"
 #include "guacamole/client.h"
+#include "guacamole/congestion.h"
 #include "guacamole/error.h"
 #include "guacamole/layer.h"
 #include "guacamole/plugin.h"
@@ -34,6 +35,7 @@
 #include "guacamole/timestamp.h"
 #include "guacamole/user.h"
 #include "id.h"
+#include "user-queue.h"
 
 #include <dlfcn.h>
 #include <inttypes.h>
@@ -148,6 +150,13 @@ guac_client* guac_client_alloc() {
     client->state = GUAC_CLIENT_RUNNING;
     client->last_sent_timestamp = guac_timestamp_current();
 
+    /* Queue broadcast data for each user by default */
+    client->output_queue_size = GUAC_CLIENT_DEFAULT_OUTPUT_QUEUE_SIZE;
+    client->output_queue_policy = GUAC_CLIENT_QUEUE_RESYNC;
+    client->encoder_threads = GUAC_CLIENT_DEFAULT_ENCODER_THREADS;
+    client->png_compression_level = GUAC_CLIENT_DEFAULT_PNG_COMPRESSION_LEVEL;
+    client->png_strategy = GUAC_CLIENT_PNG_DEFAULT;
+
     /* Generate ID */
     client->connection_id = guac_generate_id(GUAC_CLIENT_ID_PREFIX);
     if (client->connection_id == NULL) {
@@ -285,6 +294,20 @@ int guac_client_add_user(guac_client* client, guac_user* user, int argc, char**
     if (client->join_handler)
         retval = client->join_handler(user, argc, argv);
 
+    /* Allocate queue for broadcast data, if enabled */
+    if (retval == 0 && client->output_queue_size > 0) {
+
+        user->__output_queue = guac_user_queue_alloc(user,
+                client->output_queue_size, client->output_queue_policy);
+
+        /* Fall back to synchronous writes if the queue cannot be created */
+        if (user->__output_queue == NULL)
+            guac_client_log(client, GUAC_LOG_WARNING, "Unable to allocate "
+                    "output queue for user \"%s\". Broadcast data will be "
+                    "written to this user synchronously.", user->user_id);
+
+    }
+
     pthread_rwlock_wrlock(&(client->__users_lock));
 
     /* Add to list if join was successful */
@@ -333,6 +356,13 @@ void guac_client_remove_user(guac_client* client, guac_user* user) {
 
     pthread_rwlock_unlock(&(client->__users_lock));
 
+    /* Stop writing queued broadcast data now that the user is no longer
+     * visible to the broadcast socket */
+    if (user->__output_queue != NULL) {
+        guac_user_queue_free(user->__output_queue);
+        user->__output_queue = NULL;
+    }
+
     /* Call handler, if defined */
     if (user->leave_handler)
         user->leave_handler(user);
@@ -412,11 +442,39 @@ void* guac_client_for_user(guac_client* client, guac_user* user,
 
 }
 
+/**
+ * Callback which is invoked by guac_client_foreach_user() to record the end
+ * of a frame within the congestion controller of the given user.
+ *
+ * @param user
+ *     The user receiving the frame.
+ *
+ * @param data
+ *     Pointer to the guac_timestamp which will be sent within the "sync"
+ *     instruction ending the frame.
+ *
+ * @return
+ *     Always NULL.
+ */
+static void* __frame_sent_callback(guac_user* user, void* data) {
+
+    guac_timestamp* timestamp = (guac_timestamp*) data;
+
+    guac_congestion_frame_sent(user->congestion, *timestamp);
+
+    return NULL;
+
+}
+
 int guac_client_end_frame(guac_client* client) {
 
     /* Update and send timestamp */
     client->last_sent_timestamp = guac_timestamp_current();
 
+    /* Track frame until acknowledged by each user */
+    guac_client_foreach_user(client, __frame_sent_callback,
+            &client->last_sent_timestamp);
+
     /* Log received timestamp and calculated lag (at TRACE level only) */
     guac_client_log(client, GUAC_LOG_TRACE, "Server completed "
             "frame %" PRIu64 "ms.", client->last_sent_timestamp);
@@ -554,6 +612,120 @@ int guac_client_get_processing_lag(guac_client* client) {
 
 }
 
+/**
+ * Updates the provided frame duration, taking into account the frame duration
+ * recommended by the congestion controller of the given user.
+ *
+ * @param user
+ *     The guac_user to use to update the frame duration.
+ *
+ * @param data
+ *     Pointer to an int containing the current frame duration. The int will
+ *     be updated according to the frame duration recommended for the given
+ *     user.
+ *
+ * @return
+ *     Always NULL.
+ */
+static void* __calculate_frame_duration(guac_user* user, void* data) {
+
+    int* frame_duration = (int*) data;
+
+    /* Frames must be slow enough for the slowest user */
+    int user_duration = guac_congestion_get_frame_duration(user->congestion,
+            guac_timestamp_current());
+    if (user_duration > *frame_duration)
+        *frame_duration = user_duration;
+
+    return NULL;
+
+}
+
+int guac_client_get_frame_duration(guac_client* client) {
+
+    int frame_duration = 0;
+
+    guac_client_foreach_user(client, __calculate_frame_duration,
+            &frame_duration);
+
+    return frame_duration;
+
+}
+
+/**
+ * Updates the provided lossy quality, taking into account the quality
+ * recommended by the congestion controller of the given user.
+ *
+ * @param user
+ *     The guac_user to use to update the lossy quality.
+ *
+ * @param data
+ *     Pointer to an int containing the current lossy quality. The int will be
+ *     updated according to the quality recommended for the given user.
+ *
+ * @return
+ *     Always NULL.
+ */
+static void* __calculate_quality(guac_user* user, void* data) {
+
+    int* quality = (int*) data;
+
+    /* Quality must be low enough for the most congested user */
+    int user_quality = guac_congestion_get_quality(user->congestion,
+            guac_timestamp_current());
+    if (user_quality < *quality)
+        *quality = user_quality;
+
+    return NULL;
+
+}
+
+int guac_client_get_lossy_quality(guac_client* client) {
+
+    int quality = GUAC_CONGESTION_MAX_QUALITY;
+
+    guac_client_foreach_user(client, __calculate_quality, &quality);
+
+    return quality;
+
+}
+
+/**
+ * Callback which is invoked by guac_client_foreach_user() to determine
+ * whether the given user is congested.
+ *
+ * @param user
+ *     The guac_user to test.
+ *
+ * @param data
+ *     Pointer to an int which will be set to a non-zero value if the given
+ *     user is congested.
+ *
+ * @return
+ *     Always NULL.
+ */
+static void* __check_congested(guac_user* user, void* data) {
+
+    int* congested = (int*) data;
+
+    if (guac_congestion_is_congested(user->congestion,
+            guac_timestamp_current()))
+        *congested = 1;
+
+    return NULL;
+
+}
+
+int guac_client_is_congested(guac_client* client) {
+
+    int congested = 0;
+
+    guac_client_foreach_user(client, __check_congested, &congested);
+
+    return congested;
+
+}
+
 void guac_client_stream_argv(guac_client* client, guac_socket* socket,
         const char* mimetype, const char* name, const char* value) {
 
@@ -585,7 +757,8 @@ void guac_client_stream_png(guac_client* client, guac_socket* socket,
     guac_protocol_send_img(socket, stream, mode, layer, "image/png", x, y);
 
     /* Write PNG data */
-    guac_png_write(socket, stream, surface);
+    guac_png_write(socket, stream, surface, client->png_compression_level,
+            client->png_strategy);
 
     /* Terminate stream */
     guac_protocol_send_end(socket, stream);
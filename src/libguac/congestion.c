@@ -0,0 +1,386 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+
+#include "guacamole/congestion.h"
+#include "guacamole/timestamp.h"
+
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/**
+ * Clamps the given unsigned 64-bit value such that it may be safely stored
+ * within an int.
+ *
+ * @param value
+ *     The value to clamp.
+ *
+ * @return
+ *     The given value, or INT_MAX if the value is too large to be represented
+ *     as an int.
+ */
+static int guac_congestion_clamp(uint64_t value) {
+
+    if (value > INT_MAX)
+        return INT_MAX;
+
+    return (int) value;
+
+}
+
+/**
+ * Returns the estimated amount of time required to deliver all data sent to
+ * the user but not yet acknowledged, in milliseconds. The lock of the given
+ * guac_congestion must be held.
+ *
+ * @param congestion
+ *     The guac_congestion associated with the user.
+ *
+ * @return
+ *     The estimated time required to deliver all unacknowledged data, in
+ *     milliseconds, or zero if the bandwidth available to the user is not yet
+ *     known.
+ */
+static int guac_congestion_drain_time(guac_congestion* congestion) {
+
+    /* Time cannot be estimated without a bandwidth estimate */
+    if (congestion->bandwidth <= 0)
+        return 0;
+
+    uint64_t in_flight = __atomic_load_n(&congestion->bytes_sent,
+            __ATOMIC_RELAXED) - congestion->bytes_acked;
+
+    return guac_congestion_clamp(in_flight * 1000 / congestion->bandwidth);
+
+}
+
+/**
+ * Returns the estimated delay currently experienced by the user, in
+ * milliseconds. This is the larger of the user's processing lag and the
+ * queueing delay implied by the round-trip time relative to the minimum
+ * round-trip time. If the oldest unacknowledged frame has been outstanding for
+ * longer than the smoothed round-trip time, the age of that frame is used
+ * instead, such that a stalled connection is detected before any further
+ * acknowledgements arrive. The lock of the given guac_congestion must be held.
+ *
+ * @param congestion
+ *     The guac_congestion associated with the user.
+ *
+ * @param now
+ *     The current time.
+ *
+ * @return
+ *     The estimated delay experienced by the user, in milliseconds.
+ */
+static int guac_congestion_delay(guac_congestion* congestion,
+        guac_timestamp now) {
+
+    int delay = congestion->processing_lag;
+
+    /* Queueing delay can only be determined after a round trip */
+    if (congestion->min_rtt < 0)
+        return delay;
+
+    guac_timestamp rtt = congestion->rtt;
+
+    /* Account for frames which are taking longer than usual to arrive */
+    if (congestion->frame_count > 0) {
+        guac_timestamp age = now
+            - congestion->frames[congestion->frame_head].timestamp;
+        if (age > rtt)
+            rtt = age;
+    }
+
+    guac_timestamp queueing_delay = rtt - congestion->min_rtt;
+    if (queueing_delay > delay)
+        delay = guac_congestion_clamp(queueing_delay);
+
+    return delay;
+
+}
+
+/**
+ * Updates the bandwidth estimate of the given guac_congestion with a new
+ * delivery rate sample. The estimate is the largest rate measured within the
+ * current and previous bandwidth windows, such that rates measured while
+ * little data was being sent do not immediately reduce the estimate. The
+ * lock of the given guac_congestion must be held.
+ *
+ * @param congestion
+ *     The guac_congestion to update.
+ *
+ * @param rate
+ *     The measured delivery rate, in bytes per second.
+ *
+ * @param now
+ *     The time that the rate was measured.
+ */
+static void guac_congestion_update_bandwidth(guac_congestion* congestion,
+        int rate, guac_timestamp now) {
+
+    guac_timestamp elapsed = now - congestion->bandwidth_window;
+
+    /* Start a new window once the current window has ended, discarding the
+     * previous window entirely if no samples were measured within it */
+    if (elapsed >= GUAC_CONGESTION_BANDWIDTH_WINDOW) {
+
+        if (elapsed >= GUAC_CONGESTION_BANDWIDTH_WINDOW * 2)
+            congestion->bandwidth_previous = 0;
+        else
+            congestion->bandwidth_previous = congestion->bandwidth_current;
+
+        congestion->bandwidth_current = 0;
+        congestion->bandwidth_window = now;
+
+    }
+
+    if (rate > congestion->bandwidth_current)
+        congestion->bandwidth_current = rate;
+
+    /* Estimate is the maximum over both windows */
+    congestion->bandwidth = congestion->bandwidth_current;
+    if (congestion->bandwidth_previous > congestion->bandwidth)
+        congestion->bandwidth = congestion->bandwidth_previous;
+
+}
+
+guac_congestion* guac_congestion_alloc() {
+
+    guac_congestion* congestion = calloc(1, sizeof(guac_congestion));
+    if (congestion == NULL)
+        return NULL;
+
+    /* No round trips have yet been measured */
+    congestion->rtt = -1;
+    congestion->min_rtt = -1;
+
+    pthread_mutex_init(&congestion->__lock, NULL);
+    return congestion;
+
+}
+
+void guac_congestion_free(guac_congestion* congestion) {
+    pthread_mutex_destroy(&congestion->__lock);
+    free(congestion);
+}
+
+void guac_congestion_sent(guac_congestion* congestion, size_t length) {
+    __atomic_fetch_add(&congestion->bytes_sent, length, __ATOMIC_RELAXED);
+}
+
+void guac_congestion_frame_sent(guac_congestion* congestion,
+        guac_timestamp timestamp) {
+
+    pthread_mutex_lock(&congestion->__lock);
+
+    uint64_t bytes = __atomic_load_n(&congestion->bytes_sent,
+            __ATOMIC_RELAXED);
+
+    /* Update average frame size */
+    int frame_size = guac_congestion_clamp(bytes - congestion->frame_bytes);
+    if (congestion->frame_size == 0)
+        congestion->frame_size = frame_size;
+    else
+        congestion->frame_size = (congestion->frame_size * 7 + frame_size) / 8;
+
+    congestion->frame_bytes = bytes;
+
+    /* Forget oldest frame if no space remains */
+    if (congestion->frame_count == GUAC_CONGESTION_MAX_FRAMES) {
+        congestion->frame_head = (congestion->frame_head + 1)
+                               % GUAC_CONGESTION_MAX_FRAMES;
+        congestion->frame_count--;
+    }
+
+    /* Track frame until acknowledged */
+    guac_congestion_frame* frame = &congestion->frames[
+        (congestion->frame_head + congestion->frame_count)
+            % GUAC_CONGESTION_MAX_FRAMES];
+
+    frame->timestamp = timestamp;
+    frame->bytes = bytes;
+    congestion->frame_count++;
+
+    pthread_mutex_unlock(&congestion->__lock);
+
+}
+
+void guac_congestion_frame_acked(guac_congestion* congestion,
+        guac_timestamp timestamp, guac_timestamp now, int processing_lag) {
+
+    int found = 0;
+    uint64_t bytes = 0;
+
+    pthread_mutex_lock(&congestion->__lock);
+
+    congestion->processing_lag = processing_lag;
+
+    /* Acknowledgements are cumulative, covering all older frames */
+    while (congestion->frame_count > 0) {
+
+        guac_congestion_frame* frame =
+            &congestion->frames[congestion->frame_head];
+
+        if (frame->timestamp > timestamp)
+            break;
+
+        if (frame->timestamp == timestamp) {
+            bytes = frame->bytes;
+            found = 1;
+        }
+
+        congestion->frame_head = (congestion->frame_head + 1)
+                               % GUAC_CONGESTION_MAX_FRAMES;
+        congestion->frame_count--;
+
+    }
+
+    /* Estimates can be updated only if the time the frame was sent is known */
+    if (!found) {
+        pthread_mutex_unlock(&congestion->__lock);
+        return;
+    }
+
+    int rtt = now - timestamp;
+    if (rtt < 0)
+        rtt = 0;
+
+    /* Track minimum round-trip time, allowing stale minimums to expire */
+    if (congestion->min_rtt < 0 || rtt <= congestion->min_rtt
+            || now - congestion->min_rtt_timestamp
+                > GUAC_CONGESTION_MIN_RTT_WINDOW) {
+        congestion->min_rtt = rtt;
+        congestion->min_rtt_timestamp = now;
+    }
+
+    /* Smooth round-trip time */
+    if (congestion->rtt < 0)
+        congestion->rtt = rtt;
+    else
+        congestion->rtt = (congestion->rtt * 7 + rtt) / 8;
+
+    /* Measure delivery rate relative to the previous acknowledgement, using
+     * the longer of the send and receive intervals such that acknowledgements
+     * arriving in bursts do not inflate the rate */
+    if (congestion->last_ack != 0) {
+
+        guac_timestamp interval = now - congestion->last_ack;
+        if (timestamp - congestion->last_acked_frame > interval)
+            interval = timestamp - congestion->last_acked_frame;
+
+        if (interval < 1)
+            interval = 1;
+
+        int rate = guac_congestion_clamp(
+                (bytes - congestion->bytes_acked) * 1000 / interval);
+
+        guac_congestion_update_bandwidth(congestion, rate, now);
+
+    }
+
+    congestion->bytes_acked = bytes;
+    congestion->last_ack = now;
+    congestion->last_acked_frame = timestamp;
+
+    pthread_mutex_unlock(&congestion->__lock);
+
+}
+
+int guac_congestion_get_frame_duration(guac_congestion* congestion,
+        guac_timestamp now) {
+
+    pthread_mutex_lock(&congestion->__lock);
+
+    int duration = congestion->processing_lag;
+
+    /* Pace frames only while congested, as the bandwidth estimate reflects
+     * the true capacity of the link only while that link is busy */
+    if (congestion->bandwidth > 0 && guac_congestion_delay(congestion, now)
+            >= GUAC_CONGESTION_THRESHOLD) {
+
+        /* Allow enough time to transmit an average frame */
+        int pacing = guac_congestion_clamp((uint64_t) congestion->frame_size
+                * 1000 / congestion->bandwidth);
+
+        /* Allow data beyond the target latency to drain */
+        int excess = guac_congestion_drain_time(congestion)
+                   - GUAC_CONGESTION_TARGET_LATENCY;
+        if (excess > GUAC_CONGESTION_MAX_FRAME_DURATION - pacing)
+            pacing = GUAC_CONGESTION_MAX_FRAME_DURATION;
+        else if (excess > 0)
+            pacing += excess;
+
+        if (pacing > duration)
+            duration = pacing;
+
+    }
+
+    pthread_mutex_unlock(&congestion->__lock);
+
+    if (duration > GUAC_CONGESTION_MAX_FRAME_DURATION)
+        return GUAC_CONGESTION_MAX_FRAME_DURATION;
+
+    return duration;
+
+}
+
+int guac_congestion_get_quality(guac_congestion* congestion,
+        guac_timestamp now) {
+
+    pthread_mutex_lock(&congestion->__lock);
+    int delay = guac_congestion_delay(congestion, now);
+    pthread_mutex_unlock(&congestion->__lock);
+
+    /* Scale quality linearly from 90 to 30 as delay varies from 20ms to 80ms */
+    int quality = GUAC_CONGESTION_MAX_QUALITY - (delay - 20);
+
+    if (quality > GUAC_CONGESTION_MAX_QUALITY)
+        return GUAC_CONGESTION_MAX_QUALITY;
+
+    if (quality < GUAC_CONGESTION_MIN_QUALITY)
+        return GUAC_CONGESTION_MIN_QUALITY;
+
+    return quality;
+
+}
+
+int guac_congestion_is_congested(guac_congestion* congestion,
+        guac_timestamp now) {
+
+    pthread_mutex_lock(&congestion->__lock);
+    int delay = guac_congestion_delay(congestion, now);
+    pthread_mutex_unlock(&congestion->__lock);
+
+    return delay >= GUAC_CONGESTION_THRESHOLD;
+
+}
+
+void guac_congestion_get_estimates(guac_congestion* congestion, int* rtt,
+        int* bandwidth) {
+
+    pthread_mutex_lock(&congestion->__lock);
+    *rtt = congestion->rtt;
+    *bandwidth = congestion->bandwidth;
+    pthread_mutex_unlock(&congestion->__lock);
+
+}
+
@@ -33,10 +33,12 @@
 #endif
 
 #include <inttypes.h>
+#include <pthread.h>
 #include <setjmp.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <zlib.h>
 
 /**
  * Data describing the current write state of PNG data.
@@ -265,15 +267,136 @@ static void guac_png_flush_handler(png_structp png) {
 
 }
 
+/**
+ * Encoding state which is reused by all palette-based PNG images encoded
+ * within the same thread, avoiding repeated allocation of buffers which scale
+ * with the size of each image.
+ */
+typedef struct guac_png_encoder_state {
+
+    /**
+     * The palette of the image currently being encoded. This palette is
+     * reset after each image is encoded.
+     */
+    guac_palette* palette;
+
+    /**
+     * Buffer containing the palette index of each pixel of the image
+     * currently being encoded.
+     */
+    unsigned char* indexes;
+
+    /**
+     * The size of the indexes buffer, in bytes.
+     */
+    size_t indexes_size;
+
+    /**
+     * Array of pointers to the start of each row within the indexes buffer.
+     */
+    png_byte** rows;
+
+    /**
+     * The number of row pointers that the rows array can hold.
+     */
+    int rows_size;
+
+} guac_png_encoder_state;
+
+/**
+ * Key for the guac_png_encoder_state of the current thread.
+ */
+static pthread_key_t guac_png_encoder_state_key;
+
+/**
+ * Guard ensuring guac_png_encoder_state_key is created only once.
+ */
+static pthread_once_t guac_png_encoder_state_key_init = PTHREAD_ONCE_INIT;
+
+/**
+ * Frees the given guac_png_encoder_state. This function is invoked
+ * automatically when a thread which has encoded palette-based PNG images
+ * exits.
+ *
+ * @param data
+ *     The guac_png_encoder_state to free.
+ */
+static void guac_png_free_encoder_state(void* data) {
+
+    guac_png_encoder_state* state = (guac_png_encoder_state*) data;
+
+    guac_palette_free(state->palette);
+    free(state->indexes);
+    free(state->rows);
+    free(state);
+
+}
+
+/**
+ * Creates the key for the guac_png_encoder_state of each thread.
+ */
+static void guac_png_alloc_encoder_state_key() {
+    pthread_key_create(&guac_png_encoder_state_key,
+            guac_png_free_encoder_state);
+}
+
+/**
+ * Returns the guac_png_encoder_state of the current thread, allocating that
+ * state if necessary. The buffers of the returned state are guaranteed to be
+ * large enough for an image of the given dimensions.
+ *
+ * @param width
+ *     The width of the image to be encoded, in pixels.
+ *
+ * @param height
+ *     The height of the image to be encoded, in pixels.
+ *
+ * @return
+ *     The guac_png_encoder_state of the current thread.
+ */
+static guac_png_encoder_state* guac_png_get_encoder_state(int width,
+        int height) {
+
+    pthread_once(&guac_png_encoder_state_key_init,
+            guac_png_alloc_encoder_state_key);
+
+    guac_png_encoder_state* state =
+        (guac_png_encoder_state*) pthread_getspecific(guac_png_encoder_state_key);
+
+    /* Allocate state for current thread if not already allocated */
+    if (state == NULL) {
+        state = calloc(1, sizeof(guac_png_encoder_state));
+        state->palette = guac_palette_alloc();
+        pthread_setspecific(guac_png_encoder_state_key, state);
+    }
+
+    /* Expand index buffer as necessary */
+    size_t indexes_size = (size_t) width * height;
+    if (indexes_size > state->indexes_size) {
+        free(state->indexes);
+        state->indexes = malloc(indexes_size);
+        state->indexes_size = indexes_size;
+    }
+
+    /* Expand row array as necessary */
+    if (height > state->rows_size) {
+        free(state->rows);
+        state->rows = malloc(sizeof(png_byte*) * height);
+        state->rows_size = height;
+    }
+
+    return state;
+
+}
+
 int guac_png_write(guac_socket* socket, guac_stream* stream,
-        cairo_surface_t* surface) {
+        cairo_surface_t* surface, int level, guac_client_png_strategy strategy) {
 
     png_structp png;
     png_infop png_info;
-    png_byte** png_rows;
     int bpp;
 
-    int x, y;
+    int y;
 
     guac_png_write_state write_state;
 
@@ -284,30 +407,39 @@ int guac_png_write(guac_socket* socket, guac_stream* stream,
     int stride = cairo_image_surface_get_stride(surface);
     unsigned char* data = cairo_image_surface_get_data(surface);
 
-    /* If not RGB24, use Cairo PNG writer */
-    if (format != CAIRO_FORMAT_RGB24 || data == NULL)
+    /* If neither RGB24 nor ARGB32, use Cairo PNG writer */
+    if ((format != CAIRO_FORMAT_RGB24 && format != CAIRO_FORMAT_ARGB32)
+            || data == NULL)
         return guac_png_cairo_write(socket, stream, surface);
 
     /* Flush pending operations to surface */
     cairo_surface_flush(surface);
 
-    /* Attempt to build palette */
-    guac_palette* palette = guac_palette_alloc(surface);
+    guac_png_encoder_state* state = guac_png_get_encoder_state(width, height);
+    guac_palette* palette = state->palette;
 
-    /* If not possible, resort to Cairo PNG writer */
-    if (palette == NULL)
+    /* Attempt to build palette, determining the palette index of each pixel
+     * in the same pass (only possible if ARGB32 images are fully opaque) */
+    if (guac_palette_build(palette, data, width, height, stride,
+                format == CAIRO_FORMAT_ARGB32, state->indexes)) {
+
+        /* If not possible, resort to Cairo PNG writer */
+        guac_palette_reset(palette);
         return guac_png_cairo_write(socket, stream, surface);
 
+    }
+
     /* Calculate BPP from palette size */
     if      (palette->size <= 2)  bpp = 1;
     else if (palette->size <= 4)  bpp = 2;
     else if (palette->size <= 16) bpp = 4;
     else                          bpp = 8;
 
-    /* Set up PNG writer */
+    /* Set up PNG writer (libpng cannot reuse these structures for further
+     * images, thus they are recreated for each image) */
     png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
     if (!png) {
-        guac_palette_free(palette);
+        guac_palette_reset(palette);
         guac_error = GUAC_STATUS_INTERNAL_ERROR;
         guac_error_message = "libpng failed to create write structure";
         return -1;
@@ -316,7 +448,7 @@ int guac_png_write(guac_socket* socket, guac_stream* stream,
     png_info = png_create_info_struct(png);
     if (!png_info) {
         png_destroy_write_struct(&png, NULL);
-        guac_palette_free(palette);
+        guac_palette_reset(palette);
         guac_error = GUAC_STATUS_INTERNAL_ERROR;
         guac_error_message = "libpng failed to create info structure";
         return -1;
@@ -325,7 +457,7 @@ int guac_png_write(guac_socket* socket, guac_stream* stream,
     /* Set error handler */
     if (setjmp(png_jmpbuf(png))) {
         png_destroy_write_struct(&png, &png_info);
-        guac_palette_free(palette);
+        guac_palette_reset(palette);
         guac_error = GUAC_STATUS_IO_ERROR;
         guac_error_message = "libpng output error";
         return -1;
@@ -341,30 +473,40 @@ int guac_png_write(guac_socket* socket, guac_stream* stream,
             guac_png_write_handler,
             guac_png_flush_handler);
 
-    /* Copy data from surface into PNG data */
-    png_rows = (png_byte**) malloc(sizeof(png_byte*) * height);
-    for (y=0; y<height; y++) {
-
-        /* Allocate new PNG row */
-        png_byte* row = (png_byte*) malloc(sizeof(png_byte) * width);
-        png_rows[y] = row;
-
-        /* Copy data from surface into current row */
-        for (x=0; x<width; x++) {
-
-            /* Get pixel color */
-            int color = ((uint32_t*) data)[x] & 0xFFFFFF;
-
-            /* Set index in row */
-            row[x] = guac_palette_find(palette, color);
-
-        }
-
-        /* Advance to next data row */
-        data += stride;
+    /* Apply requested compression */
+    png_set_compression_level(png, level);
+    switch (strategy) {
+
+        /* Filter each row, compressing the filtered data */
+        case GUAC_CLIENT_PNG_FILTERED:
+            png_set_filter(png, PNG_FILTER_TYPE_BASE, PNG_ALL_FILTERS);
+            png_set_compression_strategy(png, Z_FILTERED);
+            break;
+
+        /* Compress unfiltered data using run-length encoding only */
+        case GUAC_CLIENT_PNG_RLE:
+            png_set_filter(png, PNG_FILTER_TYPE_BASE, PNG_FILTER_NONE);
+            png_set_compression_strategy(png, Z_RLE);
+            break;
+
+        /* Compress unfiltered data using Huffman coding only */
+        case GUAC_CLIENT_PNG_HUFFMAN:
+            png_set_filter(png, PNG_FILTER_TYPE_BASE, PNG_FILTER_NONE);
+            png_set_compression_strategy(png, Z_HUFFMAN_ONLY);
+            break;
+
+        /* Compress unfiltered data normally */
+        default:
+            png_set_filter(png, PNG_FILTER_TYPE_BASE, PNG_FILTER_NONE);
+            png_set_compression_strategy(png, Z_DEFAULT_STRATEGY);
+            break;
 
     }
 
+    /* Point each PNG row at the corresponding palette indexes */
+    for (y=0; y<height; y++)
+        state->rows[y] = state->indexes + (size_t) y * width;
+
     /* Write image info */
     png_set_IHDR(
         png,
@@ -382,19 +524,14 @@ int guac_png_write(guac_socket* socket, guac_stream* stream,
     png_set_PLTE(png, png_info, palette->colors, palette->size);
 
     /* Write image */
-    png_set_rows(png, png_info, png_rows);
+    png_set_rows(png, png_info, state->rows);
     png_write_png(png, png_info, PNG_TRANSFORM_PACKING, NULL);
 
     /* Finish write */
     png_destroy_write_struct(&png, &png_info);
 
-    /* Free palette */
-    guac_palette_free(palette);
-
-    /* Free PNG data */
-    for (y=0; y<height; y++)
-        free(png_rows[y]);
-    free(png_rows);
+    /* Clear palette for next image */
+    guac_palette_reset(palette);
 
     /* Ensure all data is written */
     guac_png_flush_data(&write_state);
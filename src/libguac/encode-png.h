@@ -22,6 +22,7 @@
 
 #include "config.h"
 
+#include "guacamole/client-types.h"
 #include "guacamole/socket.h"
 #include "guacamole/stream.h"
 
@@ -29,7 +30,10 @@
 
 /**
  * Encodes the given surface as a PNG, and sends the resulting data over the
- * given stream and socket as blobs.
+ * given stream and socket as blobs. Surfaces containing no more than 256
+ * fully-opaque colors are encoded as palette-based PNG images using buffers
+ * which are reused by all later calls within the same thread. All other
+ * surfaces are encoded by Cairo.
  *
  * @param socket
  *     The socket to send PNG blobs over.
@@ -40,11 +44,18 @@
  * @param surface
  *     The Cairo surface to write to the given stream and socket as PNG blobs.
  *
+ * @param level
+ *     The zlib compression level to use for palette-based PNG images, from 0
+ *     (no compression) to 9 (best compression).
+ *
+ * @param strategy
+ *     The strategy to use to compress palette-based PNG images.
+ *
  * @return
  *     Zero if the encoding operation is successful, non-zero otherwise.
  */
 int guac_png_write(guac_socket* socket, guac_stream* stream,
-        cairo_surface_t* surface);
+        cairo_surface_t* surface, int level, guac_client_png_strategy strategy);
 
 #endif
 
@@ -83,5 +83,26 @@
  */
 #define GUAC_BUFFER_POOL_INITIAL_SIZE 1024
 
+/**
+ * The default maximum number of bytes of broadcast data which may be queued
+ * for any single user, awaiting transmission to that user, before the output
+ * queue policy of the guac_client is applied. Output queues are disabled by
+ * default, such that broadcast data is written to each user synchronously.
+ */
+#define GUAC_CLIENT_DEFAULT_OUTPUT_QUEUE_SIZE 0
+
+/**
+ * The default number of threads which should be used by a guac_client to
+ * encode image data in parallel. This is deliberately small and independent
+ * of the number of processors, as every connection has its own threads.
+ */
+#define GUAC_CLIENT_DEFAULT_ENCODER_THREADS 2
+
+/**
+ * The default zlib compression level of PNG images sent by a guac_client,
+ * from 0 (no compression) to 9 (best compression).
+ */
+#define GUAC_CLIENT_DEFAULT_PNG_COMPRESSION_LEVEL 6
+
 #endif
 
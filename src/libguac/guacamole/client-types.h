@@ -93,5 +93,61 @@ typedef enum guac_client_log_level {
 
 } guac_client_log_level;
 
+/**
+ * Policy which dictates how a guac_client handles a user whose output queue
+ * has filled because that user cannot receive data as quickly as it is being
+ * produced.
+ */
+typedef enum guac_client_queue_policy {
+
+    /**
+     * Discard all further updates for the user until every update queued
+     * prior to the overflow has been sent, and then resynchronize that user
+     * with the current state of the connection using the resync_handler of
+     * the guac_client. If no resync_handler is defined, the user is
+     * disconnected as with GUAC_CLIENT_QUEUE_DISCONNECT.
+     */
+    GUAC_CLIENT_QUEUE_RESYNC,
+
+    /**
+     * Disconnect the user.
+     */
+    GUAC_CLIENT_QUEUE_DISCONNECT
+
+} guac_client_queue_policy;
+
+/**
+ * The strategy used to compress palette-based PNG images, trading encoding
+ * speed for compression ratio.
+ */
+typedef enum guac_client_png_strategy {
+
+    /**
+     * Do not filter image rows, compressing with the default zlib strategy.
+     */
+    GUAC_CLIENT_PNG_DEFAULT,
+
+    /**
+     * Choose the best PNG filter for each image row, compressing the filtered
+     * data with zlib's strategy for filtered data. This is the slowest
+     * strategy, but may compress images with gradients more effectively.
+     */
+    GUAC_CLIENT_PNG_FILTERED,
+
+    /**
+     * Do not filter image rows, compressing with run-length encoding only.
+     * This is much faster than the default strategy and remains effective for
+     * the large areas of solid color typical of desktop applications.
+     */
+    GUAC_CLIENT_PNG_RLE,
+
+    /**
+     * Do not filter image rows, compressing with Huffman coding only. This is
+     * the fastest strategy, but compresses least.
+     */
+    GUAC_CLIENT_PNG_HUFFMAN
+
+} guac_client_png_strategy;
+
 #endif
 
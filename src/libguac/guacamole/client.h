@@ -257,6 +257,68 @@ struct guac_client {
      */
     void* __plugin_handle;
 
+    /**
+     * Handler for resync events, called whenever a user has fallen so far
+     * behind that broadcast updates were dropped for that user, and the user
+     * must be brought back up to date with the current state of the
+     * connection. This handler is called from a thread dedicated to that user,
+     * and should send the user's socket the same state that would be sent
+     * to a new user joining the connection.
+     *
+     * If this handler is not defined, users which fall behind will be
+     * disconnected, regardless of output_queue_policy.
+     *
+     * Example:
+     * @code
+     *     int resync_handler(guac_user* user);
+     *
+     *     int guac_client_init(guac_client* client) {
+     *         client->resync_handler = resync_handler;
+     *     }
+     * @endcode
+     */
+    guac_user_resync_handler* resync_handler;
+
+    /**
+     * The maximum number of bytes of broadcast data which may be queued for
+     * each user, awaiting transmission by that user's writer thread. If zero,
+     * broadcast data is written to each user synchronously, and a user with a
+     * slow connection will delay all other users. Changes to this value
+     * affect only users that join after the change is made. By default, this
+     * will be GUAC_CLIENT_DEFAULT_OUTPUT_QUEUE_SIZE.
+     */
+    int output_queue_size;
+
+    /**
+     * What should happen when the output queue of a user overflows. By
+     * default, this will be GUAC_CLIENT_QUEUE_RESYNC.
+     */
+    guac_client_queue_policy output_queue_policy;
+
+    /**
+     * The number of threads which should be used to encode image data in
+     * parallel, such as the many independent rectangles updated within a
+     * single frame of a large remote desktop. If zero, image data is encoded
+     * serially by whichever thread sends it. This value is a hint to the
+     * implementation of the client plugin, and is read only when that
+     * plugin allocates its display. By default, this will be
+     * GUAC_CLIENT_DEFAULT_ENCODER_THREADS.
+     */
+    int encoder_threads;
+
+    /**
+     * The zlib compression level of palette-based PNG images sent by this
+     * client, from 0 (no compression) to 9 (best compression). By default,
+     * this will be GUAC_CLIENT_DEFAULT_PNG_COMPRESSION_LEVEL.
+     */
+    int png_compression_level;
+
+    /**
+     * The strategy used to compress palette-based PNG images sent by this
+     * client. By default, this will be GUAC_CLIENT_PNG_DEFAULT.
+     */
+    guac_client_png_strategy png_strategy;
+
 };
 
 /**
@@ -549,6 +611,50 @@ int guac_client_load_plugin(guac_client* client, const char* protocol);
  */
 int guac_client_get_processing_lag(guac_client* client);
 
+/**
+ * Returns the minimum amount of time that should elapse between frames sent
+ * to the pool of users, in milliseconds, as recommended by the congestion
+ * controller of each user. As all users receive the same frames, this is the
+ * longest duration recommended for any one user. Updates arriving during
+ * this time should be combined into the next frame rather than sent
+ * separately.
+ *
+ * @param client
+ *     The guac_client to calculate the frame duration of.
+ *
+ * @return
+ *     The recommended minimum frame duration for the pool of users associated
+ *     with the given guac_client, in milliseconds.
+ */
+int guac_client_get_frame_duration(guac_client* client);
+
+/**
+ * Returns the quality that should be used for lossy image encoding, as
+ * recommended by the congestion controller of each user. As all users receive
+ * the same image data, this is the lowest quality recommended for any one
+ * user.
+ *
+ * @param client
+ *     The guac_client to calculate the lossy quality of.
+ *
+ * @return
+ *     A quality between GUAC_CONGESTION_MIN_QUALITY and
+ *     GUAC_CONGESTION_MAX_QUALITY inclusive.
+ */
+int guac_client_get_lossy_quality(guac_client* client);
+
+/**
+ * Returns whether any user of the given guac_client is currently congested,
+ * such that lossy encodings should be preferred wherever they are allowed.
+ *
+ * @param client
+ *     The guac_client to test.
+ *
+ * @return
+ *     Non-zero if at least one user is congested, zero otherwise.
+ */
+int guac_client_is_congested(guac_client* client);
+
 /**
  * Sends a request to the owner of the given guac_client for parameters required
  * to continue the connection started by the client. The function returns zero
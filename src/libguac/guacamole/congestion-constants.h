@@ -0,0 +1,81 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef _GUAC_CONGESTION_CONSTANTS_H
+#define _GUAC_CONGESTION_CONSTANTS_H
+
+/**
+ * Constants related to the per-user congestion controller, guac_congestion.
+ *
+ * @file congestion-constants.h
+ */
+
+/**
+ * The maximum number of unacknowledged frames tracked for any one user. If
+ * more frames than this are outstanding, the oldest are forgotten, and their
+ * acknowledgements will not produce new estimates.
+ */
+#define GUAC_CONGESTION_MAX_FRAMES 64
+
+/**
+ * The amount of time after which the minimum observed round-trip time is
+ * considered stale and may be replaced by a larger sample, in milliseconds.
+ */
+#define GUAC_CONGESTION_MIN_RTT_WINDOW 10000
+
+/**
+ * The amount of time over which the maximum observed delivery rate is used as
+ * the bandwidth estimate, in milliseconds. The estimate is the maximum over
+ * between one and two windows of samples.
+ */
+#define GUAC_CONGESTION_BANDWIDTH_WINDOW 5000
+
+/**
+ * The amount of time that data may wait to be delivered to a user before new
+ * frames are delayed to allow that data to drain, in milliseconds.
+ */
+#define GUAC_CONGESTION_TARGET_LATENCY 100
+
+/**
+ * The estimated delay experienced by a user at or above which that user is
+ * considered congested, in milliseconds.
+ */
+#define GUAC_CONGESTION_THRESHOLD 50
+
+/**
+ * The longest frame duration that will be recommended for any user, in
+ * milliseconds. This bounds how long updates may be withheld from a user on a
+ * severely congested link.
+ */
+#define GUAC_CONGESTION_MAX_FRAME_DURATION 1000
+
+/**
+ * The highest lossy quality that will be recommended for any user, used when
+ * no congestion is detected.
+ */
+#define GUAC_CONGESTION_MAX_QUALITY 90
+
+/**
+ * The lowest lossy quality that will be recommended for any user, regardless
+ * of how congested that user's connection may be.
+ */
+#define GUAC_CONGESTION_MIN_QUALITY 30
+
+#endif
+
@@ -0,0 +1,44 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef _GUAC_CONGESTION_TYPES_H
+#define _GUAC_CONGESTION_TYPES_H
+
+/**
+ * Type definitions related to the per-user congestion controller,
+ * guac_congestion.
+ *
+ * @file congestion-types.h
+ */
+
+/**
+ * A frame which has been sent to a user but not yet acknowledged with a
+ * "sync" instruction.
+ */
+typedef struct guac_congestion_frame guac_congestion_frame;
+
+/**
+ * Estimates of the network conditions between guacd and a single user,
+ * derived from acknowledged frames, along with the recommendations made based
+ * on those estimates.
+ */
+typedef struct guac_congestion guac_congestion;
+
+#endif
+
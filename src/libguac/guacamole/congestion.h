@@ -0,0 +1,308 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef _GUAC_CONGESTION_H
+#define _GUAC_CONGESTION_H
+
+/**
+ * Provides a per-user congestion controller which estimates round-trip time
+ * and bandwidth from the "sync" instructions acknowledging each frame, and
+ * which recommends frame durations and lossy encoding quality accordingly.
+ *
+ * @file congestion.h
+ */
+
+#include "congestion-constants.h"
+#include "congestion-types.h"
+#include "timestamp-types.h"
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct guac_congestion_frame {
+
+    /**
+     * The timestamp sent within the "sync" instruction which ended this
+     * frame.
+     */
+    guac_timestamp timestamp;
+
+    /**
+     * The total number of bytes sent to the user prior to the end of this
+     * frame.
+     */
+    uint64_t bytes;
+
+};
+
+struct guac_congestion {
+
+    /**
+     * The total number of bytes sent to the user. This value is updated
+     * atomically and may be read without acquiring the lock.
+     */
+    uint64_t bytes_sent;
+
+    /**
+     * The total number of bytes sent to the user prior to the end of the most
+     * recently acknowledged frame.
+     */
+    uint64_t bytes_acked;
+
+    /**
+     * The value of bytes_sent at the end of the most recently sent frame.
+     */
+    uint64_t frame_bytes;
+
+    /**
+     * The average number of bytes sent per frame, as an exponentially-weighted
+     * moving average.
+     */
+    int frame_size;
+
+    /**
+     * Ring of all frames sent but not yet acknowledged, oldest first.
+     */
+    guac_congestion_frame frames[GUAC_CONGESTION_MAX_FRAMES];
+
+    /**
+     * The index of the oldest unacknowledged frame within frames.
+     */
+    int frame_head;
+
+    /**
+     * The number of unacknowledged frames within frames.
+     */
+    int frame_count;
+
+    /**
+     * The time that the most recent acknowledgement was received, or zero if
+     * no frame has yet been acknowledged.
+     */
+    guac_timestamp last_ack;
+
+    /**
+     * The timestamp of the most recently acknowledged frame.
+     */
+    guac_timestamp last_acked_frame;
+
+    /**
+     * The smoothed round-trip time, in milliseconds, or -1 if no round trip
+     * has yet been measured. This includes the time taken by the user to
+     * render each frame.
+     */
+    int rtt;
+
+    /**
+     * The smallest round-trip time measured within the last
+     * GUAC_CONGESTION_MIN_RTT_WINDOW milliseconds, or -1 if no round trip has
+     * yet been measured.
+     */
+    int min_rtt;
+
+    /**
+     * The time that min_rtt was measured.
+     */
+    guac_timestamp min_rtt_timestamp;
+
+    /**
+     * The estimated bandwidth available to the user, in bytes per second, or
+     * zero if not yet known.
+     */
+    int bandwidth;
+
+    /**
+     * The largest delivery rate measured within the current bandwidth window,
+     * in bytes per second.
+     */
+    int bandwidth_current;
+
+    /**
+     * The largest delivery rate measured within the previous bandwidth
+     * window, in bytes per second.
+     */
+    int bandwidth_previous;
+
+    /**
+     * The time that the current bandwidth window began.
+     */
+    guac_timestamp bandwidth_window;
+
+    /**
+     * The processing lag most recently reported for the user, in
+     * milliseconds.
+     */
+    int processing_lag;
+
+    /**
+     * Lock which is acquired whenever the estimates or unacknowledged frames
+     * are accessed.
+     */
+    pthread_mutex_t __lock;
+
+};
+
+/**
+ * Allocates a new congestion controller having no estimates. Until frames
+ * have been acknowledged, the controller makes no recommendations beyond
+ * those made for an uncongested link.
+ *
+ * @return
+ *     A newly-allocated guac_congestion, or NULL if allocation fails.
+ */
+guac_congestion* guac_congestion_alloc();
+
+/**
+ * Frees the given congestion controller.
+ *
+ * @param congestion
+ *     The guac_congestion to free.
+ */
+void guac_congestion_free(guac_congestion* congestion);
+
+/**
+ * Records that the given number of bytes have been sent to the user. This
+ * function does not acquire any locks and is safe to invoke while writing
+ * data to the user.
+ *
+ * @param congestion
+ *     The guac_congestion associated with the user receiving the data.
+ *
+ * @param length
+ *     The number of bytes sent.
+ */
+void guac_congestion_sent(guac_congestion* congestion, size_t length);
+
+/**
+ * Records that a frame has ended, and that a "sync" instruction with the
+ * given timestamp is being sent to the user.
+ *
+ * @param congestion
+ *     The guac_congestion associated with the user receiving the frame.
+ *
+ * @param timestamp
+ *     The timestamp included within the "sync" instruction ending the frame.
+ */
+void guac_congestion_frame_sent(guac_congestion* congestion,
+        guac_timestamp timestamp);
+
+/**
+ * Updates the estimates of the given congestion controller based on the
+ * acknowledgement of a frame by the user. Acknowledgements of frames which
+ * were not recorded with guac_congestion_frame_sent(), or which have been
+ * forgotten, are ignored other than to discard any older frames.
+ *
+ * @param congestion
+ *     The guac_congestion associated with the user acknowledging the frame.
+ *
+ * @param timestamp
+ *     The timestamp included within the "sync" instruction received from the
+ *     user.
+ *
+ * @param now
+ *     The time that the acknowledgement was received.
+ *
+ * @param processing_lag
+ *     The processing lag calculated for the user, in milliseconds.
+ */
+void guac_congestion_frame_acked(guac_congestion* congestion,
+        guac_timestamp timestamp, guac_timestamp now, int processing_lag);
+
+/**
+ * Returns the minimum amount of time that should elapse between frames sent
+ * to the user, in milliseconds. This is at least the user's processing lag.
+ * While the user is congested, this additionally accounts for the time
+ * required to transmit an average frame at the estimated bandwidth, and for
+ * any time needed to drain data in excess of GUAC_CONGESTION_TARGET_LATENCY.
+ * Updates arriving during this time should be combined into the next frame
+ * rather than sent separately.
+ *
+ * @param congestion
+ *     The guac_congestion associated with the user.
+ *
+ * @param now
+ *     The current time.
+ *
+ * @return
+ *     The recommended minimum frame duration, in milliseconds, never
+ *     exceeding GUAC_CONGESTION_MAX_FRAME_DURATION.
+ */
+int guac_congestion_get_frame_duration(guac_congestion* congestion,
+        guac_timestamp now);
+
+/**
+ * Returns the quality that should be used for lossy image encoding for the
+ * user, scaled down from GUAC_CONGESTION_MAX_QUALITY as the estimated delay
+ * experienced by the user increases. The estimated delay is the larger of the
+ * user's processing lag and the increase in round-trip time over the minimum
+ * round-trip time recently observed.
+ *
+ * @param congestion
+ *     The guac_congestion associated with the user.
+ *
+ * @param now
+ *     The current time.
+ *
+ * @return
+ *     A quality between GUAC_CONGESTION_MIN_QUALITY and
+ *     GUAC_CONGESTION_MAX_QUALITY inclusive.
+ */
+int guac_congestion_get_quality(guac_congestion* congestion,
+        guac_timestamp now);
+
+/**
+ * Returns whether the user is currently congested, such that lossy encodings
+ * should be preferred wherever they are allowed and frames should be paced
+ * according to the estimated bandwidth.
+ *
+ * @param congestion
+ *     The guac_congestion associated with the user.
+ *
+ * @param now
+ *     The current time.
+ *
+ * @return
+ *     Non-zero if the estimated delay experienced by the user is at least
+ *     GUAC_CONGESTION_THRESHOLD, zero otherwise.
+ */
+int guac_congestion_is_congested(guac_congestion* congestion,
+        guac_timestamp now);
+
+/**
+ * Retrieves a consistent snapshot of the current round-trip time and
+ * bandwidth estimates of the given congestion controller, such as for
+ * logging.
+ *
+ * @param congestion
+ *     The guac_congestion associated with the user.
+ *
+ * @param rtt
+ *     Pointer to an int which will receive the smoothed round-trip time, in
+ *     milliseconds, or -1 if no round trip has yet been measured.
+ *
+ * @param bandwidth
+ *     Pointer to an int which will receive the estimated bandwidth, in bytes
+ *     per second, or zero if not yet known.
+ */
+void guac_congestion_get_estimates(guac_congestion* congestion, int* rtt,
+        int* bandwidth);
+
+#endif
+
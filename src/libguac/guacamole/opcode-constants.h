@@ -0,0 +1,49 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef _GUAC_OPCODE_CONSTANTS_H
+#define _GUAC_OPCODE_CONSTANTS_H
+
+/**
+ * Constants related to guac_opcode_map, the perfect-hash lookup of
+ * instruction opcodes.
+ *
+ * @file opcode-constants.h
+ */
+
+/**
+ * The minimum number of slots within the hash table of any guac_opcode_map.
+ */
+#define GUAC_OPCODE_MAP_MIN_SIZE 8
+
+/**
+ * The maximum number of slots within the hash table of any guac_opcode_map.
+ * If no collision-free hash can be found for a set of opcodes with a table of
+ * this size, the map cannot be created.
+ */
+#define GUAC_OPCODE_MAP_MAX_SIZE 4096
+
+/**
+ * The number of hash seeds tried for each hash table size before the next
+ * larger size is tried.
+ */
+#define GUAC_OPCODE_MAP_SEEDS 256
+
+#endif
+
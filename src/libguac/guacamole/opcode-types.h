@@ -0,0 +1,38 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef _GUAC_OPCODE_TYPES_H
+#define _GUAC_OPCODE_TYPES_H
+
+/**
+ * Type definitions related to guac_opcode_map, the perfect-hash lookup of
+ * instruction opcodes.
+ *
+ * @file opcode-types.h
+ */
+
+/**
+ * A perfect-hash index of the opcodes within an array of opcode/handler
+ * mappings, allowing the mapping for any opcode to be located with a single
+ * hash and string comparison.
+ */
+typedef struct guac_opcode_map guac_opcode_map;
+
+#endif
+
@@ -0,0 +1,112 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef _GUAC_OPCODE_H
+#define _GUAC_OPCODE_H
+
+/**
+ * Provides functions and structures for dispatching instructions by opcode
+ * using a perfect hash built from an array of opcode/handler mappings.
+ *
+ * @file opcode.h
+ */
+
+#include "opcode-constants.h"
+#include "opcode-types.h"
+
+#include <stddef.h>
+
+struct guac_opcode_map {
+
+    /**
+     * The number of slots within the hash table. This is always a power of
+     * two.
+     */
+    int size;
+
+    /**
+     * The seed of the hash function, chosen such that no two distinct
+     * opcodes within the map hash to the same slot.
+     */
+    unsigned int seed;
+
+    /**
+     * The opcode associated with each slot of the hash table, or NULL if the
+     * slot is empty. These point to the opcodes of the original mappings.
+     */
+    const char** opcodes;
+
+    /**
+     * The index of the mapping within the original array of mappings which is
+     * associated with each slot of the hash table, or -1 if the slot is
+     * empty.
+     */
+    int* indices;
+
+};
+
+/**
+ * Allocates a new guac_opcode_map which indexes the given array of
+ * opcode/handler mappings. Each mapping must be a structure whose first
+ * member is the opcode (a "const char*" or "char*"), and the array must be
+ * terminated by a mapping whose opcode is NULL, as with the handler maps
+ * used throughout libguac and its utilities. The array must remain valid for
+ * the lifetime of the returned map. If an opcode appears more than once, only
+ * its first mapping is indexed.
+ *
+ * @param mappings
+ *     The array of opcode/handler mappings to index.
+ *
+ * @param mapping_size
+ *     The size of each mapping within the array, in bytes.
+ *
+ * @return
+ *     A newly-allocated guac_opcode_map, or NULL if the map could not be
+ *     allocated, in which case guac_error will be set appropriately.
+ */
+guac_opcode_map* guac_opcode_map_alloc(const void* mappings,
+        size_t mapping_size);
+
+/**
+ * Returns the index of the mapping having the given opcode within the array
+ * of mappings indexed by the given guac_opcode_map.
+ *
+ * @param map
+ *     The guac_opcode_map to search.
+ *
+ * @param opcode
+ *     The opcode to search for.
+ *
+ * @return
+ *     The index of the mapping having the given opcode within the original
+ *     array of mappings, or -1 if no mapping has that opcode.
+ */
+int guac_opcode_map_lookup(const guac_opcode_map* map, const char* opcode);
+
+/**
+ * Frees the given guac_opcode_map. The array of mappings it indexes is not
+ * freed.
+ *
+ * @param map
+ *     The guac_opcode_map to free.
+ */
+void guac_opcode_map_free(guac_opcode_map* map);
+
+#endif
+
@@ -121,6 +121,20 @@ int guac_parser_append(guac_parser* parser, void* buffer, int length);
  */
 int guac_parser_length(guac_parser* parser);
 
+/**
+ * Returns whether the unparsed bytes stored in the given parser's internal
+ * buffers contain the next instruction in its entirety, such that the next
+ * call to guac_parser_read() will parse that instruction without reading from
+ * its socket. The buffered data is only inspected and is not modified. If the
+ * buffered data is malformed, or if the given parser is in the middle of
+ * parsing an instruction, zero is returned.
+ *
+ * @param parser The parser whose buffered data should be inspected.
+ * @return Non-zero if a complete instruction is already buffered, zero
+ *         otherwise.
+ */
+int guac_parser_buffered(guac_parser* parser);
+
 /**
  * Removes up to length bytes from internal buffer of unparsed bytes, storing
  * them in the given buffer.
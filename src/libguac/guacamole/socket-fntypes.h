@@ -112,5 +112,17 @@ typedef void guac_socket_unlock_handler(guac_socket* socket);
  */
 typedef int guac_socket_free_handler(guac_socket* socket);
 
+/**
+ * Generic handler for the shutdown of a socket, modeled after the standard
+ * POSIX shutdown() function. When set within a guac_socket, a handler of this
+ * type will be called when guac_socket_shutdown() is invoked, and must cause
+ * any pending or future read or write on the socket to fail rather than
+ * block.
+ *
+ * @param socket
+ *     The guac_socket being shut down.
+ */
+typedef void guac_socket_shutdown_handler(guac_socket* socket);
+
 #endif
 
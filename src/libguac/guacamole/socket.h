@@ -31,6 +31,7 @@
 #include "socket-fntypes.h"
 #include "socket-types.h"
 #include "timestamp-types.h"
+#include "user-fntypes.h"
 
 #include <pthread.h>
 #include <stdint.h>
@@ -113,6 +114,23 @@ struct guac_socket {
      */
     pthread_t __keep_alive_thread;
 
+    /**
+     * Handler which, if defined, will be called by guac_socket_write_base64()
+     * to base64-encode complete 3-byte groups directly into any internal
+     * output buffer of this socket. The number of bytes provided to this
+     * handler will always be a multiple of 3, and the value returned is the
+     * number of unencoded bytes consumed, or a negative value on error. If
+     * not defined, data is encoded by guac_socket_write_base64() and written
+     * using the write handler.
+     */
+    guac_socket_write_handler* __write_base64_handler;
+
+    /**
+     * Handler which will be called when guac_socket_shutdown() is invoked on
+     * this socket.
+     */
+    guac_socket_shutdown_handler* shutdown_handler;
+
 };
 
 /**
@@ -254,6 +272,29 @@ guac_socket* guac_socket_tee(guac_socket* primary, guac_socket* secondary);
  */
 guac_socket* guac_socket_broadcast(guac_client* client);
 
+/**
+ * Restricts all data subsequently written by the calling thread to any socket
+ * returned by guac_socket_broadcast() to only those users accepted by the
+ * given filter. The filter remains in effect for the calling thread until it
+ * is replaced or removed by invoking this function again with a NULL filter.
+ * Other threads writing to the same broadcast socket are unaffected. Sockets
+ * created with guac_socket_tee(), such as those used for session recordings,
+ * duplicate data written by the calling thread to their secondary socket only
+ * if the filter accepts a NULL user.
+ *
+ * The filter is consulted separately for each write, flush, and instruction
+ * boundary, and must therefore produce a consistent result for each user
+ * until it is removed.
+ *
+ * @param filter
+ *     The filter to apply to data written by the calling thread, or NULL to
+ *     write to all users.
+ *
+ * @param data
+ *     Arbitrary data to pass to the given filter.
+ */
+void guac_socket_broadcast_set_filter(guac_user_filter* filter, void* data);
+
 /**
  * Writes the given unsigned int to the given guac_socket object. The data
  * written may be buffered until the buffer is flushed automatically or
@@ -369,5 +410,17 @@ ssize_t guac_socket_flush(guac_socket* socket);
  */
 int guac_socket_select(guac_socket* socket, int usec_timeout);
 
+/**
+ * Shuts down the connection underlying the given guac_socket, such that any
+ * read or write which is blocked or subsequently attempted by any thread
+ * fails. Data already written to the underlying connection is not discarded.
+ * The socket must still be freed with guac_socket_free(). If the socket does
+ * not support shutdown, this function has no effect.
+ *
+ * @param socket
+ *     The guac_socket to shut down.
+ */
+void guac_socket_shutdown(guac_socket* socket);
+
 #endif
 
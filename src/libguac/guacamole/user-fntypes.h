@@ -58,6 +58,25 @@
  */
 typedef void* guac_user_callback(guac_user* user, void* data);
 
+/**
+ * Callback which determines whether a particular user should receive data
+ * written to a broadcast socket while a filter is in effect.
+ *
+ * @see guac_socket_broadcast_set_filter()
+ *
+ * @param user
+ *     The user which would receive the data, or NULL if the data would be
+ *     received by something other than a user, such as the secondary socket
+ *     of a socket created with guac_socket_tee().
+ *
+ * @param data
+ *     The arbitrary data passed to guac_socket_broadcast_set_filter().
+ *
+ * @return
+ *     Non-zero if the given user should receive the data, zero otherwise.
+ */
+typedef int guac_user_filter(guac_user* user, void* data);
+
 /**
  * Handler for Guacamole mouse events, invoked when a "mouse" instruction has
  * been received from a user.
@@ -429,6 +448,23 @@ typedef int guac_user_join_handler(guac_user* user, int argc, char** argv);
  */
 typedef int guac_user_leave_handler(guac_user* user);
 
+/**
+ * Handler for Guacamole resync events. A resync event is fired by the
+ * guac_client whenever updates broadcast to all users had to be dropped for a
+ * particular user, as that user could not receive data quickly enough. The
+ * handler must send the user the full current state of the connection, as
+ * would be sent to a user joining the connection. There is no instruction
+ * associated with a resync event.
+ *
+ * @param user
+ *     The user that must be resynchronized.
+ *
+ * @return
+ *     Zero if the user has been successfully resynchronized, non-zero
+ *     otherwise.
+ */
+typedef int guac_user_resync_handler(guac_user* user);
+
 /**
  * Handler for Guacamole sync events. A sync event is fired by the
  * guac_client whenever a guac_user responds to a "sync" instruction. Sync
@@ -38,5 +38,11 @@ typedef struct guac_user guac_user;
  */
 typedef struct guac_user_info guac_user_info;
 
+/**
+ * Queue of broadcast data awaiting transmission to a particular user. The
+ * structure of this queue is internal to libguac.
+ */
+typedef struct guac_user_queue guac_user_queue;
+
 #endif
 
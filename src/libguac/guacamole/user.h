@@ -29,6 +29,7 @@
  */
 
 #include "client-types.h"
+#include "congestion-types.h"
 #include "layer-types.h"
 #include "pool-types.h"
 #include "socket-types.h"
@@ -42,6 +43,7 @@
 
 #include <pthread.h>
 #include <stdarg.h>
+#include <stddef.h>
 
 struct guac_user_info {
 
@@ -530,6 +532,33 @@ struct guac_user {
      */
     guac_user_touch_handler* touch_handler;
 
+    /**
+     * Non-zero if mouse and touch events which are immediately followed by
+     * another event from this user that supersedes them should be dropped,
+     * zero if every event should be passed to its handler. Only events
+     * which are already buffered are considered, and only events which
+     * change position alone are dropped: a mouse event is superseded only
+     * by a following mouse event with the same button mask, and a touch
+     * event only by a following touch event for the same contact while
+     * that contact remains pressed. This is zero by default and may be set
+     * by the join handler of any protocol plugin whose mouse and touch
+     * handlers are expensive enough that stale events would otherwise back
+     * up under lag.
+     */
+    int coalesce_input;
+
+    /**
+     * Queue of broadcast data awaiting transmission to this user, or NULL if
+     * broadcast data is written to this user's socket synchronously.
+     */
+    guac_user_queue* __output_queue;
+
+    /**
+     * Congestion controller which estimates the round-trip time and bandwidth
+     * of this user's connection from acknowledged frames.
+     */
+    guac_congestion* congestion;
+
 };
 
 /**
@@ -627,6 +656,22 @@ void guac_user_free_stream(guac_user* user, guac_stream* stream);
  */
 void guac_user_stop(guac_user* user);
 
+/**
+ * Returns the number of bytes of broadcast data currently queued for the
+ * given user, awaiting transmission. This value is intended for monitoring,
+ * and may be out of date as soon as it is returned. The given user must
+ * remain valid for the duration of this call, such as within a callback
+ * invoked by guac_client_foreach_user().
+ *
+ * @param user
+ *     The user whose output queue should be inspected.
+ *
+ * @return
+ *     The number of bytes of data queued for the given user, or zero if the
+ *     user has no output queue.
+ */
+size_t guac_user_get_queue_depth(guac_user* user);
+
 /**
  * Signals the given user to stop gracefully, while also signalling via the
  * Guacamole protocol that an error has occurred. Note that this is a completely
@@ -0,0 +1,217 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+
+#include "guacamole/error.h"
+#include "guacamole/opcode.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Returns the opcode of the mapping at the given index within an array of
+ * opcode/handler mappings, each of which begins with its opcode.
+ *
+ * @param mappings
+ *     The array of opcode/handler mappings.
+ *
+ * @param mapping_size
+ *     The size of each mapping within the array, in bytes.
+ *
+ * @param index
+ *     The index of the mapping whose opcode should be returned.
+ *
+ * @return
+ *     The opcode of the mapping at the given index, or NULL if that mapping
+ *     terminates the array.
+ */
+static const char* guac_opcode_mapping_opcode(const void* mappings,
+        size_t mapping_size, int index) {
+
+    const char* const* opcode = (const char* const*)
+        ((const char*) mappings + mapping_size * index);
+
+    return *opcode;
+
+}
+
+/**
+ * Hashes the given opcode using a seeded variant of the 32-bit FNV-1a hash.
+ *
+ * @param seed
+ *     The seed of the hash function.
+ *
+ * @param opcode
+ *     The opcode to hash.
+ *
+ * @return
+ *     The hash of the given opcode.
+ */
+static unsigned int guac_opcode_hash(unsigned int seed, const char* opcode) {
+
+    unsigned int hash = 2166136261u ^ seed;
+
+    while (*opcode != '\0') {
+        hash ^= (unsigned char) *(opcode++);
+        hash *= 16777619u;
+    }
+
+    /* Mix high bits into the low bits used to select a slot */
+    return hash ^ (hash >> 15);
+
+}
+
+/**
+ * Attempts to place every opcode within the given mappings into the hash
+ * table of the given map using the map's current size and seed. Any
+ * previous contents of the hash table are discarded.
+ *
+ * @param map
+ *     The guac_opcode_map whose hash table should be populated.
+ *
+ * @param mappings
+ *     The array of opcode/handler mappings to index.
+ *
+ * @param mapping_size
+ *     The size of each mapping within the array, in bytes.
+ *
+ * @return
+ *     Non-zero if every distinct opcode was placed within its own slot, zero
+ *     if two distinct opcodes collided.
+ */
+static int guac_opcode_map_populate(guac_opcode_map* map,
+        const void* mappings, size_t mapping_size) {
+
+    const char* opcode;
+
+    for (int i = 0; i < map->size; i++) {
+        map->opcodes[i] = NULL;
+        map->indices[i] = -1;
+    }
+
+    for (int i = 0; (opcode = guac_opcode_mapping_opcode(mappings,
+                    mapping_size, i)) != NULL; i++) {
+
+        unsigned int slot = guac_opcode_hash(map->seed, opcode)
+                          & (map->size - 1);
+
+        /* Place opcode if slot is free */
+        if (map->opcodes[slot] == NULL) {
+            map->opcodes[slot] = opcode;
+            map->indices[slot] = i;
+        }
+
+        /* Duplicate opcodes resolve to the first mapping, as with a linear
+         * search of the mappings */
+        else if (strcmp(map->opcodes[slot], opcode) != 0)
+            return 0;
+
+    }
+
+    return 1;
+
+}
+
+/**
+ * Releases any space within the hash table of the given map beyond its
+ * current size. If the space cannot be released, the map is left unchanged.
+ *
+ * @param map
+ *     The guac_opcode_map whose hash table should be reduced to its current
+ *     size.
+ */
+static void guac_opcode_map_shrink(guac_opcode_map* map) {
+
+    const char** opcodes = realloc(map->opcodes,
+            sizeof(const char*) * map->size);
+    if (opcodes != NULL)
+        map->opcodes = opcodes;
+
+    int* indices = realloc(map->indices, sizeof(int) * map->size);
+    if (indices != NULL)
+        map->indices = indices;
+
+}
+
+guac_opcode_map* guac_opcode_map_alloc(const void* mappings,
+        size_t mapping_size) {
+
+    int count = 0;
+    while (guac_opcode_mapping_opcode(mappings, mapping_size, count) != NULL)
+        count++;
+
+    guac_opcode_map* map = malloc(sizeof(guac_opcode_map));
+    if (map == NULL) {
+        guac_error = GUAC_STATUS_NO_MEMORY;
+        guac_error_message = "Insufficient memory to allocate opcode map";
+        return NULL;
+    }
+
+    map->opcodes = malloc(sizeof(const char*) * GUAC_OPCODE_MAP_MAX_SIZE);
+    map->indices = malloc(sizeof(int) * GUAC_OPCODE_MAP_MAX_SIZE);
+    if (map->opcodes == NULL || map->indices == NULL) {
+        guac_opcode_map_free(map);
+        guac_error = GUAC_STATUS_NO_MEMORY;
+        guac_error_message = "Insufficient memory to allocate opcode map";
+        return NULL;
+    }
+
+    /* Start with a table at least twice the number of opcodes, so that a
+     * collision-free seed is quickly found */
+    map->size = GUAC_OPCODE_MAP_MIN_SIZE;
+    while (map->size < count * 2)
+        map->size *= 2;
+
+    /* Search for the smallest table and seed without collisions */
+    for (; map->size <= GUAC_OPCODE_MAP_MAX_SIZE; map->size *= 2) {
+        for (map->seed = 0; map->seed < GUAC_OPCODE_MAP_SEEDS; map->seed++) {
+            if (guac_opcode_map_populate(map, mappings, mapping_size)) {
+                guac_opcode_map_shrink(map);
+                return map;
+            }
+        }
+    }
+
+    guac_opcode_map_free(map);
+    guac_error = GUAC_STATUS_INVALID_ARGUMENT;
+    guac_error_message = "No perfect hash exists for the given opcodes";
+    return NULL;
+
+}
+
+int guac_opcode_map_lookup(const guac_opcode_map* map, const char* opcode) {
+
+    unsigned int slot = guac_opcode_hash(map->seed, opcode) & (map->size - 1);
+
+    /* The only opcode which can match is the one within the hashed slot */
+    const char* candidate = map->opcodes[slot];
+    if (candidate != NULL && strcmp(candidate, opcode) == 0)
+        return map->indices[slot];
+
+    return -1;
+
+}
+
+void guac_opcode_map_free(guac_opcode_map* map) {
+    free(map->opcodes);
+    free(map->indices);
+    free(map);
+}
+
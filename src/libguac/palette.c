@@ -21,111 +21,140 @@
 
 #include "palette.h"
 
-#include <cairo/cairo.h>
-
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-guac_palette* guac_palette_alloc(cairo_surface_t* surface) {
-
-    int x, y;
-
-    int width = cairo_image_surface_get_width(surface);
-    int height = cairo_image_surface_get_height(surface);
-    int stride = cairo_image_surface_get_stride(surface);
-    unsigned char* data = cairo_image_surface_get_data(surface);
+guac_palette* guac_palette_alloc() {
 
-    /* Allocate palette */
     guac_palette* palette = (guac_palette*) malloc(sizeof(guac_palette));
     memset(palette, 0, sizeof(guac_palette));
 
-    for (y=0; y<height; y++) {
-        for (x=0; x<width; x++) {
-
-            /* Get pixel color */
-            int color = ((uint32_t*) data)[x] & 0xFFFFFF;
+    return palette;
 
-            /* Calculate hash code */
-            int hash = ((color & 0xFFF000) >> 12) ^ (color & 0xFFF);
+}
 
-            guac_palette_entry* entry;
+/**
+ * Returns the index of the given color within the given palette, adding that
+ * color to the palette if not already present.
+ *
+ * @param palette
+ *     The palette to search.
+ *
+ * @param color
+ *     The 24-bit RGB color to search for.
+ *
+ * @return
+ *     The index of the given color within the palette, or -1 if the color is
+ *     not yet present and the palette is already full.
+ */
+static int guac_palette_add(guac_palette* palette, int color) {
 
-            /* Search for open palette entry */
-            for (;;) {
-                
-                entry = &(palette->entries[hash]);
+    /* Calculate hash code */
+    int hash = ((color & 0xFFF000) >> 12) ^ (color & 0xFFF);
 
-                /* If we've found a free space, use it */
-                if (entry->index == 0) {
+    guac_palette_entry* entry;
 
-                    png_color* c;
+    /* Search for open palette entry */
+    for (;;) {
 
-                    /* Stop if already at capacity */
-                    if (palette->size == 256) {
-                        guac_palette_free(palette);
-                        return NULL;
-                    }
+        entry = &(palette->entries[hash]);
 
-                    /* Store in palette */
-                    c = &(palette->colors[palette->size]);
-                    c->blue  = (color      ) & 0xFF;
-                    c->green = (color >> 8 ) & 0xFF;
-                    c->red   = (color >> 16) & 0xFF;
+        /* If we've found a free space, use it */
+        if (entry->index == 0) {
 
-                    /* Add color to map */
-                    entry->index = ++palette->size;
-                    entry->color = color;
+            png_color* c;
 
-                    break;
+            /* Stop if already at capacity */
+            if (palette->size == GUAC_PALETTE_MAX_COLORS)
+                return -1;
 
-                }
+            /* Store in palette */
+            c = &(palette->colors[palette->size]);
+            c->blue  = (color      ) & 0xFF;
+            c->green = (color >> 8 ) & 0xFF;
+            c->red   = (color >> 16) & 0xFF;
 
-                /* Otherwise, if already stored here, done */
-                if (entry->color == color)
-                    break;
+            /* Add color to map */
+            palette->buckets[palette->size] = hash;
+            entry->index = ++palette->size;
+            entry->color = color;
 
-                /* Otherwise, collision. Move on to another bucket */
-                hash = (hash+1) & 0xFFF;
+            return entry->index - 1;
 
-            }
         }
 
-        /* Advance to next data row */
-        data += stride;
+        /* Otherwise, if already stored here, done */
+        if (entry->color == color)
+            return entry->index - 1;
 
-    }
+        /* Otherwise, collision. Move on to another bucket */
+        hash = (hash+1) & (GUAC_PALETTE_BUCKETS - 1);
 
-    return palette;
+    }
 
 }
 
-int guac_palette_find(guac_palette* palette, int color) {
+int guac_palette_build(guac_palette* palette, const unsigned char* data,
+        int width, int height, int stride, int alpha, unsigned char* indexes) {
 
-    /* Calculate hash code */
-    int hash = ((color & 0xFFF000) >> 12) ^ (color & 0xFFF);
+    int x, y;
 
-    guac_palette_entry* entry;
+    /* Pixels which must be opaque are compared including their alpha */
+    uint32_t mask = alpha ? 0xFFFFFFFF : 0xFFFFFF;
 
-    /* Search for palette entry */
-    for (;;) {
-        
-        entry = &(palette->entries[hash]);
+    for (y=0; y<height; y++) {
 
-        /* If we've found a free space, color not stored. */
-        if (entry->index == 0)
-            return -1;
+        const uint32_t* row = (const uint32_t*) data;
 
-        /* Otherwise, if color indeed stored here, done */
-        if (entry->color == color)
-            return entry->index - 1;
+        /* Always look up first pixel of each row */
+        uint32_t last_pixel = ~(row[0] & mask);
+        int index = 0;
 
-        /* Otherwise, collision. Move on to another bucket */
-        hash = (hash+1) & 0xFFF;
+        for (x=0; x<width; x++) {
+
+            uint32_t pixel = row[x] & mask;
+
+            /* Look up color only if different from previous pixel, as runs
+             * of identical pixels are common */
+            if (pixel != last_pixel) {
+
+                /* Colors which are not fully opaque cannot be stored */
+                if (alpha && (pixel & 0xFF000000) != 0xFF000000)
+                    return 1;
+
+                index = guac_palette_add(palette, pixel & 0xFFFFFF);
+                if (index < 0)
+                    return 1;
+
+                last_pixel = pixel;
+
+            }
+
+            *(indexes++) = index;
+
+        }
+
+        /* Advance to next data row */
+        data += stride;
 
     }
 
+    return 0;
+
+}
+
+void guac_palette_reset(guac_palette* palette) {
+
+    int i;
+
+    /* Clear only those buckets which are in use */
+    for (i = 0; i < palette->size; i++)
+        palette->entries[palette->buckets[i]].index = 0;
+
+    palette->size = 0;
+
 }
 
 void guac_palette_free(guac_palette* palette) {
@@ -17,13 +17,21 @@
  * under the License.
  */
 
-
 #ifndef __GUAC_PALETTE_H
 #define __GUAC_PALETTE_H
 
-#include <cairo/cairo.h>
 #include <png.h>
 
+/**
+ * The number of hash buckets within each guac_palette.
+ */
+#define GUAC_PALETTE_BUCKETS 0x1000
+
+/**
+ * The maximum number of colors which may be stored within a guac_palette.
+ */
+#define GUAC_PALETTE_MAX_COLORS 256
+
 typedef struct guac_palette_entry {
 
     int index;
@@ -33,14 +41,84 @@ typedef struct guac_palette_entry {
 
 typedef struct guac_palette {
 
-    guac_palette_entry entries[0x1000];
-    png_color colors[256];
+    guac_palette_entry entries[GUAC_PALETTE_BUCKETS];
+    png_color colors[GUAC_PALETTE_MAX_COLORS];
     int size;
 
+    /**
+     * The hash bucket of the entry corresponding to each color, such that the
+     * palette may be reset without clearing every bucket.
+     */
+    int buckets[GUAC_PALETTE_MAX_COLORS];
+
 } guac_palette;
 
-guac_palette* guac_palette_alloc(cairo_surface_t* surface);
-int guac_palette_find(guac_palette* palette, int color);
+/**
+ * Allocates a new, empty palette. The palette must eventually be freed with
+ * guac_palette_free().
+ *
+ * @return
+ *     A newly-allocated, empty palette.
+ */
+guac_palette* guac_palette_alloc();
+
+/**
+ * Builds the given palette from the given 32-bit pixel data, storing the
+ * palette index of each pixel within the given index buffer. The palette and
+ * the index of every pixel are determined in a single pass over the image
+ * data. The palette must be empty, as returned by guac_palette_alloc() or
+ * guac_palette_reset().
+ *
+ * @param palette
+ *     The empty palette to build.
+ *
+ * @param data
+ *     The pixel data to analyze, with each pixel stored as a 32-bit value in
+ *     native byte order, as in Cairo's CAIRO_FORMAT_RGB24 and
+ *     CAIRO_FORMAT_ARGB32.
+ *
+ * @param width
+ *     The width of the image, in pixels.
+ *
+ * @param height
+ *     The height of the image, in pixels.
+ *
+ * @param stride
+ *     The number of bytes between the start of each row of pixel data.
+ *
+ * @param alpha
+ *     Non-zero if the alpha channel of each pixel is meaningful, in which
+ *     case a palette can be built only if every pixel is fully opaque, zero if
+ *     the alpha channel should be ignored.
+ *
+ * @param indexes
+ *     A buffer of at least width * height bytes which will receive the
+ *     palette index of each pixel, row by row.
+ *
+ * @return
+ *     Zero if the palette was built successfully, non-zero if the image
+ *     contains more than GUAC_PALETTE_MAX_COLORS colors or, if the alpha
+ *     channel is meaningful, any pixels which are not fully opaque.
+ */
+int guac_palette_build(guac_palette* palette, const unsigned char* data,
+        int width, int height, int stride, int alpha, unsigned char* indexes);
+
+/**
+ * Removes all colors from the given palette, such that it may be built again
+ * with guac_palette_build(). Only those buckets actually used by the palette
+ * are cleared.
+ *
+ * @param palette
+ *     The palette to reset.
+ */
+void guac_palette_reset(guac_palette* palette);
+
+/**
+ * Frees the given palette.
+ *
+ * @param palette
+ *     The palette to free.
+ */
 void guac_palette_free(guac_palette* palette);
 
 #endif
@@ -293,6 +293,82 @@ int guac_parser_length(guac_parser* parser) {
 
 }
 
+int guac_parser_buffered(guac_parser* parser) {
+
+    char* current = parser->__instructionbuf_unparsed_start;
+    char* end     = parser->__instructionbuf_unparsed_end;
+    int elementc  = 0;
+
+    /* Only whole instructions can be inspected, not the remainder of an
+     * instruction which has been partially parsed */
+    if (parser->state != GUAC_PARSE_COMPLETE
+            && (parser->state != GUAC_PARSE_LENGTH
+                || parser->__elementc != 0
+                || parser->__element_length != 0))
+        return 0;
+
+    while (elementc < GUAC_INSTRUCTION_MAX_ELEMENTS) {
+
+        int element_length = 0;
+
+        /* Scan element length */
+        for (;;) {
+
+            if (current == end)
+                return 0;
+
+            char c = *(current++);
+
+            /* Stop at period, failing if not a valid length */
+            if (c == '.')
+                break;
+
+            if (c < '0' || c > '9')
+                return 0;
+
+            element_length = element_length*10 + c - '0';
+            if (element_length > GUAC_INSTRUCTION_MAX_LENGTH)
+                return 0;
+
+        }
+
+        /* Skip element content, one whole character at a time */
+        while (element_length > 0) {
+
+            if (current == end)
+                return 0;
+
+            int char_length = guac_utf8_charsize((unsigned char) *current);
+            if (char_length > end - current)
+                return 0;
+
+            current += char_length;
+            element_length--;
+
+        }
+
+        /* Verify terminator is present */
+        if (current == end)
+            return 0;
+
+        char terminator = *(current++);
+        elementc++;
+
+        /* Semicolon terminates the instruction */
+        if (terminator == ';')
+            return 1;
+
+        /* Anything other than a comma is malformed */
+        if (terminator != ',')
+            return 0;
+
+    }
+
+    /* Too many elements */
+    return 0;
+
+}
+
 int guac_parser_shift(guac_parser* parser, void* buffer, int length) {
 
     char* copy_end   = parser->__instructionbuf_unparsed_end;
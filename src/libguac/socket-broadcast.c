@@ -20,9 +20,12 @@
 #include "config.h"
 
 #include "guacamole/client.h"
+#include "guacamole/congestion.h"
 #include "guacamole/error.h"
 #include "guacamole/socket.h"
 #include "guacamole/user.h"
+#include "socket-broadcast.h"
+#include "user-queue.h"
 
 #include <pthread.h>
 #include <stdlib.h>
@@ -47,6 +50,85 @@ typedef struct guac_socket_broadcast_data {
 
 } guac_socket_broadcast_data;
 
+/**
+ * Filter restricting the users which receive data written by a particular
+ * thread to any broadcast socket.
+ */
+typedef struct guac_socket_broadcast_filter {
+
+    /**
+     * The filter function to invoke for each user, or NULL if all users
+     * should receive data.
+     */
+    guac_user_filter* filter;
+
+    /**
+     * Arbitrary data to pass to the filter function.
+     */
+    void* data;
+
+} guac_socket_broadcast_filter;
+
+/**
+ * Key used to store the guac_socket_broadcast_filter of each thread.
+ */
+static pthread_key_t __guac_socket_broadcast_filter_key;
+
+/**
+ * Guard ensuring __guac_socket_broadcast_filter_key is created only once.
+ */
+static pthread_once_t __guac_socket_broadcast_filter_key_init =
+    PTHREAD_ONCE_INIT;
+
+/**
+ * Creates the key used to store the guac_socket_broadcast_filter of each
+ * thread, automatically freeing any allocated filter on thread exit.
+ */
+static void __guac_socket_broadcast_alloc_filter_key() {
+    pthread_key_create(&__guac_socket_broadcast_filter_key, free);
+}
+
+/**
+ * Returns the filter currently in effect for the calling thread.
+ *
+ * @return
+ *     The guac_socket_broadcast_filter of the calling thread, or NULL if no
+ *     filter is in effect.
+ */
+static guac_socket_broadcast_filter* __guac_socket_broadcast_get_filter() {
+
+    pthread_once(&__guac_socket_broadcast_filter_key_init,
+            __guac_socket_broadcast_alloc_filter_key);
+
+    guac_socket_broadcast_filter* filter = (guac_socket_broadcast_filter*)
+        pthread_getspecific(__guac_socket_broadcast_filter_key);
+
+    /* Threads which never set a filter, or which removed their filter, write
+     * to all users */
+    if (filter == NULL || filter->filter == NULL)
+        return NULL;
+
+    return filter;
+
+}
+
+/**
+ * Returns whether the given user should receive data under the given filter.
+ *
+ * @param filter
+ *     The filter in effect, or NULL if all users should receive data.
+ *
+ * @param user
+ *     The user to test.
+ *
+ * @return
+ *     Non-zero if the given user should receive data, zero otherwise.
+ */
+static int __guac_socket_broadcast_accepts(
+        guac_socket_broadcast_filter* filter, guac_user* user) {
+    return filter == NULL || filter->filter(user, filter->data);
+}
+
 /**
  * Single chunk of data, to be broadcast to all users.
  */
@@ -62,6 +144,12 @@ typedef struct __write_chunk {
      */
     size_t length;
 
+    /**
+     * The filter in effect for the writing thread, or NULL if all users
+     * should receive the chunk.
+     */
+    guac_socket_broadcast_filter* filter;
+
 } __write_chunk;
 
 /**
@@ -92,8 +180,10 @@ static ssize_t __guac_socket_broadcast_read_handler(guac_socket* socket,
 
 /**
  * Callback invoked by guac_client_foreach_user() which write a given chunk of
- * data to that user's socket. If the write attempt fails, the user is
- * signalled to stop with guac_user_stop().
+ * data to that user's socket. If the user has an output queue, the chunk is
+ * appended to that queue and written later by the user's writer thread.
+ * Otherwise, the chunk is written immediately, and the user is signalled to
+ * stop with guac_user_stop() if the write attempt fails.
  *
  * @param user
  *     The user that the chunk of data should be written to.
@@ -108,6 +198,20 @@ static void* __write_chunk_callback(guac_user* user, void* data) {
 
     __write_chunk* chunk = (__write_chunk*) data;
 
+    /* Skip users excluded by the writing thread */
+    if (!__guac_socket_broadcast_accepts(chunk->filter, user))
+        return NULL;
+
+    /* Account for data sent when estimating bandwidth */
+    guac_congestion_sent(user->congestion, chunk->length);
+
+    /* Defer write to user's writer thread, if possible */
+    if (user->__output_queue != NULL) {
+        guac_user_queue_write(user->__output_queue, chunk->buffer,
+                chunk->length);
+        return NULL;
+    }
+
     /* Attempt write, disconnect on failure */
     if (guac_socket_write(user->socket, chunk->buffer, chunk->length))
         guac_user_stop(user);
@@ -145,6 +249,7 @@ static ssize_t __guac_socket_broadcast_write_handler(guac_socket* socket,
     __write_chunk chunk;
     chunk.buffer = buf;
     chunk.length = count;
+    chunk.filter = __guac_socket_broadcast_get_filter();
 
     /* Broadcast chunk to all users */
     guac_client_foreach_user(data->client, __write_chunk_callback, &chunk);
@@ -155,21 +260,34 @@ static ssize_t __guac_socket_broadcast_write_handler(guac_socket* socket,
 
 /**
  * Callback which is invoked by guac_client_foreach_user() to flush all
- * pending data on the given user's socket. If an error occurs while flushing
- * a user's socket, that user is signalled to stop with guac_user_stop().
+ * pending data on the given user's socket. If the user has an output queue,
+ * its writer thread is instead signalled to flush once all queued data has
+ * been written. If an error occurs while flushing a user's socket, that user
+ * is signalled to stop with guac_user_stop().
  *
  * @param user
  *     The user whose socket should be flushed.
  *
  * @param data
- *     Arbitrary data passed to guac_client_foreach_user(). This is not needed
- *     by this callback, and should be left as NULL.
+ *     The guac_socket_broadcast_filter in effect for the writing thread, or
+ *     NULL if all users are to be affected.
  *
  * @return
  *     Always NULL.
  */
 static void* __flush_callback(guac_user* user, void* data) {
 
+    /* Skip users excluded by the writing thread */
+    if (!__guac_socket_broadcast_accepts(
+                (guac_socket_broadcast_filter*) data, user))
+        return NULL;
+
+    /* Defer flush to user's writer thread, if possible */
+    if (user->__output_queue != NULL) {
+        guac_user_queue_flush(user->__output_queue);
+        return NULL;
+    }
+
     /* Attempt flush, disconnect on failure */
     if (guac_socket_flush(user->socket))
         guac_user_stop(user);
@@ -196,7 +314,8 @@ static ssize_t __guac_socket_broadcast_flush_handler(guac_socket* socket) {
         (guac_socket_broadcast_data*) socket->data;
 
     /* Flush all users */
-    guac_client_foreach_user(data->client, __flush_callback, NULL);
+    guac_client_foreach_user(data->client, __flush_callback,
+            __guac_socket_broadcast_get_filter());
 
     return 0;
 
@@ -205,20 +324,32 @@ static ssize_t __guac_socket_broadcast_flush_handler(guac_socket* socket) {
 /**
  * Callback which is invoked by guac_client_foreach_user() to lock the given
  * user's socket in preparation for the beginning of a Guacamole protocol
- * instruction.
+ * instruction. If the user has an output queue, the socket is not locked, and
+ * the queue is instead notified of the beginning of the instruction.
  *
  * @param user
  *     The user whose socket should be locked.
  *
  * @param data
- *     Arbitrary data passed to guac_client_foreach_user(). This is not needed
- *     by this callback, and should be left as NULL.
+ *     The guac_socket_broadcast_filter in effect for the writing thread, or
+ *     NULL if all users are to be affected.
  *
  * @return
  *     Always NULL.
  */
 static void* __lock_callback(guac_user* user, void* data) {
 
+    /* Skip users excluded by the writing thread */
+    if (!__guac_socket_broadcast_accepts(
+                (guac_socket_broadcast_filter*) data, user))
+        return NULL;
+
+    /* Queued data is written in whole instructions by the writer thread */
+    if (user->__output_queue != NULL) {
+        guac_user_queue_begin(user->__output_queue);
+        return NULL;
+    }
+
     /* Lock socket */
     guac_socket_instruction_begin(user->socket);
 
@@ -244,26 +375,40 @@ static void __guac_socket_broadcast_lock_handler(guac_socket* socket) {
     pthread_mutex_lock(&(data->socket_lock));
 
     /* Lock sockets of all users */
-    guac_client_foreach_user(data->client, __lock_callback, NULL);
+    guac_client_foreach_user(data->client, __lock_callback,
+            __guac_socket_broadcast_get_filter());
 
 }
 
 /**
  * Callback which is invoked by guac_client_foreach_user() to unlock the given
- * user's socket at the end of a Guacamole protocol instruction.
+ * user's socket at the end of a Guacamole protocol instruction. If the user
+ * has an output queue, the instruction is instead committed to that queue,
+ * making it available to the user's writer thread.
  *
  * @param user
  *     The user whose socket should be unlocked.
  *
  * @param data
- *     Arbitrary data passed to guac_client_foreach_user(). This is not needed
- *     by this callback, and should be left as NULL.
+ *     The guac_socket_broadcast_filter in effect for the writing thread, or
+ *     NULL if all users are to be affected.
  *
  * @return
  *     Always NULL.
  */
 static void* __unlock_callback(guac_user* user, void* data) {
 
+    /* Skip users excluded by the writing thread */
+    if (!__guac_socket_broadcast_accepts(
+                (guac_socket_broadcast_filter*) data, user))
+        return NULL;
+
+    /* Release completed instruction to writer thread */
+    if (user->__output_queue != NULL) {
+        guac_user_queue_commit(user->__output_queue);
+        return NULL;
+    }
+
     /* Unlock socket */
     guac_socket_instruction_end(user->socket);
 
@@ -285,7 +430,8 @@ static void __guac_socket_broadcast_unlock_handler(guac_socket* socket) {
         (guac_socket_broadcast_data*) socket->data;
 
     /* Unlock sockets of all users */
-    guac_client_foreach_user(data->client, __unlock_callback, NULL);
+    guac_client_foreach_user(data->client, __unlock_callback,
+            __guac_socket_broadcast_get_filter());
 
     /* Relinquish exclusive access to socket */
     pthread_mutex_unlock(&(data->socket_lock));
@@ -375,3 +521,34 @@ guac_socket* guac_socket_broadcast(guac_client* client) {
 
 }
 
+
+void guac_socket_broadcast_set_filter(guac_user_filter* filter, void* data) {
+
+    pthread_once(&__guac_socket_broadcast_filter_key_init,
+            __guac_socket_broadcast_alloc_filter_key);
+
+    guac_socket_broadcast_filter* current = (guac_socket_broadcast_filter*)
+        pthread_getspecific(__guac_socket_broadcast_filter_key);
+
+    /* Allocate thread-local filter if not already allocated */
+    if (current == NULL) {
+
+        /* Nothing to remove if no filter was ever set */
+        if (filter == NULL)
+            return;
+
+        current = malloc(sizeof(guac_socket_broadcast_filter));
+        pthread_setspecific(__guac_socket_broadcast_filter_key, current);
+
+    }
+
+    current->filter = filter;
+    current->data = data;
+
+}
+
+int guac_socket_broadcast_accepts(guac_user* user) {
+    return __guac_socket_broadcast_accepts(
+            __guac_socket_broadcast_get_filter(), user);
+}
+
@@ -0,0 +1,44 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUAC_SOCKET_BROADCAST_H
+#define GUAC_SOCKET_BROADCAST_H
+
+#include "config.h"
+
+#include "guacamole/user-types.h"
+
+/**
+ * Returns whether data written by the calling thread should be received by
+ * the given user, according to the filter most recently set by that thread
+ * with guac_socket_broadcast_set_filter(). If no filter is in effect, all
+ * data is received by everything.
+ *
+ * @param user
+ *     The user to test, or NULL to test whether the data should be received
+ *     by something other than a user, such as the secondary socket of a
+ *     socket created with guac_socket_tee().
+ *
+ * @return
+ *     Non-zero if the data should be received, zero otherwise.
+ */
+int guac_socket_broadcast_accepts(guac_user* user);
+
+#endif
+
@@ -19,6 +19,7 @@
 
 #include "config.h"
 
+#include "base64.h"
 #include "guacamole/error.h"
 #include "guacamole/socket.h"
 #include "wait-fd.h"
@@ -33,6 +34,8 @@
 
 #ifdef ENABLE_WINSOCK
 #include <winsock2.h>
+#else
+#include <sys/socket.h>
 #endif
 
 /**
@@ -323,6 +326,79 @@ static ssize_t guac_socket_fd_write_handler(guac_socket* socket,
 
 }
 
+/**
+ * Base64-encodes the provided data directly into the internal buffer of the
+ * given socket, flushing the internal buffer as necessary. The actual write
+ * attempt will occur only upon flush, or when the internal buffer is full.
+ *
+ * @param socket
+ *     The guac_socket being written to.
+ *
+ * @param buf
+ *     The arbitrary buffer containing the data to be encoded and written.
+ *
+ * @param count
+ *     The number of bytes contained within the buffer, which must be a
+ *     multiple of 3.
+ *
+ * @return
+ *     The number of bytes of unencoded data written, or -1 if an error
+ *     occurs.
+ */
+static ssize_t guac_socket_fd_write_base64_handler(guac_socket* socket,
+        const void* buf, size_t count) {
+
+    /* Only complete groups can be encoded without padding */
+    count -= count % 3;
+
+    size_t original_count = count;
+    const unsigned char* current = buf;
+    guac_socket_fd_data* data = (guac_socket_fd_data*) socket->data;
+
+    /* Acquire exclusive access to buffer */
+    pthread_mutex_lock(&(data->buffer_lock));
+
+    /* Encode into buffer, flush if necessary */
+    while (count > 0) {
+
+        /* Calculate number of complete groups which fit within buffer */
+        size_t chunk_size = (sizeof(data->out_buf) - data->written) / 4 * 3;
+
+        /* If no space left in buffer, flush and retry */
+        if (chunk_size == 0) {
+
+            /* Abort if error occurs during flush */
+            if (guac_socket_fd_flush(socket)) {
+                pthread_mutex_unlock(&(data->buffer_lock));
+                return -1;
+            }
+
+            /* Retry buffer append */
+            continue;
+
+        }
+
+        if (chunk_size > count)
+            chunk_size = count;
+
+        /* Update output buffer */
+        chunk_size = guac_base64_encode(current, chunk_size,
+                data->out_buf + data->written);
+        data->written += GUAC_BASE64_ENCODED_SIZE(chunk_size);
+
+        /* Update provided buffer */
+        current += chunk_size;
+        count   -= chunk_size;
+
+    }
+
+    /* Relinquish exclusive access to buffer */
+    pthread_mutex_unlock(&(data->buffer_lock));
+
+    return original_count;
+
+}
+
 /**
  * Waits for data on the underlying file desriptor of the given socket to
  * become available such that the next read operation will not block.
@@ -360,6 +436,26 @@ static int guac_socket_fd_select_handler(guac_socket* socket,
 
 }
 
+/**
+ * Shuts down the file descriptor associated with the given socket, causing
+ * any blocked or future read or write to fail. If the file descriptor is not
+ * a network socket, this has no effect.
+ *
+ * @param socket
+ *     The guac_socket to shut down.
+ */
+static void guac_socket_fd_shutdown_handler(guac_socket* socket) {
+
+    guac_socket_fd_data* data = (guac_socket_fd_data*) socket->data;
+
+#ifdef ENABLE_WINSOCK
+    shutdown(data->fd, SD_BOTH);
+#else
+    shutdown(data->fd, SHUT_RDWR);
+#endif
+
+}
+
 /**
  * Frees all implementation-specific data associated with the given socket, but
  * not the socket object itself.
@@ -445,6 +541,8 @@ guac_socket* guac_socket_open(int fd) {
     socket->unlock_handler = guac_socket_fd_unlock_handler;
     socket->flush_handler  = guac_socket_fd_flush_handler;
     socket->free_handler   = guac_socket_fd_free_handler;
+    socket->shutdown_handler = guac_socket_fd_shutdown_handler;
+    socket->__write_base64_handler = guac_socket_fd_write_base64_handler;
 
     return socket;
 
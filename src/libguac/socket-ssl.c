@@ -25,6 +25,7 @@
 #include "wait-fd.h"
 
 #include <stdlib.h>
+#include <sys/socket.h>
 
 #include <openssl/ssl.h>
 
@@ -86,6 +87,14 @@ static int __guac_socket_ssl_select_handler(guac_socket* socket, int usec_timeou
 
 }
 
+static void __guac_socket_ssl_shutdown_handler(guac_socket* socket) {
+
+    /* Abort any pending read or write of the underlying connection */
+    guac_socket_ssl_data* data = (guac_socket_ssl_data*) socket->data;
+    shutdown(data->fd, SHUT_RDWR);
+
+}
+
 static int __guac_socket_ssl_free_handler(guac_socket* socket) {
 
     /* Shutdown SSL */
@@ -137,6 +146,7 @@ guac_socket* guac_socket_open_secure(SSL_CTX* context, int fd) {
     socket->write_handler  = __guac_socket_ssl_write_handler;
     socket->select_handler = __guac_socket_ssl_select_handler;
     socket->free_handler   = __guac_socket_ssl_free_handler;
+    socket->shutdown_handler = __guac_socket_ssl_shutdown_handler;
 
     return socket;
 
@@ -20,6 +20,7 @@
 #include "config.h"
 
 #include "guacamole/socket.h"
+#include "socket-broadcast.h"
 
 #include <stdlib.h>
 
@@ -89,8 +90,10 @@ static ssize_t __guac_socket_tee_write_handler(guac_socket* socket,
 
     guac_socket_tee_data* data = (guac_socket_tee_data*) socket->data;
 
-    /* Write to secondary socket (ignoring result) */
-    guac_socket_write(data->secondary, buf, count);
+    /* Write to secondary socket (ignoring result), unless the data has been
+     * restricted to particular users */
+    if (guac_socket_broadcast_accepts(NULL))
+        guac_socket_write(data->secondary, buf, count);
 
     /* Delegate write to wrapped socket */
     if (guac_socket_write(data->primary, buf, count))
@@ -356,6 +356,20 @@ static int guac_socket_wsa_select_handler(guac_socket* socket,
 
 }
 
+/**
+ * Shuts down the Windows socket associated with the given socket, causing any
+ * blocked or future read or write to fail.
+ *
+ * @param socket
+ *     The guac_socket to shut down.
+ */
+static void guac_socket_wsa_shutdown_handler(guac_socket* socket) {
+
+    guac_socket_wsa_data* data = (guac_socket_wsa_data*) socket->data;
+    shutdown(data->sock, SD_BOTH);
+
+}
+
 /**
  * Frees all implementation-specific data associated with the given socket, but
  * not the socket object itself.
@@ -441,6 +455,7 @@ guac_socket* guac_socket_open_wsa(SOCKET sock) {
     socket->unlock_handler = guac_socket_wsa_unlock_handler;
     socket->flush_handler  = guac_socket_wsa_flush_handler;
     socket->free_handler   = guac_socket_wsa_free_handler;
+    socket->shutdown_handler = guac_socket_wsa_shutdown_handler;
 
     return socket;
 
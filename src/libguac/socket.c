@@ -19,6 +19,7 @@
 
 #include "config.h"
 
+#include "base64.h"
 #include "guacamole/error.h"
 #include "guacamole/protocol.h"
 #include "guacamole/socket.h"
@@ -166,6 +167,8 @@ guac_socket* guac_socket_alloc() {
     socket->flush_handler  = NULL;
     socket->lock_handler   = NULL;
     socket->unlock_handler = NULL;
+    socket->__write_base64_handler = NULL;
+    socket->shutdown_handler = NULL;
 
     return socket;
 
@@ -330,6 +333,48 @@ ssize_t guac_socket_write_base64(guac_socket* socket, const void* buf, size_t co
     const unsigned char* char_buf = (const unsigned char*) buf;
     const unsigned char* end = char_buf + count;
 
+    /* Complete any partial triplet from a previous write */
+    while (socket->__ready > 0 && char_buf < end) {
+
+        retval = __guac_socket_write_base64_byte(socket, *(char_buf++));
+        if (retval < 0)
+            return retval;
+
+    }
+
+    /* Encode all complete triplets directly into the socket's own output
+     * buffer, if supported */
+    if (socket->__write_base64_handler != NULL && end - char_buf >= 3) {
+
+        size_t length = (end - char_buf) - (end - char_buf) % 3;
+
+        socket->last_write_timestamp = guac_timestamp_current();
+        retval = socket->__write_base64_handler(socket, char_buf, length);
+        if (retval < 0)
+            return retval;
+
+        char_buf += retval;
+
+    }
+
+    /* Otherwise, encode and write all complete triplets in blocks */
+    char output[GUAC_BASE64_ENCODED_SIZE(GUAC_BASE64_BLOCK_SIZE)];
+    while (end - char_buf >= 3) {
+
+        size_t length = end - char_buf;
+        if (length > GUAC_BASE64_BLOCK_SIZE)
+            length = GUAC_BASE64_BLOCK_SIZE;
+
+        length = guac_base64_encode(char_buf, length, output);
+        if (guac_socket_write(socket, output,
+                    GUAC_BASE64_ENCODED_SIZE(length)))
+            return -1;
+
+        char_buf += length;
+
+    }
+
+    /* Buffer any trailing bytes until the triplet is complete */
     while (char_buf < end) {
 
         retval = __guac_socket_write_base64_byte(socket, *(char_buf++));
@@ -353,6 +398,14 @@ ssize_t guac_socket_flush(guac_socket* socket) {
 
 }
 
+void guac_socket_shutdown(guac_socket* socket) {
+
+    /* Call shutdown handler if defined */
+    if (socket->shutdown_handler)
+        socket->shutdown_handler(socket);
+
+}
+
 ssize_t guac_socket_flush_base64(guac_socket* socket) {
 
     int retval;
@@ -0,0 +1,81 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "base64.h"
+
+#include <CUnit/CUnit.h>
+
+#include <string.h>
+
+/**
+ * The maximum number of bytes of unencoded data to test.
+ */
+#define TEST_MAX_LENGTH 64
+
+/**
+ * The maximum offset from the start of the test buffers at which input is
+ * read and output is written, allowing verification of unaligned access.
+ */
+#define TEST_MAX_OFFSET 16
+
+/**
+ * Tests that guac_base64_encode(), which may use a CPU-specific
+ * implementation, produces output byte-for-byte identical to the portable
+ * guac_base64_encode_scalar() for all lengths up to TEST_MAX_LENGTH, and for
+ * input and output buffers at every offset up to TEST_MAX_OFFSET.
+ */
+void test_base64__encode() {
+
+    unsigned char input[TEST_MAX_LENGTH + TEST_MAX_OFFSET];
+    char expected[GUAC_BASE64_ENCODED_SIZE(TEST_MAX_LENGTH) + TEST_MAX_OFFSET];
+    char output[GUAC_BASE64_ENCODED_SIZE(TEST_MAX_LENGTH) + TEST_MAX_OFFSET];
+
+    /* Cover every possible byte value across the input */
+    for (int i = 0; i < sizeof(input); i++)
+        input[i] = (i * 73 + 41) & 0xFF;
+
+    for (int offset = 0; offset < TEST_MAX_OFFSET; offset++) {
+        for (size_t length = 0; length <= TEST_MAX_LENGTH; length++) {
+
+            memset(expected, '#', sizeof(expected));
+            memset(output, '#', sizeof(output));
+
+            size_t expected_encoded = guac_base64_encode_scalar(
+                    input + offset, length, expected + offset);
+            size_t encoded = guac_base64_encode(input + offset, length,
+                    output + offset);
+
+            /* Only complete groups are encoded */
+            CU_ASSERT_EQUAL(expected_encoded, length - length % 3);
+            CU_ASSERT_EQUAL(encoded, expected_encoded);
+
+            /* Output must match exactly, without writing beyond the
+             * encoded data */
+            CU_ASSERT(memcmp(output, expected, sizeof(output)) == 0);
+
+        }
+    }
+
+    /* Verify the reference implementation against known output */
+    memset(output, '#', sizeof(output));
+    CU_ASSERT_EQUAL(guac_base64_encode_scalar((const unsigned char*) "HELLO!",
+                6, output), 6);
+    CU_ASSERT_NSTRING_EQUAL(output, "SEVMTE8h#", 9);
+
+}
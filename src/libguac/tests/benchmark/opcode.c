@@ -0,0 +1,184 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <guacamole/opcode.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * The number of instructions dispatched by each benchmark.
+ */
+#define BENCHMARK_INSTRUCTIONS 20000000
+
+/**
+ * Opcode/value mapping equivalent in layout to the handler maps used by
+ * libguac and its utilities.
+ */
+typedef struct benchmark_mapping {
+
+    /**
+     * The opcode of this mapping.
+     */
+    const char* opcode;
+
+    /**
+     * Arbitrary value standing in for the handler of the opcode.
+     */
+    int value;
+
+} benchmark_mapping;
+
+/**
+ * Mappings for the instructions handled when encoding a recording, in the
+ * same order as the handler map of guacenc.
+ */
+static benchmark_mapping benchmark_mappings[] = {
+    {"blob",     1}, {"img",      2}, {"end",      3},
+    {"mouse",    4}, {"sync",     5}, {"cursor",   6},
+    {"copy",     7}, {"transfer", 8}, {"size",     9},
+    {"rect",    10}, {"cfill",   11}, {"move",    12},
+    {"shade",   13}, {"dispose", 14}, {NULL,       0}
+};
+
+/**
+ * The number of handlers within benchmark_mappings, excluding the terminator.
+ */
+#define BENCHMARK_HANDLERS \
+    ((int) (sizeof(benchmark_mappings) / sizeof(benchmark_mappings[0])) - 1)
+
+/**
+ * Sequence of opcodes resembling the instructions within a typical
+ * recording of a graphical session, including instructions which are not
+ * handled and must be searched for in vain.
+ */
+static const char* benchmark_stream[] = {
+    "img", "blob", "blob", "end", "rect", "cfill", "copy", "mouse",
+    "sync", "img", "blob", "end", "mouse", "mouse", "sync", "nop",
+    "copy", "copy", "img", "blob", "end", "audio", "blob", "blob",
+    "end", "cursor", "size", "sync", "mouse", "key", "dispose", "sync"
+};
+
+/**
+ * The number of opcodes within benchmark_stream.
+ */
+#define BENCHMARK_STREAM_LENGTH \
+    ((int) (sizeof(benchmark_stream) / sizeof(benchmark_stream[0])))
+
+/**
+ * Returns the current value of a monotonic clock, in seconds.
+ *
+ * @return
+ *     The current value of the monotonic clock, in seconds.
+ */
+static double benchmark_now() {
+    struct timespec current;
+    clock_gettime(CLOCK_MONOTONIC, &current);
+    return current.tv_sec + current.tv_nsec / 1000000000.0;
+}
+
+/**
+ * Prints the average time taken to dispatch each instruction.
+ *
+ * @param name
+ *     The human-readable name of the dispatch method being benchmarked.
+ *
+ * @param elapsed
+ *     The total time spent dispatching all instructions, in seconds.
+ *
+ * @param checksum
+ *     The sum of all values dispatched, printed so that the dispatch cannot
+ *     be optimized away.
+ */
+static void benchmark_report(const char* name, double elapsed, long checksum) {
+    printf("    %-20s %8.2f ns/instruction (checksum %ld)\n", name,
+            elapsed * 1000000000.0 / BENCHMARK_INSTRUCTIONS, checksum);
+}
+
+/**
+ * Dispatches instructions by searching the mappings linearly, as each
+ * instruction handler map was previously searched.
+ */
+static void benchmark_linear() {
+
+    long checksum = 0;
+
+    double start = benchmark_now();
+    for (int i = 0; i < BENCHMARK_INSTRUCTIONS; i++) {
+
+        const char* opcode = benchmark_stream[i % BENCHMARK_STREAM_LENGTH];
+
+        benchmark_mapping* current = benchmark_mappings;
+        while (current->opcode != NULL) {
+            if (strcmp(current->opcode, opcode) == 0) {
+                checksum += current->value;
+                break;
+            }
+            current++;
+        }
+
+    }
+
+    benchmark_report("linear search", benchmark_now() - start, checksum);
+
+}
+
+/**
+ * Dispatches instructions using a guac_opcode_map.
+ */
+static void benchmark_opcode_map() {
+
+    long checksum = 0;
+
+    guac_opcode_map* map = guac_opcode_map_alloc(benchmark_mappings,
+            sizeof(benchmark_mapping));
+    if (map == NULL) {
+        printf("    Unable to allocate opcode map.\n");
+        return;
+    }
+
+    double start = benchmark_now();
+    for (int i = 0; i < BENCHMARK_INSTRUCTIONS; i++) {
+
+        const char* opcode = benchmark_stream[i % BENCHMARK_STREAM_LENGTH];
+
+        int index = guac_opcode_map_lookup(map, opcode);
+        if (index != -1)
+            checksum += benchmark_mappings[index].value;
+
+    }
+
+    benchmark_report("guac_opcode_map", benchmark_now() - start, checksum);
+
+    guac_opcode_map_free(map);
+
+}
+
+int main() {
+
+    printf("Opcode dispatch (%d handlers, %d instructions):\n",
+            BENCHMARK_HANDLERS, BENCHMARK_INSTRUCTIONS);
+
+    benchmark_linear();
+    benchmark_opcode_map();
+
+    return 0;
+
+}
@@ -0,0 +1,199 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <CUnit/CUnit.h>
+#include <guacamole/client.h>
+#include <guacamole/protocol.h>
+#include <guacamole/socket.h>
+#include <guacamole/user.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * Opens a new guac_socket which writes to a new, anonymous temporary file,
+ * storing the file descriptor of that file within the given int. The
+ * temporary file is automatically deleted when the file descriptor is
+ * closed.
+ *
+ * @param fd
+ *     Pointer to the int which should receive the file descriptor of the
+ *     temporary file.
+ *
+ * @return
+ *     A new guac_socket which writes to the temporary file.
+ */
+static guac_socket* open_test_socket(int* fd) {
+
+    char path[] = "/tmp/guac-test-broadcast-XXXXXX";
+
+    *fd = mkstemp(path);
+    CU_ASSERT_FATAL(*fd != -1);
+    unlink(path);
+
+    return guac_socket_open(*fd);
+
+}
+
+/**
+ * Verifies that all data written to the file having the given file
+ * descriptor exactly matches the given string.
+ *
+ * @param fd
+ *     The file descriptor of the file to read.
+ *
+ * @param expected
+ *     The data which should have been written to the file.
+ */
+static void assert_written(int fd, const char* expected) {
+
+    char written[1024];
+    int length = strlen(expected);
+
+    CU_ASSERT_EQUAL(lseek(fd, 0, SEEK_END), length);
+
+    ssize_t read_length = pread(fd, written, sizeof(written), 0);
+    CU_ASSERT_EQUAL(read_length, length);
+    CU_ASSERT_NSTRING_EQUAL(written, expected, length);
+
+}
+
+/**
+ * Allocates a new user with a socket that writes to a new temporary file,
+ * joining that user to the given client. The file descriptor of the
+ * temporary file is stored within the given int.
+ */
+static guac_user* join_test_user(guac_client* client, int* fd) {
+
+    guac_user* user = guac_user_alloc();
+    user->socket = open_test_socket(fd);
+    user->client = client;
+
+    CU_ASSERT_EQUAL_FATAL(guac_client_add_user(client, user, 0, NULL), 0);
+    return user;
+
+}
+
+/**
+ * Removes the given user from the given client, freeing the user and its
+ * socket, and closing the underlying temporary file.
+ */
+static void leave_test_user(guac_client* client, guac_user* user) {
+
+    guac_client_remove_user(client, user);
+
+    guac_socket_free(user->socket);
+    guac_user_free(user);
+
+}
+
+/**
+ * Filter which accepts only the user given as its data.
+ */
+static int accept_user(guac_user* user, void* data) {
+    return user == (guac_user*) data;
+}
+
+/**
+ * Filter which accepts only the user given as its data, as well as anything
+ * other than a user, such as a session recording.
+ */
+static int accept_user_and_recording(guac_user* user, void* data) {
+    return user == NULL || user == (guac_user*) data;
+}
+
+/**
+ * Test which verifies that data written to the broadcast socket of a client
+ * while a filter is set reaches only the users accepted by that filter, and
+ * that all users again receive all data once the filter is cleared.
+ */
+void test_client__broadcast_filter() {
+
+    int first_fd;
+    int second_fd;
+
+    guac_client* client = guac_client_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(client);
+
+    guac_user* first = join_test_user(client, &first_fd);
+    guac_user* second = join_test_user(client, &second_fd);
+
+    /* Send only to first user */
+    guac_socket_broadcast_set_filter(accept_user, first);
+    guac_protocol_send_nop(client->socket);
+    guac_socket_flush(client->socket);
+    guac_socket_broadcast_set_filter(NULL, NULL);
+
+    /* Send to all users */
+    guac_protocol_send_sync(client->socket, 1234);
+    guac_socket_flush(client->socket);
+
+    assert_written(first_fd, "3.nop;4.sync,4.1234;");
+    assert_written(second_fd, "4.sync,4.1234;");
+
+    leave_test_user(client, first);
+    leave_test_user(client, second);
+    guac_client_free(client);
+
+}
+
+/**
+ * Test which verifies that data written to the broadcast socket of a client
+ * while a filter is set is duplicated to a session recording (the secondary
+ * socket of a socket created with guac_socket_tee()) only if that filter
+ * accepts a NULL user, while unfiltered data is always recorded.
+ */
+void test_client__broadcast_filter_recording() {
+
+    int user_fd;
+    int recording_fd;
+
+    guac_client* client = guac_client_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(client);
+
+    /* Record all data sent to the client's users */
+    client->socket = guac_socket_tee(client->socket,
+            open_test_socket(&recording_fd));
+
+    guac_user* user = join_test_user(client, &user_fd);
+
+    /* Send only to the user */
+    guac_socket_broadcast_set_filter(accept_user, user);
+    guac_protocol_send_nop(client->socket);
+    guac_socket_flush(client->socket);
+
+    /* Send to the user and the recording */
+    guac_socket_broadcast_set_filter(accept_user_and_recording, user);
+    guac_protocol_send_name(client->socket, "test");
+    guac_socket_flush(client->socket);
+    guac_socket_broadcast_set_filter(NULL, NULL);
+
+    /* Send to everything */
+    guac_protocol_send_sync(client->socket, 1234);
+    guac_socket_flush(client->socket);
+
+    assert_written(user_fd, "3.nop;4.name,4.test;4.sync,4.1234;");
+    assert_written(recording_fd, "4.name,4.test;4.sync,4.1234;");
+
+    leave_test_user(client, user);
+    guac_client_free(client);
+
+}
+
@@ -0,0 +1,527 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "user-queue.h"
+
+#include <CUnit/CUnit.h>
+#include <guacamole/client.h>
+#include <guacamole/protocol.h>
+#include <guacamole/socket.h>
+#include <guacamole/stream.h>
+#include <guacamole/user.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/**
+ * The size of the output queue to use when testing overflow, in bytes. This
+ * is deliberately small enough to be filled by a handful of instructions.
+ */
+#define TEST_QUEUE_SIZE 64
+
+/**
+ * The size of the output queue to use when testing streams, in bytes. This
+ * is large enough to leave room for several "end" instructions within the
+ * space the queue reserves for them.
+ */
+#define TEST_STREAM_QUEUE_SIZE 1024
+
+/**
+ * The size of the output queue to use when no overflow is expected, in bytes.
+ */
+#define TEST_LARGE_QUEUE_SIZE 1048576
+
+/**
+ * The maximum number of instructions to send while waiting for a stalled
+ * user's output queue to overflow.
+ */
+#define TEST_MAX_INSTRUCTIONS 100000
+
+/**
+ * The maximum number of milliseconds to wait for the writer thread of a user
+ * to produce expected output.
+ */
+#define TEST_TIMEOUT 5000
+
+/**
+ * The socket pair connecting the test user (index 0) with the test (index 1).
+ */
+static int test_fds[2];
+
+/**
+ * The number of bytes of filler data written to the user's end of the socket
+ * pair to simulate a stalled connection, which have not yet been read back.
+ */
+static size_t stalled_length;
+
+/**
+ * Buffer receiving all data written to the socket of the test user, excluding
+ * filler data.
+ */
+static char written[65536];
+
+/**
+ * The number of bytes currently stored within the written buffer.
+ */
+static int written_length;
+
+/**
+ * The number of times the test resync handler has been invoked.
+ */
+static volatile int resync_count;
+
+/**
+ * Resync handler for the test client which sends a "name" instruction that
+ * can be recognized within the written data.
+ */
+static int resync_handler(guac_user* user) {
+    resync_count++;
+    return guac_protocol_send_name(user->socket, "resync");
+}
+
+/**
+ * Simulates a stalled connection by filling the kernel buffers of the test
+ * user's end of the socket pair, such that any further write by the user's
+ * writer thread blocks until read_written() is next called. The writer thread
+ * must be idle when this function is invoked.
+ */
+static void stall() {
+
+    char filler[4096];
+    memset(filler, '#', sizeof(filler));
+
+    int flags = fcntl(test_fds[0], F_GETFL);
+    fcntl(test_fds[0], F_SETFL, flags | O_NONBLOCK);
+
+    ssize_t length;
+    while ((length = write(test_fds[0], filler, sizeof(filler))) > 0)
+        stalled_length += length;
+
+    CU_ASSERT_TRUE(errno == EAGAIN || errno == EWOULDBLOCK);
+    fcntl(test_fds[0], F_SETFL, flags);
+
+}
+
+/**
+ * Reads all data currently available from the test's end of the socket pair,
+ * discarding any filler data written by stall() and appending everything
+ * else to the written buffer.
+ */
+static void read_written() {
+
+    char buffer[4096];
+    ssize_t length;
+
+    while ((length = recv(test_fds[1], buffer, sizeof(buffer),
+                    MSG_DONTWAIT)) > 0) {
+
+        char* current = buffer;
+
+        /* Skip filler data */
+        size_t skipped = length;
+        if (skipped > stalled_length)
+            skipped = stalled_length;
+
+        stalled_length -= skipped;
+        current += skipped;
+        length -= skipped;
+
+        if (written_length + length >= sizeof(written))
+            length = sizeof(written) - written_length - 1;
+
+        memcpy(written + written_length, current, length);
+        written_length += length;
+        written[written_length] = '\0';
+
+    }
+
+}
+
+/**
+ * Waits for the written buffer to end with the given string, reading any
+ * data written to the socket of the test user in the meantime.
+ *
+ * @return
+ *     true if the written buffer ends with the given string, false if the
+ *     timeout elapsed.
+ */
+static bool wait_for_suffix(const char* suffix) {
+
+    int length = strlen(suffix);
+    int i;
+
+    for (i = 0; i < TEST_TIMEOUT; i++) {
+
+        read_written();
+        if (written_length >= length
+                && memcmp(written + written_length - length, suffix,
+                    length) == 0)
+            return true;
+
+        usleep(1000);
+
+    }
+
+    return false;
+
+}
+
+/**
+ * Verifies that the written buffer, from the given offset up to the given
+ * length, consists entirely of complete "nop" instructions.
+ */
+static void assert_nops(int offset, int length) {
+
+    CU_ASSERT_EQUAL(length % 6, 0);
+    for (int i = offset; i < offset + length; i += 6)
+        CU_ASSERT_NSTRING_EQUAL(written + i, "3.nop;", 6);
+
+}
+
+/**
+ * Allocates a new user with a socket that writes to the test user's end of a
+ * new socket pair, joining that user to the given client.
+ */
+static guac_user* join_test_user(guac_client* client) {
+
+    CU_ASSERT_EQUAL_FATAL(socketpair(AF_UNIX, SOCK_STREAM, 0, test_fds), 0);
+
+    stalled_length = 0;
+    written_length = 0;
+    written[0] = '\0';
+    resync_count = 0;
+
+    guac_user* user = guac_user_alloc();
+    user->socket = guac_socket_open(test_fds[0]);
+    user->client = client;
+
+    CU_ASSERT_EQUAL_FATAL(guac_client_add_user(client, user, 0, NULL), 0);
+    return user;
+
+}
+
+/**
+ * Removes the given user from the given client, freeing the user and its
+ * socket.
+ */
+static void leave_test_user(guac_client* client, guac_user* user) {
+
+    guac_client_remove_user(client, user);
+
+    guac_socket_free(user->socket);
+    guac_user_free(user);
+    close(test_fds[1]);
+
+}
+
+/**
+ * Sends "nop" instructions to all users of the given client until the given
+ * user's output queue overflows.
+ */
+static void overflow(guac_client* client, guac_user* user) {
+
+    for (int i = 0; i < TEST_MAX_INSTRUCTIONS
+            && user->__output_queue->overflows == 0; i++)
+        guac_protocol_send_nop(client->socket);
+
+    CU_ASSERT_NOT_EQUAL_FATAL(user->__output_queue->overflows, 0);
+
+}
+
+/**
+ * Test which verifies that data written to the broadcast socket of a client
+ * is delivered, in order, to a user through that user's output queue.
+ */
+void test_client__output_queue() {
+
+    guac_client* client = guac_client_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(client);
+
+    client->output_queue_size = TEST_LARGE_QUEUE_SIZE;
+
+    guac_user* user = join_test_user(client);
+    CU_ASSERT_PTR_NOT_NULL(user->__output_queue);
+
+    guac_protocol_send_nop(client->socket);
+    guac_protocol_send_sync(client->socket, 1234);
+    guac_socket_flush(client->socket);
+
+    CU_ASSERT_TRUE(wait_for_suffix("3.nop;4.sync,4.1234;"));
+    CU_ASSERT_EQUAL(written_length, 20);
+    CU_ASSERT_EQUAL(guac_user_get_queue_depth(user), 0);
+
+    leave_test_user(client, user);
+    guac_client_free(client);
+
+}
+
+/**
+ * Test which verifies that output queues are disabled unless explicitly
+ * enabled.
+ */
+void test_client__output_queue_default() {
+
+    guac_client* client = guac_client_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(client);
+
+    guac_user* user = join_test_user(client);
+    CU_ASSERT_PTR_NULL(user->__output_queue);
+
+    leave_test_user(client, user);
+    guac_client_free(client);
+
+}
+
+/**
+ * Test which verifies that a user whose output queue overflows has all
+ * further updates dropped until that user is resynchronized, after which
+ * updates resume.
+ */
+void test_client__output_queue_resync() {
+
+    guac_client* client = guac_client_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(client);
+
+    client->resync_handler = resync_handler;
+    client->output_queue_size = TEST_QUEUE_SIZE;
+    client->output_queue_policy = GUAC_CLIENT_QUEUE_RESYNC;
+
+    guac_user* user = join_test_user(client);
+
+    /* Overflow queue while user's connection is stalled */
+    stall();
+    overflow(client, user);
+    guac_socket_flush(client->socket);
+
+    CU_ASSERT_TRUE(guac_user_get_queue_depth(user) <= TEST_QUEUE_SIZE);
+    CU_ASSERT_TRUE(user->active);
+
+    /* User should be resynchronized once the stall ends */
+    CU_ASSERT_TRUE(wait_for_suffix("4.name,6.resync;"));
+    CU_ASSERT_EQUAL(resync_count, 1);
+
+    /* Updates should resume after resync */
+    guac_protocol_send_sync(client->socket, 1234);
+    guac_socket_flush(client->socket);
+    CU_ASSERT_TRUE(wait_for_suffix("4.name,6.resync;4.sync,4.1234;"));
+
+    /* Only complete instructions queued before the overflow should precede
+     * the resync */
+    assert_nops(0, written_length - 30);
+
+    leave_test_user(client, user);
+    guac_client_free(client);
+
+}
+
+/**
+ * Test which verifies that a user whose output queue overflows in the middle
+ * of a stream still receives the end of that stream, while streams opened
+ * after the overflow are not sent to that user at all, even once the user
+ * has been resynchronized.
+ */
+void test_client__output_queue_streams() {
+
+    guac_client* client = guac_client_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(client);
+
+    client->resync_handler = resync_handler;
+    client->output_queue_size = TEST_STREAM_QUEUE_SIZE;
+    client->output_queue_policy = GUAC_CLIENT_QUEUE_RESYNC;
+
+    guac_user* user = join_test_user(client);
+
+    guac_stream* sent = guac_client_alloc_stream(client);
+    guac_stream* dropped = guac_client_alloc_stream(client);
+    CU_ASSERT_EQUAL_FATAL(sent->index, 1);
+    CU_ASSERT_EQUAL_FATAL(dropped->index, 3);
+
+    /* Open stream before overflow */
+    stall();
+    guac_protocol_send_img(client->socket, sent, GUAC_COMP_OVER,
+            GUAC_DEFAULT_LAYER, "image/png", 0, 0);
+    guac_protocol_send_blob(client->socket, sent, "A", 1);
+
+    overflow(client, user);
+
+    /* Continue first stream, and open another, while overflowed */
+    guac_protocol_send_blob(client->socket, sent, "B", 1);
+    guac_protocol_send_end(client->socket, sent);
+    guac_protocol_send_img(client->socket, dropped, GUAC_COMP_OVER,
+            GUAC_DEFAULT_LAYER, "image/png", 0, 0);
+    guac_protocol_send_blob(client->socket, dropped, "C", 1);
+    guac_socket_flush(client->socket);
+
+    CU_ASSERT_TRUE(wait_for_suffix("3.end,1.1;4.name,6.resync;"));
+
+    /* Finish second stream after resync */
+    guac_protocol_send_blob(client->socket, dropped, "D", 1);
+    guac_protocol_send_end(client->socket, dropped);
+    guac_protocol_send_sync(client->socket, 1234);
+    guac_socket_flush(client->socket);
+
+    CU_ASSERT_TRUE(wait_for_suffix("4.name,6.resync;4.sync,4.1234;"));
+
+    /* Nothing of the second stream may be sent */
+    CU_ASSERT_PTR_NULL(strstr(written, "3.img,1.3,"));
+    CU_ASSERT_PTR_NULL(strstr(written, "4.blob,1.3,"));
+    CU_ASSERT_PTR_NULL(strstr(written, "3.end,1.3;"));
+
+    /* The first stream must be opened and closed exactly once, with only
+     * whole instructions dropped in between */
+    const char* opened = "3.img,1.1,2.14,1.0,9.image/png,1.0,1.0;"
+                         "4.blob,1.1,4.QQ==;";
+    int opened_length = strlen(opened);
+    CU_ASSERT_NSTRING_EQUAL(written, opened, opened_length);
+    assert_nops(opened_length, written_length - opened_length - 40);
+
+    guac_client_free_stream(client, sent);
+    guac_client_free_stream(client, dropped);
+
+    leave_test_user(client, user);
+    guac_client_free(client);
+
+}
+
+/**
+ * Test which verifies that a user whose output queue overflows is
+ * disconnected if the output queue policy of the client requires it.
+ */
+void test_client__output_queue_disconnect() {
+
+    guac_client* client = guac_client_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(client);
+
+    client->resync_handler = resync_handler;
+    client->output_queue_size = TEST_QUEUE_SIZE;
+    client->output_queue_policy = GUAC_CLIENT_QUEUE_DISCONNECT;
+
+    guac_user* user = join_test_user(client);
+
+    /* Overflow queue while user's connection is stalled */
+    stall();
+    overflow(client, user);
+    guac_socket_flush(client->socket);
+
+    CU_ASSERT_FALSE(user->active);
+    CU_ASSERT_EQUAL(resync_count, 0);
+
+    leave_test_user(client, user);
+    guac_client_free(client);
+
+}
+
+/**
+ * Arguments for remove_user_thread().
+ */
+typedef struct remove_user_args {
+
+    /**
+     * The client to remove the user from.
+     */
+    guac_client* client;
+
+    /**
+     * The user to remove.
+     */
+    guac_user* user;
+
+    /**
+     * Set to true once the user has been removed.
+     */
+    volatile bool removed;
+
+} remove_user_args;
+
+/**
+ * Thread which removes a user from a client, as described by the given
+ * remove_user_args.
+ */
+static void* remove_user_thread(void* data) {
+
+    remove_user_args* args = (remove_user_args*) data;
+
+    guac_client_remove_user(args->client, args->user);
+    args->removed = true;
+
+    return NULL;
+
+}
+
+/**
+ * Test which verifies that a user can be removed while that user's writer
+ * thread is blocked on a stalled connection.
+ */
+void test_client__output_queue_free_stalled() {
+
+    /* Writes to the shut down socket must fail rather than terminate the
+     * test */
+    signal(SIGPIPE, SIG_IGN);
+
+    guac_client* client = guac_client_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(client);
+
+    client->output_queue_size = TEST_LARGE_QUEUE_SIZE;
+
+    guac_user* user = join_test_user(client);
+
+    /* Queue more than the socket itself can buffer while stalled */
+    stall();
+    for (int i = 0; i < GUAC_SOCKET_OUTPUT_BUFFER_SIZE; i++)
+        guac_protocol_send_nop(client->socket);
+    guac_socket_flush(client->socket);
+
+    /* Wait for writer thread to block */
+    size_t depth;
+    do {
+        depth = guac_user_get_queue_depth(user);
+        usleep(50000);
+    } while (guac_user_get_queue_depth(user) != depth);
+
+    CU_ASSERT_NOT_EQUAL(depth, 0);
+
+    remove_user_args args = {
+        .client = client,
+        .user = user,
+        .removed = false
+    };
+
+    /* Removal must complete without the stall ending */
+    pthread_t thread;
+    CU_ASSERT_EQUAL_FATAL(pthread_create(&thread, NULL, remove_user_thread,
+                &args), 0);
+
+    for (int i = 0; i < TEST_TIMEOUT && !args.removed; i++)
+        usleep(1000);
+
+    CU_ASSERT_TRUE_FATAL(args.removed);
+    pthread_join(thread, NULL);
+
+    guac_socket_free(user->socket);
+    guac_user_free(user);
+    close(test_fds[1]);
+    guac_client_free(client);
+
+}
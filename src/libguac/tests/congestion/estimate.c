@@ -0,0 +1,215 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <CUnit/CUnit.h>
+#include <guacamole/congestion.h>
+#include <guacamole/timestamp.h>
+
+/**
+ * The time at which each simulated connection begins, in milliseconds.
+ */
+#define START_TIME 1000000
+
+/**
+ * The maximum number of frames sent within any simulated connection.
+ */
+#define MAX_FRAMES 256
+
+/**
+ * Simulates sending frames of a fixed size at a fixed interval over a link
+ * with the given bandwidth and base round-trip time, acknowledging each frame
+ * once it has been fully delivered and the round trip has completed. The
+ * simulation ends immediately after the last frame is sent.
+ *
+ * @param congestion
+ *     The guac_congestion to update as frames are sent and acknowledged.
+ *
+ * @param frames
+ *     The number of frames to send. This must not exceed MAX_FRAMES.
+ *
+ * @param frame_size
+ *     The size of each frame, in bytes.
+ *
+ * @param interval
+ *     The amount of time between the start of each frame, in milliseconds.
+ *
+ * @param bandwidth
+ *     The bandwidth of the simulated link, in bytes per millisecond.
+ *
+ * @param base_rtt
+ *     The round-trip time of the simulated link when no data is queued, in
+ *     milliseconds.
+ *
+ * @return
+ *     The time at which the simulation ended.
+ */
+static guac_timestamp simulate(guac_congestion* congestion, int frames, int frame_size,
+        int interval, int bandwidth, int base_rtt) {
+
+    guac_timestamp acks[MAX_FRAMES];
+    guac_timestamp link_free = START_TIME;
+
+    int sent = 0;
+    int acked = 0;
+
+    guac_timestamp end = START_TIME + (guac_timestamp) frames * interval;
+    for (guac_timestamp now = START_TIME; now < end; now++) {
+
+        /* Deliver any acknowledgements which have arrived */
+        while (acked < sent && acks[acked] <= now) {
+            guac_congestion_frame_acked(congestion,
+                    START_TIME + (guac_timestamp) acked * interval, now, 0);
+            acked++;
+        }
+
+        /* Send frames at the requested interval */
+        if ((now - START_TIME) % interval == 0) {
+
+            guac_congestion_sent(congestion, frame_size);
+            guac_congestion_frame_sent(congestion, now);
+
+            /* Frames are delivered one after another over the link */
+            if (link_free < now)
+                link_free = now;
+            link_free += frame_size / bandwidth;
+
+            acks[sent++] = link_free + base_rtt;
+
+        }
+
+    }
+
+    return end;
+
+}
+
+/**
+ * Verifies that guac_congestion does not recommend any reduction in quality
+ * or frame rate for a user whose link easily handles the data sent.
+ */
+void test_congestion__uncongested() {
+
+    guac_congestion* congestion = guac_congestion_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(congestion);
+
+    /* 10 KB frames at 25 fps over a 10 MB/s link with a 20ms RTT */
+    guac_timestamp now = simulate(congestion, 200, 10000, 40, 10000, 20);
+
+    CU_ASSERT_EQUAL(congestion->min_rtt, 21);
+    CU_ASSERT(congestion->rtt >= 21 && congestion->rtt <= 22);
+    CU_ASSERT(congestion->bandwidth > 0);
+
+    int rtt, bandwidth;
+    guac_congestion_get_estimates(congestion, &rtt, &bandwidth);
+    CU_ASSERT_EQUAL(rtt, congestion->rtt);
+    CU_ASSERT_EQUAL(bandwidth, congestion->bandwidth);
+
+    CU_ASSERT(guac_congestion_get_frame_duration(congestion, now) < 40);
+    CU_ASSERT_EQUAL(guac_congestion_get_quality(congestion, now),
+            GUAC_CONGESTION_MAX_QUALITY);
+    CU_ASSERT_FALSE(guac_congestion_is_congested(congestion, now));
+
+    guac_congestion_free(congestion);
+
+}
+
+/**
+ * Verifies that guac_congestion estimates the bandwidth of a user whose link
+ * cannot keep up with the data sent, recommending the lowest quality and
+ * longest frame duration while large amounts of data remain undelivered.
+ */
+void test_congestion__congested() {
+
+    guac_congestion* congestion = guac_congestion_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(congestion);
+
+    /* 50 KB frames at 25 fps over a 100 KB/s link with a 20ms RTT */
+    guac_timestamp now = simulate(congestion, 200, 50000, 40, 100, 20);
+
+    /* Bandwidth should be estimated within 10% of the true value */
+    CU_ASSERT(congestion->bandwidth >= 90000);
+    CU_ASSERT(congestion->bandwidth <= 110000);
+
+    CU_ASSERT_EQUAL(guac_congestion_get_frame_duration(congestion, now),
+            GUAC_CONGESTION_MAX_FRAME_DURATION);
+    CU_ASSERT_EQUAL(guac_congestion_get_quality(congestion, now),
+            GUAC_CONGESTION_MIN_QUALITY);
+    CU_ASSERT_TRUE(guac_congestion_is_congested(congestion, now));
+
+    guac_congestion_free(congestion);
+
+}
+
+/**
+ * Verifies that guac_congestion paces frames according to the estimated
+ * bandwidth once a user begins falling behind the data sent, allowing
+ * additional time for undelivered data to drain.
+ */
+void test_congestion__pacing() {
+
+    guac_congestion* congestion = guac_congestion_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(congestion);
+
+    /* 20 KB frames every 80ms over a 200 KB/s link with a 20ms RTT, such that
+     * each frame takes 100ms to deliver */
+    guac_timestamp now = simulate(congestion, 10, 20000, 80, 200, 20);
+
+    CU_ASSERT_EQUAL(congestion->min_rtt, 120);
+    CU_ASSERT_EQUAL(congestion->bandwidth, 200000);
+    CU_ASSERT_TRUE(guac_congestion_is_congested(congestion, now));
+
+    /* Frames should be no more frequent than the link allows */
+    int frame_duration = guac_congestion_get_frame_duration(congestion, now);
+    CU_ASSERT(frame_duration > 100);
+    CU_ASSERT(frame_duration < GUAC_CONGESTION_MAX_FRAME_DURATION);
+
+    guac_congestion_free(congestion);
+
+}
+
+/**
+ * Verifies that acknowledgements of frames which were never sent do not
+ * produce estimates, while still acknowledging all older frames.
+ */
+void test_congestion__unknown_frame() {
+
+    guac_congestion* congestion = guac_congestion_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(congestion);
+
+    guac_congestion_sent(congestion, 1000);
+    guac_congestion_frame_sent(congestion, START_TIME);
+    CU_ASSERT_EQUAL(congestion->frame_count, 1);
+
+    /* Acknowledge a frame which was never sent */
+    guac_congestion_frame_acked(congestion, START_TIME + 10,
+            START_TIME + 50, 0);
+
+    CU_ASSERT_EQUAL(congestion->frame_count, 0);
+    CU_ASSERT_EQUAL(congestion->rtt, -1);
+    CU_ASSERT_EQUAL(congestion->bandwidth, 0);
+
+    CU_ASSERT_EQUAL(guac_congestion_get_frame_duration(congestion,
+                START_TIME + 50), 0);
+    CU_ASSERT_EQUAL(guac_congestion_get_quality(congestion, START_TIME + 50),
+            GUAC_CONGESTION_MAX_QUALITY);
+
+    guac_congestion_free(congestion);
+
+}
+
@@ -0,0 +1,136 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <CUnit/CUnit.h>
+#include <guacamole/opcode.h>
+
+/**
+ * Arbitrary opcode/value mapping used to test guac_opcode_map. As with the
+ * handler maps throughout libguac, the opcode is the first member.
+ */
+typedef struct test_mapping {
+
+    /**
+     * The opcode of this mapping.
+     */
+    const char* opcode;
+
+    /**
+     * Arbitrary value associated with the opcode.
+     */
+    int value;
+
+} test_mapping;
+
+/**
+ * Mappings containing every opcode of the Guacamole protocol.
+ */
+static test_mapping protocol_mappings[] = {
+    {"ack",        0}, {"arc",        1}, {"argv",       2},
+    {"audio",      3}, {"blob",       4}, {"body",       5},
+    {"cfill",      6}, {"clip",       7}, {"clipboard",  8},
+    {"close",      9}, {"copy",      10}, {"cstroke",   11},
+    {"cursor",    12}, {"curve",     13}, {"disconnect",14},
+    {"dispose",   15}, {"distort",   16}, {"end",       17},
+    {"error",     18}, {"file",      19}, {"filesystem",20},
+    {"get",       21}, {"identity",  22}, {"img",       23},
+    {"jpeg",      24}, {"key",       25}, {"lfill",     26},
+    {"line",      27}, {"lstroke",   28}, {"mouse",     29},
+    {"move",      30}, {"name",      31}, {"nest",      32},
+    {"nop",       33}, {"pipe",      34}, {"pop",       35},
+    {"push",      36}, {"put",       37}, {"ready",     38},
+    {"rect",      39}, {"required",  40}, {"reset",     41},
+    {"select",    42}, {"set",       43}, {"shade",     44},
+    {"size",      45}, {"start",     46}, {"sync",      47},
+    {"timezone",  48}, {"touch",     49}, {"transfer",  50},
+    {"transform", 51}, {"undefine",  52}, {"video",     53},
+    {NULL,        -1}
+};
+
+/**
+ * Test which verifies that every opcode within a guac_opcode_map resolves to
+ * the index of its mapping, and that opcodes not within the map are not
+ * found.
+ */
+void test_opcode__lookup() {
+
+    guac_opcode_map* map = guac_opcode_map_alloc(protocol_mappings,
+            sizeof(test_mapping));
+    CU_ASSERT_PTR_NOT_NULL_FATAL(map);
+
+    for (int i = 0; protocol_mappings[i].opcode != NULL; i++) {
+        int index = guac_opcode_map_lookup(map, protocol_mappings[i].opcode);
+        CU_ASSERT_EQUAL(index, i);
+        CU_ASSERT_EQUAL(protocol_mappings[index].value, i);
+    }
+
+    CU_ASSERT_EQUAL(guac_opcode_map_lookup(map, ""), -1);
+    CU_ASSERT_EQUAL(guac_opcode_map_lookup(map, "syn"), -1);
+    CU_ASSERT_EQUAL(guac_opcode_map_lookup(map, "syncs"), -1);
+    CU_ASSERT_EQUAL(guac_opcode_map_lookup(map, "SYNC"), -1);
+    CU_ASSERT_EQUAL(guac_opcode_map_lookup(map, "unknown"), -1);
+
+    guac_opcode_map_free(map);
+
+}
+
+/**
+ * Test which verifies that duplicate opcodes resolve to their first mapping,
+ * as with a linear search of the mappings.
+ */
+void test_opcode__duplicates() {
+
+    test_mapping mappings[] = {
+        {"mouse", 0},
+        {"key",   1},
+        {"mouse", 2},
+        {NULL,   -1}
+    };
+
+    guac_opcode_map* map = guac_opcode_map_alloc(mappings,
+            sizeof(test_mapping));
+    CU_ASSERT_PTR_NOT_NULL_FATAL(map);
+
+    CU_ASSERT_EQUAL(guac_opcode_map_lookup(map, "mouse"), 0);
+    CU_ASSERT_EQUAL(guac_opcode_map_lookup(map, "key"), 1);
+
+    guac_opcode_map_free(map);
+
+}
+
+/**
+ * Test which verifies that a guac_opcode_map may index an empty array of
+ * mappings, within which no opcode is found.
+ */
+void test_opcode__empty() {
+
+    test_mapping mappings[] = {
+        {NULL, -1}
+    };
+
+    guac_opcode_map* map = guac_opcode_map_alloc(mappings,
+            sizeof(test_mapping));
+    CU_ASSERT_PTR_NOT_NULL_FATAL(map);
+
+    CU_ASSERT_EQUAL(guac_opcode_map_lookup(map, "sync"), -1);
+    CU_ASSERT_EQUAL(guac_opcode_map_lookup(map, ""), -1);
+
+    guac_opcode_map_free(map);
+
+}
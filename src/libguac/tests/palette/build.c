@@ -0,0 +1,113 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "palette.h"
+
+#include <CUnit/CUnit.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * The width of each test image, in pixels.
+ */
+#define TEST_WIDTH 32
+
+/**
+ * The height of each test image, in pixels.
+ */
+#define TEST_HEIGHT 16
+
+/**
+ * Test which verifies that guac_palette_build() assigns each distinct color
+ * its own palette index, in order of first appearance, and stores the index
+ * of every pixel, including across rows with padding.
+ */
+void test_palette__build() {
+
+    uint32_t pixels[TEST_HEIGHT][TEST_WIDTH + 4];
+    unsigned char indexes[TEST_WIDTH * TEST_HEIGHT];
+    int x, y;
+
+    /* Vertical stripes of three colors, with alpha to be ignored */
+    for (y = 0; y < TEST_HEIGHT; y++) {
+        for (x = 0; x < TEST_WIDTH; x++)
+            pixels[y][x] = (x / 4 % 3) * 0x102030 | (y % 2 ? 0xFF000000 : 0);
+    }
+
+    guac_palette* palette = guac_palette_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(palette);
+
+    CU_ASSERT_EQUAL(guac_palette_build(palette, (unsigned char*) pixels,
+                TEST_WIDTH, TEST_HEIGHT, sizeof(pixels[0]), 0, indexes), 0);
+
+    CU_ASSERT_EQUAL(palette->size, 3);
+    CU_ASSERT_EQUAL(palette->colors[1].red,   0x10);
+    CU_ASSERT_EQUAL(palette->colors[1].green, 0x20);
+    CU_ASSERT_EQUAL(palette->colors[1].blue,  0x30);
+
+    for (y = 0; y < TEST_HEIGHT; y++) {
+        for (x = 0; x < TEST_WIDTH; x++)
+            CU_ASSERT_EQUAL(indexes[y * TEST_WIDTH + x], x / 4 % 3);
+    }
+
+    guac_palette_free(palette);
+
+}
+
+/**
+ * Test which verifies that guac_palette_build() fails for images containing
+ * more colors than a palette can hold, or containing non-opaque pixels when
+ * alpha is meaningful, and that a reset palette can be built again.
+ */
+void test_palette__reset() {
+
+    uint32_t pixels[TEST_HEIGHT][TEST_WIDTH];
+    unsigned char indexes[TEST_WIDTH * TEST_HEIGHT];
+    int x, y;
+
+    /* Every pixel a different color (512 colors) */
+    for (y = 0; y < TEST_HEIGHT; y++) {
+        for (x = 0; x < TEST_WIDTH; x++)
+            pixels[y][x] = 0xFF000000 | (y * TEST_WIDTH + x) * 0x010101;
+    }
+
+    guac_palette* palette = guac_palette_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(palette);
+
+    CU_ASSERT_NOT_EQUAL(guac_palette_build(palette, (unsigned char*) pixels,
+                TEST_WIDTH, TEST_HEIGHT, sizeof(pixels[0]), 0, indexes), 0);
+
+    /* Single opaque color, after reset */
+    memset(pixels, 0xFF, sizeof(pixels));
+    guac_palette_reset(palette);
+    CU_ASSERT_EQUAL(guac_palette_build(palette, (unsigned char*) pixels,
+                TEST_WIDTH, TEST_HEIGHT, sizeof(pixels[0]), 1, indexes), 0);
+    CU_ASSERT_EQUAL(palette->size, 1);
+    CU_ASSERT_EQUAL(indexes[TEST_WIDTH * TEST_HEIGHT - 1], 0);
+
+    /* Single non-opaque pixel */
+    pixels[TEST_HEIGHT - 1][TEST_WIDTH - 1] = 0x80FFFFFF;
+    guac_palette_reset(palette);
+    CU_ASSERT_NOT_EQUAL(guac_palette_build(palette, (unsigned char*) pixels,
+                TEST_WIDTH, TEST_HEIGHT, sizeof(pixels[0]), 1, indexes), 0);
+
+    guac_palette_free(palette);
+
+}
+
@@ -0,0 +1,143 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <CUnit/CUnit.h>
+#include <guacamole/parser.h>
+#include <guacamole/socket.h>
+
+#include <unistd.h>
+
+/**
+ * Writes the given string to the given file descriptor in its entirety,
+ * closing the file descriptor afterwards.
+ *
+ * @param fd
+ *     The file descriptor to write to.
+ *
+ * @param data
+ *     The string to write.
+ *
+ * @param length
+ *     The number of bytes to write.
+ */
+static void write_all(int fd, const char* data, int length) {
+
+    while (length > 0) {
+
+        int written = write(fd, data, length);
+        if (written <= 0)
+            break;
+
+        data += written;
+        length -= written;
+
+    }
+
+    close(fd);
+
+}
+
+/**
+ * Test which verifies that guac_parser_buffered() reports whether the next
+ * instruction has already been buffered in its entirety, without disturbing
+ * the instructions subsequently read by guac_parser_read().
+ */
+void test_parser__buffered() {
+
+    char test_string[] = "5.mouse,2.10,2.20,1.0;"
+                         "5.mouse,2.11,2.21,1.0;"
+                         "3.key,5.65307,1.1;"
+                         "5.mouse,2.12,2.";
+
+    int fd[2];
+    CU_ASSERT_EQUAL_FATAL(pipe(fd), 0);
+
+    /* Test data is small enough to be written to the pipe in full before
+     * being read */
+    write_all(fd[1], test_string, sizeof(test_string) - 1);
+
+    guac_socket* socket = guac_socket_open(fd[0]);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(socket);
+
+    guac_parser* parser = guac_parser_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(parser);
+
+    /* Nothing is buffered before the first read */
+    CU_ASSERT_FALSE(guac_parser_buffered(parser));
+
+    /* First instruction */
+    CU_ASSERT_EQUAL_FATAL(guac_parser_read(parser, socket, 1000000), 0);
+    CU_ASSERT_STRING_EQUAL(parser->opcode, "mouse");
+    CU_ASSERT_STRING_EQUAL(parser->argv[0], "10");
+    char* first_x = parser->argv[0];
+
+    /* Second instruction is complete within the buffer */
+    CU_ASSERT_TRUE(guac_parser_buffered(parser));
+    CU_ASSERT_TRUE(guac_parser_buffered(parser));
+    CU_ASSERT_EQUAL_FATAL(guac_parser_read(parser, socket, 1000000), 0);
+    CU_ASSERT_STRING_EQUAL(parser->opcode, "mouse");
+    CU_ASSERT_STRING_EQUAL(parser->argv[0], "11");
+
+    /* Elements of the previous instruction remain intact */
+    CU_ASSERT_STRING_EQUAL(first_x, "10");
+
+    /* Third instruction is complete within the buffer */
+    CU_ASSERT_TRUE(guac_parser_buffered(parser));
+    CU_ASSERT_EQUAL_FATAL(guac_parser_read(parser, socket, 1000000), 0);
+    CU_ASSERT_STRING_EQUAL(parser->opcode, "key");
+    CU_ASSERT_EQUAL(parser->argc, 2);
+
+    /* Final instruction is incomplete */
+    CU_ASSERT_FALSE(guac_parser_buffered(parser));
+    CU_ASSERT_NOT_EQUAL(guac_parser_read(parser, socket, 1000000), 0);
+
+    guac_parser_free(parser);
+    guac_socket_free(socket);
+
+}
+
+/**
+ * Test which verifies that guac_parser_buffered() does not report malformed
+ * buffered data as a complete instruction.
+ */
+void test_parser__buffered_malformed() {
+
+    char test_string[] = "4.sync,3.123;"
+                         "4.sync,3.12345;";
+
+    int fd[2];
+    CU_ASSERT_EQUAL_FATAL(pipe(fd), 0);
+    write_all(fd[1], test_string, sizeof(test_string) - 1);
+
+    guac_socket* socket = guac_socket_open(fd[0]);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(socket);
+
+    guac_parser* parser = guac_parser_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(parser);
+
+    CU_ASSERT_EQUAL_FATAL(guac_parser_read(parser, socket, 1000000), 0);
+    CU_ASSERT_STRING_EQUAL(parser->opcode, "sync");
+
+    /* Second element is longer than its declared length */
+    CU_ASSERT_FALSE(guac_parser_buffered(parser));
+
+    guac_parser_free(parser);
+    guac_socket_free(socket);
+
+}
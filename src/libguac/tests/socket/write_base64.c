@@ -0,0 +1,178 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <CUnit/CUnit.h>
+#include <guacamole/protocol.h>
+#include <guacamole/socket.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * The number of bytes of test data to encode. This is deliberately larger
+ * than, and not a multiple of, both the size of the output buffer of a
+ * guac_socket wrapping a file descriptor and the block size used internally
+ * by guac_socket_write_base64().
+ */
+#define TEST_DATA_SIZE 20000
+
+/**
+ * Creates a new, empty temporary file which is automatically deleted once
+ * closed.
+ *
+ * @return
+ *     A file descriptor for the new temporary file.
+ */
+static int create_temporary_file() {
+
+    char path[] = "/tmp/guac-test-base64-XXXXXX";
+    int fd = mkstemp(path);
+    CU_ASSERT_NOT_EQUAL_FATAL(fd, -1);
+
+    unlink(path);
+    return fd;
+
+}
+
+/**
+ * Reads all data written to the given file descriptor since the given
+ * offset, storing that data as a null-terminated string.
+ *
+ * @param fd
+ *     The file descriptor to read from.
+ *
+ * @param offset
+ *     The offset within the file from which data should be read. This offset
+ *     is updated to point to the end of the data read.
+ *
+ * @param buffer
+ *     The buffer which should receive the data read.
+ *
+ * @param size
+ *     The size of the given buffer, in bytes.
+ *
+ * @return
+ *     The number of bytes read, excluding the null terminator.
+ */
+static int read_written(int fd, off_t* offset, char* buffer, size_t size) {
+
+    ssize_t length = pread(fd, buffer, size - 1, *offset);
+    CU_ASSERT_FATAL(length >= 0);
+
+    buffer[length] = '\0';
+    *offset += length;
+    return length;
+
+}
+
+/**
+ * Verifies that guac_socket_write_base64() produces correct base64 via the
+ * given socket regardless of how the data written is split across calls,
+ * including splits which leave partial triplets pending between calls, by
+ * verifying that the output decodes back to the original data.
+ *
+ * @param socket
+ *     The socket to write base64 data to.
+ *
+ * @param fd
+ *     The file descriptor of a file which receives all data written to the
+ *     given socket.
+ */
+static void verify_write_base64(guac_socket* socket, int fd) {
+
+    int i;
+    int split;
+    int length;
+    off_t offset = 0;
+
+    char written[TEST_DATA_SIZE * 2];
+    unsigned char data[TEST_DATA_SIZE];
+    for (i = 0; i < TEST_DATA_SIZE; i++)
+        data[i] = (i * 31 + (i >> 8)) & 0xFF;
+
+    /* Known output for data which requires padding */
+    guac_socket_write_base64(socket, "HELLO", 5);
+    guac_socket_flush_base64(socket);
+    guac_socket_flush(socket);
+
+    length = read_written(fd, &offset, written, sizeof(written));
+    CU_ASSERT_EQUAL(length, 8);
+    CU_ASSERT_NSTRING_EQUAL(written, "SEVMTE8=", 8);
+
+    /* Arbitrary splits of larger data */
+    int splits[] = { 0, 1, 2, 3, 17, 767, 768, 769, 6143, 6144, 6145,
+        8191, 8192, 8193, TEST_DATA_SIZE };
+
+    for (i = 0; i < sizeof(splits) / sizeof(splits[0]); i++) {
+
+        split = splits[i];
+
+        guac_socket_write_base64(socket, data, split);
+        guac_socket_write_base64(socket, data + split,
+                TEST_DATA_SIZE - split);
+        guac_socket_flush_base64(socket);
+        guac_socket_flush(socket);
+
+        /* Verify length (including padding) */
+        length = read_written(fd, &offset, written, sizeof(written));
+        CU_ASSERT_EQUAL_FATAL(length, (TEST_DATA_SIZE + 2) / 3 * 4);
+
+        /* Verify content by decoding */
+        CU_ASSERT_EQUAL(guac_protocol_decode_base64(written), TEST_DATA_SIZE);
+        CU_ASSERT(memcmp(written, data, TEST_DATA_SIZE) == 0);
+
+    }
+
+}
+
+/**
+ * Tests that guac_socket_write_base64() produces correct base64 when writing
+ * to a socket wrapping a file descriptor, which encodes base64 directly into
+ * its own output buffer.
+ */
+void test_socket__write_base64() {
+
+    int fd = create_temporary_file();
+    guac_socket* socket = guac_socket_open(fd);
+
+    verify_write_base64(socket, fd);
+
+    guac_socket_free(socket);
+
+}
+
+/**
+ * Tests that guac_socket_write_base64() produces correct base64 when writing
+ * to a socket which cannot accept base64 directly into an output buffer, in
+ * this case a socket created with guac_socket_tee().
+ */
+void test_socket__write_base64_blocks() {
+
+    int primary_fd = create_temporary_file();
+    int secondary_fd = create_temporary_file();
+
+    guac_socket* socket = guac_socket_tee(guac_socket_open(primary_fd),
+            guac_socket_open(secondary_fd));
+
+    verify_write_base64(socket, primary_fd);
+
+    guac_socket_free(socket);
+
+}
@@ -20,7 +20,9 @@
 #include "config.h"
 
 #include "guacamole/client.h"
+#include "guacamole/congestion.h"
 #include "guacamole/object.h"
+#include "guacamole/opcode.h"
 #include "guacamole/protocol.h"
 #include "guacamole/stream.h"
 #include "guacamole/timestamp.h"
@@ -28,6 +30,7 @@
 #include "user-handlers.h"
 
 #include <inttypes.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -138,13 +141,20 @@ int __guac_handle_sync(guac_user* user, int argc, char** argv) {
         /* Record baseline duration of frame by excluding lag */
         user->last_frame_duration = frame_duration - user->processing_lag;
 
+        /* Update round-trip time and bandwidth estimates */
+        guac_congestion_frame_acked(user->congestion, timestamp, current,
+                user->processing_lag);
+
     }
 
     /* Log received timestamp and calculated lag (at TRACE level only) */
+    int rtt, bandwidth;
+    guac_congestion_get_estimates(user->congestion, &rtt, &bandwidth);
     guac_user_log(user, GUAC_LOG_TRACE,
             "User confirmation of frame %" PRIu64 "ms received "
-            "at %" PRIu64 "ms (processing_lag=%ims)",
-            timestamp, current, user->processing_lag);
+            "at %" PRIu64 "ms (processing_lag=%ims, rtt=%ims, "
+            "bandwidth=%iB/s)", timestamp, current, user->processing_lag,
+            rtt, bandwidth);
 
     if (user->sync_handler)
         return user->sync_handler(user, timestamp);
@@ -728,18 +738,91 @@ void guac_free_mimetypes(char** mimetypes) {
 
 }
 
+/**
+ * Perfect-hash index of __guac_instruction_handler_map, or NULL if the index
+ * could not be built.
+ */
+static guac_opcode_map* __guac_instruction_opcode_map = NULL;
+
+/**
+ * Perfect-hash index of __guac_handshake_handler_map, or NULL if the index
+ * could not be built.
+ */
+static guac_opcode_map* __guac_handshake_opcode_map = NULL;
+
+/**
+ * Guard ensuring the opcode indices of the handler maps are built only once.
+ */
+static pthread_once_t __guac_opcode_maps_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Builds the perfect-hash indices of the instruction and handshake handler
+ * maps. This function is invoked only once, via pthread_once().
+ */
+static void __guac_init_opcode_maps() {
+
+    __guac_instruction_opcode_map = guac_opcode_map_alloc(
+            __guac_instruction_handler_map,
+            sizeof(__guac_instruction_handler_mapping));
+
+    __guac_handshake_opcode_map = guac_opcode_map_alloc(
+            __guac_handshake_handler_map,
+            sizeof(__guac_instruction_handler_mapping));
+
+}
+
+/**
+ * Returns the perfect-hash index of the given handler map, if that map is
+ * one of the handler maps defined by libguac.
+ *
+ * @param map
+ *     The handler map whose index should be returned.
+ *
+ * @return
+ *     The index of the given handler map, or NULL if no index is available
+ *     and the map must be searched linearly.
+ */
+static guac_opcode_map* __guac_get_opcode_map(
+        __guac_instruction_handler_mapping* map) {
+
+    pthread_once(&__guac_opcode_maps_once, __guac_init_opcode_maps);
+
+    if (map == __guac_instruction_handler_map)
+        return __guac_instruction_opcode_map;
+
+    if (map == __guac_handshake_handler_map)
+        return __guac_handshake_opcode_map;
+
+    return NULL;
+
+}
+
 int __guac_user_call_opcode_handler(__guac_instruction_handler_mapping* map,
         guac_user* user, const char* opcode, int argc, char** argv) {
 
-    /* For each defined instruction */
-    __guac_instruction_handler_mapping* current = map;
-    while (current->opcode != NULL) {
+    /* Look up handler by hash if the map is indexed */
+    guac_opcode_map* opcode_map = __guac_get_opcode_map(map);
+    if (opcode_map != NULL) {
+
+        int index = guac_opcode_map_lookup(opcode_map, opcode);
+        if (index != -1)
+            return map[index].handler(user, argc, argv);
+
+    }
 
-        /* If recognized, call handler */
-        if (strcmp(opcode, current->opcode) == 0)
-            return current->handler(user, argc, argv);
+    /* Otherwise, search each defined instruction */
+    else {
+
+        __guac_instruction_handler_mapping* current = map;
+        while (current->opcode != NULL) {
+
+            /* If recognized, call handler */
+            if (strcmp(opcode, current->opcode) == 0)
+                return current->handler(user, argc, argv);
+
+            current++;
+        }
 
-        current++;
     }
 
     /* If unrecognized, log and ignore */
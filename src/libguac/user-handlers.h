@@ -278,7 +278,9 @@ char** guac_copy_mimetypes(char** mimetypes, int count);
  * initial handler lookup table defined in the map that is provided to this
  * function. If an entry for the instruction is found in the provided map,
  * the handler defined in that map will be called and the value returned.  If
- * no match is found, it is silently ignored.
+ * no match is found, it is silently ignored. The handler maps defined by
+ * libguac are searched via a perfect hash of their opcodes, while any other
+ * map is searched linearly.
  *
  * @param map
  *     The array that holds the opcode to handler mappings.
@@ -114,9 +114,98 @@ static void guac_user_log_handshake_failure(guac_user* user) {
 
 }
 
+/**
+ * Handles failure to read the next instruction from a user, aborting or
+ * stopping the user as appropriate for the failure described by guac_error.
+ *
+ * @param user
+ *     The user whose instruction could not be read.
+ */
+static void guac_user_handle_read_failure(guac_user* user) {
+
+    if (guac_error == GUAC_STATUS_TIMEOUT)
+        guac_user_abort(user, GUAC_PROTOCOL_STATUS_CLIENT_TIMEOUT, "User is not responding.");
+
+    else {
+        if (guac_error != GUAC_STATUS_CLOSED)
+            guac_user_log_guac_error(user, GUAC_LOG_WARNING,
+                    "Guacamole connection failure");
+        guac_user_stop(user);
+    }
+
+}
+
+/**
+ * Returns whether the given instruction is a mouse or touch event which may
+ * be superseded by a later event, and thus dropped if input coalescing is
+ * enabled. Touch events are only coalescable while the contact is pressed.
+ *
+ * @param opcode
+ *     The opcode of the instruction.
+ *
+ * @param argc
+ *     The number of arguments of the instruction.
+ *
+ * @param argv
+ *     The arguments of the instruction.
+ *
+ * @return
+ *     Non-zero if the instruction may be superseded by a later event, zero
+ *     otherwise.
+ */
+static int guac_user_input_coalescable(const char* opcode, int argc,
+        char** argv) {
+
+    if (strcmp(opcode, "mouse") == 0)
+        return argc >= 3;
+
+    if (strcmp(opcode, "touch") == 0)
+        return argc >= 7 && atof(argv[6]) > 0;
+
+    return 0;
+
+}
+
+/**
+ * Returns whether the given coalescable mouse or touch event is superseded by
+ * the instruction which immediately follows it, such that the event may be
+ * dropped without losing a button or contact transition.
+ *
+ * @param opcode
+ *     The opcode of the coalescable instruction.
+ *
+ * @param argv
+ *     The arguments of the coalescable instruction.
+ *
+ * @param next
+ *     The parser containing the instruction which immediately follows.
+ *
+ * @return
+ *     Non-zero if the coalescable instruction is superseded by the
+ *     following instruction, zero otherwise.
+ */
+static int guac_user_input_superseded(const char* opcode, char** argv,
+        guac_parser* next) {
+
+    if (strcmp(opcode, next->opcode) != 0
+            || !guac_user_input_coalescable(next->opcode, next->argc,
+                next->argv))
+        return 0;
+
+    /* Mouse events are superseded only if no buttons change */
+    if (strcmp(opcode, "mouse") == 0)
+        return atoi(argv[2]) == atoi(next->argv[2]);
+
+    /* Touch events are superseded only by the same, still-pressed contact */
+    return atoi(argv[0]) == atoi(next->argv[0]);
+
+}
+
 /**
  * The thread which handles all user input, calling event handlers for received
- * instructions.
+ * instructions. If input coalescing is enabled for the user, mouse and touch
+ * events which are superseded by an event that has already been received are
+ * dropped.
  *
  * @param data
  *     A pointer to a guac_user_input_thread_params structure describing the
@@ -137,23 +226,53 @@ static void* guac_user_input_thread(void* data) {
     guac_client* client = user->client;
     guac_socket* socket = user->socket;
 
+    /* Whether the parser already contains the next instruction, read while
+     * looking ahead for superseding events */
+    int instruction_pending = 0;
+
     /* Guacamole user input loop */
     while (client->state == GUAC_CLIENT_RUNNING && user->active) {
 
         /* Read instruction, stop on error */
-        if (guac_parser_read(parser, socket, usec_timeout)) {
+        if (!instruction_pending
+                && guac_parser_read(parser, socket, usec_timeout)) {
+            guac_user_handle_read_failure(user);
+            return NULL;
+        }
+
+        instruction_pending = 0;
 
-            if (guac_error == GUAC_STATUS_TIMEOUT)
-                guac_user_abort(user, GUAC_PROTOCOL_STATUS_CLIENT_TIMEOUT, "User is not responding.");
+        char* opcode = parser->opcode;
+        int argc = parser->argc;
+        char** argv = parser->argv;
+        char* coalesced_argv[GUAC_INSTRUCTION_MAX_ELEMENTS];
 
-            else {
-                if (guac_error != GUAC_STATUS_CLOSED)
-                    guac_user_log_guac_error(user, GUAC_LOG_WARNING,
-                            "Guacamole connection failure");
-                guac_user_stop(user);
+        /* Replace events with later, already-received events which supersede
+         * them. Parsing buffered data never moves the instruction buffer, so
+         * the elements of the previous instruction remain valid. */
+        while (user->coalesce_input
+                && guac_user_input_coalescable(opcode, argc, argv)
+                && guac_parser_buffered(parser)) {
+
+            memcpy(coalesced_argv, argv, sizeof(char*) * argc);
+            argv = coalesced_argv;
+
+            if (guac_parser_read(parser, socket, usec_timeout)) {
+                guac_user_handle_read_failure(user);
+                return NULL;
             }
 
-            return NULL;
+            /* Handle the following instruction separately if it does not
+             * supersede the current event */
+            if (!guac_user_input_superseded(opcode, argv, parser)) {
+                instruction_pending = 1;
+                break;
+            }
+
+            opcode = parser->opcode;
+            argc = parser->argc;
+            argv = parser->argv;
+
         }
 
         /* Reset guac_error and guac_error_message (user/client handlers are not
@@ -163,14 +282,14 @@ static void* guac_user_input_thread(void* data) {
 
         /* Call handler, stop on error */
         if (__guac_user_call_opcode_handler(__guac_instruction_handler_map, 
-                user, parser->opcode, parser->argc, parser->argv)) {
+                user, opcode, argc, argv)) {
 
             /* Log error */
             guac_user_log_guac_error(user, GUAC_LOG_WARNING,
                     "User connection aborted");
 
             /* Log handler details */
-            guac_user_log(user, GUAC_LOG_DEBUG, "Failing instruction handler in user was \"%s\"", parser->opcode);
+            guac_user_log(user, GUAC_LOG_DEBUG, "Failing instruction handler in user was \"%s\"", opcode);
 
             guac_user_stop(user);
             return NULL;
@@ -0,0 +1,712 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+
+#include "guacamole/client.h"
+#include "guacamole/socket.h"
+#include "guacamole/user.h"
+#include "user-queue.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * Wakes the writer thread of the given queue if it is currently waiting for
+ * data. The queue lock is acquired only if the writer thread is actually
+ * waiting, such that the producer does not normally contend with the writer.
+ *
+ * @param queue
+ *     The queue whose writer thread should be woken.
+ */
+static void guac_user_queue_signal(guac_user_queue* queue) {
+
+    if (__atomic_load_n(&queue->waiting, __ATOMIC_SEQ_CST)) {
+        pthread_mutex_lock(&queue->lock);
+        pthread_cond_signal(&queue->modified);
+        pthread_mutex_unlock(&queue->lock);
+    }
+
+}
+
+/**
+ * Returns whether the given queue can be recovered from overflow by
+ * resynchronizing its user via the resync handler of the associated client.
+ *
+ * @param queue
+ *     The queue to test.
+ *
+ * @return
+ *     Non-zero if overflow of the given queue should be handled by
+ *     resynchronizing its user, zero if the user should be disconnected.
+ */
+static int guac_user_queue_can_resync(guac_user_queue* queue) {
+    return queue->policy == GUAC_CLIENT_QUEUE_RESYNC
+        && queue->user->client->resync_handler != NULL
+        && queue->user->active;
+}
+
+/**
+ * Returns the number of bytes which may be queued for instructions other than
+ * the "end" instructions of streams the user has already seen opened. The
+ * remainder of the queue is reserved for those "end" instructions, such that
+ * they can still be queued after the queue has overflowed.
+ *
+ * @param queue
+ *     The queue to inspect.
+ *
+ * @return
+ *     The number of bytes available to instructions other than "end".
+ */
+static size_t guac_user_queue_limit(guac_user_queue* queue) {
+
+    size_t reserve = queue->size / 4;
+    if (reserve > GUAC_USER_QUEUE_END_RESERVE)
+        reserve = GUAC_USER_QUEUE_END_RESERVE;
+
+    return queue->size - reserve;
+
+}
+
+/**
+ * Parses a single element of a Guacamole protocol instruction, such as
+ * "4.sync,", from the given buffer.
+ *
+ * @param current
+ *     The first character of the element to parse.
+ *
+ * @param end
+ *     The position immediately after the last character within the buffer.
+ *
+ * @param value
+ *     Pointer to a pointer which will receive the address of the first
+ *     character of the element's value.
+ *
+ * @param length
+ *     Pointer to an int which will receive the length of the element's value.
+ *
+ * @return
+ *     The position immediately after the terminating "," or ";" of the
+ *     element, or NULL if the buffer does not contain a complete element.
+ */
+static const char* guac_user_queue_parse_element(const char* current,
+        const char* end, const char** value, int* length) {
+
+    int parsed = 0;
+
+    /* Parse length prefix */
+    while (current < end && *current >= '0' && *current <= '9') {
+        parsed = parsed * 10 + (*(current++) - '0');
+        if (parsed > GUAC_USER_QUEUE_HEADER_SIZE)
+            return NULL;
+    }
+
+    if (current >= end || *(current++) != '.')
+        return NULL;
+
+    /* Value and terminator must both be present */
+    if (end - current <= parsed)
+        return NULL;
+
+    *value = current;
+    *length = parsed;
+
+    current += parsed;
+    if (*current != ',' && *current != ';')
+        return NULL;
+
+    return current + 1;
+
+}
+
+/**
+ * Determines the kind of the instruction currently being appended to the
+ * given queue, using the header retained for that instruction. The kind of
+ * instruction is known as soon as its opcode has been appended, while the
+ * stream it relates to is known only once its first argument has also been
+ * appended. Only streams which may be opened by the broadcast socket (those
+ * allocated with guac_client_alloc_stream()) are tracked.
+ *
+ * @param queue
+ *     The queue whose current instruction should be inspected.
+ *
+ * @param stream_bit
+ *     Pointer to a uint64_t which will receive the bit corresponding to the
+ *     relevant stream within discarded_streams, or zero if the instruction
+ *     does not relate to a tracked stream or its stream is not yet known.
+ *
+ * @return
+ *     The kind of the current instruction.
+ */
+static guac_user_queue_instruction guac_user_queue_classify(
+        guac_user_queue* queue, uint64_t* stream_bit) {
+
+    const char* current = queue->header;
+    const char* end = current + (queue->instruction_length
+            < GUAC_USER_QUEUE_HEADER_SIZE ? queue->instruction_length
+            : GUAC_USER_QUEUE_HEADER_SIZE);
+
+    const char* opcode;
+    const char* argument;
+    int opcode_length;
+    int argument_length;
+    guac_user_queue_instruction type;
+
+    *stream_bit = 0;
+
+    /* Stream-related instructions always have arguments */
+    current = guac_user_queue_parse_element(current, end, &opcode,
+            &opcode_length);
+    if (current == NULL || current[-1] != ',')
+        return GUAC_USER_QUEUE_OTHER;
+
+#define GUAC_USER_QUEUE_OPCODE(name) \
+    (opcode_length == sizeof(name) - 1 \
+        && memcmp(opcode, name, sizeof(name) - 1) == 0)
+
+    if (GUAC_USER_QUEUE_OPCODE("blob"))
+        type = GUAC_USER_QUEUE_BLOB;
+
+    else if (GUAC_USER_QUEUE_OPCODE("end"))
+        type = GUAC_USER_QUEUE_END;
+
+    else if (GUAC_USER_QUEUE_OPCODE("img")
+            || GUAC_USER_QUEUE_OPCODE("audio")
+            || GUAC_USER_QUEUE_OPCODE("video")
+            || GUAC_USER_QUEUE_OPCODE("file")
+            || GUAC_USER_QUEUE_OPCODE("pipe")
+            || GUAC_USER_QUEUE_OPCODE("clipboard")
+            || GUAC_USER_QUEUE_OPCODE("argv"))
+        type = GUAC_USER_QUEUE_OPEN;
+
+    else
+        return GUAC_USER_QUEUE_OTHER;
+
+#undef GUAC_USER_QUEUE_OPCODE
+
+    /* The stream index is the first argument */
+    current = guac_user_queue_parse_element(current, end, &argument,
+            &argument_length);
+    if (current == NULL || argument_length == 0)
+        return type;
+
+    int index = 0;
+    for (int i = 0; i < argument_length; i++) {
+        if (argument[i] < '0' || argument[i] > '9'
+                || index >= GUAC_CLIENT_MAX_STREAMS * 2)
+            return type;
+        index = index * 10 + (argument[i] - '0');
+    }
+
+    /* Streams allocated by the client always have odd indices */
+    if (index % 2 == 1 && index < GUAC_CLIENT_MAX_STREAMS * 2)
+        *stream_bit = ((uint64_t) 1) << ((index - 1) / 2);
+
+    return type;
+
+}
+
+/**
+ * Copies the given data to the end of the circular buffer of the given queue
+ * if it fits within the given limit.
+ *
+ * @param queue
+ *     The queue to append data to.
+ *
+ * @param buffer
+ *     The data to append.
+ *
+ * @param length
+ *     The number of bytes of data to append.
+ *
+ * @param limit
+ *     The maximum number of bytes which may be queued once the data has been
+ *     appended.
+ *
+ * @return
+ *     Zero if the data was appended, non-zero if it did not fit.
+ */
+static int guac_user_queue_append(guac_user_queue* queue, const void* buffer,
+        size_t length, size_t limit) {
+
+    size_t head = __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+    size_t tail = queue->tail;
+
+    if (tail - head + length > limit)
+        return 1;
+
+    /* Copy data into circular buffer, wrapping around as necessary */
+    size_t offset = tail % queue->size;
+    size_t first = queue->size - offset;
+    if (first > length)
+        first = length;
+
+    memcpy(queue->buffer + offset, buffer, first);
+    memcpy(queue->buffer, (const char*) buffer + first, length - first);
+
+    __atomic_store_n(&queue->tail, tail + length, __ATOMIC_RELAXED);
+    return 0;
+
+}
+
+/**
+ * Handles overflow of the given queue, discarding the instruction currently
+ * being appended and applying the overflow policy of the queue. All further
+ * data will be discarded until the writer thread has resynchronized the user,
+ * if the policy allows resynchronization.
+ *
+ * @param queue
+ *     The queue which has overflowed.
+ */
+static void guac_user_queue_overflow(guac_user_queue* queue) {
+
+    guac_user* user = queue->user;
+
+    /* Discard partial instruction and everything that follows */
+    queue->dropping = 1;
+    __atomic_store_n(&queue->tail, queue->committed, __ATOMIC_RELAXED);
+    __atomic_store_n(&queue->overflowed, 1, __ATOMIC_SEQ_CST);
+    queue->overflows++;
+
+    if (guac_user_queue_can_resync(queue))
+        guac_user_log(user, GUAC_LOG_DEBUG, "Output queue full (%zu bytes "
+                "pending). Dropping updates until user can be "
+                "resynchronized.", guac_user_queue_depth(queue));
+
+    else {
+        guac_user_log(user, GUAC_LOG_WARNING, "Output queue full (%zu bytes "
+                "pending). Disconnecting user, as the connection is unable "
+                "to keep up.", guac_user_queue_depth(queue));
+        guac_user_stop(user);
+    }
+
+    guac_user_queue_signal(queue);
+
+}
+
+/**
+ * Returns the position immediately after the next complete instruction which
+ * has not yet been written, consuming the corresponding recorded boundary. If
+ * no boundary was recorded for that instruction, all data up to the given
+ * end position is treated as a single instruction.
+ *
+ * @param queue
+ *     The queue containing the data to write.
+ *
+ * @param end
+ *     The position immediately after the last complete instruction which may
+ *     be written.
+ *
+ * @return
+ *     The position immediately after the next instruction to write.
+ */
+static size_t guac_user_queue_next_boundary(guac_user_queue* queue,
+        size_t end) {
+
+    size_t boundary_head = queue->boundary_head;
+    size_t boundary_tail =
+        __atomic_load_n(&queue->boundary_tail, __ATOMIC_ACQUIRE);
+
+    while (boundary_head != boundary_tail) {
+
+        size_t boundary =
+            queue->boundaries[boundary_head % GUAC_USER_QUEUE_MAX_BOUNDARIES];
+
+        /* Leave boundaries of instructions beyond the end for later */
+        if (boundary > end)
+            break;
+
+        boundary_head++;
+        if (boundary > queue->head) {
+            end = boundary;
+            break;
+        }
+
+    }
+
+    __atomic_store_n(&queue->boundary_head, boundary_head, __ATOMIC_RELEASE);
+    return end;
+
+}
+
+/**
+ * Writes all queued data between the given positions to the socket of the
+ * associated user, advancing the head of the queue as data is written. Each
+ * instruction is written as a single unit with respect to the instruction
+ * lock of the socket, and thus will not be interleaved with user-specific
+ * instructions written by other threads, while those threads need not wait
+ * for all queued data to be written.
+ *
+ * @param queue
+ *     The queue containing the data to write.
+ *
+ * @param end
+ *     The position immediately after the last byte to write. All data from
+ *     the current head of the queue up to this position will be written.
+ *
+ * @return
+ *     Zero if the data was written successfully, non-zero if an error
+ *     occurred.
+ */
+static int guac_user_queue_send(guac_user_queue* queue, size_t end) {
+
+    guac_socket* socket = queue->user->socket;
+    size_t head = queue->head;
+
+    while (head != end) {
+
+        size_t instruction_end = guac_user_queue_next_boundary(queue, end);
+        int retval = 0;
+
+        guac_socket_instruction_begin(socket);
+
+        while (head != instruction_end) {
+
+            /* Write only up to the end of the circular buffer at once */
+            size_t offset = head % queue->size;
+            size_t length = instruction_end - head;
+            if (length > queue->size - offset)
+                length = queue->size - offset;
+
+            if (guac_socket_write(socket, queue->buffer + offset, length)) {
+                retval = 1;
+                break;
+            }
+
+            head += length;
+
+        }
+
+        guac_socket_instruction_end(socket);
+
+        if (retval)
+            return retval;
+
+        /* Release written space to the producer */
+        __atomic_store_n(&queue->head, head, __ATOMIC_RELEASE);
+
+    }
+
+    return 0;
+
+}
+
+/**
+ * Resynchronizes the user of the given overflowed queue using the resync
+ * handler of the associated client, and resumes queueing of data for that
+ * user. Any updates which were dropped while the queue was overflowed are
+ * superseded by the state sent by the resync handler. Queueing resumes before
+ * the resync handler is invoked, such that any update produced while the
+ * resync handler is running is queued after the state it sends rather than
+ * being lost.
+ *
+ * @param queue
+ *     The overflowed queue whose user should be resynchronized. All data
+ *     committed to this queue must already have been written.
+ *
+ * @return
+ *     Zero if the user was resynchronized successfully, non-zero otherwise.
+ */
+static int guac_user_queue_resync(guac_user_queue* queue) {
+
+    guac_user* user = queue->user;
+
+    guac_user_log(user, GUAC_LOG_DEBUG, "Resynchronizing user after output "
+            "queue overflow.");
+
+    /* Resume accepting data at the next instruction boundary */
+    __atomic_store_n(&queue->overflowed, 0, __ATOMIC_SEQ_CST);
+
+    if (user->client->resync_handler(user)
+            || guac_socket_flush(user->socket))
+        return 1;
+
+    return 0;
+
+}
+
+/**
+ * Waits for the producer to commit new data to the given queue, to request
+ * a flush, or for the queue to be stopped. If none of these occur within
+ * GUAC_USER_QUEUE_WAIT_TIMEOUT microseconds, this function returns anyway.
+ *
+ * @param queue
+ *     The queue to wait for.
+ *
+ * @param flushed
+ *     The value of flush_requested as of the last time the user's socket was
+ *     flushed.
+ */
+static void guac_user_queue_wait(guac_user_queue* queue, size_t flushed) {
+
+    struct timespec timeout;
+    clock_gettime(CLOCK_REALTIME, &timeout);
+
+    timeout.tv_nsec += GUAC_USER_QUEUE_WAIT_TIMEOUT * 1000L;
+    if (timeout.tv_nsec >= 1000000000L) {
+        timeout.tv_sec += timeout.tv_nsec / 1000000000L;
+        timeout.tv_nsec %= 1000000000L;
+    }
+
+    pthread_mutex_lock(&queue->lock);
+    __atomic_store_n(&queue->waiting, 1, __ATOMIC_SEQ_CST);
+
+    /* Sleep only if nothing changed since the queue was last inspected */
+    if (!__atomic_load_n(&queue->stopping, __ATOMIC_SEQ_CST)
+            && __atomic_load_n(&queue->committed, __ATOMIC_SEQ_CST) == queue->head
+            && __atomic_load_n(&queue->flush_requested, __ATOMIC_SEQ_CST) == flushed
+            && !(__atomic_load_n(&queue->overflowed, __ATOMIC_SEQ_CST)
+                && guac_user_queue_can_resync(queue)))
+        pthread_cond_timedwait(&queue->modified, &queue->lock, &timeout);
+
+    __atomic_store_n(&queue->waiting, 0, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&queue->lock);
+
+}
+
+/**
+ * Writer thread which drains the queue given as its argument to the socket of
+ * the associated user until the queue is stopped. If writing to the user's
+ * socket fails, the user is signalled to stop and the thread terminates.
+ *
+ * @param data
+ *     The guac_user_queue to drain.
+ *
+ * @return
+ *     Always NULL.
+ */
+static void* guac_user_queue_writer(void* data) {
+
+    guac_user_queue* queue = (guac_user_queue*) data;
+    guac_user* user = queue->user;
+
+    size_t flushed = 0;
+
+    while (!__atomic_load_n(&queue->stopping, __ATOMIC_ACQUIRE)) {
+
+        /* Write all complete instructions */
+        size_t committed = __atomic_load_n(&queue->committed, __ATOMIC_ACQUIRE);
+        if (committed != queue->head && guac_user_queue_send(queue, committed))
+            break;
+
+        /* Flush if the producer has requested a flush of data that has now
+         * been written */
+        size_t flush_requested =
+            __atomic_load_n(&queue->flush_requested, __ATOMIC_ACQUIRE);
+
+        if (flush_requested != flushed && queue->head >= flush_requested) {
+            flushed = flush_requested;
+            if (guac_socket_flush(user->socket))
+                break;
+        }
+
+        /* Once all data preceding the overflow has been written, bring the
+         * user back up to date */
+        if (queue->head == __atomic_load_n(&queue->committed, __ATOMIC_ACQUIRE)
+                && __atomic_load_n(&queue->overflowed, __ATOMIC_ACQUIRE)
+                && guac_user_queue_can_resync(queue)) {
+            if (guac_user_queue_resync(queue))
+                break;
+            continue;
+        }
+
+        /* Sleep if there is nothing further to write */
+        if (queue->head == __atomic_load_n(&queue->committed, __ATOMIC_ACQUIRE))
+            guac_user_queue_wait(queue, flushed);
+
+    }
+
+    /* Stop user if the writer thread stopped due to an error */
+    if (!__atomic_load_n(&queue->stopping, __ATOMIC_ACQUIRE))
+        guac_user_stop(user);
+
+    return NULL;
+
+}
+
+guac_user_queue* guac_user_queue_alloc(guac_user* user, size_t size,
+        guac_client_queue_policy policy) {
+
+    guac_user_queue* queue = calloc(1, sizeof(guac_user_queue));
+    if (queue == NULL)
+        return NULL;
+
+    queue->buffer = malloc(size);
+    if (queue->buffer == NULL) {
+        free(queue);
+        return NULL;
+    }
+
+    queue->user = user;
+    queue->policy = policy;
+    queue->size = size;
+
+    /* Discard any data written before the first instruction begins,
+     * without attempting to interpret it */
+    queue->dropping = 1;
+    queue->instruction_length = GUAC_USER_QUEUE_HEADER_SIZE + 1;
+
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->modified, NULL);
+
+    if (pthread_create(&queue->writer, NULL, guac_user_queue_writer, queue)) {
+        pthread_cond_destroy(&queue->modified);
+        pthread_mutex_destroy(&queue->lock);
+        free(queue->buffer);
+        free(queue);
+        return NULL;
+    }
+
+    return queue;
+
+}
+
+void guac_user_queue_free(guac_user_queue* queue) {
+
+    /* Signal writer thread to stop */
+    pthread_mutex_lock(&queue->lock);
+    __atomic_store_n(&queue->stopping, 1, __ATOMIC_SEQ_CST);
+    pthread_cond_signal(&queue->modified);
+    pthread_mutex_unlock(&queue->lock);
+
+    /* Abort any write blocked on a stalled connection */
+    guac_socket_shutdown(queue->user->socket);
+
+    pthread_join(queue->writer, NULL);
+
+    pthread_cond_destroy(&queue->modified);
+    pthread_mutex_destroy(&queue->lock);
+    free(queue->buffer);
+    free(queue);
+
+}
+
+void guac_user_queue_begin(guac_user_queue* queue) {
+    queue->dropping = __atomic_load_n(&queue->overflowed, __ATOMIC_ACQUIRE);
+    queue->instruction_length = 0;
+}
+
+void guac_user_queue_write(guac_user_queue* queue, const void* buffer,
+        size_t length) {
+
+    /* Retain the beginning of each instruction, even if discarded */
+    size_t offset = queue->instruction_length;
+    if (offset < GUAC_USER_QUEUE_HEADER_SIZE) {
+        size_t retained = GUAC_USER_QUEUE_HEADER_SIZE - offset;
+        if (retained > length)
+            retained = length;
+        memcpy(queue->header + offset, buffer, retained);
+    }
+
+    queue->instruction_length += length;
+
+    /* Ignore data for instructions which are being discarded */
+    if (queue->dropping)
+        return;
+
+    if (!guac_user_queue_append(queue, buffer, length,
+                guac_user_queue_limit(queue)))
+        return;
+
+    /* Only "end" instructions may use the reserved end of the queue */
+    uint64_t stream_bit;
+    if (guac_user_queue_classify(queue, &stream_bit) == GUAC_USER_QUEUE_END
+            && !guac_user_queue_append(queue, buffer, length, queue->size))
+        return;
+
+    /* Apply overflow policy if the data will not fit */
+    guac_user_queue_overflow(queue);
+
+}
+
+void guac_user_queue_commit(guac_user_queue* queue) {
+
+    uint64_t stream_bit = 0;
+    guac_user_queue_instruction type =
+        guac_user_queue_classify(queue, &stream_bit);
+
+    /* Track streams which the user will never see opened */
+    if (type == GUAC_USER_QUEUE_OPEN) {
+        if (queue->dropping)
+            queue->discarded_streams |= stream_bit;
+        else
+            queue->discarded_streams &= ~stream_bit;
+    }
+
+    /* Data for streams whose opening was discarded must also be discarded */
+    else if (queue->discarded_streams & stream_bit) {
+
+        if (type == GUAC_USER_QUEUE_END)
+            queue->discarded_streams &= ~stream_bit;
+
+        __atomic_store_n(&queue->tail, queue->committed, __ATOMIC_RELAXED);
+        return;
+
+    }
+
+    /* Streams the user has seen opened must still be closed, even if
+     * everything else is being discarded */
+    else if (type == GUAC_USER_QUEUE_END && queue->dropping
+            && queue->instruction_length <= GUAC_USER_QUEUE_HEADER_SIZE) {
+        if (guac_user_queue_append(queue, queue->header,
+                    queue->instruction_length, queue->size))
+            guac_user_log(queue->user, GUAC_LOG_DEBUG, "Output queue "
+                    "reserve exhausted. A stream may not be closed.");
+    }
+
+    size_t committed = queue->tail;
+    if (committed == queue->committed)
+        return;
+
+    /* Record instruction boundary, if there is room */
+    size_t boundary_tail = queue->boundary_tail;
+    if (boundary_tail - __atomic_load_n(&queue->boundary_head,
+                __ATOMIC_ACQUIRE) < GUAC_USER_QUEUE_MAX_BOUNDARIES) {
+        queue->boundaries[boundary_tail % GUAC_USER_QUEUE_MAX_BOUNDARIES] =
+            committed;
+        __atomic_store_n(&queue->boundary_tail, boundary_tail + 1,
+                __ATOMIC_RELEASE);
+    }
+
+    __atomic_store_n(&queue->committed, committed, __ATOMIC_SEQ_CST);
+
+    /* Wake writer early if a significant amount of data is waiting */
+    size_t head = __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+    if (committed - head >= queue->size / 4)
+        guac_user_queue_signal(queue);
+
+}
+
+void guac_user_queue_flush(guac_user_queue* queue) {
+
+    __atomic_store_n(&queue->flush_requested, queue->committed,
+            __ATOMIC_SEQ_CST);
+
+    guac_user_queue_signal(queue);
+
+}
+
+size_t guac_user_queue_depth(guac_user_queue* queue) {
+    return __atomic_load_n(&queue->tail, __ATOMIC_RELAXED)
+         - __atomic_load_n(&queue->head, __ATOMIC_RELAXED);
+}
+
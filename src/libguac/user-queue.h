@@ -0,0 +1,351 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUAC_USER_QUEUE_H
+#define GUAC_USER_QUEUE_H
+
+#include "config.h"
+
+#include "guacamole/client-types.h"
+#include "guacamole/user-types.h"
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * The maximum number of microseconds that the writer thread of a
+ * guac_user_queue will sleep while waiting for new data before rechecking
+ * the state of the queue.
+ */
+#define GUAC_USER_QUEUE_WAIT_TIMEOUT 250000
+
+/**
+ * The maximum number of instruction boundaries which may be recorded within a
+ * guac_user_queue at any one time. If more instructions are pending, the
+ * writer thread writes the excess as a single unit.
+ */
+#define GUAC_USER_QUEUE_MAX_BOUNDARIES 1024
+
+/**
+ * The maximum number of bytes at the beginning of each instruction which are
+ * retained for inspection by a guac_user_queue, regardless of whether that
+ * instruction is being discarded. This is sufficient to store the opcode and
+ * first argument of any stream-related instruction, as well as any complete
+ * "end" instruction.
+ */
+#define GUAC_USER_QUEUE_HEADER_SIZE 64
+
+/**
+ * The maximum number of bytes at the end of each guac_user_queue which are
+ * reserved for "end" instructions that close streams the user has already
+ * received. Queues smaller than four times this size reserve a quarter of
+ * their space instead.
+ */
+#define GUAC_USER_QUEUE_END_RESERVE 4096
+
+/**
+ * The kinds of instruction which a guac_user_queue must distinguish to avoid
+ * leaving streams partially sent when data is discarded.
+ */
+typedef enum guac_user_queue_instruction {
+
+    /**
+     * Any instruction which does not relate to a stream opened by the
+     * broadcast socket.
+     */
+    GUAC_USER_QUEUE_OTHER,
+
+    /**
+     * An instruction which opens a stream, such as "img" or "audio".
+     */
+    GUAC_USER_QUEUE_OPEN,
+
+    /**
+     * A "blob" instruction, which sends data along an open stream.
+     */
+    GUAC_USER_QUEUE_BLOB,
+
+    /**
+     * An "end" instruction, which closes an open stream.
+     */
+    GUAC_USER_QUEUE_END
+
+} guac_user_queue_instruction;
+
+/**
+ * Bounded, single-producer/single-consumer queue of outbound Guacamole
+ * protocol data for a single user. Data broadcast to all users is appended to
+ * the queue of each user by the thread writing to the broadcast socket, and is
+ * drained to the user's own socket by a dedicated writer thread, such that a
+ * user with a slow connection cannot stall the production of data for others.
+ *
+ * The producer and consumer coordinate exclusively through atomic updates of
+ * monotonically increasing byte positions within a circular buffer. Data is
+ * only made visible to the writer thread at instruction boundaries, such that
+ * the writer never writes a partial instruction to the user's socket, and the
+ * writer acquires the user's socket for one instruction at a time, such that
+ * user-specific instructions sent by other threads are not held back until
+ * the whole queue has drained.
+ *
+ * Data is only ever discarded in whole instructions, and never in a way which
+ * leaves a stream half-open for the user: the "end" instruction of any stream
+ * the user has seen opened is always queued, and the "blob" and "end"
+ * instructions of any stream whose opening instruction was discarded are
+ * discarded with it.
+ */
+struct guac_user_queue {
+
+    /**
+     * The user whose socket receives all data written to this queue.
+     */
+    guac_user* user;
+
+    /**
+     * What should happen if this queue overflows.
+     */
+    guac_client_queue_policy policy;
+
+    /**
+     * Circular buffer containing all queued data.
+     */
+    char* buffer;
+
+    /**
+     * The size of the circular buffer, in bytes.
+     */
+    size_t size;
+
+    /**
+     * The position of the next byte to be written to the user's socket. This
+     * is updated only by the writer thread.
+     */
+    size_t head;
+
+    /**
+     * The position at which the next byte appended to the queue will be
+     * stored. This is updated only by the producer and may point within a
+     * partially-queued instruction.
+     */
+    size_t tail;
+
+    /**
+     * The position immediately after the last complete instruction within
+     * the queue. Only data before this position is visible to the writer
+     * thread. This is updated only by the producer.
+     */
+    size_t committed;
+
+    /**
+     * The value of committed at the time the producer last requested that
+     * queued data be flushed to the user's socket.
+     */
+    size_t flush_requested;
+
+    /**
+     * The positions immediately after each complete instruction which has not
+     * yet been written, stored in order within a circular buffer. If this
+     * buffer is full when an instruction is committed, that instruction is
+     * not recorded, and is written together with the following instruction.
+     */
+    size_t boundaries[GUAC_USER_QUEUE_MAX_BOUNDARIES];
+
+    /**
+     * The number of instruction boundaries consumed from the boundaries
+     * buffer. This is updated only by the writer thread.
+     */
+    size_t boundary_head;
+
+    /**
+     * The number of instruction boundaries stored within the boundaries
+     * buffer. This is updated only by the producer.
+     */
+    size_t boundary_tail;
+
+    /**
+     * The first GUAC_USER_QUEUE_HEADER_SIZE bytes of the instruction
+     * currently being appended by the producer, retained even if that
+     * instruction is being discarded. This is accessed only by the producer.
+     */
+    char header[GUAC_USER_QUEUE_HEADER_SIZE];
+
+    /**
+     * The total length of the instruction currently being appended by the
+     * producer, in bytes, including any bytes which did not fit within the
+     * header buffer. This is accessed only by the producer.
+     */
+    size_t instruction_length;
+
+    /**
+     * Bitmask of the broadcast streams whose opening instruction was
+     * discarded, and whose "blob" and "end" instructions must therefore also
+     * be discarded. Bit N corresponds to the stream having index (N * 2) + 1,
+     * matching the odd indices allocated by guac_client_alloc_stream(). This
+     * is accessed only by the producer.
+     */
+    uint64_t discarded_streams;
+
+    /**
+     * Non-zero if the instruction currently being appended by the producer is
+     * being discarded, either because the queue is overflowed or because the
+     * instruction began before this queue was attached to the user. This is
+     * accessed only by the producer.
+     */
+    int dropping;
+
+    /**
+     * Non-zero if the queue has overflowed and all further data is being
+     * discarded until the user has been resynchronized. This is set by the
+     * producer and cleared by the writer thread immediately before the user
+     * is resynchronized.
+     */
+    int overflowed;
+
+    /**
+     * The total number of times this queue has overflowed.
+     */
+    unsigned int overflows;
+
+    /**
+     * Non-zero if the writer thread should stop.
+     */
+    int stopping;
+
+    /**
+     * Non-zero if the writer thread is currently waiting on the modified
+     * condition for new data.
+     */
+    int waiting;
+
+    /**
+     * Lock used solely to allow the writer thread to sleep while awaiting new
+     * data. This lock is never acquired by the producer unless the writer
+     * thread is known to be waiting.
+     */
+    pthread_mutex_t lock;
+
+    /**
+     * Condition which is signalled when new data has been committed, when a
+     * flush has been requested, or when the writer thread should stop.
+     */
+    pthread_cond_t modified;
+
+    /**
+     * The writer thread which drains this queue to the user's socket.
+     */
+    pthread_t writer;
+
+};
+
+/**
+ * Allocates a new output queue for the given user, starting a writer thread
+ * which drains that queue to the user's socket.
+ *
+ * @param user
+ *     The user whose socket should receive all data written to the queue.
+ *
+ * @param size
+ *     The maximum number of bytes that may be queued for the user.
+ *
+ * @param policy
+ *     What should happen if the queue overflows.
+ *
+ * @return
+ *     A newly-allocated output queue, or NULL if the queue or its writer
+ *     thread could not be created.
+ */
+guac_user_queue* guac_user_queue_alloc(guac_user* user, size_t size,
+        guac_client_queue_policy policy);
+
+/**
+ * Stops the writer thread of the given queue, waiting for that thread to
+ * terminate, and frees the queue. The user's socket is shut down first, such
+ * that a writer thread blocked on a stalled connection cannot delay this
+ * function indefinitely. Any data which has not yet been written to the
+ * user's socket is discarded. The queue must no longer be accessible to the
+ * producer when this function is invoked.
+ *
+ * @param queue
+ *     The queue to free.
+ */
+void guac_user_queue_free(guac_user_queue* queue);
+
+/**
+ * Notifies the given queue that a new instruction is about to be appended.
+ * If the queue is currently overflowed, the entire instruction will be
+ * discarded. Data written to the queue outside of a
+ * guac_user_queue_begin()/guac_user_queue_commit() pair is always discarded.
+ *
+ * @param queue
+ *     The queue which will receive the instruction.
+ */
+void guac_user_queue_begin(guac_user_queue* queue);
+
+/**
+ * Appends the given data to the given queue as part of the current
+ * instruction. If the data does not fit, the queue overflows, the current
+ * instruction is discarded, and the overflow policy of the queue is applied.
+ *
+ * @param queue
+ *     The queue to append data to.
+ *
+ * @param buffer
+ *     The data to append.
+ *
+ * @param length
+ *     The number of bytes of data to append.
+ */
+void guac_user_queue_write(guac_user_queue* queue, const void* buffer,
+        size_t length);
+
+/**
+ * Marks the end of the current instruction, making all data appended since
+ * the corresponding call to guac_user_queue_begin() visible to the writer
+ * thread, unless that instruction must be discarded to keep the streams
+ * seen by the user consistent.
+ *
+ * @param queue
+ *     The queue to commit.
+ */
+void guac_user_queue_commit(guac_user_queue* queue);
+
+/**
+ * Requests that all data committed to the given queue be written and flushed
+ * to the user's socket as soon as possible. This function does not wait for
+ * the data to be written.
+ *
+ * @param queue
+ *     The queue to flush.
+ */
+void guac_user_queue_flush(guac_user_queue* queue);
+
+/**
+ * Returns the number of bytes currently queued, including data belonging to
+ * any partially-appended instruction.
+ *
+ * @param queue
+ *     The queue to inspect.
+ *
+ * @return
+ *     The number of bytes currently queued.
+ */
+size_t guac_user_queue_depth(guac_user_queue* queue);
+
+#endif
+
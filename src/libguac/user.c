@@ -23,6 +23,7 @@
 #include "encode-png.h"
 #include "encode-webp.h"
 #include "guacamole/client.h"
+#include "guacamole/congestion.h"
 #include "guacamole/object.h"
 #include "guacamole/pool.h"
 #include "guacamole/protocol.h"
@@ -32,6 +33,7 @@
 #include "guacamole/user.h"
 #include "id.h"
 #include "user-handlers.h"
+#include "user-queue.h"
 
 #include <errno.h>
 #include <limits.h>
@@ -55,6 +57,14 @@ guac_user* guac_user_alloc() {
     user->processing_lag = 0;
     user->active = 1;
 
+    /* Allocate congestion controller */
+    user->congestion = guac_congestion_alloc();
+    if (user->congestion == NULL) {
+        free(user->user_id);
+        free(user);
+        return NULL;
+    }
+
     /* Allocate stream pool */
     user->__stream_pool = guac_pool_alloc(0);
 
@@ -94,6 +104,9 @@ void guac_user_free(guac_user* user) {
     /* Free object pool */
     guac_pool_free(user->__object_pool);
 
+    /* Free congestion controller */
+    guac_congestion_free(user->congestion);
+
     /* Clean up user */
     free(user->user_id);
     free(user);
@@ -178,6 +191,16 @@ void guac_user_stop(guac_user* user) {
     user->active = 0;
 }
 
+size_t guac_user_get_queue_depth(guac_user* user) {
+
+    /* Users without queues have nothing pending */
+    if (user->__output_queue == NULL)
+        return 0;
+
+    return guac_user_queue_depth(user->__output_queue);
+
+}
+
 void vguac_user_abort(guac_user* user, guac_protocol_status status,
         const char* format, va_list ap) {
 
@@ -260,7 +283,8 @@ void guac_user_stream_png(guac_user* user, guac_socket* socket,
     guac_protocol_send_img(socket, stream, mode, layer, "image/png", x, y);
 
     /* Write PNG data */
-    guac_png_write(socket, stream, surface);
+    guac_png_write(socket, stream, surface,
+            user->client->png_compression_level, user->client->png_strategy);
 
     /* Terminate stream */
     guac_protocol_send_end(socket, stream);
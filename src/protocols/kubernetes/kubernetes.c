@@ -236,7 +236,11 @@ void* guac_kubernetes_client_thread(void* data) {
                 !settings->recording_exclude_output,
                 !settings->recording_exclude_mouse,
                 0, /* Touch events not supported */
-                settings->recording_include_keys);
+                settings->recording_include_keys,
+                settings->recording_write_index,
+                settings->recording_buffer_size,
+                settings->recording_drop_on_overflow,
+                settings->recording_compression);
     }
 
     /* Create terminal */
@@ -244,7 +248,8 @@ void* guac_kubernetes_client_thread(void* data) {
             kubernetes_client->clipboard, settings->disable_copy,
             settings->max_scrollback, settings->font_name, settings->font_size,
             settings->resolution, settings->width, settings->height,
-            settings->color_scheme, settings->backspace);
+            settings->color_scheme, settings->backspace,
+            settings->glyph_buffers);
 
     /* Fail if terminal init failed */
     if (kubernetes_client->term == NULL) {
@@ -122,3 +122,16 @@ int guac_kubernetes_user_leave_handler(guac_user* user) {
     return 0;
 }
 
+int guac_kubernetes_user_resync_handler(guac_user* user) {
+
+    guac_kubernetes_client* kubernetes_client = (guac_kubernetes_client*) user->client->data;
+
+    /* Nothing to synchronize if the terminal does not yet exist */
+    if (kubernetes_client->term == NULL)
+        return 0;
+
+    /* Synchronize with current display */
+    guac_terminal_dup(kubernetes_client->term, user, user->socket);
+    return 0;
+
+}
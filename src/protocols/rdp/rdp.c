@@ -480,7 +480,11 @@ static int guac_rdp_handle_connection(guac_client* client) {
                 !settings->recording_exclude_output,
                 !settings->recording_exclude_mouse,
                 !settings->recording_exclude_touch,
-                settings->recording_include_keys);
+                settings->recording_include_keys,
+                settings->recording_write_index,
+                settings->recording_buffer_size,
+                settings->recording_drop_on_overflow,
+                settings->recording_compression);
     }
 
     /* Create display */
@@ -492,6 +496,10 @@ static int guac_rdp_handle_connection(guac_client* client) {
      * heuristics) */
     guac_common_display_set_lossless(rdp_client->display, settings->lossless);
 
+    /* Limit size of cache of previously-sent image data */
+    guac_common_display_set_image_cache_size(rdp_client->display,
+            settings->image_cache_size);
+
     rdp_client->current_surface = rdp_client->display->default_surface;
 
     rdp_client->available_svc = guac_common_list_alloc();
@@ -555,7 +563,7 @@ static int guac_rdp_handle_connection(guac_client* client) {
                 GUAC_RDP_FRAME_START_TIMEOUT);
         if (wait_result > 0) {
 
-            int processing_lag = guac_client_get_processing_lag(client);
+            int frame_duration = guac_client_get_frame_duration(client);
             guac_timestamp frame_start = guac_timestamp_current();
 
             /* Read server messages until frame is built */
@@ -583,9 +591,10 @@ static int guac_rdp_handle_connection(guac_client* client) {
 
                 /* Calculate time that client needs to catch up */
                 int time_elapsed = frame_end - last_frame_end;
-                int required_wait = processing_lag - time_elapsed;
+                int required_wait = frame_duration - time_elapsed;
 
-                /* Increase the duration of this frame if client is lagging */
+                /* Increase the duration of this frame if client is lagging or
+                 * congested, combining further updates into this frame */
                 if (required_wait > GUAC_RDP_FRAME_TIMEOUT)
                     wait_result = rdp_guac_client_wait_for_messages(client,
                             required_wait);
@@ -19,6 +19,7 @@
 
 #include "argv.h"
 #include "common/defaults.h"
+#include "common/image-cache.h"
 #include "common/string.h"
 #include "config.h"
 #include "resolution.h"
@@ -106,6 +107,10 @@ const char* GUAC_RDP_CLIENT_ARGS[] = {
     "recording-exclude-mouse",
     "recording-exclude-touch",
     "recording-include-keys",
+    "recording-write-index",
+    "recording-buffer-size",
+    "recording-drop-on-overflow",
+    "recording-compression",
     "create-recording-path",
     "resize-method",
     "enable-audio-input",
@@ -130,6 +135,7 @@ const char* GUAC_RDP_CLIENT_ARGS[] = {
     "wol-wait-time",
 
     "force-lossless",
+    "image-cache-size",
     NULL
 };
 
@@ -520,6 +526,37 @@ enum RDP_ARGS_IDX {
      */
     IDX_RECORDING_INCLUDE_KEYS,
 
+    /**
+     * Whether a sidecar index should be written alongside the session
+     * recording, allowing playback and analysis tools to begin at an
+     * arbitrary point in time. The index is NOT written by default.
+     */
+    IDX_RECORDING_WRITE_INDEX,
+
+    /**
+     * The maximum number of bytes of recorded data which may be held in
+     * memory while waiting to be written to the session recording. By
+     * default, up to 16 MiB of recorded data may be held in memory.
+     */
+    IDX_RECORDING_BUFFER_SIZE,
+
+    /**
+     * Whether recorded data should be discarded, rather than stalling the
+     * session, if the session recording cannot be written quickly enough for
+     * the amount of recorded data held in memory to remain within
+     * "recording-buffer-size". Any discarded data is marked within the
+     * recording with a "gap" instruction. Recorded data is NOT discarded by
+     * default.
+     */
+    IDX_RECORDING_DROP_ON_OVERFLOW,
+
+    /**
+     * The compression format which should be used to compress the session
+     * recording as it is written. Legal values are "none" and "gzip". Session
+     * recordings are NOT compressed by default.
+     */
+    IDX_RECORDING_COMPRESSION,
+
     /**
      * Whether the specified screen recording path should automatically be
      * created if it does not yet exist.
@@ -647,6 +684,13 @@ enum RDP_ARGS_IDX {
      */
     IDX_FORCE_LOSSLESS,
 
+    /**
+     * The maximum number of bytes of image data which may be cached and reused
+     * client-side for graphical updates which exactly repeat earlier updates,
+     * or "0" to disable this caching. If blank, a default size is used.
+     */
+    IDX_IMAGE_CACHE_SIZE,
+
     RDP_ARGS_COUNT
 };
 
@@ -792,6 +836,15 @@ guac_rdp_settings* guac_rdp_parse_args(guac_user* user,
         guac_user_parse_args_boolean(user, GUAC_RDP_CLIENT_ARGS, argv,
                 IDX_FORCE_LOSSLESS, 0);
 
+    /* Image cache size */
+    settings->image_cache_size =
+        guac_user_parse_args_int(user, GUAC_RDP_CLIENT_ARGS, argv,
+                IDX_IMAGE_CACHE_SIZE, GUAC_COMMON_IMAGE_CACHE_DEFAULT_SIZE);
+
+    /* Negative cache sizes make no sense; treat as disabled */
+    if (settings->image_cache_size < 0)
+        settings->image_cache_size = 0;
+
     /* Domain */
     settings->domain =
         guac_user_parse_args_string(user, GUAC_RDP_CLIENT_ARGS, argv,
@@ -1088,6 +1141,26 @@ guac_rdp_settings* guac_rdp_parse_args(guac_user* user,
         guac_user_parse_args_boolean(user, GUAC_RDP_CLIENT_ARGS, argv,
                 IDX_RECORDING_INCLUDE_KEYS, 0);
 
+    /* Parse recording index flag */
+    settings->recording_write_index =
+        guac_user_parse_args_boolean(user, GUAC_RDP_CLIENT_ARGS, argv,
+                IDX_RECORDING_WRITE_INDEX, 0);
+
+    /* Parse recording buffer size */
+    settings->recording_buffer_size =
+        guac_user_parse_args_int(user, GUAC_RDP_CLIENT_ARGS, argv,
+                IDX_RECORDING_BUFFER_SIZE, 0);
+
+    /* Parse recording overflow policy */
+    settings->recording_drop_on_overflow =
+        guac_user_parse_args_boolean(user, GUAC_RDP_CLIENT_ARGS, argv,
+                IDX_RECORDING_DROP_ON_OVERFLOW, 0);
+
+    /* Parse recording compression format */
+    settings->recording_compression =
+        guac_user_parse_args_string(user, GUAC_RDP_CLIENT_ARGS, argv,
+                IDX_RECORDING_COMPRESSION, NULL);
+
     /* Parse path creation flag */
     settings->create_recording_path =
         guac_user_parse_args_boolean(user, GUAC_RDP_CLIENT_ARGS, argv,
@@ -1220,6 +1293,7 @@ void guac_rdp_settings_free(guac_rdp_settings* settings) {
     free(settings->initial_program);
     free(settings->password);
     free(settings->preconnection_blob);
+    free(settings->recording_compression);
     free(settings->recording_name);
     free(settings->recording_path);
     free(settings->remote_app);
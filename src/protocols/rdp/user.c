@@ -105,6 +105,9 @@ int guac_rdp_user_join_handler(guac_user* user, int argc, char** argv) {
         user->mouse_handler = guac_rdp_user_mouse_handler;
         user->key_handler = guac_rdp_user_key_handler;
 
+        /* Drop stale pointer motion rather than replaying it to the server */
+        user->coalesce_input = 1;
+
         /* Multi-touch events */
         if (settings->enable_touch)
             user->touch_handler = guac_rdp_user_touch_handler;
@@ -177,3 +180,16 @@ int guac_rdp_user_leave_handler(guac_user* user) {
     return 0;
 }
 
+int guac_rdp_user_resync_handler(guac_user* user) {
+
+    guac_rdp_client* rdp_client = (guac_rdp_client*) user->client->data;
+
+    /* Nothing to synchronize if the display does not yet exist */
+    if (rdp_client->display == NULL)
+        return 0;
+
+    /* Synchronize with current display */
+    guac_common_display_dup(rdp_client->display, user, user->socket);
+    return 0;
+
+}
@@ -32,6 +32,11 @@ guac_user_join_handler guac_rdp_user_join_handler;
  */
 guac_user_leave_handler guac_rdp_user_leave_handler;
 
+/**
+ * Handler for resynchronizing users which have fallen behind.
+ */
+guac_user_resync_handler guac_rdp_user_resync_handler;
+
 /**
  * Handler for received simple file uploads. This handler will automatically
  * select between RDPDR and SFTP depending on which is available and which has
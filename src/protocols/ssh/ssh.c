@@ -235,7 +235,11 @@ void* ssh_client_thread(void* data) {
                 !settings->recording_exclude_output,
                 !settings->recording_exclude_mouse,
                 0, /* Touch events not supported */
-                settings->recording_include_keys);
+                settings->recording_include_keys,
+                settings->recording_write_index,
+                settings->recording_buffer_size,
+                settings->recording_drop_on_overflow,
+                settings->recording_compression);
     }
 
     /* Create terminal */
@@ -243,7 +247,7 @@ void* ssh_client_thread(void* data) {
             settings->disable_copy, settings->max_scrollback,
             settings->font_name, settings->font_size, settings->resolution,
             settings->width, settings->height, settings->color_scheme,
-            settings->backspace);
+            settings->backspace, settings->glyph_buffers);
 
     /* Fail if terminal init failed */
     if (ssh_client->term == NULL) {
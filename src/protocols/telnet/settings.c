@@ -51,6 +51,10 @@ const char* GUAC_TELNET_CLIENT_ARGS[] = {
     "recording-exclude-output",
     "recording-exclude-mouse",
     "recording-include-keys",
+    "recording-write-index",
+    "recording-buffer-size",
+    "recording-drop-on-overflow",
+    "recording-compression",
     "create-recording-path",
     "read-only",
     "backspace",
@@ -65,6 +69,7 @@ const char* GUAC_TELNET_CLIENT_ARGS[] = {
     "wol-broadcast-addr",
     "wol-udp-port",
     "wol-wait-time",
+    "glyph-buffers",
     NULL
 };
 
@@ -179,6 +184,37 @@ enum TELNET_ARGS_IDX {
      */
     IDX_RECORDING_INCLUDE_KEYS,
 
+    /**
+     * Whether a sidecar index should be written alongside the session
+     * recording, allowing playback and analysis tools to begin at an
+     * arbitrary point in time. The index is NOT written by default.
+     */
+    IDX_RECORDING_WRITE_INDEX,
+
+    /**
+     * The maximum number of bytes of recorded data which may be held in
+     * memory while waiting to be written to the session recording. By
+     * default, up to 16 MiB of recorded data may be held in memory.
+     */
+    IDX_RECORDING_BUFFER_SIZE,
+
+    /**
+     * Whether recorded data should be discarded, rather than stalling the
+     * session, if the session recording cannot be written quickly enough for
+     * the amount of recorded data held in memory to remain within
+     * "recording-buffer-size". Any discarded data is marked within the
+     * recording with a "gap" instruction. Recorded data is NOT discarded by
+     * default.
+     */
+    IDX_RECORDING_DROP_ON_OVERFLOW,
+
+    /**
+     * The compression format which should be used to compress the session
+     * recording as it is written. Legal values are "none" and "gzip". Session
+     * recordings are NOT compressed by default.
+     */
+    IDX_RECORDING_COMPRESSION,
+
     /**
      * Whether the specified screen recording path should automatically be
      * created if it does not yet exist.
@@ -271,6 +307,14 @@ enum TELNET_ARGS_IDX {
      */
     IDX_WOL_WAIT_TIME,
 
+    /**
+     * Whether rendered glyphs should be stored within client-side buffers
+     * and drawn using "copy" instructions rather than being sent as image
+     * data each time they are drawn. By default, glyphs are sent as image
+     * data.
+     */
+    IDX_GLYPH_BUFFERS,
+
     TELNET_ARGS_COUNT
 };
 
@@ -468,6 +512,26 @@ guac_telnet_settings* guac_telnet_parse_args(guac_user* user,
         guac_user_parse_args_boolean(user, GUAC_TELNET_CLIENT_ARGS, argv,
                 IDX_RECORDING_INCLUDE_KEYS, false);
 
+    /* Parse recording index flag */
+    settings->recording_write_index =
+        guac_user_parse_args_boolean(user, GUAC_TELNET_CLIENT_ARGS, argv,
+                IDX_RECORDING_WRITE_INDEX, false);
+
+    /* Parse recording buffer size */
+    settings->recording_buffer_size =
+        guac_user_parse_args_int(user, GUAC_TELNET_CLIENT_ARGS, argv,
+                IDX_RECORDING_BUFFER_SIZE, 0);
+
+    /* Parse recording overflow policy */
+    settings->recording_drop_on_overflow =
+        guac_user_parse_args_boolean(user, GUAC_TELNET_CLIENT_ARGS, argv,
+                IDX_RECORDING_DROP_ON_OVERFLOW, false);
+
+    /* Parse recording compression format */
+    settings->recording_compression =
+        guac_user_parse_args_string(user, GUAC_TELNET_CLIENT_ARGS, argv,
+                IDX_RECORDING_COMPRESSION, NULL);
+
     /* Parse path creation flag */
     settings->create_recording_path =
         guac_user_parse_args_boolean(user, GUAC_TELNET_CLIENT_ARGS, argv,
@@ -492,6 +556,11 @@ guac_telnet_settings* guac_telnet_parse_args(guac_user* user,
     settings->disable_paste =
         guac_user_parse_args_boolean(user, GUAC_TELNET_CLIENT_ARGS, argv,
                 IDX_DISABLE_PASTE, false);
+
+    /* Parse client-side glyph buffer flag */
+    settings->glyph_buffers =
+        guac_user_parse_args_boolean(user, GUAC_TELNET_CLIENT_ARGS, argv,
+                IDX_GLYPH_BUFFERS, false);
     
     /* Parse Wake-on-LAN (WoL) settings */
     settings->wol_send_packet =
@@ -559,6 +628,7 @@ void guac_telnet_settings_free(guac_telnet_settings* settings) {
     free(settings->typescript_path);
 
     /* Free screen recording settings */
+    free(settings->recording_compression);
     free(settings->recording_name);
     free(settings->recording_path);
 
@@ -185,6 +185,13 @@ typedef struct guac_telnet_settings {
      */
     bool disable_paste;
 
+    /**
+     * Whether rendered glyphs should be stored within client-side buffers,
+     * such that repeated glyphs are drawn using "copy" instructions rather
+     * than by sending image data.
+     */
+    bool glyph_buffers;
+
     /**
      * The path in which the typescript should be saved, if enabled. If no
      * typescript should be saved, this will be NULL.
@@ -245,6 +252,33 @@ typedef struct guac_telnet_settings {
      */
     bool recording_include_keys;
 
+    /**
+     * Whether a sidecar index should be written alongside the session
+     * recording, allowing playback and analysis tools to begin at an
+     * arbitrary point in time.
+     */
+    bool recording_write_index;
+
+    /**
+     * The maximum number of bytes of recorded data which may be held in
+     * memory while waiting to be written to the session recording, or zero
+     * to use the default.
+     */
+    int recording_buffer_size;
+
+    /**
+     * Whether recorded data should be discarded, rather than stalling the
+     * session, if the session recording cannot be written quickly enough.
+     */
+    bool recording_drop_on_overflow;
+
+    /**
+     * The name of the compression format which should be used to compress
+     * the session recording, or NULL if the recording should not be
+     * compressed.
+     */
+    char* recording_compression;
+
     /**
      * The ASCII code, as an integer, that the telnet client will use when the
      * backspace key is pressed.  By default, this is 127, ASCII delete, if
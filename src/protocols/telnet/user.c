@@ -120,3 +120,16 @@ int guac_telnet_user_leave_handler(guac_user* user) {
     return 0;
 }
 
+int guac_telnet_user_resync_handler(guac_user* user) {
+
+    guac_telnet_client* telnet_client = (guac_telnet_client*) user->client->data;
+
+    /* Nothing to synchronize if the terminal does not yet exist */
+    if (telnet_client->term == NULL)
+        return 0;
+
+    /* Synchronize with current display */
+    guac_terminal_dup(telnet_client->term, user, user->socket);
+    return 0;
+
+}
@@ -34,5 +34,10 @@ guac_user_join_handler guac_telnet_user_join_handler;
  */
 guac_user_leave_handler guac_telnet_user_leave_handler;
 
+/**
+ * Handler for resynchronizing users which have fallen behind.
+ */
+guac_user_resync_handler guac_telnet_user_resync_handler;
+
 #endif
 
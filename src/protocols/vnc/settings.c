@@ -22,6 +22,7 @@
 #include "argv.h"
 #include "client.h"
 #include "common/defaults.h"
+#include "common/image-cache.h"
 #include "settings.h"
 
 #include <guacamole/user.h>
@@ -82,6 +83,10 @@ const char* GUAC_VNC_CLIENT_ARGS[] = {
     "recording-exclude-output",
     "recording-exclude-mouse",
     "recording-include-keys",
+    "recording-write-index",
+    "recording-buffer-size",
+    "recording-drop-on-overflow",
+    "recording-compression",
     "create-recording-path",
     "disable-copy",
     "disable-paste",
@@ -93,6 +98,7 @@ const char* GUAC_VNC_CLIENT_ARGS[] = {
     "wol-wait-time",
 
     "force-lossless",
+    "image-cache-size",
     NULL
 };
 
@@ -324,6 +330,37 @@ enum VNC_ARGS_IDX {
      */
     IDX_RECORDING_INCLUDE_KEYS,
 
+    /**
+     * Whether a sidecar index should be written alongside the session
+     * recording, allowing playback and analysis tools to begin at an
+     * arbitrary point in time. The index is NOT written by default.
+     */
+    IDX_RECORDING_WRITE_INDEX,
+
+    /**
+     * The maximum number of bytes of recorded data which may be held in
+     * memory while waiting to be written to the session recording. By
+     * default, up to 16 MiB of recorded data may be held in memory.
+     */
+    IDX_RECORDING_BUFFER_SIZE,
+
+    /**
+     * Whether recorded data should be discarded, rather than stalling the
+     * session, if the session recording cannot be written quickly enough for
+     * the amount of recorded data held in memory to remain within
+     * "recording-buffer-size". Any discarded data is marked within the
+     * recording with a "gap" instruction. Recorded data is NOT discarded by
+     * default.
+     */
+    IDX_RECORDING_DROP_ON_OVERFLOW,
+
+    /**
+     * The compression format which should be used to compress the session
+     * recording as it is written. Legal values are "none" and "gzip". Session
+     * recordings are NOT compressed by default.
+     */
+    IDX_RECORDING_COMPRESSION,
+
     /**
      * Whether the specified screen recording path should automatically be
      * created if it does not yet exist.
@@ -381,6 +418,13 @@ enum VNC_ARGS_IDX {
      */
     IDX_FORCE_LOSSLESS,
 
+    /**
+     * The maximum number of bytes of image data which may be cached and reused
+     * client-side for graphical updates which exactly repeat earlier updates,
+     * or "0" to disable this caching. If blank, a default size is used.
+     */
+    IDX_IMAGE_CACHE_SIZE,
+
     VNC_ARGS_COUNT
 };
 
@@ -445,6 +489,15 @@ guac_vnc_settings* guac_vnc_parse_args(guac_user* user,
         guac_user_parse_args_boolean(user, GUAC_VNC_CLIENT_ARGS, argv,
                 IDX_FORCE_LOSSLESS, false);
 
+    /* Image cache size */
+    settings->image_cache_size =
+        guac_user_parse_args_int(user, GUAC_VNC_CLIENT_ARGS, argv,
+                IDX_IMAGE_CACHE_SIZE, GUAC_COMMON_IMAGE_CACHE_DEFAULT_SIZE);
+
+    /* Negative cache sizes make no sense; treat as disabled */
+    if (settings->image_cache_size < 0)
+        settings->image_cache_size = 0;
+
 #ifdef ENABLE_VNC_REPEATER
     /* Set repeater parameters if specified */
     settings->dest_host =
@@ -588,6 +641,26 @@ guac_vnc_settings* guac_vnc_parse_args(guac_user* user,
         guac_user_parse_args_boolean(user, GUAC_VNC_CLIENT_ARGS, argv,
                 IDX_RECORDING_INCLUDE_KEYS, false);
 
+    /* Parse recording index flag */
+    settings->recording_write_index =
+        guac_user_parse_args_boolean(user, GUAC_VNC_CLIENT_ARGS, argv,
+                IDX_RECORDING_WRITE_INDEX, false);
+
+    /* Parse recording buffer size */
+    settings->recording_buffer_size =
+        guac_user_parse_args_int(user, GUAC_VNC_CLIENT_ARGS, argv,
+                IDX_RECORDING_BUFFER_SIZE, 0);
+
+    /* Parse recording overflow policy */
+    settings->recording_drop_on_overflow =
+        guac_user_parse_args_boolean(user, GUAC_VNC_CLIENT_ARGS, argv,
+                IDX_RECORDING_DROP_ON_OVERFLOW, false);
+
+    /* Parse recording compression format */
+    settings->recording_compression =
+        guac_user_parse_args_string(user, GUAC_VNC_CLIENT_ARGS, argv,
+                IDX_RECORDING_COMPRESSION, NULL);
+
     /* Parse path creation flag */
     settings->create_recording_path =
         guac_user_parse_args_boolean(user, GUAC_VNC_CLIENT_ARGS, argv,
@@ -650,6 +723,7 @@ void guac_vnc_settings_free(guac_vnc_settings* settings) {
     free(settings->encodings);
     free(settings->hostname);
     free(settings->password);
+    free(settings->recording_compression);
     free(settings->recording_name);
     free(settings->recording_path);
     free(settings->username);
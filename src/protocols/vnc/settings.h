@@ -83,6 +83,13 @@ typedef struct guac_vnc_settings {
      */
     bool lossless;
 
+    /**
+     * The maximum number of bytes of image data which may be cached
+     * client-side for reuse by later graphical updates, or zero if such
+     * caching is disabled.
+     */
+    int image_cache_size;
+
 #ifdef ENABLE_VNC_REPEATER
     /**
      * The VNC host to connect to, if using a repeater.
@@ -275,6 +282,33 @@ typedef struct guac_vnc_settings {
      * as passwords, credit card numbers, etc.
      */
     bool recording_include_keys;
+
+    /**
+     * Whether a sidecar index should be written alongside the session
+     * recording, allowing playback and analysis tools to begin at an
+     * arbitrary point in time.
+     */
+    bool recording_write_index;
+
+    /**
+     * The maximum number of bytes of recorded data which may be held in
+     * memory while waiting to be written to the session recording, or zero
+     * to use the default.
+     */
+    int recording_buffer_size;
+
+    /**
+     * Whether recorded data should be discarded, rather than stalling the
+     * session, if the session recording cannot be written quickly enough.
+     */
+    bool recording_drop_on_overflow;
+
+    /**
+     * The name of the compression format which should be used to compress
+     * the session recording, or NULL if the recording should not be
+     * compressed.
+     */
+    char* recording_compression;
     
     /**
      * Whether or not to send the magic Wake-on-LAN (WoL) packet prior to
@@ -96,6 +96,9 @@ int guac_vnc_user_join_handler(guac_user* user, int argc, char** argv) {
         user->mouse_handler = guac_vnc_user_mouse_handler;
         user->key_handler = guac_vnc_user_key_handler;
 
+        /* Drop stale pointer motion rather than replaying it to the server */
+        user->coalesce_input = 1;
+
         /* Inbound (client to server) clipboard transfer */
         if (!settings->disable_paste)
             user->clipboard_handler = guac_vnc_clipboard_handler;
@@ -134,3 +137,16 @@ int guac_vnc_user_leave_handler(guac_user* user) {
     return 0;
 }
 
+int guac_vnc_user_resync_handler(guac_user* user) {
+
+    guac_vnc_client* vnc_client = (guac_vnc_client*) user->client->data;
+
+    /* Nothing to synchronize if the display does not yet exist */
+    if (vnc_client->display == NULL)
+        return 0;
+
+    /* Synchronize with current display */
+    guac_common_display_dup(vnc_client->display, user, user->socket);
+    return 0;
+
+}
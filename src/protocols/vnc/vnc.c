@@ -428,7 +428,11 @@ void* guac_vnc_client_thread(void* data) {
                 !settings->recording_exclude_output,
                 !settings->recording_exclude_mouse,
                 0, /* Touch events not supported */
-                settings->recording_include_keys);
+                settings->recording_include_keys,
+                settings->recording_write_index,
+                settings->recording_buffer_size,
+                settings->recording_drop_on_overflow,
+                settings->recording_compression);
     }
 
     /* Create display */
@@ -439,6 +443,10 @@ void* guac_vnc_client_thread(void* data) {
      * heuristics) */
     guac_common_display_set_lossless(vnc_client->display, settings->lossless);
 
+    /* Limit size of cache of previously-sent image data */
+    guac_common_display_set_image_cache_size(vnc_client->display,
+            settings->image_cache_size);
+
     /* If not read-only, set an appropriate cursor */
     if (settings->read_only == 0) {
         if (settings->remote_cursor)
@@ -460,7 +468,7 @@ void* guac_vnc_client_thread(void* data) {
                 GUAC_VNC_FRAME_START_TIMEOUT);
         if (wait_result > 0) {
 
-            int processing_lag = guac_client_get_processing_lag(client);
+            int frame_duration = guac_client_get_frame_duration(client);
             guac_timestamp frame_start = guac_timestamp_current();
 
             /* Read server messages until frame is built */
@@ -484,9 +492,10 @@ void* guac_vnc_client_thread(void* data) {
 
                 /* Calculate time that client needs to catch up */
                 int time_elapsed = frame_end - last_frame_end;
-                int required_wait = processing_lag - time_elapsed;
+                int required_wait = frame_duration - time_elapsed;
 
-                /* Increase the duration of this frame if client is lagging */
+                /* Increase the duration of this frame if client is lagging or
+                 * congested, combining further updates into this frame */
                 if (required_wait > GUAC_VNC_FRAME_TIMEOUT)
                     wait_result = guac_vnc_wait_for_messages(rfb_client,
                             required_wait*1000);
@@ -513,7 +522,7 @@ void* guac_vnc_client_thread(void* data) {
             guac_client_abort(client, GUAC_PROTOCOL_STATUS_UPSTREAM_ERROR, "Connection closed.");
 
         /* Flush frame */
-        guac_common_surface_flush(vnc_client->display->default_surface);
+        guac_common_display_flush(vnc_client->display);
         guac_client_end_frame(client);
         guac_socket_flush(client->socket);
 
@@ -22,39 +22,480 @@
 #include "terminal/buffer.h"
 #include "terminal/common.h"
 
+#include <guacamole/client.h>
+
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
-guac_terminal_buffer* guac_terminal_buffer_alloc(int rows, guac_terminal_char* default_character) {
+/**
+ * The number of bytes required to store each column of a row: the codepoint,
+ * the index of the attributes, and the width of the character.
+ */
+#define GUAC_TERMINAL_BUFFER_COLUMN_SIZE \
+    (sizeof(int) + sizeof(uint16_t) + sizeof(unsigned char))
+
+/**
+ * Returns whether the given colors are exactly identical, including both
+ * palette index and RGB components.
+ *
+ * @param a
+ *     The first color to compare.
+ *
+ * @param b
+ *     The second color to compare.
+ *
+ * @return
+ *     true if the colors are identical, false otherwise.
+ */
+static bool __guac_terminal_buffer_color_equal(const guac_terminal_color* a,
+        const guac_terminal_color* b) {
+
+    return a->palette_index == b->palette_index
+        && a->red   == b->red
+        && a->green == b->green
+        && a->blue  == b->blue;
+
+}
+
+/**
+ * Returns whether the given sets of attributes are exactly identical.
+ *
+ * @param a
+ *     The first set of attributes to compare.
+ *
+ * @param b
+ *     The second set of attributes to compare.
+ *
+ * @return
+ *     true if the attributes are identical, false otherwise.
+ */
+static bool __guac_terminal_buffer_attributes_equal(
+        const guac_terminal_attributes* a, const guac_terminal_attributes* b) {
+
+    return a->bold        == b->bold
+        && a->half_bright == b->half_bright
+        && a->reverse     == b->reverse
+        && a->cursor      == b->cursor
+        && a->underscore  == b->underscore
+        && __guac_terminal_buffer_color_equal(&a->foreground, &b->foreground)
+        && __guac_terminal_buffer_color_equal(&a->background, &b->background);
+
+}
+
+/**
+ * Returns a hash of the given color. Identical colors always produce the
+ * same hash.
+ *
+ * @param color
+ *     The color to hash.
+ *
+ * @return
+ *     A hash of the given color.
+ */
+static unsigned int __guac_terminal_buffer_color_hash(
+        const guac_terminal_color* color) {
+
+    return ((unsigned int) color->palette_index * 16777619u)
+        ^ ((unsigned int) color->red << 16)
+        ^ ((unsigned int) color->green << 8)
+        ^  (unsigned int) color->blue;
+
+}
+
+/**
+ * Returns a hash of the given set of attributes. Identical attributes always
+ * produce the same hash.
+ *
+ * @param attributes
+ *     The attributes to hash.
+ *
+ * @return
+ *     A hash of the given attributes.
+ */
+static unsigned int __guac_terminal_buffer_attributes_hash(
+        const guac_terminal_attributes* attributes) {
+
+    unsigned int hash =
+          (attributes->bold        ? 0x01 : 0)
+        | (attributes->half_bright ? 0x02 : 0)
+        | (attributes->reverse     ? 0x04 : 0)
+        | (attributes->cursor      ? 0x08 : 0)
+        | (attributes->underscore  ? 0x10 : 0);
+
+    hash = hash * 31 + __guac_terminal_buffer_color_hash(&attributes->foreground);
+    hash = hash * 31 + __guac_terminal_buffer_color_hash(&attributes->background);
+
+    /* Mix high bits into the low bits used for lookup */
+    hash ^= hash >> 15;
+    hash *= 0x2C1B3C6D;
+    hash ^= hash >> 12;
+
+    return hash;
+
+}
+
+/**
+ * Returns the squared distance between the RGB components of the given
+ * colors.
+ *
+ * @param a
+ *     The first color to compare.
+ *
+ * @param b
+ *     The second color to compare.
+ *
+ * @return
+ *     The sum of the squared differences of the red, green, and blue
+ *     components of the given colors.
+ */
+static int __guac_terminal_buffer_color_distance(const guac_terminal_color* a,
+        const guac_terminal_color* b) {
+
+    int red   = a->red   - b->red;
+    int green = a->green - b->green;
+    int blue  = a->blue  - b->blue;
+
+    return red * red + green * green + blue * blue;
+
+}
+
+/**
+ * Returns a measure of how visibly different the given sets of attributes
+ * are. Each differing flag counts as more distant than any difference in
+ * color, such that the closest attributes first match as many flags as
+ * possible, then are as close in color as possible.
+ *
+ * @param a
+ *     The first set of attributes to compare.
+ *
+ * @param b
+ *     The second set of attributes to compare.
+ *
+ * @return
+ *     The distance between the given sets of attributes, where zero denotes
+ *     attributes which appear identical.
+ */
+static long __guac_terminal_buffer_attributes_distance(
+        const guac_terminal_attributes* a, const guac_terminal_attributes* b) {
+
+    /* Exceeds the combined distance of any two pairs of colors */
+    const long flag_distance = 2 * 3 * 255 * 255 + 1;
+
+    int flags = (a->bold        != b->bold)
+              + (a->half_bright != b->half_bright)
+              + (a->reverse     != b->reverse)
+              + (a->cursor      != b->cursor)
+              + (a->underscore  != b->underscore);
+
+    return flags * flag_distance
+        + __guac_terminal_buffer_color_distance(&a->foreground, &b->foreground)
+        + __guac_terminal_buffer_color_distance(&a->background, &b->background);
+
+}
+
+/**
+ * Adds the attributes at the given index of the attribute table to the hash
+ * table used to locate those attributes. The hash table MUST contain at least
+ * one unused entry.
+ *
+ * @param buffer
+ *     The buffer whose hash table should be updated.
+ *
+ * @param index
+ *     The index of the attributes within the attribute table.
+ */
+static void __guac_terminal_buffer_add_lookup(guac_terminal_buffer* buffer,
+        int index) {
+
+    int mask = buffer->attributes_available * 2 - 1;
+    int slot = __guac_terminal_buffer_attributes_hash(
+            &buffer->attributes[index]) & mask;
+
+    /* Find next unused entry */
+    while (buffer->attribute_lookup[slot] != 0)
+        slot = (slot + 1) & mask;
+
+    buffer->attribute_lookup[slot] = index + 1;
+
+}
+
+/**
+ * Reallocates the hash table of the given buffer to match the current size of
+ * its attribute table, adding all attributes currently within that table.
+ *
+ * @param buffer
+ *     The buffer whose hash table should be rebuilt.
+ */
+static void __guac_terminal_buffer_rebuild_lookup(
+        guac_terminal_buffer* buffer) {
+
+    int i;
+
+    free(buffer->attribute_lookup);
+    buffer->attribute_lookup = calloc(buffer->attributes_available * 2,
+            sizeof(int));
+
+    for (i = 0; i < buffer->attributes_length; i++)
+        __guac_terminal_buffer_add_lookup(buffer, i);
+
+    buffer->last_attributes = 0;
+    buffer->last_approximation = -1;
+
+}
+
+/**
+ * Removes all attributes which are no longer used by any character within the
+ * given buffer from its attribute table, updating the indices stored within
+ * all rows accordingly. The attributes of the default character are always
+ * retained at index 0.
+ *
+ * @param buffer
+ *     The buffer whose attribute table should be compacted.
+ *
+ * @return
+ *     The number of entries freed within the attribute table, which will be
+ *     zero if no attributes could be removed or if memory could not be
+ *     allocated to perform the compaction.
+ */
+static int __guac_terminal_buffer_compact_attributes(
+        guac_terminal_buffer* buffer) {
+
+    int i, column;
+    int length = 0;
+
+    /* Mark all attributes which are still in use */
+    int* remap = calloc(buffer->attributes_length, sizeof(int));
+    if (remap == NULL)
+        return 0;
+
+    remap[0] = 1;
+
+    guac_terminal_buffer_row* row = buffer->rows;
+    for (i = 0; i < buffer->available; i++) {
+        for (column = 0; column < row->length; column++)
+            remap[row->attributes[column]] = 1;
+        row++;
+    }
+
+    /* Move all used attributes to the beginning of the table, recording
+     * their new indices */
+    for (i = 0; i < buffer->attributes_length; i++) {
+        if (remap[i]) {
+            buffer->attributes[length] = buffer->attributes[i];
+            remap[i] = length++;
+        }
+    }
+
+    int freed = buffer->attributes_length - length;
+    buffer->attributes_length = length;
+
+    /* Update all rows to use new indices */
+    row = buffer->rows;
+    for (i = 0; i < buffer->available; i++) {
+        for (column = 0; column < row->length; column++)
+            row->attributes[column] = remap[row->attributes[column]];
+        row++;
+    }
+
+    free(remap);
+    __guac_terminal_buffer_rebuild_lookup(buffer);
+
+    return freed;
+
+}
+
+/**
+ * Attempts to free space within the full attribute table of the given buffer
+ * by compacting that table. If a recent compaction freed too few entries,
+ * compaction is instead deferred until the table has filled
+ * GUAC_TERMINAL_BUFFER_MIN_COMPACTED_ATTRIBUTES more times, such that the
+ * cost of scanning the whole buffer is amortized across many new sets of
+ * attributes.
+ *
+ * @param buffer
+ *     The buffer whose attribute table is full.
+ *
+ * @return
+ *     true if space is now available within the attribute table, false
+ *     otherwise.
+ */
+static bool __guac_terminal_buffer_make_room(guac_terminal_buffer* buffer) {
+
+    if (buffer->compaction_deferred > 0) {
+        buffer->compaction_deferred--;
+        return false;
+    }
+
+    int freed = __guac_terminal_buffer_compact_attributes(buffer);
+
+    /* Avoid repeatedly rescanning the buffer if it remains nearly full */
+    if (freed < GUAC_TERMINAL_BUFFER_MIN_COMPACTED_ATTRIBUTES) {
+        buffer->compaction_deferred =
+            GUAC_TERMINAL_BUFFER_MIN_COMPACTED_ATTRIBUTES;
+        guac_client_log(buffer->client, GUAC_LOG_DEBUG, "Terminal attribute "
+                "table is nearly full (%i of %i entries in use). New "
+                "attributes may be displayed using the closest existing "
+                "attributes.", buffer->attributes_length,
+                buffer->attributes_available);
+    }
+
+    return freed > 0;
+
+}
+
+/**
+ * Returns the index of the existing attributes within the attribute table of
+ * the given buffer which are closest in appearance to the given attributes,
+ * for use when the table is full and cannot accept new attributes. Only the
+ * attributes of the default character and the
+ * GUAC_TERMINAL_BUFFER_APPROXIMATION_CANDIDATES most recently added entries
+ * are considered.
+ *
+ * @param buffer
+ *     The buffer whose attribute table should be searched.
+ *
+ * @param attributes
+ *     The attributes to approximate.
+ *
+ * @return
+ *     The index of the closest attributes within the attribute table.
+ */
+static int __guac_terminal_buffer_approximate(guac_terminal_buffer* buffer,
+        const guac_terminal_attributes* attributes) {
+
+    /* Approximations are most often needed for runs of identically-styled
+     * characters */
+    if (buffer->last_approximation >= 0
+            && __guac_terminal_buffer_attributes_equal(
+                &buffer->last_approximated, attributes))
+        return buffer->last_approximation;
+
+    int closest = 0;
+    long closest_distance = __guac_terminal_buffer_attributes_distance(
+            &buffer->attributes[0], attributes);
+
+    int i = buffer->attributes_length
+          - GUAC_TERMINAL_BUFFER_APPROXIMATION_CANDIDATES;
+    if (i < 1)
+        i = 1;
+
+    for (; i < buffer->attributes_length && closest_distance > 0; i++) {
+        long distance = __guac_terminal_buffer_attributes_distance(
+                &buffer->attributes[i], attributes);
+        if (distance < closest_distance) {
+            closest = i;
+            closest_distance = distance;
+        }
+    }
+
+    buffer->last_approximated = *attributes;
+    buffer->last_approximation = closest;
+    return closest;
+
+}
+
+/**
+ * Returns the index of the given attributes within the attribute table of the
+ * given buffer, adding those attributes to the table if not already present.
+ * If the table is full and cannot grow, attributes which are no longer used
+ * are first removed. If no room can be made, the index of the closest
+ * existing attributes is returned.
+ *
+ * @param buffer
+ *     The buffer whose attribute table should be used.
+ *
+ * @param attributes
+ *     The attributes to locate or add.
+ *
+ * @return
+ *     The index of the given attributes within the attribute table, or of
+ *     the closest existing attributes if the table is full.
+ */
+static int __guac_terminal_buffer_intern(guac_terminal_buffer* buffer,
+        const guac_terminal_attributes* attributes) {
+
+    /* Characters are most often written using the same attributes as the
+     * characters written before them */
+    if (__guac_terminal_buffer_attributes_equal(
+                &buffer->attributes[buffer->last_attributes], attributes))
+        return buffer->last_attributes;
+
+    int mask = buffer->attributes_available * 2 - 1;
+    int slot = __guac_terminal_buffer_attributes_hash(attributes) & mask;
+
+    /* Search for existing identical attributes */
+    int entry;
+    while ((entry = buffer->attribute_lookup[slot]) != 0) {
+
+        if (__guac_terminal_buffer_attributes_equal(
+                    &buffer->attributes[entry - 1], attributes)) {
+            buffer->last_attributes = entry - 1;
+            return entry - 1;
+        }
+
+        slot = (slot + 1) & mask;
+
+    }
+
+    /* Make room for new attributes if table is full */
+    if (buffer->attributes_length == buffer->attributes_available) {
+
+        /* Grow table if possible */
+        if (buffer->attributes_available < GUAC_TERMINAL_BUFFER_MAX_ATTRIBUTES) {
+            buffer->attributes_available *= 2;
+            buffer->attributes = realloc(buffer->attributes,
+                    sizeof(guac_terminal_attributes)
+                    * buffer->attributes_available);
+            __guac_terminal_buffer_rebuild_lookup(buffer);
+        }
+
+        /* Otherwise, discard any attributes no longer in use, falling back to
+         * the closest existing attributes if that is not possible */
+        else if (!__guac_terminal_buffer_make_room(buffer))
+            return __guac_terminal_buffer_approximate(buffer, attributes);
+
+    }
+
+    /* Add new attributes */
+    int index = buffer->attributes_length++;
+    buffer->attributes[index] = *attributes;
+    __guac_terminal_buffer_add_lookup(buffer, index);
+
+    buffer->last_attributes = index;
+    buffer->last_approximation = -1;
+    return index;
+
+}
+
+guac_terminal_buffer* guac_terminal_buffer_alloc(guac_client* client, int rows,
+        guac_terminal_char* default_character) {
 
     /* Allocate scrollback */
     guac_terminal_buffer* buffer =
         malloc(sizeof(guac_terminal_buffer));
 
-    int i;
-    guac_terminal_buffer_row* row;
-
     /* Init scrollback data */
+    buffer->client = client;
     buffer->default_character = *default_character;
     buffer->available = rows;
     buffer->top = 0;
     buffer->length = 0;
-    buffer->rows = malloc(sizeof(guac_terminal_buffer_row) *
-            buffer->available);
-
-    /* Init scrollback rows */
-    row = buffer->rows;
-    for (i=0; i<rows; i++) {
-
-        /* Allocate row  */
-        row->available = 256;
-        row->length = 0;
-        row->characters = malloc(sizeof(guac_terminal_char) * row->available);
 
-        /* Next row */
-        row++;
+    /* Storage for each row is allocated only when that row is first used */
+    buffer->rows = calloc(buffer->available,
+            sizeof(guac_terminal_buffer_row));
 
-    }
+    /* Init attribute table with attributes of default character at index 0 */
+    buffer->attributes_available = GUAC_TERMINAL_BUFFER_INITIAL_ATTRIBUTES;
+    buffer->attributes_length = 1;
+    buffer->attributes = malloc(sizeof(guac_terminal_attributes)
+            * buffer->attributes_available);
+    buffer->attributes[0] = default_character->attributes;
+    buffer->attribute_lookup = NULL;
+    buffer->compaction_deferred = 0;
+    __guac_terminal_buffer_rebuild_lookup(buffer);
 
     return buffer;
 
@@ -67,11 +508,13 @@ void guac_terminal_buffer_free(guac_terminal_buffer* buffer) {
 
     /* Free all rows */
     for (i=0; i<buffer->available; i++) {
-        free(row->characters);
+        free(row->codepoints);
         row++;
     }
 
     /* Free actual buffer */
+    free(buffer->attribute_lookup);
+    free(buffer->attributes);
     free(buffer->rows);
     free(buffer);
 
@@ -80,7 +523,6 @@ void guac_terminal_buffer_free(guac_terminal_buffer* buffer) {
 guac_terminal_buffer_row* guac_terminal_buffer_get_row(guac_terminal_buffer* buffer, int row, int width) {
 
     int i;
-    guac_terminal_char* first;
     guac_terminal_buffer_row* buffer_row;
 
     /* Normalize row index into a scrollback buffer index */
@@ -94,16 +536,40 @@ guac_terminal_buffer_row* guac_terminal_buffer_get_row(guac_terminal_buffer* buf
     /* If resizing is needed */
     if (width >= buffer_row->length) {
 
-        /* Expand if necessary */
+        /* Expand to exactly the requested width if necessary, as rows
+         * generally remain the width of the terminal */
         if (width > buffer_row->available) {
-            buffer_row->available = width*2;
-            buffer_row->characters = realloc(buffer_row->characters, sizeof(guac_terminal_char) * buffer_row->available);
+
+            int length = buffer_row->length;
+            unsigned char* block = malloc(
+                    GUAC_TERMINAL_BUFFER_COLUMN_SIZE * width);
+
+            int* codepoints = (int*) block;
+            uint16_t* attributes = (uint16_t*) (codepoints + width);
+            unsigned char* widths = (unsigned char*) (attributes + width);
+
+            /* Copy existing contents, if any */
+            if (length > 0) {
+                memcpy(codepoints, buffer_row->codepoints, sizeof(int) * length);
+                memcpy(attributes, buffer_row->attributes, sizeof(uint16_t) * length);
+                memcpy(widths, buffer_row->widths, length);
+            }
+
+            free(buffer_row->codepoints);
+            buffer_row->codepoints = codepoints;
+            buffer_row->attributes = attributes;
+            buffer_row->widths = widths;
+            buffer_row->available = width;
+
         }
 
-        /* Initialize new part of row */
-        first = &(buffer_row->characters[buffer_row->length]);
-        for (i=buffer_row->length; i<width; i++)
-            *(first++) = buffer->default_character;
+        /* Initialize new part of row (attributes of the default character
+         * are always at index 0) */
+        for (i=buffer_row->length; i<width; i++) {
+            buffer_row->codepoints[i] = buffer->default_character.value;
+            buffer_row->attributes[i] = 0;
+            buffer_row->widths[i] = buffer->default_character.width;
+        }
 
         buffer_row->length = width;
 
@@ -114,12 +580,36 @@ guac_terminal_buffer_row* guac_terminal_buffer_get_row(guac_terminal_buffer* buf
 
 }
 
+void guac_terminal_buffer_get_char(guac_terminal_buffer* buffer,
+        guac_terminal_buffer_row* row, int column,
+        guac_terminal_char* character) {
+
+    character->value = row->codepoints[column];
+    character->attributes = buffer->attributes[row->attributes[column]];
+    character->width = row->widths[column];
+
+}
+
+void guac_terminal_buffer_set_cursor(guac_terminal_buffer* buffer, int row,
+        int column, bool is_cursor) {
+
+    /* Get and expand row */
+    guac_terminal_buffer_row* buffer_row =
+        guac_terminal_buffer_get_row(buffer, row, column+1);
+
+    /* Update only the cursor attribute */
+    guac_terminal_attributes attributes =
+        buffer->attributes[buffer_row->attributes[column]];
+    attributes.cursor = is_cursor;
+
+    buffer_row->attributes[column] =
+        __guac_terminal_buffer_intern(buffer, &attributes);
+
+}
+
 void guac_terminal_buffer_copy_columns(guac_terminal_buffer* buffer, int row,
         int start_column, int end_column, int offset) {
 
-    guac_terminal_char* src;
-    guac_terminal_char* dst;
-
     /* Get row */
     guac_terminal_buffer_row* buffer_row = guac_terminal_buffer_get_row(buffer, row, end_column + offset + 1);
 
@@ -129,12 +619,14 @@ void guac_terminal_buffer_copy_columns(guac_terminal_buffer* buffer, int row,
     start_column = guac_terminal_fit_to_range(start_column + offset, 0, buffer_row->length - 1) - offset;
     end_column   = guac_terminal_fit_to_range(end_column   + offset, 0, buffer_row->length - 1) - offset;
 
-    /* Determine source and destination locations */
-    src = &(buffer_row->characters[start_column]);
-    dst = &(buffer_row->characters[start_column + offset]);
-
     /* Copy data */
-    memmove(dst, src, sizeof(guac_terminal_char) * (end_column - start_column + 1));
+    int count = end_column - start_column + 1;
+    memmove(&(buffer_row->codepoints[start_column + offset]),
+            &(buffer_row->codepoints[start_column]), sizeof(int) * count);
+    memmove(&(buffer_row->attributes[start_column + offset]),
+            &(buffer_row->attributes[start_column]), sizeof(uint16_t) * count);
+    memmove(&(buffer_row->widths[start_column + offset]),
+            &(buffer_row->widths[start_column]), count);
 
 }
 
@@ -164,7 +656,12 @@ void guac_terminal_buffer_copy_rows(guac_terminal_buffer* buffer,
         guac_terminal_buffer_row* dst_row = guac_terminal_buffer_get_row(buffer, current_row + offset, src_row->length);
 
         /* Copy data */
-        memcpy(dst_row->characters, src_row->characters, sizeof(guac_terminal_char) * src_row->length);
+        if (src_row->length > 0) {
+            memcpy(dst_row->codepoints, src_row->codepoints, sizeof(int) * src_row->length);
+            memcpy(dst_row->attributes, src_row->attributes, sizeof(uint16_t) * src_row->length);
+            memcpy(dst_row->widths, src_row->widths, src_row->length);
+        }
+
         dst_row->length = src_row->length;
 
         /* Next current_row */
@@ -178,30 +675,32 @@ void guac_terminal_buffer_set_columns(guac_terminal_buffer* buffer, int row,
         int start_column, int end_column, guac_terminal_char* character) {
 
     int i, j;
-    guac_terminal_char* current;
 
     /* Do nothing if glyph is empty */
     if (character->width == 0)
         return;
 
-    /* Build continuation char (for multicolumn characters) */
-    guac_terminal_char continuation_char;
-    continuation_char.value = GUAC_CHAR_CONTINUATION;
-    continuation_char.attributes = character->attributes;
-    continuation_char.width = 0; /* Not applicable for GUAC_CHAR_CONTINUATION */
+    /* Locate attributes within table (shared with continuation chars) */
+    uint16_t attributes = __guac_terminal_buffer_intern(buffer,
+            &character->attributes);
 
     /* Get and expand row */
     guac_terminal_buffer_row* buffer_row = guac_terminal_buffer_get_row(buffer, row, end_column+1);
 
     /* Set values */
-    current = &(buffer_row->characters[start_column]);
     for (i = start_column; i <= end_column; i += character->width) {
 
-        *(current++) = *character;
+        buffer_row->codepoints[i] = character->value;
+        buffer_row->attributes[i] = attributes;
+        buffer_row->widths[i] = character->width;
 
-        /* Store any required continuation characters */
-        for (j=1; j < character->width; j++)
-            *(current++) = continuation_char;
+        /* Store any required continuation characters which fit within the
+         * row */
+        for (j=1; j < character->width && i+j < buffer_row->length; j++) {
+            buffer_row->codepoints[i+j] = GUAC_CHAR_CONTINUATION;
+            buffer_row->attributes[i+j] = attributes;
+            buffer_row->widths[i+j] = 0;
+        }
 
     }
 
@@ -211,3 +710,55 @@ void guac_terminal_buffer_set_columns(guac_terminal_buffer* buffer, int row,
 
 }
 
+void guac_terminal_buffer_set_codepoints(guac_terminal_buffer* buffer,
+        int row, int start_column, const int* codepoints, int length,
+        const guac_terminal_attributes* attributes) {
+
+    int i;
+
+    /* Locate attributes within table once for entire run */
+    uint16_t index = __guac_terminal_buffer_intern(buffer, attributes);
+
+    /* Get and expand row */
+    guac_terminal_buffer_row* buffer_row = guac_terminal_buffer_get_row(buffer,
+            row, start_column + length);
+
+    /* Set values */
+    memcpy(&(buffer_row->codepoints[start_column]), codepoints,
+            sizeof(int) * length);
+    memset(&(buffer_row->widths[start_column]), 1, length);
+    for (i = start_column; i < start_column + length; i++)
+        buffer_row->attributes[i] = index;
+
+    /* Update length if any character of the row written is non-null */
+    if (row >= buffer->length) {
+        for (i = 0; i < length; i++) {
+            if (codepoints[i] != 0) {
+                buffer->length = row+1;
+                break;
+            }
+        }
+    }
+
+}
+
+size_t guac_terminal_buffer_get_memory_usage(guac_terminal_buffer* buffer) {
+
+    int i;
+
+    size_t usage = sizeof(guac_terminal_buffer)
+        + sizeof(guac_terminal_buffer_row) * buffer->available
+        + sizeof(guac_terminal_attributes) * buffer->attributes_available
+        + sizeof(int) * buffer->attributes_available * 2;
+
+    /* Add storage allocated for each row */
+    guac_terminal_buffer_row* row = buffer->rows;
+    for (i = 0; i < buffer->available; i++) {
+        usage += GUAC_TERMINAL_BUFFER_COLUMN_SIZE * row->available;
+        row++;
+    }
+
+    return usage;
+
+}
+
@@ -22,6 +22,7 @@
 #include "common/surface.h"
 #include "terminal/common.h"
 #include "terminal/display.h"
+#include "terminal/glyph-cache.h"
 #include "terminal/palette.h"
 #include "terminal/types.h"
 
@@ -37,18 +38,6 @@
 #include <guacamole/socket.h>
 #include <pango/pangocairo.h>
 
-/* Maps any codepoint onto a number between 0 and 511 inclusive */
-int __guac_terminal_hash_codepoint(int codepoint) {
-
-    /* If within one byte, just return codepoint */
-    if (codepoint <= 0xFF)
-        return codepoint;
-
-    /* Otherwise, map to next 256 values */
-    return (codepoint & 0xFF) + 0x100;
-
-}
-
 /**
  * Sets the attributes of the display such that future glyphs will render as
  * expected.
@@ -97,13 +86,13 @@ int __guac_terminal_set_colors(guac_terminal_display* display,
 }
 
 /**
- * Sends the given character to the terminal at the given row and column,
- * rendering the character immediately. This bypasses the guac_terminal_display
- * mechanism and is intended for flushing of updates only.
+ * Renders the given character using the current glyph colors of the display,
+ * returning a new surface which exactly fills the given number of columns.
+ * The returned surface must eventually be destroyed with
+ * cairo_surface_destroy().
  */
-int __guac_terminal_set(guac_terminal_display* display, int row, int col, int codepoint) {
-
-    int width;
+cairo_surface_t* __guac_terminal_render_glyph(guac_terminal_display* display,
+        int codepoint, int width) {
 
     int bytes;
     char utf8[4];
@@ -122,15 +111,6 @@ int __guac_terminal_set(guac_terminal_display* display, int row, int col, int co
     int layout_width, layout_height;
     int ideal_layout_width, ideal_layout_height;
 
-    /* Calculate width in columns */
-    width = wcwidth(codepoint);
-    if (width < 0)
-        width = 1;
-
-    /* Do nothing if glyph is empty */
-    if (width == 0)
-        return 0;
-
     /* Convert to UTF-8 */
     bytes = guac_terminal_encode_utf8(codepoint, utf8);
 
@@ -186,16 +166,121 @@ int __guac_terminal_set(guac_terminal_display* display, int row, int col, int co
     cairo_move_to(cairo, 0.0, 0.0);
     pango_cairo_show_layout(cairo, layout);
 
+    /* Free all but rendered surface */
+    g_object_unref(layout);
+    cairo_destroy(cairo);
+
+    cairo_surface_flush(surface);
+    return surface;
+
+}
+
+/**
+ * Returns the glyph for the given character as rendered using the current
+ * glyph colors of the display, rendering and caching the glyph only if an
+ * identical glyph is not already present within the glyph cache.
+ */
+guac_terminal_glyph* __guac_terminal_get_glyph(guac_terminal_display* display,
+        int codepoint, int width, guac_terminal_attributes* attributes) {
+
+    /* Reuse previously-rendered glyph if possible */
+    guac_terminal_glyph* glyph = guac_terminal_glyph_cache_get(
+            display->glyph_cache, codepoint, &display->glyph_foreground,
+            &display->glyph_background, attributes);
+
+    /* Otherwise, render and cache glyph */
+    if (glyph == NULL) {
+        cairo_surface_t* surface = __guac_terminal_render_glyph(display,
+                codepoint, width);
+        glyph = guac_terminal_glyph_cache_add(display->glyph_cache,
+                codepoint, &display->glyph_foreground,
+                &display->glyph_background, attributes, surface);
+    }
+
+    return glyph;
+
+}
+
+/**
+ * Ensures the given glyph is present within the client-side glyph buffer,
+ * drawing the glyph to a newly-assigned slot if necessary. Client-side glyph
+ * buffers must be enabled for the given display.
+ *
+ * @return
+ *     The index of the slot containing the glyph, or -1 if no slot is
+ *     available and the glyph must instead be drawn directly.
+ */
+int __guac_terminal_buffer_glyph(guac_terminal_display* display,
+        guac_terminal_glyph* glyph) {
+
+    int assigned;
+    int slot = guac_terminal_glyph_cache_assign_slot(display->glyph_cache,
+            glyph, display->frame, &assigned);
+
+    /* Draw glyph into its new slot only if not already present */
+    if (assigned) {
+        guac_common_surface_draw(display->glyph_surface,
+                GUAC_TERMINAL_GLYPH_SLOT_X(display, slot),
+                GUAC_TERMINAL_GLYPH_SLOT_Y(display, slot),
+                glyph->surface);
+    }
+
+    return slot;
+
+}
+
+/**
+ * Sends the given character to the terminal at the given row and column,
+ * rendering the character immediately. This bypasses the guac_terminal_display
+ * mechanism and is intended for flushing of updates only. The glyph is
+ * rendered only if an identical glyph is not already present within the glyph
+ * cache of the display. If client-side glyph buffers are enabled and the
+ * glyph is already present within the client-side glyph buffer, the character
+ * is drawn by copying the glyph from that buffer.
+ */
+int __guac_terminal_set(guac_terminal_display* display, int row, int col,
+        int codepoint, guac_terminal_attributes* attributes) {
+
+    int width;
+
+    /* Calculate width in columns */
+    width = wcwidth(codepoint);
+    if (width < 0)
+        width = 1;
+
+    /* Do nothing if glyph is empty */
+    if (width == 0)
+        return 0;
+
+    guac_terminal_glyph* glyph = __guac_terminal_get_glyph(display,
+            codepoint, width, attributes);
+
+    /* Copy glyph from client-side glyph buffer if it was buffered by
+     * __guac_terminal_display_flush_glyphs(). No slot may be assigned here, as
+     * the glyph buffer has already been flushed for this frame, and a glyph
+     * which was evicted from the glyph cache since must be drawn directly. */
+    if (display->glyph_surface != NULL && glyph->slot >= 0) {
+
+        int slot = __guac_terminal_buffer_glyph(display, glyph);
+        if (slot >= 0) {
+            guac_common_surface_copy_direct(display->glyph_surface,
+                    GUAC_TERMINAL_GLYPH_SLOT_X(display, slot),
+                    GUAC_TERMINAL_GLYPH_SLOT_Y(display, slot),
+                    cairo_image_surface_get_width(glyph->surface),
+                    cairo_image_surface_get_height(glyph->surface),
+                    display->display_surface,
+                    display->char_width * col,
+                    display->char_height * row);
+            return 0;
+        }
+
+    }
+
     /* Draw */
     guac_common_surface_draw(display->display_surface,
         display->char_width * col,
         display->char_height * row,
-        surface);
-
-    /* Free all */
-    g_object_unref(layout);
-    cairo_destroy(cairo);
-    cairo_surface_destroy(surface);
+        glyph->surface);
 
     return 0;
 
@@ -204,7 +289,7 @@ int __guac_terminal_set(guac_terminal_display* display, int row, int col, int co
 guac_terminal_display* guac_terminal_display_alloc(guac_client* client,
         const char* font_name, int font_size, int dpi,
         guac_terminal_color* foreground, guac_terminal_color* background,
-        guac_terminal_color (*palette)[256]) {
+        guac_terminal_color (*palette)[256], bool glyph_buffers) {
 
     /* Allocate display */
     guac_terminal_display* display = malloc(sizeof(guac_terminal_display));
@@ -215,6 +300,25 @@ guac_terminal_display* guac_terminal_display_alloc(guac_client* client,
     display->char_width = 0;
     display->char_height = 0;
 
+    /* Initially no glyphs rendered */
+    display->glyph_cache = guac_terminal_glyph_cache_alloc(
+            GUAC_TERMINAL_GLYPH_CACHE_DEFAULT_SIZE,
+            glyph_buffers ? GUAC_TERMINAL_GLYPH_CACHE_SLOTS : 0);
+    display->frame = 0;
+
+    /* Create client-side glyph buffer only if requested (will be sized
+     * according to font metrics once the font is loaded) */
+    if (glyph_buffers) {
+        display->glyph_buffer = guac_client_alloc_buffer(client);
+        display->glyph_surface = guac_common_surface_alloc(client,
+                client->socket, display->glyph_buffer, 0, 0);
+        guac_common_surface_set_lossless(display->glyph_surface, 1);
+    }
+    else {
+        display->glyph_buffer = NULL;
+        display->glyph_surface = NULL;
+    }
+
     /* Create default surface */
     display->display_layer = guac_client_alloc_layer(client);
     display->select_layer = guac_client_alloc_layer(client);
@@ -244,7 +348,7 @@ guac_terminal_display* guac_terminal_display_alloc(guac_client* client,
     if (guac_terminal_display_set_font(display, font_name, font_size, dpi)) {
         guac_client_abort(display->client, GUAC_PROTOCOL_STATUS_SERVER_ERROR,
                 "Unable to set initial font \"%s\"", font_name);
-        free(display);
+        guac_terminal_display_free(display);
         return NULL;
     }
 
@@ -257,6 +361,15 @@ void guac_terminal_display_free(guac_terminal_display* display) {
     /* Free font description */
     pango_font_description_free(display->font_desc);
 
+    /* Free all rendered glyphs */
+    guac_terminal_glyph_cache_free(display->glyph_cache);
+
+    /* Free client-side glyph buffer, if any */
+    if (display->glyph_surface != NULL) {
+        guac_common_surface_free(display->glyph_surface);
+        guac_client_free_buffer(display->client, display->glyph_buffer);
+    }
+
     /* Free default palette. */
     free(display->default_palette);
 
@@ -444,6 +557,50 @@ void guac_terminal_display_set_columns(guac_terminal_display* display, int row,
 
 }
 
+void guac_terminal_display_set_codepoints(guac_terminal_display* display,
+        int row, int start_column, const int* codepoints, int length,
+        const guac_terminal_attributes* attributes) {
+
+    int i;
+    guac_terminal_operation* current;
+
+    /* Ignore operations outside display bounds */
+    if (row < 0 || row >= display->height)
+        return;
+
+    /* Fit range within bounds, skipping any characters which precede the
+     * first column */
+    int end_column = start_column + length - 1;
+    if (end_column >= display->width)
+        end_column = display->width - 1;
+
+    if (start_column < 0) {
+        codepoints -= start_column;
+        start_column = 0;
+    }
+
+    /* Ignore runs lying entirely outside display bounds */
+    if (start_column > end_column)
+        return;
+
+    current = &(display->operations[row * display->width + start_column]);
+
+    /* For each column in range */
+    for (i = start_column; i <= end_column; i++) {
+
+        /* Set operation */
+        current->type                 = GUAC_CHAR_SET;
+        current->character.value      = *(codepoints++);
+        current->character.attributes = *attributes;
+        current->character.width      = 1;
+
+        /* Next character */
+        current++;
+
+    }
+
+}
+
 void guac_terminal_display_resize(guac_terminal_display* display, int width, int height) {
 
     guac_terminal_operation* current;
@@ -767,6 +924,52 @@ void __guac_terminal_display_flush_clear(guac_terminal_display* display) {
 }
 
 
+void __guac_terminal_display_flush_glyphs(guac_terminal_display* display) {
+
+    guac_terminal_operation* current = display->operations;
+    int row, col;
+
+    /* For each operation */
+    for (row=0; row<display->height; row++) {
+        for (col=0; col<display->width; col++) {
+
+            /* Buffer glyphs of all operations which will draw a glyph */
+            if (current->type == GUAC_CHAR_SET
+                    && guac_terminal_has_glyph(current->character.value)) {
+
+                int codepoint = current->character.value;
+
+                /* Calculate width in columns, skipping empty glyphs */
+                int width = wcwidth(codepoint);
+                if (width < 0)
+                    width = 1;
+
+                if (width != 0) {
+
+                    /* Set attributes */
+                    __guac_terminal_set_colors(display,
+                            &(current->character.attributes));
+
+                    /* Ensure glyph is present within client-side buffer */
+                    __guac_terminal_buffer_glyph(display,
+                            __guac_terminal_get_glyph(display, codepoint,
+                                width, &(current->character.attributes)));
+
+                }
+
+            }
+
+            /* Next operation */
+            current++;
+
+        }
+    }
+
+    /* Send all newly-buffered glyphs at once */
+    guac_common_surface_flush(display->glyph_surface);
+
+}
+
 void __guac_terminal_display_flush_set(guac_terminal_display* display) {
 
     guac_terminal_operation* current = display->operations;
@@ -790,7 +993,8 @@ void __guac_terminal_display_flush_set(guac_terminal_display* display) {
                         &(current->character.attributes));
 
                 /* Send character */
-                __guac_terminal_set(display, row, col, codepoint);
+                __guac_terminal_set(display, row, col, codepoint,
+                        &(current->character.attributes));
 
                 /* Mark operation as handled */
                 current->type = GUAC_CHAR_NOP;
@@ -807,9 +1011,18 @@ void __guac_terminal_display_flush_set(guac_terminal_display* display) {
 
 void guac_terminal_display_flush(guac_terminal_display* display) {
 
+    /* Glyphs drawn during this flush must not be evicted from the
+     * client-side glyph buffer until a later flush */
+    display->frame++;
+
     /* Flush operations, copies first, then clears, then sets. */
     __guac_terminal_display_flush_copy(display);
     __guac_terminal_display_flush_clear(display);
+
+    /* Update client-side glyph buffer prior to sets, if enabled */
+    if (display->glyph_surface != NULL)
+        __guac_terminal_display_flush_glyphs(display);
+
     __guac_terminal_display_flush_set(display);
 
     /* Flush surface */
@@ -820,6 +1033,10 @@ void guac_terminal_display_flush(guac_terminal_display* display) {
 void guac_terminal_display_dup(guac_terminal_display* display, guac_user* user,
         guac_socket* socket) {
 
+    /* Replay client-side glyph buffer, if any */
+    if (display->glyph_surface != NULL)
+        guac_common_surface_dup(display->glyph_surface, user, socket);
+
     /* Create default surface */
     guac_common_surface_dup(display->display_surface, user, socket);
 
@@ -1011,6 +1228,17 @@ int guac_terminal_display_set_font(guac_terminal_display* display,
     display->font_desc = font_desc;
     pango_font_description_free(old_font_desc);
 
+    /* Previously-rendered glyphs no longer match the current font */
+    guac_terminal_glyph_cache_clear(display->glyph_cache);
+
+    /* Resize client-side glyph buffer to fit glyphs of the new font */
+    if (display->glyph_surface != NULL)
+        guac_common_surface_resize(display->glyph_surface,
+                GUAC_TERMINAL_GLYPH_BUFFER_COLUMNS
+                    * GUAC_TERMINAL_MAX_CHAR_WIDTH * display->char_width,
+                GUAC_TERMINAL_GLYPH_CACHE_SLOTS
+                    / GUAC_TERMINAL_GLYPH_BUFFER_COLUMNS * display->char_height);
+
     /* Recalculate dimensions which will fit within current surface */
     int new_width = pixel_width / display->char_width;
     int new_height = pixel_height / display->char_height;
@@ -0,0 +1,365 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "config.h"
+
+#include "terminal/glyph-cache.h"
+#include "terminal/palette.h"
+#include "terminal/types.h"
+
+#include <cairo/cairo.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+int __guac_terminal_hash_codepoint(int codepoint) {
+
+    /* If within one byte, just return codepoint */
+    if (codepoint <= 0xFF)
+        return codepoint;
+
+    /* Otherwise, map to next 256 values */
+    return (codepoint & 0xFF) + 0x100;
+
+}
+
+/**
+ * Returns the hash bucket which would contain glyphs having the given
+ * codepoint.
+ *
+ * @param cache
+ *     The glyph cache containing the bucket.
+ *
+ * @param codepoint
+ *     The codepoint of the glyph.
+ *
+ * @return
+ *     A pointer to the head of the bucket which would contain the glyph.
+ */
+static guac_terminal_glyph** guac_terminal_glyph_cache_bucket(
+        guac_terminal_glyph_cache* cache, int codepoint) {
+
+    /* Continuation characters and other negative values are never rendered,
+     * but map them somewhere valid regardless */
+    if (codepoint < 0)
+        codepoint = 0;
+
+    return &cache->buckets[__guac_terminal_hash_codepoint(codepoint)];
+
+}
+
+/**
+ * Removes the given glyph from the least-recently-used list of the given
+ * cache. The glyph remains within its hash bucket.
+ *
+ * @param cache
+ *     The glyph cache containing the glyph.
+ *
+ * @param glyph
+ *     The glyph to remove from the least-recently-used list.
+ */
+static void guac_terminal_glyph_cache_unlink(guac_terminal_glyph_cache* cache,
+        guac_terminal_glyph* glyph) {
+
+    if (glyph->newer != NULL)
+        glyph->newer->older = glyph->older;
+    else
+        cache->newest = glyph->older;
+
+    if (glyph->older != NULL)
+        glyph->older->newer = glyph->newer;
+    else
+        cache->oldest = glyph->newer;
+
+    glyph->newer = NULL;
+    glyph->older = NULL;
+
+}
+
+/**
+ * Inserts the given glyph at the head of the least-recently-used list of the
+ * given cache, marking it as the most recently used glyph.
+ *
+ * @param cache
+ *     The glyph cache to insert the glyph into.
+ *
+ * @param glyph
+ *     The glyph to mark as most recently used. This glyph must not currently
+ *     be within the least-recently-used list.
+ */
+static void guac_terminal_glyph_cache_touch(guac_terminal_glyph_cache* cache,
+        guac_terminal_glyph* glyph) {
+
+    glyph->newer = NULL;
+    glyph->older = cache->newest;
+
+    if (cache->newest != NULL)
+        cache->newest->newer = glyph;
+    else
+        cache->oldest = glyph;
+
+    cache->newest = glyph;
+
+}
+
+/**
+ * Releases the slot of the client-side glyph buffer occupied by the given
+ * glyph, if any, such that it may be assigned to another glyph.
+ *
+ * @param cache
+ *     The glyph cache containing the glyph.
+ *
+ * @param glyph
+ *     The glyph whose slot should be released.
+ */
+static void guac_terminal_glyph_cache_release_slot(
+        guac_terminal_glyph_cache* cache, guac_terminal_glyph* glyph) {
+
+    if (glyph->slot < 0)
+        return;
+
+    cache->slots[glyph->slot] = NULL;
+    cache->slots_used--;
+    glyph->slot = -1;
+
+}
+
+/**
+ * Removes the given glyph from the given cache entirely, freeing the glyph
+ * and its rendered surface.
+ *
+ * @param cache
+ *     The glyph cache containing the glyph.
+ *
+ * @param glyph
+ *     The glyph to remove and free.
+ */
+static void guac_terminal_glyph_cache_remove(guac_terminal_glyph_cache* cache,
+        guac_terminal_glyph* glyph) {
+
+    /* Remove from hash bucket */
+    guac_terminal_glyph** current =
+        guac_terminal_glyph_cache_bucket(cache, glyph->codepoint);
+
+    while (*current != NULL) {
+        if (*current == glyph) {
+            *current = glyph->next;
+            break;
+        }
+        current = &(*current)->next;
+    }
+
+    /* Remove from LRU list and client-side glyph buffer */
+    guac_terminal_glyph_cache_unlink(cache, glyph);
+    guac_terminal_glyph_cache_release_slot(cache, glyph);
+
+    cache->size -= glyph->size;
+    cairo_surface_destroy(glyph->surface);
+    free(glyph);
+
+}
+
+guac_terminal_glyph_cache* guac_terminal_glyph_cache_alloc(size_t max_size,
+        int slot_count) {
+
+    guac_terminal_glyph_cache* cache =
+        calloc(1, sizeof(guac_terminal_glyph_cache));
+
+    cache->max_size = max_size;
+
+    /* Track client-side glyph buffer slots only if requested */
+    if (slot_count > 0) {
+        cache->slots = calloc(slot_count, sizeof(guac_terminal_glyph*));
+        cache->slot_count = slot_count;
+    }
+
+    return cache;
+
+}
+
+void guac_terminal_glyph_cache_free(guac_terminal_glyph_cache* cache) {
+
+    /* Ignore NULL caches */
+    if (cache == NULL)
+        return;
+
+    guac_terminal_glyph_cache_clear(cache);
+    free(cache->slots);
+    free(cache);
+
+}
+
+void guac_terminal_glyph_cache_clear(guac_terminal_glyph_cache* cache) {
+
+    guac_terminal_glyph* current = cache->newest;
+    while (current != NULL) {
+        guac_terminal_glyph* older = current->older;
+        cairo_surface_destroy(current->surface);
+        free(current);
+        current = older;
+    }
+
+    memset(cache->buckets, 0, sizeof(cache->buckets));
+
+    /* All slots are now unoccupied */
+    if (cache->slots != NULL)
+        memset(cache->slots, 0, cache->slot_count * sizeof(guac_terminal_glyph*));
+
+    cache->slots_used = 0;
+    cache->newest = NULL;
+    cache->oldest = NULL;
+    cache->size = 0;
+
+}
+
+guac_terminal_glyph* guac_terminal_glyph_cache_get(
+        guac_terminal_glyph_cache* cache, int codepoint,
+        const guac_terminal_color* foreground,
+        const guac_terminal_color* background,
+        const guac_terminal_attributes* attributes) {
+
+    guac_terminal_glyph* current =
+        *guac_terminal_glyph_cache_bucket(cache, codepoint);
+
+    /* Search bucket for identically-rendered glyph */
+    while (current != NULL) {
+
+        if (current->codepoint == codepoint
+                && current->bold == attributes->bold
+                && current->half_bright == attributes->half_bright
+                && current->underscore == attributes->underscore
+                && guac_terminal_colorcmp(&current->foreground, foreground) == 0
+                && guac_terminal_colorcmp(&current->background, background) == 0) {
+
+            /* Mark as most recently used */
+            if (cache->newest != current) {
+                guac_terminal_glyph_cache_unlink(cache, current);
+                guac_terminal_glyph_cache_touch(cache, current);
+            }
+
+            return current;
+
+        }
+
+        current = current->next;
+
+    }
+
+    /* Not yet rendered */
+    return NULL;
+
+}
+
+guac_terminal_glyph* guac_terminal_glyph_cache_add(
+        guac_terminal_glyph_cache* cache, int codepoint,
+        const guac_terminal_color* foreground,
+        const guac_terminal_color* background,
+        const guac_terminal_attributes* attributes,
+        cairo_surface_t* surface) {
+
+    guac_terminal_glyph* glyph = malloc(sizeof(guac_terminal_glyph));
+
+    glyph->codepoint   = codepoint;
+    glyph->foreground  = *foreground;
+    glyph->background  = *background;
+    glyph->bold        = attributes->bold;
+    glyph->half_bright = attributes->half_bright;
+    glyph->underscore  = attributes->underscore;
+    glyph->surface     = surface;
+    glyph->slot        = -1;
+    glyph->slot_frame  = 0;
+    glyph->size        = cairo_image_surface_get_stride(surface)
+                       * cairo_image_surface_get_height(surface);
+
+    /* Evict least recently used glyphs until the new glyph fits */
+    while (cache->oldest != NULL
+            && cache->size + glyph->size > cache->max_size)
+        guac_terminal_glyph_cache_remove(cache, cache->oldest);
+
+    /* Add to hash bucket */
+    guac_terminal_glyph** bucket =
+        guac_terminal_glyph_cache_bucket(cache, codepoint);
+
+    glyph->next = *bucket;
+    *bucket = glyph;
+
+    /* Add as most recently used */
+    guac_terminal_glyph_cache_touch(cache, glyph);
+    cache->size += glyph->size;
+
+    return glyph;
+
+}
+
+int guac_terminal_glyph_cache_assign_slot(guac_terminal_glyph_cache* cache,
+        guac_terminal_glyph* glyph, unsigned int frame, int* assigned) {
+
+    int slot;
+
+    /* Reuse existing slot if already present within glyph buffer */
+    if (glyph->slot >= 0) {
+        glyph->slot_frame = frame;
+        *assigned = 0;
+        return glyph->slot;
+    }
+
+    /* Glyph will need to be drawn if a slot can be assigned */
+    *assigned = 1;
+
+    /* Use first unoccupied slot, if any */
+    if (cache->slots_used < cache->slot_count) {
+        for (slot = 0; slot < cache->slot_count; slot++) {
+            if (cache->slots[slot] == NULL)
+                break;
+        }
+    }
+
+    /* Otherwise, take the slot of the least recently used glyph which has
+     * not already been drawn during this frame */
+    else {
+
+        guac_terminal_glyph* current = cache->oldest;
+        while (current != NULL) {
+            if (current->slot >= 0 && current->slot_frame != frame)
+                break;
+            current = current->newer;
+        }
+
+        /* All slots are in use by the current frame */
+        if (current == NULL) {
+            *assigned = 0;
+            return -1;
+        }
+
+        slot = current->slot;
+        guac_terminal_glyph_cache_release_slot(cache, current);
+
+    }
+
+    /* Occupy slot */
+    cache->slots[slot] = glyph;
+    cache->slots_used++;
+
+    glyph->slot = slot;
+    glyph->slot_frame = frame;
+    return slot;
+
+}
+
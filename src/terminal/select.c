@@ -153,16 +153,13 @@ static int guac_terminal_find_char(guac_terminal* terminal,
     if (start_column < buffer_row->length) {
 
         /* Find beginning of character */
-        guac_terminal_char* start_char = &(buffer_row->characters[start_column]);
-        while (start_column > 0 && start_char->value == GUAC_CHAR_CONTINUATION) {
-            start_char--;
+        while (start_column > 0 && buffer_row->codepoints[start_column] == GUAC_CHAR_CONTINUATION)
             start_column--;
-        }
 
         /* Use width, if available */
-        if (start_char->value != GUAC_CHAR_CONTINUATION) {
+        if (buffer_row->codepoints[start_column] != GUAC_CHAR_CONTINUATION) {
             *column = start_column;
-            return start_char->width;
+            return buffer_row->widths[start_column];
         }
 
     }
@@ -307,7 +304,7 @@ static void guac_terminal_clipboard_append_row(guac_terminal* terminal,
         /* Convert as many codepoints within the given range as possible */
         for (i = start; i <= end; i++) {
 
-            int codepoint = buffer_row->characters[i].value;
+            int codepoint = buffer_row->codepoints[i];
 
             /* Ignore null (blank) characters */
             if (codepoint == 0 || codepoint == GUAC_CHAR_CONTINUATION)
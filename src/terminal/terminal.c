@@ -84,26 +84,20 @@ static void __guac_terminal_force_break(guac_terminal* terminal, int row, int ed
         int end_column = edge - 1;
         int start_column = end_column;
 
-        guac_terminal_char* start_char = &(buffer_row->characters[start_column]);
-
         /* Determine start column */
-        while (start_column > 0 && start_char->value == GUAC_CHAR_CONTINUATION) {
-            start_char--;
+        while (start_column > 0 && buffer_row->codepoints[start_column] == GUAC_CHAR_CONTINUATION)
             start_column--;
-        }
 
         /* Advance to start of broken character if necessary */
-        if (start_char->value != GUAC_CHAR_CONTINUATION && start_char->width < end_column - start_column + 1) {
-            start_column += start_char->width;
-            start_char += start_char->width;
-        }
+        if (buffer_row->codepoints[start_column] != GUAC_CHAR_CONTINUATION && buffer_row->widths[start_column] < end_column - start_column + 1)
+            start_column += buffer_row->widths[start_column];
 
         /* Clear character if broken */
-        if (start_char->value == GUAC_CHAR_CONTINUATION || start_char->width != end_column - start_column + 1) {
+        if (buffer_row->codepoints[start_column] == GUAC_CHAR_CONTINUATION || buffer_row->widths[start_column] != end_column - start_column + 1) {
 
             guac_terminal_char cleared_char;
+            guac_terminal_buffer_get_char(terminal->buffer, buffer_row, start_column, &cleared_char);
             cleared_char.value = ' ';
-            cleared_char.attributes = start_char->attributes;
             cleared_char.width = 1;
 
             __guac_terminal_set_columns(terminal, row, start_column, end_column, &cleared_char);
@@ -118,27 +112,20 @@ static void __guac_terminal_force_break(guac_terminal* terminal, int row, int ed
         int start_column = edge;
         int end_column = start_column;
 
-        guac_terminal_char* start_char = &(buffer_row->characters[start_column]);
-        guac_terminal_char* end_char = &(buffer_row->characters[end_column]);
-
         /* Determine end column */
-        while (end_column+1 < buffer_row->length && (end_char+1)->value == GUAC_CHAR_CONTINUATION) {
-            end_char++;
+        while (end_column+1 < buffer_row->length && buffer_row->codepoints[end_column+1] == GUAC_CHAR_CONTINUATION)
             end_column++;
-        }
 
         /* Advance to start of broken character if necessary */
-        if (start_char->value != GUAC_CHAR_CONTINUATION && start_char->width < end_column - start_column + 1) {
-            start_column += start_char->width;
-            start_char += start_char->width;
-        }
+        if (buffer_row->codepoints[start_column] != GUAC_CHAR_CONTINUATION && buffer_row->widths[start_column] < end_column - start_column + 1)
+            start_column += buffer_row->widths[start_column];
 
         /* Clear character if broken */
-        if (start_char->value == GUAC_CHAR_CONTINUATION || start_char->width != end_column - start_column + 1) {
+        if (buffer_row->codepoints[start_column] == GUAC_CHAR_CONTINUATION || buffer_row->widths[start_column] != end_column - start_column + 1) {
 
             guac_terminal_char cleared_char;
+            guac_terminal_buffer_get_char(terminal->buffer, buffer_row, start_column, &cleared_char);
             cleared_char.value = ' ';
-            cleared_char.attributes = start_char->attributes;
             cleared_char.width = 1;
 
             __guac_terminal_set_columns(terminal, row, start_column, end_column, &cleared_char);
@@ -195,6 +182,8 @@ void guac_terminal_reset(guac_terminal* term) {
 
     /* Set current state */
     term->char_handler = guac_terminal_echo; 
+    term->utf8_bytes_remaining = 0;
+    term->utf8_codepoint = 0;
     term->active_char_set = 0;
     term->char_mapping[0] =
     term->char_mapping[1] = NULL;
@@ -310,7 +299,7 @@ guac_terminal* guac_terminal_create(guac_client* client,
         guac_common_clipboard* clipboard, bool disable_copy,
         int max_scrollback, const char* font_name, int font_size, int dpi,
         int width, int height, const char* color_scheme,
-        const int backspace) {
+        const int backspace, bool glyph_buffers) {
 
     /* Build default character using default colors */
     guac_terminal_char default_char = {
@@ -369,7 +358,7 @@ guac_terminal* guac_terminal_create(guac_client* client,
         initial_scrollback = GUAC_TERMINAL_MAX_ROWS;
 
     /* Init buffer */
-    term->buffer = guac_terminal_buffer_alloc(initial_scrollback,
+    term->buffer = guac_terminal_buffer_alloc(client, initial_scrollback,
             &default_char);
 
     /* Init display */
@@ -377,7 +366,7 @@ guac_terminal* guac_terminal_create(guac_client* client,
             font_name, font_size, dpi,
             &default_char.attributes.foreground,
             &default_char.attributes.background,
-            (guac_terminal_color(*)[256]) default_palette);
+            (guac_terminal_color(*)[256]) default_palette, glyph_buffers);
 
     /* Fail if display init failed */
     if (term->display == NULL) {
@@ -512,6 +501,12 @@ void guac_terminal_free(guac_terminal* term) {
     /* Free display */
     guac_terminal_display_free(term->display);
 
+    /* Report memory used by buffer, including all scrollback */
+    guac_client_log(term->client, GUAC_LOG_DEBUG, "Terminal buffer used %zu "
+            "bytes for %i rows of scrollback (%i distinct attributes).",
+            guac_terminal_buffer_get_memory_usage(term->buffer),
+            term->buffer->length, term->buffer->attributes_length);
+
     /* Free buffer */
     guac_terminal_buffer_free(term->buffer);
 
@@ -622,6 +617,7 @@ int guac_terminal_render_frame(guac_terminal* terminal) {
     wait_result = guac_terminal_wait(terminal, 1000);
     if (wait_result || !terminal->started) {
 
+        int frame_duration = guac_client_get_frame_duration(client);
         guac_timestamp frame_start = guac_timestamp_current();
 
         do {
@@ -631,8 +627,16 @@ int guac_terminal_render_frame(guac_terminal* terminal) {
             int frame_remaining = frame_start + GUAC_TERMINAL_FRAME_DURATION
                                 - frame_end;
 
+            /* Calculate time that client needs to catch up */
+            int required_wait = frame_start + frame_duration - frame_end;
+
+            /* Increase the duration of this frame if client is lagging or
+             * congested, combining further updates into this frame */
+            if (required_wait > GUAC_TERMINAL_FRAME_TIMEOUT)
+                wait_result = guac_terminal_wait(terminal, required_wait);
+
             /* Wait again if frame remaining */
-            if (frame_remaining > 0 || !terminal->started)
+            else if (frame_remaining > 0 || !terminal->started)
                 wait_result = guac_terminal_wait(terminal,
                         GUAC_TERMINAL_FRAME_TIMEOUT);
             else
@@ -774,9 +778,51 @@ int guac_terminal_set(guac_terminal* term, int row, int col, int codepoint) {
 
 }
 
+int guac_terminal_set_codepoints(guac_terminal* term, int row, int col,
+        const int* codepoints, int length) {
+
+    int end_col = col + length - 1;
+
+    guac_terminal_display_set_codepoints(term->display,
+            row + term->scroll_offset, col, codepoints, length,
+            &term->current_attributes);
+
+    guac_terminal_buffer_set_codepoints(term->buffer, row, col,
+            codepoints, length, &term->current_attributes);
+
+    /* Clear selection if region is modified */
+    guac_terminal_select_touch(term, row, col, row, end_col);
+
+    /* If visible cursor in current run, preserve state */
+    if (row == term->visible_cursor_row
+            && term->visible_cursor_col >= col
+            && term->visible_cursor_col <= end_col) {
+
+        /* Create copy of character with cursor attribute set */
+        guac_terminal_char cursor_character = {
+            .value      = codepoints[term->visible_cursor_col - col],
+            .attributes = term->current_attributes,
+            .width      = 1
+        };
+        cursor_character.attributes.cursor = true;
+
+        __guac_terminal_set_columns(term, row,
+                term->visible_cursor_col, term->visible_cursor_col,
+                &cursor_character);
+
+    }
+
+    /* Force breaks around destination region */
+    __guac_terminal_force_break(term, row, col);
+    __guac_terminal_force_break(term, row, end_col + 1);
+
+    return 0;
+
+}
+
 void guac_terminal_commit_cursor(guac_terminal* term) {
 
-    guac_terminal_char* guac_char;
+    guac_terminal_char guac_char;
 
     guac_terminal_buffer_row* row;
 
@@ -787,23 +833,23 @@ void guac_terminal_commit_cursor(guac_terminal* term) {
     /* Clear cursor if it was visible */
     if (term->visible_cursor_row != -1 && term->visible_cursor_col != -1) {
         /* Get old row with cursor */
+        guac_terminal_buffer_set_cursor(term->buffer, term->visible_cursor_row, term->visible_cursor_col, false);
         row = guac_terminal_buffer_get_row(term->buffer, term->visible_cursor_row, term->visible_cursor_col+1);
 
-        guac_char = &(row->characters[term->visible_cursor_col]);
-        guac_char->attributes.cursor = false;
+        guac_terminal_buffer_get_char(term->buffer, row, term->visible_cursor_col, &guac_char);
         guac_terminal_display_set_columns(term->display, term->visible_cursor_row + term->scroll_offset,
-                term->visible_cursor_col, term->visible_cursor_col, guac_char);
+                term->visible_cursor_col, term->visible_cursor_col, &guac_char);
     }
 
     /* Set cursor if should be visible */
     if (term->cursor_visible) {
         /* Get new row with cursor */
+        guac_terminal_buffer_set_cursor(term->buffer, term->cursor_row, term->cursor_col, true);
         row = guac_terminal_buffer_get_row(term->buffer, term->cursor_row, term->cursor_col+1);
 
-        guac_char = &(row->characters[term->cursor_col]);
-        guac_char->attributes.cursor = true;
+        guac_terminal_buffer_get_char(term->buffer, row, term->cursor_col, &guac_char);
         guac_terminal_display_set_columns(term->display, term->cursor_row + term->scroll_offset,
-                term->cursor_col, term->cursor_col, guac_char);
+                term->cursor_col, term->cursor_col, &guac_char);
 
         term->visible_cursor_row = term->cursor_row;
         term->visible_cursor_col = term->cursor_col;
@@ -824,6 +870,27 @@ int guac_terminal_write(guac_terminal* term, const char* c, int size) {
     guac_terminal_lock(term);
     while (size > 0) {
 
+        /* Handle runs of ordinary printable text in bulk */
+        if (term->char_handler == guac_terminal_echo) {
+
+            int length = guac_terminal_echo_run(term, c, size);
+            if (length > 0) {
+
+                /* Write all handled characters to typescript, if any */
+                if (term->typescript != NULL) {
+                    int i;
+                    for (i = 0; i < length; i++)
+                        guac_terminal_typescript_write(term->typescript, c[i]);
+                }
+
+                c += length;
+                size -= length;
+                continue;
+
+            }
+
+        }
+
         /* Read and advance to next character */
         char current = *(c++);
         size--;
@@ -1045,14 +1112,13 @@ void guac_terminal_scroll_display_down(guac_terminal* terminal,
                 dest_row, 0, terminal->display->width, &(terminal->default_char));
 
         /* Draw row */
-        guac_terminal_char* current = buffer_row->characters;
         for (column=0; column<buffer_row->length; column++) {
 
             /* Only draw if not blank */
-            if (guac_terminal_is_visible(terminal, current))
-                guac_terminal_display_set_columns(terminal->display, dest_row, column, column, current);
-
-            current++;
+            guac_terminal_char current;
+            guac_terminal_buffer_get_char(terminal->buffer, buffer_row, column, &current);
+            if (guac_terminal_is_visible(terminal, &current))
+                guac_terminal_display_set_columns(terminal->display, dest_row, column, column, &current);
 
         }
 
@@ -1108,14 +1174,13 @@ void guac_terminal_scroll_display_up(guac_terminal* terminal,
                 dest_row, 0, terminal->display->width, &(terminal->default_char));
 
         /* Draw row */
-        guac_terminal_char* current = buffer_row->characters;
         for (column=0; column<buffer_row->length; column++) {
 
             /* Only draw if not blank */
-            if (guac_terminal_is_visible(terminal, current))
-                guac_terminal_display_set_columns(terminal->display, dest_row, column, column, current);
-
-            current++;
+            guac_terminal_char current;
+            guac_terminal_buffer_get_char(terminal->buffer, buffer_row, column, &current);
+            if (guac_terminal_is_visible(terminal, &current))
+                guac_terminal_display_set_columns(terminal->display, dest_row, column, column, &current);
 
         }
 
@@ -1215,9 +1280,10 @@ static void __guac_terminal_redraw_rect(guac_terminal* term, int start_row, int
         for (col=start_col; col <= end_col && col < buffer_row->length; col++) {
 
             /* Only redraw if not blank */
-            guac_terminal_char* c = &(buffer_row->characters[col]);
-            if (guac_terminal_is_visible(term, c))
-                guac_terminal_display_set_columns(term->display, row, col, col, c);
+            guac_terminal_char c;
+            guac_terminal_buffer_get_char(term->buffer, buffer_row, col, &c);
+            if (guac_terminal_is_visible(term, &c))
+                guac_terminal_display_set_columns(term->display, row, col, col, &c);
 
         }
 
@@ -1425,6 +1491,7 @@ void guac_terminal_flush(guac_terminal* terminal) {
     guac_terminal_commit_cursor(terminal);
     guac_terminal_display_flush(terminal->display);
     guac_terminal_scrollbar_flush(terminal->scrollbar);
+    guac_common_cursor_flush(terminal->cursor);
 
 }
 
@@ -25,15 +25,72 @@
 
 #include "types.h"
 
+#include <guacamole/client.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * The maximum number of distinct sets of attributes which may be stored
+ * within the attribute table of a terminal buffer at any one time. This is
+ * dictated by the size of the indices stored for each character.
+ */
+#define GUAC_TERMINAL_BUFFER_MAX_ATTRIBUTES 65536
+
 /**
- * A single variable-length row of terminal data.
+ * The number of distinct sets of attributes for which space is initially
+ * allocated within the attribute table of a terminal buffer.
+ */
+#define GUAC_TERMINAL_BUFFER_INITIAL_ATTRIBUTES 64
+
+/**
+ * The minimum number of entries which compacting a full attribute table must
+ * free for the table to be compacted again as soon as it next fills. If fewer
+ * entries are freed, this many further sets of attributes which do not fit
+ * are approximated using the closest existing attributes before compaction is
+ * next attempted, such that a nearly-full table does not result in the whole
+ * buffer being scanned for every new set of attributes.
+ */
+#define GUAC_TERMINAL_BUFFER_MIN_COMPACTED_ATTRIBUTES 4096
+
+/**
+ * The number of most recently added entries of a full attribute table which
+ * are searched for the closest match to attributes that do not fit within
+ * the table. Recently added attributes are the most likely to resemble those
+ * currently being written, and bounding the search keeps each approximation
+ * cheap.
+ */
+#define GUAC_TERMINAL_BUFFER_APPROXIMATION_CANDIDATES 1024
+
+/**
+ * A single variable-length row of terminal data. Rather than storing a full
+ * guac_terminal_char for each column, the codepoint, width, and attributes of
+ * each column are stored within separate dense arrays, with attributes stored
+ * as indices into the attribute table of the buffer containing the row.
  */
 typedef struct guac_terminal_buffer_row {
 
     /**
-     * Array of guac_terminal_char representing the contents of the row.
+     * The Unicode codepoint of the character within each column of the row,
+     * or GUAC_CHAR_CONTINUATION if the column is part of a character which
+     * spans multiple columns. The attributes and widths arrays are stored
+     * within the same allocated block as this array, which is NULL if no
+     * storage has yet been allocated for the row.
+     */
+    int* codepoints;
+
+    /**
+     * The index of the attributes of the character within each column of the
+     * row, relative to the attribute table of the containing buffer.
+     */
+    uint16_t* attributes;
+
+    /**
+     * The number of columns occupied by the character within each column of
+     * the row, or zero for GUAC_CHAR_CONTINUATION.
      */
-    guac_terminal_char* characters;
+    unsigned char* widths;
 
     /**
      * The length of this row in characters. This is the number of initialized
@@ -43,8 +100,9 @@ typedef struct guac_terminal_buffer_row {
     int length;
 
     /**
-     * The number of elements in the characters array. After the length
-     * equals this value, the array must be resized.
+     * The number of elements in each of the codepoints, attributes, and
+     * widths arrays. After the length equals this value, the arrays must be
+     * resized.
      */
     int available;
 
@@ -53,10 +111,16 @@ typedef struct guac_terminal_buffer_row {
 /**
  * A buffer containing a constant number of arbitrary-length rows.
  * New rows can be appended to the buffer, with the oldest row replaced with
- * the new row.
+ * the new row. Storage for each row is allocated only once that row is first
+ * used, and is sized to the width of the terminal at that time.
  */
 typedef struct guac_terminal_buffer {
 
+    /**
+     * The client associated with the terminal using this buffer.
+     */
+    guac_client* client;
+
     /**
      * The character to assign to newly-allocated cells.
      */
@@ -88,13 +152,70 @@ typedef struct guac_terminal_buffer {
      */
     int available;
 
+    /**
+     * Table of every distinct set of attributes used by the characters within
+     * this buffer. Rows refer to attributes by their index within this table.
+     * The attributes of the default character are always at index 0.
+     */
+    guac_terminal_attributes* attributes;
+
+    /**
+     * The number of distinct sets of attributes currently stored within the
+     * attribute table.
+     */
+    int attributes_length;
+
+    /**
+     * The number of sets of attributes which may be stored within the
+     * attribute table before that table must be resized.
+     */
+    int attributes_available;
+
+    /**
+     * Hash table mapping sets of attributes to their indices within the
+     * attribute table, using open addressing. Each entry is one greater than
+     * the index of the corresponding attributes, or zero if unused. This table
+     * always has twice as many entries as attributes_available.
+     */
+    int* attribute_lookup;
+
+    /**
+     * The index of the most recently interned set of attributes. As runs of
+     * identically-styled characters are common, this is checked prior to
+     * consulting the hash table.
+     */
+    int last_attributes;
+
+    /**
+     * The number of sets of attributes which do not fit within the full
+     * attribute table that should still be approximated using the closest
+     * existing attributes before the table is next compacted.
+     */
+    int compaction_deferred;
+
+    /**
+     * The most recent set of attributes which had to be approximated because
+     * the attribute table was full. This is only valid if
+     * last_approximation is non-negative.
+     */
+    guac_terminal_attributes last_approximated;
+
+    /**
+     * The index of the existing attributes used to approximate
+     * last_approximated, or -1 if no attributes have been approximated since
+     * the attribute table was last modified.
+     */
+    int last_approximation;
+
 } guac_terminal_buffer;
 
 /**
  * Allocates a new buffer having the given maximum number of rows. New character cells will
- * be initialized to the given character.
+ * be initialized to the given character. Any messages regarding the buffer
+ * are logged via the given client.
  */
-guac_terminal_buffer* guac_terminal_buffer_alloc(int rows, guac_terminal_char* default_character);
+guac_terminal_buffer* guac_terminal_buffer_alloc(guac_client* client, int rows,
+        guac_terminal_char* default_character);
 
 /**
  * Frees the given buffer.
@@ -107,6 +228,48 @@ void guac_terminal_buffer_free(guac_terminal_buffer* buffer);
  */
 guac_terminal_buffer_row* guac_terminal_buffer_get_row(guac_terminal_buffer* buffer, int row, int width);
 
+/**
+ * Retrieves the character stored within the given column of the given row,
+ * which must be a row of the given buffer.
+ *
+ * @param buffer
+ *     The buffer containing the row.
+ *
+ * @param row
+ *     The row containing the character, as returned by
+ *     guac_terminal_buffer_get_row().
+ *
+ * @param column
+ *     The column containing the character. This MUST be less than the length
+ *     of the row.
+ *
+ * @param character
+ *     The guac_terminal_char to populate with the character stored within the
+ *     given column.
+ */
+void guac_terminal_buffer_get_char(guac_terminal_buffer* buffer,
+        guac_terminal_buffer_row* row, int column,
+        guac_terminal_char* character);
+
+/**
+ * Sets whether the character within the given row and column is highlighted
+ * by the cursor, leaving all other attributes of that character untouched.
+ *
+ * @param buffer
+ *     The buffer containing the character.
+ *
+ * @param row
+ *     The row containing the character.
+ *
+ * @param column
+ *     The column containing the character.
+ *
+ * @param is_cursor
+ *     Whether the character should be highlighted by the cursor.
+ */
+void guac_terminal_buffer_set_cursor(guac_terminal_buffer* buffer, int row,
+        int column, bool is_cursor);
+
 /**
  * Copies the given range of columns to a new location, offset from
  * the original by the given number of columns.
@@ -128,5 +291,44 @@ void guac_terminal_buffer_copy_rows(guac_terminal_buffer* buffer,
 void guac_terminal_buffer_set_columns(guac_terminal_buffer* buffer, int row,
         int start_column, int end_column, guac_terminal_char* character);
 
+/**
+ * Sets a run of consecutive columns within the given row, beginning at the
+ * given column, to characters having the given codepoints and attributes.
+ * Each character MUST occupy exactly one column.
+ *
+ * @param buffer
+ *     The buffer containing the row.
+ *
+ * @param row
+ *     The row containing the columns to set.
+ *
+ * @param start_column
+ *     The first column to set.
+ *
+ * @param codepoints
+ *     The Unicode codepoint of each character in the run.
+ *
+ * @param length
+ *     The number of characters in the run.
+ *
+ * @param attributes
+ *     The attributes to apply to every character in the run.
+ */
+void guac_terminal_buffer_set_codepoints(guac_terminal_buffer* buffer,
+        int row, int start_column, const int* codepoints, int length,
+        const guac_terminal_attributes* attributes);
+
+/**
+ * Returns the total number of bytes of memory currently allocated for the
+ * given buffer, including all rows and the attribute table.
+ *
+ * @param buffer
+ *     The buffer to inspect.
+ *
+ * @return
+ *     The number of bytes of memory allocated for the given buffer.
+ */
+size_t guac_terminal_buffer_get_memory_usage(guac_terminal_buffer* buffer);
+
 #endif
 
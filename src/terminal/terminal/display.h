@@ -24,6 +24,7 @@
 #include "config.h"
 
 #include "common/surface.h"
+#include "glyph-cache.h"
 #include "palette.h"
 #include "types.h"
 
@@ -39,6 +40,30 @@
  */
 #define GUAC_TERMINAL_MAX_CHAR_WIDTH 2
 
+/**
+ * The number of glyph slots in each row of the client-side glyph buffer. Each
+ * slot is wide enough to hold a glyph of the maximum character width.
+ */
+#define GUAC_TERMINAL_GLYPH_BUFFER_COLUMNS 32
+
+/**
+ * Returns the X coordinate of the upper-left corner of the given slot within
+ * the client-side glyph buffer of the given display, in pixels.
+ */
+#define GUAC_TERMINAL_GLYPH_SLOT_X(display, slot) (                        \
+        ((slot) % GUAC_TERMINAL_GLYPH_BUFFER_COLUMNS)                      \
+            * GUAC_TERMINAL_MAX_CHAR_WIDTH * (display)->char_width         \
+)
+
+/**
+ * Returns the Y coordinate of the upper-left corner of the given slot within
+ * the client-side glyph buffer of the given display, in pixels.
+ */
+#define GUAC_TERMINAL_GLYPH_SLOT_Y(display, slot) (                        \
+        ((slot) / GUAC_TERMINAL_GLYPH_BUFFER_COLUMNS)                      \
+            * (display)->char_height                                       \
+)
+
 /**
  * All available terminal operations which affect character cells.
  */
@@ -133,6 +158,34 @@ typedef struct guac_terminal_display {
      */
     int char_height;
 
+    /**
+     * Cache of all recently-rendered glyphs, allowing glyphs which are drawn
+     * repeatedly to be rendered only once.
+     */
+    guac_terminal_glyph_cache* glyph_cache;
+
+    /**
+     * Off-screen buffer containing copies of frequently-used glyphs, such
+     * that those glyphs can be drawn by the client using "copy" instructions
+     * rather than by sending image data. If client-side glyph buffers are
+     * disabled, this will be NULL.
+     */
+    guac_layer* glyph_buffer;
+
+    /**
+     * The surface of the client-side glyph buffer, divided into a regular
+     * grid of slots as defined by GUAC_TERMINAL_GLYPH_BUFFER_COLUMNS and
+     * GUAC_TERMINAL_GLYPH_CACHE_SLOTS. If client-side glyph buffers are
+     * disabled, this will be NULL.
+     */
+    guac_common_surface* glyph_surface;
+
+    /**
+     * The number of the frame currently being flushed. This value is
+     * incremented with each call to guac_terminal_display_flush().
+     */
+    unsigned int frame;
+
     /**
      * The current palette.
      */
@@ -210,12 +263,14 @@ typedef struct guac_terminal_display {
 
 /**
  * Allocates a new display having the given default foreground and background
- * colors.
+ * colors. If glyph_buffers is true, glyphs will be stored within a
+ * client-side buffer and drawn using "copy" instructions rather than being
+ * sent as image data each time they are drawn.
  */
 guac_terminal_display* guac_terminal_display_alloc(guac_client* client,
         const char* font_name, int font_size, int dpi,
         guac_terminal_color* foreground, guac_terminal_color* background,
-        guac_terminal_color (*palette)[256]);
+        guac_terminal_color (*palette)[256], bool glyph_buffers);
 
 /**
  * Frees the given display.
@@ -285,6 +340,34 @@ void guac_terminal_display_copy_columns(guac_terminal_display* display, int row,
 void guac_terminal_display_copy_rows(guac_terminal_display* display,
         int start_row, int end_row, int offset);
 
+/**
+ * Sets a run of consecutive columns within the given row, beginning at the
+ * given column, to characters having the given codepoints and attributes.
+ * Each character MUST occupy exactly one column. Columns outside the bounds
+ * of the display are ignored.
+ *
+ * @param display
+ *     The display to update.
+ *
+ * @param row
+ *     The row containing the columns to set.
+ *
+ * @param start_column
+ *     The first column to set.
+ *
+ * @param codepoints
+ *     The Unicode codepoint of each character in the run.
+ *
+ * @param length
+ *     The number of characters in the run.
+ *
+ * @param attributes
+ *     The attributes to apply to every character in the run.
+ */
+void guac_terminal_display_set_codepoints(guac_terminal_display* display,
+        int row, int start_column, const int* codepoints, int length,
+        const guac_terminal_attributes* attributes);
+
 /**
  * Sets the given range of columns within the given row to the given
  * character.
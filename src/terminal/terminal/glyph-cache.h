@@ -0,0 +1,336 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUAC_TERMINAL_GLYPH_CACHE_H
+#define GUAC_TERMINAL_GLYPH_CACHE_H
+
+#include "config.h"
+
+#include "palette.h"
+#include "types.h"
+
+#include <cairo/cairo.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * The number of hash buckets within each glyph cache. Codepoints are mapped
+ * onto these buckets using __guac_terminal_hash_codepoint(), which produces
+ * values between 0 and 511 inclusive.
+ */
+#define GUAC_TERMINAL_GLYPH_CACHE_BUCKETS 512
+
+/**
+ * The default maximum number of bytes of rendered glyph image data which may
+ * be held within a single glyph cache. Once this limit is exceeded, the least
+ * recently used glyphs are evicted.
+ */
+#define GUAC_TERMINAL_GLYPH_CACHE_DEFAULT_SIZE 4194304
+
+/**
+ * The number of glyph slots within the client-side glyph buffer of each
+ * terminal display, if client-side glyph buffers are enabled.
+ */
+#define GUAC_TERMINAL_GLYPH_CACHE_SLOTS 1024
+
+/**
+ * A single rendered glyph, including the colors and attributes it was
+ * rendered with. Each glyph is simultaneously part of the singly-linked list
+ * of its hash bucket and the doubly-linked least-recently-used list of the
+ * cache which contains it.
+ */
+typedef struct guac_terminal_glyph {
+
+    /**
+     * The Unicode codepoint of the rendered character.
+     */
+    int codepoint;
+
+    /**
+     * The effective foreground color the glyph was rendered with, after
+     * reverse video, bold and half-bright attributes have been applied. Only
+     * the color components are significant.
+     */
+    guac_terminal_color foreground;
+
+    /**
+     * The effective background color the glyph was rendered with, after
+     * reverse video has been applied. Only the color components are
+     * significant.
+     */
+    guac_terminal_color background;
+
+    /**
+     * Whether the glyph was rendered bold.
+     */
+    bool bold;
+
+    /**
+     * Whether the glyph was rendered with half brightness.
+     */
+    bool half_bright;
+
+    /**
+     * Whether the glyph was rendered with underscore.
+     */
+    bool underscore;
+
+    /**
+     * The rendered glyph, sized to exactly fill the character cells it
+     * occupies.
+     */
+    cairo_surface_t* surface;
+
+    /**
+     * The number of bytes of image data within the rendered surface.
+     */
+    size_t size;
+
+    /**
+     * The index of the slot within the client-side glyph buffer which
+     * currently contains a copy of this glyph, or -1 if the glyph is not
+     * currently present within the client-side glyph buffer.
+     */
+    int slot;
+
+    /**
+     * The frame during which this glyph was last drawn from its slot within
+     * the client-side glyph buffer. A glyph drawn during the current frame
+     * will not have its slot reassigned to another glyph until a later frame.
+     */
+    unsigned int slot_frame;
+
+    /**
+     * The next glyph within the same hash bucket, or NULL if this is the last
+     * glyph in the bucket.
+     */
+    struct guac_terminal_glyph* next;
+
+    /**
+     * The next more recently used glyph, or NULL if this is the most recently
+     * used glyph in the cache.
+     */
+    struct guac_terminal_glyph* newer;
+
+    /**
+     * The next less recently used glyph, or NULL if this is the least
+     * recently used glyph in the cache.
+     */
+    struct guac_terminal_glyph* older;
+
+} guac_terminal_glyph;
+
+/**
+ * A bounded cache of rendered glyphs, allowing each distinct combination of
+ * codepoint, colors and attributes to be rasterized only once.
+ */
+typedef struct guac_terminal_glyph_cache {
+
+    /**
+     * Hash table of all cached glyphs, keyed by
+     * __guac_terminal_hash_codepoint().
+     */
+    guac_terminal_glyph* buckets[GUAC_TERMINAL_GLYPH_CACHE_BUCKETS];
+
+    /**
+     * The most recently used glyph, or NULL if the cache is empty.
+     */
+    guac_terminal_glyph* newest;
+
+    /**
+     * The least recently used glyph, or NULL if the cache is empty.
+     */
+    guac_terminal_glyph* oldest;
+
+    /**
+     * The total number of bytes of image data currently cached.
+     */
+    size_t size;
+
+    /**
+     * The maximum number of bytes of image data which may be cached.
+     */
+    size_t max_size;
+
+    /**
+     * Array of the glyphs currently occupying each slot of the client-side
+     * glyph buffer, where unoccupied slots are NULL. If client-side glyph
+     * buffers are not in use, this will be NULL.
+     */
+    guac_terminal_glyph** slots;
+
+    /**
+     * The total number of slots within the client-side glyph buffer.
+     */
+    int slot_count;
+
+    /**
+     * The number of slots within the client-side glyph buffer which are
+     * currently occupied.
+     */
+    int slots_used;
+
+} guac_terminal_glyph_cache;
+
+/**
+ * Maps any codepoint onto a number between 0 and 511 inclusive.
+ *
+ * @param codepoint
+ *     The codepoint to hash.
+ *
+ * @return
+ *     A number between 0 and 511 inclusive.
+ */
+int __guac_terminal_hash_codepoint(int codepoint);
+
+/**
+ * Allocates a new, empty glyph cache which will hold no more than the given
+ * number of bytes of rendered glyph data. If a non-zero number of slots is
+ * given, the cache will additionally track which glyphs occupy each slot of a
+ * client-side glyph buffer of that size.
+ *
+ * @param max_size
+ *     The maximum number of bytes of rendered image data to cache.
+ *
+ * @param slot_count
+ *     The number of slots within the client-side glyph buffer, or zero if
+ *     client-side glyph buffers will not be used.
+ *
+ * @return
+ *     A newly-allocated glyph cache, which must eventually be freed with
+ *     guac_terminal_glyph_cache_free().
+ */
+guac_terminal_glyph_cache* guac_terminal_glyph_cache_alloc(size_t max_size,
+        int slot_count);
+
+/**
+ * Frees the given glyph cache and all glyphs within it.
+ *
+ * @param cache
+ *     The glyph cache to free.
+ */
+void guac_terminal_glyph_cache_free(guac_terminal_glyph_cache* cache);
+
+/**
+ * Removes and frees all glyphs within the given cache, releasing all slots of
+ * the client-side glyph buffer. This must be invoked whenever
+ * previously-rendered glyphs are no longer valid, such as when the font
+ * changes.
+ *
+ * @param cache
+ *     The glyph cache to clear.
+ */
+void guac_terminal_glyph_cache_clear(guac_terminal_glyph_cache* cache);
+
+/**
+ * Returns the cached glyph matching the given codepoint, colors and
+ * attributes, marking that glyph as most recently used. If no such glyph has
+ * been cached, NULL is returned.
+ *
+ * @param cache
+ *     The glyph cache to search.
+ *
+ * @param codepoint
+ *     The codepoint of the desired glyph.
+ *
+ * @param foreground
+ *     The effective foreground color of the desired glyph.
+ *
+ * @param background
+ *     The effective background color of the desired glyph.
+ *
+ * @param attributes
+ *     The attributes of the desired glyph. Only the bold, half-bright and
+ *     underscore attributes are considered.
+ *
+ * @return
+ *     The matching cached glyph, or NULL if no such glyph is cached.
+ */
+guac_terminal_glyph* guac_terminal_glyph_cache_get(
+        guac_terminal_glyph_cache* cache, int codepoint,
+        const guac_terminal_color* foreground,
+        const guac_terminal_color* background,
+        const guac_terminal_attributes* attributes);
+
+/**
+ * Adds the given rendered glyph to the cache, evicting least recently used
+ * glyphs as necessary to remain within the size limit of the cache. The cache
+ * takes ownership of the given surface, which will be destroyed when the
+ * glyph is evicted. The newly-added glyph is never evicted by this call, even
+ * if it alone exceeds the size limit.
+ *
+ * @param cache
+ *     The glyph cache to add the glyph to.
+ *
+ * @param codepoint
+ *     The codepoint of the rendered glyph.
+ *
+ * @param foreground
+ *     The effective foreground color the glyph was rendered with.
+ *
+ * @param background
+ *     The effective background color the glyph was rendered with.
+ *
+ * @param attributes
+ *     The attributes the glyph was rendered with. Only the bold, half-bright
+ *     and underscore attributes are considered.
+ *
+ * @param surface
+ *     The rendered glyph.
+ *
+ * @return
+ *     The newly-added glyph.
+ */
+guac_terminal_glyph* guac_terminal_glyph_cache_add(
+        guac_terminal_glyph_cache* cache, int codepoint,
+        const guac_terminal_color* foreground,
+        const guac_terminal_color* background,
+        const guac_terminal_attributes* attributes,
+        cairo_surface_t* surface);
+
+/**
+ * Assigns the given glyph a slot within the client-side glyph buffer, if it
+ * does not already have one, and marks that slot as in use for the given
+ * frame. If all slots are occupied, the slot of the least recently used glyph
+ * which has not been drawn during the given frame is reassigned.
+ *
+ * @param cache
+ *     The glyph cache containing the glyph.
+ *
+ * @param glyph
+ *     The glyph which should occupy a slot.
+ *
+ * @param frame
+ *     The number of the frame currently being rendered.
+ *
+ * @param assigned
+ *     Pointer to an int which will be set to non-zero if the glyph was newly
+ *     assigned a slot (and thus must be drawn to the client-side glyph buffer
+ *     before use), or zero if the glyph already occupied a slot.
+ *
+ * @return
+ *     The index of the slot occupied by the glyph, or -1 if no slot could be
+ *     assigned, in which case the glyph must be drawn directly.
+ */
+int guac_terminal_glyph_cache_assign_slot(guac_terminal_glyph_cache* cache,
+        guac_terminal_glyph* glyph, unsigned int frame, int* assigned);
+
+#endif
+
@@ -382,6 +382,19 @@ struct guac_terminal {
      */
     guac_terminal_char_handler* char_handler;
 
+    /**
+     * The number of bytes remaining within the UTF-8 sequence currently being
+     * decoded by guac_terminal_echo(), or zero if no such sequence is in
+     * progress.
+     */
+    int utf8_bytes_remaining;
+
+    /**
+     * The portion of the codepoint decoded thus far from the UTF-8 sequence
+     * currently being decoded by guac_terminal_echo().
+     */
+    int utf8_codepoint;
+
     /**
      * The difference between the currently-rendered screen and the current
      * state of the terminal, and the contextual information necessary to
@@ -607,6 +620,11 @@ struct guac_terminal {
  *     The integer ASCII code to send when backspace is pressed in
  *     this terminal.
  *
+ * @param glyph_buffers
+ *     Whether rendered glyphs should be stored within client-side buffers,
+ *     such that repeated glyphs are drawn using "copy" instructions rather
+ *     than by sending image data.
+ *
  * @return
  *     A new guac_terminal having the given font, dimensions, and attributes
  *     which renders all text to the given client.
@@ -615,7 +633,7 @@ guac_terminal* guac_terminal_create(guac_client* client,
         guac_common_clipboard* clipboard, bool disable_copy,
         int max_scrollback, const char* font_name, int font_size, int dpi,
         int width, int height, const char* color_scheme,
-        const int backspace);
+        const int backspace, bool glyph_buffers);
 
 /**
  * Frees all resources associated with the given terminal.
@@ -850,6 +868,35 @@ int guac_terminal_write(guac_terminal* term, const char* c, int size);
  */
 int guac_terminal_set(guac_terminal* term, int row, int col, int codepoint);
 
+/**
+ * Sets a run of consecutive characters within the given row, beginning at the
+ * given column, to the specified values using the current attributes of the
+ * terminal. Each character MUST occupy exactly one column, and the run MUST
+ * fit within the terminal. This has the same effect as calling
+ * guac_terminal_set() for each character, but updates the buffer and display
+ * once for the entire run.
+ *
+ * @param term
+ *     The terminal to update.
+ *
+ * @param row
+ *     The row containing the characters to set.
+ *
+ * @param col
+ *     The column of the first character to set.
+ *
+ * @param codepoints
+ *     The Unicode codepoints of each character in the run.
+ *
+ * @param length
+ *     The number of characters in the run.
+ *
+ * @return
+ *     Zero if the characters were set successfully, non-zero otherwise.
+ */
+int guac_terminal_set_codepoints(guac_terminal* term, int row, int col,
+        const int* codepoints, int length);
+
 /**
  * Clears the given region within a single row.
  */
@@ -38,6 +38,30 @@
  */
 int guac_terminal_echo(guac_terminal* term, unsigned char c);
 
+/**
+ * Handles a run of printable characters at the beginning of the given data in
+ * bulk, writing each row of that run to the terminal at once, with the same
+ * result as if each byte had been passed to guac_terminal_echo(). This must
+ * only be called while guac_terminal_echo() is the active character handler.
+ * Handling stops at the first byte which guac_terminal_echo() would need to
+ * interpret, such as a control character or the start of an escape sequence.
+ *
+ * @param term
+ *     The terminal that received the given data.
+ *
+ * @param data
+ *     The data received by the given terminal.
+ *
+ * @param size
+ *     The number of bytes of data received.
+ *
+ * @return
+ *     The number of bytes handled, which may be zero if the data does not
+ *     begin with a printable character or if the terminal is in a state
+ *     requiring each character to be handled individually.
+ */
+int guac_terminal_echo_run(guac_terminal* term, const char* data, int size);
+
 /**
  * Handles any characters which follow an ANSI ESC (0x1B) character.
  *
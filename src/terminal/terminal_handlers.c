@@ -49,6 +49,12 @@
  */
 #define GUAC_TERMINAL_OK          "\x1B[0n"
 
+/**
+ * The maximum number of characters which may be written to the terminal as a
+ * single run by guac_terminal_echo_run(). Longer runs are split.
+ */
+#define GUAC_TERMINAL_MAX_RUN_LENGTH 256
+
 /**
  * Advances the cursor to the next row, scrolling if the cursor would otherwise
  * leave the scrolling region. If the cursor is already outside the scrolling
@@ -128,8 +134,8 @@ int guac_terminal_echo(guac_terminal* term, unsigned char c) {
 
     int width;
 
-    static int bytes_remaining = 0;
-    static int codepoint = 0;
+    int bytes_remaining = term->utf8_bytes_remaining;
+    int codepoint = term->utf8_codepoint;
 
     const int* char_mapping = term->char_mapping[term->active_char_set];
 
@@ -187,6 +193,10 @@ int guac_terminal_echo(guac_terminal* term, unsigned char c) {
         bytes_remaining = 0;
     }
 
+    /* Store decoder state for subsequent bytes */
+    term->utf8_bytes_remaining = bytes_remaining;
+    term->utf8_codepoint = codepoint;
+
     /* If we need more bytes, wait for more bytes */
     if (bytes_remaining != 0)
         return 0;
@@ -296,6 +306,160 @@ int guac_terminal_echo(guac_terminal* term, unsigned char c) {
 
 }
 
+/**
+ * Decodes the character at the beginning of the given data if that character
+ * is printable and occupies exactly one column, such that it can be written
+ * as part of a run by guac_terminal_echo_run() with the same result as if it
+ * had been handled by guac_terminal_echo(). Control characters, incomplete or
+ * malformed UTF-8 sequences, and characters of any other width are not
+ * decoded.
+ *
+ * @param char_mapping
+ *     The active character mapping of the terminal, or NULL if UTF-8 is in
+ *     use.
+ *
+ * @param data
+ *     The data to decode.
+ *
+ * @param size
+ *     The number of bytes available within the given data. This MUST be at
+ *     least 1.
+ *
+ * @param codepoint
+ *     Pointer to an int which will receive the codepoint of the decoded
+ *     character, after any character mapping has been applied.
+ *
+ * @return
+ *     The number of bytes making up the decoded character, or zero if the
+ *     data does not begin with a printable, single-column character.
+ */
+static int guac_terminal_decode_printable(const int* char_mapping,
+        const unsigned char* data, int size, int* codepoint) {
+
+    int i, length, value;
+    unsigned char c = data[0];
+
+    /* Printable ASCII, mapped through any non-Unicode character mapping */
+    if (c >= 0x20 && c < 0x7F) {
+
+        if (char_mapping == NULL) {
+            *codepoint = c;
+            return 1;
+        }
+
+        *codepoint = char_mapping[c - 0x20];
+        return wcwidth(*codepoint) == 1 ? 1 : 0;
+
+    }
+
+    /* Only UTF-8 may contain multibyte characters */
+    if (char_mapping != NULL)
+        return 0;
+
+    /* 2-byte UTF-8 codepoint */
+    if ((c & 0xE0) == 0xC0) { /* 110xxxxx */
+        value = c & 0x1F;
+        length = 2;
+    }
+
+    /* 3-byte UTF-8 codepoint */
+    else if ((c & 0xF0) == 0xE0) { /* 1110xxxx */
+        value = c & 0x0F;
+        length = 3;
+    }
+
+    /* 4-byte UTF-8 codepoint */
+    else if ((c & 0xF8) == 0xF0) { /* 11110xxx */
+        value = c & 0x07;
+        length = 4;
+    }
+
+    /* Anything else is handled individually */
+    else
+        return 0;
+
+    /* Entire sequence must be available */
+    if (size < length)
+        return 0;
+
+    /* Decode continuation bytes */
+    for (i = 1; i < length; i++) {
+        if ((data[i] & 0xC0) != 0x80) /* 10xxxxxx */
+            return 0;
+        value = (value << 6) | (data[i] & 0x3F);
+    }
+
+    /* C1 control characters (including CSI) must be interpreted */
+    if (value < 0xA0 || wcwidth(value) != 1)
+        return 0;
+
+    *codepoint = value;
+    return length;
+
+}
+
+int guac_terminal_echo_run(guac_terminal* term, const char* data, int size) {
+
+    int codepoints[GUAC_TERMINAL_MAX_RUN_LENGTH];
+    const unsigned char* current = (const unsigned char*) data;
+    int consumed = 0;
+
+    /* Characters can only be handled in bulk if no other processing would be
+     * required, such as echoing to an open pipe stream or shifting existing
+     * characters in insert mode */
+    if (term->pipe_stream != NULL || term->insert_mode
+            || term->utf8_bytes_remaining != 0)
+        return 0;
+
+    const int* char_mapping = term->char_mapping[term->active_char_set];
+
+    while (consumed < size) {
+
+        int codepoint;
+        int length = 0;
+
+        /* Stop at first character requiring individual handling */
+        int bytes = guac_terminal_decode_printable(char_mapping, current,
+                size - consumed, &codepoint);
+        if (bytes == 0)
+            break;
+
+        /* Wrap if necessary */
+        if (term->cursor_col >= term->term_width) {
+            term->cursor_col = 0;
+            guac_terminal_linefeed(term);
+        }
+
+        /* Collect as many characters as fit within the current row */
+        int available = term->term_width - term->cursor_col;
+        if (available > GUAC_TERMINAL_MAX_RUN_LENGTH)
+            available = GUAC_TERMINAL_MAX_RUN_LENGTH;
+
+        do {
+
+            codepoints[length++] = codepoint;
+            current += bytes;
+            consumed += bytes;
+
+            if (length == available || consumed == size)
+                break;
+
+            bytes = guac_terminal_decode_printable(char_mapping, current,
+                    size - consumed, &codepoint);
+
+        } while (bytes != 0);
+
+        /* Write entire run at once and advance cursor */
+        guac_terminal_set_codepoints(term, term->cursor_row, term->cursor_col,
+                codepoints, length);
+        term->cursor_col += length;
+
+    }
+
+    return consumed;
+
+}
+
 int guac_terminal_escape(guac_terminal* term, unsigned char c) {
 
     switch (c) {
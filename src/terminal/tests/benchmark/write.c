@@ -0,0 +1,147 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "common/clipboard.h"
+#include "terminal/terminal.h"
+
+#include <guacamole/client.h>
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/**
+ * The width of the benchmarked terminal display, in pixels.
+ */
+#define BENCHMARK_WIDTH 1024
+
+/**
+ * The height of the benchmarked terminal display, in pixels.
+ */
+#define BENCHMARK_HEIGHT 768
+
+/**
+ * The number of times the recorded output is written to the terminal if no
+ * repeat count is given.
+ */
+#define BENCHMARK_DEFAULT_PASSES 10
+
+/**
+ * Returns the current value of a monotonic clock, in seconds.
+ *
+ * @return
+ *     The current value of the monotonic clock, in seconds.
+ */
+static double benchmark_now() {
+    struct timespec current;
+    clock_gettime(CLOCK_MONOTONIC, &current);
+    return current.tv_sec + current.tv_nsec / 1000000000.0;
+}
+
+/**
+ * Reads the entire contents of the given file into a newly-allocated buffer.
+ *
+ * @param path
+ *     The path of the file to read.
+ *
+ * @param length
+ *     Pointer to an int which will receive the number of bytes read.
+ *
+ * @return
+ *     A newly-allocated buffer containing the file contents, which must be
+ *     freed with free(), or NULL if the file could not be read.
+ */
+static char* benchmark_read_file(const char* path, int* length) {
+
+    FILE* file = fopen(path, "rb");
+    if (file == NULL)
+        return NULL;
+
+    int available = 65536;
+    char* data = malloc(available);
+    *length = 0;
+
+    size_t read;
+    while ((read = fread(data + *length, 1, available - *length, file)) > 0) {
+        *length += read;
+        if (*length == available) {
+            available *= 2;
+            data = realloc(data, available);
+        }
+    }
+
+    fclose(file);
+    return data;
+
+}
+
+/**
+ * Writes recorded terminal output, such as the data file of a typescript,
+ * to a terminal repeatedly, printing the throughput achieved by the terminal
+ * emulator.
+ *
+ * Usage: benchmark_terminal FILE [PASSES]
+ */
+int main(int argc, char** argv) {
+
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s FILE [PASSES]\n", argv[0]);
+        return 1;
+    }
+
+    int passes = BENCHMARK_DEFAULT_PASSES;
+    if (argc > 2)
+        passes = atoi(argv[2]);
+
+    int length;
+    char* data = benchmark_read_file(argv[1], &length);
+    if (data == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    guac_client* client = guac_client_alloc();
+    guac_common_clipboard* clipboard = guac_common_clipboard_alloc(262144);
+
+    guac_terminal* term = guac_terminal_create(client, clipboard, false,
+            1000, "monospace", 12, 96, BENCHMARK_WIDTH, BENCHMARK_HEIGHT,
+            "", 127, false);
+
+    if (term == NULL) {
+        fprintf(stderr, "Terminal initialization failed.\n");
+        return 1;
+    }
+
+    double start = benchmark_now();
+    for (int pass = 0; pass < passes; pass++)
+        guac_terminal_write(term, data, length);
+    double elapsed = benchmark_now() - start;
+
+    printf("%d bytes x %d passes in %.3f s: %.2f MB/s\n", length, passes,
+            elapsed, (double) length * passes / elapsed / 1000000.0);
+
+    guac_terminal_free(term);
+    guac_common_clipboard_free(clipboard);
+    guac_client_free(client);
+    free(data);
+
+    return 0;
+
+}